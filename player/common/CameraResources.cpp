@@ -89,34 +89,30 @@ namespace DXHelper
                 // Set render target size.
                 m_d3dRenderTargetSize = currentSize;
 
-                // A new depth stencil view is also needed.
-                m_d3dDepthStencilView = nullptr;
+                // A new depth stencil view is also needed. The current one is kept for cameras of the previous size.
+                pDeviceResources->GetDepthTargetPool().Release(std::move(m_depthTarget));
             }
         }
 
         // Refresh depth stencil resources, if needed.
-        if (m_d3dDepthStencilView == nullptr)
+        if (m_depthTarget == nullptr)
         {
-            // Create a depth stencil view for use with 3D rendering if needed.
-            CD3D11_TEXTURE2D_DESC depthStencilDesc(
-                DXGI_FORMAT_R16_TYPELESS,
-                static_cast<UINT>(m_d3dRenderTargetSize.Width),
-                static_cast<UINT>(m_d3dRenderTargetSize.Height),
-                m_isStereo ? 2 : 1, // Create two textures when rendering in stereo.
-                1,                  // Use a single mipmap level.
-                D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE);
-
-            // Allow sharing by default for easier interop with future D3D12 components for processing the remote or local frame.
-            // This is optional, but without the flag any D3D12 components need to perform an additional copy.
-            depthStencilDesc.MiscFlags = D3D11_RESOURCE_MISC_SHARED;
-
-            m_d3dDepthStencil = nullptr;
-            winrt::check_hresult(device->CreateTexture2D(&depthStencilDesc, nullptr, m_d3dDepthStencil.put()));
-
-            CD3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc(
-                m_isStereo ? D3D11_DSV_DIMENSION_TEXTURE2DARRAY : D3D11_DSV_DIMENSION_TEXTURE2D, DXGI_FORMAT_D16_UNORM);
-            winrt::check_hresult(
-                device->CreateDepthStencilView(m_d3dDepthStencil.get(), &depthStencilViewDesc, m_d3dDepthStencilView.put()));
+            const D3D11_TEXTURE2D_DESC depthStencilDesc = GetDepthStencilDesc(m_d3dRenderTargetSize, m_isStereo);
+
+            // Use the depth stencil prepared for this size, if there is one, otherwise take one from the pool.
+            if (m_preparedDepthTarget.valid())
+            {
+                m_depthTarget = m_preparedDepthTarget.get();
+                if (m_depthTarget->desc.Width != depthStencilDesc.Width || m_depthTarget->desc.Height != depthStencilDesc.Height)
+                {
+                    pDeviceResources->GetDepthTargetPool().Release(std::move(m_depthTarget));
+                }
+            }
+
+            if (m_depthTarget == nullptr)
+            {
+                m_depthTarget = pDeviceResources->GetDepthTargetPool().Acquire(device, depthStencilDesc, DXGI_FORMAT_D16_UNORM);
+            }
         }
 
         // Create the constant buffer, if needed.
@@ -126,18 +122,73 @@ namespace DXHelper
             CD3D11_BUFFER_DESC constantBufferDesc(sizeof(ViewProjectionConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
             constantBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
             constantBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-            winrt::check_hresult(device->CreateBuffer(&constantBufferDesc, nullptr, m_viewProjectionConstantBuffer.put()));
+            pDeviceResources->CreateBuffer(
+                MemoryAccounting::Tag::Cameras, constantBufferDesc, nullptr, m_viewProjectionConstantBuffer.put());
+        }
+    }
+
+    void CameraResources::PrepareDepthStencil(DeviceResourcesUWP* pDeviceResources, winrt::Windows::Foundation::Size renderTargetSize)
+    {
+        if (renderTargetSize == m_d3dRenderTargetSize)
+        {
+            return;
+        }
+
+        DepthTargetPool& pool = pDeviceResources->GetDepthTargetPool();
+        ReleasePreparedDepthTarget(pool);
+
+        // Resources can be created on any thread, only the device context is bound to the render thread.
+        winrt::com_ptr<ID3D11Device> device;
+        device.copy_from(pDeviceResources->GetD3DDevice());
+        m_preparedDepthTarget =
+            std::async(std::launch::async, [&pool, device, depthStencilDesc = GetDepthStencilDesc(renderTargetSize, m_isStereo)]() {
+                return pool.Acquire(device.get(), depthStencilDesc, DXGI_FORMAT_D16_UNORM);
+            });
+    }
+
+    void CameraResources::ReleasePreparedDepthTarget(DepthTargetPool& pool)
+    {
+        if (m_preparedDepthTarget.valid())
+        {
+            try
+            {
+                pool.Release(m_preparedDepthTarget.get());
+            }
+            catch (const winrt::hresult_error&)
+            {
+                // Taking it failed, e.g. because the device was lost, which the next frame handles.
+            }
         }
     }
 
+    D3D11_TEXTURE2D_DESC CameraResources::GetDepthStencilDesc(winrt::Windows::Foundation::Size size, bool isStereo)
+    {
+        // Describes a depth stencil view for use with 3D rendering.
+        CD3D11_TEXTURE2D_DESC depthStencilDesc(
+            DXGI_FORMAT_R16_TYPELESS,
+            static_cast<UINT>(size.Width),
+            static_cast<UINT>(size.Height),
+            isStereo ? 2 : 1, // Create two textures when rendering in stereo.
+            1,                // Use a single mipmap level.
+            D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE);
+
+        // Allow sharing by default for easier interop with future D3D12 components for processing the remote or local frame.
+        // This is optional, but without the flag any D3D12 components need to perform an additional copy.
+        depthStencilDesc.MiscFlags = D3D11_RESOURCE_MISC_SHARED;
+
+        return depthStencilDesc;
+    }
+
     // Releases resources associated with a back buffer.
     void CameraResources::ReleaseResourcesForBackBuffer(DeviceResourcesUWP* pDeviceResources)
     {
+        DepthTargetPool& pool = pDeviceResources->GetDepthTargetPool();
+        ReleasePreparedDepthTarget(pool);
+
         // Release camera-specific resources.
         m_d3dBackBuffer = nullptr;
-        m_d3dDepthStencil = nullptr;
         m_d3dRenderTargetView = nullptr;
-        m_d3dDepthStencilView = nullptr;
+        pool.Release(std::move(m_depthTarget));
         m_viewProjectionConstantBuffer = nullptr;
 
         pDeviceResources->UseD3DDeviceContext([](auto context) {
@@ -242,14 +293,7 @@ namespace DXHelper
 
     winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface CameraResources::GetDepthStencilTextureInteropObject()
     {
-        // Direct3D interop APIs are used to provide the buffer to the WinRT API.
-        winrt::com_ptr<IDXGIResource1> depthStencilResource;
-        winrt::check_bool(m_d3dDepthStencil.try_as(depthStencilResource));
-        winrt::com_ptr<IDXGISurface2> depthDxgiSurface;
-        winrt::check_hresult(depthStencilResource->CreateSubresourceSurface(0, depthDxgiSurface.put()));
-        winrt::com_ptr<::IInspectable> inspectableSurface;
-        winrt::check_hresult(CreateDirect3D11SurfaceFromDXGISurface(
-            depthDxgiSurface.get(), reinterpret_cast<IInspectable**>(winrt::put_abi(inspectableSurface))));
-        return inspectableSurface.as<winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface>();
+        // The surface is kept with the depth target, so committing the depth buffer every frame does not create one.
+        return m_depthTarget->GetInteropSurface();
     }
 } // namespace DXHelper
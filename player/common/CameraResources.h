@@ -10,6 +10,8 @@
 
 #pragma once
 
+#include "DepthTargetPool.h"
+
 namespace DXHelper
 {
     class DeviceResourcesUWP;
@@ -37,6 +39,10 @@ namespace DXHelper
             winrt::Windows::Graphics::Holographic::HolographicCameraRenderingParameters const& cameraParameters);
         void ReleaseResourcesForBackBuffer(DeviceResourcesUWP* pDeviceResources);
 
+        // Takes the depth stencil for a render target size from the pool on a worker thread. Once the back buffer has this size, the depth
+        // stencil is swapped in by CreateResourcesForBackBuffer instead of being created within that frame.
+        void PrepareDepthStencil(DeviceResourcesUWP* pDeviceResources, winrt::Windows::Foundation::Size renderTargetSize);
+
         void UpdateViewProjectionBuffer(
             std::shared_ptr<DeviceResourcesUWP> deviceResources,
             winrt::Windows::Graphics::Holographic::HolographicCameraPose const& cameraPose,
@@ -51,7 +57,7 @@ namespace DXHelper
         }
         ID3D11DepthStencilView* GetDepthStencilView() const
         {
-            return m_d3dDepthStencilView.get();
+            return m_depthTarget ? m_depthTarget->view.get() : nullptr;
         }
         ID3D11Texture2D* GetBackBufferTexture2D() const
         {
@@ -59,7 +65,7 @@ namespace DXHelper
         }
         ID3D11Texture2D* GetDepthStencilTexture2D() const
         {
-            return m_d3dDepthStencil.get();
+            return m_depthTarget ? m_depthTarget->texture.get() : nullptr;
         }
         D3D11_VIEWPORT GetViewport() const
         {
@@ -99,11 +105,20 @@ namespace DXHelper
         }
 
     private:
+        static D3D11_TEXTURE2D_DESC GetDepthStencilDesc(winrt::Windows::Foundation::Size size, bool isStereo);
+
+        // Waits for the depth target taken by PrepareDepthStencil, if any, and returns it to the pool.
+        void ReleasePreparedDepthTarget(DepthTargetPool& pool);
+
         // Direct3D rendering objects. Required for 3D.
         winrt::com_ptr<ID3D11RenderTargetView> m_d3dRenderTargetView;
-        winrt::com_ptr<ID3D11DepthStencilView> m_d3dDepthStencilView;
         winrt::com_ptr<ID3D11Texture2D> m_d3dBackBuffer;
-        winrt::com_ptr<ID3D11Texture2D> m_d3dDepthStencil;
+
+        // Taken from and returned to the depth target pool of the device resources.
+        std::shared_ptr<DepthTarget> m_depthTarget;
+
+        // Depth target taken by PrepareDepthStencil.
+        std::future<std::shared_ptr<DepthTarget>> m_preparedDepthTarget;
 
         // Device resource to store view and projection matrices.
         winrt::com_ptr<ID3D11Buffer> m_viewProjectionConstantBuffer;
@@ -23,10 +23,17 @@
 
 #include <algorithm>
 #include <assert.h>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string_view>
+#include <tuple>
+#include <vector>
 
 #include "DDSTextureLoader.h"
 
+#include "..\Common\MemoryAccounting.h"
+
 #if !defined(NO_D3D11_DEBUG_NAME) && (defined(_DEBUG) || defined(PROFILE))
 #    pragma comment(lib, "dxguid.lib")
 #endif
@@ -1010,6 +1017,8 @@ static HRESULT CreateD3DResources(
             hr = d3dDevice->CreateTexture2D(&desc, initData, &tex);
             if (SUCCEEDED(hr) && tex != 0)
             {
+                MemoryAccounting::TrackGpuResource(MemoryAccounting::Tag::Textures, tex);
+
                 if (textureView != 0)
                 {
                     D3D11_SHADER_RESOURCE_VIEW_DESC SRVDesc;
@@ -1414,19 +1423,25 @@ static HRESULT CreateTextureFromDDS(
     }
     else
     {
-        // Create the texture
-        std::unique_ptr<D3D11_SUBRESOURCE_DATA[]> initData(new (std::nothrow) D3D11_SUBRESOURCE_DATA[mipCount * arraySize]);
-        if (!initData)
+        // Create the texture with all array slices and mip levels in one go. The subresource array is reused by the following
+        // textures created on this thread.
+        thread_local std::vector<D3D11_SUBRESOURCE_DATA> initDataPool;
+        try
+        {
+            initDataPool.resize(std::max(initDataPool.size(), mipCount * arraySize));
+        }
+        catch (const std::bad_alloc&)
         {
             return E_OUTOFMEMORY;
         }
+        D3D11_SUBRESOURCE_DATA* const initData = initDataPool.data();
 
         size_t skipMip = 0;
         size_t twidth = 0;
         size_t theight = 0;
         size_t tdepth = 0;
         hr = FillInitData(
-            width, height, depth, mipCount, arraySize, format, maxsize, bitSize, bitData, twidth, theight, tdepth, skipMip, initData.get());
+            width, height, depth, mipCount, arraySize, format, maxsize, bitSize, bitData, twidth, theight, tdepth, skipMip, initData);
 
         if (SUCCEEDED(hr))
         {
@@ -1445,7 +1460,7 @@ static HRESULT CreateTextureFromDDS(
                 miscFlags,
                 forceSRGB,
                 isCubeMap,
-                initData.get(),
+                initData,
                 texture,
                 textureView);
 
@@ -1492,7 +1507,7 @@ static HRESULT CreateTextureFromDDS(
                     theight,
                     tdepth,
                     skipMip,
-                    initData.get());
+                    initData);
                 if (SUCCEEDED(hr))
                 {
                     hr = CreateD3DResources(
@@ -1510,7 +1525,7 @@ static HRESULT CreateTextureFromDDS(
                         miscFlags,
                         forceSRGB,
                         isCubeMap,
-                        initData.get(),
+                        initData,
                         texture,
                         textureView);
                 }
@@ -1892,3 +1907,317 @@ _Use_decl_annotations_ HRESULT DirectX::CreateDDSTextureFromFileEx(
 
     return hr;
 }
+
+//--------------------------------------------------------------------------------------
+_Use_decl_annotations_ HRESULT DirectX::GetDDSTexture2DLayout(
+    const uint8_t* ddsData, size_t ddsDataSize, bool forceSRGB, DDSTexture2DLayout* layout)
+{
+    if (!ddsData || !layout)
+    {
+        return E_INVALIDARG;
+    }
+
+    *layout = {};
+
+    // Validate DDS file in memory
+    if (ddsDataSize < (sizeof(uint32_t) + sizeof(DDS_HEADER)))
+    {
+        return E_FAIL;
+    }
+
+    uint32_t dwMagicNumber = *(const uint32_t*)(ddsData);
+    if (dwMagicNumber != DDS_MAGIC)
+    {
+        return E_FAIL;
+    }
+
+    auto header = reinterpret_cast<const DDS_HEADER*>(ddsData + sizeof(uint32_t));
+
+    // Verify header to validate DDS file
+    if (header->size != sizeof(DDS_HEADER) || header->ddspf.size != sizeof(DDS_PIXELFORMAT))
+    {
+        return E_FAIL;
+    }
+
+    size_t mipCount = header->mipMapCount;
+    if (0 == mipCount)
+    {
+        mipCount = 1;
+    }
+
+    DXGI_FORMAT format = DXGI_FORMAT_UNKNOWN;
+    ptrdiff_t offset = sizeof(uint32_t) + sizeof(DDS_HEADER);
+
+    // Check for DX10 extension
+    if ((header->ddspf.flags & DDS_FOURCC) && (MAKEFOURCC('D', 'X', '1', '0') == header->ddspf.fourCC))
+    {
+        // Must be long enough for both headers and magic value
+        if (ddsDataSize < (sizeof(DDS_HEADER) + sizeof(uint32_t) + sizeof(DDS_HEADER_DXT10)))
+        {
+            return E_FAIL;
+        }
+
+        auto d3d10ext = reinterpret_cast<const DDS_HEADER_DXT10*>((const char*)header + sizeof(DDS_HEADER));
+        if (d3d10ext->resourceDimension != D3D11_RESOURCE_DIMENSION_TEXTURE2D || d3d10ext->arraySize != 1 ||
+            (d3d10ext->miscFlag & D3D11_RESOURCE_MISC_TEXTURECUBE))
+        {
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
+
+        switch (d3d10ext->dxgiFormat)
+        {
+            case DXGI_FORMAT_AI44:
+            case DXGI_FORMAT_IA44:
+            case DXGI_FORMAT_P8:
+            case DXGI_FORMAT_A8P8:
+                return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+
+            default:
+                if (BitsPerPixel(d3d10ext->dxgiFormat) == 0)
+                {
+                    return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+                }
+        }
+
+        format = d3d10ext->dxgiFormat;
+        offset += sizeof(DDS_HEADER_DXT10);
+    }
+    else
+    {
+        if ((header->flags & DDS_HEADER_FLAGS_VOLUME) || (header->caps2 & DDS_CUBEMAP))
+        {
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
+
+        format = GetDXGIFormat(header->ddspf);
+        if (format == DXGI_FORMAT_UNKNOWN)
+        {
+            return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+        }
+    }
+
+    // Bound sizes (for security purposes we don't trust DDS file metadata larger than the D3D 11.x hardware requirements)
+    if ((mipCount > D3D11_REQ_MIP_LEVELS) || (header->width > D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION) ||
+        (header->height > D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION))
+    {
+        return HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED);
+    }
+
+    size_t twidth = 0;
+    size_t theight = 0;
+    size_t tdepth = 0;
+    size_t skipMip = 0;
+    HRESULT hr = FillInitData(
+        header->width,
+        header->height,
+        1,
+        mipCount,
+        1,
+        format,
+        0,
+        ddsDataSize - offset,
+        ddsData + offset,
+        twidth,
+        theight,
+        tdepth,
+        skipMip,
+        layout->mips);
+    if (FAILED(hr))
+    {
+        return hr;
+    }
+
+    layout->format = forceSRGB ? MakeSRGB(format) : format;
+    layout->width = header->width;
+    layout->height = header->height;
+    layout->mipCount = static_cast<UINT>(mipCount);
+    layout->alphaMode = GetAlphaMode(header);
+
+    return S_OK;
+}
+
+//--------------------------------------------------------------------------------------
+// Texture cache
+//--------------------------------------------------------------------------------------
+namespace
+{
+    // The cached textures are all created with the default parameters of CreateDDSTextureFromFile.
+    struct CachedTextureKey
+    {
+        ID3D11Device* device;
+        std::wstring fileName;
+
+        bool operator<(const CachedTextureKey& other) const
+        {
+            return std::tie(device, fileName) < std::tie(other.device, other.fileName);
+        }
+    };
+
+    struct CachedTexture
+    {
+        winrt::com_ptr<ID3D11Resource> texture;
+        winrt::com_ptr<ID3D11ShaderResourceView> textureView;
+        DDS_ALPHA_MODE alphaMode;
+
+        void CopyTo(ID3D11Resource** textureOut, ID3D11ShaderResourceView** textureViewOut, DDS_ALPHA_MODE* alphaModeOut) const
+        {
+            if (textureOut)
+            {
+                texture.copy_to(textureOut);
+            }
+            if (textureViewOut)
+            {
+                textureView.copy_to(textureViewOut);
+            }
+            if (alphaModeOut)
+            {
+                *alphaModeOut = alphaMode;
+            }
+        }
+    };
+
+    // Holds a reference to every cached texture. An entry whose texture and view are not referenced by anybody else is unused,
+    // and nobody but the cache can take a new reference to it, so dropping it under the lock is safe.
+    class TextureCache
+    {
+    public:
+        static TextureCache& Get()
+        {
+            static TextureCache cache;
+            return cache;
+        }
+
+        bool Find(const CachedTextureKey& key, CachedTexture& texture)
+        {
+            std::lock_guard lock(m_mutex);
+            ReleaseUnusedLocked();
+
+            auto it = m_textures.find(key);
+            if (it == m_textures.end())
+            {
+                return false;
+            }
+
+            texture = it->second;
+            return true;
+        }
+
+        // Returns the cached texture, which is the one added before if another caller loaded the same texture meanwhile.
+        CachedTexture Add(CachedTextureKey key, CachedTexture texture)
+        {
+            std::lock_guard lock(m_mutex);
+            ReleaseUnusedLocked();
+            return m_textures.try_emplace(std::move(key), std::move(texture)).first->second;
+        }
+
+        void ReleaseUnused()
+        {
+            std::lock_guard lock(m_mutex);
+            ReleaseUnusedLocked();
+        }
+
+    private:
+        static ULONG GetReferenceCount(IUnknown* object)
+        {
+            object->AddRef();
+            return object->Release();
+        }
+
+        static bool IsUnused(const CachedTexture& entry)
+        {
+            // The view holds a reference to the texture, in addition to the one of the cache.
+            const ULONG cacheReferences = entry.textureView ? 2 : 1;
+            return GetReferenceCount(entry.texture.get()) == cacheReferences &&
+                   (!entry.textureView || GetReferenceCount(entry.textureView.get()) == 1);
+        }
+
+        void ReleaseUnusedLocked()
+        {
+            for (auto it = m_textures.begin(); it != m_textures.end();)
+            {
+                it = IsUnused(it->second) ? m_textures.erase(it) : std::next(it);
+            }
+        }
+
+        std::mutex m_mutex;
+        std::map<CachedTextureKey, CachedTexture> m_textures;
+    };
+} // namespace
+
+_Use_decl_annotations_ bool DirectX::FindCachedDDSTexture(
+    ID3D11Device* d3dDevice,
+    const wchar_t* fileName,
+    ID3D11Resource** texture,
+    ID3D11ShaderResourceView** textureView,
+    DDS_ALPHA_MODE* alphaMode)
+{
+    if (texture)
+    {
+        *texture = nullptr;
+    }
+    if (textureView)
+    {
+        *textureView = nullptr;
+    }
+
+    if (!d3dDevice || !fileName)
+    {
+        return false;
+    }
+
+    CachedTexture cached = {};
+    if (!TextureCache::Get().Find({d3dDevice, fileName}, cached))
+    {
+        return false;
+    }
+
+    cached.CopyTo(texture, textureView, alphaMode);
+    return true;
+}
+
+_Use_decl_annotations_ void DirectX::AddCachedDDSTexture(
+    ID3D11Device* d3dDevice,
+    const wchar_t* fileName,
+    ID3D11Resource* texture,
+    ID3D11ShaderResourceView* textureView,
+    DDS_ALPHA_MODE alphaMode)
+{
+    if (!d3dDevice || !fileName || !texture)
+    {
+        return;
+    }
+
+    CachedTexture cached = {};
+    cached.texture.copy_from(texture);
+    cached.textureView.copy_from(textureView);
+    cached.alphaMode = alphaMode;
+    TextureCache::Get().Add({d3dDevice, fileName}, std::move(cached));
+}
+
+void DirectX::ReleaseUnusedDDSTextures()
+{
+    TextureCache::Get().ReleaseUnused();
+}
+
+_Use_decl_annotations_ std::wstring DirectX::GetPreferredDDSFileName(ID3D11Device* d3dDevice, const wchar_t* fileName)
+{
+    std::wstring name = fileName ? fileName : L"";
+
+    // Feature level 11 supports all block compressed formats, including BC6H and BC7.
+    constexpr std::wstring_view extension = L".dds";
+    if (!d3dDevice || d3dDevice->GetFeatureLevel() < D3D_FEATURE_LEVEL_11_0 || name.size() < extension.size() ||
+        _wcsicmp(name.c_str() + name.size() - extension.size(), extension.data()) != 0)
+    {
+        return name;
+    }
+
+    std::wstring compressedName = name.substr(0, name.size() - extension.size()) + L".bc.dds";
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (GetFileAttributesExW(compressedName.c_str(), GetFileExInfoStandard, &attributes) &&
+        !(attributes.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+    {
+        return compressedName;
+    }
+
+    return name;
+}
@@ -36,6 +36,8 @@
 #include <stdint.h>
 #pragma warning(pop)
 
+#include <string>
+
 #if defined(_MSC_VER) && (_MSC_VER < 1610) && !defined(_In_reads_)
 #    define _In_reads_(exp)
 #    define _Out_writes_(exp)
@@ -154,4 +156,48 @@ namespace DirectX
         _Outptr_opt_ ID3D11Resource** texture,
         _Outptr_opt_ ID3D11ShaderResourceView** textureView,
         _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr);
+    // Layout of a DDS file holding a single 2D texture, which lets callers create the texture and upload its mip levels
+    // themselves, e.g. spread over several frames. The mip level data points into the DDS data passed in.
+    struct DDSTexture2DLayout
+    {
+        DXGI_FORMAT format;
+        UINT width;
+        UINT height;
+        UINT mipCount;
+        D3D11_SUBRESOURCE_DATA mips[D3D11_REQ_MIP_LEVELS];
+        DDS_ALPHA_MODE alphaMode;
+    };
+
+    // Fails with HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED) for 1D, 3D, cube map and array textures.
+    HRESULT GetDDSTexture2DLayout(
+        _In_reads_bytes_(ddsDataSize) const uint8_t* ddsData,
+        _In_ size_t ddsDataSize,
+        _In_ bool forceSRGB,
+        _Out_ DDSTexture2DLayout* layout);
+
+    // Look up and add cache entries of textures created with the default parameters of CreateDDSTextureFromFile, for loaders
+    // which create the textures themselves, like DDSTextureStreamer. The textures are cached process-wide, keyed by the device
+    // and the file name, so every loader of the same file shares one texture. The cache does not keep the textures alive:
+    // entries which are only referenced by the cache any more are dropped by the next call into the cache.
+    // FindCachedDDSTexture returns false if the file is not cached.
+    bool FindCachedDDSTexture(
+        _In_ ID3D11Device* d3dDevice,
+        _In_z_ const wchar_t* szFileName,
+        _Outptr_opt_ ID3D11Resource** texture,
+        _Outptr_opt_ ID3D11ShaderResourceView** textureView,
+        _Out_opt_ DDS_ALPHA_MODE* alphaMode = nullptr);
+
+    void AddCachedDDSTexture(
+        _In_ ID3D11Device* d3dDevice,
+        _In_z_ const wchar_t* szFileName,
+        _In_ ID3D11Resource* texture,
+        _In_opt_ ID3D11ShaderResourceView* textureView,
+        _In_ DDS_ALPHA_MODE alphaMode);
+
+    // Drops the cache entries which are only referenced by the cache, e.g. before the device is recreated.
+    void ReleaseUnusedDDSTextures();
+
+    // Returns the name of the block compressed version of a DDS file if it exists and the device supports all block compressed
+    // formats, otherwise the file name itself. The block compressed version has the extension .bc.dds instead of .dds.
+    std::wstring GetPreferredDDSFileName(_In_ ID3D11Device* d3dDevice, _In_z_ const wchar_t* szFileName);
 } // namespace DirectX
@@ -0,0 +1,200 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+#include "DDSTextureStreamer.h"
+
+#include "..\Common\MemoryAccounting.h"
+
+#include <algorithm>
+#include <utility>
+
+DDSTextureStreamer::DDSTextureStreamer(ID3D11Device* device, std::wstring fileName, size_t uploadBudgetPerFrame)
+    : m_fileName(std::move(fileName))
+    , m_uploadBudgetPerFrame(uploadBudgetPerFrame)
+{
+    m_device.copy_from(device);
+
+    if (DirectX::FindCachedDDSTexture(device, m_fileName.c_str(), m_texture.put(), m_shaderResourceView.put()) && m_shaderResourceView)
+    {
+        m_availableFromCache = true;
+        return;
+    }
+    m_texture = nullptr;
+
+    // The block compressed version of the file is read if there is one.
+    m_pendingFileData = std::async(std::launch::async, [device = m_device, fileName = m_fileName]() {
+        return ReadFileData(DirectX::GetPreferredDDSFileName(device.get(), fileName.c_str()));
+    });
+}
+
+bool DDSTextureStreamer::Update(ID3D11DeviceContext* context)
+{
+    if (m_failed || IsComplete())
+    {
+        return std::exchange(m_availableFromCache, false);
+    }
+
+    try
+    {
+        if (!m_texture)
+        {
+            if (m_pendingFileData.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                return false;
+            }
+
+            m_fileData = m_pendingFileData.get();
+            CreateTexture(context);
+
+            if (IsComplete())
+            {
+                // The texture could not be streamed and was created in one go.
+                return true;
+            }
+        }
+
+        return UploadMips(context);
+    }
+    catch (const winrt::hresult_error& err)
+    {
+        m_failed = true;
+        m_texture = nullptr;
+        m_shaderResourceView = nullptr;
+        m_fileData = {};
+
+        std::wstring message = L"Failed to load " + m_fileName + L": " + err.message().c_str() + L"\n";
+        OutputDebugStringW(message.c_str());
+        return false;
+    }
+}
+
+std::vector<uint8_t> DDSTextureStreamer::ReadFileData(const std::wstring& fileName)
+{
+    winrt::file_handle file(CreateFile2(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, nullptr));
+    if (!file)
+    {
+        winrt::throw_last_error();
+    }
+
+    FILE_STANDARD_INFO fileInfo;
+    winrt::check_bool(GetFileInformationByHandleEx(file.get(), FileStandardInfo, &fileInfo, sizeof(fileInfo)));
+
+    // DDS files larger than 4 GB are not supported, just like with DirectX::CreateDDSTextureFromFile.
+    if (fileInfo.EndOfFile.HighPart > 0)
+    {
+        winrt::throw_hresult(E_FAIL);
+    }
+
+    std::vector<uint8_t> data(fileInfo.EndOfFile.LowPart);
+
+    DWORD bytesRead = 0;
+    winrt::check_bool(ReadFile(file.get(), data.data(), static_cast<DWORD>(data.size()), &bytesRead, nullptr));
+    if (bytesRead < data.size())
+    {
+        winrt::throw_hresult(E_FAIL);
+    }
+
+    return data;
+}
+
+void DDSTextureStreamer::CreateTexture(ID3D11DeviceContext* context)
+{
+    const HRESULT hr = DirectX::GetDDSTexture2DLayout(m_fileData.data(), m_fileData.size(), false, &m_layout);
+    if (hr == HRESULT_FROM_WIN32(ERROR_NOT_SUPPORTED))
+    {
+        // Texture types other than plain 2D textures and formats which have to be converted are left to the regular loader.
+        winrt::check_hresult(DirectX::CreateDDSTextureFromMemory(
+            m_device.get(), m_fileData.data(), m_fileData.size(), m_texture.put(), m_shaderResourceView.put(), 0, &m_layout.alphaMode));
+
+        m_pendingMips = 0;
+        m_fileData = {};
+        DirectX::AddCachedDDSTexture(m_device.get(), m_fileName.c_str(), m_texture.get(), m_shaderResourceView.get(), m_layout.alphaMode);
+        return;
+    }
+    winrt::check_hresult(hr);
+
+    // The texture starts out without any content. Restrict sampling to the smallest mip level until it was uploaded.
+    const CD3D11_TEXTURE2D_DESC textureDesc(
+        m_layout.format, m_layout.width, m_layout.height, 1, m_layout.mipCount, D3D11_BIND_SHADER_RESOURCE, D3D11_USAGE_DEFAULT);
+
+    winrt::com_ptr<ID3D11Texture2D> texture;
+    winrt::check_hresult(m_device->CreateTexture2D(&textureDesc, nullptr, texture.put()));
+    MemoryAccounting::TrackGpuResource(MemoryAccounting::Tag::Textures, texture.get());
+    m_texture = texture.as<ID3D11Resource>();
+
+    context->SetResourceMinLOD(m_texture.get(), static_cast<FLOAT>(m_layout.mipCount - 1));
+
+    m_pendingMips = m_layout.mipCount;
+    m_nextRow = 0;
+}
+
+bool DDSTextureStreamer::UploadMips(ID3D11DeviceContext* context)
+{
+    bool becameAvailable = false;
+    size_t remainingBudget = m_uploadBudgetPerFrame;
+
+    while (m_pendingMips > 0)
+    {
+        const UINT mip = m_pendingMips - 1;
+        const D3D11_SUBRESOURCE_DATA& mipData = m_layout.mips[mip];
+
+        const UINT mipWidth = std::max(1u, m_layout.width >> mip);
+        const UINT mipHeight = std::max(1u, m_layout.height >> mip);
+        const UINT rowCount = mipData.SysMemSlicePitch / mipData.SysMemPitch;
+
+        // Block compressed formats have fewer rows than pixel rows, each of them covering 4 pixel rows.
+        const UINT rowHeight = rowCount < mipHeight ? 4 : 1;
+
+        UINT rows = static_cast<UINT>(std::min<size_t>(remainingBudget / mipData.SysMemPitch, rowCount - m_nextRow));
+        if (rows == 0)
+        {
+            if (remainingBudget != m_uploadBudgetPerFrame)
+            {
+                break;
+            }
+
+            // A single row exceeds the budget. Upload it anyway to keep making progress.
+            rows = 1;
+        }
+
+        const D3D11_BOX box = {0, m_nextRow * rowHeight, 0, mipWidth, std::min(mipHeight, (m_nextRow + rows) * rowHeight), 1};
+        const uint8_t* rowData = static_cast<const uint8_t*>(mipData.pSysMem) + static_cast<size_t>(m_nextRow) * mipData.SysMemPitch;
+        context->UpdateSubresource(m_texture.get(), mip, &box, rowData, mipData.SysMemPitch, 0);
+
+        remainingBudget -= std::min<size_t>(remainingBudget, static_cast<size_t>(rows) * mipData.SysMemPitch);
+        m_nextRow += rows;
+
+        if (m_nextRow == rowCount)
+        {
+            m_nextRow = 0;
+            --m_pendingMips;
+
+            context->SetResourceMinLOD(m_texture.get(), static_cast<FLOAT>(mip));
+
+            if (!m_shaderResourceView)
+            {
+                const CD3D11_SHADER_RESOURCE_VIEW_DESC viewDesc(D3D11_SRV_DIMENSION_TEXTURE2D, m_layout.format, 0, m_layout.mipCount);
+                winrt::check_hresult(m_device->CreateShaderResourceView(m_texture.get(), &viewDesc, m_shaderResourceView.put()));
+                becameAvailable = true;
+            }
+        }
+    }
+
+    if (m_pendingMips == 0)
+    {
+        m_fileData = {};
+        DirectX::AddCachedDDSTexture(m_device.get(), m_fileName.c_str(), m_texture.get(), m_shaderResourceView.get(), m_layout.alphaMode);
+    }
+
+    return becameAvailable;
+}
@@ -0,0 +1,76 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include "DDSTextureLoader.h"
+
+#include <future>
+#include <string>
+#include <vector>
+
+// Loads a DDS texture without blocking the render loop.
+// The file is read on a background thread. Afterwards the mip levels are uploaded from the smallest to the largest one,
+// spread over several frames so that at most a fixed number of bytes is uploaded per frame. The texture can be used as soon
+// as the smallest mip level is available; sampling is restricted to the mip levels which were uploaded completely.
+// Completely uploaded textures are shared through the texture cache of the DDS loader, a texture which is cached already is
+// available with the first update.
+class DDSTextureStreamer
+{
+public:
+    static constexpr size_t DefaultUploadBudgetPerFrame = 256 * 1024;
+
+    DDSTextureStreamer(ID3D11Device* device, std::wstring fileName, size_t uploadBudgetPerFrame = DefaultUploadBudgetPerFrame);
+
+    // Continues loading the texture. Must be called once per frame with exclusive access to the immediate context.
+    // Returns true in the frame the shader resource view became available.
+    bool Update(ID3D11DeviceContext* context);
+
+    // Returns nullptr until the smallest mip level was uploaded.
+    const winrt::com_ptr<ID3D11ShaderResourceView>& GetShaderResourceView() const
+    {
+        return m_shaderResourceView;
+    }
+
+    bool IsComplete() const
+    {
+        return m_texture && m_pendingMips == 0;
+    }
+
+private:
+    static std::vector<uint8_t> ReadFileData(const std::wstring& fileName);
+
+    void CreateTexture(ID3D11DeviceContext* context);
+    bool UploadMips(ID3D11DeviceContext* context);
+
+    const std::wstring m_fileName;
+    const size_t m_uploadBudgetPerFrame;
+
+    winrt::com_ptr<ID3D11Device> m_device;
+    winrt::com_ptr<ID3D11Resource> m_texture;
+    winrt::com_ptr<ID3D11ShaderResourceView> m_shaderResourceView;
+
+    std::future<std::vector<uint8_t>> m_pendingFileData;
+
+    // The mip level data in m_layout points into m_fileData, which is released once all mip levels were uploaded.
+    std::vector<uint8_t> m_fileData;
+    DirectX::DDSTexture2DLayout m_layout = {};
+
+    // Mip levels [0, m_pendingMips) still have to be uploaded; m_nextRow is the next row of mip level m_pendingMips - 1.
+    // For block compressed formats a row is one row of blocks.
+    UINT m_pendingMips = 0;
+    UINT m_nextRow = 0;
+
+    bool m_failed = false;
+
+    // Set if the texture was taken from the cache, until the first update reported it as available.
+    bool m_availableFromCache = false;
+};
@@ -15,6 +15,8 @@
 
 #include "StatusDisplay.h"
 
+#include <algorithm>
+
 using namespace winrt::Microsoft::Holographic::AppRemoting;
 
 ErrorHelper::ErrorHelper()
@@ -30,10 +32,20 @@ void ErrorHelper::Apply(std::unique_ptr<StatusDisplay>& statusDisplay)
     }
 }
 
-void ErrorHelper::AddError(const std::wstring& message, float timeToShowInSeconds)
+bool ErrorHelper::AddError(const std::wstring& message, float timeToShowInSeconds)
 {
     std::scoped_lock lock(m_lineMutex);
+    for (auto& line : m_lines)
+    {
+        if (line.text == message)
+        {
+            line.timeUntilRemovalInSeconds = std::max(line.timeUntilRemovalInSeconds, timeToShowInSeconds);
+            return false;
+        }
+    }
+
     m_lines.push_back(ErrorLine{message, timeToShowInSeconds});
+    return true;
 }
 
 void ErrorHelper::ClearErrors()
@@ -31,8 +31,9 @@ public:
 
     void Apply(std::unique_ptr<StatusDisplay>& statusDisplay);
 
-    // Adds an error message to the error display
-    void AddError(const std::wstring& message, float timeToShowInSeconds = 10.0f);
+    // Adds an error message to the error display. An error which is already displayed is kept for the new time instead, so
+    // bursts of the same error neither add lines nor change the display. Returns whether a line was added.
+    bool AddError(const std::wstring& message, float timeToShowInSeconds = 10.0f);
     void ClearErrors();
 
     bool ProcessOnDisconnect(const winrt::Microsoft::Holographic::AppRemoting::ConnectionFailureReason& reason);
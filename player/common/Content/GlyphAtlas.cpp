@@ -0,0 +1,189 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+#include "GlyphAtlas.h"
+
+#include "..\Common\MemoryAccounting.h"
+
+#include <cmath>
+
+namespace
+{
+    constexpr UINT AtlasWidth = 2048;
+
+    // Transparent padding around every glyph in percent of the font size, which covers overhanging glyph parts.
+    constexpr float GlyphPadding = 0.15f;
+
+    // Maximum layout extent used to measure a single glyph.
+    constexpr float MeasureExtent = 100000.0f;
+
+    // Edge length in pixels of the white cell in the top left corner of the atlas. Its center is not affected by filtering.
+    constexpr UINT SolidCellSize = 4;
+} // namespace
+
+void GlyphAtlas::CreateDeviceDependentResources(
+    ID3D11Device* device,
+    ID2D1Factory* d2dFactory,
+    IDWriteFactory* dwriteFactory,
+    winrt::array_view<const winrt::com_ptr<IDWriteTextFormat>> textFormats,
+    float dpiX,
+    float dpiY)
+{
+    ReleaseDeviceDependentResources();
+
+    const float dpiScaleX = dpiX / 96.0f;
+    const float dpiScaleY = dpiY / 96.0f;
+
+    struct PendingGlyph
+    {
+        winrt::com_ptr<IDWriteTextLayout> layout;
+        Glyph* glyph = nullptr;
+        float padding = 0.0f;
+        float height = 0.0f;
+        UINT x = 0;
+        UINT y = 0;
+    };
+    std::vector<PendingGlyph> pendingGlyphs;
+
+    // Measure all glyphs and pack them into rows of the atlas, which start with the white cell.
+    UINT penX = SolidCellSize + 1;
+    UINT penY = 0;
+    UINT rowHeight = SolidCellSize + 1;
+
+    m_textFormatGlyphs.resize(textFormats.size());
+    for (size_t textFormatIndex = 0; textFormatIndex < textFormats.size(); ++textFormatIndex)
+    {
+        IDWriteTextFormat* textFormat = textFormats[textFormatIndex].get();
+        TextFormatGlyphs& textFormatGlyphs = m_textFormatGlyphs[textFormatIndex];
+
+        const float padding = textFormat->GetFontSize() * GlyphPadding;
+
+        for (wchar_t character = FirstCharacter; character <= LastCharacter; ++character)
+        {
+            winrt::com_ptr<IDWriteTextLayout> layout;
+            winrt::check_hresult(dwriteFactory->CreateTextLayout(&character, 1, textFormat, MeasureExtent, MeasureExtent, layout.put()));
+            winrt::check_hresult(layout->SetTextAlignment(DWRITE_TEXT_ALIGNMENT_LEADING));
+            winrt::check_hresult(layout->SetWordWrapping(DWRITE_WORD_WRAPPING_NO_WRAP));
+
+            DWRITE_TEXT_METRICS metrics = {};
+            winrt::check_hresult(layout->GetMetrics(&metrics));
+
+            textFormatGlyphs.lineHeight = std::max<>(textFormatGlyphs.lineHeight, metrics.height);
+
+            Glyph& glyph = textFormatGlyphs.glyphs[character - FirstCharacter];
+            glyph.advance = metrics.widthIncludingTrailingWhitespace;
+            glyph.offsetX = -padding;
+            glyph.width = metrics.widthIncludingTrailingWhitespace + 2.0f * padding;
+
+            if (character == L' ')
+            {
+                continue;
+            }
+
+            // Keep one pixel between glyphs, so that filtering does not pick up parts of the neighbouring glyphs.
+            const UINT cellWidth = static_cast<UINT>(std::ceil(glyph.width * dpiScaleX)) + 1;
+            const UINT cellHeight = static_cast<UINT>(std::ceil(metrics.height * dpiScaleY)) + 1;
+
+            if (penX + cellWidth > AtlasWidth)
+            {
+                penX = 0;
+                penY += rowHeight;
+                rowHeight = 0;
+            }
+
+            if (cellWidth > AtlasWidth || penY + cellHeight > D3D11_REQ_TEXTURE2D_U_OR_V_DIMENSION)
+            {
+                // The glyph does not fit into the atlas and stays invisible.
+                continue;
+            }
+
+            pendingGlyphs.push_back(PendingGlyph{std::move(layout), &glyph, padding, metrics.height, penX, penY});
+
+            penX += cellWidth;
+            rowHeight = std::max<>(rowHeight, cellHeight);
+        }
+    }
+
+    const UINT atlasHeight = std::max<>(penY + rowHeight, 1u);
+
+    CD3D11_TEXTURE2D_DESC textureDesc(
+        DXGI_FORMAT_B8G8R8A8_UNORM, AtlasWidth, atlasHeight, 1, 1, D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET);
+    winrt::check_hresult(device->CreateTexture2D(&textureDesc, nullptr, m_texture.put()));
+    MemoryAccounting::TrackGpuResource(MemoryAccounting::Tag::StatusDisplay, m_texture.get());
+    winrt::check_hresult(device->CreateShaderResourceView(m_texture.get(), nullptr, m_shaderResourceView.put()));
+
+    // Render all glyphs into the atlas. This is the only time Direct2D touches the text resources.
+    D2D1_RENDER_TARGET_PROPERTIES props = D2D1::RenderTargetProperties(
+        D2D1_RENDER_TARGET_TYPE_DEFAULT, D2D1::PixelFormat(DXGI_FORMAT_UNKNOWN, D2D1_ALPHA_MODE_PREMULTIPLIED), dpiX, dpiY);
+
+    winrt::com_ptr<IDXGISurface> dxgiSurface;
+    m_texture.as(dxgiSurface);
+
+    winrt::com_ptr<ID2D1RenderTarget> d2dRenderTarget;
+    winrt::check_hresult(d2dFactory->CreateDxgiSurfaceRenderTarget(dxgiSurface.get(), &props, d2dRenderTarget.put()));
+    d2dRenderTarget->SetTextAntialiasMode(D2D1_TEXT_ANTIALIAS_MODE_GRAYSCALE);
+
+    // The glyphs are rendered white. The color of a line is applied when drawing the glyph quads.
+    winrt::com_ptr<ID2D1SolidColorBrush> brush;
+    winrt::check_hresult(d2dRenderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::White), brush.put()));
+
+    d2dRenderTarget->BeginDraw();
+    d2dRenderTarget->Clear(D2D1::ColorF(0, 0.0f));
+
+    d2dRenderTarget->FillRectangle(D2D1::RectF(0.0f, 0.0f, SolidCellSize / dpiScaleX, SolidCellSize / dpiScaleY), brush.get());
+    m_solidUv = {0.5f * SolidCellSize / static_cast<float>(AtlasWidth), 0.5f * SolidCellSize / static_cast<float>(atlasHeight)};
+
+    for (PendingGlyph& pendingGlyph : pendingGlyphs)
+    {
+        const float left = pendingGlyph.x / dpiScaleX;
+        const float top = pendingGlyph.y / dpiScaleY;
+        d2dRenderTarget->DrawTextLayout(D2D1::Point2F(left + pendingGlyph.padding, top), pendingGlyph.layout.get(), brush.get());
+
+        Glyph& glyph = *pendingGlyph.glyph;
+        glyph.visible = true;
+        glyph.uvTopLeft = {pendingGlyph.x / static_cast<float>(AtlasWidth), pendingGlyph.y / static_cast<float>(atlasHeight)};
+        glyph.uvBottomRight = {
+            (left + glyph.width) * dpiScaleX / static_cast<float>(AtlasWidth),
+            (top + pendingGlyph.height) * dpiScaleY / static_cast<float>(atlasHeight)};
+    }
+
+    // Ignore D2DERR_RECREATE_TARGET here. This error indicates that the device
+    // is lost. It will be handled during the next call to Present.
+    const HRESULT hr = d2dRenderTarget->EndDraw();
+    if (hr != D2DERR_RECREATE_TARGET)
+    {
+        winrt::check_hresult(hr);
+    }
+}
+
+void GlyphAtlas::ReleaseDeviceDependentResources()
+{
+    m_textFormatGlyphs.clear();
+    m_shaderResourceView = nullptr;
+    m_texture = nullptr;
+}
+
+const GlyphAtlas::Glyph& GlyphAtlas::GetGlyph(size_t textFormat, wchar_t character) const
+{
+    if (character < FirstCharacter || character > LastCharacter)
+    {
+        character = FallbackCharacter;
+    }
+
+    return m_textFormatGlyphs[textFormat].glyphs[character - FirstCharacter];
+}
+
+float GlyphAtlas::GetLineHeight(size_t textFormat) const
+{
+    return m_textFormatGlyphs[textFormat].lineHeight;
+}
@@ -0,0 +1,75 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <array>
+#include <vector>
+
+// Texture atlas containing the printable ASCII glyphs of a set of text formats.
+// The glyphs are rendered once using Direct2D, afterwards text is drawn as textured quads referencing the atlas.
+class GlyphAtlas
+{
+public:
+    static constexpr wchar_t FirstCharacter = L' ';
+    static constexpr wchar_t LastCharacter = L'~';
+
+    // Characters outside of the atlas are drawn using this character.
+    static constexpr wchar_t FallbackCharacter = L'?';
+
+    // All extents are in DIPs of the DPI the atlas was created with.
+    struct Glyph
+    {
+        bool visible = false;
+        float advance = 0.0f;
+        // Offset of the glyph quad relative to the pen position and its width. The quad is always one line high.
+        float offsetX = 0.0f;
+        float width = 0.0f;
+        DirectX::XMFLOAT2 uvTopLeft = {};
+        DirectX::XMFLOAT2 uvBottomRight = {};
+    };
+
+    void CreateDeviceDependentResources(
+        ID3D11Device* device,
+        ID2D1Factory* d2dFactory,
+        IDWriteFactory* dwriteFactory,
+        winrt::array_view<const winrt::com_ptr<IDWriteTextFormat>> textFormats,
+        float dpiX,
+        float dpiY);
+    void ReleaseDeviceDependentResources();
+
+    const Glyph& GetGlyph(size_t textFormat, wchar_t character) const;
+    float GetLineHeight(size_t textFormat) const;
+
+    ID3D11ShaderResourceView* GetShaderResourceView() const
+    {
+        return m_shaderResourceView.get();
+    }
+
+    // Texture coordinate of a white texel. Quads using it for all their vertices are drawn in a solid color, together with the text.
+    DirectX::XMFLOAT2 GetSolidUv() const
+    {
+        return m_solidUv;
+    }
+
+private:
+    struct TextFormatGlyphs
+    {
+        float lineHeight = 0.0f;
+        std::array<Glyph, LastCharacter - FirstCharacter + 1> glyphs = {};
+    };
+
+    std::vector<TextFormatGlyphs> m_textFormatGlyphs;
+    DirectX::XMFLOAT2 m_solidUv = {};
+
+    winrt::com_ptr<ID3D11Texture2D> m_texture;
+    winrt::com_ptr<ID3D11ShaderResourceView> m_shaderResourceView;
+};
@@ -11,10 +11,10 @@
 
 #pragma once
 
-// Constant buffer used to send hologram position transform to the shader pipeline.
+// Constant buffer used to send the hologram position transforms of the image and the text to the shader pipeline.
 struct ModelConstantBuffer
 {
-    DirectX::XMFLOAT4X4 model;
+    DirectX::XMFLOAT4X4 model[2];
 };
 
 // Assert that the constant buffer remains multiple of 16-bytes (best practice).
@@ -27,4 +27,8 @@ struct VertexBufferElement
 {
     DirectX::XMFLOAT3 pos;
     DirectX::XMFLOAT2 uv;
+    // The sampled texture is multiplied with this color.
+    DirectX::XMFLOAT4 color;
+    // 0 for the image, 1 for the text. Selects the model transform and the texture.
+    uint32_t layer;
 };
@@ -18,15 +18,28 @@
 #include <shaders\VPRTVertexShader.h>
 #include <shaders\VertexShader.h>
 
+#include <algorithm>
+
 constexpr const wchar_t Font[] = L"Segoe UI";
 // Font size in percent.
 constexpr float FontSizeLarge = 0.045f;
 constexpr float FontSizeMedium = 0.035f;
 constexpr float FontSizeSmall = 0.03f;
+// Height of the graph and the space between the graph and the lines below it, in percent of the width like the font sizes.
+constexpr float GraphHeight = 0.12f;
+constexpr float GraphSpacing = 0.02f;
 constexpr const wchar_t FontLanguage[] = L"en-US";
 constexpr const float Degree2Rad = 3.14159265359f / 180.0f;
 constexpr const float Meter2Inch = 39.37f;
 
+// The glyph atlas is rendered in white, the pixel shader multiplies it with the color of the line.
+constexpr DirectX::XMFLOAT4 TextColors[] = {
+    {1.0f, 0.98f, 0.94f, 1.0f}, // FloralWhite
+    {1.0f, 1.0f, 0.0f, 1.0f},   // Yellow
+    {1.0f, 0.0f, 0.0f, 1.0f},   // Red
+};
+constexpr DirectX::XMFLOAT4 ImageColor = {1.0f, 1.0f, 1.0f, 1.0f};
+
 using namespace DirectX;
 using namespace Concurrency;
 using namespace winrt::Windows::Foundation::Numerics;
@@ -75,9 +88,18 @@ StatusDisplay::StatusDisplay(const std::shared_ptr<DXHelper::DeviceResourcesComm
 // relative to the position transform indicated by hologramPositionTransform.
 void StatusDisplay::Update(float deltaTimeInSeconds)
 {
+    if (!HasContent())
+    {
+        m_positionSnapPending = true;
+        return;
+    }
+
     UpdateConstantBuffer(
-        deltaTimeInSeconds, m_modelConstantBufferDataImage, m_isOpaque ? m_positionContent : m_positionOffset, m_normalContent);
-    UpdateConstantBuffer(deltaTimeInSeconds, m_modelConstantBufferDataText, m_positionContent, m_normalContent);
+        deltaTimeInSeconds,
+        m_modelConstantBufferData.model[ImageLayer],
+        m_isOpaque ? m_positionContent : m_positionOffset,
+        m_normalContent);
+    UpdateConstantBuffer(deltaTimeInSeconds, m_modelConstantBufferData.model[TextLayer], m_positionContent, m_normalContent);
 }
 
 // Renders a frame to the screen.
@@ -89,7 +111,8 @@ void StatusDisplay::Render()
         return;
     }
 
-    // First render all text using direct2D.
+    // First update the glyph quads of all lines which have changed.
+    UINT glyphCount = 0;
     {
         std::scoped_lock lock(m_lineMutex);
         if (m_lines.size() > 0 && m_lines != m_previousLines)
@@ -97,153 +120,116 @@ void StatusDisplay::Render()
             m_previousLines.resize(m_lines.size());
             m_runtimeLines.resize(m_lines.size());
 
-            for (int i = 0; i < m_lines.size(); ++i)
+            size_t firstChangedLine = m_lines.size();
+            for (size_t i = 0; i < m_lines.size(); ++i)
             {
                 if (m_lines[i] != m_previousLines[i])
                 {
                     UpdateLineInternal(m_runtimeLines[i], m_lines[i]);
                     m_previousLines[i] = m_lines[i];
+                    firstChangedLine = std::min(firstChangedLine, i);
                 }
             }
 
-            m_deviceResources->UseD3DDeviceContext(
-                [&](auto context) { context->ClearRenderTargetView(m_textRenderTarget.get(), DirectX::Colors::Transparent); });
-
-            m_d2dTextRenderTarget->BeginDraw();
-
-            const float virtualDisplayDPIy = m_textTextureHeight / m_virtualDisplaySizeInchY;
-            const float dpiScaleY = virtualDisplayDPIy / 96.0f;
-
-            float top = 0.0f;
-            for (auto& line : m_runtimeLines)
-            {
-                if (line.alignBottom)
-                {
-                    top = m_textTextureHeight - (line.metrics.height * line.lineHeightMultiplier * dpiScaleY);
-                }
+            UpdateTextMesh(firstChangedLine);
+        }
 
-                m_d2dTextRenderTarget->DrawTextLayout(D2D1::Point2F(0, top), line.layout.get(), m_brushes[line.color].get());
-                top += line.metrics.height * line.lineHeightMultiplier;
-            }
+        if (!m_lines.empty())
+        {
+            glyphCount = m_textGlyphCount;
+        }
 
-            // Ignore D2DERR_RECREATE_TARGET here. This error indicates that the device
-            // is lost. It will be handled during the next call to Present.
-            const HRESULT hr = m_d2dTextRenderTarget->EndDraw();
-            if (hr != D2DERR_RECREATE_TARGET)
-            {
-                winrt::check_hresult(hr);
-            }
+        if (m_graphVerticesChanged)
+        {
+            UpdateGraphMesh();
         }
     }
 
-    // Now render the quads into 3d space
-    if (m_imageEnabled && m_imageView || !m_lines.empty())
+    // The image quad is drawn together with the glyph quads, so both are drawn with one draw call or the image quad is skipped.
+    const bool drawImage = m_imageEnabled && m_imageView;
+    const UINT firstQuad = drawImage ? ImageQuad : FirstGlyphQuad;
+    const UINT quadCount = FirstGlyphQuad + glyphCount - firstQuad;
+    if (quadCount == 0 && m_graphQuadCount == 0)
     {
-        m_deviceResources->UseD3DDeviceContext([&](auto context) {
-            DXHelper::D3D11StoreAndRestoreState(context, [&]() {
-                // Each vertex is one instance of the VertexBufferElement struct.
-                const UINT stride = sizeof(VertexBufferElement);
-                const UINT offset = 0;
-                ID3D11Buffer* pBufferToSet = m_vertexBufferImage.get();
-                context->IASetVertexBuffers(0, 1, &pBufferToSet, &stride, &offset);
-                context->IASetIndexBuffer(m_indexBuffer.get(), DXGI_FORMAT_R16_UINT, 0);
+        return;
+    }
 
-                context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-                context->IASetInputLayout(m_inputLayout.get());
-                context->OMSetBlendState(m_textAlphaBlendState.get(), nullptr, 0xffffffff);
-                context->OMSetDepthStencilState(m_depthStencilState.get(), 0);
+    // Now render the quads into 3d space
+    m_deviceResources->UseD3DDeviceContext([&](auto context) {
+        if (m_imageVerticesChanged)
+        {
+            constexpr UINT quadSize = static_cast<UINT>(4 * sizeof(VertexBufferElement));
+            const D3D11_BOX box = {ImageQuad * quadSize, 0, 0, (ImageQuad + 1) * quadSize, 1, 1};
+            context->UpdateSubresource(m_quadVertexBuffer.get(), 0, &box, m_imageVertices, 0, 0);
+            m_imageVerticesChanged = false;
+        }
 
-                context->UpdateSubresource(m_modelConstantBuffer.get(), 0, nullptr, &m_modelConstantBufferDataImage, 0, 0);
+        DXHelper::D3D11StoreAndRestoreState(context, [&]() {
+            // Each vertex is one instance of the VertexBufferElement struct.
+            const UINT stride = sizeof(VertexBufferElement);
+            const UINT offset = 0;
+            ID3D11Buffer* pBufferToSet = m_quadVertexBuffer.get();
+            context->IASetVertexBuffers(0, 1, &pBufferToSet, &stride, &offset);
+            context->IASetIndexBuffer(m_quadIndexBuffer.get(), DXGI_FORMAT_R16_UINT, 0);
 
-                // Apply the model constant buffer to the vertex shader.
-                pBufferToSet = m_modelConstantBuffer.get();
-                context->VSSetConstantBuffers(0, 1, &pBufferToSet);
+            context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            context->IASetInputLayout(m_inputLayout.get());
+            context->OMSetBlendState(m_textAlphaBlendState.get(), nullptr, 0xffffffff);
+            context->OMSetDepthStencilState(m_depthStencilState.get(), 0);
 
-                // Attach the vertex shader.
-                context->VSSetShader(m_vertexShader.get(), nullptr, 0);
+            // The model transforms of the image and the text are updated together.
+            context->UpdateSubresource(m_modelConstantBuffer.get(), 0, nullptr, &m_modelConstantBufferData, 0, 0);
 
-                // On devices that do not support the D3D11_FEATURE_D3D11_OPTIONS3::
-                // VPAndRTArrayIndexFromAnyShaderFeedingRasterizer optional feature,
-                // a pass-through geometry shader sets the render target ID.
-                context->GSSetShader(!m_usingVprtShaders ? m_geometryShader.get() : nullptr, nullptr, 0);
+            // Apply the model constant buffer to the vertex shader.
+            pBufferToSet = m_modelConstantBuffer.get();
+            context->VSSetConstantBuffers(0, 1, &pBufferToSet);
 
-                // Attach the pixel shader.
-                context->PSSetShader(m_pixelShader.get(), nullptr, 0);
+            // Attach the vertex shader.
+            context->VSSetShader(m_vertexShader.get(), nullptr, 0);
 
-                // Draw the image.
-                if (m_imageEnabled && m_imageView)
-                {
-                    ID3D11ShaderResourceView* pShaderViewToSet = m_imageView.get();
-                    context->PSSetShaderResources(0, 1, &pShaderViewToSet);
-
-                    ID3D11SamplerState* pSamplerToSet = m_imageSamplerState.get();
-                    context->PSSetSamplers(0, 1, &pSamplerToSet);
-
-                    context->DrawIndexedInstanced(
-                        m_indexCount, // Index count per instance.
-                        2,            // Instance count.
-                        0,            // Start index location.
-                        0,            // Base vertex location.
-                        0             // Start instance location.
-                    );
-                }
+            // On devices that do not support the D3D11_FEATURE_D3D11_OPTIONS3::
+            // VPAndRTArrayIndexFromAnyShaderFeedingRasterizer optional feature,
+            // a pass-through geometry shader sets the render target ID.
+            context->GSSetShader(!m_usingVprtShaders ? m_geometryShader.get() : nullptr, nullptr, 0);
 
-                // Draw the text.
-                if (!m_lines.empty())
-                {
-                    // Set up for rendering the texture that contains the text
-                    pBufferToSet = m_vertexBufferText.get();
-                    context->IASetVertexBuffers(0, 1, &pBufferToSet, &stride, &offset);
+            // Attach the pixel shader, which samples the image or the glyph atlas depending on the layer of the quad.
+            context->PSSetShader(m_pixelShader.get(), nullptr, 0);
 
-                    ID3D11ShaderResourceView* pShaderViewToSet = m_textShaderResourceView.get();
-                    context->PSSetShaderResources(0, 1, &pShaderViewToSet);
+            ID3D11ShaderResourceView* const shaderViewsToSet[] = {m_imageView.get(), m_glyphAtlas.GetShaderResourceView()};
+            context->PSSetShaderResources(0, ARRAYSIZE(shaderViewsToSet), shaderViewsToSet);
 
-                    ID3D11SamplerState* pSamplerToSet = m_textSamplerState.get();
-                    context->PSSetSamplers(0, 1, &pSamplerToSet);
+            ID3D11SamplerState* const samplersToSet[] = {m_imageSamplerState.get(), m_textSamplerState.get()};
+            context->PSSetSamplers(0, ARRAYSIZE(samplersToSet), samplersToSet);
 
-                    context->UpdateSubresource(m_modelConstantBuffer.get(), 0, nullptr, &m_modelConstantBufferDataText, 0, 0);
+            // Draw the image and the text for both views.
+            if (quadCount > 0)
+            {
+                context->DrawIndexedInstanced(
+                    quadCount * 6, // Index count per instance.
+                    2,             // Instance count.
+                    firstQuad * 6, // Start index location.
+                    0,             // Base vertex location.
+                    0              // Start instance location.
+                );
+            }
 
-                    context->DrawIndexedInstanced(
-                        m_indexCount, // Index count per instance.
-                        2,            // Instance count.
-                        0,            // Start index location.
-                        0,            // Base vertex location.
-                        0             // Start instance location.
-                    );
-                }
-            });
+            // The graph only has vertices of its own, it is drawn with the index buffer, shaders and states of the text.
+            if (m_graphQuadCount > 0)
+            {
+                pBufferToSet = m_graphVertexBuffer.get();
+                context->IASetVertexBuffers(0, 1, &pBufferToSet, &stride, &offset);
+                context->DrawIndexedInstanced(m_graphQuadCount * 6, 2, 0, 0, 0);
+            }
         });
-    }
+    });
 }
 
 void StatusDisplay::CreateDeviceDependentResources()
 {
     auto device = m_deviceResources->GetD3DDevice();
 
-    CD3D11_TEXTURE2D_DESC textureDesc(
-        DXGI_FORMAT_B8G8R8A8_UNORM, m_textTextureWidth, m_textTextureHeight, 1, 1, D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET);
-
-    m_textTexture = nullptr;
-    device->CreateTexture2D(&textureDesc, nullptr, m_textTexture.put());
-
-    m_textShaderResourceView = nullptr;
-    device->CreateShaderResourceView(m_textTexture.get(), nullptr, m_textShaderResourceView.put());
-
-    m_textRenderTarget = nullptr;
-    device->CreateRenderTargetView(m_textTexture.get(), nullptr, m_textRenderTarget.put());
-
-    D2D1_RENDER_TARGET_PROPERTIES props = D2D1::RenderTargetProperties(
-        D2D1_RENDER_TARGET_TYPE_DEFAULT, D2D1::PixelFormat(DXGI_FORMAT_UNKNOWN, D2D1_ALPHA_MODE_PREMULTIPLIED), 96, 96);
-
-    winrt::com_ptr<IDXGISurface> dxgiSurface;
-    m_textTexture.as(dxgiSurface);
-
-    m_d2dTextRenderTarget = nullptr;
-    winrt::check_hresult(
-        m_deviceResources->GetD2DFactory()->CreateDxgiSurfaceRenderTarget(dxgiSurface.get(), &props, m_d2dTextRenderTarget.put()));
-
     CreateFonts();
-    CreateBrushes();
+    CreateGlyphAtlas();
 
     m_usingVprtShaders = m_deviceResources->GetDeviceSupportsVprt();
 
@@ -259,6 +245,8 @@ void StatusDisplay::CreateDeviceDependentResources()
         static const D3D11_INPUT_ELEMENT_DESC vertexDesc[] = {
             {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
             {"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
+            {"COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 20, D3D11_INPUT_PER_VERTEX_DATA, 0},
+            {"LAYER", 0, DXGI_FORMAT_R32_UINT, 0, 36, D3D11_INPUT_PER_VERTEX_DATA, 0},
         };
 
         winrt::check_hresult(
@@ -270,7 +258,7 @@ void StatusDisplay::CreateDeviceDependentResources()
         winrt::check_hresult(device->CreatePixelShader(PixelShader, sizeof(PixelShader), nullptr, m_pixelShader.put()));
 
         const CD3D11_BUFFER_DESC constantBufferDesc(sizeof(ModelConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
-        winrt::check_hresult(device->CreateBuffer(&constantBufferDesc, nullptr, m_modelConstantBuffer.put()));
+        m_deviceResources->CreateBuffer(MemoryAccounting::Tag::StatusDisplay, constantBufferDesc, nullptr, m_modelConstantBuffer.put());
     });
 
     task<void> createGSTask;
@@ -284,7 +272,7 @@ void StatusDisplay::CreateDeviceDependentResources()
 
     // Once all shaders are loaded, create the mesh.
     task<void> shaderTaskGroup = m_usingVprtShaders ? (createPSTask && createVSTask) : (createPSTask && createVSTask && createGSTask);
-    task<void> createQuadTask = shaderTaskGroup.then([this, device]() {
+    task<void> createQuadTask = shaderTaskGroup.then([this]() {
         // Load mesh indices. Each trio of indices represents
         // a triangle to be rendered on the screen.
         // For example: 2,1,0 means that the vertices with indexes
@@ -300,14 +288,32 @@ void StatusDisplay::CreateDeviceDependentResources()
             2,
         };
 
-        m_indexCount = ARRAYSIZE(quadIndices);
+        // The image and the text are drawn as one quad each for the image and every glyph, which all share the same index pattern.
+        std::vector<unsigned short> indices(MaxQuadCount * ARRAYSIZE(quadIndices));
+        for (UINT quad = 0; quad < MaxQuadCount; ++quad)
+        {
+            for (UINT i = 0; i < ARRAYSIZE(quadIndices); ++i)
+            {
+                indices[quad * ARRAYSIZE(quadIndices) + i] = static_cast<unsigned short>(quad * 4 + quadIndices[i]);
+            }
+        }
 
-        D3D11_SUBRESOURCE_DATA indexBufferData = {0};
-        indexBufferData.pSysMem = quadIndices;
-        indexBufferData.SysMemPitch = 0;
-        indexBufferData.SysMemSlicePitch = 0;
-        const CD3D11_BUFFER_DESC indexBufferDesc(sizeof(quadIndices), D3D11_BIND_INDEX_BUFFER);
-        winrt::check_hresult(device->CreateBuffer(&indexBufferDesc, &indexBufferData, m_indexBuffer.put()));
+        D3D11_SUBRESOURCE_DATA indexBufferData = {indices.data(), 0, 0};
+        const CD3D11_BUFFER_DESC indexBufferDesc(
+            static_cast<UINT>(indices.size() * sizeof(unsigned short)), D3D11_BIND_INDEX_BUFFER, D3D11_USAGE_IMMUTABLE);
+        m_deviceResources->CreateBuffer(MemoryAccounting::Tag::StatusDisplay, indexBufferDesc, &indexBufferData, m_quadIndexBuffer.put());
+
+        // Not dynamic, so the image quad and the glyphs of unchanged lines are kept when only the changed quads are uploaded.
+        const CD3D11_BUFFER_DESC vertexBufferDesc(MaxQuadCount * 4 * sizeof(VertexBufferElement), D3D11_BIND_VERTEX_BUFFER);
+        m_deviceResources->CreateBuffer(MemoryAccounting::Tag::StatusDisplay, vertexBufferDesc, nullptr, m_quadVertexBuffer.put());
+        m_imageVerticesChanged = true;
+
+        // The graph changes every frame and is rewritten as a whole, so its vertex buffer is dynamic.
+        const CD3D11_BUFFER_DESC graphVertexBufferDesc(
+            MaxGraphQuadCount * 4 * sizeof(VertexBufferElement), D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+        m_deviceResources->CreateBuffer(
+            MemoryAccounting::Tag::StatusDisplay, graphVertexBufferDesc, nullptr, m_graphVertexBuffer.put());
+        m_graphVerticesChanged = true;
     });
 
     // Create image sampler state
@@ -378,9 +384,11 @@ void StatusDisplay::ReleaseDeviceDependentResources()
 
     m_modelConstantBuffer = nullptr;
 
-    m_vertexBufferImage = nullptr;
-    m_vertexBufferText = nullptr;
-    m_indexBuffer = nullptr;
+    m_quadVertexBuffer = nullptr;
+    m_quadIndexBuffer = nullptr;
+    m_graphVertexBuffer = nullptr;
+
+    m_glyphAtlas.ReleaseDeviceDependentResources();
 
     m_imageView = nullptr;
     m_imageSamplerState = nullptr;
@@ -388,14 +396,17 @@ void StatusDisplay::ReleaseDeviceDependentResources()
     m_textSamplerState = nullptr;
     m_textAlphaBlendState = nullptr;
 
-    for (size_t i = 0; i < ARRAYSIZE(m_brushes); i++)
-    {
-        m_brushes[i] = nullptr;
-    }
     for (size_t i = 0; i < ARRAYSIZE(m_textFormats); i++)
     {
         m_textFormats[i] = nullptr;
     }
+
+    // Trigger full recreation of the text mesh once the resources are available again.
+    std::scoped_lock lock(m_lineMutex);
+    m_previousLines.clear();
+    m_runtimeLines.clear();
+    m_layoutCache.clear();
+    m_graphQuadCount = 0;
 }
 
 void StatusDisplay::ClearLines()
@@ -417,7 +428,7 @@ void StatusDisplay::SetLines(winrt::array_view<Line> lines)
     }
 }
 
-void StatusDisplay::UpdateLineText(size_t index, std::wstring text)
+void StatusDisplay::UpdateLineText(size_t index, std::wstring_view text)
 {
     std::scoped_lock lock(m_lineMutex);
     if (index >= m_lines.size())
@@ -425,7 +436,7 @@ void StatusDisplay::UpdateLineText(size_t index, std::wstring text)
         return;
     }
 
-    m_lines[index].text = text;
+    m_lines[index].text.assign(text.data(), text.size());
 }
 
 size_t StatusDisplay::AddLine(const Line& line)
@@ -443,6 +454,43 @@ bool StatusDisplay::HasLine(size_t index)
     return index < m_lines.size();
 }
 
+void StatusDisplay::SetGraph(winrt::array_view<const GraphQuad> quads)
+{
+    std::scoped_lock lock(m_lineMutex);
+    if (!m_hasGraph)
+    {
+        // The lines move below the graph.
+        m_hasGraph = true;
+        m_previousLines.clear();
+    }
+
+    m_graphQuads.assign(quads.begin(), quads.end());
+    m_graphVerticesChanged = true;
+}
+
+void StatusDisplay::ClearGraph()
+{
+    std::scoped_lock lock(m_lineMutex);
+    if (m_hasGraph)
+    {
+        m_hasGraph = false;
+        m_previousLines.clear();
+        m_graphQuads.clear();
+        m_graphVerticesChanged = true;
+    }
+}
+
+bool StatusDisplay::HasContent()
+{
+    if (m_imageEnabled && m_imageView)
+    {
+        return true;
+    }
+
+    std::scoped_lock lock(m_lineMutex);
+    return !m_lines.empty() || m_hasGraph;
+}
+
 void StatusDisplay::CreateFonts()
 {
     // DIP font size, based on the horizontal size of the virtual display.
@@ -509,16 +557,19 @@ void StatusDisplay::CreateFonts()
     static_assert(TextFormatCount == 4, "Expected 4 text formats");
 }
 
-void StatusDisplay::CreateBrushes()
+void StatusDisplay::CreateGlyphAtlas()
 {
-    m_brushes[White] = nullptr;
-    winrt::check_hresult(m_d2dTextRenderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::FloralWhite), m_brushes[White].put()));
-
-    m_brushes[Yellow] = nullptr;
-    winrt::check_hresult(m_d2dTextRenderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::Yellow), m_brushes[Yellow].put()));
-
-    m_brushes[Red] = nullptr;
-    winrt::check_hresult(m_d2dTextRenderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::Red), m_brushes[Red].put()));
+    // The glyphs are rendered at the resolution of the text area, so that they are sampled one to one.
+    const float virtualDisplayDPIx = m_textTextureWidth / m_virtualDisplaySizeInchX;
+    const float virtualDisplayDPIy = m_textTextureHeight / m_virtualDisplaySizeInchY;
+
+    m_glyphAtlas.CreateDeviceDependentResources(
+        m_deviceResources->GetD3DDevice(),
+        m_deviceResources->GetD2DFactory(),
+        m_deviceResources->GetDWriteFactory(),
+        {std::begin(m_textFormats), std::end(m_textFormats)},
+        virtualDisplayDPIx,
+        virtualDisplayDPIy);
 }
 
 void StatusDisplay::UpdateLineInternal(RuntimeLine& runtimeLine, const Line& line)
@@ -526,27 +577,45 @@ void StatusDisplay::UpdateLineInternal(RuntimeLine& runtimeLine, const Line& lin
     assert(line.format >= 0 && line.format < TextFormatCount && "Line text format out of bounds");
     assert(line.color >= 0 && line.color < TextColorCount && "Line text color out of bounds");
 
-    if (line.format != runtimeLine.format || line.text != runtimeLine.text)
+    const bool formatChanged = line.format != runtimeLine.format || !runtimeLine.initialized;
+    const bool labelChanged = formatChanged || line.label != runtimeLine.label;
+    const bool textChanged = labelChanged || line.text != runtimeLine.text;
+
+    if (textChanged)
     {
         runtimeLine.format = line.format;
-        runtimeLine.text = line.text;
+        runtimeLine.initialized = true;
 
-        const float virtualDisplayDPIx = m_textTextureWidth / m_virtualDisplaySizeInchX;
-        const float virtualDisplayDPIy = m_textTextureHeight / m_virtualDisplaySizeInchY;
+        const float maxWidth = GetTextAreaSize().x;
 
-        const float dpiScaleX = virtualDisplayDPIx / 96.0f;
-        const float dpiScaleY = virtualDisplayDPIy / 96.0f;
+        // Lines with a label are split into two columns, separated by half of the font size.
+        const float columnSpacing = m_textFormats[line.format]->GetFontSize() * 0.5f;
+        const float columnWidth = (maxWidth - columnSpacing) * 0.5f;
 
-        runtimeLine.layout = nullptr;
-        winrt::check_hresult(m_deviceResources->GetDWriteFactory()->CreateTextLayout(
-            line.text.c_str(),
-            static_cast<UINT32>(line.text.length()),
-            m_textFormats[line.format].get(),
-            static_cast<float>(m_textTextureWidth / dpiScaleX),  // Max width of the input text.
-            static_cast<float>(m_textTextureHeight / dpiScaleY), // Max height of the input text.
-            runtimeLine.layout.put()));
+        if (labelChanged)
+        {
+            runtimeLine.label = line.label;
+            runtimeLine.labelGlyphs.clear();
+            runtimeLine.labelHeight = 0.0f;
 
-        winrt::check_hresult(runtimeLine.layout->GetMetrics(&runtimeLine.metrics));
+            if (!line.label.empty())
+            {
+                runtimeLine.labelHeight =
+                    LayoutTextCached(line.label, line.format, 0.0f, columnWidth, DWRITE_TEXT_ALIGNMENT_TRAILING, runtimeLine.labelGlyphs);
+            }
+        }
+
+        runtimeLine.text = line.text;
+        if (runtimeLine.label.empty())
+        {
+            runtimeLine.textHeight =
+                LayoutTextCached(line.text, line.format, 0.0f, maxWidth, DWRITE_TEXT_ALIGNMENT_CENTER, runtimeLine.textGlyphs);
+        }
+        else
+        {
+            runtimeLine.textHeight = LayoutTextCached(
+                line.text, line.format, columnWidth + columnSpacing, columnWidth, DWRITE_TEXT_ALIGNMENT_LEADING, runtimeLine.textGlyphs);
+        }
     }
 
     runtimeLine.color = line.color;
@@ -554,6 +623,266 @@ void StatusDisplay::UpdateLineInternal(RuntimeLine& runtimeLine, const Line& lin
     runtimeLine.alignBottom = line.alignBottom;
 }
 
+void StatusDisplay::UpdateTextMesh(size_t firstLine)
+{
+    const float2 textAreaSize = GetTextAreaSize();
+    auto toQuad = [&](float x, float y) { return TextAreaToQuad(x, y, textAreaSize); };
+
+    m_textVertices.clear();
+
+    // The lines start below the graph.
+    UINT firstGlyph = 0;
+    UINT glyphCount = 0;
+    float top = m_hasGraph ? GetGraphHeight(textAreaSize) + textAreaSize.x * GraphSpacing : 0.0f;
+    for (size_t lineIndex = 0; lineIndex < m_runtimeLines.size(); ++lineIndex)
+    {
+        RuntimeLine& line = m_runtimeLines[lineIndex];
+        const float lineHeight = std::max<>(line.textHeight, line.labelHeight);
+        if (line.alignBottom)
+        {
+            top = textAreaSize.y - (lineHeight * line.lineHeightMultiplier);
+        }
+
+        // The glyphs of the lines before the first changed line are already in the vertex buffer.
+        if (lineIndex < firstLine)
+        {
+            glyphCount = line.firstGlyph + line.glyphCount;
+            firstGlyph = glyphCount;
+        }
+        else
+        {
+            line.firstGlyph = glyphCount;
+            for (const GlyphQuads* glyphs : {&line.labelGlyphs, &line.textGlyphs})
+            {
+                for (const GlyphQuad& glyph : *glyphs)
+                {
+                    const float glyphTop = top + glyph.y;
+                    const float glyphBottom = glyphTop + glyph.height;
+
+                    // Glyphs are clipped to the text area and to the capacity of the vertex buffer.
+                    if (glyphTop < 0.0f || glyphBottom > textAreaSize.y || glyphCount == MaxGlyphCount)
+                    {
+                        continue;
+                    }
+
+                    const float glyphLeft = glyph.x;
+                    const float glyphRight = glyph.x + glyph.width;
+
+                    const XMFLOAT4& color = TextColors[line.color];
+                    m_textVertices.push_back(
+                        {toQuad(glyphLeft, glyphTop), XMFLOAT2(glyph.uvTopLeft.x, glyph.uvTopLeft.y), color, TextLayer});
+                    m_textVertices.push_back(
+                        {toQuad(glyphRight, glyphTop), XMFLOAT2(glyph.uvBottomRight.x, glyph.uvTopLeft.y), color, TextLayer});
+                    m_textVertices.push_back(
+                        {toQuad(glyphRight, glyphBottom), XMFLOAT2(glyph.uvBottomRight.x, glyph.uvBottomRight.y), color, TextLayer});
+                    m_textVertices.push_back(
+                        {toQuad(glyphLeft, glyphBottom), XMFLOAT2(glyph.uvTopLeft.x, glyph.uvBottomRight.y), color, TextLayer});
+                    ++glyphCount;
+                }
+            }
+            line.glyphCount = glyphCount - line.firstGlyph;
+        }
+
+        top += lineHeight * line.lineHeightMultiplier;
+    }
+
+    m_textGlyphCount = glyphCount;
+    if (m_textVertices.empty())
+    {
+        return;
+    }
+
+    // Only the glyphs of the changed lines and the lines after them are uploaded.
+    const size_t firstVertex = (FirstGlyphQuad + firstGlyph) * 4;
+    const D3D11_BOX box = {
+        static_cast<UINT>(firstVertex * sizeof(VertexBufferElement)),
+        0,
+        0,
+        static_cast<UINT>((firstVertex + m_textVertices.size()) * sizeof(VertexBufferElement)),
+        1,
+        1};
+    m_deviceResources->UseD3DDeviceContext(
+        [&](auto context) { context->UpdateSubresource(m_quadVertexBuffer.get(), 0, &box, m_textVertices.data(), 0, 0); });
+}
+
+void StatusDisplay::UpdateGraphMesh()
+{
+    m_graphVerticesChanged = false;
+    m_graphQuadCount = m_hasGraph ? static_cast<UINT>(std::min<size_t>(m_graphQuads.size(), MaxGraphQuadCount)) : 0;
+    if (m_graphQuadCount == 0)
+    {
+        return;
+    }
+
+    // The graph spans the width of the text area. All vertices sample the white texel of the glyph atlas.
+    const float2 textAreaSize = GetTextAreaSize();
+    const float graphHeight = GetGraphHeight(textAreaSize);
+    const XMFLOAT2 uv = m_glyphAtlas.GetSolidUv();
+
+    m_deviceResources->UseD3DDeviceContext([&](auto context) {
+        D3D11_MAPPED_SUBRESOURCE mappedVertices = {};
+        winrt::check_hresult(context->Map(m_graphVertexBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedVertices));
+        VertexBufferElement* vertices = static_cast<VertexBufferElement*>(mappedVertices.pData);
+
+        for (UINT i = 0; i < m_graphQuadCount; ++i)
+        {
+            const GraphQuad& quad = m_graphQuads[i];
+            const float left = std::clamp(quad.left, 0.0f, 1.0f) * textAreaSize.x;
+            const float right = std::clamp(quad.right, 0.0f, 1.0f) * textAreaSize.x;
+            const float top = (1.0f - std::clamp(quad.top, 0.0f, 1.0f)) * graphHeight;
+            const float bottom = (1.0f - std::clamp(quad.bottom, 0.0f, 1.0f)) * graphHeight;
+
+            const XMFLOAT4& color = TextColors[quad.color];
+            vertices[i * 4 + 0] = {TextAreaToQuad(left, top, textAreaSize), uv, color, TextLayer};
+            vertices[i * 4 + 1] = {TextAreaToQuad(right, top, textAreaSize), uv, color, TextLayer};
+            vertices[i * 4 + 2] = {TextAreaToQuad(right, bottom, textAreaSize), uv, color, TextLayer};
+            vertices[i * 4 + 3] = {TextAreaToQuad(left, bottom, textAreaSize), uv, color, TextLayer};
+        }
+
+        context->Unmap(m_graphVertexBuffer.get(), 0);
+    });
+}
+
+XMFLOAT3 StatusDisplay::TextAreaToQuad(float x, float y, float2 textAreaSize) const
+{
+    return XMFLOAT3(
+        (x / textAreaSize.x * 2.0f - 1.0f) * m_textQuadExtent.x, (1.0f - y / textAreaSize.y * 2.0f) * m_textQuadExtent.y, 0.0f);
+}
+
+float StatusDisplay::GetGraphHeight(float2 textAreaSize) const
+{
+    return std::min(textAreaSize.x * GraphHeight, textAreaSize.y);
+}
+
+float StatusDisplay::LayoutText(
+    std::wstring_view text,
+    TextFormat format,
+    float originX,
+    float width,
+    DWRITE_TEXT_ALIGNMENT alignment,
+    GlyphQuads& glyphs) const
+{
+    glyphs.clear();
+
+    const float lineHeight = m_glyphAtlas.GetLineHeight(format);
+    float top = 0.0f;
+
+    auto addGlyphs = [&](std::wstring_view lineText, float lineWidth) {
+        float penX = originX;
+        if (alignment == DWRITE_TEXT_ALIGNMENT_CENTER)
+        {
+            penX += (width - lineWidth) * 0.5f;
+        }
+        else if (alignment == DWRITE_TEXT_ALIGNMENT_TRAILING)
+        {
+            penX += width - lineWidth;
+        }
+
+        for (wchar_t character : lineText)
+        {
+            const GlyphAtlas::Glyph& glyph = m_glyphAtlas.GetGlyph(format, character);
+            if (glyph.visible)
+            {
+                glyphs.push_back(GlyphQuad{penX + glyph.offsetX, top, glyph.width, lineHeight, glyph.uvTopLeft, glyph.uvBottomRight});
+            }
+            penX += glyph.advance;
+        }
+    };
+
+    size_t paragraphStart = 0;
+    while (true)
+    {
+        const size_t paragraphEnd = text.find(L'\n', paragraphStart);
+        const std::wstring_view paragraph =
+            text.substr(paragraphStart, paragraphEnd == std::wstring_view::npos ? std::wstring_view::npos : paragraphEnd - paragraphStart);
+
+        // Break the paragraph at the last space before the text exceeds the available width.
+        size_t lineStart = 0;
+        do
+        {
+            size_t breakPosition = std::wstring_view::npos;
+            float breakWidth = 0.0f;
+            float lineWidth = 0.0f;
+
+            size_t position = lineStart;
+            for (; position < paragraph.size(); ++position)
+            {
+                const float advance = m_glyphAtlas.GetGlyph(format, paragraph[position]).advance;
+                if (paragraph[position] == L' ')
+                {
+                    breakPosition = position;
+                    breakWidth = lineWidth;
+                }
+                else if (lineWidth + advance > width && breakPosition != std::wstring_view::npos)
+                {
+                    break;
+                }
+                lineWidth += advance;
+            }
+
+            if (position < paragraph.size())
+            {
+                addGlyphs(paragraph.substr(lineStart, breakPosition - lineStart), breakWidth);
+                lineStart = breakPosition + 1;
+            }
+            else
+            {
+                addGlyphs(paragraph.substr(lineStart), lineWidth);
+                lineStart = position;
+            }
+
+            top += lineHeight;
+        } while (lineStart < paragraph.size());
+
+        if (paragraphEnd == std::wstring_view::npos)
+        {
+            break;
+        }
+        paragraphStart = paragraphEnd + 1;
+    }
+
+    return top;
+}
+
+float StatusDisplay::LayoutTextCached(
+    std::wstring_view text,
+    TextFormat format,
+    float originX,
+    float width,
+    DWRITE_TEXT_ALIGNMENT alignment,
+    GlyphQuads& glyphs)
+{
+    auto it = m_layoutCache.find(std::make_tuple(format, alignment, text));
+    if (it == m_layoutCache.end())
+    {
+        if (m_layoutCache.size() >= MaxCachedLayouts)
+        {
+            m_layoutCache.erase(std::min_element(m_layoutCache.begin(), m_layoutCache.end(), [](const auto& a, const auto& b) {
+                return a.second.lastUse < b.second.lastUse;
+            }));
+        }
+
+        CachedLayout layout;
+        layout.height = LayoutText(text, format, originX, width, alignment, layout.glyphs);
+        it = m_layoutCache.emplace(LayoutKey{format, alignment, std::wstring(text)}, std::move(layout)).first;
+    }
+
+    it->second.lastUse = ++m_layoutUseCount;
+    glyphs = it->second.glyphs;
+    return it->second.height;
+}
+
+float2 StatusDisplay::GetTextAreaSize() const
+{
+    const float virtualDisplayDPIx = m_textTextureWidth / m_virtualDisplaySizeInchX;
+    const float virtualDisplayDPIy = m_textTextureHeight / m_virtualDisplaySizeInchY;
+
+    const float dpiScaleX = virtualDisplayDPIx / 96.0f;
+    const float dpiScaleY = virtualDisplayDPIy / 96.0f;
+
+    return {m_textTextureWidth / dpiScaleX, m_textTextureHeight / dpiScaleY};
+}
+
 void StatusDisplay::SetImage(const winrt::com_ptr<ID3D11ShaderResourceView>& imageView)
 {
     m_imageView = imageView;
@@ -574,7 +903,9 @@ void StatusDisplay::PositionDisplay(
     const float3 headRight = normalize(cross(direction, float3(0, 1, 0)));
     const float3 headUp = normalize(cross(headRight, direction));
 
-    m_positionContent = lerp(m_positionContent, contentPosition, deltaTimeInSeconds * c_lerpRate);
+    m_positionContent =
+        m_positionSnapPending ? contentPosition : lerp(m_positionContent, contentPosition, deltaTimeInSeconds * c_lerpRate);
+    m_positionSnapPending = false;
     m_positionOffset =
         m_positionContent + (headRight * m_virtualDisplaySizeInchX * imageOffsetX) + (headUp * m_virtualDisplaySizeInchY * imageOffsetY);
     m_normalContent = direction;
@@ -582,7 +913,7 @@ void StatusDisplay::PositionDisplay(
 
 void StatusDisplay::UpdateConstantBuffer(
     float deltaTimeInSeconds,
-    ModelConstantBuffer& buffer,
+    XMFLOAT4X4& model,
     winrt::Windows::Foundation::Numerics::float3 position,
     winrt::Windows::Foundation::Numerics::float3 normal)
 {
@@ -615,7 +946,7 @@ void StatusDisplay::UpdateConstantBuffer(
     // with holographic cameras, and updated on a per-camera basis.
     // Here, we provide the model transform for the sample hologram. The model transform
     // matrix is transposed to prepare it for the shader.
-    XMStoreFloat4x4(&buffer.model, XMMatrixTranspose(rotationMatrix * modelTranslation));
+    XMStoreFloat4x4(&model, XMMatrixTranspose(rotationMatrix * modelTranslation));
 }
 
 void StatusDisplay::UpdateTextScale(
@@ -692,94 +1023,39 @@ void StatusDisplay::UpdateTextScale(
 
         m_projection = proj;
 
-        // Create the new texture.
         auto device = m_deviceResources->GetD3DDevice();
 
-        // Load mesh vertices. Each vertex has a position and a color.
-        // Note that the quad size has changed from the default DirectX app
-        // template. The quad size is based on the target FOV.
-        const VertexBufferElement quadVerticesText[] = {
-            {XMFLOAT3(-quadExtentX, quadExtentY, 0.f), XMFLOAT2(0.f, 0.f)},
-            {XMFLOAT3(quadExtentX, quadExtentY, 0.f), XMFLOAT2(1.f, 0.f)},
-            {XMFLOAT3(quadExtentX, -quadExtentY, 0.f), XMFLOAT2(1.f, 1.f)},
-            {XMFLOAT3(-quadExtentX, -quadExtentY, 0.f), XMFLOAT2(0.f, 1.f)},
-        };
-
-        D3D11_SUBRESOURCE_DATA vertexBufferDataText = {0};
-        vertexBufferDataText.pSysMem = quadVerticesText;
-        vertexBufferDataText.SysMemPitch = 0;
-        vertexBufferDataText.SysMemSlicePitch = 0;
-        const CD3D11_BUFFER_DESC vertexBufferDescText(sizeof(quadVerticesText), D3D11_BIND_VERTEX_BUFFER);
-
-        m_vertexBufferText = nullptr;
-        winrt::check_hresult(device->CreateBuffer(&vertexBufferDescText, &vertexBufferDataText, m_vertexBufferText.put()));
+        // The glyph quads of the text are placed within the text quad, whose size is based on the target FOV.
+        m_textQuadExtent = {quadExtentX, quadExtentY};
 
         // Create image buffer
         // The image contains 50% of the textFOV.
         const float imageFOVDegree = (m_isOpaque ? 0.75f : 0.2f) * (m_currentQuadFov * 0.5f);
         const float imageQuadExtent = m_statusDisplayDistance / tan((90.0f - imageFOVDegree) * Degree2Rad);
 
-        const VertexBufferElement quadVertices[] = {
-            {XMFLOAT3(-imageQuadExtent, imageQuadExtent, 0.f), XMFLOAT2(0.f, 0.f)},
-            {XMFLOAT3(imageQuadExtent, imageQuadExtent, 0.f), XMFLOAT2(1.f, 0.f)},
-            {XMFLOAT3(imageQuadExtent, -imageQuadExtent, 0.f), XMFLOAT2(1.f, 1.f)},
-            {XMFLOAT3(-imageQuadExtent, -imageQuadExtent, 0.f), XMFLOAT2(0.f, 1.f)},
-        };
-
-        D3D11_SUBRESOURCE_DATA vertexBufferData = {0};
-        vertexBufferData.pSysMem = quadVertices;
-        vertexBufferData.SysMemPitch = 0;
-        vertexBufferData.SysMemSlicePitch = 0;
-        const CD3D11_BUFFER_DESC vertexBufferDesc(sizeof(quadVertices), D3D11_BIND_VERTEX_BUFFER);
-        m_vertexBufferImage = nullptr;
-        winrt::check_hresult(device->CreateBuffer(&vertexBufferDesc, &vertexBufferData, m_vertexBufferImage.put()));
-
-        CD3D11_TEXTURE2D_DESC textureDesc(
-            DXGI_FORMAT_B8G8R8A8_UNORM,
-            m_textTextureWidth,
-            m_textTextureHeight,
-            1,
-            1,
-            D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET);
-
-        m_textTexture = nullptr;
-        device->CreateTexture2D(&textureDesc, nullptr, m_textTexture.put());
-
-        m_textShaderResourceView = nullptr;
-        device->CreateShaderResourceView(m_textTexture.get(), nullptr, m_textShaderResourceView.put());
-
-        m_textRenderTarget = nullptr;
-        device->CreateRenderTargetView(m_textTexture.get(), nullptr, m_textRenderTarget.put());
-
-        const float virtualDisplayDPIx = m_textTextureWidth / m_virtualDisplaySizeInchX;
-        const float virtualDisplayDPIy = m_textTextureHeight / m_virtualDisplaySizeInchY;
-
-        D2D1_RENDER_TARGET_PROPERTIES props = D2D1::RenderTargetProperties(
-            D2D1_RENDER_TARGET_TYPE_DEFAULT,
-            D2D1::PixelFormat(DXGI_FORMAT_UNKNOWN, D2D1_ALPHA_MODE_PREMULTIPLIED),
-            virtualDisplayDPIx,
-            virtualDisplayDPIy);
-
-        winrt::com_ptr<IDXGISurface> dxgiSurface;
-        m_textTexture.as(dxgiSurface);
-
-        m_d2dTextRenderTarget = nullptr;
-        winrt::check_hresult(
-            m_deviceResources->GetD2DFactory()->CreateDxgiSurfaceRenderTarget(dxgiSurface.get(), &props, m_d2dTextRenderTarget.put()));
+        // The image quad is uploaded into the shared vertex buffer by the next Render.
+        m_imageVertices[0] = {XMFLOAT3(-imageQuadExtent, imageQuadExtent, 0.f), XMFLOAT2(0.f, 0.f), ImageColor, ImageLayer};
+        m_imageVertices[1] = {XMFLOAT3(imageQuadExtent, imageQuadExtent, 0.f), XMFLOAT2(1.f, 0.f), ImageColor, ImageLayer};
+        m_imageVertices[2] = {XMFLOAT3(imageQuadExtent, -imageQuadExtent, 0.f), XMFLOAT2(1.f, 1.f), ImageColor, ImageLayer};
+        m_imageVertices[3] = {XMFLOAT3(-imageQuadExtent, -imageQuadExtent, 0.f), XMFLOAT2(0.f, 1.f), ImageColor, ImageLayer};
+        m_imageVerticesChanged = true;
 
-        // Update the fonts.
+        // Update the fonts and render their glyphs at the new resolution.
         CreateFonts();
+        CreateGlyphAtlas();
 
         // Trigger full recreation in the next frame
         m_previousLines.clear();
         m_runtimeLines.clear();
+        m_layoutCache.clear();
+        m_graphVerticesChanged = true;
     }
 }
 
 bool StatusDisplay::Line::operator==(const Line& line) const
 {
-    return std::tie(text, format, color, lineHeightMultiplier, alignBottom) ==
-           std::tie(line.text, line.format, line.color, line.lineHeightMultiplier, line.alignBottom);
+    return std::tie(text, format, color, lineHeightMultiplier, alignBottom, label) ==
+           std::tie(line.text, line.format, line.color, line.lineHeightMultiplier, line.alignBottom, line.label);
 }
 
 bool StatusDisplay::Line::operator!=(const Line& line) const
@@ -12,9 +12,14 @@
 #pragma once
 
 #include "..\Common\DeviceResourcesCommon.h"
+#include "..\Common\MemoryAccounting.h"
+#include "GlyphAtlas.h"
 #include "ShaderStructures.h"
 
+#include <map>
 #include <string>
+#include <string_view>
+#include <tuple>
 
 #include <winrt\Windows.Networking.Connectivity.h>
 
@@ -52,8 +57,25 @@ public:
         TextColor color = White;
         float lineHeightMultiplier = 1.0f;
         bool alignBottom = false;
+        // Optional static label rendered in a column left of the text. The label is laid out independently of the text, so
+        // lines whose text changes frequently only rebuild the layout of the text.
+        std::wstring label;
     };
 
+    // A solid quad of the graph, in coordinates of the graph area. x runs from 0 at the left to 1 at the right edge of the area, y
+    // from 0 at the bottom to 1 at the top. Quads are clamped to the area.
+    struct GraphQuad
+    {
+        float left = 0.0f;
+        float right = 0.0f;
+        float bottom = 0.0f;
+        float top = 0.0f;
+        TextColor color = White;
+    };
+
+    // Maximum number of quads of the graph.
+    static constexpr UINT MaxGraphQuadCount = 1024;
+
 public:
     StatusDisplay(const std::shared_ptr<DXHelper::DeviceResourcesCommon>& deviceResources);
 
@@ -74,8 +96,8 @@ public:
     // Set a new set of lines replacing the existing ones
     void SetLines(winrt::array_view<Line> lines);
 
-    // Update the text of a single line
-    void UpdateLineText(size_t index, std::wstring text);
+    // Update the text of a single line. Reuses the storage of the current text of the line.
+    void UpdateLineText(size_t index, std::wstring_view text);
 
     // Add a new line returning the index of the new line
     size_t AddLine(const Line& line);
@@ -83,6 +105,18 @@ public:
     // Check if a line with the given index exists
     bool HasLine(size_t index);
 
+    // Shows a graph in a band at the top of the text area and moves the lines below it, or replaces the quads of the shown graph.
+    // The quads are drawn from a dynamic vertex buffer of their own with a single draw call for both views, so the graph can
+    // change every frame without laying out any text.
+    void SetGraph(winrt::array_view<const GraphQuad> quads);
+
+    // Removes the graph, the lines move up into its band.
+    void ClearGraph();
+
+    // Check if there is anything to draw, i.e. at least one line or an enabled image. Without content the status display can be
+    // skipped entirely, including its positioning and the per camera text scale update.
+    bool HasContent();
+
     /*
         Methods to change the displayed image
     */
@@ -117,48 +151,145 @@ public:
         bool isOpaque);
 
 private:
+    // A single glyph quad of a laid out text, in DIPs relative to the top left corner of the line.
+    struct GlyphQuad
+    {
+        float x = 0.0f;
+        float y = 0.0f;
+        float width = 0.0f;
+        float height = 0.0f;
+        DirectX::XMFLOAT2 uvTopLeft = {};
+        DirectX::XMFLOAT2 uvBottomRight = {};
+    };
+
+    // The glyphs and the vertices of the lines are counted under MemoryAccounting::Tag::StatusDisplay.
+    template <typename T>
+    using StatusVector = MemoryAccounting::Vector<T, MemoryAccounting::Tag::StatusDisplay>;
+    using GlyphQuads = StatusVector<GlyphQuad>;
+
     // Runtime representation of a text line.
     struct RuntimeLine
     {
-        winrt::com_ptr<IDWriteTextLayout> layout = nullptr;
-        DWRITE_TEXT_METRICS metrics = {};
+        GlyphQuads textGlyphs;
+        GlyphQuads labelGlyphs;
+        float textHeight = 0.0f;
+        float labelHeight = 0.0f;
         std::wstring text = {};
+        std::wstring label = {};
         TextFormat format = Large;
         TextColor color = White;
         float lineHeightMultiplier = 1.0f;
         bool alignBottom = false;
+        bool initialized = false;
+
+        // Range of the glyphs of this line. Glyph i is the quad FirstGlyphQuad + i of the vertex buffer.
+        UINT firstGlyph = 0;
+        UINT glyphCount = 0;
     };
 
+    // A laid out text. Layouts are cached, so lines which only move, e.g. when an error line above them ages out, or which show
+    // a text again are not laid out again.
+    struct CachedLayout
+    {
+        GlyphQuads glyphs;
+        float height = 0.0f;
+        uint64_t lastUse = 0;
+    };
+
+    // The alignment identifies the column of the line the text is laid out in, which determines the origin and the width.
+    using LayoutKey = std::tuple<TextFormat, DWRITE_TEXT_ALIGNMENT, std::wstring>;
+
+    // The least recently used layout is dropped when the cache is full.
+    static constexpr size_t MaxCachedLayouts = 64;
+
+    // Maximum number of glyphs of all lines together.
+    static constexpr UINT MaxGlyphCount = 4096;
+
+    // The image and the glyphs share one vertex buffer, so both stereo views of all of them are drawn with a single draw call.
+    // The image quad comes first, it is skipped when the image is not drawn.
+    static constexpr UINT ImageQuad = 0;
+    static constexpr UINT FirstGlyphQuad = 1;
+    static constexpr UINT MaxQuadCount = FirstGlyphQuad + MaxGlyphCount;
+    static_assert(MaxGraphQuadCount <= MaxQuadCount, "The graph is drawn with the index buffer of the image and the glyphs.");
+    static constexpr uint32_t ImageLayer = 0;
+    static constexpr uint32_t TextLayer = 1;
+
     void CreateFonts();
-    void CreateBrushes();
+    void CreateGlyphAtlas();
     void UpdateLineInternal(RuntimeLine& runtimLine, const Line& line);
+    // Rebuilds the glyph quads of the lines starting at firstLine. The quads of the lines before stay in the vertex buffer.
+    void UpdateTextMesh(size_t firstLine);
+    // Rewrites the vertex buffer of the graph.
+    void UpdateGraphMesh();
+
+    // Maps a position in DIPs of the text area to the text quad.
+    DirectX::XMFLOAT3 TextAreaToQuad(float x, float y, winrt::Windows::Foundation::Numerics::float2 textAreaSize) const;
+
+    // Returns the height of the graph in DIPs.
+    float GetGraphHeight(winrt::Windows::Foundation::Numerics::float2 textAreaSize) const;
+
+    // Lays out the text using the glyphs of the atlas. Breaks lines at spaces to fit into the given width.
+    // Returns the height of the laid out text.
+    float LayoutText(
+        std::wstring_view text,
+        TextFormat format,
+        float originX,
+        float width,
+        DWRITE_TEXT_ALIGNMENT alignment,
+        GlyphQuads& glyphs) const;
+
+    // Returns the cached layout of the text, or lays it out and caches it.
+    float LayoutTextCached(
+        std::wstring_view text,
+        TextFormat format,
+        float originX,
+        float width,
+        DWRITE_TEXT_ALIGNMENT alignment,
+        GlyphQuads& glyphs);
+
+    // Returns the size of the text area in DIPs.
+    winrt::Windows::Foundation::Numerics::float2 GetTextAreaSize() const;
+
     void UpdateConstantBuffer(
         float deltaTimeInSeconds,
-        ModelConstantBuffer& buffer,
+        DirectX::XMFLOAT4X4& model,
         winrt::Windows::Foundation::Numerics::float3 position,
         winrt::Windows::Foundation::Numerics::float3 normal);
 
-    winrt::com_ptr<ID2D1SolidColorBrush> m_brushes[TextColorCount] = {};
     winrt::com_ptr<IDWriteTextFormat> m_textFormats[TextFormatCount] = {};
     std::vector<Line> m_lines;
     std::vector<Line> m_previousLines;
     std::vector<RuntimeLine> m_runtimeLines;
     std::mutex m_lineMutex;
 
+    // Only valid for the current fonts and text area, cleared together with the runtime lines.
+    std::map<LayoutKey, CachedLayout, std::less<>> m_layoutCache;
+    uint64_t m_layoutUseCount = 0;
+
     // Cached pointer to device resources.
     std::shared_ptr<DXHelper::DeviceResourcesCommon> m_deviceResources;
 
     // Resources related to text rendering.
-    winrt::com_ptr<ID3D11Texture2D> m_textTexture;
-    winrt::com_ptr<ID3D11ShaderResourceView> m_textShaderResourceView;
-    winrt::com_ptr<ID3D11RenderTargetView> m_textRenderTarget;
-    winrt::com_ptr<ID2D1RenderTarget> m_d2dTextRenderTarget;
+    GlyphAtlas m_glyphAtlas;
+    StatusVector<VertexBufferElement> m_textVertices;
+    UINT m_textGlyphCount = 0;
+
+    // The quads of the graph, guarded by m_lineMutex like the lines. They are uploaded by the next Render when
+    // m_graphVerticesChanged is set.
+    StatusVector<GraphQuad> m_graphQuads;
+    bool m_hasGraph = false;
+    bool m_graphVerticesChanged = false;
+    UINT m_graphQuadCount = 0;
+
+    // The vertices of the image quad, uploaded by the next Render when m_imageVerticesChanged is set.
+    VertexBufferElement m_imageVertices[4] = {};
+    bool m_imageVerticesChanged = false;
 
     // Direct3D resources for quad geometry.
     winrt::com_ptr<ID3D11InputLayout> m_inputLayout;
-    winrt::com_ptr<ID3D11Buffer> m_vertexBufferImage;
-    winrt::com_ptr<ID3D11Buffer> m_vertexBufferText;
-    winrt::com_ptr<ID3D11Buffer> m_indexBuffer;
+    winrt::com_ptr<ID3D11Buffer> m_quadVertexBuffer;
+    winrt::com_ptr<ID3D11Buffer> m_quadIndexBuffer;
+    winrt::com_ptr<ID3D11Buffer> m_graphVertexBuffer;
     winrt::com_ptr<ID3D11VertexShader> m_vertexShader;
     winrt::com_ptr<ID3D11GeometryShader> m_geometryShader;
     winrt::com_ptr<ID3D11PixelShader> m_pixelShader;
@@ -172,10 +303,8 @@ private:
     winrt::com_ptr<ID3D11BlendState> m_textAlphaBlendState;
     winrt::com_ptr<ID3D11DepthStencilState> m_depthStencilState;
 
-    // System resources for quad geometry.
-    ModelConstantBuffer m_modelConstantBufferDataImage = {};
-    ModelConstantBuffer m_modelConstantBufferDataText = {};
-    uint32_t m_indexCount = 0;
+    // System resources for quad geometry. Holds the model transforms of the image and the text layer.
+    ModelConstantBuffer m_modelConstantBufferData = {};
 
     // Variables used with the rendering loop.
     bool m_loadingComplete = false;
@@ -184,6 +313,10 @@ private:
     winrt::Windows::Foundation::Numerics::float3 m_positionContent = {0.0f, 0.0f, 0.0f};
     winrt::Windows::Foundation::Numerics::float3 m_normalContent = {0.0f, 0.0f, 0.0f};
 
+    // Set while there is no content. The next PositionDisplay then places the display directly instead of moving it in from where
+    // it was hidden.
+    bool m_positionSnapPending = true;
+
     // If the current D3D Device supports VPRT, we can avoid using a geometry
     // shader just to set the render target array index.
     bool m_usingVprtShaders = false;
@@ -199,10 +332,13 @@ private:
     // The view Projection matrix.
     DirectX::XMFLOAT4X4 m_projection;
 
-    // Default size, gets adjusted based on HMD.
+    // Resolution the text is rendered at. Default size, gets adjusted based on HMD.
     int m_textTextureWidth = 128;
     int m_textTextureHeight = 128;
 
+    // Half extent of the text quad in meters.
+    winrt::Windows::Foundation::Numerics::float2 m_textQuadExtent = {0.0f, 0.0f};
+
     // Default size, gets adjusted based on the HMD and FOV.
     float m_virtualDisplaySizeInchX = 10.0f;
     float m_virtualDisplaySizeInchY = 10.0f;
@@ -215,6 +351,6 @@ private:
     float m_defaultQuadFov = 25.0f;
     // The statistics FOV for the text quad in degree.
     float m_landscapeQuadFov = 23.0f;
-    // The height ratio for the statistics quad in percent.
-    float m_landscapeHeightRatio = 0.3f;
+    // The height ratio for the statistics quad in percent. Holds the frame graph, the statistics and the lines below them.
+    float m_landscapeHeightRatio = 0.75f;
 };
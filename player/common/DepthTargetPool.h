@@ -0,0 +1,62 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <d3d11.h>
+
+#include <winrt/Windows.Graphics.DirectX.Direct3D11.h>
+
+#include <deque>
+#include <memory>
+#include <mutex>
+
+namespace DXHelper
+{
+    // A depth buffer with its view. The interop surface, which hands the depth buffer to WinRT APIs, is created on first use
+    // and kept with the depth buffer.
+    struct DepthTarget
+    {
+        D3D11_TEXTURE2D_DESC desc = {};
+        DXGI_FORMAT viewFormat = DXGI_FORMAT_UNKNOWN;
+        winrt::com_ptr<ID3D11Texture2D> texture;
+        winrt::com_ptr<ID3D11DepthStencilView> view;
+
+        winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface GetInteropSurface();
+
+    private:
+        winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface m_interopSurface = nullptr;
+    };
+
+    // Keeps the depth targets released by the cameras, so a camera which needs a depth target of the same description, e.g.
+    // after its render target size changed back, reuses one instead of allocating it. Thread-safe.
+    class DepthTargetPool
+    {
+    public:
+        // Returns a released depth target of the description and view format, or creates one if none matches.
+        std::shared_ptr<DepthTarget> Acquire(ID3D11Device* device, const D3D11_TEXTURE2D_DESC& desc, DXGI_FORMAT viewFormat);
+
+        // Returns the depth target for reuse. Only the most recently released targets are kept.
+        void Release(std::shared_ptr<DepthTarget> target);
+
+        void ReleaseDeviceDependentResources();
+
+    private:
+        static constexpr size_t MaxReleasedTargets = 4;
+
+        static bool Matches(const DepthTarget& target, const D3D11_TEXTURE2D_DESC& desc, DXGI_FORMAT viewFormat);
+
+        std::mutex m_mutex;
+
+        // Ordered from least to most recently released.
+        std::deque<std::shared_ptr<DepthTarget>> m_releasedTargets;
+    };
+} // namespace DXHelper
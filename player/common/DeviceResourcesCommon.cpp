@@ -167,6 +167,8 @@ namespace DXHelper
         {
             m_supportsVprt = true;
         }
+
+        m_gpuTimer.CreateDeviceDependentResources(m_d3dDevice.get());
     }
 
     void DeviceResourcesCommon::NotifyDeviceLost()
@@ -175,6 +177,8 @@ namespace DXHelper
         {
             m_deviceNotify->OnDeviceLost();
         }
+
+        m_gpuTimer.ReleaseDeviceDependentResources();
     }
 
     void DeviceResourcesCommon::NotifyDeviceRestored()
@@ -207,4 +211,21 @@ namespace DXHelper
             dxgiDevice->Trim();
         }
     }
+
+    void DeviceResourcesCommon::CreateBuffer(
+        MemoryAccounting::Tag tag, const D3D11_BUFFER_DESC& desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer) const
+    {
+        winrt::check_hresult(m_d3dDevice->CreateBuffer(&desc, initialData, buffer));
+        MemoryAccounting::TrackGpuResource(tag, *buffer);
+    }
+
+    void DeviceResourcesCommon::CreateTexture2D(
+        MemoryAccounting::Tag tag,
+        const D3D11_TEXTURE2D_DESC& desc,
+        const D3D11_SUBRESOURCE_DATA* initialData,
+        ID3D11Texture2D** texture) const
+    {
+        winrt::check_hresult(m_d3dDevice->CreateTexture2D(&desc, initialData, texture));
+        MemoryAccounting::TrackGpuResource(tag, *texture);
+    }
 } // namespace DXHelper
@@ -11,6 +11,9 @@
 
 #pragma once
 
+#include "GpuTimer.h"
+#include "MemoryAccounting.h"
+
 #include <d3d11.h>
 
 #include <winrt/base.h>
@@ -51,6 +54,19 @@ namespace DXHelper
         {
             return m_d3dDevice.get();
         }
+
+        // Create a buffer or a texture which is counted under the tag until it is destroyed, see MemoryAccounting. Resources created
+        // on a device taken from GetD3DDevice are counted with MemoryAccounting::TrackGpuResource instead.
+        void CreateBuffer(
+            MemoryAccounting::Tag tag,
+            const D3D11_BUFFER_DESC& desc,
+            const D3D11_SUBRESOURCE_DATA* initialData,
+            ID3D11Buffer** buffer) const;
+        void CreateTexture2D(
+            MemoryAccounting::Tag tag,
+            const D3D11_TEXTURE2D_DESC& desc,
+            const D3D11_SUBRESOURCE_DATA* initialData,
+            ID3D11Texture2D** texture) const;
         template <typename F>
         auto UseD3DDeviceContext(F func) const
         {
@@ -66,6 +82,12 @@ namespace DXHelper
             return m_supportsVprt;
         }
 
+        // Measures the GPU time of frames and sections of them. Only use it from within UseD3DDeviceContext.
+        GpuTimer& GetGpuTimer()
+        {
+            return m_gpuTimer;
+        }
+
         // DXGI acessors.
         IDXGIAdapter3* GetDXGIAdapter() const
         {
@@ -100,6 +122,8 @@ namespace DXHelper
         winrt::com_ptr<ID3D11DeviceContext3> m_d3dContext;
         winrt::com_ptr<IDXGIAdapter3> m_dxgiAdapter;
 
+        GpuTimer m_gpuTimer;
+
         // Direct2D factories.
         winrt::com_ptr<ID2D1Factory2> m_d2dFactory;
         winrt::com_ptr<IDWriteFactory2> m_dwriteFactory;
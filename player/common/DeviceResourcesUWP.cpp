@@ -162,6 +162,7 @@ void DeviceResourcesUWP::HandleDeviceLost()
             pCameraResources->ReleaseResourcesForBackBuffer(this);
         }
     });
+    m_depthTargetPool.ReleaseDeviceDependentResources();
 
     InitializeUsingHolographicSpace();
 
@@ -191,6 +192,7 @@ void DeviceResourcesUWP::Present(HolographicFrame frame)
         switch (WaitForNextFrameReady())
         {
             case WaitResult::Success:
+                m_nextPresentMustWait = false;
                 break;
             case WaitResult::Failure:
                 return; // We failed to wait for the next frame ready. Do not present.
@@ -213,8 +215,12 @@ void DeviceResourcesUWP::Present(HolographicFrame frame)
     if (presentResult != HolographicFramePresentResult::Success)
     {
         m_nextPresentMustWait = true;
+        m_headStartController.Reset();
         HandleDeviceLost();
+        return;
     }
+
+    m_headStartController.OnFramePresented(frame.Duration());
 }
 
 void DXHelper::DeviceResourcesUWP::OnIsAvailableChanged(
@@ -237,7 +243,8 @@ DXHelper::DeviceResourcesUWP::WaitResult DXHelper::DeviceResourcesUWP::WaitForNe
     try
     {
         // WaitForNextFrameReadyWithHeadStart has been added in 10.0.17763.0.
-        m_holographicSpace.WaitForNextFrameReadyWithHeadStart(winrt::Windows::Foundation::TimeSpan(0));
+        m_holographicSpace.WaitForNextFrameReadyWithHeadStart(m_headStartController.GetHeadStart());
+        m_headStartController.OnFrameReady();
         return WaitResult::Success;
     }
     catch (winrt::hresult_error& err)
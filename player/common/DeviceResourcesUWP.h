@@ -1,6 +1,8 @@
 #pragma once
 
+#include "DepthTargetPool.h"
 #include "DeviceResourcesCommon.h"
+#include "HeadStartController.h"
 
 #include <winrt/Windows.Graphics.Holographic.h>
 
@@ -48,6 +50,18 @@ namespace DXHelper
             return m_d3dInteropDevice;
         }
 
+        // Chooses the head start of WaitForNextFrameReady. Must only be used by the thread presenting the frames.
+        HeadStartController& GetHeadStartController()
+        {
+            return m_headStartController;
+        }
+
+        // Depth targets released by the cameras, shared by all of them. May be used from any thread.
+        DepthTargetPool& GetDepthTargetPool()
+        {
+            return m_depthTargetPool;
+        }
+
     protected:
         virtual void CreateDeviceResources() override;
 
@@ -76,6 +90,10 @@ namespace DXHelper
         bool m_nextPresentMustWait = false;
         bool m_firstFramePresented = false;
 
+        HeadStartController m_headStartController;
+
+        DepthTargetPool m_depthTargetPool;
+
         // Back buffer resources, etc. for attached holographic cameras.
         std::map<UINT32, std::unique_ptr<CameraResources>> m_cameraResources;
         std::mutex m_cameraResourcesLock;
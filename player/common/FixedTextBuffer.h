@@ -0,0 +1,76 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <string_view>
+
+// Fixed capacity text buffer which formats text and numbers without allocating.
+// Text which does not fit into the buffer anymore is truncated.
+template <size_t Capacity>
+class FixedTextBuffer
+{
+public:
+    void Clear()
+    {
+        m_length = 0;
+    }
+
+    FixedTextBuffer& Append(std::wstring_view text)
+    {
+        for (wchar_t character : text)
+        {
+            if (m_length == Capacity)
+            {
+                break;
+            }
+            m_buffer[m_length++] = character;
+        }
+        return *this;
+    }
+
+    FixedTextBuffer& Append(uint32_t value)
+    {
+        return AppendNumber(value);
+    }
+
+    // Appends the value in fixed point notation with the given number of decimal places.
+    FixedTextBuffer& Append(float value, int precision)
+    {
+        return AppendNumber(value, std::chars_format::fixed, precision);
+    }
+
+    std::wstring_view View() const
+    {
+        return {m_buffer.data(), m_length};
+    }
+
+private:
+    template <typename... Args>
+    FixedTextBuffer& AppendNumber(Args... args)
+    {
+        char digits[32];
+        const std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), args...);
+        if (result.ec == std::errc())
+        {
+            for (const char* digit = digits; digit != result.ptr && m_length < Capacity; ++digit)
+            {
+                m_buffer[m_length++] = static_cast<wchar_t>(*digit);
+            }
+        }
+        return *this;
+    }
+
+    std::array<wchar_t, Capacity> m_buffer;
+    size_t m_length = 0;
+};
@@ -0,0 +1,162 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+#include "GpuTimer.h"
+
+namespace
+{
+    // Returns S_FALSE if the data is not available yet. Never flushes, the queries are submitted with the frame anyway.
+    template <typename T>
+    HRESULT GetQueryData(ID3D11DeviceContext* context, ID3D11Query* query, T& data)
+    {
+        return context->GetData(query, &data, sizeof(data), D3D11_ASYNC_GETDATA_DONOTFLUSH);
+    }
+
+    float TicksToMilliseconds(UINT64 begin, UINT64 end, UINT64 frequency)
+    {
+        return end > begin ? static_cast<float>(static_cast<double>(end - begin) * 1000.0 / static_cast<double>(frequency)) : 0.0f;
+    }
+} // namespace
+
+namespace DXHelper
+{
+    void GpuTimer::CreateDeviceDependentResources(ID3D11Device* device)
+    {
+        const CD3D11_QUERY_DESC disjointDesc(D3D11_QUERY_TIMESTAMP_DISJOINT);
+        const CD3D11_QUERY_DESC timestampDesc(D3D11_QUERY_TIMESTAMP);
+
+        for (QuerySet& querySet : m_querySets)
+        {
+            winrt::check_hresult(device->CreateQuery(&disjointDesc, querySet.disjoint.put()));
+            winrt::check_hresult(device->CreateQuery(&timestampDesc, querySet.frameBegin.put()));
+            winrt::check_hresult(device->CreateQuery(&timestampDesc, querySet.frameEnd.put()));
+            for (size_t section = 0; section < MaxSectionCount; ++section)
+            {
+                winrt::check_hresult(device->CreateQuery(&timestampDesc, querySet.sectionBegin[section].put()));
+                winrt::check_hresult(device->CreateQuery(&timestampDesc, querySet.sectionEnd[section].put()));
+            }
+            querySet.pending = false;
+        }
+
+        m_currentSet = 0;
+        m_measuring = false;
+    }
+
+    void GpuTimer::ReleaseDeviceDependentResources()
+    {
+        m_querySets = {};
+        m_measuring = false;
+    }
+
+    void GpuTimer::BeginFrame(ID3D11DeviceContext* context)
+    {
+        if (!m_querySets[0].disjoint)
+        {
+            return;
+        }
+
+        // Read back the pending query sets from the oldest to the newest, so the results always advance.
+        for (size_t i = 1; i <= QuerySetCount; ++i)
+        {
+            QuerySet& querySet = m_querySets[(m_currentSet + i) % QuerySetCount];
+            if (querySet.pending && !TryReadBack(context, querySet))
+            {
+                break;
+            }
+        }
+
+        QuerySet& querySet = m_querySets[m_currentSet];
+        m_measuring = !querySet.pending;
+        if (!m_measuring)
+        {
+            return;
+        }
+
+        querySet.sectionMeasured = {};
+        context->Begin(querySet.disjoint.get());
+        context->End(querySet.frameBegin.get());
+    }
+
+    void GpuTimer::EndFrame(ID3D11DeviceContext* context)
+    {
+        if (!m_measuring)
+        {
+            return;
+        }
+
+        QuerySet& querySet = m_querySets[m_currentSet];
+        context->End(querySet.frameEnd.get());
+        context->End(querySet.disjoint.get());
+        querySet.pending = true;
+
+        m_currentSet = (m_currentSet + 1) % QuerySetCount;
+        m_measuring = false;
+    }
+
+    void GpuTimer::BeginSection(ID3D11DeviceContext* context, size_t section)
+    {
+        if (m_measuring && section < MaxSectionCount)
+        {
+            context->End(m_querySets[m_currentSet].sectionBegin[section].get());
+        }
+    }
+
+    void GpuTimer::EndSection(ID3D11DeviceContext* context, size_t section)
+    {
+        if (m_measuring && section < MaxSectionCount)
+        {
+            QuerySet& querySet = m_querySets[m_currentSet];
+            context->End(querySet.sectionEnd[section].get());
+            querySet.sectionMeasured[section] = true;
+        }
+    }
+
+    bool GpuTimer::TryReadBack(ID3D11DeviceContext* context, QuerySet& querySet)
+    {
+        D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjointData;
+        UINT64 frameBegin = 0;
+        UINT64 frameEnd = 0;
+        if (GetQueryData(context, querySet.disjoint.get(), disjointData) != S_OK ||
+            GetQueryData(context, querySet.frameBegin.get(), frameBegin) != S_OK ||
+            GetQueryData(context, querySet.frameEnd.get(), frameEnd) != S_OK)
+        {
+            return false;
+        }
+
+        std::array<float, MaxSectionCount> sectionTimes = {};
+        for (size_t section = 0; section < MaxSectionCount; ++section)
+        {
+            if (querySet.sectionMeasured[section])
+            {
+                UINT64 sectionBegin = 0;
+                UINT64 sectionEnd = 0;
+                if (GetQueryData(context, querySet.sectionBegin[section].get(), sectionBegin) != S_OK ||
+                    GetQueryData(context, querySet.sectionEnd[section].get(), sectionEnd) != S_OK)
+                {
+                    return false;
+                }
+                sectionTimes[section] = TicksToMilliseconds(sectionBegin, sectionEnd, disjointData.Frequency);
+            }
+        }
+
+        querySet.pending = false;
+
+        // The timestamps are meaningless if the GPU clock changed during the frame, e.g. because of power management.
+        if (!disjointData.Disjoint)
+        {
+            m_frameTime = TicksToMilliseconds(frameBegin, frameEnd, disjointData.Frequency);
+            m_sectionTimes = sectionTimes;
+        }
+        return true;
+    }
+} // namespace DXHelper
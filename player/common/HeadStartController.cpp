@@ -0,0 +1,80 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+#include "HeadStartController.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace DXHelper
+{
+    void HeadStartController::OnFrameReady()
+    {
+        m_previousFrameReadyTime = m_frameReadyTime;
+        m_previousFrameReady = m_frameReady;
+        m_frameReadyTime = Clock::now();
+        m_frameReady = true;
+    }
+
+    void HeadStartController::OnFramePresented(winrt::Windows::Foundation::TimeSpan frameDuration)
+    {
+        if (!m_frameReady)
+        {
+            return;
+        }
+
+        const Seconds duration = std::chrono::duration_cast<Seconds>(frameDuration);
+        if (duration <= Seconds::zero())
+        {
+            return;
+        }
+
+        const Seconds work = std::chrono::duration_cast<Seconds>(Clock::now() - m_frameReadyTime);
+        m_workEstimate = std::max<>(work, m_workEstimate + (work - m_workEstimate) * 0.02f);
+
+        if (m_previousFrameReady)
+        {
+            const Seconds interval = std::chrono::duration_cast<Seconds>(m_frameReadyTime - m_previousFrameReadyTime);
+            // Longer gaps are pauses, e.g. while the app was not visible. The work and the misses before the pause do not say
+            // anything about the frames after it, so the estimate starts over from the current frame.
+            if (interval > duration * 4.0f)
+            {
+                m_workEstimate = work;
+                m_correction = Seconds::zero();
+            }
+            else if (interval > duration * 1.5f)
+            {
+                m_missedFrameCount++;
+                m_correction += CorrectionPerMissedFrame;
+            }
+            else
+            {
+                m_correction = std::max<>(m_correction - CorrectionDecayPerSecond * interval.count(), Seconds::zero());
+            }
+        }
+
+        const Seconds overrun = std::max<>(m_workEstimate - duration * WorkBudget, Seconds::zero());
+        m_headStart = std::clamp<>(overrun + m_correction, Seconds::zero(), duration * MaxHeadStart);
+    }
+
+    void HeadStartController::Reset()
+    {
+        m_frameReady = false;
+        m_previousFrameReady = false;
+    }
+
+    uint32_t HeadStartController::TakeMissedFrameCount()
+    {
+        return std::exchange(m_missedFrameCount, 0);
+    }
+} // namespace DXHelper
@@ -0,0 +1,74 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <chrono>
+
+#include <winrt/Windows.Foundation.h>
+
+namespace DXHelper
+{
+    // Chooses the head start passed to HolographicSpace::WaitForNextFrameReadyWithHeadStart. The later the wait returns, the more
+    // recent the remote frame which is blitted, so the head start is kept as small as the work after the wait allows.
+    // The work from the return of the wait to the present, i.e. the blit and the local rendering, is measured every frame. The head
+    // start covers the part of it which does not fit into the frame, plus a correction which grows with every missed frame and
+    // shrinks again while no frames are missed. A frame counts as missed if the next wait returns more than one and a half frame
+    // durations after the previous one. After a pause of more than four frame durations, the measurement starts over.
+    class HeadStartController
+    {
+    public:
+        // Called when the wait for the next frame returned.
+        void OnFrameReady();
+
+        // Called after the frame was presented, with the duration the system predicted for it.
+        void OnFramePresented(winrt::Windows::Foundation::TimeSpan frameDuration);
+
+        // Called if frames were not presented, e.g. while the holographic space was not available. The next interval is not
+        // counted as missed frame.
+        void Reset();
+
+        winrt::Windows::Foundation::TimeSpan GetHeadStart() const
+        {
+            return std::chrono::duration_cast<winrt::Windows::Foundation::TimeSpan>(m_headStart);
+        }
+
+        // Returns the number of frames missed since the previous call.
+        uint32_t TakeMissedFrameCount();
+
+    private:
+        using Clock = std::chrono::steady_clock;
+        using Seconds = std::chrono::duration<float>;
+
+        // Fraction of the frame duration which the work after the wait is allowed to take without head start.
+        static constexpr float WorkBudget = 0.8f;
+
+        // The head start never exceeds this fraction of the frame duration, which would just add a frame of latency.
+        static constexpr float MaxHeadStart = 0.5f;
+
+        // Added to the correction for every missed frame. While no frames are missed, the correction decays by the given amount
+        // per second.
+        static constexpr Seconds CorrectionPerMissedFrame{0.001f};
+        static constexpr Seconds CorrectionDecayPerSecond{0.0005f};
+
+        Clock::time_point m_frameReadyTime;
+        Clock::time_point m_previousFrameReadyTime;
+        bool m_frameReady = false;
+        bool m_previousFrameReady = false;
+
+        // Peak of the measured work, which follows increases immediately and decreases slowly.
+        Seconds m_workEstimate{0.0f};
+        Seconds m_correction{0.0f};
+        Seconds m_headStart{0.0f};
+
+        uint32_t m_missedFrameCount = 0;
+    };
+} // namespace DXHelper
@@ -19,66 +19,97 @@ using namespace winrt::Windows::Networking::Connectivity;
 IpAddressUpdater::IpAddressUpdater()
 {
     m_networkStatusChangedRevoker = winrt::Windows::Networking::Connectivity::NetworkInformation::NetworkStatusChanged(
-        winrt::auto_revoke, [this](winrt::Windows::Foundation::IInspectable sender) { UpdateIpAddress(sender); });
+        winrt::auto_revoke, [state = m_state](winrt::Windows::Foundation::IInspectable sender) { RequestUpdate(state); });
 
-    UpdateIpAddress(nullptr);
+    RequestUpdate(m_state);
 }
 
 IpAddressUpdater::~IpAddressUpdater() = default;
 
 winrt::hstring IpAddressUpdater::GetIpAddress(bool ipv6)
 {
-    std::lock_guard lockGuard(m_lock);
-    return ipv6 ? m_ipAddressIpv6 : m_ipAddressIpv4;
+    std::lock_guard lockGuard(m_state->lock);
+    return ipv6 ? m_state->ipAddressIpv6 : m_state->ipAddressIpv4;
 }
 
-void IpAddressUpdater::UpdateIpAddress(winrt::Windows::Foundation::IInspectable sender)
+void IpAddressUpdater::RequestUpdate(const std::shared_ptr<State>& state)
 {
-    winrt::hstring ipAddressIpv4 = L"";
-    winrt::hstring ipAddressIpv6 = L"";
+    {
+        std::lock_guard lockGuard(state->lock);
+        if (state->updateInFlight)
+        {
+            state->updatePending = true;
+            return;
+        }
+        state->updateInFlight = true;
+    }
+
+    UpdateIpAddressAsync(state);
+}
+
+winrt::fire_and_forget IpAddressUpdater::UpdateIpAddressAsync(std::shared_ptr<State> state)
+{
+    co_await winrt::resume_background();
 
-    try
+    while (true)
     {
-        winrt::Windows::Foundation::Collections::IVectorView<HostName> hostnames = NetworkInformation::GetHostNames();
+        winrt::hstring ipAddressIpv4 = L"";
+        winrt::hstring ipAddressIpv6 = L"";
 
-        for (winrt::Windows::Networking::HostName hostname : hostnames)
+        try
         {
-            auto hostNameType = hostname.Type();
-            if (hostNameType != HostNameType::Ipv4 && hostNameType != HostNameType::Ipv6)
-            {
-                continue;
-            }
+            winrt::Windows::Foundation::Collections::IVectorView<HostName> hostnames = NetworkInformation::GetHostNames();
 
-            if (hostname.IPInformation() && hostname.IPInformation().NetworkAdapter())
+            for (winrt::Windows::Networking::HostName hostname : hostnames)
             {
-                if (hostNameType == HostNameType::Ipv6 && ipAddressIpv6.empty())
+                auto hostNameType = hostname.Type();
+                if (hostNameType != HostNameType::Ipv4 && hostNameType != HostNameType::Ipv6)
                 {
-                    ipAddressIpv6 = hostname.CanonicalName();
+                    continue;
                 }
-                else if (hostNameType == HostNameType::Ipv4 && ipAddressIpv4.empty())
+
+                if (hostname.IPInformation() && hostname.IPInformation().NetworkAdapter())
                 {
-                    ipAddressIpv4 = hostname.CanonicalName();
+                    if (hostNameType == HostNameType::Ipv6 && ipAddressIpv6.empty())
+                    {
+                        ipAddressIpv6 = hostname.CanonicalName();
+                    }
+                    else if (hostNameType == HostNameType::Ipv4 && ipAddressIpv4.empty())
+                    {
+                        ipAddressIpv4 = hostname.CanonicalName();
+                    }
                 }
             }
         }
-    }
-    catch (winrt::hresult_error&)
-    {
-        ipAddressIpv4.clear();
-        ipAddressIpv6.clear();
-    }
+        catch (winrt::hresult_error&)
+        {
+            ipAddressIpv4.clear();
+            ipAddressIpv6.clear();
+        }
 
-    if (ipAddressIpv6.empty())
-    {
-        ipAddressIpv6 = L"(No Network Connection)";
-    }
+        if (ipAddressIpv6.empty())
+        {
+            ipAddressIpv6 = L"(No Network Connection)";
+        }
 
-    if (ipAddressIpv4.empty())
-    {
-        ipAddressIpv4 = L"(No Network Connection)";
-    }
+        if (ipAddressIpv4.empty())
+        {
+            ipAddressIpv4 = L"(No Network Connection)";
+        }
 
-    std::lock_guard lockGuard(m_lock);
-    m_ipAddressIpv6 = ipAddressIpv6;
-    m_ipAddressIpv4 = ipAddressIpv4;
-};
+        std::lock_guard lockGuard(state->lock);
+        if (state->ipAddressIpv6 != ipAddressIpv6 || state->ipAddressIpv4 != ipAddressIpv4)
+        {
+            state->ipAddressIpv6 = ipAddressIpv6;
+            state->ipAddressIpv4 = ipAddressIpv4;
+            state->generation.fetch_add(1, std::memory_order_release);
+        }
+
+        if (!state->updatePending)
+        {
+            state->updateInFlight = false;
+            co_return;
+        }
+        state->updatePending = false;
+    }
+}
@@ -13,6 +13,11 @@
 
 #include <winrt/Windows.Networking.Connectivity.h>
 
+#include <atomic>
+#include <memory>
+
+// Provides the IP addresses of the device. The host names are enumerated on a thread pool thread when the updater is created and
+// whenever the network status changes, so neither blocks the caller.
 class IpAddressUpdater
 {
 public:
@@ -21,13 +26,32 @@ public:
 
     winrt::hstring GetIpAddress(bool ipv6);
 
+    // Incremented whenever one of the addresses changes. Cheap enough to be polled every frame, GetIpAddress only needs to be
+    // called again when it changed.
+    uint64_t GetGeneration() const
+    {
+        return m_state->generation.load(std::memory_order_acquire);
+    }
+
 private:
-    void UpdateIpAddress(winrt::Windows::Foundation::IInspectable sender);
+    // Shared with the enumerations in flight, which may outlive the updater.
+    struct State
+    {
+        std::mutex lock;
+        winrt::hstring ipAddressIpv6;
+        winrt::hstring ipAddressIpv4;
+        std::atomic<uint64_t> generation = 0;
+
+        // Network status changes during an enumeration are coalesced into one more enumeration.
+        bool updateInFlight = false;
+        bool updatePending = false;
+    };
+
+    static void RequestUpdate(const std::shared_ptr<State>& state);
+    static winrt::fire_and_forget UpdateIpAddressAsync(std::shared_ptr<State> state);
 
 private:
-    std::mutex m_lock;
-    winrt::hstring m_ipAddressIpv6;
-    winrt::hstring m_ipAddressIpv4;
+    std::shared_ptr<State> m_state = std::make_shared<State>();
 
     winrt::Windows::Networking::Connectivity::NetworkInformation::NetworkStatusChanged_revoker m_networkStatusChangedRevoker;
 };
@@ -13,72 +13,90 @@
 
 #include "PlayerFrameStatisticsHelper.h"
 
-#include <sstream>
+#include <cmath>
 
 using namespace winrt::Microsoft::Holographic::AppRemoting;
 
-std::wstring PlayerFrameStatisticsHelper::GetStatisticsString() const
+std::wstring_view PlayerFrameStatisticsHelper::GetStatisticsLabels()
 {
+    return L"Render (fps)\n"
+           L"Render interval (ms, avg/max)\n"
+           L"Render interval (ms, p50/p95/p99)\n"
+           L"Video frames (skipped/reused/received)\n"
+           L"Video frames delta (ms, min/max)\n"
+           L"Latency (ms, avg)\n"
+           L"Latency (ms, p50/p95/p99)\n"
+           L"Video frames discarded (last sec/total)\n"
+           L"GPU (ms, blit/status avg)\n"
+           L"Head start (ms, avg) / missed frames";
+}
+
+std::wstring_view PlayerFrameStatisticsHelper::FormatStatisticsValues(StatisticsText& text) const
+{
+    const WindowAccumulator& window = m_lastWindow;
+
     float timeSinceLastPresentAvg = 0.0f;
-    float timeSinceLastPresentMax = 0.0f;
-    uint32_t videoFramesSkipped = 0;
-    uint32_t videoFramesReused = 0;
-    uint32_t videoFramesReceived = 0;
-    float videoFrameMinDelta = 0.0f;
-    float videoFrameMaxDelta = 0.0f;
     float latencyAvg = 0.0f;
-    uint32_t videoFramesDiscarded = 0;
-
-    for (const PlayerFrameStatistics& frameStatistics : m_lastWindowFrameStats)
+    float gpuBlitTimeAvg = 0.0f;
+    float gpuStatusDisplayTimeAvg = 0.0f;
+    float headStartAvg = 0.0f;
+    if (window.framesPresented > 0)
     {
-        timeSinceLastPresentAvg += frameStatistics.TimeSinceLastPresent;
-        timeSinceLastPresentMax = std::max<>(timeSinceLastPresentMax, frameStatistics.TimeSinceLastPresent);
-
-        videoFramesSkipped += frameStatistics.VideoFramesSkipped;
-        videoFramesReused += frameStatistics.VideoFrameReusedCount > 0 ? 1 : 0;
-        videoFramesReceived += frameStatistics.VideoFramesReceived;
+        timeSinceLastPresentAvg = window.timeSinceLastPresentSum / static_cast<float>(window.framesPresented);
+        latencyAvg = window.latencySum / static_cast<float>(window.framesPresented);
+        gpuBlitTimeAvg = window.gpuBlitTimeSum / static_cast<float>(window.framesPresented);
+        gpuStatusDisplayTimeAvg = window.gpuStatusDisplayTimeSum / static_cast<float>(window.framesPresented);
+        headStartAvg = window.headStartSum / static_cast<float>(window.framesPresented);
+    }
 
-        if (frameStatistics.VideoFramesReceived > 0)
-        {
-            if (videoFrameMinDelta == 0.0f)
-            {
-                videoFrameMinDelta = frameStatistics.VideoFrameMinDelta;
-                videoFrameMaxDelta = frameStatistics.VideoFrameMaxDelta;
-            }
-            else
-            {
-                videoFrameMinDelta = std::min<>(videoFrameMinDelta, frameStatistics.VideoFrameMinDelta);
-                videoFrameMaxDelta = std::max<>(videoFrameMaxDelta, frameStatistics.VideoFrameMaxDelta);
-            }
-        }
+    auto appendPercentiles = [&text](const DurationHistogram& histogram) {
+        text.Append(histogram.GetPercentile(0.50f) * 1000, 1)
+            .Append(L" / ")
+            .Append(histogram.GetPercentile(0.95f) * 1000, 1)
+            .Append(L" / ")
+            .Append(histogram.GetPercentile(0.99f) * 1000, 1);
+    };
+
+    text.Clear();
+    text.Append(window.framesPresented).Append(L"\n");
+    text.Append(timeSinceLastPresentAvg * 1000, 1).Append(L" / ").Append(window.timeSinceLastPresentMax * 1000, 1).Append(L"\n");
+    appendPercentiles(window.timeSinceLastPresentHistogram);
+    text.Append(L"\n");
+    text.Append(window.videoFramesSkipped)
+        .Append(L" / ")
+        .Append(window.videoFramesReused)
+        .Append(L" / ")
+        .Append(window.videoFramesReceived)
+        .Append(L"\n");
+    text.Append(window.videoFrameMinDelta * 1000, 1).Append(L" / ").Append(window.videoFrameMaxDelta * 1000, 1).Append(L"\n");
+    text.Append(latencyAvg * 1000, 1).Append(L"\n");
+    appendPercentiles(window.latencyHistogram);
+    text.Append(L"\n");
+    text.Append(window.videoFramesDiscarded).Append(L" / ").Append(m_videoFramesDiscardedTotal).Append(L"\n");
+    text.Append(gpuBlitTimeAvg * 1000, 2).Append(L" / ").Append(gpuStatusDisplayTimeAvg * 1000, 2).Append(L"\n");
+    text.Append(headStartAvg * 1000, 2).Append(L" / ").Append(window.framesMissed);
+
+    return text.View();
+}
 
-        latencyAvg += frameStatistics.Latency;
-        videoFramesDiscarded += frameStatistics.VideoFramesDiscarded;
-    }
+PlayerFrameStatisticsHelper::WindowStatistics PlayerFrameStatisticsHelper::GetLastWindowStatistics() const
+{
+    WindowStatistics windowStatistics;
+    windowStatistics.framesPresented = m_lastWindow.framesPresented;
+    windowStatistics.videoFramesReceived = m_lastWindow.videoFramesReceived;
+    windowStatistics.videoFramesSkipped = m_lastWindow.videoFramesSkipped;
+    windowStatistics.videoFramesDiscarded = m_lastWindow.videoFramesDiscarded;
 
-    const size_t frameStatsCount = m_lastWindowFrameStats.size();
-    if (frameStatsCount > 0)
+    if (m_lastWindow.framesPresented > 0)
     {
-        timeSinceLastPresentAvg /= static_cast<float>(frameStatsCount);
-        latencyAvg /= static_cast<float>(frameStatsCount);
+        windowStatistics.latencyAvg = m_lastWindow.latencySum / static_cast<float>(m_lastWindow.framesPresented);
     }
 
-    std::wstringstream statisticsStringStream;
-    statisticsStringStream.precision(3);
-    statisticsStringStream << L"Render: " << frameStatsCount << L" fps - " << timeSinceLastPresentAvg * 1000 << L" / "
-                           << timeSinceLastPresentMax * 1000 << L" ms (avg/max)" << std::endl
-                           << L"Video frames: " << videoFramesSkipped << L" / " << videoFramesReused << L" / " << videoFramesReceived
-                           << L" skipped/reused/received" << std::endl
-                           << L"Video frames delta: " << videoFrameMinDelta * 1000 << L" / " << videoFrameMaxDelta * 1000
-                           << L" ms (min/max)" << std::endl
-                           << L"Latency: " << latencyAvg * 1000 << L" ms (avg)" << std::endl
-                           << L"Video frames discarded: " << videoFramesDiscarded << L" / " << m_videoFramesDiscardedTotal
-                           << L" frames (last sec/total)" << std::endl;
-
-    return statisticsStringStream.str();
+    return windowStatistics;
 }
 
-void PlayerFrameStatisticsHelper::Update(const PlayerFrameStatistics& frameStatistics)
+void PlayerFrameStatisticsHelper::Update(
+    const PlayerFrameStatistics& frameStatistics, const PlayerFrameStatisticsTrace::GpuTimes& gpuTimes, const FramePacing& framePacing)
 {
     using namespace std::chrono;
 
@@ -89,8 +107,8 @@ void PlayerFrameStatisticsHelper::Update(const PlayerFrameStatistics& frameStati
     {
         m_statsHasChanged = true;
 
-        m_lastWindowFrameStats.swap(m_currWindowFrameStats);
-        m_currWindowFrameStats.clear();
+        std::swap(m_lastWindow, m_currWindow);
+        m_currWindow.Clear();
 
         do
         {
@@ -98,11 +116,116 @@ void PlayerFrameStatisticsHelper::Update(const PlayerFrameStatistics& frameStati
         } while (now > m_currWindowStartTime + 1s);
     }
 
-    m_currWindowFrameStats.push_back(frameStatistics);
+    m_currWindow.Add(frameStatistics, gpuTimes, framePacing);
+    m_trace.Push(frameStatistics, gpuTimes);
     m_videoFramesDiscardedTotal += frameStatistics.VideoFramesDiscarded;
+
+    m_recentFrames[m_recentFramesWritten++ % RecentFrameCount] = {
+        frameStatistics.Latency,
+        frameStatistics.TimeSinceLastPresent,
+        frameStatistics.VideoFramesSkipped,
+        frameStatistics.VideoFramesDiscarded};
 }
 
 bool PlayerFrameStatisticsHelper::StatisticsHaveChanged()
 {
     return m_statsHasChanged;
 }
+
+void PlayerFrameStatisticsHelper::DurationHistogram::Add(float duration)
+{
+    const float bucket = std::max<>(duration, 0.0f) / BucketWidth;
+    const size_t bucketIndex = bucket < static_cast<float>(BucketCount - 1) ? static_cast<size_t>(bucket) : BucketCount - 1;
+
+    m_buckets[bucketIndex]++;
+    m_count++;
+    m_max = std::max<>(m_max, duration);
+}
+
+void PlayerFrameStatisticsHelper::DurationHistogram::Clear()
+{
+    m_buckets.fill(0);
+    m_count = 0;
+    m_max = 0.0f;
+}
+
+float PlayerFrameStatisticsHelper::DurationHistogram::GetPercentile(float percentile) const
+{
+    if (m_count == 0)
+    {
+        return 0.0f;
+    }
+
+    const uint32_t rank = std::max<>(static_cast<uint32_t>(std::ceil(percentile * static_cast<float>(m_count))), 1u);
+
+    uint32_t count = 0;
+    for (size_t bucketIndex = 0; bucketIndex < BucketCount; ++bucketIndex)
+    {
+        count += m_buckets[bucketIndex];
+        if (count >= rank)
+        {
+            return std::min<>(static_cast<float>(bucketIndex + 1) * BucketWidth, m_max);
+        }
+    }
+
+    return m_max;
+}
+
+void PlayerFrameStatisticsHelper::WindowAccumulator::Add(
+    const PlayerFrameStatistics& frameStatistics, const PlayerFrameStatisticsTrace::GpuTimes& gpuTimes, const FramePacing& framePacing)
+{
+    framesPresented++;
+
+    timeSinceLastPresentSum += frameStatistics.TimeSinceLastPresent;
+    timeSinceLastPresentMax = std::max<>(timeSinceLastPresentMax, frameStatistics.TimeSinceLastPresent);
+
+    videoFramesSkipped += frameStatistics.VideoFramesSkipped;
+    videoFramesReused += frameStatistics.VideoFrameReusedCount > 0 ? 1 : 0;
+    videoFramesReceived += frameStatistics.VideoFramesReceived;
+
+    if (frameStatistics.VideoFramesReceived > 0)
+    {
+        if (videoFrameMinDelta == 0.0f)
+        {
+            videoFrameMinDelta = frameStatistics.VideoFrameMinDelta;
+            videoFrameMaxDelta = frameStatistics.VideoFrameMaxDelta;
+        }
+        else
+        {
+            videoFrameMinDelta = std::min<>(videoFrameMinDelta, frameStatistics.VideoFrameMinDelta);
+            videoFrameMaxDelta = std::max<>(videoFrameMaxDelta, frameStatistics.VideoFrameMaxDelta);
+        }
+    }
+
+    latencySum += frameStatistics.Latency;
+    videoFramesDiscarded += frameStatistics.VideoFramesDiscarded;
+
+    latencyHistogram.Add(frameStatistics.Latency);
+    timeSinceLastPresentHistogram.Add(frameStatistics.TimeSinceLastPresent);
+
+    gpuBlitTimeSum += gpuTimes.blit;
+    gpuStatusDisplayTimeSum += gpuTimes.statusDisplay;
+    headStartSum += framePacing.headStart;
+    framesMissed += framePacing.framesMissed;
+}
+
+void PlayerFrameStatisticsHelper::WindowAccumulator::Clear()
+{
+    framesPresented = 0;
+    timeSinceLastPresentSum = 0.0f;
+    timeSinceLastPresentMax = 0.0f;
+    videoFramesSkipped = 0;
+    videoFramesReused = 0;
+    videoFramesReceived = 0;
+    videoFrameMinDelta = 0.0f;
+    videoFrameMaxDelta = 0.0f;
+    latencySum = 0.0f;
+    videoFramesDiscarded = 0;
+    gpuBlitTimeSum = 0.0f;
+    gpuStatusDisplayTimeSum = 0.0f;
+    headStartSum = 0.0f;
+    framesMissed = 0;
+
+    latencyHistogram.Clear();
+    timeSinceLastPresentHistogram.Clear();
+}
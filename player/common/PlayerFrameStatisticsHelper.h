@@ -11,32 +11,148 @@
 
 #pragma once
 
+#include "FixedTextBuffer.h"
+#include "PlayerFrameStatisticsTrace.h"
+
+#include <algorithm>
+#include <array>
 #include <string>
-#include <vector>
 
 #include <winrt/Microsoft.Holographic.AppRemoting.h>
 
-// Helper class for PlayerFrameStatistics. Accumulates frame statistics in a 1 second long fixed window and formats it into a readable
-// string.
+// Helper class for PlayerFrameStatistics. Accumulates frame statistics in a 1 second long fixed window and formats it into readable
+// text.
 class PlayerFrameStatisticsHelper
 {
 public:
-    // Returns the accumulated statistics of the last 1s fixed window as string.
-    std::wstring GetStatisticsString() const;
+    // Statistics accumulated over the last 1s fixed window.
+    struct WindowStatistics
+    {
+        uint32_t framesPresented = 0;
+        uint32_t videoFramesReceived = 0;
+        uint32_t videoFramesSkipped = 0;
+        uint32_t videoFramesDiscarded = 0;
+        float latencyAvg = 0.0f;
+    };
+
+    // Returns the accumulated statistics of the last 1s fixed window.
+    WindowStatistics GetLastWindowStatistics() const;
+
+    // How the player paced the frame, see DXHelper::HeadStartController.
+    struct FramePacing
+    {
+        float headStart = 0.0f;
+        uint32_t framesMissed = 0;
+    };
+
+    using StatisticsText = FixedTextBuffer<512>;
+
+    // Returns the labels of the values formatted by FormatStatisticsValues, one label per line.
+    static std::wstring_view GetStatisticsLabels();
 
-    // Updates the statistics with the provided statistics data.
-    void Update(const winrt::Microsoft::Holographic::AppRemoting::PlayerFrameStatistics& frameStatistics);
+    // Formats the accumulated statistics of the last 1s fixed window into text without allocating.
+    // Every line of the text contains the values for the corresponding line of GetStatisticsLabels.
+    std::wstring_view FormatStatisticsValues(StatisticsText& text) const;
+
+    // Updates the statistics with the provided statistics data, the GPU times of the player's own rendering and its frame pacing.
+    void Update(
+        const winrt::Microsoft::Holographic::AppRemoting::PlayerFrameStatistics& frameStatistics,
+        const PlayerFrameStatisticsTrace::GpuTimes& gpuTimes,
+        const FramePacing& framePacing);
 
     bool StatisticsHaveChanged();
 
+    // Values of a single frame, kept for the recent frames so that single frame hitches can be shown.
+    struct RecentFrame
+    {
+        float latency = 0.0f;
+        float timeSinceLastPresent = 0.0f;
+        uint32_t videoFramesSkipped = 0;
+        uint32_t videoFramesDiscarded = 0;
+    };
+
+    // Number of recent frames which are kept, 4 seconds at 60 frames per second.
+    static constexpr size_t RecentFrameCount = 240;
+
+    // Number of recent frames available, at most RecentFrameCount.
+    size_t GetRecentFrameCount() const
+    {
+        return static_cast<size_t>(std::min<uint64_t>(m_recentFramesWritten, RecentFrameCount));
+    }
+
+    // Returns a recent frame by its age, age 0 is the frame last passed to Update.
+    const RecentFrame& GetRecentFrame(size_t age) const
+    {
+        return m_recentFrames[(m_recentFramesWritten - 1 - age) % RecentFrameCount];
+    }
+
+    // Raw statistics of every frame passed to Update.
+    PlayerFrameStatisticsTrace& GetTrace()
+    {
+        return m_trace;
+    }
+
 private:
     using Clock = std::chrono::high_resolution_clock;
     using TimePoint = Clock::time_point;
     using Duration = Clock::duration;
 
+    // Fixed-bucket histogram of durations in seconds. Values beyond the covered range are counted in the last bucket.
+    class DurationHistogram
+    {
+    public:
+        static constexpr float BucketWidth = 0.0005f;
+        static constexpr size_t BucketCount = 512;
+
+        void Add(float duration);
+        void Clear();
+
+        // Returns the upper bound of the bucket containing the given percentile (0..1), clamped to the largest added duration.
+        float GetPercentile(float percentile) const;
+
+    private:
+        std::array<uint32_t, BucketCount> m_buckets = {};
+        uint32_t m_count = 0;
+        float m_max = 0.0f;
+    };
+
+    // Aggregated statistics of one fixed window. Updated in constant time per frame and never allocates.
+    struct WindowAccumulator
+    {
+        uint32_t framesPresented = 0;
+        float timeSinceLastPresentSum = 0.0f;
+        float timeSinceLastPresentMax = 0.0f;
+        uint32_t videoFramesSkipped = 0;
+        uint32_t videoFramesReused = 0;
+        uint32_t videoFramesReceived = 0;
+        float videoFrameMinDelta = 0.0f;
+        float videoFrameMaxDelta = 0.0f;
+        float latencySum = 0.0f;
+        uint32_t videoFramesDiscarded = 0;
+        float gpuBlitTimeSum = 0.0f;
+        float gpuStatusDisplayTimeSum = 0.0f;
+        float headStartSum = 0.0f;
+        uint32_t framesMissed = 0;
+
+        DurationHistogram latencyHistogram;
+        DurationHistogram timeSinceLastPresentHistogram;
+
+        void Add(
+            const winrt::Microsoft::Holographic::AppRemoting::PlayerFrameStatistics& frameStatistics,
+            const PlayerFrameStatisticsTrace::GpuTimes& gpuTimes,
+            const FramePacing& framePacing);
+        void Clear();
+    };
+
     TimePoint m_currWindowStartTime = Clock::now();
-    std::vector<winrt::Microsoft::Holographic::AppRemoting::PlayerFrameStatistics> m_currWindowFrameStats;
-    std::vector<winrt::Microsoft::Holographic::AppRemoting::PlayerFrameStatistics> m_lastWindowFrameStats;
+    WindowAccumulator m_currWindow;
+    WindowAccumulator m_lastWindow;
     uint32_t m_videoFramesDiscardedTotal = 0;
     bool m_statsHasChanged = true;
+
+    // Ring buffer of the recent frames, the slot of a frame is the number of frames written before it modulo RecentFrameCount.
+    std::array<RecentFrame, RecentFrameCount> m_recentFrames = {};
+    uint64_t m_recentFramesWritten = 0;
+
+    PlayerFrameStatisticsTrace m_trace;
 };
@@ -0,0 +1,180 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+#include "PlayerFrameStatisticsTrace.h"
+
+#include <algorithm>
+#include <cstdio>
+
+using namespace winrt::Microsoft::Holographic::AppRemoting;
+
+namespace
+{
+    // Number of records the export thread writes at once.
+    constexpr size_t ExportBatchSize = 256;
+} // namespace
+
+PlayerFrameStatisticsTrace::PlayerFrameStatisticsTrace()
+    : m_records(std::make_unique<Record[]>(Capacity))
+{
+}
+
+PlayerFrameStatisticsTrace::~PlayerFrameStatisticsTrace()
+{
+    StopExport();
+}
+
+void PlayerFrameStatisticsTrace::Push(const PlayerFrameStatistics& frameStatistics, const GpuTimes& gpuTimes)
+{
+    const uint64_t writeCount = m_writeCount.load(std::memory_order_relaxed);
+    if (writeCount - m_readCount.load(std::memory_order_acquire) >= Capacity)
+    {
+        m_droppedRecordCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    Record& record = m_records[writeCount % Capacity];
+    record.timestampUs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - m_startTime).count();
+    record.latency = frameStatistics.Latency;
+    record.timeSinceLastPresent = frameStatistics.TimeSinceLastPresent;
+    record.videoFrameMinDelta = frameStatistics.VideoFrameMinDelta;
+    record.videoFrameMaxDelta = frameStatistics.VideoFrameMaxDelta;
+    record.videoFramesSkipped = frameStatistics.VideoFramesSkipped;
+    record.videoFrameReusedCount = frameStatistics.VideoFrameReusedCount;
+    record.videoFramesDiscarded = frameStatistics.VideoFramesDiscarded;
+    record.videoFramesReceived = frameStatistics.VideoFramesReceived;
+    record.gpuBlitTime = gpuTimes.blit;
+    record.gpuStatusDisplayTime = gpuTimes.statusDisplay;
+
+    // Publish the record to the consumer.
+    m_writeCount.store(writeCount + 1, std::memory_order_release);
+}
+
+size_t PlayerFrameStatisticsTrace::Pop(Record* records, size_t maxRecords)
+{
+    const uint64_t readCount = m_readCount.load(std::memory_order_relaxed);
+    const uint64_t available = m_writeCount.load(std::memory_order_acquire) - readCount;
+    const size_t count = static_cast<size_t>(std::min<uint64_t>(available, maxRecords));
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        records[i] = m_records[(readCount + i) % Capacity];
+    }
+
+    // Hand the slots back to the producer.
+    m_readCount.store(readCount + count, std::memory_order_release);
+    return count;
+}
+
+uint64_t PlayerFrameStatisticsTrace::GetDroppedRecordCount() const
+{
+    return m_droppedRecordCount.load(std::memory_order_relaxed);
+}
+
+void PlayerFrameStatisticsTrace::StartExport(const std::wstring& fileName, ExportFormat format)
+{
+    StopExport();
+
+    FILE* file = nullptr;
+    if (_wfopen_s(&file, fileName.c_str(), format == ExportFormat::Csv ? L"w" : L"wb") != 0 || file == nullptr)
+    {
+        return;
+    }
+
+    // Only export records of frames from now on.
+    Record discarded[ExportBatchSize];
+    while (Pop(discarded, ExportBatchSize) > 0)
+    {
+    }
+
+    m_stopExport = false;
+    m_exportThread = std::thread(&PlayerFrameStatisticsTrace::ExportThread, this, file, format);
+}
+
+void PlayerFrameStatisticsTrace::StopExport()
+{
+    if (m_exportThread.joinable())
+    {
+        m_stopExport = true;
+        m_exportThread.join();
+    }
+}
+
+bool PlayerFrameStatisticsTrace::IsExporting() const
+{
+    return m_exportThread.joinable();
+}
+
+void PlayerFrameStatisticsTrace::ExportThread(FILE* file, ExportFormat format)
+{
+    using namespace std::chrono_literals;
+
+    if (format == ExportFormat::Csv)
+    {
+        fputs(
+            "timestampUs,latency,timeSinceLastPresent,videoFrameMinDelta,videoFrameMaxDelta,"
+            "videoFramesSkipped,videoFrameReusedCount,videoFramesDiscarded,videoFramesReceived,"
+            "gpuBlitTime,gpuStatusDisplayTime\n",
+            file);
+    }
+    else
+    {
+        const FileHeader header;
+        fwrite(&header, sizeof(header), 1, file);
+    }
+
+    Record records[ExportBatchSize];
+    bool stopping = false;
+    while (!stopping)
+    {
+        // Check the stop flag before draining, so the records pushed before StopExport are written as well.
+        stopping = m_stopExport;
+
+        size_t count;
+        while ((count = Pop(records, ExportBatchSize)) > 0)
+        {
+            if (format == ExportFormat::Csv)
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const Record& record = records[i];
+                    fprintf(
+                        file,
+                        "%llu,%.6f,%.6f,%.6f,%.6f,%u,%u,%u,%u,%.6f,%.6f\n",
+                        record.timestampUs,
+                        record.latency,
+                        record.timeSinceLastPresent,
+                        record.videoFrameMinDelta,
+                        record.videoFrameMaxDelta,
+                        record.videoFramesSkipped,
+                        record.videoFrameReusedCount,
+                        record.videoFramesDiscarded,
+                        record.videoFramesReceived,
+                        record.gpuBlitTime,
+                        record.gpuStatusDisplayTime);
+                }
+            }
+            else
+            {
+                fwrite(records, sizeof(Record), count, file);
+            }
+        }
+
+        if (!stopping)
+        {
+            std::this_thread::sleep_for(250ms);
+        }
+    }
+
+    fclose(file);
+}
@@ -0,0 +1,106 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include <winrt/Microsoft.Holographic.AppRemoting.h>
+
+// Keeps the raw statistics of every frame in a fixed size, lock-free single producer/single consumer ring buffer and
+// optionally streams them to a file on a background thread. Meant for long sessions, where latency percentiles and spikes
+// are evaluated offline.
+class PlayerFrameStatisticsTrace
+{
+public:
+    enum class ExportFormat
+    {
+        Csv,
+        Binary,
+    };
+
+    // GPU time in seconds the player spent on parts of a frame, as measured by DXHelper::GpuTimer.
+    struct GpuTimes
+    {
+        float blit = 0.0f;
+        float statusDisplay = 0.0f;
+    };
+
+    // Raw statistics of a single frame. Binary exports are a sequence of these records, preceded by a FileHeader.
+    struct Record
+    {
+        uint64_t timestampUs = 0; // Microseconds since the trace was created.
+        float latency = 0.0f;
+        float timeSinceLastPresent = 0.0f;
+        float videoFrameMinDelta = 0.0f;
+        float videoFrameMaxDelta = 0.0f;
+        uint32_t videoFramesSkipped = 0;
+        uint32_t videoFrameReusedCount = 0;
+        uint32_t videoFramesDiscarded = 0;
+        uint32_t videoFramesReceived = 0;
+        float gpuBlitTime = 0.0f;
+        float gpuStatusDisplayTime = 0.0f;
+    };
+    static_assert(sizeof(Record) == 48);
+
+    struct FileHeader
+    {
+        char magic[4] = {'P', 'F', 'S', 'T'};
+        uint32_t version = 2;
+        uint32_t recordSize = sizeof(Record);
+        uint32_t reserved = 0;
+    };
+
+    // Number of records the ring buffer holds, a bit more than 4 minutes at 60 frames per second.
+    static constexpr uint64_t Capacity = 1 << 14;
+
+    PlayerFrameStatisticsTrace();
+    ~PlayerFrameStatisticsTrace();
+
+    // Adds the statistics of a frame. Must only be called from one thread. Never blocks, if the ring buffer is full
+    // the record is dropped and counted.
+    void Push(const winrt::Microsoft::Holographic::AppRemoting::PlayerFrameStatistics& frameStatistics, const GpuTimes& gpuTimes);
+
+    // Removes up to maxRecords of the oldest records from the ring buffer. Must only be called from one thread, which
+    // must not be a thread exporting the trace.
+    size_t Pop(Record* records, size_t maxRecords);
+
+    // Number of records which were dropped because the ring buffer was full.
+    uint64_t GetDroppedRecordCount() const;
+
+    // Starts a background thread which streams all new records to the given file. Stops a previously started export.
+    void StartExport(const std::wstring& fileName, ExportFormat format);
+
+    // Writes the remaining records and closes the file.
+    void StopExport();
+
+    bool IsExporting() const;
+
+private:
+    void ExportThread(FILE* file, ExportFormat format);
+
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point m_startTime = Clock::now();
+
+    std::unique_ptr<Record[]> m_records;
+
+    // Total number of records pushed and popped. Slot index is the count modulo Capacity.
+    std::atomic<uint64_t> m_writeCount = 0;
+    std::atomic<uint64_t> m_readCount = 0;
+    std::atomic<uint64_t> m_droppedRecordCount = 0;
+
+    std::thread m_exportThread;
+    std::atomic<bool> m_stopExport = false;
+};
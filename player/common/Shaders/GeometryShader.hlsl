@@ -14,6 +14,8 @@ struct GeometryShaderInput
 {
     min16float4 pos     : SV_POSITION;
     float2      uv      : TEXCOORD0;
+    min16float4 color   : COLOR0;
+    nointerpolation uint layer : TEXCOORD2;
     uint        instId  : TEXCOORD1;
 };
 
@@ -22,6 +24,8 @@ struct GeometryShaderOutput
 {
     min16float4 pos     : SV_POSITION;
     float2      uv      : TEXCOORD0;
+    min16float4 color   : COLOR0;
+    nointerpolation uint layer : TEXCOORD2;
     uint        rtvId   : SV_RenderTargetArrayIndex;
 };
 
@@ -36,6 +40,8 @@ void main(triangle GeometryShaderInput input[3], inout TriangleStream<GeometrySh
     {
         output.pos   = input[i].pos;
         output.uv    = input[i].uv;
+        output.color = input[i].color;
+        output.layer = input[i].layer;
         output.rtvId = input[i].instId;
         outStream.Append(output);
     }
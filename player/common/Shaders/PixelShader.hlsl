@@ -14,10 +14,15 @@ struct PixelShaderInput
 {
     min16float4 pos : SV_POSITION;
     float2 uv : TEXCOORD0; // Note: we use full precission floats for texture coordinates to avoid artifacts with large textures
+    min16float4 color : COLOR0;
+    nointerpolation uint layer : TEXCOORD2;
 };
 
-Texture2D tex : t0;
-SamplerState samp : s0;
+// The image is drawn from layer 0, the text from layer 1, all within the same draw call.
+Texture2D imageTex : register(t0);
+Texture2D glyphTex : register(t1);
+SamplerState imageSamp : register(s0);
+SamplerState glyphSamp : register(s1);
 
 float4 main(PixelShaderInput input) : SV_TARGET
 {
@@ -29,7 +34,10 @@ float4 main(PixelShaderInput input) : SV_TARGET
     [unroll]
     for (int i = 0; i < 4; ++i)
     {
-        color += 0.25 * tex.Sample(samp, input.uv + offsets[i].x * dtdx + offsets[i].y * dtdy);
+        const float2 uv = input.uv + offsets[i].x * dtdx + offsets[i].y * dtdy;
+        const float4 texel =
+            input.layer == 0 ? imageTex.SampleGrad(imageSamp, uv, dtdx, dtdy) : glyphTex.SampleGrad(glyphSamp, uv, dtdx, dtdy);
+        color += 0.25 * texel;
     }
-    return color;
+    return color * input.color;
 }
@@ -14,6 +14,8 @@ struct VertexShaderOutput
 {
     min16float4 pos     : SV_POSITION;
     float2      uv      : TEXCOORD0;
+    min16float4 color   : COLOR0;
+    nointerpolation uint layer : TEXCOORD2;
 
     // The render target array index is set here in the vertex shader.
     uint        viewId  : SV_RenderTargetArrayIndex;
@@ -9,10 +9,10 @@
 //
 //*********************************************************
 
-// A constant buffer that stores the model transform.
+// A constant buffer that stores the model transforms of the image and the text, indexed by the layer of the vertex.
 cbuffer ModelConstantBuffer : register(b0)
 {
-    float4x4 model;
+    float4x4 model[2];
 };
 
 // A constant buffer that stores each set of view and projection matrices in column-major format.
@@ -26,6 +26,8 @@ struct VertexShaderInput
 {
     min16float3 pos     : POSITION;
     float2      uv      : TEXCOORD0;
+    min16float4 color   : COLOR0;
+    uint        layer   : LAYER;
     uint        instId  : SV_InstanceID;
 };
 
@@ -42,14 +44,16 @@ VertexShaderOutput main(VertexShaderInput input)
     int idx = input.instId % 2;
 
     // Transform the vertex position into world space.
-    pos = mul(pos, model);
+    pos = mul(pos, model[input.layer]);
 
     // Correct for perspective and project the vertex position onto the screen.
     pos = mul(pos, viewProjection[idx]);
     output.pos = (min16float4)pos;
 
-    // Pass the texture coordinates through without modification.
+    // Pass the texture coordinates, the color and the layer through without modification.
     output.uv = input.uv;
+    output.color = input.color;
+    output.layer = input.layer;
 
     // Set the render target array index.
     output.viewId = idx;
@@ -0,0 +1,143 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include "pch.h"
+
+#include "StartupTimeline.h"
+
+#include <algorithm>
+#include <cwchar>
+#include <vector>
+
+StartupTimeline::StartupTimeline()
+    : m_start(Clock::now())
+{
+}
+
+bool StartupTimeline::Mark(Milestone milestone)
+{
+    std::optional<Clock::time_point>& time = m_times[static_cast<size_t>(milestone)];
+    if (time)
+    {
+        return false;
+    }
+
+    time = Clock::now();
+    return true;
+}
+
+void StartupTimeline::StartConnectionAttempt()
+{
+    // Attempts are counted until a connection is established.
+    if (IsReached(Milestone::Connected))
+    {
+        m_connectionAttempts = 0;
+    }
+
+    m_times[static_cast<size_t>(Milestone::Connected)].reset();
+    m_times[static_cast<size_t>(Milestone::FirstRemoteFrameBlitted)].reset();
+    m_times[static_cast<size_t>(Milestone::ConnectStarted)] = Clock::now();
+    m_connectionAttempts++;
+}
+
+std::wstring StartupTimeline::FormatSummary() const
+{
+    // Each value is the time since start, the difference to the previous value is the time of the phase in between.
+    constexpr Milestone milestones[] = {
+        Milestone::HolographicSpaceCreated, Milestone::FrameLoopStarted, Milestone::Connected, Milestone::FirstRemoteFrameBlitted};
+    constexpr const wchar_t* labels[] = {L"space", L"frames", L"connected", L"first frame"};
+
+    std::wstring summary = L"Startup (ms):";
+    for (size_t i = 0; i < std::size(milestones); ++i)
+    {
+        wchar_t value[64];
+        if (IsReached(milestones[i]))
+        {
+            swprintf_s(value, L" %s %.0f", labels[i], GetMilliseconds(milestones[i]));
+        }
+        else
+        {
+            swprintf_s(value, L" %s -", labels[i]);
+        }
+        summary += value;
+    }
+
+    if (m_connectionAttempts > 1)
+    {
+        summary += L", attempt " + std::to_wstring(m_connectionAttempts);
+    }
+    return summary;
+}
+
+std::wstring StartupTimeline::FormatWaterfall() const
+{
+    std::vector<Milestone> reached;
+    for (size_t i = 0; i < m_times.size(); ++i)
+    {
+        if (m_times[i])
+        {
+            reached.push_back(static_cast<Milestone>(i));
+        }
+    }
+    std::stable_sort(reached.begin(), reached.end(), [this](Milestone a, Milestone b) {
+        return *m_times[static_cast<size_t>(a)] < *m_times[static_cast<size_t>(b)];
+    });
+
+    std::wstring waterfall = L"Startup waterfall (ms since start, +ms since previous milestone):\n";
+    float previousMilliseconds = 0.0f;
+    for (Milestone milestone : reached)
+    {
+        const float milliseconds = GetMilliseconds(milestone);
+
+        wchar_t line[128];
+        swprintf_s(line, L"  %-26s %8.1f  +%.1f\n", GetName(milestone), milliseconds, milliseconds - previousMilliseconds);
+        waterfall += line;
+        previousMilliseconds = milliseconds;
+    }
+
+    if (m_connectionAttempts > 0)
+    {
+        waterfall += L"  Connection attempts: " + std::to_wstring(m_connectionAttempts) + L"\n";
+    }
+    return waterfall;
+}
+
+const wchar_t* StartupTimeline::GetName(Milestone milestone)
+{
+    switch (milestone)
+    {
+        case Milestone::Initialized:
+            return L"Initialized";
+        case Milestone::HolographicSpaceCreated:
+            return L"HolographicSpaceCreated";
+        case Milestone::LogoLoadStarted:
+            return L"LogoLoadStarted";
+        case Milestone::FrameLoopStarted:
+            return L"FrameLoopStarted";
+        case Milestone::Activated:
+            return L"Activated";
+        case Milestone::LogoVisible:
+            return L"LogoVisible";
+        case Milestone::ConnectStarted:
+            return L"ConnectStarted";
+        case Milestone::Connected:
+            return L"Connected";
+        case Milestone::FirstRemoteFrameBlitted:
+            return L"FirstRemoteFrameBlitted";
+        default:
+            return L"";
+    }
+}
+
+float StartupTimeline::GetMilliseconds(Milestone milestone) const
+{
+    return std::chrono::duration<float, std::milli>(*m_times[static_cast<size_t>(milestone)] - m_start).count();
+}
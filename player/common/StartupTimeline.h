@@ -0,0 +1,77 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <optional>
+#include <string>
+
+// Records when the player reaches the milestones from app start to the first remote frame, so the time to the first hologram can
+// be broken down into its phases. The times are taken from the steady clock, relative to the creation of the timeline.
+// Not thread-safe: the milestones before the render thread starts are marked on the CoreWindow thread, all others on the render
+// thread.
+class StartupTimeline
+{
+public:
+    enum class Milestone
+    {
+        // Initialize returned, the player context and the device resources are created.
+        Initialized,
+        // The holographic space of the window is created.
+        HolographicSpaceCreated,
+        // LoadLogoImage returned, the logo streams in over the next frames.
+        LogoLoadStarted,
+        // The render thread started its first frame.
+        FrameLoopStarted,
+        // The activation arguments were applied.
+        Activated,
+        // The logo shows up in the status display.
+        LogoVisible,
+        // The last connection attempt started, i.e. ConnectOrListen was called.
+        ConnectStarted,
+        Connected,
+        FirstRemoteFrameBlitted,
+
+        Count
+    };
+
+    StartupTimeline();
+
+    // Records the current time for the milestone, unless it was already reached. Returns whether the time was recorded.
+    bool Mark(Milestone milestone);
+
+    // Forgets the milestones of the previous connection and counts a new connection attempt. The app milestones are kept.
+    void StartConnectionAttempt();
+
+    bool IsReached(Milestone milestone) const
+    {
+        return m_times[static_cast<size_t>(milestone)].has_value();
+    }
+
+    // One line with the time since start of the most important milestones, for the status display.
+    std::wstring FormatSummary() const;
+
+    // One line per reached milestone, in the order they were reached, with the time since start and since the previous milestone.
+    std::wstring FormatWaterfall() const;
+
+    static const wchar_t* GetName(Milestone milestone);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    float GetMilliseconds(Milestone milestone) const;
+
+    const Clock::time_point m_start;
+    std::array<std::optional<Clock::time_point>, static_cast<size_t>(Milestone::Count)> m_times;
+    uint32_t m_connectionAttempts = 0;
+};
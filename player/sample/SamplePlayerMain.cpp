@@ -14,12 +14,21 @@
 #include "SamplePlayerMain.h"
 
 #include "../common/CameraResources.h"
-#include "../common/Content/DDSTextureLoader.h"
+#include "../common/FrameProfiler.h"
+#include "../common/MemoryAccounting.h"
 #include "../common/PlayerUtil.h"
 
+#include "../../remote/common/LatencyProbeMessage.h"
+
+#include <algorithm>
+#include <cmath>
 #include <sstream>
 
+#include <avrt.h>
+#pragma comment(lib, "avrt.lib")
+
 #include <winrt/Windows.Foundation.Metadata.h>
+#include <winrt/Windows.Storage.h>
 #include <winrt/Windows.Ui.Popups.h>
 
 using namespace std::chrono_literals;
@@ -38,16 +47,70 @@ using namespace winrt::Windows::UI::Input::Spatial;
 namespace
 {
     constexpr int64_t s_loadingDotsMaxCount = 3;
+
+    // Sections of a frame measured by the GPU timer.
+    constexpr size_t s_gpuSectionBlit = 0;
+    constexpr size_t s_gpuSectionStatusDisplay = 1;
+
+    // Durations which fill the frame graph, longer ones are clipped. The top of the graph is kept free for the markers of frames
+    // which skipped or discarded video frames.
+    constexpr float s_frameGraphRange = 0.1f;
+    constexpr float s_frameGraphValueHeight = 0.9f;
+
+    // Render target size requests of the remote side are applied once they did not change for this long, so a renegotiation
+    // reallocates the back buffers once instead of for every intermediate size.
+    constexpr auto s_renderTargetSizeChangeDebounce = 250ms;
+
+    // Requests which change neither width nor height by more than this fraction of the current size are ignored.
+    constexpr float s_renderTargetSizeChangeThreshold = 0.02f;
+
+    int64_t GetSteadyClockMicroseconds()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    bool IsSignificantSizeChange(winrt::Windows::Foundation::Size currentSize, winrt::Windows::Foundation::Size newSize)
+    {
+        return std::abs(newSize.Width - currentSize.Width) > currentSize.Width * s_renderTargetSizeChangeThreshold ||
+               std::abs(newSize.Height - currentSize.Height) > currentSize.Height * s_renderTargetSizeChangeThreshold;
+    }
+
+    // Parses "<first reconnect delay in ms>[,<maximum reconnect delay in ms>]". Without a maximum the delay does not back off.
+    bool ParseReconnectBackoff(const std::wstring& value, std::chrono::milliseconds& delay, std::chrono::milliseconds& maxDelay)
+    {
+        unsigned int delayMs = 0;
+        unsigned int maxDelayMs = 0;
+        const int count = swscanf_s(value.c_str(), L"%u,%u", &delayMs, &maxDelayMs);
+        if (count < 1)
+        {
+            return false;
+        }
+
+        delay = std::chrono::milliseconds(delayMs);
+        maxDelay = std::chrono::milliseconds(count > 1 ? std::max(delayMs, maxDelayMs) : delayMs);
+        return true;
+    }
 }
 
 SamplePlayerMain::SamplePlayerMain()
 {
+    FrameProfiler::Initialize();
+
     m_canCommitDirect3D11DepthBuffer = winrt::Windows::Foundation::Metadata::ApiInformation::IsMethodPresent(
         L"Windows.Graphics.Holographic.HolographicCameraRenderingParameters", L"CommitDirect3D11DepthBuffer");
+
+#ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
+    // Latency probes are echoed, any other message is answered with the sample response.
+    m_customDataChannelDispatcher.Register(
+        LatencyProbeMessage::Type, [this](winrt::array_view<const uint8_t> message) { EchoLatencyProbe(message); });
+    m_customDataChannelDispatcher.SetDefaultHandler([this](winrt::array_view<const uint8_t>) { SendCustomDataChannelResponse(); });
+#endif
 }
 SamplePlayerMain::~SamplePlayerMain()
 {
     Uninitialize();
+
+    FrameProfiler::Shutdown();
 }
 
 void SamplePlayerMain::ConnectOrListen()
@@ -55,6 +118,8 @@ void SamplePlayerMain::ConnectOrListen()
     // Disconnect from a potentially existing connection first
     m_playerContext.Disconnect();
 
+    m_startupTimeline.StartConnectionAttempt();
+
     UpdateStatusDisplay();
 
     // Try to establish a connection as specified in m_playerOptions
@@ -86,7 +151,7 @@ void SamplePlayerMain::ConnectOrListen()
         // Possible reasons for this are invalid parameters or because the PlayerContext is already in connected or connecting state.
         m_errorHelper.AddError(
             std::wstring(m_playerOptions.m_listen ? L"Failed to Listen: " : L"Failed to Connect: ") + std::wstring(ex.message().c_str()));
-        ConnectOrListenAfter(1s);
+        ConnectOrListenAfterFailure();
     }
 
     UpdateStatusDisplay();
@@ -109,72 +174,141 @@ winrt::fire_and_forget SamplePlayerMain::ConnectOrListenAfter(std::chrono::syste
     }
 
     // Try to connect or listen
-    ConnectOrListen();
+    strongThis->PostToRenderThread([strongThis]() { strongThis->ConnectOrListen(); });
+}
+
+void SamplePlayerMain::ConnectOrListenAfterFailure()
+{
+    std::chrono::milliseconds delay = m_playerOptions.m_reconnectDelay;
+    for (uint32_t i = 0; i < m_connectionFailures && delay < m_playerOptions.m_maxReconnectDelay; ++i)
+    {
+        delay *= 2;
+    }
+    delay = std::min(delay, std::max(m_playerOptions.m_maxReconnectDelay, m_playerOptions.m_reconnectDelay));
+
+    m_connectionFailures++;
+    ConnectOrListenAfter(delay);
 }
 
 HolographicFrame SamplePlayerMain::Update(float deltaTimeInSeconds, const HolographicFrame& prevHolographicFrame)
 {
+    FRAME_PROFILER_ZONE("Update");
+
     SpatialCoordinateSystem focusPointCoordinateSystem = nullptr;
     float3 focusPointPosition{0.0f, 0.0f, 0.0f};
 
-    // Update the position of the status and error display.
-    // Note, this is done with the data from the previous frame before the next wait to save CPU time and get the remote frame presented as
-    // fast as possible. This also means that focus point and status display position are one frame behind which is a reasonable tradeoff
-    // for the time we win.
-    if (prevHolographicFrame != nullptr && m_attachedFrameOfReference != nullptr)
+    // Update content of the status and error display.
     {
-        HolographicFramePrediction prevPrediction = prevHolographicFrame.CurrentPrediction();
-        SpatialCoordinateSystem coordinateSystem =
-            m_attachedFrameOfReference.GetStationaryCoordinateSystemAtTimestamp(prevPrediction.Timestamp());
+        FRAME_PROFILER_ZONE("UpdateStatus");
 
-        auto poseIterator = prevPrediction.CameraPoses().First();
-        if (poseIterator.HasCurrent())
+        // Update the accumulated statistics with the statistics from the last frame.
+        PlayerFrameStatisticsTrace::GpuTimes gpuTimes;
+        m_deviceResources->UseD3DDeviceContext([&](ID3D11DeviceContext3*) {
+            const DXHelper::GpuTimer& gpuTimer = m_deviceResources->GetGpuTimer();
+            gpuTimes.blit = gpuTimer.GetSectionTime(s_gpuSectionBlit) / 1000.0f;
+            gpuTimes.statusDisplay = gpuTimer.GetSectionTime(s_gpuSectionStatusDisplay) / 1000.0f;
+        });
+        DXHelper::HeadStartController& headStartController = m_deviceResources->GetHeadStartController();
+        PlayerFrameStatisticsHelper::FramePacing framePacing;
+        framePacing.headStart = std::chrono::duration<float>(headStartController.GetHeadStart()).count();
+        framePacing.framesMissed = headStartController.TakeMissedFrameCount();
+        m_statisticsHelper.Update(m_playerContext.LastFrameStatistics(), gpuTimes, framePacing);
+
+        if (!m_firstRemoteFrameWasBlitted || (m_statisticsHelper.StatisticsHaveChanged() && !UpdateStatisticsLine()))
         {
-            HolographicCameraPose cameraPose = poseIterator.Current();
-            if (auto visibleFrustumReference = cameraPose.TryGetVisibleFrustum(coordinateSystem))
-            {
-                const float imageOffsetX = m_trackingLost ? -0.0095f : -0.0125f;
-                const float imageOffsetY = 0.0111f;
-                m_statusDisplay->PositionDisplay(deltaTimeInSeconds, visibleFrustumReference.Value(), imageOffsetX, imageOffsetY);
-            }
+            UpdateStatusDisplay();
+        }
+        else if (m_statisticsHelper.StatisticsHaveChanged() && m_memoryLineIndex)
+        {
+            m_statusDisplay->UpdateLineText(*m_memoryLineIndex, MemoryAccounting::FormatUsage());
         }
 
-        focusPointCoordinateSystem = coordinateSystem;
-        focusPointPosition = m_statusDisplay->GetPosition();
-    }
-
-    // Update content of the status and error display.
-    {
-        // Update the accumulated statistics with the statistics from the last frame.
-        m_statisticsHelper.Update(m_playerContext.LastFrameStatistics());
+        if (m_statisticsLineIndex)
+        {
+            UpdateFrameGraph();
+        }
 
-        if (m_statisticsHelper.StatisticsHaveChanged() || !m_firstRemoteFrameWasBlitted)
+#ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
+        if (m_statisticsHelper.StatisticsHaveChanged())
         {
-            UpdateStatusDisplay();
+            SendFrameStatistics();
         }
+#endif
 
         const bool connected = (m_playerContext.ConnectionState() == ConnectionState::Connected);
         if (!(connected && !m_trackingLost))
         {
-            if (m_playerOptions.m_listen)
+            // The address is only read again after it changed, all other frames only load the generation.
+            const uint64_t deviceIpGeneration = m_ipAddressUpdater.GetGeneration();
+            if (m_playerOptions.m_listen && m_deviceIpGeneration != deviceIpGeneration)
             {
+                m_deviceIpGeneration = deviceIpGeneration;
+
                 auto deviceIpNew = m_ipAddressUpdater.GetIpAddress(m_playerOptions.m_ipv6);
                 if (m_deviceIp != deviceIpNew)
                 {
                     m_deviceIp = deviceIpNew;
 
+                    UpdateAddressLine();
                     UpdateStatusDisplay();
                 }
             }
         }
 
+        if (m_logoStreamer)
+        {
+            const bool logoAvailable = m_deviceResources->UseD3DDeviceContext(
+                [&](ID3D11DeviceContext3* deviceContext) { return m_logoStreamer->Update(deviceContext); });
+            if (logoAvailable)
+            {
+                m_statusDisplay->SetImage(m_logoStreamer->GetShaderResourceView());
+                m_startupTimeline.Mark(StartupTimeline::Milestone::LogoVisible);
+            }
+        }
+
         m_statusDisplay->SetImageEnabled(!connected);
-        m_statusDisplay->Update(deltaTimeInSeconds);
         m_errorHelper.Update(deltaTimeInSeconds, [this]() { UpdateStatusDisplay(); });
     }
 
-    HolographicFrame holographicFrame = m_deviceResources->GetHolographicSpace().CreateNextFrame();
+    // Update the position of the status and error display.
+    // Note, this is done with the data from the previous frame before the next wait to save CPU time and get the remote frame presented as
+    // fast as possible. This also means that focus point and status display position are one frame behind which is a reasonable tradeoff
+    // for the time we win.
+    // When connected without statistics and errors there is nothing to draw, so the display is neither positioned nor used as
+    // focus point.
+    const bool statusDisplayVisible = m_statusDisplay->HasContent();
+    if (statusDisplayVisible && prevHolographicFrame != nullptr && m_attachedFrameOfReference != nullptr)
+    {
+        HolographicFramePrediction prevPrediction = prevHolographicFrame.CurrentPrediction();
+        SpatialCoordinateSystem coordinateSystem =
+            m_attachedFrameOfReference.GetStationaryCoordinateSystemAtTimestamp(prevPrediction.Timestamp());
+
+        auto poseIterator = prevPrediction.CameraPoses().First();
+        if (poseIterator.HasCurrent())
+        {
+            HolographicCameraPose cameraPose = poseIterator.Current();
+            if (auto visibleFrustumReference = cameraPose.TryGetVisibleFrustum(coordinateSystem))
+            {
+                const float imageOffsetX = m_trackingLost ? -0.0095f : -0.0125f;
+                const float imageOffsetY = 0.0111f;
+                m_statusDisplay->PositionDisplay(deltaTimeInSeconds, visibleFrustumReference.Value(), imageOffsetX, imageOffsetY);
+            }
+        }
+
+        focusPointCoordinateSystem = coordinateSystem;
+        focusPointPosition = m_statusDisplay->GetPosition();
+    }
+
+    m_statusDisplay->Update(deltaTimeInSeconds);
+
+    HolographicFrame holographicFrame = nullptr;
     {
+        FRAME_PROFILER_ZONE("CreateNextFrame");
+        holographicFrame = m_deviceResources->GetHolographicSpace().CreateNextFrame();
+    }
+    {
+        FRAME_PROFILER_ZONE("WaitForNextFrameReady");
+
         // Note, we don't wait for the next frame on present which allows us to first update all view independent stuff and also create the
         // next frame before we actually wait. By doing so everything before the wait is executed while the previous frame is presented by
         // the OS and thus saves us quite some CPU time after the wait.
@@ -183,22 +317,32 @@ HolographicFrame SamplePlayerMain::Update(float deltaTimeInSeconds, const Hologr
     holographicFrame.UpdateCurrentPrediction();
 
     // Back buffers can change from frame to frame. Validate each buffer, and recreate resource views and depth buffers as needed.
-    m_deviceResources->EnsureCameraResources(
-        holographicFrame, holographicFrame.CurrentPrediction(), focusPointCoordinateSystem, focusPointPosition);
+    {
+        FRAME_PROFILER_ZONE("EnsureCameraResources");
+        m_deviceResources->EnsureCameraResources(
+            holographicFrame, holographicFrame.CurrentPrediction(), focusPointCoordinateSystem, focusPointPosition);
+    }
 
     return holographicFrame;
 }
 
 void SamplePlayerMain::Render(const HolographicFrame& holographicFrame)
 {
+    FRAME_PROFILER_ZONE("Render");
+
     bool atLeastOneCameraRendered = false;
 
-    m_deviceResources->UseHolographicCameraResources([this, holographicFrame, &atLeastOneCameraRendered](
+    // Skips the status display pass, i.e. its text scale update, constant buffers, state changes and draws, if there is nothing to
+    // draw. This is the common case while connected, where every bit of GPU time after the blit adds latency.
+    const bool statusDisplayVisible = m_statusDisplay->HasContent();
+
+    m_deviceResources->UseHolographicCameraResources([this, holographicFrame, statusDisplayVisible, &atLeastOneCameraRendered](
                                                          std::map<UINT32, std::unique_ptr<DXHelper::CameraResources>>& cameraResourceMap) {
         HolographicFramePrediction prediction = holographicFrame.CurrentPrediction();
 
+        // The coordinate system is only needed for the view and projection of local content.
         SpatialCoordinateSystem coordinateSystem = nullptr;
-        if (m_attachedFrameOfReference)
+        if (statusDisplayVisible && m_attachedFrameOfReference)
         {
             coordinateSystem = m_attachedFrameOfReference.GetStationaryCoordinateSystemAtTimestamp(prediction.Timestamp());
         }
@@ -208,7 +352,8 @@ void SamplePlayerMain::Render(const HolographicFrame& holographicFrame)
         winrt::Windows::Foundation::Size newRenderTargetSize{};
         {
             std::lock_guard lock{m_renderTargetSizeChangeMutex};
-            if (m_needRenderTargetSizeChange)
+            if (m_needRenderTargetSizeChange &&
+                std::chrono::steady_clock::now() - m_renderTargetSizeChangeTime >= s_renderTargetSizeChangeDebounce)
             {
                 needRenderTargetSizeChange = true;
                 newRenderTargetSize = m_newRenderTargetSize;
@@ -216,6 +361,9 @@ void SamplePlayerMain::Render(const HolographicFrame& holographicFrame)
             }
         }
 
+        m_deviceResources->UseD3DDeviceContext(
+            [&](ID3D11DeviceContext3* deviceContext) { m_deviceResources->GetGpuTimer().BeginFrame(deviceContext); });
+
         for (const HolographicCameraPose& cameraPose : prediction.CameraPoses())
         {
             DXHelper::CameraResources* pCameraResources = cameraResourceMap[cameraPose.HolographicCamera().Id()].get();
@@ -223,40 +371,49 @@ void SamplePlayerMain::Render(const HolographicFrame& holographicFrame)
             m_deviceResources->UseD3DDeviceContext([&](ID3D11DeviceContext3* deviceContext) {
                 ID3D11DepthStencilView* depthStencilView = pCameraResources->GetDepthStencilView();
 
-                // Set render targets to the current holographic camera.
                 ID3D11RenderTargetView* const targets[1] = {pCameraResources->GetBackBufferRenderTargetView()};
-                deviceContext->OMSetRenderTargets(1, targets, depthStencilView);
-
                 if (!targets[0] || !depthStencilView)
                 {
                     return;
                 }
 
-                if (coordinateSystem)
+                // Without local content the remote frame is blitted right away. BlitRemoteFrame writes to the back buffer of the
+                // camera by itself, so the render targets, viewport and view/projection constant buffer are only set up when local
+                // content is drawn on top of it.
+                bool cameraActive = true;
+                if (statusDisplayVisible)
                 {
-                    // The view and projection matrices for each holographic camera will change
-                    // every frame. This function refreshes the data in the constant buffer for
-                    // the holographic camera indicated by cameraPose.
-                    pCameraResources->UpdateViewProjectionBuffer(m_deviceResources, cameraPose, coordinateSystem);
-
-                    const bool connected = (m_playerContext.ConnectionState() == ConnectionState::Connected);
-
-                    // Reduce the fov of the statistics view.
-                    bool useLandscape = m_playerOptions.m_showStatistics && connected && !m_trackingLost && m_firstRemoteFrameWasBlitted;
-
-                    // Pass data from the camera resources to the status display.
-                    m_statusDisplay->UpdateTextScale(
-                        pCameraResources->GetProjectionTransform(),
-                        pCameraResources->GetRenderTargetSize().Width,
-                        pCameraResources->GetRenderTargetSize().Height,
-                        useLandscape,
-                        pCameraResources->IsOpaque());
-                }
+                    // Set render targets to the current holographic camera.
+                    deviceContext->OMSetRenderTargets(1, targets, depthStencilView);
 
-                // Attach the view/projection constant buffer for this camera to the graphics pipeline.
-                bool cameraActive = pCameraResources->AttachViewProjectionBuffer(m_deviceResources);
+                    if (coordinateSystem)
+                    {
+                        // The view and projection matrices for each holographic camera will change
+                        // every frame. This function refreshes the data in the constant buffer for
+                        // the holographic camera indicated by cameraPose.
+                        pCameraResources->UpdateViewProjectionBuffer(m_deviceResources, cameraPose, coordinateSystem);
+
+                        const bool connected = (m_playerContext.ConnectionState() == ConnectionState::Connected);
+
+                        // Reduce the fov of the statistics view.
+                        bool useLandscape =
+                            m_playerOptions.m_showStatistics && connected && !m_trackingLost && m_firstRemoteFrameWasBlitted;
+
+                        // Pass data from the camera resources to the status display.
+                        m_statusDisplay->UpdateTextScale(
+                            pCameraResources->GetProjectionTransform(),
+                            pCameraResources->GetRenderTargetSize().Width,
+                            pCameraResources->GetRenderTargetSize().Height,
+                            useLandscape,
+                            pCameraResources->IsOpaque());
+                    }
+
+                    // Attach the view/projection constant buffer for this camera to the graphics pipeline.
+                    cameraActive = pCameraResources->AttachViewProjectionBuffer(m_deviceResources);
+                }
 
-                // Only render world-locked content when positional tracking is active.
+                // Only render world-locked content when positional tracking is active. Without local content the blit does not depend on
+                // it, and tracking loss is reported by the status display anyway.
                 if (cameraActive)
                 {
                     auto blitResult = BlitResult::Failed_NoRemoteFrameAvailable;
@@ -268,14 +425,19 @@ void SamplePlayerMain::Render(const HolographicFrame& holographicFrame)
                             // Blit the remote frame into the backbuffer for the HolographicFrame.
                             // NOTE: This overwrites the focus point for the current frame, if the remote application
                             // has specified a focus point during the rendering of the remote frame.
+                            FRAME_PROFILER_ZONE("BlitRemoteFrame");
+                            m_deviceResources->GetGpuTimer().BeginSection(deviceContext, s_gpuSectionBlit);
                             blitResult = m_playerContext.BlitRemoteFrame();
+                            m_deviceResources->GetGpuTimer().EndSection(deviceContext, s_gpuSectionBlit);
                         }
                     }
                     catch (winrt::hresult_error err)
                     {
                         winrt::hstring msg = err.message();
-                        m_errorHelper.AddError(std::wstring(L"BlitRemoteFrame failed: ") + msg.c_str());
-                        UpdateStatusDisplay();
+                        if (m_errorHelper.AddError(std::wstring(L"BlitRemoteFrame failed: ") + msg.c_str()))
+                        {
+                            UpdateStatusDisplay();
+                        }
                     }
 
                     // If a remote remote frame has been blitted then color and depth buffer are fully overwritten, otherwise we have to
@@ -289,14 +451,25 @@ void SamplePlayerMain::Render(const HolographicFrame& holographicFrame)
                     else
                     {
                         m_firstRemoteFrameWasBlitted = true;
+                        if (m_startupTimeline.Mark(StartupTimeline::Milestone::FirstRemoteFrameBlitted))
+                        {
+                            OutputDebugStringW(m_startupTimeline.FormatWaterfall().c_str());
+                            if (m_startupLineIndex)
+                            {
+                                m_statusDisplay->UpdateLineText(*m_startupLineIndex, m_startupTimeline.FormatSummary());
+                            }
+                        }
                     }
 
                     // Render local content.
+                    // NOTE: Any local custom content would be rendered here.
+                    if (statusDisplayVisible)
                     {
-                        // NOTE: Any local custom content would be rendered here.
-
                         // Draw connection status and/or statistics.
+                        FRAME_PROFILER_ZONE("StatusDisplay::Render");
+                        m_deviceResources->GetGpuTimer().BeginSection(deviceContext, s_gpuSectionStatusDisplay);
                         m_statusDisplay->Render();
+                        m_deviceResources->GetGpuTimer().EndSection(deviceContext, s_gpuSectionStatusDisplay);
                     }
 
                     // Commit depth buffer if it has been committed by the remote app which is indicated by Success_Color_Depth.
@@ -318,17 +491,25 @@ void SamplePlayerMain::Render(const HolographicFrame& holographicFrame)
                 if (HolographicViewConfiguration viewConfig = cameraPose.HolographicCamera().ViewConfiguration())
                 {
                     // Only request new render target size if we are dealing with an opaque (i.e., VR) display
-                    if (cameraPose.HolographicCamera().Display().IsOpaque())
+                    if (cameraPose.HolographicCamera().Display().IsOpaque() &&
+                        IsSignificantSizeChange(viewConfig.RenderTargetSize(), newRenderTargetSize))
                     {
-                        viewConfig.RequestRenderTargetSize(newRenderTargetSize);
+                        // The back buffers change to the new size within the next frames. The depth stencil for the size which is
+                        // actually used is created meanwhile on a worker thread.
+                        const winrt::Windows::Foundation::Size actualSize = viewConfig.RequestRenderTargetSize(newRenderTargetSize);
+                        pCameraResources->PrepareDepthStencil(m_deviceResources.get(), actualSize);
                     }
                 }
             }
         }
+
+        m_deviceResources->UseD3DDeviceContext(
+            [&](ID3D11DeviceContext3* deviceContext) { m_deviceResources->GetGpuTimer().EndFrame(deviceContext); });
     });
 
     if (atLeastOneCameraRendered)
     {
+        FRAME_PROFILER_ZONE("Present");
         m_deviceResources->Present(holographicFrame);
     }
 }
@@ -396,6 +577,10 @@ void SamplePlayerMain::Initialize(const CoreApplicationView& applicationView)
             m_spatialLocator.LocatabilityChanged(winrt::auto_revoke, {this, &SamplePlayerMain::OnLocatabilityChanged});
         m_attachedFrameOfReference = m_spatialLocator.CreateAttachedFrameOfReferenceAtCurrentHeading();
     }
+
+    UpdateAddressLine();
+
+    m_startupTimeline.Mark(StartupTimeline::Milestone::Initialized);
 }
 
 void SamplePlayerMain::SetWindow(const CoreWindow& window)
@@ -415,11 +600,13 @@ void SamplePlayerMain::SetWindow(const CoreWindow& window)
 
     // Forward the window to the device resources, so that it can create a holographic space for the window.
     m_deviceResources->SetWindow(window);
+    m_startupTimeline.Mark(StartupTimeline::Milestone::HolographicSpaceCreated);
 
     // Initialize the status display.
     m_statusDisplay = std::make_unique<StatusDisplay>(m_deviceResources);
 
     LoadLogoImage();
+    m_startupTimeline.Mark(StartupTimeline::Milestone::LogoLoadStarted);
 
 #ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
     try
@@ -429,7 +616,7 @@ void SamplePlayerMain::SetWindow(const CoreWindow& window)
             m_customDataChannel = dataChannel.as<IDataChannel2>();
 
             m_customChannelDataReceivedEventRevoker = m_customDataChannel.OnDataReceived(
-                winrt::auto_revoke, [this](winrt::array_view<const uint8_t> dataView) { OnCustomDataChannelDataReceived(); });
+                winrt::auto_revoke, [this](winrt::array_view<const uint8_t> dataView) { OnCustomDataChannelDataReceived(dataView); });
 
             m_customChannelClosedEventRevoker = m_customDataChannel.OnClosed(winrt::auto_revoke, [this]() { OnCustomDataChannelClosed(); });
         });
@@ -449,20 +636,15 @@ void SamplePlayerMain::Load(const winrt::hstring& entryPoint)
 
 void SamplePlayerMain::Run()
 {
-    using Clock = std::chrono::high_resolution_clock;
-    using TimePoint = Clock::time_point;
-    using Duration = Clock::duration;
-
-    Clock clock;
-    TimePoint timeLastUpdate = clock.now();
+    // The holographic frames are rendered on a separate thread, so that processing system UI and activation events does not delay
+    // frames. This thread only processes events and posts the resulting changes to the render thread.
+    if (m_deviceResources)
+    {
+        m_renderThread = std::thread(&SamplePlayerMain::RenderThread, this);
+    }
 
-    HolographicFrame prevHolographicFrame = nullptr;
     while (!m_windowClosed)
     {
-        TimePoint timeCurrUpdate = clock.now();
-        Duration timeSinceLastUpdate = timeCurrUpdate - timeLastUpdate;
-        float deltaTimeInSeconds = std::chrono::duration<float>(timeSinceLastUpdate).count();
-
         // If we encountered an error while creating the player context, we are going to provide
         // users with some feedback here. We have to do this after the application has launched
         // or we are going to fail at showing the dialog box.
@@ -494,25 +676,114 @@ void SamplePlayerMain::Run()
             m_shownFeedbackToUser = true;
         }
 
-        if (m_windowVisible && m_deviceResources != nullptr && (m_deviceResources->GetHolographicSpace() != nullptr))
+        CoreWindow::GetForCurrentThread().Dispatcher().ProcessEvents(CoreProcessEventsOption::ProcessOneAndAllPending);
+    }
+
+    StopRenderThread();
+}
+
+void SamplePlayerMain::RenderThread()
+{
+    // Let MMCSS schedule the frame loop like the one of a game, so that other threads of the app and the system delay it less.
+    DWORD mmcssTaskIndex = 0;
+    HANDLE mmcssHandle = AvSetMmThreadCharacteristicsW(L"Games", &mmcssTaskIndex);
+    if (mmcssHandle)
+    {
+        AvSetMmThreadPriority(mmcssHandle, AVRT_PRIORITY_HIGH);
+    }
+    else
+    {
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+    }
+
+    using Clock = std::chrono::high_resolution_clock;
+    using TimePoint = Clock::time_point;
+    using Duration = Clock::duration;
+
+    Clock clock;
+    TimePoint timeLastUpdate = clock.now();
+
+    HolographicFrame prevHolographicFrame = nullptr;
+    std::vector<std::function<void()>> commands;
+    while (true)
+    {
+        const bool renderFrame = m_windowVisible && (m_deviceResources->GetHolographicSpace() != nullptr);
+        {
+            std::unique_lock lock(m_renderCommandsMutex);
+
+            // Without a frame to render there is nothing to do until the next command.
+            if (!renderFrame)
+            {
+                m_renderCommandsCondition.wait(lock, [this]() { return m_stopRenderThread || !m_renderCommands.empty(); });
+            }
+
+            if (m_stopRenderThread)
+            {
+                break;
+            }
+
+            commands.swap(m_renderCommands);
+        }
+
+        for (const std::function<void()>& command : commands)
         {
-            CoreWindow::GetForCurrentThread().Dispatcher().ProcessEvents(CoreProcessEventsOption::ProcessAllIfPresent);
+            command();
+        }
+        commands.clear();
+
+        TimePoint timeCurrUpdate = clock.now();
+        Duration timeSinceLastUpdate = timeCurrUpdate - timeLastUpdate;
+        float deltaTimeInSeconds = std::chrono::duration<float>(timeSinceLastUpdate).count();
 
+        if (renderFrame)
+        {
+            m_startupTimeline.Mark(StartupTimeline::Milestone::FrameLoopStarted);
             HolographicFrame holographicFrame = Update(deltaTimeInSeconds, prevHolographicFrame);
             Render(holographicFrame);
             prevHolographicFrame = holographicFrame;
         }
-        else
-        {
-            CoreWindow::GetForCurrentThread().Dispatcher().ProcessEvents(CoreProcessEventsOption::ProcessOneAndAllPending);
-        }
 
         timeLastUpdate = timeCurrUpdate;
     }
+
+    if (mmcssHandle)
+    {
+        AvRevertMmThreadCharacteristics(mmcssHandle);
+    }
+}
+
+void SamplePlayerMain::StopRenderThread()
+{
+    if (!m_renderThread.joinable())
+    {
+        return;
+    }
+
+    {
+        std::lock_guard lock(m_renderCommandsMutex);
+        m_stopRenderThread = true;
+    }
+    m_renderCommandsCondition.notify_all();
+    m_renderThread.join();
+}
+
+void SamplePlayerMain::PostToRenderThread(std::function<void()> command)
+{
+    {
+        std::lock_guard lock(m_renderCommandsMutex);
+        if (m_stopRenderThread)
+        {
+            return;
+        }
+        m_renderCommands.push_back(std::move(command));
+    }
+    m_renderCommandsCondition.notify_all();
 }
 
 void SamplePlayerMain::Uninitialize()
 {
+    StopRenderThread();
+
 #ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
     OnCustomDataChannelClosed();
 #endif
@@ -536,10 +807,13 @@ void SamplePlayerMain::Uninitialize()
 
 void SamplePlayerMain::OnDeviceLost()
 {
-    m_logoImage = nullptr;
+    m_logoStreamer = nullptr;
 
     m_statusDisplay->ReleaseDeviceDependentResources();
 
+    // The cached textures of the lost device are not used anymore.
+    DirectX::ReleaseUnusedDDSTextures();
+
     // Request application restart and provide current player options to the new application instance
     std::wstringstream argsStream;
     argsStream << m_playerOptions.m_hostname.c_str() << L":" << m_playerOptions.m_port;
@@ -567,13 +841,10 @@ void SamplePlayerMain::OnDeviceRestored()
 
 void SamplePlayerMain::LoadLogoImage()
 {
-    m_logoImage = nullptr;
-
-    winrt::com_ptr<ID3D11ShaderResourceView> logoView;
-    winrt::check_hresult(
-        DirectX::CreateDDSTextureFromFile(m_deviceResources->GetD3DDevice(), L"RemotingLogo.dds", m_logoImage.put(), logoView.put()));
-
-    m_statusDisplay->SetImage(logoView);
+    // The logo is read and uploaded over the next frames, it shows up in the status display as soon as its smallest mip level is
+    // available.
+    m_statusDisplay->SetImage(nullptr);
+    m_logoStreamer = std::make_unique<DDSTextureStreamer>(m_deviceResources->GetD3DDevice(), L"RemotingLogo.dds");
 }
 
 SamplePlayerMain::PlayerOptions SamplePlayerMain::ParseActivationArgs(const IActivatedEventArgs& activationArgs)
@@ -583,6 +854,10 @@ SamplePlayerMain::PlayerOptions SamplePlayerMain::ParseActivationArgs(const IAct
     uint16_t port = 0;
     bool listen = false;
     bool showStatistics = false;
+    bool traceStatistics = false;
+    PlayerFrameStatisticsTrace::ExportFormat traceFormat = PlayerFrameStatisticsTrace::ExportFormat::Csv;
+    std::chrono::milliseconds reconnectDelay = m_playerOptions.m_reconnectDelay;
+    std::chrono::milliseconds maxReconnectDelay = m_playerOptions.m_maxReconnectDelay;
 
     if (activationArgs != nullptr)
     {
@@ -625,6 +900,22 @@ SamplePlayerMain::PlayerOptions SamplePlayerMain::ParseActivationArgs(const IAct
                                 listen = true;
                             }
 
+                            if (param == L"trace")
+                            {
+                                traceStatistics = true;
+                            }
+
+                            if (param == L"tracebinary")
+                            {
+                                traceStatistics = true;
+                                traceFormat = PlayerFrameStatisticsTrace::ExportFormat::Binary;
+                            }
+
+                            if (param.rfind(L"backoff=", 0) == 0)
+                            {
+                                ParseReconnectBackoff(param.substr(8), reconnectDelay, maxReconnectDelay);
+                            }
+
                             continue;
                         }
 
@@ -664,6 +955,15 @@ SamplePlayerMain::PlayerOptions SamplePlayerMain::ParseActivationArgs(const IAct
                         catch (...)
                         {
                         }
+
+                        try
+                        {
+                            winrt::hstring backoffValue = query.GetFirstValueByName(L"backoff");
+                            ParseReconnectBackoff(std::wstring(backoffValue), reconnectDelay, maxReconnectDelay);
+                        }
+                        catch (...)
+                        {
+                        }
                     }
                 }
                 break;
@@ -692,6 +992,10 @@ SamplePlayerMain::PlayerOptions SamplePlayerMain::ParseActivationArgs(const IAct
         playerOptions.m_port = port;
         playerOptions.m_listen = listen;
         playerOptions.m_showStatistics = showStatistics;
+        playerOptions.m_traceStatistics = traceStatistics;
+        playerOptions.m_traceFormat = traceFormat;
+        playerOptions.m_reconnectDelay = reconnectDelay;
+        playerOptions.m_maxReconnectDelay = maxReconnectDelay;
         playerOptions.m_ipv6 = !hostname.empty() && hostname.front() == L'[';
     }
     else
@@ -705,6 +1009,12 @@ SamplePlayerMain::PlayerOptions SamplePlayerMain::ParseActivationArgs(const IAct
 void SamplePlayerMain::UpdateStatusDisplay()
 {
     m_statusDisplay->ClearLines();
+    m_statisticsLineIndex.reset();
+    m_startupLineIndex.reset();
+    m_memoryLineIndex.reset();
+#ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
+    m_latencyLineIndex.reset();
+#endif
 
     if (m_trackingLost)
     {
@@ -726,13 +1036,7 @@ void SamplePlayerMain::UpdateStatusDisplay()
                     StatusDisplay::White}};
             m_statusDisplay->SetLines(lines);
 
-            std::wostringstream addressLine;
-            addressLine << (m_playerOptions.m_listen ? m_deviceIp.c_str() : m_playerOptions.m_hostname.c_str());
-            if (m_playerOptions.m_port)
-            {
-                addressLine << L":" << m_playerOptions.m_port;
-            }
-            m_statusDisplay->AddLine(StatusDisplay::Line{addressLine.str(), StatusDisplay::Medium, StatusDisplay::Yellow});
+            m_statusDisplay->AddLine(StatusDisplay::Line{m_addressLine, StatusDisplay::Medium, StatusDisplay::Yellow});
             m_statusDisplay->AddLine(
                 StatusDisplay::Line{L"Get help at: https://aka.ms/holographicremotinghelp", StatusDisplay::Small, StatusDisplay::White});
 
@@ -762,23 +1066,122 @@ void SamplePlayerMain::UpdateStatusDisplay()
         {
             if (m_playerOptions.m_showStatistics)
             {
-                const std::wstring statisticsString = m_statisticsHelper.GetStatisticsString();
-
-                StatusDisplay::Line line = {std::move(statisticsString), StatusDisplay::Medium, StatusDisplay::Yellow, 1.0f, true};
-                m_statusDisplay->AddLine(line);
+                // The statistics follow the frame graph, the lines below them stay within the statistics view.
+                StatusDisplay::Line line = {
+                    std::wstring(m_statisticsHelper.FormatStatisticsValues(m_statisticsText)),
+                    StatusDisplay::Medium,
+                    StatusDisplay::Yellow,
+                    1.0f,
+                    false,
+                    std::wstring(PlayerFrameStatisticsHelper::GetStatisticsLabels())};
+                m_statisticsLineIndex = m_statusDisplay->AddLine(line);
+                m_startupLineIndex = m_statusDisplay->AddLine(
+                    StatusDisplay::Line{m_startupTimeline.FormatSummary(), StatusDisplay::Small, StatusDisplay::Yellow});
+                m_memoryLineIndex = m_statusDisplay->AddLine(
+                    StatusDisplay::Line{MemoryAccounting::FormatUsage(), StatusDisplay::Small, StatusDisplay::Yellow});
+#ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
+                m_latencyLineIndex =
+                    m_statusDisplay->AddLine(StatusDisplay::Line{m_latencyText, StatusDisplay::Small, StatusDisplay::Yellow});
+#endif
             }
         }
     }
 
     m_errorHelper.Apply(m_statusDisplay);
+
+    // While the statistics are shown, the graph is updated every frame by UpdateFrameGraph.
+    if (!m_statisticsLineIndex)
+    {
+        m_statusDisplay->ClearGraph();
+    }
+}
+
+void SamplePlayerMain::UpdateAddressLine()
+{
+    std::wostringstream addressLine;
+    if (!m_playerOptions.m_listen)
+    {
+        addressLine << m_playerOptions.m_hostname.c_str();
+    }
+    else if (!m_deviceIp.empty())
+    {
+        addressLine << m_deviceIp.c_str();
+    }
+    else if (m_playerOptions.m_hostname != L"0.0.0.0")
+    {
+        // Until the first enumeration of the device addresses completed, a configured listen address is shown instead.
+        addressLine << m_playerOptions.m_hostname.c_str();
+    }
+    else
+    {
+        m_addressLine = L"(discovering address...)";
+        return;
+    }
+    if (m_playerOptions.m_port)
+    {
+        addressLine << L":" << m_playerOptions.m_port;
+    }
+    m_addressLine = addressLine.str();
+}
+
+bool SamplePlayerMain::UpdateStatisticsLine()
+{
+    if (!m_statisticsLineIndex)
+    {
+        return false;
+    }
+
+    // Only the values change from window to window, the labels and the layout of the status display stay the same.
+    m_statusDisplay->UpdateLineText(*m_statisticsLineIndex, m_statisticsHelper.FormatStatisticsValues(m_statisticsText));
+    return true;
+}
+
+void SamplePlayerMain::UpdateFrameGraph()
+{
+    constexpr size_t frameCount = PlayerFrameStatisticsHelper::RecentFrameCount;
+    static_assert(1 + frameCount * 3 <= StatusDisplay::MaxGraphQuadCount, "Every frame needs up to three quads.");
+
+    // One column per frame, the last frame is on the right.
+    constexpr float columnWidth = 1.0f / frameCount;
+    constexpr float durationToHeight = s_frameGraphValueHeight / s_frameGraphRange;
+    constexpr float dotHeight = 0.02f;
+
+    m_frameGraphQuads.clear();
+
+    // A line at the present interval of 60 frames per second, longer bars are late frames.
+    const float referenceHeight = durationToHeight / 60.0f;
+    m_frameGraphQuads.push_back({0.0f, 1.0f, referenceHeight - 0.5f * dotHeight, referenceHeight + 0.5f * dotHeight, StatusDisplay::Red});
+
+    for (size_t age = 0; age < m_statisticsHelper.GetRecentFrameCount(); ++age)
+    {
+        const PlayerFrameStatisticsHelper::RecentFrame& frame = m_statisticsHelper.GetRecentFrame(age);
+        const float right = 1.0f - age * columnWidth;
+        const float left = right - columnWidth;
+
+        // The present interval is drawn as a bar, the latency as a dot.
+        m_frameGraphQuads.push_back({left, right, 0.0f, frame.timeSinceLastPresent * durationToHeight, StatusDisplay::White});
+
+        const float latencyHeight = std::min(frame.latency * durationToHeight, s_frameGraphValueHeight);
+        m_frameGraphQuads.push_back({left, right, latencyHeight - dotHeight, latencyHeight, StatusDisplay::Yellow});
+
+        if (frame.videoFramesSkipped > 0 || frame.videoFramesDiscarded > 0)
+        {
+            m_frameGraphQuads.push_back({left, right, s_frameGraphValueHeight + dotHeight, 1.0f, StatusDisplay::Red});
+        }
+    }
+
+    m_statusDisplay->SetGraph({m_frameGraphQuads.data(), m_frameGraphQuads.data() + m_frameGraphQuads.size()});
 }
 
 #ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
-void SamplePlayerMain::OnCustomDataChannelDataReceived()
+void SamplePlayerMain::OnCustomDataChannelDataReceived(winrt::array_view<const uint8_t> dataView)
 {
-    // TODO: React on data received via the custom data channel here.
+    // The remote side batches its messages, the handlers get views into the received packet.
+    m_customDataChannelDispatcher.DispatchBatch(dataView);
+}
 
-    // For example: Send back artificial response
+void SamplePlayerMain::SendCustomDataChannelResponse()
+{
     std::lock_guard customDataChannelLockGuard(m_customDataChannelLock);
     if (m_customDataChannel)
     {
@@ -804,6 +1207,107 @@ void SamplePlayerMain::OnCustomDataChannelDataReceived()
     }
 }
 
+void SamplePlayerMain::SendFrameStatistics()
+{
+    // Message layout expected by BitrateController on the remote side.
+    struct FrameStatisticsMessage
+    {
+        uint8_t type = 2;
+        uint8_t reserved[3] = {};
+        uint32_t framesPresented = 0;
+        uint32_t videoFramesReceived = 0;
+        uint32_t videoFramesSkipped = 0;
+        uint32_t videoFramesDiscarded = 0;
+        float latencyAvg = 0.0f;
+    };
+    static_assert(sizeof(FrameStatisticsMessage) == 24);
+
+    const PlayerFrameStatisticsHelper::WindowStatistics windowStatistics = m_statisticsHelper.GetLastWindowStatistics();
+
+    FrameStatisticsMessage message;
+    message.framesPresented = windowStatistics.framesPresented;
+    message.videoFramesReceived = windowStatistics.videoFramesReceived;
+    message.videoFramesSkipped = windowStatistics.videoFramesSkipped;
+    message.videoFramesDiscarded = windowStatistics.videoFramesDiscarded;
+    message.latencyAvg = windowStatistics.latencyAvg;
+
+    std::lock_guard customDataChannelLockGuard(m_customDataChannelLock);
+    if (m_customDataChannel)
+    {
+        // The statistics are only useful while they are recent, don't add to an already congested send queue.
+        if (m_customDataChannel.SendQueueSize() < 1 * 1024 * 1024)
+        {
+            try
+            {
+                m_customDataChannel.SendData(
+                    winrt::array_view<const uint8_t>(
+                        reinterpret_cast<const uint8_t*>(&message), reinterpret_cast<const uint8_t*>(&message + 1)),
+                    false);
+            }
+            catch (...)
+            {
+                // SendData might throw if channel is closed, but we did not get or process the async closed event yet.
+            }
+        }
+    }
+}
+
+void SamplePlayerMain::EchoLatencyProbe(winrt::array_view<const uint8_t> message)
+{
+    // Taken first, the time until the probe is echoed is subtracted from the round trip on the remote side.
+    const int64_t receiveTime = GetSteadyClockMicroseconds();
+
+    if (message.size() != sizeof(LatencyProbeMessage))
+    {
+        return;
+    }
+
+    // Copied to get a properly aligned structure, which is sent back with the times of this side filled in.
+    LatencyProbeMessage probe;
+    memcpy(&probe, message.data(), sizeof(probe));
+    probe.playerReceiveTime = receiveTime;
+
+    {
+        std::lock_guard customDataChannelLockGuard(m_customDataChannelLock);
+        if (m_customDataChannel && m_customDataChannel.SendQueueSize() < 1 * 1024 * 1024)
+        {
+            try
+            {
+                // Unreliable like the probe itself, a lost echo is replaced by the next probe.
+                probe.playerSendTime = GetSteadyClockMicroseconds();
+                m_customDataChannel.SendData(
+                    winrt::array_view<const uint8_t>(
+                        reinterpret_cast<const uint8_t*>(&probe), reinterpret_cast<const uint8_t*>(&probe + 1)),
+                    false);
+            }
+            catch (...)
+            {
+                // SendData might throw if channel is closed, but we did not get or process the async closed event yet.
+            }
+        }
+    }
+
+    // The probe carries the latest estimates of the remote side, which are shown below the statistics.
+    if (probe.roundTripTime != 0)
+    {
+        wchar_t latencyText[96];
+        swprintf_s(
+            latencyText,
+            L"Network: %.1f ms round trip, %.1f ms to player, %.1f ms back",
+            probe.roundTripTime / 1000.0f,
+            probe.toPlayerTime / 1000.0f,
+            probe.toRemoteTime / 1000.0f);
+
+        PostToRenderThread([this, text = std::wstring(latencyText)]() {
+            m_latencyText = text;
+            if (m_latencyLineIndex)
+            {
+                m_statusDisplay->UpdateLineText(*m_latencyLineIndex, m_latencyText);
+            }
+        });
+    }
+}
+
 void SamplePlayerMain::OnCustomDataChannelClosed()
 {
     std::lock_guard customDataChannelLockGuard(m_customDataChannelLock);
@@ -818,12 +1322,37 @@ void SamplePlayerMain::OnCustomDataChannelClosed()
 
 void SamplePlayerMain::OnConnected()
 {
+    PostToRenderThread([this]() { OnConnectedOnRenderThread(); });
+}
+
+void SamplePlayerMain::OnConnectedOnRenderThread()
+{
+    m_startupTimeline.Mark(StartupTimeline::Milestone::Connected);
+    m_connectionFailures = 0;
+
     m_errorHelper.ClearErrors();
     UpdateStatusDisplay();
+
+    if (m_playerOptions.m_traceStatistics)
+    {
+        // Write one trace file per connection into the local app data folder.
+        const bool binary = m_playerOptions.m_traceFormat == PlayerFrameStatisticsTrace::ExportFormat::Binary;
+        const auto timestamp = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch());
+        std::wstring fileName = std::wstring(winrt::Windows::Storage::ApplicationData::Current().LocalFolder().Path()) +
+                                L"\\FrameStatistics_" + std::to_wstring(timestamp.count()) + (binary ? L".bin" : L".csv");
+        m_statisticsHelper.GetTrace().StartExport(fileName, m_playerOptions.m_traceFormat);
+    }
 }
 
 void SamplePlayerMain::OnDisconnected(ConnectionFailureReason reason)
 {
+    PostToRenderThread([this, reason]() { OnDisconnectedOnRenderThread(reason); });
+}
+
+void SamplePlayerMain::OnDisconnectedOnRenderThread(ConnectionFailureReason reason)
+{
+    m_statisticsHelper.GetTrace().StopExport();
+
     m_errorHelper.ClearErrors();
     bool error = m_errorHelper.ProcessOnDisconnect(reason);
 
@@ -833,7 +1362,7 @@ void SamplePlayerMain::OnDisconnected(ConnectionFailureReason reason)
 
     if (error)
     {
-        ConnectOrListenAfter(1s);
+        ConnectOrListenAfterFailure();
         return;
     }
 
@@ -850,29 +1379,23 @@ void SamplePlayerMain::OnRequestRenderTargetSize(
     std::lock_guard lock{m_renderTargetSizeChangeMutex};
     m_needRenderTargetSizeChange = true;
     m_newRenderTargetSize = providedSize;
+    m_renderTargetSizeChangeTime = std::chrono::steady_clock::now();
 }
 
 #pragma region Spatial locator event handlers
 
 void SamplePlayerMain::OnLocatabilityChanged(const SpatialLocator& sender, const winrt::Windows::Foundation::IInspectable& args)
 {
-    bool wasTrackingLost = m_trackingLost;
-
-    switch (sender.Locatability())
-    {
-        case SpatialLocatability::PositionalTrackingActive:
-            m_trackingLost = false;
-            break;
-
-        default:
-            m_trackingLost = true;
-            break;
-    }
+    const bool trackingLost = sender.Locatability() != SpatialLocatability::PositionalTrackingActive;
+    PostToRenderThread([this, trackingLost]() {
+        bool wasTrackingLost = m_trackingLost;
+        m_trackingLost = trackingLost;
 
-    if (m_statusDisplay && m_trackingLost != wasTrackingLost)
-    {
-        UpdateStatusDisplay();
-    }
+        if (m_statusDisplay && m_trackingLost != wasTrackingLost)
+        {
+            UpdateStatusDisplay();
+        }
+    });
 }
 
 #pragma endregion Spatial locator event handlers
@@ -881,41 +1404,61 @@ void SamplePlayerMain::OnLocatabilityChanged(const SpatialLocator& sender, const
 
 void SamplePlayerMain::OnViewActivated(const CoreApplicationView& sender, const IActivatedEventArgs& activationArgs)
 {
-    PlayerOptions playerOptionsNew = ParseActivationArgs(activationArgs);
+    // The player options are used by the frame loop, so they are parsed and applied on the render thread.
+    PostToRenderThread([this, activationArgs]() {
+        PlayerOptions playerOptionsNew = ParseActivationArgs(activationArgs);
 
-    // Prevent diagnostics to be turned off everytime the app went to background.
-    if (activationArgs.PreviousExecutionState() != ApplicationExecutionState::NotRunning)
-    {
-        if (!playerOptionsNew.m_showStatistics)
+        // Prevent diagnostics to be turned off everytime the app went to background.
+        if (activationArgs.PreviousExecutionState() != ApplicationExecutionState::NotRunning)
         {
-            playerOptionsNew.m_showStatistics = m_playerOptions.m_showStatistics;
+            if (!playerOptionsNew.m_showStatistics)
+            {
+                playerOptionsNew.m_showStatistics = m_playerOptions.m_showStatistics;
+            }
         }
-    }
 
-    m_playerOptions = playerOptionsNew;
+        m_playerOptions = playerOptionsNew;
+        m_startupTimeline.Mark(StartupTimeline::Milestone::Activated);
 
-    if (m_playerContext.ConnectionState() == ConnectionState::Disconnected)
-    {
-        // Try to connect to or listen on the provided hostname/port
-        ConnectOrListen();
-    }
-    else
-    {
-        UpdateStatusDisplay();
-    }
+        // The address family may have changed, so the address is read again by the next frame.
+        m_deviceIpGeneration.reset();
+        UpdateAddressLine();
+
+        if (m_playerContext.ConnectionState() == ConnectionState::Disconnected)
+        {
+            // Try to connect to or listen on the provided hostname/port
+            ConnectOrListen();
+        }
+        else
+        {
+            UpdateStatusDisplay();
+        }
+    });
 
     sender.CoreWindow().Activate();
 }
 
 void SamplePlayerMain::OnSuspending(const winrt::Windows::Foundation::IInspectable& sender, const SuspendingEventArgs& args)
 {
-    m_deviceResources->Trim();
-
-    // Disconnect when app is about to suspend.
-    if (m_playerContext.ConnectionState() != ConnectionState::Disconnected)
+    if (!m_renderThread.joinable())
     {
-        m_playerContext.Disconnect();
+        return;
     }
+
+    // The device context is used by the render thread, so the device is trimmed there. The app must not be suspended before.
+    std::promise<void> trimmed;
+    PostToRenderThread([this, &trimmed]() {
+        m_deviceResources->Trim();
+
+        // Disconnect when app is about to suspend.
+        if (m_playerContext.ConnectionState() != ConnectionState::Disconnected)
+        {
+            m_playerContext.Disconnect();
+        }
+
+        trimmed.set_value();
+    });
+    trimmed.get_future().wait();
 }
 
 #pragma endregion Application lifecycle event handlers
@@ -924,7 +1467,7 @@ void SamplePlayerMain::OnSuspending(const winrt::Windows::Foundation::IInspectab
 
 void SamplePlayerMain::OnVisibilityChanged(const CoreWindow& sender, const VisibilityChangedEventArgs& args)
 {
-    m_windowVisible = args.Visible();
+    PostToRenderThread([this, visible = args.Visible()]() { m_windowVisible = visible; });
 }
 
 void SamplePlayerMain::OnWindowClosed(const CoreWindow& sender, const CoreWindowEventArgs& args)
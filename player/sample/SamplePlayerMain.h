@@ -13,15 +13,22 @@
 
 // #define ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
 
+#include "../common/Content/DDSTextureStreamer.h"
 #include "../common/Content/ErrorHelper.h"
 #include "../common/Content/StatusDisplay.h"
+#include "../common/DataChannelDispatcher.h"
 #include "../common/DeviceResourcesUWP.h"
 #include "../common/IpAddressUpdater.h"
 #include "../common/PlayerFrameStatisticsHelper.h"
+#include "../common/StartupTimeline.h"
 
 #include <winrt/Microsoft.Holographic.AppRemoting.h>
 
 #include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <optional>
+#include <thread>
 
 class SamplePlayerMain : public winrt::implements<
                              SamplePlayerMain,
@@ -39,6 +46,10 @@ public:
     // Try to (re-)connect to or listen on the hostname/port, that was set during activation of the app after a certain amount of time
     winrt::fire_and_forget ConnectOrListenAfter(std::chrono::system_clock::duration time);
 
+    // Try to (re-)connect after a failed attempt. The delay starts at the configured reconnect delay and doubles with each
+    // consecutive failure, up to the configured maximum.
+    void ConnectOrListenAfterFailure();
+
     // Starts the holographic frame and updates the content.
     winrt::Windows::Graphics::Holographic::HolographicFrame
         Update(float deltaTimeInSeconds, const winrt::Windows::Graphics::Holographic::HolographicFrame& prevHolographicFrame);
@@ -69,7 +80,13 @@ private:
         uint16_t m_port = 0;
         bool m_listen = true;
         bool m_showStatistics = false;
+        bool m_traceStatistics = false;
+        PlayerFrameStatisticsTrace::ExportFormat m_traceFormat = PlayerFrameStatisticsTrace::ExportFormat::Csv;
         bool m_ipv6 = false;
+
+        // Delay of the first reconnect after a failure, and the maximum the delay backs off to after consecutive failures.
+        std::chrono::milliseconds m_reconnectDelay{1000};
+        std::chrono::milliseconds m_maxReconnectDelay{1000};
     };
 
 private:
@@ -82,14 +99,42 @@ private:
     // Setup the text display to show the connection info text
     void UpdateStatusDisplay();
 
+    // Formats the address line of the status display, after the device IP address or the player options changed
+    void UpdateAddressLine();
+
+    // Updates the values of the statistics line in place, if the status display currently shows it
+    bool UpdateStatisticsLine();
+
+    // Shows the recent frames as a graph above the statistics, called every frame while the statistics are shown
+    void UpdateFrameGraph();
+
+    // Runs the holographic frame loop and the commands posted to it until StopRenderThread is called
+    void RenderThread();
+    void StopRenderThread();
+
+    // Runs the command on the render thread before its next frame. The state used by the frame loop is only changed this way.
+    void PostToRenderThread(std::function<void()> command);
+
 #ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
-    void OnCustomDataChannelDataReceived();
+    void OnCustomDataChannelDataReceived(winrt::array_view<const uint8_t> dataView);
     void OnCustomDataChannelClosed();
+
+    // Sends an artificial response to a message of the remote side.
+    void SendCustomDataChannelResponse();
+
+    // Sends a latency probe of the remote side back with the times it was received and sent, and shows the latency the
+    // remote side estimated from the previous probes.
+    void EchoLatencyProbe(winrt::array_view<const uint8_t> message);
+
+    // Sends the statistics of the last 1s window to the remote side, which uses them to adapt the stream bitrate.
+    void SendFrameStatistics();
 #endif
 
-    // PlayerContext event handlers
+    // PlayerContext event handlers. The connection handlers post their work to the render thread.
     void OnConnected();
     void OnDisconnected(winrt::Microsoft::Holographic::AppRemoting::ConnectionFailureReason reason);
+    void OnConnectedOnRenderThread();
+    void OnDisconnectedOnRenderThread(winrt::Microsoft::Holographic::AppRemoting::ConnectionFailureReason reason);
     void OnRequestRenderTargetSize(winrt::Windows::Foundation::Size requestedSize, winrt::Windows::Foundation::Size providedSize);
 
     // SpatialLocator event handlers
@@ -127,36 +172,66 @@ private:
     // Renders a AppRemoting logo together with the connection state and IP address
     std::unique_ptr<StatusDisplay> m_statusDisplay;
 
-    // Texture holding the AppRemoting logo
-    winrt::com_ptr<ID3D11Resource> m_logoImage;
+    // Streams in the texture holding the AppRemoting logo
+    std::unique_ptr<DDSTextureStreamer> m_logoStreamer;
 
-    // The IP address of the device the player is running on
-    winrt::hstring m_deviceIp = L"127.0.0.1";
+    // The IP address of the device the player is running on, the generation of m_ipAddressUpdater it was read at, and the
+    // address line of the status display formatted from it. The address is empty until the first enumeration completed.
+    winrt::hstring m_deviceIp;
+    std::optional<uint64_t> m_deviceIpGeneration;
+    std::wstring m_addressLine;
 
     // Monitors and provides the IP address of the device the player is running on
     IpAddressUpdater m_ipAddressUpdater;
 
     // Accumulates and provides remote frame statistics
     PlayerFrameStatisticsHelper m_statisticsHelper;
+    PlayerFrameStatisticsHelper::StatisticsText m_statisticsText;
+    std::optional<size_t> m_statisticsLineIndex;
+    // Startup summary line of the status display, shown below the statistics and completed once the first remote frame is blitted.
+    std::optional<size_t> m_startupLineIndex;
+    // Memory usage line of the status display, shown below the statistics and refreshed with them.
+    std::optional<size_t> m_memoryLineIndex;
+    // Reused by UpdateFrameGraph.
+    std::vector<StatusDisplay::GraphQuad> m_frameGraphQuads;
     ErrorHelper m_errorHelper;
 
+    // When the startup and connection milestones were reached, written to the debug output once the first remote frame is blitted
+    StartupTimeline m_startupTimeline;
+
+    // Failed connection attempts since the last successful connection, which determine the next reconnect delay
+    uint32_t m_connectionFailures = 0;
+
 #ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
     std::mutex m_customDataChannelLock;
     winrt::Microsoft::Holographic::AppRemoting::IDataChannel2 m_customDataChannel = nullptr;
     winrt::Microsoft::Holographic::AppRemoting::IDataChannel2::OnDataReceived_revoker m_customChannelDataReceivedEventRevoker;
     winrt::Microsoft::Holographic::AppRemoting::IDataChannel2::OnClosed_revoker m_customChannelClosedEventRevoker;
+    DataChannelDispatcher m_customDataChannelDispatcher;
+
+    // Network latency line of the status display, shown below the statistics.
+    std::wstring m_latencyText;
+    std::optional<size_t> m_latencyLineIndex;
 #endif
 
     // Indicates that tracking has been lost
     bool m_trackingLost = false;
 
-    // CoreWindow status
+    // CoreWindow status. m_windowClosed is used by the CoreWindow thread, m_windowVisible by the render thread.
     bool m_windowClosed = false;
     bool m_windowVisible = false;
 
-    // Indicates that the remote side has successfully requested a render target size change
+    // Renders the holographic frames, while the CoreWindow thread only processes events
+    std::thread m_renderThread;
+    std::vector<std::function<void()>> m_renderCommands;
+    bool m_stopRenderThread = false;
+    std::mutex m_renderCommandsMutex;
+    std::condition_variable m_renderCommandsCondition;
+
+    // Indicates that the remote side has successfully requested a render target size change, and when it last changed the request
     bool m_needRenderTargetSizeChange = false;
     winrt::Windows::Foundation::Size m_newRenderTargetSize;
+    std::chrono::steady_clock::time_point m_renderTargetSizeChangeTime;
     std::mutex m_renderTargetSizeChangeMutex;
 
     bool m_canCommitDirect3D11DepthBuffer = false;
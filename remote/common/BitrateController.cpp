@@ -0,0 +1,135 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <pch.h>
+
+#include <BitrateController.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Number of consecutive uncongested 1 second windows before the stream quality is raised again.
+    constexpr uint32_t StableWindowsBeforeIncrease = 5;
+
+    // Latency growth over the baseline which is treated as congestion, in seconds.
+    constexpr float LatencyIncreaseThreshold = 0.015f;
+
+    // Relative bitrate change which is worth reconnecting for.
+    constexpr float SignificantBitrateChange = 0.1f;
+
+    constexpr uint32_t MinDepthDownscale = 1;
+    constexpr uint32_t MaxDepthDownscale = 4;
+} // namespace
+
+BitrateController::BitrateController(uint32_t maxBitrateKbps, uint32_t maxDepthDownscale)
+{
+    Configure(maxBitrateKbps, maxDepthDownscale);
+}
+
+void BitrateController::Configure(uint32_t maxBitrateKbps, uint32_t maxDepthDownscale)
+{
+    std::lock_guard lock(m_mutex);
+
+    m_maxBitrateKbps = std::max(maxBitrateKbps, m_minBitrateKbps);
+    m_maxDepthDownscale = std::clamp(maxDepthDownscale, MinDepthDownscale, MaxDepthDownscale);
+
+    m_bitrateKbps = m_appliedBitrateKbps = m_maxBitrateKbps;
+    m_depthDownscale = m_appliedDepthDownscale = m_maxDepthDownscale;
+    m_latencyBaseline = 0.0f;
+    m_stableWindowCount = 0;
+}
+
+BitrateController::Adjustment BitrateController::OnPlayerFrameStatistics(const PlayerFrameStatisticsMessage& statistics)
+{
+    std::lock_guard lock(m_mutex);
+
+    // Nothing was streamed during this window, so it does not say anything about the connection.
+    if (statistics.videoFramesReceived == 0)
+    {
+        return Adjustment::None;
+    }
+
+    if (m_latencyBaseline == 0.0f || statistics.latencyAvg < m_latencyBaseline)
+    {
+        m_latencyBaseline = statistics.latencyAvg;
+    }
+
+    const bool congested = statistics.videoFramesDiscarded > 0 || statistics.videoFramesSkipped * 10 > statistics.videoFramesReceived ||
+                           statistics.latencyAvg > m_latencyBaseline + LatencyIncreaseThreshold;
+
+    if (congested)
+    {
+        m_stableWindowCount = 0;
+
+        // Reduce the bitrate first. Once the bitrate reached its minimum, also reduce the depth buffer resolution.
+        if (m_bitrateKbps > m_minBitrateKbps)
+        {
+            m_bitrateKbps = std::max(m_bitrateKbps * 3 / 4, m_minBitrateKbps);
+        }
+        else if (m_depthDownscale < MaxDepthDownscale)
+        {
+            m_depthDownscale *= 2;
+        }
+        else
+        {
+            // Both are at their minimum already, there is nothing to reconfigure.
+            return Adjustment::None;
+        }
+        return Adjustment::Lowered;
+    }
+    else if (++m_stableWindowCount >= StableWindowsBeforeIncrease)
+    {
+        m_stableWindowCount = 0;
+
+        // Recover in the opposite order of the reduction.
+        if (m_depthDownscale > m_maxDepthDownscale)
+        {
+            m_depthDownscale /= 2;
+        }
+        else
+        {
+            m_bitrateKbps = std::min(m_bitrateKbps * 11 / 10, m_maxBitrateKbps);
+        }
+        return Adjustment::Raised;
+    }
+
+    return Adjustment::None;
+}
+
+uint32_t BitrateController::GetBitrateKbps() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_bitrateKbps;
+}
+
+uint32_t BitrateController::GetDepthDownscale() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_depthDownscale;
+}
+
+void BitrateController::MarkApplied()
+{
+    std::lock_guard lock(m_mutex);
+    m_appliedBitrateKbps = m_bitrateKbps;
+    m_appliedDepthDownscale = m_depthDownscale;
+}
+
+bool BitrateController::HasPendingChange() const
+{
+    std::lock_guard lock(m_mutex);
+
+    const float bitrateChange =
+        std::abs(static_cast<float>(m_bitrateKbps) - static_cast<float>(m_appliedBitrateKbps)) / static_cast<float>(m_appliedBitrateKbps);
+    return bitrateChange >= SignificantBitrateChange || m_depthDownscale != m_appliedDepthDownscale;
+}
@@ -0,0 +1,87 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+// Frame statistics the player sends over the custom data channel once per second. Contains the statistics
+// PlayerFrameStatisticsHelper accumulated over its last 1 second window. The layout must match the player.
+struct PlayerFrameStatisticsMessage
+{
+    static constexpr uint8_t Type = 2;
+
+    uint8_t type = Type;
+    uint8_t reserved[3] = {};
+    uint32_t framesPresented = 0;
+    uint32_t videoFramesReceived = 0;
+    uint32_t videoFramesSkipped = 0;
+    uint32_t videoFramesDiscarded = 0;
+    float latencyAvg = 0.0f;
+};
+static_assert(sizeof(PlayerFrameStatisticsMessage) == 24);
+
+// Chooses the video bitrate and the depth buffer stream resolution from the frame statistics reported by the player.
+// Lowers the stream quality quickly when the player discards or skips frames, or when the latency grows, and recovers
+// it slowly once the connection is stable again. Both settings can only be applied when creating a RemoteContext, so
+// the chosen settings take effect on the next connection. Shared by the holographic and the OpenXR remote, so the depth
+// resolution is expressed as downscale factor, which each of them maps to its own API.
+class BitrateController
+{
+public:
+    // How the statistics of a window changed the stream quality.
+    enum class Adjustment
+    {
+        // Also returned for a congested window while the quality is at its minimum already.
+        None,
+        Lowered,
+        // Also returned once the connection was stable for long enough while the quality is at its best already, so callers can
+        // raise settings of their own.
+        Raised,
+    };
+
+    BitrateController(uint32_t maxBitrateKbps = 20000, uint32_t maxDepthDownscale = 2);
+
+    // Sets the best stream quality the controller may choose and resets it to that quality.
+    void Configure(uint32_t maxBitrateKbps, uint32_t maxDepthDownscale = 2);
+
+    // Updates the chosen settings with the statistics of one window. Thread-safe.
+    Adjustment OnPlayerFrameStatistics(const PlayerFrameStatisticsMessage& statistics);
+
+    uint32_t GetBitrateKbps() const;
+    // 1 for the full depth buffer resolution, 2 for half and 4 for quarter resolution.
+    uint32_t GetDepthDownscale() const;
+
+    // Marks the currently chosen settings as applied to a RemoteContext.
+    void MarkApplied();
+
+    // Returns true if the chosen settings differ noticeably from the ones last applied to a RemoteContext.
+    bool HasPendingChange() const;
+
+private:
+    mutable std::mutex m_mutex;
+
+    uint32_t m_minBitrateKbps = 4000;
+    uint32_t m_maxBitrateKbps = 20000;
+    uint32_t m_maxDepthDownscale = 2;
+
+    uint32_t m_bitrateKbps = 20000;
+    uint32_t m_depthDownscale = 2;
+
+    uint32_t m_appliedBitrateKbps = 20000;
+    uint32_t m_appliedDepthDownscale = 2;
+
+    // Lowest average latency seen so far, used as reference for detecting growing latency.
+    float m_latencyBaseline = 0.0f;
+
+    uint32_t m_stableWindowCount = 0;
+};
@@ -0,0 +1,210 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#pragma once
+
+#include <compressapi.h>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <winrt/base.h>
+
+#pragma comment(lib, "Cabinet.lib")
+
+// Compresses single custom data channel messages with the XPRESS algorithm of the Windows compression API, which trades
+// ratio for speed much like LZ4. A compressed message is framed as a message of its own type, so it is batched and
+// dispatched like any other and the receiver does not need to know in advance which messages are compressed:
+//
+//   uint8_t  CompressedMessageType
+//   uint8_t  reserved[3]
+//   uint32_t size of the original message, little endian
+//   ...      the compressed original message, including its type byte
+//
+// The layout must match the player.
+namespace DataChannelCompression
+{
+    constexpr uint8_t CompressedMessageType = 0xFF;
+    constexpr size_t HeaderSize = 8;
+
+    // Smaller messages hardly ever compress by more than the header adds.
+    constexpr size_t MinCompressedMessageSize = 256;
+
+    // Original messages are limited to the size of a single message of DataChannelSender, which also protects the receiver
+    // from allocating for a malformed size.
+    constexpr size_t MaxOriginalMessageSize = UINT16_MAX;
+
+    // Compresses messages on a single thread. Creating a compressor allocates its work buffers, so a thread keeps its compressor.
+    class Compressor
+    {
+    public:
+        Compressor()
+        {
+            if (!CreateCompressor(COMPRESS_ALGORITHM_XPRESS | COMPRESS_RAW, nullptr, &m_handle))
+            {
+                m_handle = nullptr;
+            }
+        }
+
+        ~Compressor()
+        {
+            if (m_handle)
+            {
+                CloseCompressor(m_handle);
+            }
+        }
+
+        Compressor(const Compressor&) = delete;
+        Compressor& operator=(const Compressor&) = delete;
+
+        // Frames the compressed message. Returns false if that would not make the message smaller, then framed is unspecified.
+        bool Compress(winrt::array_view<const uint8_t> message, std::vector<uint8_t>& framed)
+        {
+            if (!m_handle || message.size() <= HeaderSize || message.size() > MaxOriginalMessageSize)
+            {
+                return false;
+            }
+
+            // The compressed data has to be smaller than the original minus the header, otherwise compression fails with an
+            // insufficient buffer, which is just as good an answer.
+            framed.resize(message.size() - 1);
+            SIZE_T compressedSize = 0;
+            if (!::Compress(
+                    m_handle,
+                    message.data(),
+                    message.size(),
+                    framed.data() + HeaderSize,
+                    framed.size() - HeaderSize,
+                    &compressedSize))
+            {
+                return false;
+            }
+
+            const uint32_t originalSize = static_cast<uint32_t>(message.size());
+            framed[0] = CompressedMessageType;
+            framed[1] = framed[2] = framed[3] = 0;
+            for (int i = 0; i < 4; ++i)
+            {
+                framed[4 + i] = static_cast<uint8_t>(originalSize >> (8 * i));
+            }
+            framed.resize(HeaderSize + compressedSize);
+            return true;
+        }
+
+    private:
+        COMPRESSOR_HANDLE m_handle = nullptr;
+    };
+
+    // Decompresses framed messages into pooled buffers, so after the first few messages nothing is allocated unless a message
+    // is larger than all before. Thread-safe, every concurrent call uses a decompressor and a buffer of its own.
+    class Decompressor
+    {
+    public:
+        Decompressor() = default;
+        Decompressor(const Decompressor&) = delete;
+        Decompressor& operator=(const Decompressor&) = delete;
+
+        // Calls consume with a view of the original message, which is only valid during the call. Returns false if the message
+        // is malformed.
+        template <typename F>
+        bool Decompress(winrt::array_view<const uint8_t> framed, F&& consume)
+        {
+            if (framed.size() <= HeaderSize || framed[0] != CompressedMessageType)
+            {
+                return false;
+            }
+
+            uint32_t originalSize = 0;
+            for (int i = 0; i < 4; ++i)
+            {
+                originalSize |= static_cast<uint32_t>(framed[4 + i]) << (8 * i);
+            }
+            if (originalSize == 0 || originalSize > MaxOriginalMessageSize)
+            {
+                return false;
+            }
+
+            std::unique_ptr<Entry> entry = Acquire();
+            if (!entry->handle)
+            {
+                return false;
+            }
+
+            entry->buffer.resize(originalSize);
+            SIZE_T decompressedSize = 0;
+            const bool decompressed = ::Decompress(
+                                          entry->handle,
+                                          framed.data() + HeaderSize,
+                                          framed.size() - HeaderSize,
+                                          entry->buffer.data(),
+                                          entry->buffer.size(),
+                                          &decompressedSize) &&
+                                      decompressedSize == originalSize;
+            if (decompressed)
+            {
+                consume(winrt::array_view<const uint8_t>(entry->buffer.data(), entry->buffer.data() + originalSize));
+            }
+
+            Release(std::move(entry));
+            return decompressed;
+        }
+
+    private:
+        struct Entry
+        {
+            Entry()
+            {
+                if (!CreateDecompressor(COMPRESS_ALGORITHM_XPRESS | COMPRESS_RAW, nullptr, &handle))
+                {
+                    handle = nullptr;
+                }
+            }
+
+            ~Entry()
+            {
+                if (handle)
+                {
+                    CloseDecompressor(handle);
+                }
+            }
+
+            DECOMPRESSOR_HANDLE handle = nullptr;
+            std::vector<uint8_t> buffer;
+        };
+
+        std::unique_ptr<Entry> Acquire()
+        {
+            {
+                std::lock_guard lock(m_mutex);
+                if (!m_pool.empty())
+                {
+                    std::unique_ptr<Entry> entry = std::move(m_pool.back());
+                    m_pool.pop_back();
+                    return entry;
+                }
+            }
+            return std::make_unique<Entry>();
+        }
+
+        void Release(std::unique_ptr<Entry> entry)
+        {
+            std::lock_guard lock(m_mutex);
+            m_pool.push_back(std::move(entry));
+        }
+
+        std::mutex m_mutex;
+        std::vector<std::unique_ptr<Entry>> m_pool;
+    };
+} // namespace DataChannelCompression
@@ -0,0 +1,100 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <DataChannelCompression.h>
+
+#include <array>
+#include <functional>
+
+#include <winrt/base.h>
+
+// Routes messages received over a custom data channel to the handler registered for their type, the first byte of a
+// message. Handlers get a view of the received data, which is only valid during the call; nothing is copied or allocated
+// per message. Messages compressed by DataChannelSender are decompressed into pooled buffers and dispatched like the others,
+// which is why DataChannelCompression::CompressedMessageType cannot be used as the type of an application message.
+class DataChannelDispatcher
+{
+public:
+    using Handler = std::function<void(winrt::array_view<const uint8_t> message)>;
+
+    // Messages without a handler for their type go to the default handler, if there is one.
+    void Register(uint8_t type, Handler handler)
+    {
+        m_handlers[type] = std::move(handler);
+    }
+
+    void SetDefaultHandler(Handler handler)
+    {
+        m_defaultHandler = std::move(handler);
+    }
+
+    // Dispatches a packet containing a single message.
+    void Dispatch(winrt::array_view<const uint8_t> message) const
+    {
+        if (message.empty())
+        {
+            return;
+        }
+
+        if (message[0] == DataChannelCompression::CompressedMessageType)
+        {
+            m_decompressor.Decompress(message, [this](winrt::array_view<const uint8_t> original) {
+                // A compressed message never contains another one.
+                if (original[0] != DataChannelCompression::CompressedMessageType)
+                {
+                    Dispatch(original);
+                }
+            });
+            return;
+        }
+
+        const Handler& handler = m_handlers[message[0]] ? m_handlers[message[0]] : m_defaultHandler;
+        if (handler)
+        {
+            handler(message);
+        }
+    }
+
+    // Dispatches the messages of a packet batched by DataChannelSender, each prefixed with its size as little endian uint16_t.
+    // Returns false if the packet is malformed, the messages before the malformed part are dispatched nevertheless.
+    bool DispatchBatch(winrt::array_view<const uint8_t> batch) const
+    {
+        const uint8_t* data = batch.data();
+        const uint8_t* end = data + batch.size();
+        while (data != end)
+        {
+            if (end - data < 2)
+            {
+                return false;
+            }
+
+            const size_t size = data[0] | (static_cast<size_t>(data[1]) << 8);
+            data += 2;
+            if (static_cast<size_t>(end - data) < size)
+            {
+                return false;
+            }
+
+            Dispatch(winrt::array_view<const uint8_t>(data, data + size));
+            data += size;
+        }
+        return true;
+    }
+
+private:
+    std::array<Handler, 256> m_handlers;
+    Handler m_defaultHandler;
+
+    // Dispatching does not change which handler a message goes to, only the decompressor is shared by concurrent calls.
+    mutable DataChannelCompression::Decompressor m_decompressor;
+};
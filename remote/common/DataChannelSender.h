@@ -0,0 +1,110 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <DataChannelCompression.h>
+#include <Utils.h>
+
+#include <bitset>
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include <winrt/base.h>
+
+// Sends application messages over a custom data channel.
+// Messages can be enqueued from any thread. Flush coalesces the queued messages into batches of up to MaxBatchSize bytes
+// and sends them, reliable messages first. Sending is paced by the send queue size of the channel: a flush only sends
+// as much as fits below the send queue limit. Reliable messages which did not fit stay queued for the next flush,
+// unreliable ones are dropped, as newer messages supersede them.
+//
+// Each batch is a sequence of messages, every message prefixed with its size as little endian uint16_t. Messages of at least
+// DataChannelCompression::MinCompressedMessageSize bytes are compressed when that makes them smaller, unless compression is
+// disabled for their type. The receiver must use a DataChannelDispatcher which decompresses them, like the sample player does.
+class DataChannelSender
+{
+public:
+    enum class Lane
+    {
+        Reliable,
+        Unreliable
+    };
+
+    // Keeps a batch within a single network packet.
+    static constexpr size_t MaxBatchSize = 1200;
+
+    // Messages larger than a batch are sent in a batch of their own.
+    static constexpr size_t MaxMessageSize = UINT16_MAX;
+
+    using SendFunction = std::function<void(winrt::array_view<const uint8_t> batch, bool guaranteedDelivery)>;
+
+    struct Statistics
+    {
+        uint64_t messagesSent = 0;
+        uint64_t batchesSent = 0;
+        uint64_t messagesDropped = 0;
+        uint64_t messagesCompressed = 0;
+        uint64_t bytesSavedByCompression = 0;
+    };
+
+    DataChannelSender(uint32_t sendQueueLimit = 256 * 1024);
+
+    // Thread-safe. Returns false if the message is empty or larger than MaxMessageSize.
+    bool Enqueue(Lane lane, winrt::array_view<const uint8_t> message);
+
+    // Sends queued messages while the send queue of the channel stays below the limit. Must be called regularly, e.g. once
+    // per frame, always from the same thread.
+    void Flush(uint32_t sendQueueSize, const SendFunction& send);
+
+    // Drops all queued messages, e.g. after the channel was closed. Must be called from the thread calling Flush.
+    void Clear();
+
+    // Disables compression for messages whose payload does not compress, e.g. encoded images, to not waste time trying. Must be
+    // called from the thread calling Flush.
+    void SetCompressionEnabled(uint8_t type, bool enabled)
+    {
+        m_uncompressedTypes[type] = !enabled;
+    }
+
+    // Must be called from the thread calling Flush.
+    const Statistics& GetStatistics() const
+    {
+        return m_statistics;
+    }
+
+private:
+    using Message = std::vector<uint8_t>;
+
+    void MovePushedMessages();
+
+    // Replaces the message with its compressed form if it is worth it.
+    void TryCompress(Message& message);
+
+    // Appends messages of the lane to batches and sends them until the lane is empty or the budget is used up.
+    void SendLane(Lane lane, size_t& budget, const SendFunction& send);
+
+    const uint32_t m_sendQueueLimit;
+
+    Utils::MpscQueue<std::pair<Lane, Message>> m_pushedMessages;
+
+    // Messages waiting to be sent, only accessed by the thread calling Flush.
+    std::deque<Message> m_reliableMessages;
+    std::deque<Message> m_unreliableMessages;
+    std::vector<uint8_t> m_batch;
+
+    // Messages are compressed by the thread calling Flush, after they were queued, so Enqueue stays cheap.
+    std::bitset<256> m_uncompressedTypes;
+    DataChannelCompression::Compressor m_compressor;
+    Message m_compressed;
+
+    Statistics m_statistics;
+};
@@ -0,0 +1,107 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <pch.h>
+
+#include <FrameProfiler.h>
+
+#include <algorithm>
+#include <array>
+
+#include <TraceLoggingProvider.h>
+
+namespace
+{
+    // The GUID is derived from the provider name, so trace sessions can enable the provider as *HolographicRemotingSamples.FrameProfiler.
+    TRACELOGGING_DEFINE_PROVIDER(
+        s_provider,
+        "HolographicRemotingSamples.FrameProfiler",
+        (0x892e0b51, 0x7540, 0x550c, 0x55, 0xf1, 0x20, 0xa2, 0x8e, 0x32, 0xbb, 0x8f));
+
+    struct ThreadZones
+    {
+        std::array<FrameProfiler::Zone, FrameProfiler::ZonesPerThread> zones;
+        uint64_t count = 0;
+        uint32_t depth = 0;
+    };
+
+    thread_local ThreadZones t_threadZones;
+
+    int64_t Now()
+    {
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        return counter.QuadPart;
+    }
+
+    int64_t Frequency()
+    {
+        static const int64_t frequency = [] {
+            LARGE_INTEGER frequency;
+            QueryPerformanceFrequency(&frequency);
+            return frequency.QuadPart;
+        }();
+        return frequency;
+    }
+} // namespace
+
+namespace FrameProfiler
+{
+    void Initialize()
+    {
+        TraceLoggingRegister(s_provider);
+    }
+
+    void Shutdown()
+    {
+        TraceLoggingUnregister(s_provider);
+    }
+
+    size_t CopyRecentZones(Zone* zones, size_t maxZones)
+    {
+        const ThreadZones& threadZones = t_threadZones;
+        const size_t count = static_cast<size_t>(std::min<uint64_t>(threadZones.count, std::min(ZonesPerThread, maxZones)));
+        for (size_t i = 0; i < count; ++i)
+        {
+            zones[i] = threadZones.zones[(threadZones.count - count + i) % ZonesPerThread];
+        }
+        return count;
+    }
+
+    double TicksToMilliseconds(int64_t ticks)
+    {
+        return static_cast<double>(ticks) * 1000.0 / static_cast<double>(Frequency());
+    }
+
+    ScopedZone::ScopedZone(const char* name)
+        : m_name(name)
+        , m_depth(t_threadZones.depth++)
+    {
+        m_begin = Now();
+    }
+
+    ScopedZone::~ScopedZone()
+    {
+        const int64_t end = Now();
+
+        ThreadZones& threadZones = t_threadZones;
+        threadZones.depth = m_depth;
+        threadZones.zones[threadZones.count++ % ZonesPerThread] = {m_name, m_begin, end, m_depth};
+
+        TraceLoggingWrite(
+            s_provider,
+            "Zone",
+            TraceLoggingString(m_name, "Name"),
+            TraceLoggingUInt32(m_depth, "Depth"),
+            TraceLoggingInt64(m_begin, "BeginTicks"),
+            TraceLoggingFloat64(TicksToMilliseconds(end - m_begin), "DurationMs"));
+    }
+} // namespace FrameProfiler
@@ -0,0 +1,75 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Define ENABLE_FRAME_PROFILER as 0 to compile out all profiler zones.
+#ifndef ENABLE_FRAME_PROFILER
+#define ENABLE_FRAME_PROFILER 1
+#endif
+
+// Lightweight CPU profiler for the phases of a frame.
+// A zone measures the time of the scope it is declared in. Finished zones are kept in a fixed size ring buffer of the thread which
+// recorded them and, while a trace session listens to the provider "HolographicRemotingSamples.FrameProfiler", are written as
+// TraceLogging events, which can be inspected in WPA or PIX. Recording a zone takes two timestamp reads and never allocates or locks.
+namespace FrameProfiler
+{
+    struct Zone
+    {
+        // Must point to a string literal.
+        const char* name;
+        // QueryPerformanceCounter ticks.
+        int64_t begin;
+        int64_t end;
+        // Number of enclosing zones on the same thread.
+        uint32_t depth;
+    };
+
+    // Number of zones each thread keeps.
+    constexpr size_t ZonesPerThread = 256;
+
+    // Registers and unregisters the TraceLogging provider. Zones are recorded to the ring buffers regardless.
+    void Initialize();
+    void Shutdown();
+
+    // Copies up to maxZones of the most recently finished zones of the calling thread, oldest first. Returns the number of zones copied.
+    size_t CopyRecentZones(Zone* zones, size_t maxZones);
+
+    double TicksToMilliseconds(int64_t ticks);
+
+    class ScopedZone
+    {
+    public:
+        explicit ScopedZone(const char* name);
+        ~ScopedZone();
+
+        ScopedZone(const ScopedZone&) = delete;
+        ScopedZone& operator=(const ScopedZone&) = delete;
+
+    private:
+        const char* m_name;
+        int64_t m_begin;
+        uint32_t m_depth;
+    };
+} // namespace FrameProfiler
+
+#define FRAME_PROFILER_CONCAT_IMPL(a, b) a##b
+#define FRAME_PROFILER_CONCAT(a, b) FRAME_PROFILER_CONCAT_IMPL(a, b)
+
+#if ENABLE_FRAME_PROFILER
+// Measures the rest of the enclosing scope as a zone with the given string literal as name.
+#define FRAME_PROFILER_ZONE(name) FrameProfiler::ScopedZone FRAME_PROFILER_CONCAT(frameProfilerZone, __LINE__)(name)
+#else
+#define FRAME_PROFILER_ZONE(name)
+#endif
@@ -0,0 +1,113 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#include <pch.h>
+
+#include <LatencyProbe.h>
+
+#include <algorithm>
+
+namespace
+{
+    // Echoes which took longer than this are left over from a stall and would only distort the estimate.
+    constexpr int64_t MaxRoundTripUs = 5'000'000;
+
+    // Weight of a new sample in the smoothed estimate, like the smoothed round trip time of TCP.
+    constexpr float SmoothingFactor = 1.0f / 8.0f;
+
+    int64_t ToMicroseconds(LatencyProbe::Clock::time_point time)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(time.time_since_epoch()).count();
+    }
+
+    void Smooth(float& estimate, float sample, bool first)
+    {
+        estimate = first ? sample : estimate + (sample - estimate) * SmoothingFactor;
+    }
+} // namespace
+
+void LatencyProbe::Configure(std::chrono::milliseconds interval)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_interval = interval;
+    }
+    Reset();
+}
+
+void LatencyProbe::Reset()
+{
+    std::lock_guard lock(m_mutex);
+    m_lastSendTime.reset();
+    m_sampleCount = 0;
+    m_estimate = {};
+}
+
+std::optional<LatencyProbeMessage> LatencyProbe::TakeProbeToSend(Clock::time_point now)
+{
+    std::lock_guard lock(m_mutex);
+    if (m_interval.count() <= 0 || (m_lastSendTime && now - *m_lastSendTime < m_interval))
+    {
+        return std::nullopt;
+    }
+    m_lastSendTime = now;
+
+    LatencyProbeMessage probe;
+    probe.sequence = m_nextSequence++;
+    probe.remoteSendTime = ToMicroseconds(now);
+    if (m_estimate.valid)
+    {
+        probe.roundTripTime = static_cast<uint32_t>(m_estimate.roundTripMs * 1000.0f);
+        probe.toPlayerTime = static_cast<uint32_t>(m_estimate.toPlayerMs * 1000.0f);
+        probe.toRemoteTime = static_cast<uint32_t>(m_estimate.toRemoteMs * 1000.0f);
+    }
+    return probe;
+}
+
+void LatencyProbe::OnProbeEchoed(const LatencyProbeMessage& probe, Clock::time_point now)
+{
+    const int64_t remoteReceiveTime = ToMicroseconds(now);
+    const int64_t playerHoldTime = probe.playerSendTime - probe.playerReceiveTime;
+    const int64_t roundTrip = (remoteReceiveTime - probe.remoteSendTime) - playerHoldTime;
+    if (playerHoldTime < 0 || roundTrip < 0 || roundTrip > MaxRoundTripUs)
+    {
+        return;
+    }
+
+    Sample sample;
+    sample.roundTrip = roundTrip;
+    sample.clockOffset = ((probe.playerReceiveTime - probe.remoteSendTime) + (probe.playerSendTime - remoteReceiveTime)) / 2;
+
+    std::lock_guard lock(m_mutex);
+    m_samples[m_sampleCount % SampleWindow] = sample;
+    m_sampleCount++;
+
+    const auto samplesEnd = m_samples.begin() + std::min(m_sampleCount, SampleWindow);
+    const Sample& best = *std::min_element(
+        m_samples.begin(), samplesEnd, [](const Sample& a, const Sample& b) { return a.roundTrip < b.roundTrip; });
+
+    // The one-way times of this probe, measured with the most accurate clock offset.
+    const int64_t toPlayer = std::max<int64_t>(0, probe.playerReceiveTime - probe.remoteSendTime - best.clockOffset);
+    const int64_t toRemote = std::max<int64_t>(0, remoteReceiveTime - probe.playerSendTime + best.clockOffset);
+
+    const bool first = !m_estimate.valid;
+    Smooth(m_estimate.roundTripMs, roundTrip / 1000.0f, first);
+    Smooth(m_estimate.toPlayerMs, toPlayer / 1000.0f, first);
+    Smooth(m_estimate.toRemoteMs, toRemote / 1000.0f, first);
+    m_estimate.valid = true;
+}
+
+LatencyProbe::Estimate LatencyProbe::GetEstimate() const
+{
+    std::lock_guard lock(m_mutex);
+    return m_estimate;
+}
@@ -0,0 +1,76 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+
+#include <LatencyProbeMessage.h>
+
+// Measures the network latency between remote and player, apart from the render latency the frame statistics report.
+// Every echoed probe is a sample of the round trip time without the time the player took to echo it, and of the offset
+// between the clocks of both sides, NTP style. The offset of the sample with the shortest round trip of the recent ones is
+// the most accurate, as its queuing delay is the lowest. With that offset the round trip splits into the time to the
+// player and the time back, which differ if the network queues in one direction only. Probes are sent unreliably, a
+// retransmitted probe would measure the retransmission.
+class LatencyProbe
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Estimate
+    {
+        bool valid = false;
+        float roundTripMs = 0.0f;
+        float toPlayerMs = 0.0f;
+        float toRemoteMs = 0.0f;
+    };
+
+    // Sets the interval between probes, 0 disables the probe. Resets the estimate.
+    void Configure(std::chrono::milliseconds interval);
+
+    // Forgets the samples of a previous connection.
+    void Reset();
+
+    // Returns the probe to send if the interval elapsed since the last one. Thread-safe.
+    std::optional<LatencyProbeMessage> TakeProbeToSend(Clock::time_point now);
+
+    // Takes a sample from a probe echoed by the player, received at the given time. Thread-safe.
+    void OnProbeEchoed(const LatencyProbeMessage& probe, Clock::time_point now);
+
+    // Returns the smoothed estimate. Thread-safe.
+    Estimate GetEstimate() const;
+
+private:
+    struct Sample
+    {
+        int64_t roundTrip = 0;
+        int64_t clockOffset = 0;
+    };
+
+    static constexpr size_t SampleWindow = 8;
+
+    mutable std::mutex m_mutex;
+
+    std::chrono::milliseconds m_interval{1000};
+    std::optional<Clock::time_point> m_lastSendTime;
+    uint32_t m_nextSequence = 0;
+
+    std::array<Sample, SampleWindow> m_samples = {};
+    size_t m_sampleCount = 0;
+
+    Estimate m_estimate;
+};
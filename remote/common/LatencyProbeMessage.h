@@ -0,0 +1,38 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#pragma once
+
+#include <cstdint>
+
+// Latency probe exchanged with the player over the custom data channel. The remote sends it with its send time, the player
+// echoes it right away with the times it received and sent it. The remote also passes its latest estimates along, so the
+// player can show them. Times are in microseconds, each on the steady clock of the side which took it. The definition is
+// shared with the player.
+struct LatencyProbeMessage
+{
+    static constexpr uint8_t Type = 3;
+
+    uint8_t type = Type;
+    uint8_t reserved[3] = {};
+    uint32_t sequence = 0;
+    int64_t remoteSendTime = 0;
+    int64_t playerReceiveTime = 0;
+    int64_t playerSendTime = 0;
+
+    // Estimates of the remote in microseconds, 0 until the first probe came back.
+    uint32_t roundTripTime = 0;
+    uint32_t toPlayerTime = 0;
+    uint32_t toRemoteTime = 0;
+    uint32_t reserved2 = 0;
+};
+static_assert(sizeof(LatencyProbeMessage) == 48);
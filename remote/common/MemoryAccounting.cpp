@@ -0,0 +1,236 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#include <pch.h>
+
+#include <MemoryAccounting.h>
+
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+    constexpr size_t TagCount = static_cast<size_t>(MemoryAccounting::Tag::Count);
+
+    std::atomic<uint64_t> g_cpuBytes[TagCount] = {};
+    std::atomic<uint64_t> g_gpuBytes[TagCount] = {};
+
+    // Identifies the GpuAllocation attached to a resource.
+    // {5B1D6E7A-3C4F-4E2B-9A8D-1F0C7B6E5D42}
+    constexpr GUID GpuAllocationGuid = {0x5b1d6e7a, 0x3c4f, 0x4e2b, {0x9a, 0x8d, 0x1f, 0x0c, 0x7b, 0x6e, 0x5d, 0x42}};
+
+    // Counted while the resource it is attached to exists, the resource releases its private data when it is destroyed.
+    class GpuAllocation final : public ::IUnknown
+    {
+    public:
+        GpuAllocation(MemoryAccounting::Tag tag, uint64_t bytes)
+            : m_tag(static_cast<size_t>(tag))
+            , m_bytes(bytes)
+        {
+            g_gpuBytes[m_tag].fetch_add(m_bytes, std::memory_order_relaxed);
+        }
+
+        ~GpuAllocation()
+        {
+            g_gpuBytes[m_tag].fetch_sub(m_bytes, std::memory_order_relaxed);
+        }
+
+        HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** object) override
+        {
+            if (riid == __uuidof(::IUnknown))
+            {
+                *object = static_cast<::IUnknown*>(this);
+                AddRef();
+                return S_OK;
+            }
+            *object = nullptr;
+            return E_NOINTERFACE;
+        }
+
+        ULONG STDMETHODCALLTYPE AddRef() override
+        {
+            return ++m_refCount;
+        }
+
+        ULONG STDMETHODCALLTYPE Release() override
+        {
+            const ULONG refCount = --m_refCount;
+            if (refCount == 0)
+            {
+                delete this;
+            }
+            return refCount;
+        }
+
+    private:
+        std::atomic<ULONG> m_refCount = 1;
+        size_t m_tag;
+        uint64_t m_bytes;
+    };
+
+    // Bits per texel of the formats the samples use. Block compressed formats have the average over their blocks.
+    uint32_t GetBitsPerPixel(DXGI_FORMAT format)
+    {
+        switch (format)
+        {
+            case DXGI_FORMAT_R32G32B32A32_FLOAT:
+            case DXGI_FORMAT_R32G32B32A32_UINT:
+                return 128;
+
+            case DXGI_FORMAT_R16G16B16A16_FLOAT:
+            case DXGI_FORMAT_R16G16B16A16_UNORM:
+            case DXGI_FORMAT_R32G32_FLOAT:
+            case DXGI_FORMAT_R32G8X24_TYPELESS:
+            case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+                return 64;
+
+            case DXGI_FORMAT_R16_FLOAT:
+            case DXGI_FORMAT_R16_UNORM:
+            case DXGI_FORMAT_R16_TYPELESS:
+            case DXGI_FORMAT_D16_UNORM:
+                return 16;
+
+            case DXGI_FORMAT_R8_UNORM:
+            case DXGI_FORMAT_A8_UNORM:
+            case DXGI_FORMAT_BC2_UNORM:
+            case DXGI_FORMAT_BC2_UNORM_SRGB:
+            case DXGI_FORMAT_BC3_UNORM:
+            case DXGI_FORMAT_BC3_UNORM_SRGB:
+            case DXGI_FORMAT_BC5_UNORM:
+            case DXGI_FORMAT_BC6H_UF16:
+            case DXGI_FORMAT_BC7_UNORM:
+            case DXGI_FORMAT_BC7_UNORM_SRGB:
+                return 8;
+
+            case DXGI_FORMAT_BC1_UNORM:
+            case DXGI_FORMAT_BC1_UNORM_SRGB:
+            case DXGI_FORMAT_BC4_UNORM:
+                return 4;
+
+            default:
+                // The 32 bit color and depth formats.
+                return 32;
+        }
+    }
+
+    uint64_t GetResourceBytes(ID3D11Resource* resource)
+    {
+        D3D11_RESOURCE_DIMENSION dimension = D3D11_RESOURCE_DIMENSION_UNKNOWN;
+        resource->GetType(&dimension);
+
+        if (dimension == D3D11_RESOURCE_DIMENSION_BUFFER)
+        {
+            winrt::com_ptr<ID3D11Buffer> buffer;
+            resource->QueryInterface(IID_PPV_ARGS(buffer.put()));
+            D3D11_BUFFER_DESC desc;
+            buffer->GetDesc(&desc);
+            return desc.ByteWidth;
+        }
+
+        if (dimension == D3D11_RESOURCE_DIMENSION_TEXTURE2D)
+        {
+            winrt::com_ptr<ID3D11Texture2D> texture;
+            resource->QueryInterface(IID_PPV_ARGS(texture.put()));
+            D3D11_TEXTURE2D_DESC desc;
+            texture->GetDesc(&desc);
+
+            uint64_t texels = 0;
+            for (UINT mip = 0; mip < desc.MipLevels; ++mip)
+            {
+                texels += uint64_t{std::max(desc.Width >> mip, 1u)} * std::max(desc.Height >> mip, 1u);
+            }
+            return texels * desc.ArraySize * desc.SampleDesc.Count * GetBitsPerPixel(desc.Format) / 8;
+        }
+
+        return 0;
+    }
+} // namespace
+
+namespace MemoryAccounting
+{
+    Usage GetUsage(Tag tag)
+    {
+        const size_t index = static_cast<size_t>(tag);
+        return {g_cpuBytes[index].load(std::memory_order_relaxed), g_gpuBytes[index].load(std::memory_order_relaxed)};
+    }
+
+    Usage GetTotalUsage()
+    {
+        Usage total;
+        for (size_t i = 0; i < TagCount; ++i)
+        {
+            const Usage usage = GetUsage(static_cast<Tag>(i));
+            total.cpuBytes += usage.cpuBytes;
+            total.gpuBytes += usage.gpuBytes;
+        }
+        return total;
+    }
+
+    const wchar_t* GetTagName(Tag tag)
+    {
+        switch (tag)
+        {
+            case Tag::SurfaceMesh:
+                return L"Mesh";
+            case Tag::SceneUnderstanding:
+                return L"Scene";
+            case Tag::QRCodes:
+                return L"QR";
+            case Tag::Cameras:
+                return L"Cameras";
+            default:
+                return L"";
+        }
+    }
+
+    std::wstring FormatUsage()
+    {
+        constexpr double BytesPerMB = 1024.0 * 1024.0;
+
+        std::wstring text = L"CPU/GPU MB";
+        for (size_t i = 0; i < TagCount; ++i)
+        {
+            const Tag tag = static_cast<Tag>(i);
+            const Usage usage = GetUsage(tag);
+
+            wchar_t usageText[64];
+            swprintf_s(usageText, L" %s %.1f/%.1f", GetTagName(tag), usage.cpuBytes / BytesPerMB, usage.gpuBytes / BytesPerMB);
+            text += usageText;
+        }
+        return text;
+    }
+
+    void AddCpuBytes(Tag tag, size_t bytes)
+    {
+        g_cpuBytes[static_cast<size_t>(tag)].fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+    void RemoveCpuBytes(Tag tag, size_t bytes)
+    {
+        g_cpuBytes[static_cast<size_t>(tag)].fetch_sub(bytes, std::memory_order_relaxed);
+    }
+
+    void TrackGpuResource(Tag tag, ID3D11Resource* resource)
+    {
+        if (!resource)
+        {
+            return;
+        }
+
+        winrt::com_ptr<::IUnknown> allocation;
+        allocation.attach(new GpuAllocation(tag, GetResourceBytes(resource)));
+
+        // Replacing an earlier allocation of the resource releases it, so the resource is not counted twice. Accounting never fails
+        // the creation of a resource, if the allocation cannot be attached the resource is simply not counted.
+        resource->SetPrivateDataInterface(GpuAllocationGuid, allocation.get());
+    }
+} // namespace MemoryAccounting
@@ -0,0 +1,107 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#pragma once
+
+#include <d3d11.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Counts the memory of the content renderers and the camera resources per subsystem, so that a subsystem which keeps growing
+// over a long session shows up before the OS terminates the app. CPU memory is counted by the containers which hold the content,
+// through TrackingAllocator. GPU memory is counted per buffer or texture from its creation until it is destroyed. GPU sizes are
+// estimated from the resource descriptions, the padding and alignment of the driver are not included.
+namespace MemoryAccounting
+{
+    enum class Tag : uint32_t
+    {
+        SurfaceMesh,
+        SceneUnderstanding,
+        QRCodes,
+        Cameras,
+        Count
+    };
+
+    struct Usage
+    {
+        uint64_t cpuBytes = 0;
+        uint64_t gpuBytes = 0;
+    };
+
+    // May be called from any thread.
+    Usage GetUsage(Tag tag);
+    Usage GetTotalUsage();
+    const wchar_t* GetTagName(Tag tag);
+
+    // The CPU and GPU memory of all subsystems in one line, like "CPU/GPU MB Mesh 1.2/20.5 Scene 0.4/3.1 QR 0.0/0.1 Cameras 0.0/42.2".
+    std::wstring FormatUsage();
+
+    void AddCpuBytes(Tag tag, size_t bytes);
+    void RemoveCpuBytes(Tag tag, size_t bytes);
+
+    // Counts the resource under the tag until it is destroyed. The count is attached to the resource as private data, so it ends
+    // with the last reference to the resource, whoever holds it. A resource is only counted once, under the last tag.
+    void TrackGpuResource(Tag tag, ID3D11Resource* resource);
+
+    // Allocator of the containers which are counted under the tag.
+    template <typename T, Tag AllocationTag>
+    class TrackingAllocator
+    {
+    public:
+        using value_type = T;
+
+        template <typename U>
+        struct rebind
+        {
+            using other = TrackingAllocator<U, AllocationTag>;
+        };
+
+        TrackingAllocator() noexcept = default;
+
+        template <typename U>
+        TrackingAllocator(const TrackingAllocator<U, AllocationTag>&) noexcept
+        {
+        }
+
+        T* allocate(size_t count)
+        {
+            T* elements = std::allocator<T>().allocate(count);
+            AddCpuBytes(AllocationTag, count * sizeof(T));
+            return elements;
+        }
+
+        void deallocate(T* elements, size_t count) noexcept
+        {
+            std::allocator<T>().deallocate(elements, count);
+            RemoveCpuBytes(AllocationTag, count * sizeof(T));
+        }
+
+        template <typename U>
+        bool operator==(const TrackingAllocator<U, AllocationTag>&) const noexcept
+        {
+            return true;
+        }
+
+        template <typename U>
+        bool operator!=(const TrackingAllocator<U, AllocationTag>&) const noexcept
+        {
+            return false;
+        }
+    };
+
+    template <typename T, Tag AllocationTag>
+    using Vector = std::vector<T, TrackingAllocator<T, AllocationTag>>;
+} // namespace MemoryAccounting
@@ -0,0 +1,250 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#include <pch.h>
+
+#include <DbgLog.h>
+#include <ThreadConfiguration.h>
+
+#include <avrt.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    std::atomic<bool> g_mmcssFrameThread = true;
+
+    class WorkerPool
+    {
+    public:
+        ~WorkerPool()
+        {
+            Stop();
+        }
+
+        // Restarts the workers if they run with other settings.
+        void Configure(const ThreadConfiguration::Settings& settings)
+        {
+            {
+                std::lock_guard lock(m_mutex);
+                const bool settingsChanged =
+                    settings.workerCount != m_settings.workerCount || settings.workerAffinityMask != m_settings.workerAffinityMask;
+                m_settings = settings;
+                if (!settingsChanged && !m_threads.empty())
+                {
+                    return;
+                }
+            }
+
+            Stop();
+
+            std::lock_guard lock(m_mutex);
+            StartLocked();
+        }
+
+        void Stop()
+        {
+            std::unique_lock lock(m_mutex);
+            m_stopped.wait(lock, [this]() { return !m_stopping; });
+            if (m_threads.empty())
+            {
+                return;
+            }
+
+            // The workers stay in m_threads until they are joined, so work posted meanwhile does not start a second set of workers.
+            m_stopping = true;
+            lock.unlock();
+            m_workAvailable.notify_all();
+
+            // The workers drain the queue before they exit.
+            for (std::thread& thread : m_threads)
+            {
+                thread.join();
+            }
+
+            // Work posted after the workers drained the queue stays queued, it runs once the workers start again.
+            lock.lock();
+            m_threads.clear();
+            m_stopping = false;
+            lock.unlock();
+            m_stopped.notify_all();
+        }
+
+        void Post(std::function<void()> task)
+        {
+            {
+                std::lock_guard lock(m_mutex);
+                m_tasks.push_back(std::move(task));
+                if (m_threads.empty())
+                {
+                    StartLocked();
+                }
+            }
+            m_workAvailable.notify_one();
+        }
+
+    private:
+        // Starts the workers with the current settings, unless they are running or stopping.
+        void StartLocked()
+        {
+            if (!m_threads.empty())
+            {
+                return;
+            }
+
+            const ThreadConfiguration::Settings& settings = m_settings;
+            uint32_t workerCount = settings.workerCount;
+            if (workerCount == 0)
+            {
+                workerCount = std::max(std::thread::hardware_concurrency() / 2, 1u);
+            }
+
+            m_threads.reserve(workerCount);
+            for (uint32_t i = 0; i < workerCount; ++i)
+            {
+                m_threads.emplace_back([this, i, affinityMask = settings.workerAffinityMask]() { Run(i, affinityMask); });
+            }
+        }
+
+        void Run(uint32_t index, uint64_t affinityMask)
+        {
+            const std::wstring name = L"Content worker " + std::to_wstring(index);
+            SetThreadDescription(GetCurrentThread(), name.c_str());
+
+            // The workers only prepare content for later frames, the frame thread and the encoder go first.
+            SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL);
+
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+            if (affinityMask != 0 && SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(affinityMask)) == 0)
+            {
+                DebugLog(L"Failed to set the affinity of the worker thread to 0x%llx.\n", affinityMask);
+            }
+#else
+            (void)affinityMask;
+#endif
+
+            while (true)
+            {
+                std::function<void()> task;
+                {
+                    std::unique_lock lock(m_mutex);
+                    m_workAvailable.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+                    if (m_tasks.empty())
+                    {
+                        return;
+                    }
+                    task = std::move(m_tasks.front());
+                    m_tasks.pop_front();
+                }
+
+                task();
+            }
+        }
+
+        std::mutex m_mutex;
+        std::condition_variable m_workAvailable;
+        std::condition_variable m_stopped;
+        std::deque<std::function<void()>> m_tasks;
+        ThreadConfiguration::Settings m_settings;
+        // Only modified with m_mutex held and m_stopping false. While m_stopping is set, only Stop touches it.
+        std::vector<std::thread> m_threads;
+        bool m_stopping = false;
+    };
+
+    WorkerPool& GetWorkerPool()
+    {
+        static WorkerPool pool;
+        return pool;
+    }
+
+    // Registration of the frame thread, reverted by the destructor when the thread exits.
+    struct FrameThreadRegistration
+    {
+        ~FrameThreadRegistration()
+        {
+            if (mmcssHandle)
+            {
+                AvRevertMmThreadCharacteristics(mmcssHandle);
+            }
+        }
+
+        bool registered = false;
+        HANDLE mmcssHandle = nullptr;
+    };
+} // namespace
+
+namespace ThreadConfiguration
+{
+    void Configure(const Settings& settings)
+    {
+        g_mmcssFrameThread = settings.mmcssFrameThread;
+        GetWorkerPool().Configure(settings);
+    }
+
+    void Shutdown()
+    {
+        GetWorkerPool().Stop();
+    }
+
+    void RegisterFrameThread()
+    {
+        thread_local FrameThreadRegistration registration;
+        if (registration.registered)
+        {
+            return;
+        }
+        registration.registered = true;
+
+        if (!g_mmcssFrameThread)
+        {
+            return;
+        }
+
+        // Like the render thread of the player, the frame thread is scheduled like the one of a game.
+        DWORD taskIndex = 0;
+        registration.mmcssHandle = AvSetMmThreadCharacteristicsW(L"Games", &taskIndex);
+        if (registration.mmcssHandle)
+        {
+            AvSetMmThreadPriority(registration.mmcssHandle, AVRT_PRIORITY_HIGH);
+        }
+        else
+        {
+            DebugLog(L"Failed to register the frame thread with MMCSS (%u).\n", GetLastError());
+            SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+        }
+    }
+
+    void PostToWorker(std::function<void()> task)
+    {
+        GetWorkerPool().Post(std::move(task));
+    }
+
+    BackgroundPriorityScope::BackgroundPriorityScope()
+        : m_active(SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN) != FALSE)
+    {
+    }
+
+    BackgroundPriorityScope::~BackgroundPriorityScope()
+    {
+        if (m_active)
+        {
+            SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_END);
+        }
+    }
+} // namespace ThreadConfiguration
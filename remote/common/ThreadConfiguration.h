@@ -0,0 +1,84 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+// Threading setup of the remote, so that the frame thread and the content processing do not compete with the remoting encoder
+// on shared render servers. The frame thread is registered with the Multimedia Class Scheduler Service (MMCSS), which boosts
+// its priority while it runs. Mesh and scene processing runs on a bounded pool of worker threads instead of the system thread
+// pool, optionally restricted to some of the cores. Background file access runs at background priority, which also lowers
+// the priority of its I/O.
+namespace ThreadConfiguration
+{
+    struct Settings
+    {
+        // Registers the frame thread with MMCSS. Without, it runs at normal priority.
+        bool mmcssFrameThread = true;
+
+        // Number of worker threads, 0 uses half of the logical processors, but at least one.
+        uint32_t workerCount = 0;
+
+        // Logical processors the worker threads may run on, one bit per processor, 0 lets them run on any of them. Only
+        // applied on desktop.
+        uint64_t workerAffinityMask = 0;
+    };
+
+    // Starts the worker threads, or restarts them once the work posted so far completed if the worker settings changed. Work
+    // posted before the first call runs on the default settings. Work posted while the workers restart waits for them.
+    void Configure(const Settings& settings);
+
+    // Stops the worker threads after the work posted so far completed.
+    void Shutdown();
+
+    // Registers the calling thread as frame thread, once per thread. The registration is reverted when the thread exits.
+    void RegisterFrameThread();
+
+    // Runs the task on a worker thread.
+    void PostToWorker(std::function<void()> task);
+
+    // Resumes a coroutine on a worker thread, in place of winrt::resume_background for mesh and scene processing.
+    struct ResumeOnWorker
+    {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        template <typename CoroutineHandle>
+        void await_suspend(CoroutineHandle handle) const
+        {
+            PostToWorker([handle]() { handle(); });
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+    // Runs the calling thread at background priority while in scope, for file access which must not delay the frames. Must not
+    // span a co_await, the scope has to end on the thread it started on.
+    class BackgroundPriorityScope
+    {
+    public:
+        BackgroundPriorityScope();
+        ~BackgroundPriorityScope();
+
+        BackgroundPriorityScope(const BackgroundPriorityScope&) = delete;
+        BackgroundPriorityScope& operator=(const BackgroundPriorityScope&) = delete;
+
+    private:
+        bool m_active;
+    };
+} // namespace ThreadConfiguration
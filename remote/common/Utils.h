@@ -11,7 +11,15 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
 #include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
 
 namespace Utils
 {
@@ -34,5 +42,267 @@ namespace Utils
         }
     };
 
+    // hash function to allow for GUID as a key of unordered containers
+    struct GUIDHasher
+    {
+        size_t operator()(const GUID& guid) const
+        {
+            // GUIDs are mostly random already, so mixing their two halves is sufficient.
+            uint64_t halves[2];
+            memcpy(halves, &guid, sizeof(GUID));
+            const uint64_t hash = (halves[0] ^ (halves[1] * 0x9E3779B97F4A7C15ull)) * 0xBF58476D1CE4E5B9ull;
+            return static_cast<size_t>(hash ^ (hash >> 32));
+        }
+    };
+
+    // Map from GUID to Value which stores its entries contiguously, so iterating over all entries is a linear scan.
+    // Lookups go through an open addressing table with linear probing which holds indices into the entries.
+    // Erasing moves the last entry into the erased position, so the order of the entries is not stable.
+    // The entries and the table are both allocated through the allocator, for example to count their memory.
+    template <typename Value, typename Allocator = std::allocator<std::pair<GUID, Value>>>
+    class GUIDFlatMap
+    {
+    public:
+        using Entry = std::pair<GUID, Value>;
+        using iterator = typename std::vector<Entry, Allocator>::iterator;
+        using const_iterator = typename std::vector<Entry, Allocator>::const_iterator;
+
+        iterator begin()
+        {
+            return m_entries.begin();
+        }
+
+        iterator end()
+        {
+            return m_entries.end();
+        }
+
+        const_iterator begin() const
+        {
+            return m_entries.begin();
+        }
+
+        const_iterator end() const
+        {
+            return m_entries.end();
+        }
+
+        const_iterator cbegin() const
+        {
+            return m_entries.cbegin();
+        }
+
+        const_iterator cend() const
+        {
+            return m_entries.cend();
+        }
+
+        size_t size() const
+        {
+            return m_entries.size();
+        }
+
+        bool empty() const
+        {
+            return m_entries.empty();
+        }
+
+        void clear()
+        {
+            m_entries.clear();
+            std::fill(m_slots.begin(), m_slots.end(), EmptySlot);
+        }
+
+        iterator find(const GUID& key)
+        {
+            const size_t slot = FindKeySlot(key);
+            return slot == NoSlot ? end() : begin() + m_slots[slot];
+        }
+
+        const_iterator find(const GUID& key) const
+        {
+            const size_t slot = FindKeySlot(key);
+            return slot == NoSlot ? end() : begin() + m_slots[slot];
+        }
+
+        // Constructs a value from args if the key is not in the map yet.
+        // Returns the entry of the key and whether it was inserted.
+        template <typename... Args>
+        std::pair<iterator, bool> try_emplace(const GUID& key, Args&&... args)
+        {
+            // Keep the load factor at or below 3/4, so that probe sequences stay short.
+            if ((m_entries.size() + 1) * 4 > m_slots.size() * 3)
+            {
+                Rehash(std::max<size_t>(16, m_slots.size() * 2));
+            }
+
+            size_t slot = SlotOf(key);
+            for (; m_slots[slot] != EmptySlot; slot = NextSlot(slot))
+            {
+                if (GUIDComparer::equals(m_entries[m_slots[slot]].first, key))
+                {
+                    return {begin() + m_slots[slot], false};
+                }
+            }
+
+            m_slots[slot] = static_cast<uint32_t>(m_entries.size());
+            m_entries.emplace_back(
+                std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+            return {std::prev(m_entries.end()), true};
+        }
+
+        // Returns an iterator to the entry which took over the position of the erased one. Erasing while iterating from begin to end
+        // therefore still visits every entry exactly once.
+        iterator erase(const_iterator position)
+        {
+            const size_t index = position - m_entries.cbegin();
+            const size_t last = m_entries.size() - 1;
+
+            EraseSlot(FindIndexSlot(index));
+            if (index != last)
+            {
+                m_slots[FindIndexSlot(last)] = static_cast<uint32_t>(index);
+                m_entries[index] = std::move(m_entries[last]);
+            }
+            m_entries.pop_back();
+
+            return begin() + index;
+        }
+
+    private:
+        static constexpr uint32_t EmptySlot = UINT32_MAX;
+        static constexpr size_t NoSlot = SIZE_MAX;
+
+        size_t SlotOf(const GUID& key) const
+        {
+            return GUIDHasher()(key) & (m_slots.size() - 1);
+        }
+
+        size_t NextSlot(size_t slot) const
+        {
+            return (slot + 1) & (m_slots.size() - 1);
+        }
+
+        size_t FindKeySlot(const GUID& key) const
+        {
+            if (m_entries.empty())
+            {
+                return NoSlot;
+            }
+
+            for (size_t slot = SlotOf(key); m_slots[slot] != EmptySlot; slot = NextSlot(slot))
+            {
+                if (GUIDComparer::equals(m_entries[m_slots[slot]].first, key))
+                {
+                    return slot;
+                }
+            }
+            return NoSlot;
+        }
+
+        size_t FindIndexSlot(size_t index) const
+        {
+            size_t slot = SlotOf(m_entries[index].first);
+            while (m_slots[slot] != index)
+            {
+                slot = NextSlot(slot);
+            }
+            return slot;
+        }
+
+        // Removes a slot without leaving a tombstone by shifting back the entries of the probe sequence which follows it.
+        void EraseSlot(size_t hole)
+        {
+            const size_t mask = m_slots.size() - 1;
+
+            m_slots[hole] = EmptySlot;
+            for (size_t slot = NextSlot(hole); m_slots[slot] != EmptySlot; slot = NextSlot(slot))
+            {
+                // The entry may only move back if the hole lies between its home slot and its current slot.
+                const size_t home = SlotOf(m_entries[m_slots[slot]].first);
+                if (((slot - home) & mask) >= ((slot - hole) & mask))
+                {
+                    m_slots[hole] = m_slots[slot];
+                    m_slots[slot] = EmptySlot;
+                    hole = slot;
+                }
+            }
+        }
+
+        void Rehash(size_t slotCount)
+        {
+            m_slots.assign(slotCount, EmptySlot);
+            for (size_t index = 0; index < m_entries.size(); ++index)
+            {
+                size_t slot = SlotOf(m_entries[index].first);
+                while (m_slots[slot] != EmptySlot)
+                {
+                    slot = NextSlot(slot);
+                }
+                m_slots[slot] = static_cast<uint32_t>(index);
+            }
+        }
+
+        std::vector<Entry, Allocator> m_entries;
+        // Power of two sized table of indices into m_entries.
+        std::vector<uint32_t, typename std::allocator_traits<Allocator>::template rebind_alloc<uint32_t>> m_slots;
+    };
+
+    // Lock-free queue which any number of threads can push to and a single consumer thread drains.
+    // Pushing a value allocates a node, draining hands out all values pushed so far in push order.
+    template <typename T>
+    class MpscQueue
+    {
+    public:
+        MpscQueue() = default;
+        MpscQueue(const MpscQueue&) = delete;
+        MpscQueue& operator=(const MpscQueue&) = delete;
+
+        ~MpscQueue()
+        {
+            Drain([](T&&) {});
+        }
+
+        void Push(T value)
+        {
+            Node* node = new Node{std::move(value), m_head.load(std::memory_order_relaxed)};
+            while (!m_head.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed))
+            {
+            }
+        }
+
+        // Invokes callback with each value pushed before the call. Must only be called from the consumer thread.
+        template <typename Callback>
+        void Drain(Callback&& callback)
+        {
+            // The pushed nodes form a stack, reverse it to hand out the values in push order.
+            Node* stack = m_head.exchange(nullptr, std::memory_order_acquire);
+            Node* queue = nullptr;
+            while (stack)
+            {
+                Node* next = stack->next;
+                stack->next = queue;
+                queue = stack;
+                stack = next;
+            }
+
+            while (queue)
+            {
+                std::unique_ptr<Node> node(queue);
+                queue = node->next;
+                callback(std::move(node->value));
+            }
+        }
+
+    private:
+        struct Node
+        {
+            T value;
+            Node* next;
+        };
+
+        std::atomic<Node*> m_head = nullptr;
+    };
+
     std::wstring SplitHostnameAndPortString(const std::wstring& address, uint16_t& port);
 } // namespace Utils
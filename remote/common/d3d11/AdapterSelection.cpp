@@ -0,0 +1,135 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#include <pch.h>
+
+#include <DbgLog.h>
+#include <d3d11/AdapterSelection.h>
+
+#include <mfapi.h>
+#include <mftransform.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+    bool IsSameAdapter(const LUID& a, const LUID& b)
+    {
+        return a.LowPart == b.LowPart && a.HighPart == b.HighPart;
+    }
+
+    // Returns the adapters which have a hardware H.265 encoder. Encoders whose driver does not report their adapter are ignored.
+    std::vector<LUID> GetAdaptersWithHevcEncoder()
+    {
+        std::vector<LUID> adapters;
+
+        const MFT_REGISTER_TYPE_INFO outputType = {MFMediaType_Video, MFVideoFormat_HEVC};
+        IMFActivate** activates = nullptr;
+        UINT32 activateCount = 0;
+        if (FAILED(MFTEnumEx(
+                MFT_CATEGORY_VIDEO_ENCODER,
+                MFT_ENUM_FLAG_HARDWARE | MFT_ENUM_FLAG_SORTANDFILTER,
+                nullptr,
+                &outputType,
+                &activates,
+                &activateCount)))
+        {
+            return adapters;
+        }
+
+        for (UINT32 i = 0; i < activateCount; ++i)
+        {
+            LUID adapterLuid = {};
+            UINT32 size = 0;
+            if (SUCCEEDED(activates[i]->GetBlob(
+                    MFT_ENUM_ADAPTER_LUID, reinterpret_cast<UINT8*>(&adapterLuid), sizeof(adapterLuid), &size)) &&
+                size == sizeof(adapterLuid))
+            {
+                adapters.push_back(adapterLuid);
+            }
+            activates[i]->Release();
+        }
+        CoTaskMemFree(activates);
+
+        return adapters;
+    }
+} // namespace
+
+namespace DXHelper
+{
+    winrt::com_ptr<IDXGIAdapter3> SelectAdapter(IDXGIFactory4* factory, int32_t pinnedAdapterIndex)
+    {
+        if (pinnedAdapterIndex >= 0)
+        {
+            winrt::com_ptr<IDXGIAdapter1> adapter;
+            DXGI_ADAPTER_DESC1 adapterDesc;
+            if (SUCCEEDED(factory->EnumAdapters1(static_cast<UINT>(pinnedAdapterIndex), adapter.put())) &&
+                SUCCEEDED(adapter->GetDesc1(&adapterDesc)))
+            {
+                DebugLog(L"Using the pinned graphics adapter %d, %s.\n", pinnedAdapterIndex, adapterDesc.Description);
+                return adapter.as<IDXGIAdapter3>();
+            }
+
+            DebugLog(L"There is no graphics adapter %d, selecting one automatically.\n", pinnedAdapterIndex);
+        }
+
+        const std::vector<LUID> hevcEncoderAdapters = GetAdaptersWithHevcEncoder();
+
+        winrt::com_ptr<IDXGIAdapter1> selectedAdapter;
+        DXGI_ADAPTER_DESC1 selectedAdapterDesc = {};
+        bool selectedHasHevcEncoder = false;
+        for (UINT index = 0;; ++index)
+        {
+            // EnumAdapters1 fails with DXGI_ERROR_NOT_FOUND when there are no more adapters.
+            winrt::com_ptr<IDXGIAdapter1> adapter;
+            if (FAILED(factory->EnumAdapters1(index, adapter.put())))
+            {
+                break;
+            }
+
+            DXGI_ADAPTER_DESC1 adapterDesc;
+            if (FAILED(adapter->GetDesc1(&adapterDesc)) || (adapterDesc.Flags & DXGI_ADAPTER_FLAG_SOFTWARE) != 0)
+            {
+                continue;
+            }
+
+            const bool hasHevcEncoder =
+                std::any_of(hevcEncoderAdapters.begin(), hevcEncoderAdapters.end(), [&adapterDesc](const LUID& adapterLuid) {
+                    return IsSameAdapter(adapterLuid, adapterDesc.AdapterLuid);
+                });
+
+            // Of equal adapters the first one is kept, which drives the primary display.
+            const bool better = !selectedAdapter || (hasHevcEncoder && !selectedHasHevcEncoder) ||
+                                (hasHevcEncoder == selectedHasHevcEncoder &&
+                                 adapterDesc.DedicatedVideoMemory > selectedAdapterDesc.DedicatedVideoMemory);
+            if (better)
+            {
+                selectedAdapter = std::move(adapter);
+                selectedAdapterDesc = adapterDesc;
+                selectedHasHevcEncoder = hasHevcEncoder;
+            }
+        }
+
+        if (!selectedAdapter)
+        {
+            return nullptr;
+        }
+
+        DebugLog(
+            L"Using the graphics adapter %s, %s hardware H.265 encoder, %llu MB dedicated video memory.\n",
+            selectedAdapterDesc.Description,
+            selectedHasHevcEncoder ? L"with" : L"without",
+            static_cast<unsigned long long>(selectedAdapterDesc.DedicatedVideoMemory >> 20));
+        return selectedAdapter.as<IDXGIAdapter3>();
+    }
+} // namespace DXHelper
@@ -0,0 +1,27 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#pragma once
+
+#include <dxgi1_4.h>
+
+#include <cstdint>
+
+namespace DXHelper
+{
+    // Picks the adapter the Direct3D device is created on if the holographic space does not ask for one, which is the case for
+    // holographic remoting. The frames are encoded on the adapter they are rendered on, so an adapter with a hardware H.265
+    // encoder is preferred, then the one with the most dedicated video memory. Software adapters are never picked, nullptr is
+    // returned if there is no other adapter. A pinnedAdapterIndex of 0 or more selects the adapter with that DXGI enumeration
+    // index instead, e.g. to spread the processes of a machine serving several headsets across its GPUs.
+    winrt::com_ptr<IDXGIAdapter3> SelectAdapter(IDXGIFactory4* factory, int32_t pinnedAdapterIndex);
+} // namespace DXHelper
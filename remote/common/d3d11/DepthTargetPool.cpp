@@ -0,0 +1,98 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <pch.h>
+
+#include <d3d11/DepthTargetPool.h>
+
+#include <MemoryAccounting.h>
+
+#include <windows.graphics.directx.direct3d11.interop.h>
+
+#include <algorithm>
+
+namespace DXHelper
+{
+    winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface DepthTarget::GetInteropSurface()
+    {
+        if (!m_interopSurface)
+        {
+            // Direct3D interop APIs are used to provide the buffer to the WinRT API.
+            winrt::com_ptr<IDXGIResource1> depthStencilResource;
+            winrt::check_bool(texture.try_as(depthStencilResource));
+            winrt::com_ptr<IDXGISurface2> depthDxgiSurface;
+            winrt::check_hresult(depthStencilResource->CreateSubresourceSurface(0, depthDxgiSurface.put()));
+            winrt::com_ptr<::IInspectable> inspectableSurface;
+            winrt::check_hresult(CreateDirect3D11SurfaceFromDXGISurface(
+                depthDxgiSurface.get(), reinterpret_cast<IInspectable**>(winrt::put_abi(inspectableSurface))));
+            m_interopSurface = inspectableSurface.as<winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface>();
+        }
+        return m_interopSurface;
+    }
+
+    std::shared_ptr<DepthTarget>
+        DepthTargetPool::Acquire(ID3D11Device* device, const D3D11_TEXTURE2D_DESC& desc, DXGI_FORMAT viewFormat)
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            auto it = std::find_if(m_releasedTargets.rbegin(), m_releasedTargets.rend(), [&](const std::shared_ptr<DepthTarget>& target) {
+                return Matches(*target, desc, viewFormat);
+            });
+            if (it != m_releasedTargets.rend())
+            {
+                std::shared_ptr<DepthTarget> target = std::move(*it);
+                m_releasedTargets.erase(std::next(it).base());
+                return target;
+            }
+        }
+
+        auto target = std::make_shared<DepthTarget>();
+        target->desc = desc;
+        target->viewFormat = viewFormat;
+        winrt::check_hresult(device->CreateTexture2D(&desc, nullptr, target->texture.put()));
+        MemoryAccounting::TrackGpuResource(MemoryAccounting::Tag::Cameras, target->texture.get());
+
+        CD3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc(
+            desc.ArraySize > 1 ? D3D11_DSV_DIMENSION_TEXTURE2DARRAY : D3D11_DSV_DIMENSION_TEXTURE2D, viewFormat);
+        winrt::check_hresult(device->CreateDepthStencilView(target->texture.get(), &depthStencilViewDesc, target->view.put()));
+        return target;
+    }
+
+    void DepthTargetPool::Release(std::shared_ptr<DepthTarget> target)
+    {
+        if (!target)
+        {
+            return;
+        }
+
+        std::lock_guard lock(m_mutex);
+        m_releasedTargets.push_back(std::move(target));
+        if (m_releasedTargets.size() > MaxReleasedTargets)
+        {
+            m_releasedTargets.pop_front();
+        }
+    }
+
+    void DepthTargetPool::ReleaseDeviceDependentResources()
+    {
+        std::lock_guard lock(m_mutex);
+        m_releasedTargets.clear();
+    }
+
+    bool DepthTargetPool::Matches(const DepthTarget& target, const D3D11_TEXTURE2D_DESC& desc, DXGI_FORMAT viewFormat)
+    {
+        const D3D11_TEXTURE2D_DESC& targetDesc = target.desc;
+        return targetDesc.Width == desc.Width && targetDesc.Height == desc.Height && targetDesc.ArraySize == desc.ArraySize &&
+               targetDesc.MipLevels == desc.MipLevels && targetDesc.Format == desc.Format &&
+               targetDesc.SampleDesc.Count == desc.SampleDesc.Count && targetDesc.SampleDesc.Quality == desc.SampleDesc.Quality &&
+               targetDesc.BindFlags == desc.BindFlags && targetDesc.MiscFlags == desc.MiscFlags && target.viewFormat == viewFormat;
+    }
+} // namespace DXHelper
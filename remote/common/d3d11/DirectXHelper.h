@@ -28,6 +28,7 @@
 #include <dxgi1_2.h>
 
 #include <filesystem>
+#include <memory>
 
 namespace DXHelper
 {
@@ -100,22 +101,40 @@ namespace DXHelper
         immediateContext->IASetIndexBuffer(indexBuffer.get(), indexBufferFormat, indexBufferOffset);
     }
 
-    // Function that reads from a binary file asynchronously.
-    inline std::future<std::vector<byte>> ReadDataAsync(const std::wstring_view& filename)
+    // Overwrites the contents of a buffer created with D3D11_USAGE_DYNAMIC and D3D11_CPU_ACCESS_WRITE. Unlike
+    // UpdateSubresource this does not go through an intermediate copy; the driver renames the buffer instead of waiting
+    // for the GPU to finish reading the previous contents.
+    template <typename T>
+    void UpdateDynamicBuffer(ID3D11DeviceContext* context, ID3D11Buffer* buffer, const T& data)
     {
-        using namespace winrt::Windows::Storage;
-        using namespace winrt::Windows::Storage::Streams;
+        D3D11_MAPPED_SUBRESOURCE mappedResource = {};
+        winrt::check_hresult(context->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
+        memcpy(mappedResource.pData, &data, sizeof(T));
+        context->Unmap(buffer, 0);
+    }
 
 #if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
-
+    // Resolves a file name relative to the directory of the executable.
+    inline std::filesystem::path GetExecutableRelativePath(const std::wstring_view& filename)
+    {
         wchar_t moduleFullyQualifiedFilename[MAX_PATH] = {};
         uint32_t moduleFileNameLength = GetModuleFileNameW(NULL, moduleFullyQualifiedFilename, _countof(moduleFullyQualifiedFilename) - 1);
         moduleFullyQualifiedFilename[moduleFileNameLength] = L'\0';
 
         std::filesystem::path modulePath = moduleFullyQualifiedFilename;
-        // winrt::hstring moduleFilename = modulePath.filename().c_str();
         modulePath.replace_filename(filename);
-        winrt::hstring absoluteFilename = modulePath.c_str();
+        return modulePath;
+    }
+#endif
+
+    // Function that reads from a binary file asynchronously.
+    inline std::future<std::vector<byte>> ReadDataAsync(const std::wstring_view& filename)
+    {
+        using namespace winrt::Windows::Storage;
+        using namespace winrt::Windows::Storage::Streams;
+
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+        winrt::hstring absoluteFilename = GetExecutableRelativePath(filename).c_str();
 
         IBuffer fileBuffer = co_await PathIO::ReadBufferAsync(absoluteFilename);
 #else
@@ -128,6 +147,93 @@ namespace DXHelper
         return returnBuffer;
     }
 
+    // Non-owning, read-only view of the contents of a file. The view holds a reference to the memory it points to,
+    // so copies of a view share the same memory, which is released together with the last copy.
+    class FileView
+    {
+    public:
+        FileView() = default;
+        FileView(const byte* data, size_t size, std::shared_ptr<const void> lifetime)
+            : m_data(data)
+            , m_size(size)
+            , m_lifetime(std::move(lifetime))
+        {
+        }
+
+        const byte* data() const
+        {
+            return m_data;
+        }
+
+        size_t size() const
+        {
+            return m_size;
+        }
+
+        bool empty() const
+        {
+            return m_size == 0;
+        }
+
+    private:
+        const byte* m_data = nullptr;
+        size_t m_size = 0;
+        std::shared_ptr<const void> m_lifetime;
+    };
+
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+    // Maps a file relative to the executable into memory. Unlike ReadDataAsync the contents are not copied to the heap,
+    // pages are loaded on first access and the mapping is unmapped when the last copy of the returned view is gone.
+    inline FileView MapFile(const std::wstring_view& filename)
+    {
+        const std::filesystem::path path = GetExecutableRelativePath(filename);
+
+        winrt::file_handle file(
+            CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr));
+        if (!file)
+        {
+            winrt::throw_last_error();
+        }
+
+        LARGE_INTEGER fileSize = {};
+        winrt::check_bool(GetFileSizeEx(file.get(), &fileSize));
+        if (fileSize.QuadPart == 0)
+        {
+            // Empty files can not be mapped.
+            return {};
+        }
+
+        winrt::handle mapping(CreateFileMappingW(file.get(), nullptr, PAGE_READONLY, 0, 0, nullptr));
+        if (!mapping)
+        {
+            winrt::throw_last_error();
+        }
+
+        // The view keeps the mapping alive, both handles can be closed once it exists.
+        const void* view = MapViewOfFile(mapping.get(), FILE_MAP_READ, 0, 0, 0);
+        if (!view)
+        {
+            winrt::throw_last_error();
+        }
+
+        std::shared_ptr<const void> lifetime(view, [](const void* view) { UnmapViewOfFile(view); });
+        return FileView(static_cast<const byte*>(view), static_cast<size_t>(fileSize.QuadPart), std::move(lifetime));
+    }
+#endif
+
+    // Returns a view of the contents of a file. On desktop the file is memory mapped on a background thread, otherwise
+    // (including ms-appx:/// paths) it is read with ReadDataAsync and the view owns the read data.
+    inline std::future<FileView> MapDataAsync(std::wstring filename)
+    {
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+        co_await winrt::resume_background();
+        co_return MapFile(filename);
+#else
+        auto data = std::make_shared<const std::vector<byte>>(co_await ReadDataAsync(filename));
+        co_return FileView(data->data(), data->size(), data);
+#endif
+    }
+
     // Converts a length in device-independent pixels (DIPs) to a length in physical pixels.
     inline float ConvertDipsToPixels(float dips, float dpi)
     {
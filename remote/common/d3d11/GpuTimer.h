@@ -0,0 +1,76 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <d3d11.h>
+
+#include <array>
+
+namespace DXHelper
+{
+    // Measures how long the GPU spends on a frame and on sections of it, using timestamp queries within a disjoint query.
+    // The queries of a frame are read back a few frames later from a ring of query sets, so reading the results never stalls.
+    // If the GPU falls behind by more than the ring holds, frames are not measured until a query set becomes available.
+    // All methods must be called from within DeviceResources::UseImmediateD3DDeviceContext.
+    class GpuTimer
+    {
+    public:
+        static constexpr size_t QuerySetCount = 4;
+        static constexpr size_t MaxSectionCount = 8;
+
+        void CreateDeviceDependentResources(ID3D11Device* device);
+        void ReleaseDeviceDependentResources();
+
+        void BeginFrame(ID3D11DeviceContext* context);
+        void EndFrame(ID3D11DeviceContext* context);
+
+        // Sections are identified by an index below MaxSectionCount chosen by the caller. They may overlap, but every section
+        // may only be measured once per frame.
+        void BeginSection(ID3D11DeviceContext* context, size_t section);
+        void EndSection(ID3D11DeviceContext* context, size_t section);
+
+        // GPU times in milliseconds of the most recent frame which was read back. Sections which were not measured in that
+        // frame report 0.
+        float GetFrameTime() const
+        {
+            return m_frameTime;
+        }
+        float GetSectionTime(size_t section) const
+        {
+            return m_sectionTimes[section];
+        }
+
+    private:
+        struct QuerySet
+        {
+            winrt::com_ptr<ID3D11Query> disjoint;
+            winrt::com_ptr<ID3D11Query> frameBegin;
+            winrt::com_ptr<ID3D11Query> frameEnd;
+            std::array<winrt::com_ptr<ID3D11Query>, MaxSectionCount> sectionBegin;
+            std::array<winrt::com_ptr<ID3D11Query>, MaxSectionCount> sectionEnd;
+            std::array<bool, MaxSectionCount> sectionMeasured = {};
+            bool pending = false;
+        };
+
+        // Reads back the results of the query set without waiting. Returns false if they are not available yet.
+        bool TryReadBack(ID3D11DeviceContext* context, QuerySet& querySet);
+
+        std::array<QuerySet, QuerySetCount> m_querySets;
+        size_t m_currentSet = 0;
+
+        // False if the current frame is not measured, e.g. because all query sets are still pending.
+        bool m_measuring = false;
+
+        float m_frameTime = 0.0f;
+        std::array<float, MaxSectionCount> m_sectionTimes = {};
+    };
+} // namespace DXHelper
@@ -0,0 +1,390 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <pch.h>
+
+#include <d3d11/DirectXHelper.h>
+#include <d3d11/HiZOcclusionCuller.h>
+
+#include <algorithm>
+
+namespace
+{
+    // Thread group sizes of the compute shaders.
+    constexpr UINT DownsampleGroupSize = 8;
+    constexpr UINT CullGroupSize = 64;
+
+    // Element of the instance count within D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS, which the cull shader clears.
+    constexpr UINT ArgumentsElementCount = sizeof(D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS) / sizeof(UINT);
+    static_assert(ArgumentsElementCount == 5, "The cull shader expects five elements per draw.");
+
+    struct DrawConstantBuffer
+    {
+        uint32_t drawCount;
+        uint32_t padding[3];
+    };
+
+    UINT DivideRoundingUp(UINT value, UINT divisor)
+    {
+        return (value + divisor - 1) / divisor;
+    }
+} // namespace
+
+namespace DXHelper
+{
+    std::future<void> HiZOcclusionCuller::CreateDeviceDependentResources(ID3D11Device* device, ShaderCache& shaderCache)
+    {
+        auto downsampleShader = shaderCache.GetComputeShaderAsync(L"HiZ_DownsampleComputeShader.cso");
+        auto cullShader = shaderCache.GetComputeShaderAsync(L"HiZ_CullComputeShader.cso");
+
+        const CD3D11_BUFFER_DESC downsampleConstantBufferDesc(
+            sizeof(DownsampleConstantBuffer), D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+        winrt::check_hresult(device->CreateBuffer(&downsampleConstantBufferDesc, nullptr, m_downsampleConstantBuffer.put()));
+
+        // Written once per frame when the pyramid is built, and read by all culling dispatches of the next frame.
+        const CD3D11_BUFFER_DESC pyramidConstantBufferDesc(sizeof(PyramidConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
+        winrt::check_hresult(device->CreateBuffer(&pyramidConstantBufferDesc, nullptr, m_pyramidConstantBuffer.put()));
+
+        m_downsampleShader = co_await downsampleShader;
+        m_cullShader = co_await cullShader;
+
+        m_loadingComplete = true;
+    }
+
+    void HiZOcclusionCuller::ReleaseDeviceDependentResources()
+    {
+        m_loadingComplete = false;
+        m_pyramidUpdated = false;
+        m_pyramidValid = false;
+
+        m_downsampleShader = nullptr;
+        m_cullShader = nullptr;
+        m_downsampleConstantBuffer = nullptr;
+        m_pyramidConstantBuffer = nullptr;
+
+        m_pyramid = nullptr;
+        m_pyramidView = nullptr;
+        m_levelViews.clear();
+        m_levelUnorderedAccessViews.clear();
+        m_pyramidWidth = 0;
+        m_pyramidHeight = 0;
+        m_pyramidArraySize = 0;
+
+        m_depthViews.clear();
+    }
+
+    void HiZOcclusionCuller::BeginFrame(bool enabled)
+    {
+        m_pyramidValid = enabled && m_pyramidUpdated;
+        m_pyramidUpdated = false;
+    }
+
+    void HiZOcclusionCuller::UpdatePyramid(
+        ID3D11DeviceContext* context, ID3D11Texture2D* depthTexture, const DirectX::XMFLOAT4X4 (&viewProjection)[2], bool isStereo)
+    {
+        if (!m_loadingComplete || !depthTexture)
+        {
+            return;
+        }
+
+        winrt::com_ptr<ID3D11Device> device;
+        context->GetDevice(device.put());
+
+        ID3D11ShaderResourceView* depthView = GetDepthView(device.get(), depthTexture);
+        if (!depthView)
+        {
+            return;
+        }
+
+        D3D11_TEXTURE2D_DESC depthDesc;
+        depthTexture->GetDesc(&depthDesc);
+
+        const UINT width = std::max<UINT>(depthDesc.Width / 2, 1);
+        const UINT height = std::max<UINT>(depthDesc.Height / 2, 1);
+        if (width != m_pyramidWidth || height != m_pyramidHeight || depthDesc.ArraySize != m_pyramidArraySize)
+        {
+            CreatePyramid(device.get(), width, height, depthDesc.ArraySize);
+        }
+
+        context->CSSetShader(m_downsampleShader.get(), nullptr, 0);
+        ID3D11Buffer* constantBuffer = m_downsampleConstantBuffer.get();
+        context->CSSetConstantBuffers(0, 1, &constantBuffer);
+
+        // Each level is built from the one before it, level 0 from the depth buffer.
+        UINT sourceWidth = depthDesc.Width;
+        UINT sourceHeight = depthDesc.Height;
+        for (size_t level = 0; level < m_levelUnorderedAccessViews.size(); ++level)
+        {
+            const UINT levelWidth = std::max<UINT>(width >> level, 1);
+            const UINT levelHeight = std::max<UINT>(height >> level, 1);
+            UpdateDynamicBuffer(
+                context, m_downsampleConstantBuffer.get(), DownsampleConstantBuffer{{sourceWidth, sourceHeight}, {levelWidth, levelHeight}});
+
+            ID3D11ShaderResourceView* sourceView = level == 0 ? depthView : m_levelViews[level - 1].get();
+            ID3D11UnorderedAccessView* destinationView = m_levelUnorderedAccessViews[level].get();
+            context->CSSetShaderResources(0, 1, &sourceView);
+            context->CSSetUnorderedAccessViews(0, 1, &destinationView, nullptr);
+
+            context->Dispatch(
+                DivideRoundingUp(levelWidth, DownsampleGroupSize), DivideRoundingUp(levelHeight, DownsampleGroupSize), m_pyramidArraySize);
+
+            // The level is read by the next dispatch, which requires it to be unbound as unordered access view first.
+            ID3D11ShaderResourceView* nullView = nullptr;
+            ID3D11UnorderedAccessView* nullUnorderedAccessView = nullptr;
+            context->CSSetShaderResources(0, 1, &nullView);
+            context->CSSetUnorderedAccessViews(0, 1, &nullUnorderedAccessView, nullptr);
+
+            sourceWidth = levelWidth;
+            sourceHeight = levelHeight;
+        }
+
+        context->CSSetShader(nullptr, nullptr, 0);
+
+        PyramidConstantBuffer pyramidConstants = {};
+        pyramidConstants.viewProjection[0] = viewProjection[0];
+        pyramidConstants.viewProjection[1] = viewProjection[1];
+        pyramidConstants.size[0] = width;
+        pyramidConstants.size[1] = height;
+        pyramidConstants.levelCount = static_cast<uint32_t>(m_levelUnorderedAccessViews.size());
+        pyramidConstants.viewCount = isStereo && m_pyramidArraySize > 1 ? 2 : 1;
+        context->UpdateSubresource(m_pyramidConstantBuffer.get(), 0, nullptr, &pyramidConstants, 0, 0);
+
+        m_pyramidUpdated = true;
+    }
+
+    void HiZOcclusionCuller::Cull(
+        ID3D11DeviceContext* context,
+        ID3D11ShaderResourceView* spheres,
+        ID3D11UnorderedAccessView* drawArguments,
+        ID3D11Buffer* drawConstants,
+        UINT drawCount)
+    {
+        if (!IsActive() || drawCount == 0)
+        {
+            return;
+        }
+
+        context->CSSetShader(m_cullShader.get(), nullptr, 0);
+
+        ID3D11Buffer* constantBuffers[2] = {m_pyramidConstantBuffer.get(), drawConstants};
+        context->CSSetConstantBuffers(0, 2, constantBuffers);
+
+        ID3D11ShaderResourceView* views[2] = {m_pyramidView.get(), spheres};
+        context->CSSetShaderResources(0, 2, views);
+        context->CSSetUnorderedAccessViews(0, 1, &drawArguments, nullptr);
+
+        context->Dispatch(DivideRoundingUp(drawCount, CullGroupSize), 1, 1);
+
+        // The draw arguments are used for drawing next, unbind everything so that no other shader inherits them.
+        ID3D11ShaderResourceView* nullViews[2] = {};
+        ID3D11UnorderedAccessView* nullUnorderedAccessView = nullptr;
+        context->CSSetShaderResources(0, 2, nullViews);
+        context->CSSetUnorderedAccessViews(0, 1, &nullUnorderedAccessView, nullptr);
+        context->CSSetShader(nullptr, nullptr, 0);
+    }
+
+    void HiZOcclusionCuller::CreatePyramid(ID3D11Device* device, UINT width, UINT height, UINT arraySize)
+    {
+        m_pyramid = nullptr;
+        m_pyramidView = nullptr;
+        m_levelViews.clear();
+        m_levelUnorderedAccessViews.clear();
+
+        UINT levelCount = 1;
+        while ((std::max)(width, height) >> levelCount)
+        {
+            levelCount++;
+        }
+
+        const CD3D11_TEXTURE2D_DESC pyramidDesc(
+            DXGI_FORMAT_R32_FLOAT,
+            width,
+            height,
+            arraySize,
+            levelCount,
+            D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_UNORDERED_ACCESS);
+        winrt::check_hresult(device->CreateTexture2D(&pyramidDesc, nullptr, m_pyramid.put()));
+
+        const CD3D11_SHADER_RESOURCE_VIEW_DESC pyramidViewDesc(
+            D3D11_SRV_DIMENSION_TEXTURE2DARRAY, DXGI_FORMAT_R32_FLOAT, 0, levelCount, 0, arraySize);
+        winrt::check_hresult(device->CreateShaderResourceView(m_pyramid.get(), &pyramidViewDesc, m_pyramidView.put()));
+
+        for (UINT level = 0; level < levelCount; ++level)
+        {
+            const CD3D11_SHADER_RESOURCE_VIEW_DESC levelViewDesc(
+                D3D11_SRV_DIMENSION_TEXTURE2DARRAY, DXGI_FORMAT_R32_FLOAT, level, 1, 0, arraySize);
+            winrt::com_ptr<ID3D11ShaderResourceView> levelView;
+            winrt::check_hresult(device->CreateShaderResourceView(m_pyramid.get(), &levelViewDesc, levelView.put()));
+            m_levelViews.push_back(std::move(levelView));
+
+            const CD3D11_UNORDERED_ACCESS_VIEW_DESC levelUnorderedAccessViewDesc(
+                D3D11_UAV_DIMENSION_TEXTURE2DARRAY, DXGI_FORMAT_R32_FLOAT, level, 0, arraySize);
+            winrt::com_ptr<ID3D11UnorderedAccessView> levelUnorderedAccessView;
+            winrt::check_hresult(
+                device->CreateUnorderedAccessView(m_pyramid.get(), &levelUnorderedAccessViewDesc, levelUnorderedAccessView.put()));
+            m_levelUnorderedAccessViews.push_back(std::move(levelUnorderedAccessView));
+        }
+
+        m_pyramidWidth = width;
+        m_pyramidHeight = height;
+        m_pyramidArraySize = arraySize;
+    }
+
+    ID3D11ShaderResourceView* HiZOcclusionCuller::GetDepthView(ID3D11Device* device, ID3D11Texture2D* depthTexture)
+    {
+        auto it = std::find_if(
+            m_depthViews.begin(), m_depthViews.end(), [depthTexture](const auto& entry) { return entry.first.get() == depthTexture; });
+        if (it != m_depthViews.end())
+        {
+            return it->second.get();
+        }
+
+        D3D11_TEXTURE2D_DESC depthDesc;
+        depthTexture->GetDesc(&depthDesc);
+
+        // Only the depth of typeless depth buffers which are bound as shader resource can be read.
+        DXGI_FORMAT viewFormat = DXGI_FORMAT_UNKNOWN;
+        switch (depthDesc.Format)
+        {
+            case DXGI_FORMAT_R16_TYPELESS:
+                viewFormat = DXGI_FORMAT_R16_UNORM;
+                break;
+            case DXGI_FORMAT_R24G8_TYPELESS:
+                viewFormat = DXGI_FORMAT_R24_UNORM_X8_TYPELESS;
+                break;
+            case DXGI_FORMAT_R32_TYPELESS:
+                viewFormat = DXGI_FORMAT_R32_FLOAT;
+                break;
+        }
+
+        if (viewFormat == DXGI_FORMAT_UNKNOWN || (depthDesc.BindFlags & D3D11_BIND_SHADER_RESOURCE) == 0)
+        {
+            return nullptr;
+        }
+
+        const CD3D11_SHADER_RESOURCE_VIEW_DESC viewDesc(D3D11_SRV_DIMENSION_TEXTURE2DARRAY, viewFormat, 0, 1, 0, depthDesc.ArraySize);
+        winrt::com_ptr<ID3D11ShaderResourceView> view;
+        winrt::check_hresult(device->CreateShaderResourceView(depthTexture, &viewDesc, view.put()));
+
+        if (m_depthViews.size() == MaxDepthViews)
+        {
+            m_depthViews.erase(m_depthViews.begin());
+        }
+
+        winrt::com_ptr<ID3D11Texture2D> texture;
+        texture.copy_from(depthTexture);
+        m_depthViews.emplace_back(std::move(texture), std::move(view));
+        return m_depthViews.back().second.get();
+    }
+
+    void OcclusionCulledDraws::ReleaseDeviceDependentResources()
+    {
+        m_sphereBuffer = nullptr;
+        m_sphereView = nullptr;
+        m_argumentBuffer = nullptr;
+        m_argumentView = nullptr;
+        m_constantBuffer = nullptr;
+        m_capacity = 0;
+    }
+
+    void OcclusionCulledDraws::Clear()
+    {
+        m_spheres.clear();
+        m_arguments.clear();
+    }
+
+    size_t OcclusionCulledDraws::Add(const DirectX::XMFLOAT4& sphere, const D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS& arguments)
+    {
+        m_spheres.push_back(sphere);
+        m_arguments.push_back(arguments);
+        return m_arguments.size() - 1;
+    }
+
+    void OcclusionCulledDraws::Cull(ID3D11DeviceContext* context, HiZOcclusionCuller& culler)
+    {
+        const UINT drawCount = static_cast<UINT>(m_arguments.size());
+        if (drawCount == 0)
+        {
+            return;
+        }
+
+        winrt::com_ptr<ID3D11Device> device;
+        context->GetDevice(device.put());
+        EnsureCapacity(device.get(), drawCount);
+
+        // The draw arguments are rewritten every pass, the cull shader only clears the instance counts of hidden draws.
+        const D3D11_BOX argumentBox = {0, 0, 0, drawCount * static_cast<UINT>(sizeof(D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS)), 1, 1};
+        context->UpdateSubresource(m_argumentBuffer.get(), 0, &argumentBox, m_arguments.data(), 0, 0);
+
+        D3D11_MAPPED_SUBRESOURCE mappedSpheres = {};
+        winrt::check_hresult(context->Map(m_sphereBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedSpheres));
+        memcpy(mappedSpheres.pData, m_spheres.data(), m_spheres.size() * sizeof(DirectX::XMFLOAT4));
+        context->Unmap(m_sphereBuffer.get(), 0);
+
+        UpdateDynamicBuffer(context, m_constantBuffer.get(), DrawConstantBuffer{drawCount, {}});
+
+        culler.Cull(context, m_sphereView.get(), m_argumentView.get(), m_constantBuffer.get(), drawCount);
+    }
+
+    void OcclusionCulledDraws::EnsureCapacity(ID3D11Device* device, UINT drawCount)
+    {
+        if (!m_constantBuffer)
+        {
+            const CD3D11_BUFFER_DESC constantBufferDesc(
+                sizeof(DrawConstantBuffer), D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+            winrt::check_hresult(device->CreateBuffer(&constantBufferDesc, nullptr, m_constantBuffer.put()));
+        }
+
+        if (drawCount <= m_capacity)
+        {
+            return;
+        }
+
+        // Grow in powers of two, so that a slowly growing number of draws does not recreate the buffers every pass.
+        UINT capacity = std::max<UINT>(m_capacity, 16);
+        while (capacity < drawCount)
+        {
+            capacity *= 2;
+        }
+
+        m_sphereBuffer = nullptr;
+        m_sphereView = nullptr;
+        m_argumentBuffer = nullptr;
+        m_argumentView = nullptr;
+
+        const CD3D11_BUFFER_DESC sphereBufferDesc(
+            capacity * sizeof(DirectX::XMFLOAT4),
+            D3D11_BIND_SHADER_RESOURCE,
+            D3D11_USAGE_DYNAMIC,
+            D3D11_CPU_ACCESS_WRITE,
+            D3D11_RESOURCE_MISC_BUFFER_STRUCTURED,
+            sizeof(DirectX::XMFLOAT4));
+        winrt::check_hresult(device->CreateBuffer(&sphereBufferDesc, nullptr, m_sphereBuffer.put()));
+
+        const CD3D11_SHADER_RESOURCE_VIEW_DESC sphereViewDesc(D3D11_SRV_DIMENSION_BUFFER, DXGI_FORMAT_UNKNOWN, 0, capacity);
+        winrt::check_hresult(device->CreateShaderResourceView(m_sphereBuffer.get(), &sphereViewDesc, m_sphereView.put()));
+
+        // Indirect arguments cannot be structured, the cull shader writes them through a typed view.
+        const CD3D11_BUFFER_DESC argumentBufferDesc(
+            capacity * sizeof(D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS),
+            D3D11_BIND_UNORDERED_ACCESS,
+            D3D11_USAGE_DEFAULT,
+            0,
+            D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS);
+        winrt::check_hresult(device->CreateBuffer(&argumentBufferDesc, nullptr, m_argumentBuffer.put()));
+
+        const CD3D11_UNORDERED_ACCESS_VIEW_DESC argumentViewDesc(
+            D3D11_UAV_DIMENSION_BUFFER, DXGI_FORMAT_R32_UINT, 0, capacity * ArgumentsElementCount);
+        winrt::check_hresult(device->CreateUnorderedAccessView(m_argumentBuffer.get(), &argumentViewDesc, m_argumentView.put()));
+
+        m_capacity = capacity;
+    }
+} // namespace DXHelper
@@ -0,0 +1,140 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <d3d11/ShaderCache.h>
+
+#include <DirectXMath.h>
+#include <d3d11.h>
+
+#include <atomic>
+#include <future>
+#include <utility>
+#include <vector>
+
+namespace DXHelper
+{
+    // Culls bounding spheres against a hierarchical depth (Hi-Z) pyramid, built by a compute shader from the depth buffer of the
+    // previous frame. Each texel of a level holds the farthest depth of the texels it covers, so a sphere which is farther away
+    // than that at every texel of its screen rectangle is hidden. The test runs in a compute shader and clears the instance count
+    // of the indirect draw arguments of hidden objects, so nothing is read back. Content which was hidden in the previous frame
+    // shows up one frame late when it becomes visible. Only used while a single camera renders, the pyramid is of that camera.
+    class HiZOcclusionCuller
+    {
+    public:
+        std::future<void> CreateDeviceDependentResources(ID3D11Device* device, ShaderCache& shaderCache);
+        void ReleaseDeviceDependentResources();
+
+        // Takes over the pyramid of the previous frame, unless culling is disabled for this frame, e.g. because more than one
+        // camera renders. Called once per frame before any content is rendered.
+        void BeginFrame(bool enabled);
+
+        // Returns whether the pyramid of the previous frame is available for culling.
+        bool IsActive() const
+        {
+            return m_loadingComplete && m_pyramidValid;
+        }
+
+        // Builds the pyramid from the depth buffer the content of the current frame was rendered to, with the view-projection
+        // matrices, transposed for the shaders, it was rendered with. Must be called with exclusive access to the context.
+        void UpdatePyramid(
+            ID3D11DeviceContext* context, ID3D11Texture2D* depthTexture, const DirectX::XMFLOAT4X4 (&viewProjection)[2], bool isStereo);
+
+        // Tests drawCount spheres against the pyramid and clears the instance count of the draw arguments of hidden ones.
+        void Cull(
+            ID3D11DeviceContext* context,
+            ID3D11ShaderResourceView* spheres,
+            ID3D11UnorderedAccessView* drawArguments,
+            ID3D11Buffer* drawConstants,
+            UINT drawCount);
+
+    private:
+        struct PyramidConstantBuffer
+        {
+            DirectX::XMFLOAT4X4 viewProjection[2];
+            uint32_t size[2];
+            uint32_t levelCount;
+            uint32_t viewCount;
+        };
+
+        struct DownsampleConstantBuffer
+        {
+            uint32_t sourceSize[2];
+            uint32_t destinationSize[2];
+        };
+
+        void CreatePyramid(ID3D11Device* device, UINT width, UINT height, UINT arraySize);
+
+        // Returns a view of the depth buffer which the downsample shader can read, or nullptr if its format is not supported.
+        ID3D11ShaderResourceView* GetDepthView(ID3D11Device* device, ID3D11Texture2D* depthTexture);
+
+        winrt::com_ptr<ID3D11ComputeShader> m_downsampleShader;
+        winrt::com_ptr<ID3D11ComputeShader> m_cullShader;
+        winrt::com_ptr<ID3D11Buffer> m_downsampleConstantBuffer;
+        winrt::com_ptr<ID3D11Buffer> m_pyramidConstantBuffer;
+
+        // Level 0 has half the resolution of the depth buffer, the last level is 1x1. One slice per view.
+        winrt::com_ptr<ID3D11Texture2D> m_pyramid;
+        winrt::com_ptr<ID3D11ShaderResourceView> m_pyramidView;
+        std::vector<winrt::com_ptr<ID3D11ShaderResourceView>> m_levelViews;
+        std::vector<winrt::com_ptr<ID3D11UnorderedAccessView>> m_levelUnorderedAccessViews;
+        UINT m_pyramidWidth = 0;
+        UINT m_pyramidHeight = 0;
+        UINT m_pyramidArraySize = 0;
+
+        // Views of the recently used depth buffers, which the cameras reuse frame after frame.
+        static constexpr size_t MaxDepthViews = 4;
+        std::vector<std::pair<winrt::com_ptr<ID3D11Texture2D>, winrt::com_ptr<ID3D11ShaderResourceView>>> m_depthViews;
+
+        std::atomic<bool> m_loadingComplete = false;
+
+        // Set by UpdatePyramid and taken over by the next BeginFrame, so a pyramid is only used in the frame after it was built.
+        bool m_pyramidUpdated = false;
+        bool m_pyramidValid = false;
+    };
+
+    // The indirect draws of a renderer pass, each with the bounding sphere it is culled with. A renderer adds the draws of a pass,
+    // culls all of them with a single dispatch and then issues them one by one.
+    class OcclusionCulledDraws
+    {
+    public:
+        void ReleaseDeviceDependentResources();
+
+        void Clear();
+
+        // The sphere holds the center in the rendering coordinate system and the radius. Returns the index of the draw.
+        size_t Add(const DirectX::XMFLOAT4& sphere, const D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS& arguments);
+
+        // Uploads the draws and culls them. Must be called from within DeviceResources::UseD3DDeviceContext.
+        void Cull(ID3D11DeviceContext* context, HiZOcclusionCuller& culler);
+
+        // Issues a draw, which does nothing if the draw was culled.
+        void Draw(ID3D11DeviceContext* context, size_t index) const
+        {
+            context->DrawIndexedInstancedIndirect(
+                m_argumentBuffer.get(), static_cast<UINT>(index * sizeof(D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS)));
+        }
+
+    private:
+        void EnsureCapacity(ID3D11Device* device, UINT drawCount);
+
+        std::vector<DirectX::XMFLOAT4> m_spheres;
+        std::vector<D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS> m_arguments;
+
+        winrt::com_ptr<ID3D11Buffer> m_sphereBuffer;
+        winrt::com_ptr<ID3D11ShaderResourceView> m_sphereView;
+        winrt::com_ptr<ID3D11Buffer> m_argumentBuffer;
+        winrt::com_ptr<ID3D11UnorderedAccessView> m_argumentView;
+        winrt::com_ptr<ID3D11Buffer> m_constantBuffer;
+        UINT m_capacity = 0;
+    };
+} // namespace DXHelper
@@ -0,0 +1,133 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#include <pch.h>
+
+#include <d3d11/RenderQueue.h>
+
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+
+namespace
+{
+    auto GetPipelineKey(const DXHelper::PipelineState& pipeline)
+    {
+        // The vertex shader goes first, it differs between most pipelines and switching it is the most expensive.
+        return std::make_tuple(
+            pipeline.vertexShader.get(),
+            pipeline.inputLayout.get(),
+            pipeline.geometryShader.get(),
+            pipeline.pixelShader.get(),
+            pipeline.rasterizerState.get(),
+            pipeline.topology);
+    }
+} // namespace
+
+namespace DXHelper
+{
+    void RenderQueue::Execute(ID3D11DeviceContext* context)
+    {
+        m_order.resize(m_packets.size());
+        std::iota(m_order.begin(), m_order.end(), 0u);
+        std::stable_sort(m_order.begin(), m_order.end(), [this](uint32_t a, uint32_t b) {
+            return GetPipelineKey(m_packets[a].pipeline) < GetPipelineKey(m_packets[b].pipeline);
+        });
+
+        m_skippedBindingCount = 0;
+        const DrawPacket* previous = nullptr;
+        for (uint32_t index : m_order)
+        {
+            const DrawPacket& packet = m_packets[index];
+            const PipelineState& pipeline = packet.pipeline;
+            const PipelineState* previousPipeline = previous ? &previous->pipeline : nullptr;
+
+            // Takes whether the previous draw bound the same state and counts the skipped bindings.
+            auto isBound = [this](bool bound) {
+                m_skippedBindingCount += bound ? 1 : 0;
+                return bound;
+            };
+
+            if (!isBound(previousPipeline && previousPipeline->inputLayout == pipeline.inputLayout))
+            {
+                context->IASetInputLayout(pipeline.inputLayout.get());
+            }
+            if (!isBound(previousPipeline && previousPipeline->topology == pipeline.topology))
+            {
+                context->IASetPrimitiveTopology(pipeline.topology);
+            }
+            if (!isBound(previousPipeline && previousPipeline->vertexShader == pipeline.vertexShader))
+            {
+                context->VSSetShader(pipeline.vertexShader.get(), nullptr, 0);
+            }
+            if (!isBound(previousPipeline && previousPipeline->geometryShader == pipeline.geometryShader))
+            {
+                context->GSSetShader(pipeline.geometryShader.get(), nullptr, 0);
+            }
+            if (!isBound(previousPipeline && previousPipeline->pixelShader == pipeline.pixelShader))
+            {
+                context->PSSetShader(pipeline.pixelShader.get(), nullptr, 0);
+            }
+            if (!isBound(previousPipeline && previousPipeline->rasterizerState == pipeline.rasterizerState))
+            {
+                context->RSSetState(pipeline.rasterizerState.get());
+            }
+
+            for (UINT slot = 0; slot < DrawPacket::MaxVertexBuffers; ++slot)
+            {
+                if (!isBound(
+                        previous && previous->vertexBuffers[slot] == packet.vertexBuffers[slot] &&
+                        previous->strides[slot] == packet.strides[slot] && previous->offsets[slot] == packet.offsets[slot]))
+                {
+                    ID3D11Buffer* vertexBuffer = packet.vertexBuffers[slot].get();
+                    context->IASetVertexBuffers(slot, 1, &vertexBuffer, &packet.strides[slot], &packet.offsets[slot]);
+                }
+            }
+
+            if (packet.indexBuffer &&
+                !isBound(previous && previous->indexBuffer == packet.indexBuffer && previous->indexFormat == packet.indexFormat))
+            {
+                context->IASetIndexBuffer(packet.indexBuffer.get(), packet.indexFormat, 0);
+            }
+
+            for (UINT slot = 0; slot < DrawPacket::MaxVertexShaderConstantBuffers; ++slot)
+            {
+                if (packet.vertexShaderConstantBuffers[slot] &&
+                    !isBound(previous && previous->vertexShaderConstantBuffers[slot] == packet.vertexShaderConstantBuffers[slot]))
+                {
+                    ID3D11Buffer* constantBuffer = packet.vertexShaderConstantBuffers[slot].get();
+                    context->VSSetConstantBuffers(slot, 1, &constantBuffer);
+                }
+            }
+
+            if (packet.pixelShaderConstantBuffer &&
+                !isBound(previous && previous->pixelShaderConstantBuffer == packet.pixelShaderConstantBuffer))
+            {
+                ID3D11Buffer* constantBuffer = packet.pixelShaderConstantBuffer.get();
+                context->PSSetConstantBuffers(0, 1, &constantBuffer);
+            }
+
+            if (packet.indexBuffer)
+            {
+                context->DrawIndexedInstanced(packet.elementCount, packet.instanceCount, 0, 0, 0);
+            }
+            else
+            {
+                context->DrawInstanced(packet.elementCount, packet.instanceCount, 0, 0);
+            }
+
+            previous = &packet;
+        }
+
+        m_packets.clear();
+    }
+} // namespace DXHelper
@@ -0,0 +1,86 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#pragma once
+
+#include <d3d11.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace DXHelper
+{
+    // The shaders and the fixed function state of a draw. The queue sorts draws by it, so draws which share a pipeline should
+    // use the same objects.
+    struct PipelineState
+    {
+        winrt::com_ptr<ID3D11InputLayout> inputLayout;
+        winrt::com_ptr<ID3D11VertexShader> vertexShader;
+        // Null unbinds the geometry shader.
+        winrt::com_ptr<ID3D11GeometryShader> geometryShader;
+        winrt::com_ptr<ID3D11PixelShader> pixelShader;
+        winrt::com_ptr<ID3D11RasterizerState> rasterizerState;
+        D3D11_PRIMITIVE_TOPOLOGY topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+    };
+
+    // A draw submitted to a RenderQueue, holding references to everything it binds.
+    struct DrawPacket
+    {
+        static constexpr UINT MaxVertexBuffers = 2;
+        static constexpr UINT MaxVertexShaderConstantBuffers = 3;
+
+        PipelineState pipeline;
+
+        winrt::com_ptr<ID3D11Buffer> vertexBuffers[MaxVertexBuffers];
+        UINT strides[MaxVertexBuffers] = {};
+        UINT offsets[MaxVertexBuffers] = {};
+
+        // Draws indexed if set.
+        winrt::com_ptr<ID3D11Buffer> indexBuffer;
+        DXGI_FORMAT indexFormat = DXGI_FORMAT_R16_UINT;
+
+        // By slot. Slots left empty keep what is bound, like the view-projection buffer CameraResources binds to slot 1.
+        winrt::com_ptr<ID3D11Buffer> vertexShaderConstantBuffers[MaxVertexShaderConstantBuffers];
+        // Bound to slot 0.
+        winrt::com_ptr<ID3D11Buffer> pixelShaderConstantBuffer;
+
+        // Vertices per instance, or indices per instance for indexed draws.
+        UINT elementCount = 0;
+        UINT instanceCount = 1;
+    };
+
+    // Collects the draws of a pass and issues them sorted by pipeline state. State which the previous draw of the same execution
+    // already bound is not bound again, so draws sharing a pipeline pay for its state once.
+    class RenderQueue
+    {
+    public:
+        void Submit(DrawPacket&& packet)
+        {
+            m_packets.push_back(std::move(packet));
+        }
+
+        // Issues and clears the submitted draws. The draws keep the order they were submitted in within a pipeline. The state bound
+        // before is unknown to the queue, so the first draw binds all of its state.
+        void Execute(ID3D11DeviceContext* context);
+
+        // Number of state bindings the last Execute skipped because the previous draw bound the same state.
+        uint32_t GetSkippedBindingCount() const
+        {
+            return m_skippedBindingCount;
+        }
+
+    private:
+        std::vector<DrawPacket> m_packets;
+        std::vector<uint32_t> m_order;
+        uint32_t m_skippedBindingCount = 0;
+    };
+} // namespace DXHelper
@@ -0,0 +1,184 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <pch.h>
+
+#include <d3d11/ShaderCache.h>
+
+#include <chrono>
+
+namespace DXHelper
+{
+    void ShaderCache::CreateDeviceDependentResources(ID3D11Device* device)
+    {
+        std::scoped_lock lock(m_mutex);
+        m_device.copy_from(device);
+    }
+
+    void ShaderCache::ReleaseDeviceDependentResources()
+    {
+        std::scoped_lock lock(m_mutex);
+        m_device = nullptr;
+        for (auto& [fileName, entry] : m_entries)
+        {
+            entry.vertexShader = nullptr;
+            entry.geometryShader = nullptr;
+            entry.pixelShader = nullptr;
+            entry.computeShader = nullptr;
+        }
+    }
+
+    std::future<ShaderCache::Bytecode> ShaderCache::GetBytecodeAsync(std::wstring fileName)
+    {
+        std::shared_future<Bytecode> bytecode = GetOrReadBytecode(fileName);
+        if (bytecode.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            // The read may be shared with other callers, wait for it on a background thread.
+            co_await winrt::resume_background();
+        }
+
+        try
+        {
+            co_return bytecode.get();
+        }
+        catch (...)
+        {
+            // Keeping the failed read would fail every later request for the file, the next request reads it again.
+            EvictFailedBytecode(fileName);
+            throw;
+        }
+    }
+
+    std::future<winrt::com_ptr<ID3D11VertexShader>> ShaderCache::GetVertexShaderAsync(std::wstring fileName)
+    {
+        return GetShaderAsync(
+            std::move(fileName), &Entry::vertexShader, [](ID3D11Device* device, const Bytecode& bytecode, auto shader) {
+                return device->CreateVertexShader(bytecode.data(), bytecode.size(), nullptr, shader);
+            });
+    }
+
+    std::future<winrt::com_ptr<ID3D11GeometryShader>> ShaderCache::GetGeometryShaderAsync(std::wstring fileName)
+    {
+        return GetShaderAsync(
+            std::move(fileName), &Entry::geometryShader, [](ID3D11Device* device, const Bytecode& bytecode, auto shader) {
+                return device->CreateGeometryShader(bytecode.data(), bytecode.size(), nullptr, shader);
+            });
+    }
+
+    std::future<winrt::com_ptr<ID3D11PixelShader>> ShaderCache::GetPixelShaderAsync(std::wstring fileName)
+    {
+        return GetShaderAsync(
+            std::move(fileName), &Entry::pixelShader, [](ID3D11Device* device, const Bytecode& bytecode, auto shader) {
+                return device->CreatePixelShader(bytecode.data(), bytecode.size(), nullptr, shader);
+            });
+    }
+
+    std::future<winrt::com_ptr<ID3D11ComputeShader>> ShaderCache::GetComputeShaderAsync(std::wstring fileName)
+    {
+        return GetShaderAsync(
+            std::move(fileName), &Entry::computeShader, [](ID3D11Device* device, const Bytecode& bytecode, auto shader) {
+                return device->CreateComputeShader(bytecode.data(), bytecode.size(), nullptr, shader);
+            });
+    }
+
+    std::shared_future<ShaderCache::Bytecode> ShaderCache::GetOrReadBytecode(std::wstring_view fileName)
+    {
+        std::scoped_lock lock(m_mutex);
+
+        auto it = m_entries.find(fileName);
+        if (it == m_entries.end())
+        {
+            it = m_entries.emplace(std::wstring(fileName), Entry()).first;
+        }
+
+        if (!it->second.bytecode.valid())
+        {
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+            std::wstring fileNamePrefix = L"";
+#else
+            std::wstring fileNamePrefix = L"ms-appx:///";
+#endif
+
+            // Only starts the read, the file data arrives asynchronously.
+            it->second.bytecode = MapDataAsync(fileNamePrefix + std::wstring(fileName)).share();
+        }
+
+        return it->second.bytecode;
+    }
+
+    void ShaderCache::EvictFailedBytecode(std::wstring_view fileName)
+    {
+        std::scoped_lock lock(m_mutex);
+
+        auto it = m_entries.find(fileName);
+        if (it == m_entries.end() || !it->second.bytecode.valid() ||
+            it->second.bytecode.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            // Already evicted, or another caller started a new read.
+            return;
+        }
+
+        try
+        {
+            it->second.bytecode.get();
+        }
+        catch (...)
+        {
+            m_entries.erase(it);
+        }
+    }
+
+    template <typename Shader, typename CreateShader>
+    std::future<winrt::com_ptr<Shader>>
+        ShaderCache::GetShaderAsync(std::wstring fileName, winrt::com_ptr<Shader> Entry::*entryShader, CreateShader createShader)
+    {
+        winrt::com_ptr<ID3D11Device> device;
+        {
+            std::scoped_lock lock(m_mutex);
+
+            auto it = m_entries.find(fileName);
+            if (it != m_entries.end() && it->second.*entryShader)
+            {
+                co_return it->second.*entryShader;
+            }
+        }
+
+        Bytecode bytecode = co_await GetBytecodeAsync(fileName);
+
+        {
+            std::scoped_lock lock(m_mutex);
+            Entry& entry = m_entries[fileName];
+            if (entry.*entryShader)
+            {
+                co_return entry.*entryShader;
+            }
+
+            device = m_device;
+        }
+
+        if (!device)
+        {
+            winrt::throw_hresult(DXGI_ERROR_DEVICE_REMOVED);
+        }
+
+        // The device is free threaded, shaders are created outside of the lock so that they can be created in parallel.
+        winrt::com_ptr<Shader> shader;
+        winrt::check_hresult(createShader(device.get(), bytecode, shader.put()));
+
+        std::scoped_lock lock(m_mutex);
+        Entry& entry = m_entries[fileName];
+        if (m_device == device && !(entry.*entryShader))
+        {
+            entry.*entryShader = shader;
+        }
+        co_return shader;
+    }
+} // namespace DXHelper
@@ -0,0 +1,69 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <d3d11/DirectXHelper.h>
+
+#include <d3d11.h>
+
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+namespace DXHelper
+{
+    // Caches compiled shaders by file name, so renderers which use the same shader share its bytecode and shader object.
+    // A file is read asynchronously as soon as it is first requested, so requesting all shaders of a renderer before awaiting
+    // any of them reads their files in parallel. The bytecode outlives the device, restoring a lost device only recreates the
+    // shader objects.
+    class ShaderCache
+    {
+    public:
+        // Memory mapped on desktop, so the bytecode is not copied to the heap.
+        using Bytecode = FileView;
+
+        void CreateDeviceDependentResources(ID3D11Device* device);
+        void ReleaseDeviceDependentResources();
+
+        // The file names are relative to the application package or, for desktop applications, the executable.
+        std::future<Bytecode> GetBytecodeAsync(std::wstring fileName);
+        std::future<winrt::com_ptr<ID3D11VertexShader>> GetVertexShaderAsync(std::wstring fileName);
+        std::future<winrt::com_ptr<ID3D11GeometryShader>> GetGeometryShaderAsync(std::wstring fileName);
+        std::future<winrt::com_ptr<ID3D11PixelShader>> GetPixelShaderAsync(std::wstring fileName);
+        std::future<winrt::com_ptr<ID3D11ComputeShader>> GetComputeShaderAsync(std::wstring fileName);
+
+    private:
+        struct Entry
+        {
+            std::shared_future<Bytecode> bytecode;
+            winrt::com_ptr<ID3D11VertexShader> vertexShader;
+            winrt::com_ptr<ID3D11GeometryShader> geometryShader;
+            winrt::com_ptr<ID3D11PixelShader> pixelShader;
+            winrt::com_ptr<ID3D11ComputeShader> computeShader;
+        };
+
+        std::shared_future<Bytecode> GetOrReadBytecode(std::wstring_view fileName);
+
+        // Removes the entry of a file whose read failed, so that the next request reads the file again.
+        void EvictFailedBytecode(std::wstring_view fileName);
+
+        template <typename Shader, typename CreateShader>
+        std::future<winrt::com_ptr<Shader>>
+            GetShaderAsync(std::wstring fileName, winrt::com_ptr<Shader> Entry::*entryShader, CreateShader createShader);
+
+        std::mutex m_mutex;
+        winrt::com_ptr<ID3D11Device> m_device;
+        std::map<std::wstring, Entry, std::less<>> m_entries;
+    };
+} // namespace DXHelper
@@ -11,6 +11,9 @@
 
 #pragma once
 
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+
 // Constant buffer used to send hologram position transform to the shader pipeline.
 struct ModelConstantBuffer
 {
@@ -22,14 +25,16 @@ static_assert(
     (sizeof(ModelConstantBuffer) % (sizeof(float) * 4)) == 0,
     "Model constant buffer size must be 16-byte aligned (16 bytes is the length of four floats).");
 
-// Used to send per-vertex data to the vertex shader.
-struct VertexPositionNormalColor
+// Used to send per-vertex data to the vertex shader. The color is bound as DXGI_FORMAT_R8G8B8A8_UNORM, which makes a vertex
+// 16 bytes large instead of the 36 bytes of float colors and the normals the SimpleColor shaders never read.
+struct VertexPositionColor
 {
     DirectX::XMFLOAT3 pos;
-    DirectX::XMFLOAT3 normal; // Normal.
-    DirectX::XMFLOAT3 color;
+    DirectX::PackedVector::XMUBYTEN4 color;
 };
 
+static_assert(sizeof(VertexPositionColor) == 16, "VertexPositionColor must match the SimpleColor input layouts.");
+
 struct VertexPositionUV
 {
     DirectX::XMFLOAT3 pos;
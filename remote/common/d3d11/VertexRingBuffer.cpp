@@ -0,0 +1,133 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <pch.h>
+
+#include <d3d11/VertexRingBuffer.h>
+
+#include <algorithm>
+
+namespace
+{
+    // Allocations are aligned so that every sub-allocation can be used as a vertex buffer offset.
+    constexpr UINT AllocationAlignment = 16;
+
+    // The buffer never grows past this, larger allocations fail.
+    constexpr uint64_t MaxCapacity = 256 * 1024 * 1024;
+} // namespace
+
+namespace DXHelper
+{
+    VertexRingBuffer::VertexRingBuffer(UINT initialCapacity)
+        : m_capacity(initialCapacity)
+    {
+    }
+
+    void VertexRingBuffer::CreateDeviceDependentResources(ID3D11Device* device)
+    {
+        m_device.copy_from(device);
+        CreateBuffer(m_capacity);
+    }
+
+    void VertexRingBuffer::ReleaseDeviceDependentResources()
+    {
+        m_buffer = nullptr;
+        m_device = nullptr;
+        m_writeOffset = 0;
+        m_frameStartOffset = 0;
+        m_discardPending = true;
+    }
+
+    VertexRingBuffer::Allocation VertexRingBuffer::Allocate(ID3D11DeviceContext* context, const void* data, UINT size)
+    {
+        if (!m_buffer || size == 0 || size > MaxCapacity)
+        {
+            return {};
+        }
+
+        const UINT alignedSize = (size + AllocationAlignment - 1) & ~(AllocationAlignment - 1);
+
+        if (m_writeOffset + alignedSize > m_capacity)
+        {
+            const UINT frameUsage = m_writeOffset - m_frameStartOffset;
+            if (frameUsage + alignedSize > m_capacity)
+            {
+                // The frame needs more than the whole buffer, grow it so that the following frames fit.
+                const uint64_t capacity = std::max<uint64_t>(2ull * m_capacity, frameUsage + alignedSize);
+                CreateBuffer(static_cast<UINT>(std::min(capacity, MaxCapacity)));
+            }
+            else if (frameUsage > 0)
+            {
+                // Allocations made earlier in this frame still have to be readable by draw calls that have not been issued yet,
+                // so the buffer must not be discarded. Switch to a new buffer of the same size instead; the old one is kept alive
+                // by the outstanding allocations.
+                CreateBuffer(m_capacity);
+            }
+
+            // Everything still in the buffer belongs to previous frames, which were already submitted.
+            m_writeOffset = 0;
+            m_frameStartOffset = 0;
+            m_discardPending = true;
+        }
+
+        const D3D11_MAP mapType = m_discardPending ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+
+        D3D11_MAPPED_SUBRESOURCE mappedResource = {};
+        winrt::check_hresult(context->Map(m_buffer.get(), 0, mapType, 0, &mappedResource));
+        memcpy(static_cast<uint8_t*>(mappedResource.pData) + m_writeOffset, data, size);
+        context->Unmap(m_buffer.get(), 0);
+
+        m_discardPending = false;
+
+        Allocation allocation;
+        allocation.buffer = m_buffer;
+        allocation.offset = m_writeOffset;
+        allocation.size = size;
+
+        m_writeOffset += alignedSize;
+
+        return allocation;
+    }
+
+    bool VertexRingBuffer::Overwrite(ID3D11DeviceContext* context, const Allocation& allocation, const void* data, UINT size)
+    {
+        // Only allocations of the current frame, whose draws have not been issued yet, may be overwritten without a discard.
+        if (!allocation || allocation.buffer != m_buffer || size != allocation.size || allocation.offset < m_frameStartOffset ||
+            allocation.offset >= m_writeOffset)
+        {
+            return false;
+        }
+
+        D3D11_MAPPED_SUBRESOURCE mappedResource = {};
+        winrt::check_hresult(context->Map(m_buffer.get(), 0, D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mappedResource));
+        memcpy(static_cast<uint8_t*>(mappedResource.pData) + allocation.offset, data, size);
+        context->Unmap(m_buffer.get(), 0);
+        return true;
+    }
+
+    void VertexRingBuffer::BeginFrame()
+    {
+        m_frameStartOffset = m_writeOffset;
+    }
+
+    void VertexRingBuffer::CreateBuffer(UINT capacity)
+    {
+        m_capacity = capacity;
+        m_buffer = nullptr;
+
+        const CD3D11_BUFFER_DESC bufferDesc(m_capacity, D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+        winrt::check_hresult(m_device->CreateBuffer(&bufferDesc, nullptr, m_buffer.put()));
+
+        m_writeOffset = 0;
+        m_frameStartOffset = 0;
+        m_discardPending = true;
+    }
+} // namespace DXHelper
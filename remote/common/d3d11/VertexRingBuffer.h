@@ -0,0 +1,81 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <d3d11.h>
+
+#include <vector>
+
+namespace DXHelper
+{
+    // A persistent dynamic vertex buffer which renderers sub-allocate their per-frame geometry from.
+    // Allocations are written using D3D11_MAP_WRITE_NO_OVERWRITE and stay valid until the end of the frame they were made in.
+    // The buffer is only discarded when it runs out of space, so the steady state does not create any GPU resources.
+    class VertexRingBuffer
+    {
+    public:
+        struct Allocation
+        {
+            // Holds a reference to the buffer the data was written to, which keeps it alive if the ring buffer has to grow.
+            winrt::com_ptr<ID3D11Buffer> buffer;
+            UINT offset = 0;
+            UINT size = 0;
+
+            explicit operator bool() const
+            {
+                return buffer != nullptr;
+            }
+        };
+
+        VertexRingBuffer(UINT initialCapacity = 1024 * 1024);
+
+        void CreateDeviceDependentResources(ID3D11Device* device);
+        void ReleaseDeviceDependentResources();
+
+        // Copies data into the ring buffer. Must be called from within DeviceResources::UseImmediateD3DDeviceContext.
+        // Returns an empty allocation if no data was passed or if the device dependent resources are not available.
+        Allocation Allocate(ID3D11DeviceContext* context, const void* data, UINT size);
+
+        template <typename T>
+        Allocation Allocate(ID3D11DeviceContext* context, const std::vector<T>& data)
+        {
+            return Allocate(context, data.data(), static_cast<UINT>(data.size() * sizeof(T)));
+        }
+
+        // Writes new data of the same size into an allocation of the current frame, before any draw using it was issued. Returns
+        // false, leaving the allocation as it is, if it is not one of the current frame or the size differs.
+        bool Overwrite(ID3D11DeviceContext* context, const Allocation& allocation, const void* data, UINT size);
+
+        template <typename T>
+        bool Overwrite(ID3D11DeviceContext* context, const Allocation& allocation, const std::vector<T>& data)
+        {
+            return Overwrite(context, allocation, data.data(), static_cast<UINT>(data.size() * sizeof(T)));
+        }
+
+        // Marks the start of a new frame. Space used by previous frames may be recycled afterwards.
+        void BeginFrame();
+
+    private:
+        void CreateBuffer(UINT capacity);
+
+        winrt::com_ptr<ID3D11Device> m_device;
+        winrt::com_ptr<ID3D11Buffer> m_buffer;
+
+        UINT m_capacity = 0;
+        UINT m_writeOffset = 0;
+        UINT m_frameStartOffset = 0;
+
+        // A freshly created buffer has to be mapped with D3D11_MAP_WRITE_DISCARD before it can be mapped with
+        // D3D11_MAP_WRITE_NO_OVERWRITE.
+        bool m_discardPending = true;
+    };
+} // namespace DXHelper
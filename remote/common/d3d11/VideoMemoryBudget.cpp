@@ -0,0 +1,92 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#include <pch.h>
+
+#include <DbgLog.h>
+#include <d3d11/VideoMemoryBudget.h>
+
+namespace DXHelper
+{
+    VideoMemoryBudget::~VideoMemoryBudget()
+    {
+        ReleaseDeviceDependentResources();
+    }
+
+    void VideoMemoryBudget::CreateDeviceDependentResources(IDXGIAdapter3* adapter)
+    {
+        if (!m_budgetChangedEvent)
+        {
+            m_budgetChangedEvent.attach(winrt::check_pointer(CreateEventW(nullptr, FALSE, FALSE, nullptr)));
+        }
+        m_adapter.copy_from(adapter);
+
+        // Without the notification the budget is still picked up by the periodic query.
+        m_registered =
+            SUCCEEDED(m_adapter->RegisterVideoMemoryBudgetChangeNotificationEvent(m_budgetChangedEvent.get(), &m_budgetChangedCookie));
+
+        Query();
+    }
+
+    void VideoMemoryBudget::ReleaseDeviceDependentResources()
+    {
+        if (m_registered)
+        {
+            m_adapter->UnregisterVideoMemoryBudgetChangeNotification(m_budgetChangedCookie);
+            m_registered = false;
+        }
+        m_adapter = nullptr;
+        m_bytesOverTarget = 0;
+    }
+
+    void VideoMemoryBudget::Update()
+    {
+        if (!m_adapter)
+        {
+            return;
+        }
+
+        if (WaitForSingleObject(m_budgetChangedEvent.get(), 0) == WAIT_OBJECT_0 ||
+            std::chrono::steady_clock::now() - m_queryTime >= QueryInterval)
+        {
+            Query();
+        }
+    }
+
+    void VideoMemoryBudget::NotifyReleased(uint64_t bytes)
+    {
+        uint64_t bytesOverTarget = m_bytesOverTarget;
+        while (!m_bytesOverTarget.compare_exchange_weak(bytesOverTarget, bytesOverTarget > bytes ? bytesOverTarget - bytes : 0))
+        {
+        }
+    }
+
+    void VideoMemoryBudget::Query()
+    {
+        m_queryTime = std::chrono::steady_clock::now();
+
+        DXGI_QUERY_VIDEO_MEMORY_INFO info = {};
+        if (FAILED(m_adapter->QueryVideoMemoryInfo(0, DXGI_MEMORY_SEGMENT_GROUP_LOCAL, &info)))
+        {
+            m_bytesOverTarget = 0;
+            return;
+        }
+
+        const uint64_t target = info.Budget / 100 * TargetPercent;
+        const uint64_t bytesOverTarget = info.CurrentUsage > target ? info.CurrentUsage - target : 0;
+        if (bytesOverTarget > 0 && m_bytesOverTarget == 0)
+        {
+            DebugLog(L"Video memory usage of %llu MB exceeds the target of %llu MB.\n", info.CurrentUsage >> 20, target >> 20);
+        }
+        m_bytesOverTarget = bytesOverTarget;
+    }
+} // namespace DXHelper
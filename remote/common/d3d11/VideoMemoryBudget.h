@@ -0,0 +1,67 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#pragma once
+
+#include <dxgi1_4.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace DXHelper
+{
+    // Tracks the local video memory the process uses against the budget the OS grants it. The budget is queried again whenever
+    // DXGI signals a budget change and about once per second otherwise, since the usage also changes with every allocation.
+    // Renderers which keep GPU resources for content that is not visible release them while the usage is over the target,
+    // which is a fraction of the budget, so long sessions do not grow until the OS starts to demote resources.
+    class VideoMemoryBudget
+    {
+    public:
+        ~VideoMemoryBudget();
+
+        void CreateDeviceDependentResources(IDXGIAdapter3* adapter);
+        void ReleaseDeviceDependentResources();
+
+        // Queries the budget and the usage if they are outdated. Called once per frame by DeviceResources::EnsureCameraResources.
+        void Update();
+
+        // The bytes by which the usage exceeds the target, or 0. May be called from any thread.
+        uint64_t GetBytesOverTarget() const
+        {
+            return m_bytesOverTarget;
+        }
+        bool IsOverTarget() const
+        {
+            return m_bytesOverTarget > 0;
+        }
+
+        // Accounts for resources which were released since the last query, so several renderers do not release more than
+        // necessary one after another. May be called from any thread.
+        void NotifyReleased(uint64_t bytes);
+
+    private:
+        // The usage is kept below this fraction of the budget.
+        static constexpr uint64_t TargetPercent = 90;
+        static constexpr std::chrono::seconds QueryInterval{1};
+
+        void Query();
+
+        winrt::com_ptr<IDXGIAdapter3> m_adapter;
+        winrt::handle m_budgetChangedEvent;
+        DWORD m_budgetChangedCookie = 0;
+        bool m_registered = false;
+
+        std::chrono::steady_clock::time_point m_queryTime;
+        std::atomic<uint64_t> m_bytesOverTarget = 0;
+    };
+} // namespace DXHelper
@@ -0,0 +1,99 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// The Hi-Z pyramid of the previous frame, one slice per view.
+Texture2DArray<float> hiZ : register(t0);
+
+// The bounding sphere of each draw, center in xyz and radius in w.
+StructuredBuffer<float4> spheres : register(t1);
+
+// The D3D11_DRAW_INDEXED_INSTANCED_INDIRECT_ARGS of each draw, five elements per draw.
+RWBuffer<uint> drawArgs : register(u0);
+
+// The view and projection matrices the pyramid was built with, in column-major format.
+cbuffer PyramidConstantBuffer : register(b0)
+{
+    float4x4 viewProjection[2];
+    uint2 size;
+    uint levelCount;
+    uint viewCount;
+};
+
+cbuffer DrawConstantBuffer : register(b1)
+{
+    uint drawCount;
+};
+
+// Returns whether the sphere may be visible in the view. Spheres which are not entirely in front of the camera and on screen
+// are treated as visible.
+bool IsVisible(float4 sphere, uint view)
+{
+    float3 minNdc = float3(1.0f, 1.0f, 1.0f);
+    float3 maxNdc = float3(-1.0f, -1.0f, -1.0f);
+    for (uint corner = 0; corner < 8; ++corner)
+    {
+        const float3 offset = float3(corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : -1.0f, corner & 4 ? 1.0f : -1.0f);
+        const float4 position = mul(float4(sphere.xyz + offset * sphere.w, 1.0f), viewProjection[view]);
+        if (position.w <= 0.0f)
+        {
+            return true;
+        }
+
+        const float3 ndc = position.xyz / position.w;
+        minNdc = min(minNdc, ndc);
+        maxNdc = max(maxNdc, ndc);
+    }
+
+    if (any(minNdc.xy < -1.0f) || any(maxNdc.xy > 1.0f) || minNdc.z <= 0.0f)
+    {
+        return true;
+    }
+
+    // Texel rectangle in level 0, with y pointing down.
+    const float2 minTexel = float2(minNdc.x * 0.5f + 0.5f, 0.5f - maxNdc.y * 0.5f) * size;
+    const float2 maxTexel = float2(maxNdc.x * 0.5f + 0.5f, 0.5f - minNdc.y * 0.5f) * size;
+
+    // The level at which the rectangle covers at most 2x2 texels.
+    const float2 extent = maxTexel - minTexel;
+    const uint level = min(levelCount - 1, (uint)ceil(log2(max(max(extent.x, extent.y), 1.0f))));
+    const uint2 levelMax = max(size >> level, 1) - 1;
+    const uint2 first = min((uint2)minTexel >> level, levelMax);
+    const uint2 last = min((uint2)maxTexel >> level, levelMax);
+
+    float farthest = hiZ.Load(int4(first.x, first.y, view, level));
+    farthest = max(farthest, hiZ.Load(int4(last.x, first.y, view, level)));
+    farthest = max(farthest, hiZ.Load(int4(first.x, last.y, view, level)));
+    farthest = max(farthest, hiZ.Load(int4(last.x, last.y, view, level)));
+
+    return minNdc.z <= farthest;
+}
+
+[numthreads(64, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    const uint draw = id.x;
+    if (draw >= drawCount)
+    {
+        return;
+    }
+
+    const float4 sphere = spheres[draw];
+    bool visible = false;
+    for (uint view = 0; view < viewCount && !visible; ++view)
+    {
+        visible = IsVisible(sphere, view);
+    }
+
+    if (!visible)
+    {
+        drawArgs[draw * 5 + 1] = 0;
+    }
+}
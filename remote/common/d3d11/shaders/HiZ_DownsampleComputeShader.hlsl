@@ -0,0 +1,55 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// The depth buffer, or the previous level of the Hi-Z pyramid.
+Texture2DArray<float> sourceDepth : register(t0);
+
+// The level of the Hi-Z pyramid which is built.
+RWTexture2DArray<float> destinationDepth : register(u0);
+
+cbuffer DownsampleConstantBuffer : register(b0)
+{
+    uint2 sourceSize;
+    uint2 destinationSize;
+};
+
+// Writes the farthest depth of the source texels covered by each destination texel. Where the source size is odd, the last
+// destination texel also covers the remaining source texel, so no source texel is skipped.
+[numthreads(8, 8, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+    if (any(id.xy >= destinationSize))
+    {
+        return;
+    }
+
+    const uint2 first = id.xy * 2;
+    uint2 last = min(first + 1, sourceSize - 1);
+    if (id.x == destinationSize.x - 1)
+    {
+        last.x = sourceSize.x - 1;
+    }
+    if (id.y == destinationSize.y - 1)
+    {
+        last.y = sourceSize.y - 1;
+    }
+
+    float depth = 0.0f;
+    for (uint y = first.y; y <= last.y; ++y)
+    {
+        for (uint x = first.x; x <= last.x; ++x)
+        {
+            depth = max(depth, sourceDepth.Load(int4(x, y, id.z, 0)));
+        }
+    }
+
+    destinationDepth[id] = depth;
+}
@@ -0,0 +1,34 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+Texture2DArray sourceTexture : register(t0);
+SamplerState linearSampler : register(s0);
+
+// Per-pixel data passed through the pixel shader.
+struct PixelShaderInput
+{
+    float4 pos : SV_POSITION;
+    float2 uv  : TEXCOORD0;
+};
+
+// Downsamples the first slice of the source texture. Four bilinear samples spread over the footprint of the pixel average
+// up to 4x4 source texels, which keeps strong downscaling from aliasing.
+float4 main(PixelShaderInput input) : SV_TARGET
+{
+    const float2 offset = 0.25f * (abs(ddx(input.uv)) + abs(ddy(input.uv)));
+
+    float3 color = sourceTexture.Sample(linearSampler, float3(input.uv + float2(-offset.x, -offset.y), 0.0f)).rgb;
+    color += sourceTexture.Sample(linearSampler, float3(input.uv + float2(offset.x, -offset.y), 0.0f)).rgb;
+    color += sourceTexture.Sample(linearSampler, float3(input.uv + float2(-offset.x, offset.y), 0.0f)).rgb;
+    color += sourceTexture.Sample(linearSampler, float3(input.uv + float2(offset.x, offset.y), 0.0f)).rgb;
+
+    return float4(0.25f * color, 1.0f);
+}
@@ -0,0 +1,26 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Per-pixel data passed to the pixel shader.
+struct VertexShaderOutput
+{
+    float4 pos : SV_POSITION;
+    float2 uv  : TEXCOORD0;
+};
+
+// Generates a triangle covering the viewport from the vertex id, so no vertex buffer is needed.
+VertexShaderOutput main(uint id : SV_VertexID)
+{
+    VertexShaderOutput output;
+    output.uv = float2((id << 1) & 2, id & 2);
+    output.pos = float4(output.uv * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 0.0f, 1.0f);
+    return output;
+}
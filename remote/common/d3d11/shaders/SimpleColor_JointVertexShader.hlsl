@@ -0,0 +1,92 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// A constant buffer that stores the model transform.
+cbuffer ModelConstantBuffer : register(b0)
+{
+    float4x4 model;
+};
+
+// A constant buffer that stores each set of view and projection matrices in column-major format.
+cbuffer ViewProjectionConstantBuffer : register(b1)
+{
+    float4x4 viewProjection[2];
+};
+
+// A constant buffer that stores the number of views each joint instance is drawn to.
+cbuffer JointConstantBuffer : register(b2)
+{
+    uint viewCount;
+};
+
+// Per-vertex data of the unit joint mesh and per-instance data of the joint.
+// The unit mesh stores the normalized x and y offsets of each vertex in pos.xy and
+// the part of the joint it belongs to in pos.z (0 = base, 1 = center ring, 2 = tip).
+struct VertexShaderInput
+{
+    float3      pos         : POSITION;
+    min16float3 color       : COLOR0;
+    float3      jointPos    : JOINTPOSITION;
+    float4      jointRot    : JOINTORIENTATION;
+    float2      jointSize   : JOINTSIZE; // x = length, y = radius
+    uint        instId      : SV_InstanceID;
+};
+
+// Per-vertex data passed to the geometry shader.
+// Note that the render target array index will be set by the geometry shader
+// using the value of viewId.
+struct VertexShaderOutput
+{
+    float4      pos     : SV_POSITION;
+    min16float3 color   : COLOR0;
+    uint        viewId  : TEXCOORD0;  // SV_InstanceID % 2
+};
+
+float3 RotateByQuaternion(float3 v, float4 q)
+{
+    return v + 2.0f * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+// Expands the unit joint mesh to the size of the joint instance and transforms it into clip space.
+VertexShaderOutput main(VertexShaderInput input)
+{
+    VertexShaderOutput output;
+
+    float jointLength = input.jointSize.x;
+    float jointRadius = input.jointSize.y;
+    float centerHeight = min(jointRadius, 0.5f * jointLength);
+
+    float3 localPos;
+    localPos.xy = input.pos.xy * (jointRadius * 0.70710678f);
+    localPos.z = -(input.pos.z <= 1.0f ? input.pos.z * centerHeight : jointLength);
+
+    float4 pos = float4(RotateByQuaternion(localPos, input.jointRot) + input.jointPos, 1.0f);
+
+    // Each joint instance is drawn once per view, see SpatialInputRenderer::Draw.
+    int idx = input.instId % viewCount;
+
+    // Transform the vertex position into world space.
+    pos = mul(pos, model);
+
+    // Correct for perspective and project the vertex position onto the screen.
+    pos = mul(pos, viewProjection[idx]);
+
+    output.pos = pos;
+
+    // Pass the color through without modification.
+    output.color = input.color;
+
+    // Set the instance ID. The pass-through geometry shader will set the
+    // render target array index to whatever value is set here.
+    output.viewId = idx;
+
+    return output;
+}
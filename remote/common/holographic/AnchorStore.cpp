@@ -0,0 +1,296 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <pch.h>
+
+#include <DbgLog.h>
+#include <holographic/AnchorStore.h>
+
+#include <winrt/Windows.Foundation.Collections.h>
+
+#include <algorithm>
+#include <iterator>
+
+using namespace winrt::Windows::Foundation::Numerics;
+using namespace winrt::Windows::Perception::Spatial;
+
+void AnchorStore::Reset()
+{
+    std::lock_guard lock(m_mutex);
+
+    m_generation++;
+    m_storeState = StoreState::Closed;
+    m_store = nullptr;
+    m_savedAnchors.clear();
+    m_savedAnchorsEnumerated = false;
+    m_pendingSaves.clear();
+    m_saveInFlight = false;
+    m_pendingRegions.clear();
+    m_regionLoadInFlight = false;
+    m_unlocatedAnchors.clear();
+}
+
+void AnchorStore::Save(const winrt::hstring& name, const SpatialAnchor& anchor)
+{
+    std::lock_guard lock(m_mutex);
+    m_pendingSaves.push_back({name, anchor});
+    ProcessPendingLocked();
+}
+
+void AnchorStore::Remove(const winrt::hstring& name)
+{
+    std::lock_guard lock(m_mutex);
+    m_pendingSaves.push_back({name, nullptr});
+    ProcessPendingLocked();
+}
+
+void AnchorStore::LoadRegion(const std::wstring& region, LocatedHandler handler)
+{
+    std::lock_guard lock(m_mutex);
+    m_pendingRegions.push_back({region, std::move(handler)});
+    ProcessPendingLocked();
+}
+
+void AnchorStore::Update(const SpatialCoordinateSystem& coordinateSystem, uint32_t maxAnchors)
+{
+    std::vector<UnlocatedAnchor> anchors;
+    uint64_t generation = 0;
+    {
+        std::lock_guard lock(m_mutex);
+        while (anchors.size() < maxAnchors && !m_unlocatedAnchors.empty())
+        {
+            anchors.push_back(std::move(m_unlocatedAnchors.front()));
+            m_unlocatedAnchors.pop_front();
+        }
+        generation = m_generation;
+    }
+
+    std::vector<UnlocatedAnchor> retries;
+    for (UnlocatedAnchor& anchor : anchors)
+    {
+        if (auto anchorToCoordinateSystem = anchor.anchor.CoordinateSystem().TryGetTransformTo(coordinateSystem))
+        {
+            (*anchor.handler)(anchor.name, anchorToCoordinateSystem.Value());
+        }
+        else
+        {
+            retries.push_back(std::move(anchor));
+        }
+    }
+
+    // Anchors which cannot be located yet go to the back, so they do not hold up the others.
+    std::lock_guard lock(m_mutex);
+    if (generation == m_generation)
+    {
+        std::move(retries.begin(), retries.end(), std::back_inserter(m_unlocatedAnchors));
+    }
+}
+
+std::wstring_view AnchorStore::GetRegion(std::wstring_view name)
+{
+    const size_t separator = name.rfind(L'/');
+    return separator == std::wstring_view::npos ? std::wstring_view() : name.substr(0, separator);
+}
+
+void AnchorStore::ProcessPendingLocked()
+{
+    if (m_storeState == StoreState::Closed)
+    {
+        m_storeState = StoreState::Opening;
+        OpenStoreAsync(m_generation);
+        return;
+    }
+
+    if (m_storeState != StoreState::Open)
+    {
+        return;
+    }
+
+    if (!m_pendingSaves.empty() && !m_saveInFlight)
+    {
+        m_saveInFlight = true;
+        SaveBatchesAsync(m_generation);
+    }
+
+    if (!m_pendingRegions.empty() && !m_regionLoadInFlight)
+    {
+        m_regionLoadInFlight = true;
+        LoadRegionsAsync(m_generation);
+    }
+}
+
+winrt::fire_and_forget AnchorStore::OpenStoreAsync(uint64_t generation)
+{
+    auto keepAlive = shared_from_this();
+
+    // The caller holds the lock, which must not be taken again before it returns.
+    co_await winrt::resume_background();
+
+    SpatialAnchorStore store = nullptr;
+    try
+    {
+        store = co_await SpatialAnchorManager::RequestStoreAsync();
+    }
+    catch (const winrt::hresult_error&)
+    {
+    }
+
+    std::lock_guard lock(m_mutex);
+    if (generation != m_generation)
+    {
+        co_return;
+    }
+
+    if (!store)
+    {
+        // Requested again by the next call.
+        DebugLog(L"Failed to open the spatial anchor store.\n");
+        m_storeState = StoreState::Closed;
+        co_return;
+    }
+
+    m_store = store;
+    m_storeState = StoreState::Open;
+    ProcessPendingLocked();
+}
+
+winrt::fire_and_forget AnchorStore::SaveBatchesAsync(uint64_t generation)
+{
+    auto keepAlive = shared_from_this();
+    co_await winrt::resume_background();
+
+    // Saves queued while a batch is written form the next batch.
+    while (true)
+    {
+        std::vector<PendingSave> batch;
+        SpatialAnchorStore store = nullptr;
+        {
+            std::lock_guard lock(m_mutex);
+            if (generation != m_generation)
+            {
+                co_return;
+            }
+
+            if (m_pendingSaves.empty())
+            {
+                m_saveInFlight = false;
+                co_return;
+            }
+
+            batch.swap(m_pendingSaves);
+            store = m_store;
+        }
+
+        uint32_t failedCount = 0;
+        for (const PendingSave& save : batch)
+        {
+            try
+            {
+                store.Remove(save.name);
+                if (save.anchor && !store.TrySave(save.name, save.anchor))
+                {
+                    failedCount++;
+                }
+            }
+            catch (const winrt::hresult_error&)
+            {
+                failedCount++;
+            }
+        }
+
+        if (failedCount > 0)
+        {
+            DebugLog(L"Failed to save %u of %u spatial anchors.\n", failedCount, static_cast<uint32_t>(batch.size()));
+        }
+
+        std::lock_guard lock(m_mutex);
+        if (generation == m_generation)
+        {
+            for (const PendingSave& save : batch)
+            {
+                if (save.anchor)
+                {
+                    m_savedAnchors.insert_or_assign(std::wstring(save.name), save.anchor);
+                }
+                else
+                {
+                    m_savedAnchors.erase(std::wstring(save.name));
+                }
+            }
+        }
+    }
+}
+
+winrt::fire_and_forget AnchorStore::LoadRegionsAsync(uint64_t generation)
+{
+    auto keepAlive = shared_from_this();
+    co_await winrt::resume_background();
+
+    bool enumerate = false;
+    SpatialAnchorStore store = nullptr;
+    {
+        std::lock_guard lock(m_mutex);
+        if (generation != m_generation)
+        {
+            co_return;
+        }
+        enumerate = !m_savedAnchorsEnumerated;
+        store = m_store;
+    }
+
+    // Enumerating all saved anchors is the expensive part, which happens once per store and not while the lock is held.
+    std::map<std::wstring, SpatialAnchor, std::less<>> savedAnchors;
+    if (enumerate)
+    {
+        try
+        {
+            for (const auto& pair : store.GetAllSavedAnchors())
+            {
+                savedAnchors.emplace(std::wstring(pair.Key()), pair.Value());
+            }
+        }
+        catch (const winrt::hresult_error&)
+        {
+            DebugLog(L"Failed to enumerate the saved spatial anchors.\n");
+        }
+    }
+
+    std::lock_guard lock(m_mutex);
+    if (generation != m_generation)
+    {
+        co_return;
+    }
+
+    if (enumerate)
+    {
+        // Saves which completed meanwhile are more recent than the enumeration.
+        for (const auto& [name, anchor] : m_savedAnchors)
+        {
+            savedAnchors.insert_or_assign(name, anchor);
+        }
+        m_savedAnchors = std::move(savedAnchors);
+        m_savedAnchorsEnumerated = true;
+    }
+
+    for (PendingRegion& pendingRegion : m_pendingRegions)
+    {
+        auto handler = std::make_shared<const LocatedHandler>(std::move(pendingRegion.handler));
+        for (const auto& [name, anchor] : m_savedAnchors)
+        {
+            if (GetRegion(name) == pendingRegion.region)
+            {
+                m_unlocatedAnchors.push_back({winrt::hstring(name), anchor, handler});
+            }
+        }
+    }
+    m_pendingRegions.clear();
+    m_regionLoadInFlight = false;
+}
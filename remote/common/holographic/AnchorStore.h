@@ -0,0 +1,111 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <winrt/Windows.Foundation.Numerics.h>
+#include <winrt/Windows.Perception.Spatial.h>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Persists spatial anchors in the SpatialAnchorStore of the connected device, for apps with many anchored holograms.
+// The store is requested once and kept until Reset. The saved anchors are enumerated once, on a worker thread, when the first
+// region is loaded. Saves are queued and written in batches on a worker thread. The anchors of a loaded region are located
+// by Update on the render thread, a few per frame, so neither startup nor a frame waits for all anchors.
+// Anchor names have the form "<region>/<name>", names without '/' belong to the region "".
+class AnchorStore : public std::enable_shared_from_this<AnchorStore>
+{
+public:
+    // Called by Update with the name of a located anchor and the transform from the anchor to the coordinate system passed to Update.
+    using LocatedHandler =
+        std::function<void(const winrt::hstring& name, const winrt::Windows::Foundation::Numerics::float4x4& anchorToCoordinateSystem)>;
+
+    // Drops the store and all pending work, e.g. after disconnecting. The next call requests the store of the new connection.
+    void Reset();
+
+    // Queues the anchor to be saved under the name, replacing a saved anchor of the same name.
+    void Save(const winrt::hstring& name, const winrt::Windows::Perception::Spatial::SpatialAnchor& anchor);
+
+    // Queues the removal of the saved anchor of the name.
+    void Remove(const winrt::hstring& name);
+
+    // Loads the saved anchors of a region. Each of them is passed to the handler once Update was able to locate it.
+    void LoadRegion(const std::wstring& region, LocatedHandler handler);
+
+    // Locates up to maxAnchors of the loaded anchors relative to the coordinate system. Anchors which cannot be located yet are
+    // retried in later calls. Call once per frame.
+    void Update(const winrt::Windows::Perception::Spatial::SpatialCoordinateSystem& coordinateSystem, uint32_t maxAnchors = 8);
+
+private:
+    enum class StoreState
+    {
+        Closed,
+        Opening,
+        Open,
+    };
+
+    // A queued save, or removal if the anchor is null.
+    struct PendingSave
+    {
+        winrt::hstring name;
+        winrt::Windows::Perception::Spatial::SpatialAnchor anchor = nullptr;
+    };
+
+    struct PendingRegion
+    {
+        std::wstring region;
+        LocatedHandler handler;
+    };
+
+    struct UnlocatedAnchor
+    {
+        winrt::hstring name;
+        winrt::Windows::Perception::Spatial::SpatialAnchor anchor = nullptr;
+        std::shared_ptr<const LocatedHandler> handler;
+    };
+
+    static std::wstring_view GetRegion(std::wstring_view name);
+
+    // Requests the store if needed and starts the workers for the pending saves and regions once it is open.
+    // Must be called with m_mutex held.
+    void ProcessPendingLocked();
+
+    winrt::fire_and_forget OpenStoreAsync(uint64_t generation);
+    winrt::fire_and_forget SaveBatchesAsync(uint64_t generation);
+    winrt::fire_and_forget LoadRegionsAsync(uint64_t generation);
+
+    std::mutex m_mutex;
+
+    // Incremented by Reset, workers of a previous generation discard their results.
+    uint64_t m_generation = 0;
+
+    StoreState m_storeState = StoreState::Closed;
+    winrt::Windows::Perception::Spatial::SpatialAnchorStore m_store = nullptr;
+
+    // The saved anchors by name. Holds the anchors saved by this instance until the first region is loaded, which adds the ones
+    // enumerated from the store.
+    std::map<std::wstring, winrt::Windows::Perception::Spatial::SpatialAnchor, std::less<>> m_savedAnchors;
+    bool m_savedAnchorsEnumerated = false;
+
+    std::vector<PendingSave> m_pendingSaves;
+    bool m_saveInFlight = false;
+
+    std::vector<PendingRegion> m_pendingRegions;
+    bool m_regionLoadInFlight = false;
+
+    std::deque<UnlocatedAnchor> m_unlocatedAnchors;
+};
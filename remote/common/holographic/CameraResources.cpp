@@ -16,8 +16,7 @@
 #include <d3d11/DirectXHelper.h>
 #include <holographic/DeviceResources.h>
 
-#include <windows.graphics.directx.direct3d11.interop.h>
-
+#include <winrt/Windows.Foundation.Metadata.h>
 #include <winrt/Windows.Perception.Spatial.h>
 
 using namespace DirectX;
@@ -29,11 +28,22 @@ namespace DXHelper
     CameraResources::CameraResources(const HolographicCamera& camera)
         : m_holographicCamera(camera)
         , m_isStereo(camera.IsStereo())
+        , m_isSecondary(IsSecondaryCamera(camera))
         , m_d3dRenderTargetSize(camera.RenderTargetSize())
     {
         m_d3dViewport = CD3D11_VIEWPORT(0.f, 0.f, m_d3dRenderTargetSize.Width, m_d3dRenderTargetSize.Height);
     };
 
+    bool CameraResources::IsSecondaryCamera(const HolographicCamera& camera)
+    {
+        // The photo video camera has a view configuration of its own. Without view configurations any mono camera is secondary,
+        // the display is stereo.
+        static const bool hasViewConfiguration = winrt::Windows::Foundation::Metadata::ApiInformation::IsPropertyPresent(
+            L"Windows.Graphics.Holographic.HolographicCamera", L"ViewConfiguration");
+        HolographicViewConfiguration viewConfiguration = hasViewConfiguration ? camera.ViewConfiguration() : nullptr;
+        return viewConfiguration ? viewConfiguration.Kind() != HolographicViewConfigurationKind::Display : !camera.IsStereo();
+    }
+
     // Updates resources associated with a holographic camera's swap chain.
     // The app does not access the swap chain directly, but it does create
     // resource views for the back buffer.
@@ -104,16 +114,18 @@ namespace DXHelper
                 // Set render target size.
                 m_d3dRenderTargetSize = currentSize;
 
-                // A new depth stencil view is also needed.
-                m_d3dDepthStencil = nullptr;
-                m_d3dDepthStencilView = nullptr;
+                // A new depth stencil view is also needed. The current one is kept for cameras of the previous size.
+                pDeviceResources->GetDepthTargetPool().Release(std::move(m_depthTarget));
+
+                // A held frame of the previous size cannot be copied to the new back buffers.
+                m_heldFrame = nullptr;
             }
         }
 
         // Refresh depth stencil resources, if needed.
-        if (m_d3dDepthStencilView == nullptr)
+        if (m_depthTarget == nullptr)
         {
-            // Create a depth stencil view for use with 3D rendering if needed.
+            // Take a depth stencil view for use with 3D rendering from the pool, which creates it if needed.
             CD3D11_TEXTURE2D_DESC depthStencilDesc(
                 DXGI_FORMAT_R16_TYPELESS,
                 static_cast<UINT>(m_d3dRenderTargetSize.Width),
@@ -122,22 +134,17 @@ namespace DXHelper
                 1,                  // Use a single mipmap level.
                 D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE);
 
-            winrt::check_hresult(device->CreateTexture2D(&depthStencilDesc, nullptr, m_d3dDepthStencil.put()));
-
-            CD3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc(
-                m_isStereo ? D3D11_DSV_DIMENSION_TEXTURE2DARRAY : D3D11_DSV_DIMENSION_TEXTURE2D);
-            depthStencilViewDesc.Format = DXGI_FORMAT_D16_UNORM;
-
-            winrt::check_hresult(
-                device->CreateDepthStencilView(m_d3dDepthStencil.get(), &depthStencilViewDesc, m_d3dDepthStencilView.put()));
+            m_depthTarget = pDeviceResources->GetDepthTargetPool().Acquire(device, depthStencilDesc, DXGI_FORMAT_D16_UNORM);
         }
 
         // Create the constant buffer, if needed.
         if (m_viewProjectionConstantBuffer == nullptr)
         {
             // Create a constant buffer to store view and projection matrices for the camera.
-            CD3D11_BUFFER_DESC constantBufferDesc(sizeof(ViewProjectionConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
-            winrt::check_hresult(device->CreateBuffer(&constantBufferDesc, nullptr, m_viewProjectionConstantBuffer.put()));
+            CD3D11_BUFFER_DESC constantBufferDesc(
+                sizeof(ViewProjectionConstantBuffer), D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+            pDeviceResources->CreateBuffer(
+                MemoryAccounting::Tag::Cameras, constantBufferDesc, nullptr, m_viewProjectionConstantBuffer.put());
         }
     }
 
@@ -146,10 +153,10 @@ namespace DXHelper
     {
         // Release camera-specific resources.
         m_d3dBackBuffer = nullptr;
-        m_d3dDepthStencil = nullptr;
         m_d3dRenderTargetView = nullptr;
-        m_d3dDepthStencilView = nullptr;
+        pDeviceResources->GetDepthTargetPool().Release(std::move(m_depthTarget));
         m_viewProjectionConstantBuffer = nullptr;
+        m_heldFrame = nullptr;
 
         // Ensure system references to the back buffer are released by clearing the render
         // target from the graphics pipeline state, and then flushing the Direct3D context.
@@ -160,69 +167,131 @@ namespace DXHelper
         });
     }
 
+    void CameraResources::HoldFrame(ID3D11DeviceContext* context)
+    {
+        if (m_d3dBackBuffer == nullptr)
+        {
+            return;
+        }
+
+        if (m_heldFrame == nullptr)
+        {
+            // Same layout as the back buffer, so whole resources can be copied in both directions.
+            D3D11_TEXTURE2D_DESC heldFrameDesc;
+            m_d3dBackBuffer->GetDesc(&heldFrameDesc);
+            heldFrameDesc.Usage = D3D11_USAGE_DEFAULT;
+            heldFrameDesc.BindFlags = 0;
+            heldFrameDesc.CPUAccessFlags = 0;
+            heldFrameDesc.MiscFlags = 0;
+
+            winrt::com_ptr<ID3D11Device> device;
+            context->GetDevice(device.put());
+            winrt::check_hresult(device->CreateTexture2D(&heldFrameDesc, nullptr, m_heldFrame.put()));
+            MemoryAccounting::TrackGpuResource(MemoryAccounting::Tag::Cameras, m_heldFrame.get());
+        }
+
+        context->CopyResource(m_heldFrame.get(), m_d3dBackBuffer.get());
+    }
+
+    bool CameraResources::RestoreHeldFrame(ID3D11DeviceContext* context) const
+    {
+        if (m_heldFrame == nullptr || m_d3dBackBuffer == nullptr)
+        {
+            return false;
+        }
+
+        context->CopyResource(m_d3dBackBuffer.get(), m_heldFrame.get());
+        return true;
+    }
+
     // Updates the view/projection constant buffer for a holographic camera.
     void CameraResources::UpdateViewProjectionBuffer(
         std::shared_ptr<DeviceResources> deviceResources,
         const HolographicCameraPose& cameraPose,
         const SpatialCoordinateSystem& coordinateSystem)
+    {
+        if (UpdateViewProjection(cameraPose, coordinateSystem))
+        {
+            // Use the D3D device context to update Direct3D device-based resources.
+            deviceResources->UseD3DDeviceContext([&](auto context) { UploadViewProjectionBuffer(context); });
+        }
+    }
+
+    void CameraResources::UploadViewProjectionBuffer(ID3D11DeviceContext* context)
+    {
+        // Loading is asynchronous. Resources must be created before they can be updated.
+        if (context == nullptr || m_viewProjectionConstantBuffer == nullptr || !m_viewTransformAcquired)
+        {
+            m_framePending = false;
+        }
+        else
+        {
+            // Update the view and projection matrices.
+            DXHelper::UpdateDynamicBuffer(context, m_viewProjectionConstantBuffer.get(), m_viewProjectionConstantBufferData);
+
+            m_framePending = true;
+        }
+    }
+
+    bool CameraResources::UpdateViewProjection(const HolographicCameraPose& cameraPose, const SpatialCoordinateSystem& coordinateSystem)
     {
         // The system changes the viewport on a per-frame basis for system optimizations.
         m_d3dViewport =
             CD3D11_VIEWPORT(cameraPose.Viewport().X, cameraPose.Viewport().Y, cameraPose.Viewport().Width, cameraPose.Viewport().Height);
 
+        // A camera uses its own constant buffer unless it gets assigned an element of the shared array buffer.
+        m_viewProjectionArrayElement = InvalidArrayElement;
+        m_framePending = false;
+
         // The projection transform for each frame is provided by the HolographicCameraPose.
         auto cameraProjectionTransform = cameraPose.ProjectionTransform();
 
-        ViewProjectionConstantBuffer viewProjectionConstantBufferData = {};
-        bool viewTransformAcquired = false;
-
+        // Get a container object with the view and projection matrices for the given
+        // pose in the given coordinate system.
+        auto viewTransformContainer = cameraPose.TryGetViewTransform(coordinateSystem);
+
+        // If TryGetViewTransform returns a null pointer, that means the pose and coordinate
+        // system cannot be understood relative to one another; content cannot be rendered
+        // in this coordinate system for the duration of the current frame.
+        // This usually means that positional tracking is not active for the current frame, in
+        // which case it is possible to use a SpatialLocatorAttachedFrameOfReference to render
+        // content that is not world-locked instead.
+        m_viewTransformAcquired = viewTransformContainer != nullptr;
+        if (m_viewTransformAcquired)
         {
+            // Otherwise, the set of view transforms can be retrieved.
+            auto viewCoordinateSystemTransform = viewTransformContainer.Value();
+
+            // Update the view matrices. Holographic cameras (such as Microsoft HoloLens) are
+            // constantly moving relative to the world. The view matrices need to be updated
+            // every frame.
+            XMStoreFloat4x4(
+                &m_viewProjectionConstantBufferData.viewProjection[0],
+                XMMatrixTranspose(XMLoadFloat4x4(&viewCoordinateSystemTransform.Left) * XMLoadFloat4x4(&cameraProjectionTransform.Left)));
+            XMStoreFloat4x4(
+                &m_viewProjectionConstantBufferData.viewProjection[1],
+                XMMatrixTranspose(
+                    XMLoadFloat4x4(&viewCoordinateSystemTransform.Right) * XMLoadFloat4x4(&cameraProjectionTransform.Right)));
+        }
 
-            // Get a container object with the view and projection matrices for the given
-            // pose in the given coordinate system.
-            auto viewTransformContainer = cameraPose.TryGetViewTransform(coordinateSystem);
-
-            // If TryGetViewTransform returns a null pointer, that means the pose and coordinate
-            // system cannot be understood relative to one another; content cannot be rendered
-            // in this coordinate system for the duration of the current frame.
-            // This usually means that positional tracking is not active for the current frame, in
-            // which case it is possible to use a SpatialLocatorAttachedFrameOfReference to render
-            // content that is not world-locked instead.
-            viewTransformAcquired = viewTransformContainer != nullptr;
-            if (viewTransformAcquired)
-            {
-                // Otherwise, the set of view transforms can be retrieved.
-                auto viewCoordinateSystemTransform = viewTransformContainer.Value();
-
-                // Update the view matrices. Holographic cameras (such as Microsoft HoloLens) are
-                // constantly moving relative to the world. The view matrices need to be updated
-                // every frame.
-                XMStoreFloat4x4(
-                    &viewProjectionConstantBufferData.viewProjection[0],
-                    XMMatrixTranspose(
-                        XMLoadFloat4x4(&viewCoordinateSystemTransform.Left) * XMLoadFloat4x4(&cameraProjectionTransform.Left)));
-                XMStoreFloat4x4(
-                    &viewProjectionConstantBufferData.viewProjection[1],
-                    XMMatrixTranspose(
-                        XMLoadFloat4x4(&viewCoordinateSystemTransform.Right) * XMLoadFloat4x4(&cameraProjectionTransform.Right)));
-            }
+        return m_viewTransformAcquired;
+    }
+
+    bool CameraResources::ReplaceViewProjection(const std::optional<ViewProjectionConstantBuffer>& viewProjection)
+    {
+        m_viewTransformAcquired = viewProjection.has_value();
+        if (m_viewTransformAcquired)
+        {
+            m_viewProjectionConstantBufferData = *viewProjection;
         }
 
-        // Use the D3D device context to update Direct3D device-based resources.
-        deviceResources->UseD3DDeviceContext([&](auto context) {
-            // Loading is asynchronous. Resources must be created before they can be updated.
-            if (context == nullptr || m_viewProjectionConstantBuffer == nullptr || !viewTransformAcquired)
-            {
-                m_framePending = false;
-            }
-            else
-            {
-                // Update the view and projection matrices.
-                context->UpdateSubresource(m_viewProjectionConstantBuffer.get(), 0, nullptr, &viewProjectionConstantBufferData, 0, 0);
+        return m_viewTransformAcquired;
+    }
 
-                m_framePending = true;
-            }
-        });
+    void CameraResources::SetViewProjectionArrayElement(UINT element)
+    {
+        m_viewProjectionArrayElement = element;
+        m_framePending = m_viewTransformAcquired;
     }
 
     // Gets the view-projection constant buffer for the HolographicCamera and attaches it
@@ -239,12 +308,7 @@ namespace DXHelper
                 return false;
             }
 
-            // Set the viewport for this camera.
-            context->RSSetViewports(1, &m_d3dViewport);
-
-            // Send the constant buffer to the vertex shader.
-            ID3D11Buffer* pBuffer = m_viewProjectionConstantBuffer.get();
-            context->VSSetConstantBuffers(1, 1, &pBuffer);
+            BindViewProjectionBuffer(deviceResources.get(), context);
 
             // The template includes a pass-through geometry shader that is used by
             // default on systems that don't support the D3D11_FEATURE_D3D11_OPTIONS3::
@@ -265,16 +329,37 @@ namespace DXHelper
         });
     }
 
+    void CameraResources::BindRenderState(DeviceResources* pDeviceResources, ID3D11DeviceContext1* context) const
+    {
+        BindViewProjectionBuffer(pDeviceResources, context);
+
+        ID3D11RenderTargetView* const targets[1] = {m_d3dRenderTargetView.get()};
+        context->OMSetRenderTargets(1, targets, GetDepthStencilView());
+    }
+
+    void CameraResources::BindViewProjectionBuffer(DeviceResources* pDeviceResources, ID3D11DeviceContext1* context) const
+    {
+        // Set the viewport for this camera.
+        context->RSSetViewports(1, &m_d3dViewport);
+
+        // Send the constant buffer to the vertex shader.
+        if (m_viewProjectionArrayElement != InvalidArrayElement)
+        {
+            ID3D11Buffer* pBuffer = pDeviceResources->GetViewProjectionArrayBuffer();
+            const UINT firstConstant = m_viewProjectionArrayElement * DeviceResources::ViewProjectionArrayElementConstants;
+            const UINT numConstants = DeviceResources::ViewProjectionArrayElementConstants;
+            context->VSSetConstantBuffers1(1, 1, &pBuffer, &firstConstant, &numConstants);
+        }
+        else
+        {
+            ID3D11Buffer* pBuffer = m_viewProjectionConstantBuffer.get();
+            context->VSSetConstantBuffers(1, 1, &pBuffer);
+        }
+    }
+
     winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface CameraResources::GetDepthStencilTextureInteropObject()
     {
-        // Direct3D interop APIs are used to provide the buffer to the WinRT API.
-        winrt::com_ptr<IDXGIResource1> depthStencilResource;
-        winrt::check_bool(m_d3dDepthStencil.try_as(depthStencilResource));
-        winrt::com_ptr<IDXGISurface2> depthDxgiSurface;
-        winrt::check_hresult(depthStencilResource->CreateSubresourceSurface(0, depthDxgiSurface.put()));
-        winrt::com_ptr<::IInspectable> inspectableSurface;
-        winrt::check_hresult(CreateDirect3D11SurfaceFromDXGISurface(
-            depthDxgiSurface.get(), reinterpret_cast<IInspectable**>(winrt::put_abi(inspectableSurface))));
-        return inspectableSurface.as<winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface>();
+        // The surface is kept with the depth target, so committing the depth buffer every frame does not create one.
+        return m_depthTarget->GetInteropSurface();
     }
 } // namespace DXHelper
@@ -11,9 +11,14 @@
 
 #pragma once
 
+#include <d3d11/DepthTargetPool.h>
+
 #include <winrt/Windows.Graphics.Holographic.h>
 
-#include <d3d11.h>
+#include <d3d11_1.h>
+
+#include <memory>
+#include <optional>
 
 using namespace winrt::Windows::Graphics::Holographic;
 using namespace winrt::Windows::Perception::Spatial;
@@ -40,6 +45,9 @@ namespace DXHelper
     public:
         CameraResources(const HolographicCamera& holographicCamera);
 
+        // Returns whether the camera is one besides the display, like the photo video camera of mixed reality capture.
+        static bool IsSecondaryCamera(const HolographicCamera& camera);
+
         void CreateResourcesForBackBuffer(
             DXHelper::DeviceResources* pDeviceResources, const HolographicCameraRenderingParameters& cameraParameters);
         void ReleaseResourcesForBackBuffer(DXHelper::DeviceResources* pDeviceResources);
@@ -49,8 +57,27 @@ namespace DXHelper
             const HolographicCameraPose& cameraPose,
             const SpatialCoordinateSystem& coordinateSystem);
 
+        // Updates the viewport and the view-projection matrices without uploading them. Returns false if the
+        // camera pose cannot be located in the given coordinate system.
+        bool UpdateViewProjection(const HolographicCameraPose& cameraPose, const SpatialCoordinateSystem& coordinateSystem);
+
+        // Replaces the matrices computed by UpdateViewProjection, e.g. with ones from a perception recording. The camera is treated
+        // as not located if no matrices are given. Returns whether the camera is located.
+        bool ReplaceViewProjection(const std::optional<ViewProjectionConstantBuffer>& viewProjection);
+
+        // Uploads the matrices computed by UpdateViewProjection to the camera's own constant buffer.
+        void UploadViewProjectionBuffer(ID3D11DeviceContext* context);
+
+        // Makes the camera use the given element of the view-projection array buffer owned by DeviceResources
+        // instead of its own constant buffer, see DeviceResources::UpdateViewProjectionBuffers.
+        void SetViewProjectionArrayElement(UINT element);
+
         bool AttachViewProjectionBuffer(std::shared_ptr<DXHelper::DeviceResources> deviceResources);
 
+        // Binds the viewport, the view-projection buffer and the render targets of the camera. Used to set up state on
+        // contexts which do not inherit it from AttachViewProjectionBuffer, like deferred contexts.
+        void BindRenderState(DXHelper::DeviceResources* pDeviceResources, ID3D11DeviceContext1* context) const;
+
         // Direct3D device resources.
         ID3D11RenderTargetView* GetBackBufferRenderTargetView() const
         {
@@ -58,7 +85,7 @@ namespace DXHelper
         }
         ID3D11DepthStencilView* GetDepthStencilView() const
         {
-            return m_d3dDepthStencilView.get();
+            return m_depthTarget ? m_depthTarget->view.get() : nullptr;
         }
         ID3D11Texture2D* GetBackBufferTexture2D() const
         {
@@ -66,7 +93,7 @@ namespace DXHelper
         }
         ID3D11Texture2D* GetDepthStencilTexture2D() const
         {
-            return m_d3dDepthStencil.get();
+            return m_depthTarget ? m_depthTarget->texture.get() : nullptr;
         }
         D3D11_VIEWPORT GetViewport() const
         {
@@ -87,23 +114,55 @@ namespace DXHelper
             return m_isStereo;
         }
 
+        // See IsSecondaryCamera.
+        bool IsSecondary() const
+        {
+            return m_isSecondary;
+        }
+
+        // Copies the back buffer rendered this frame, so later frames can repeat it instead of rendering. The copy is dropped
+        // when the render target size changes. Must be called with exclusive access to the context.
+        void HoldFrame(ID3D11DeviceContext* context);
+
+        // Copies the held frame to the back buffer. Returns false if no frame is held.
+        bool RestoreHeldFrame(ID3D11DeviceContext* context) const;
+        bool HasHeldFrame() const
+        {
+            return m_heldFrame != nullptr;
+        }
+
         // The holographic camera these resources are for.
         const HolographicCamera& GetHolographicCamera() const
         {
             return m_holographicCamera;
         }
 
+        const ViewProjectionConstantBuffer& GetViewProjectionConstantBufferData() const
+        {
+            return m_viewProjectionConstantBufferData;
+        }
+
         winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface GetDepthStencilTextureInteropObject();
 
     private:
+        void BindViewProjectionBuffer(DXHelper::DeviceResources* pDeviceResources, ID3D11DeviceContext1* context) const;
+
         // Direct3D rendering objects. Required for 3D.
         winrt::com_ptr<ID3D11RenderTargetView> m_d3dRenderTargetView;
-        winrt::com_ptr<ID3D11DepthStencilView> m_d3dDepthStencilView;
         winrt::com_ptr<ID3D11Texture2D> m_d3dBackBuffer;
-        winrt::com_ptr<ID3D11Texture2D> m_d3dDepthStencil;
+
+        // Taken from and returned to the depth target pool of the device resources.
+        std::shared_ptr<DepthTarget> m_depthTarget;
 
         // Device resource to store view and projection matrices.
         winrt::com_ptr<ID3D11Buffer> m_viewProjectionConstantBuffer;
+        ViewProjectionConstantBuffer m_viewProjectionConstantBufferData = {};
+        bool m_viewTransformAcquired = false;
+
+        // Element of the shared view-projection array buffer used this frame, or InvalidArrayElement
+        // if the camera's own constant buffer holds the view-projection matrices.
+        static constexpr UINT InvalidArrayElement = UINT_MAX;
+        UINT m_viewProjectionArrayElement = InvalidArrayElement;
 
         // Direct3D rendering properties.
         DXGI_FORMAT m_dxgiFormat = DXGI_FORMAT_UNKNOWN;
@@ -113,6 +172,12 @@ namespace DXHelper
         // Indicates whether the camera supports stereoscopic rendering.
         bool m_isStereo = false;
 
+        // Set for cameras besides the display, see IsSecondary.
+        bool m_isSecondary = false;
+
+        // Copy of a back buffer rendered earlier, see HoldFrame.
+        winrt::com_ptr<ID3D11Texture2D> m_heldFrame;
+
         // Indicates whether this camera has a pending frame.
         bool m_framePending = false;
 
@@ -0,0 +1,53 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <holographic/ContentDepthRange.h>
+
+#include <algorithm>
+#include <limits>
+
+using namespace winrt::Windows::Foundation::Numerics;
+
+bool ContentDepthRange::ComputePlanes(
+    const winrt::Windows::Graphics::Holographic::HolographicStereoTransform& viewTransform,
+    float& nearPlane,
+    float& farPlane) const
+{
+    float minDepth = std::numeric_limits<float>::max();
+    float maxDepth = 0.0f;
+
+    for (const float4x4& view : {viewTransform.Left, viewTransform.Right})
+    {
+        for (const FrustumCulling::CullingSphere& bounds : m_bounds)
+        {
+            // Views look down the negative z axis.
+            const float depth = -transform(bounds.center, view).z;
+            if (depth + bounds.radius <= 0.0f)
+            {
+                continue;
+            }
+
+            minDepth = std::min(minDepth, depth - bounds.radius);
+            maxDepth = std::max(maxDepth, depth + bounds.radius);
+        }
+    }
+
+    if (maxDepth == 0.0f)
+    {
+        nearPlane = DefaultNearPlane;
+        farPlane = DefaultFarPlane;
+        return false;
+    }
+
+    nearPlane = std::clamp(minDepth - Margin, DefaultNearPlane, DefaultFarPlane - Margin);
+    farPlane = std::clamp(maxDepth + Margin, nearPlane + Margin, DefaultFarPlane);
+    return true;
+}
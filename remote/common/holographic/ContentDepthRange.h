@@ -0,0 +1,57 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <holographic/FrustumCulling.h>
+
+#include <vector>
+
+#include <winrt/Windows.Graphics.Holographic.h>
+
+// Collects the bounding spheres of the content of a frame, in the rendering coordinate system, and derives near and far
+// plane distances which enclose the content tightly. The depth buffer precision is then spent where the content is, which
+// improves the depth based reprojection on the player and lets the depth buffer compress better when it is streamed.
+class ContentDepthRange
+{
+public:
+    // The default plane distances of a holographic camera, also used if there is no content in front of it.
+    static constexpr float DefaultNearPlane = 0.1f;
+    static constexpr float DefaultFarPlane = 20.0f;
+
+    // The planes are applied to the next frame. The margin keeps content within the range while the head keeps moving.
+    static constexpr float Margin = 0.25f;
+
+    void Clear()
+    {
+        m_bounds.clear();
+    }
+
+    void Add(const FrustumCulling::CullingSphere& bounds)
+    {
+        m_bounds.push_back(bounds);
+    }
+
+    void Add(const std::vector<FrustumCulling::CullingSphere>& bounds)
+    {
+        m_bounds.insert(m_bounds.end(), bounds.begin(), bounds.end());
+    }
+
+    // Computes the plane distances enclosing the content for both views of the given view transform, clamped to the default
+    // range. Returns false, and the default range, if no content is in front of the views.
+    bool ComputePlanes(
+        const winrt::Windows::Graphics::Holographic::HolographicStereoTransform& viewTransform,
+        float& nearPlane,
+        float& farPlane) const;
+
+private:
+    std::vector<FrustumCulling::CullingSphere> m_bounds;
+};
@@ -0,0 +1,151 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <pch.h>
+
+#include <holographic/DeferredContextRecorder.h>
+
+DXHelper::DeferredContextRecorder::DeferredContextRecorder(const std::shared_ptr<DeviceResources>& deviceResources)
+    : m_deviceResources(deviceResources)
+{
+    m_thread = std::thread([this]() { Run(); });
+}
+
+DXHelper::DeferredContextRecorder::~DeferredContextRecorder()
+{
+    // The recorder thread uses the deferred context, so any pending recording has to finish first.
+    {
+        std::unique_lock lock(m_mutex);
+        WaitForRecording(lock);
+        m_stopping = true;
+    }
+    m_changed.notify_all();
+
+    if (m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+void DXHelper::DeferredContextRecorder::ReleaseDeviceDependentResources()
+{
+    {
+        std::unique_lock lock(m_mutex);
+        WaitForRecording(lock);
+        m_commandList = nullptr;
+        m_exception = nullptr;
+    }
+    m_recordingStarted = false;
+
+    m_deferredContext = nullptr;
+}
+
+void DXHelper::DeferredContextRecorder::BeginRecording(std::function<void()> func)
+{
+    if (!m_deferredContext)
+    {
+        winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateDeferredContext3(0, m_deferredContext.put()));
+    }
+
+    {
+        std::unique_lock lock(m_mutex);
+        WaitForRecording(lock);
+        m_commandList = nullptr;
+        m_exception = nullptr;
+        m_func = std::move(func);
+        m_recordingPending = true;
+    }
+    m_changed.notify_all();
+
+    m_recordingStarted = true;
+}
+
+void DXHelper::DeferredContextRecorder::ExecuteRecording()
+{
+    if (!m_recordingStarted)
+    {
+        return;
+    }
+    m_recordingStarted = false;
+
+    winrt::com_ptr<ID3D11CommandList> commandList;
+    {
+        std::unique_lock lock(m_mutex);
+        WaitForRecording(lock);
+        commandList = std::move(m_commandList);
+        if (m_exception)
+        {
+            std::rethrow_exception(std::exchange(m_exception, nullptr));
+        }
+    }
+
+    m_deviceResources->ExecuteCommandList(commandList.get());
+}
+
+void DXHelper::DeferredContextRecorder::WaitForRecording(std::unique_lock<std::mutex>& lock)
+{
+    m_changed.wait(lock, [this]() { return !m_recordingPending; });
+}
+
+void DXHelper::DeferredContextRecorder::Run()
+{
+    SetThreadDescription(GetCurrentThread(), L"Deferred context recorder");
+
+    std::unique_lock lock(m_mutex);
+    while (true)
+    {
+        m_changed.wait(lock, [this]() { return m_recordingPending || m_stopping; });
+        if (!m_recordingPending)
+        {
+            return;
+        }
+
+        std::function<void()> func = std::move(m_func);
+        lock.unlock();
+
+        winrt::com_ptr<ID3D11CommandList> commandList;
+        std::exception_ptr exception;
+        try
+        {
+            commandList = Record(func);
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+
+        lock.lock();
+        m_commandList = std::move(commandList);
+        m_exception = exception;
+        m_recordingPending = false;
+        m_changed.notify_all();
+    }
+}
+
+winrt::com_ptr<ID3D11CommandList> DXHelper::DeferredContextRecorder::Record(const std::function<void()>& func)
+{
+    winrt::com_ptr<ID3D11CommandList> commandList;
+
+    try
+    {
+        m_deviceResources->RecordD3DDeviceContext(m_deferredContext.get(), func);
+    }
+    catch (...)
+    {
+        // Drop the partially recorded commands, so the next recording starts from a clean deferred context.
+        m_deferredContext->FinishCommandList(FALSE, commandList.put());
+        throw;
+    }
+
+    // Every recording sets up its state from scratch, so the deferred context state does not need to be restored.
+    winrt::check_hresult(m_deferredContext->FinishCommandList(FALSE, commandList.put()));
+    return commandList;
+}
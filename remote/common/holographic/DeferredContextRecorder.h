@@ -0,0 +1,69 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <holographic/DeviceResources.h>
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace DXHelper
+{
+    // Records the Direct3D commands of a renderer into its own deferred context on a recorder thread, which the recorder keeps
+    // for its whole lifetime instead of starting a thread per recording.
+    // While the recording function runs, DeviceResources::UseD3DDeviceContext on the worker thread hands out the deferred
+    // context instead of the immediate context, so renderers do not need to know whether they are being recorded.
+    class DeferredContextRecorder
+    {
+    public:
+        DeferredContextRecorder(const std::shared_ptr<DeviceResources>& deviceResources);
+        ~DeferredContextRecorder();
+
+        void ReleaseDeviceDependentResources();
+
+        // Starts recording the commands issued by func on the recorder thread. A recording which was not executed is dropped.
+        // A deferred context does not inherit any state from the immediate context, func has to set up everything it needs.
+        void BeginRecording(std::function<void()> func);
+
+        // Waits for the current recording to finish and executes the recorded command list on the immediate context.
+        // Rethrows any exception thrown while recording.
+        void ExecuteRecording();
+
+    private:
+        void Run();
+        winrt::com_ptr<ID3D11CommandList> Record(const std::function<void()>& func);
+
+        // Waits until the recorder thread finished the current recording. The caller holds m_mutex.
+        void WaitForRecording(std::unique_lock<std::mutex>& lock);
+
+        std::shared_ptr<DeviceResources> m_deviceResources;
+
+        winrt::com_ptr<ID3D11DeviceContext3> m_deferredContext;
+
+        // Handed over between the render thread and the recorder thread.
+        std::mutex m_mutex;
+        std::condition_variable m_changed;
+        std::function<void()> m_func;
+        bool m_recordingPending = false;
+        bool m_stopping = false;
+        winrt::com_ptr<ID3D11CommandList> m_commandList;
+        std::exception_ptr m_exception;
+
+        // Set from BeginRecording until ExecuteRecording, only used on the render thread.
+        bool m_recordingStarted = false;
+
+        std::thread m_thread;
+    };
+} // namespace DXHelper
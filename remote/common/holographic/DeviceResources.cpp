@@ -11,6 +11,7 @@
 
 #include <pch.h>
 
+#include <d3d11/AdapterSelection.h>
 #include <d3d11/DirectXHelper.h>
 #include <holographic/DeviceResources.h>
 
@@ -60,12 +61,45 @@ void DXHelper::DeviceResources::CreateDeviceIndependentResources()
         CoCreateInstance(CLSID_WICImagingFactory2, nullptr, CLSCTX_INPROC_SERVER, __uuidof(m_wicFactory), m_wicFactory.put_void()));
 }
 
-void DXHelper::DeviceResources::SetHolographicSpace(HolographicSpace holographicSpace)
+bool DXHelper::DeviceResources::SetHolographicSpace(HolographicSpace holographicSpace)
 {
+    // The cameras belong to the previous space, the new space adds its own cameras.
+    if (m_holographicSpace != nullptr && m_holographicSpace != holographicSpace)
+    {
+        RemoveAllHolographicCameras();
+    }
+
     // Cache the holographic space. Used to re-initalize during device-lost scenarios.
     m_holographicSpace = holographicSpace;
 
+    // A new space, e.g. after reconnecting with a new remote context, can keep using the current device if it is on the adapter
+    // the space asks for. The device dependent resources of the app stay valid then and do not need to be recreated.
+    if (CanReuseDevice())
+    {
+        m_holographicSpace.SetDirect3D11Device(m_d3dInteropDevice);
+        return false;
+    }
+
     InitializeUsingHolographicSpace();
+    return true;
+}
+
+bool DXHelper::DeviceResources::CanReuseDevice() const
+{
+    if (!m_d3dDevice || m_d3dDevice->GetDeviceRemovedReason() != S_OK)
+    {
+        return false;
+    }
+
+    const auto adapterId = m_holographicSpace.PrimaryAdapterId();
+    if (adapterId.LowPart == 0 && adapterId.HighPart == 0)
+    {
+        return true;
+    }
+
+    DXGI_ADAPTER_DESC2 adapterDesc;
+    return m_dxgiAdapter && SUCCEEDED(m_dxgiAdapter->GetDesc2(&adapterDesc)) && adapterDesc.AdapterLuid.LowPart == adapterId.LowPart &&
+           adapterDesc.AdapterLuid.HighPart == adapterId.HighPart;
 }
 
 void DXHelper::DeviceResources::InitializeUsingHolographicSpace()
@@ -74,31 +108,33 @@ void DXHelper::DeviceResources::InitializeUsingHolographicSpace()
     // holograms, in which case it will specify a non-zero PrimaryAdapterId.
     LUID id = {m_holographicSpace.PrimaryAdapterId().LowPart, m_holographicSpace.PrimaryAdapterId().HighPart};
 
+    UINT createFlags = 0;
+#ifdef _DEBUG
+    if (DXHelper::SdkLayersAvailable())
+    {
+        createFlags |= DXGI_CREATE_FACTORY_DEBUG;
+    }
+#endif
+    // Create the DXGI factory.
+    winrt::com_ptr<IDXGIFactory1> dxgiFactory;
+    winrt::check_hresult(CreateDXGIFactory2(createFlags, __uuidof(dxgiFactory), dxgiFactory.put_void()));
+    winrt::com_ptr<IDXGIFactory4> dxgiFactory4;
+    dxgiFactory.as(dxgiFactory4);
+
     // When a primary adapter ID is given to the app, the app should find
     // the corresponding DXGI adapter and use it to create Direct3D devices
     // and device contexts. Otherwise, there is no restriction on the DXGI
-    // adapter the app can use.
+    // adapter the app can use, and the adapter is chosen for rendering and
+    // encoding the remoted frames.
+    m_dxgiAdapter = nullptr;
     if ((id.HighPart != 0) || (id.LowPart != 0))
     {
-        UINT createFlags = 0;
-#ifdef _DEBUG
-        if (DXHelper::SdkLayersAvailable())
-        {
-            createFlags |= DXGI_CREATE_FACTORY_DEBUG;
-        }
-#endif
-        // Create the DXGI factory.
-        winrt::com_ptr<IDXGIFactory1> dxgiFactory;
-        winrt::check_hresult(CreateDXGIFactory2(createFlags, __uuidof(dxgiFactory), dxgiFactory.put_void()));
-        winrt::com_ptr<IDXGIFactory4> dxgiFactory4;
-        dxgiFactory.as(dxgiFactory4);
-
         // Retrieve the adapter specified by the holographic space.
         winrt::check_hresult(dxgiFactory4->EnumAdapterByLuid(id, __uuidof(m_dxgiAdapter), m_dxgiAdapter.put_void()));
     }
     else
     {
-        m_dxgiAdapter = nullptr;
+        m_dxgiAdapter = DXHelper::SelectAdapter(dxgiFactory4.get(), m_adapterIndex);
     }
 
     CreateDeviceResources();
@@ -195,21 +231,44 @@ void DXHelper::DeviceResources::CreateDeviceResources()
     {
         m_supportsVprt = true;
     }
+
+    // Check for device support for binding a range of a constant buffer, which is used to share one buffer between all cameras.
+    D3D11_FEATURE_DATA_D3D11_OPTIONS options0;
+    m_d3dDevice->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options0, sizeof(options0));
+    m_supportsConstantBufferOffsetting = options0.ConstantBufferOffsetting;
+
+    m_vertexRingBuffer.CreateDeviceDependentResources(m_d3dDevice.get());
+    m_shaderCache.CreateDeviceDependentResources(m_d3dDevice.get());
+    m_gpuTimer.CreateDeviceDependentResources(m_d3dDevice.get());
+    m_occlusionCuller.CreateDeviceDependentResources(m_d3dDevice.get(), m_shaderCache);
+    m_videoMemoryBudget.CreateDeviceDependentResources(m_dxgiAdapter.get());
 }
 
 // Validates the back buffer for each HolographicCamera and recreates
 // resources for back buffers that have changed.
-// Locks the set of holographic camera resources until the function exits.
 void DXHelper::DeviceResources::EnsureCameraResources(HolographicFrame frame, HolographicFramePrediction prediction)
 {
-    UseHolographicCameraResources([this, frame, prediction](std::map<UINT32, std::unique_ptr<CameraResources>>& cameraResourceMap) {
+    // All draw calls of the previous frame have been issued, so the space they used in the vertex ring buffer can be recycled.
+    UseD3DDeviceContext([this](auto context) { m_vertexRingBuffer.BeginFrame(); });
+
+    // The previous frame no longer uses the cameras which were removed meanwhile.
+    ReleaseRemovedHolographicCameras();
+
+    // The content updates of the frame decide against the current usage whether to release resources.
+    m_videoMemoryBudget.Update();
+
+    UseHolographicCameraResources([this, frame, prediction](const CameraResourceSet& cameraResources) {
         for (HolographicCameraPose const& cameraPose : prediction.CameraPoses())
         {
             try
             {
-                HolographicCameraRenderingParameters renderingParameters = frame.GetRenderingParameters(cameraPose);
-                CameraResources* pCameraResources = cameraResourceMap[cameraPose.HolographicCamera().Id()].get();
-                pCameraResources->CreateResourcesForBackBuffer(this, renderingParameters);
+                // A camera which was just added might not be part of the set yet.
+                CameraResources* pCameraResources = cameraResources.Find(cameraPose.HolographicCamera().Id());
+                if (pCameraResources != nullptr)
+                {
+                    HolographicCameraRenderingParameters renderingParameters = frame.GetRenderingParameters(cameraPose);
+                    pCameraResources->CreateResourcesForBackBuffer(this, renderingParameters);
+                }
             }
             catch (const winrt::hresult_error&)
             {
@@ -218,32 +277,164 @@ void DXHelper::DeviceResources::EnsureCameraResources(HolographicFrame frame, Ho
     });
 }
 
+// Computes the view-projection matrices of all cameras first and then uploads them to one constant buffer with a single
+// map, instead of updating a separate constant buffer for each camera. Each camera binds its own range of the buffer.
+// Falls back to the per-camera constant buffers if the device does not support constant buffer offsetting.
+void DXHelper::DeviceResources::UpdateViewProjectionBuffers(
+    const CameraResourceSet& cameraResources,
+    const HolographicFramePrediction& prediction,
+    const winrt::Windows::Perception::Spatial::SpatialCoordinateSystem& coordinateSystem,
+    winrt::array_view<const std::optional<ViewProjectionConstantBuffer>> replacedViewProjections)
+{
+    auto cameraPoses = prediction.CameraPoses();
+
+    auto updateViewProjection = [&](CameraResources& resources, const HolographicCameraPose& cameraPose, UINT poseIndex) {
+        const bool located = resources.UpdateViewProjection(cameraPose, coordinateSystem);
+        return poseIndex < replacedViewProjections.size() ? resources.ReplaceViewProjection(replacedViewProjections[poseIndex]) : located;
+    };
+
+    const UINT elementSize = ViewProjectionArrayElementConstants * sizeof(float) * 4;
+    static_assert(sizeof(ViewProjectionConstantBuffer) <= ViewProjectionArrayElementConstants * sizeof(float) * 4);
+
+    UseD3DDeviceContext([&](auto context) {
+        if (!m_supportsConstantBufferOffsetting)
+        {
+            UINT poseIndex = 0;
+            for (const HolographicCameraPose& cameraPose : cameraPoses)
+            {
+                CameraResources* pCameraResources = cameraResources.Find(cameraPose.HolographicCamera().Id());
+                if (pCameraResources != nullptr && updateViewProjection(*pCameraResources, cameraPose, poseIndex))
+                {
+                    pCameraResources->UploadViewProjectionBuffer(context);
+                }
+                ++poseIndex;
+            }
+            return;
+        }
+
+        const UINT cameraCount = cameraPoses.Size();
+        if (cameraCount == 0)
+        {
+            return;
+        }
+
+        if (m_viewProjectionArrayCapacity < cameraCount)
+        {
+            m_viewProjectionArrayBuffer = nullptr;
+            const CD3D11_BUFFER_DESC bufferDesc(
+                cameraCount * elementSize, D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+            CreateBuffer(MemoryAccounting::Tag::Cameras, bufferDesc, nullptr, m_viewProjectionArrayBuffer.put());
+            m_viewProjectionArrayCapacity = cameraCount;
+        }
+
+        D3D11_MAPPED_SUBRESOURCE mappedResource = {};
+        winrt::check_hresult(context->Map(m_viewProjectionArrayBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
+
+        UINT element = 0;
+        for (const HolographicCameraPose& cameraPose : cameraPoses)
+        {
+            CameraResources* pCameraResources = cameraResources.Find(cameraPose.HolographicCamera().Id());
+            if (pCameraResources != nullptr && updateViewProjection(*pCameraResources, cameraPose, element))
+            {
+                memcpy(
+                    static_cast<uint8_t*>(mappedResource.pData) + element * elementSize,
+                    &pCameraResources->GetViewProjectionConstantBufferData(),
+                    sizeof(ViewProjectionConstantBuffer));
+                pCameraResources->SetViewProjectionArrayElement(element);
+            }
+            ++element;
+        }
+
+        context->Unmap(m_viewProjectionArrayBuffer.get(), 0);
+    });
+}
+
+void DXHelper::DeviceResources::ExecuteCommandList(ID3D11CommandList* commandList, bool restoreContextState)
+{
+    // By default the immediate context state is not restored afterwards. All state needed for rendering a camera is set up per
+    // camera.
+    UseImmediateD3DDeviceContext([commandList, restoreContextState](auto context) {
+        context->ExecuteCommandList(commandList, restoreContextState ? TRUE : FALSE);
+    });
+}
+
 // Prepares to allocate resources and adds resource views for a camera.
-// Locks the set of holographic camera resources until the function exits.
+// Publishes a new set of holographic camera resources, frames in flight keep using their set.
 void DXHelper::DeviceResources::AddHolographicCamera(HolographicCamera camera)
 {
-    UseHolographicCameraResources([this, camera](std::map<UINT32, std::unique_ptr<CameraResources>>& cameraResourceMap) {
-        cameraResourceMap[camera.Id()] = std::make_unique<CameraResources>(camera);
+    auto pCameraResources = std::make_shared<CameraResources>(camera);
+
+    std::lock_guard<std::mutex> guard(m_cameraResourcesLock);
+    PublishHolographicCameraResources([this, &pCameraResources, cameraId = camera.Id()](std::vector<CameraResourceSet::Entry>& entries) {
+        for (CameraResourceSet::Entry& entry : entries)
+        {
+            if (entry.cameraId == cameraId)
+            {
+                m_removedCameraResources.push_back(std::exchange(entry.resources, std::move(pCameraResources)));
+                return;
+            }
+        }
+        entries.push_back({cameraId, std::move(pCameraResources)});
     });
 }
 
-// Deallocates resources for a camera and removes the camera from the set.
-// Locks the set of holographic camera resources until the function exits.
+// Removes the camera from the set. The back buffer of a camera has to be released before the CameraRemoved handler returns, so
+// its resources are deallocated right away unless a frame in flight still refers to them. Only then they are deallocated by the
+// next frame, once no set refers to them anymore.
 void DXHelper::DeviceResources::RemoveHolographicCamera(HolographicCamera camera)
 {
-    UseHolographicCameraResources([this, camera](std::map<UINT32, std::unique_ptr<CameraResources>>& cameraResourceMap) {
-        CameraResources* pCameraResources = cameraResourceMap[camera.Id()].get();
+    std::lock_guard<std::mutex> guard(m_cameraResourcesLock);
+    PublishHolographicCameraResources([this, cameraId = camera.Id()](std::vector<CameraResourceSet::Entry>& entries) {
+        for (auto it = entries.begin(); it != entries.end(); ++it)
+        {
+            if (it->cameraId == cameraId)
+            {
+                m_removedCameraResources.push_back(std::move(it->resources));
+                entries.erase(it);
+                return;
+            }
+        }
+    });
+    ReleaseRemovedHolographicCamerasLocked();
+}
 
-        if (pCameraResources != nullptr)
+void DXHelper::DeviceResources::RemoveAllHolographicCameras()
+{
+    std::lock_guard<std::mutex> guard(m_cameraResourcesLock);
+    PublishHolographicCameraResources([this](std::vector<CameraResourceSet::Entry>& entries) {
+        for (CameraResourceSet::Entry& entry : entries)
         {
-            pCameraResources->ReleaseResourcesForBackBuffer(this);
-            cameraResourceMap.erase(camera.Id());
+            m_removedCameraResources.push_back(std::move(entry.resources));
         }
+        entries.clear();
     });
+    ReleaseRemovedHolographicCamerasLocked();
+}
+
+void DXHelper::DeviceResources::ReleaseRemovedHolographicCameras()
+{
+    std::lock_guard<std::mutex> guard(m_cameraResourcesLock);
+    ReleaseRemovedHolographicCamerasLocked();
+}
+
+void DXHelper::DeviceResources::ReleaseRemovedHolographicCamerasLocked()
+{
+    for (auto it = m_removedCameraResources.begin(); it != m_removedCameraResources.end();)
+    {
+        // The camera resource sets hold the only other references.
+        if (it->use_count() == 1)
+        {
+            (*it)->ReleaseResourcesForBackBuffer(this);
+            it = m_removedCameraResources.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
 }
 
 // Recreate all device resources and set them back to the current state.
-// Locks the set of holographic camera resources until the function exits.
 void DXHelper::DeviceResources::HandleDeviceLost()
 {
     if (m_deviceNotify != nullptr)
@@ -251,13 +442,33 @@ void DXHelper::DeviceResources::HandleDeviceLost()
         m_deviceNotify->OnDeviceLost();
     }
 
-    UseHolographicCameraResources([this](std::map<UINT32, std::unique_ptr<CameraResources>>& cameraResourceMap) {
-        for (auto& pair : cameraResourceMap)
+    UseHolographicCameraResources([this](const CameraResourceSet& cameraResources) {
+        for (const CameraResourceSet::Entry& entry : cameraResources.GetEntries())
+        {
+            entry.resources->ReleaseResourcesForBackBuffer(this);
+        }
+    });
+
+    {
+        // No frame is in flight while the device is recreated.
+        std::lock_guard<std::mutex> guard(m_cameraResourcesLock);
+        for (const std::shared_ptr<CameraResources>& pCameraResources : m_removedCameraResources)
         {
-            CameraResources* pCameraResources = pair.second.get();
             pCameraResources->ReleaseResourcesForBackBuffer(this);
         }
+        m_removedCameraResources.clear();
+    }
+
+    UseD3DDeviceContext([this](auto context) {
+        m_vertexRingBuffer.ReleaseDeviceDependentResources();
+        m_gpuTimer.ReleaseDeviceDependentResources();
+        m_occlusionCuller.ReleaseDeviceDependentResources();
+        m_viewProjectionArrayBuffer = nullptr;
+        m_viewProjectionArrayCapacity = 0;
     });
+    m_shaderCache.ReleaseDeviceDependentResources();
+    m_depthTargetPool.ReleaseDeviceDependentResources();
+    m_videoMemoryBudget.ReleaseDeviceDependentResources();
 
     InitializeUsingHolographicSpace();
 
@@ -273,19 +484,32 @@ void DXHelper::DeviceResources::RegisterDeviceNotify(DXHelper::IDeviceNotify* de
     m_deviceNotify = deviceNotify;
 }
 
-// Call this method when the app suspends. It provides a hint to the driver that the app
+// Call this method when the app suspends or stops streaming. It provides a hint to the driver that the app
 // is entering an idle state and that temporary buffers can be reclaimed for use by other apps.
 void DXHelper::DeviceResources::Trim()
 {
-    m_d3dContext->ClearState();
+    UseImmediateD3DDeviceContext([](ID3D11DeviceContext3* context) { context->ClearState(); });
 
     winrt::com_ptr<IDXGIDevice3> dxgiDevice;
     m_d3dDevice.as(dxgiDevice);
     dxgiDevice->Trim();
 }
 
+void DXHelper::DeviceResources::CreateBuffer(
+    MemoryAccounting::Tag tag, const D3D11_BUFFER_DESC& desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Buffer** buffer) const
+{
+    winrt::check_hresult(m_d3dDevice->CreateBuffer(&desc, initialData, buffer));
+    MemoryAccounting::TrackGpuResource(tag, *buffer);
+}
+
+void DXHelper::DeviceResources::CreateTexture2D(
+    MemoryAccounting::Tag tag, const D3D11_TEXTURE2D_DESC& desc, const D3D11_SUBRESOURCE_DATA* initialData, ID3D11Texture2D** texture) const
+{
+    winrt::check_hresult(m_d3dDevice->CreateTexture2D(&desc, initialData, texture));
+    MemoryAccounting::TrackGpuResource(tag, *texture);
+}
+
 // Present the contents of the swap chain to the screen.
-// Locks the set of holographic camera resources until the function exits.
 void DXHelper::DeviceResources::Present(HolographicFrame frame)
 {
     // By default, this API waits for the frame to finish before it returns.
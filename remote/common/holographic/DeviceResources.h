@@ -11,12 +11,24 @@
 
 #pragma once
 
+#include <MemoryAccounting.h>
+
+#include <d3d11/DepthTargetPool.h>
+#include <d3d11/GpuTimer.h>
+#include <d3d11/HiZOcclusionCuller.h>
+#include <d3d11/ShaderCache.h>
+#include <d3d11/VertexRingBuffer.h>
+#include <d3d11/VideoMemoryBudget.h>
 #include <holographic/CameraResources.h>
 
 #include <d2d1_2.h>
 #include <d3d11_4.h>
 #include <dwrite_2.h>
+#include <memory>
 #include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
 #include <wincodec.h>
 #include <wrl/client.h>
 
@@ -29,6 +41,42 @@ namespace DXHelper
         virtual void OnDeviceRestored() = 0;
     };
 
+    // An immutable set of the resources of the attached holographic cameras. Camera events publish a new set, while a frame
+    // keeps using the set it started with. The resources of a camera that was removed stay alive until no set refers to them.
+    // There are at most a few cameras, so the set is a flat array which is searched linearly.
+    class CameraResourceSet
+    {
+    public:
+        struct Entry
+        {
+            UINT32 cameraId;
+            std::shared_ptr<CameraResources> resources;
+        };
+
+        // Returns nullptr if the camera is not part of the set.
+        CameraResources* Find(UINT32 cameraId) const
+        {
+            for (const Entry& entry : m_entries)
+            {
+                if (entry.cameraId == cameraId)
+                {
+                    return entry.resources.get();
+                }
+            }
+            return nullptr;
+        }
+
+        const std::vector<Entry>& GetEntries() const
+        {
+            return m_entries;
+        }
+
+    private:
+        friend class DeviceResources;
+
+        std::vector<Entry> m_entries;
+    };
+
     // Creates and manages a Direct3D device and immediate context, Direct2D device and context (for debug), and the holographic swap chain.
     class DeviceResources
     {
@@ -43,11 +91,28 @@ namespace DXHelper
         void Present(winrt::Windows::Graphics::Holographic::HolographicFrame frame);
 
         // Public methods related to holographic devices.
-        void SetHolographicSpace(winrt::Windows::Graphics::Holographic::HolographicSpace space);
+        // Pins the Direct3D device to the adapter with this DXGI enumeration index, if the holographic space does not ask for an
+        // adapter. A negative index selects the adapter automatically, see SelectAdapter. Applies to devices created afterwards.
+        void SetAdapterIndex(int32_t adapterIndex)
+        {
+            m_adapterIndex = adapterIndex;
+        }
+
+        // Returns true if a new Direct3D device was created for the space, false if the current device is kept.
+        bool SetHolographicSpace(winrt::Windows::Graphics::Holographic::HolographicSpace space);
         void EnsureCameraResources(
             winrt::Windows::Graphics::Holographic::HolographicFrame frame,
             winrt::Windows::Graphics::Holographic::HolographicFramePrediction prediction);
 
+        // Computes the view-projection matrices of all cameras in the prediction and uploads them in a single update. Must be
+        // called from within UseHolographicCameraResources, the camera resources are passed in by the caller. The n-th replaced
+        // element, if any, takes the place of the matrices of the n-th camera pose, see CameraResources::ReplaceViewProjection.
+        void UpdateViewProjectionBuffers(
+            const CameraResourceSet& cameraResources,
+            const winrt::Windows::Graphics::Holographic::HolographicFramePrediction& prediction,
+            const winrt::Windows::Perception::Spatial::SpatialCoordinateSystem& coordinateSystem,
+            winrt::array_view<const std::optional<ViewProjectionConstantBuffer>> replacedViewProjections = {});
+
         void AddHolographicCamera(winrt::Windows::Graphics::Holographic::HolographicCamera camera);
         void RemoveHolographicCamera(winrt::Windows::Graphics::Holographic::HolographicCamera camera);
 
@@ -55,6 +120,12 @@ namespace DXHelper
         template <typename LCallback>
         void UseHolographicCameraResources(LCallback const& callback);
 
+        // Returns the current set of camera resources. Never blocks, camera events can be processed while the set is in use.
+        std::shared_ptr<const CameraResourceSet> GetHolographicCameraResources() const
+        {
+            return std::atomic_load(&m_cameraResources);
+        }
+
         winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice GetD3DInteropDevice() const
         {
             return m_d3dInteropDevice;
@@ -65,12 +136,62 @@ namespace DXHelper
         {
             return m_d3dDevice.get();
         }
+
+        // Create a buffer or a texture which is counted under the tag until it is destroyed, see MemoryAccounting. Resources created
+        // on a device taken from GetD3DDevice are counted with MemoryAccounting::TrackGpuResource instead.
+        void CreateBuffer(
+            MemoryAccounting::Tag tag,
+            const D3D11_BUFFER_DESC& desc,
+            const D3D11_SUBRESOURCE_DATA* initialData,
+            ID3D11Buffer** buffer) const;
+        void CreateTexture2D(
+            MemoryAccounting::Tag tag,
+            const D3D11_TEXTURE2D_DESC& desc,
+            const D3D11_SUBRESOURCE_DATA* initialData,
+            ID3D11Texture2D** texture) const;
         template <typename F>
         auto UseD3DDeviceContext(F func) const
         {
+            // Threads which are recording a deferred context, see RecordD3DDeviceContext, do not touch the immediate context.
+            if (s_recordingContext != nullptr)
+            {
+                return func(s_recordingContext);
+            }
+
             std::scoped_lock lock(m_d3dContextMutex);
             return func(m_d3dContext.get());
         }
+
+        // Always uses the immediate context, also on threads which are recording a deferred context. Use it for resources
+        // which have to be updated on the immediate context, like the vertex ring buffer.
+        template <typename F>
+        auto UseImmediateD3DDeviceContext(F func) const
+        {
+            std::scoped_lock lock(m_d3dContextMutex);
+            return func(m_d3dContext.get());
+        }
+
+        // Redirects UseD3DDeviceContext on the calling thread to the given deferred context while func runs.
+        template <typename F>
+        void RecordD3DDeviceContext(ID3D11DeviceContext3* deferredContext, const F& func) const
+        {
+            s_recordingContext = deferredContext;
+            try
+            {
+                func();
+            }
+            catch (...)
+            {
+                s_recordingContext = nullptr;
+                throw;
+            }
+            s_recordingContext = nullptr;
+        }
+
+        // Executes a command list recorded on a deferred context on the immediate context. Command lists executed from other
+        // threads than the render thread have to restore the immediate context state, the render thread may be between binding
+        // its state and drawing.
+        void ExecuteCommandList(ID3D11CommandList* commandList, bool restoreContextState = false);
         D3D_FEATURE_LEVEL GetDeviceFeatureLevel() const
         {
             return m_d3dFeatureLevel;
@@ -80,6 +201,68 @@ namespace DXHelper
             return m_supportsVprt;
         }
 
+        // Returns the compiled vertex shader file of a shader set. Devices which can set the render target array index from the
+        // vertex shader use the "<name>Vprt.cso" variant, which must not be combined with a pass-through geometry shader. All other
+        // devices use "<name>.cso", followed by the pass-through geometry shader of the set.
+        std::wstring GetVertexShaderFileName(std::wstring_view name) const
+        {
+            return std::wstring(name) + (m_supportsVprt ? L"Vprt.cso" : L".cso");
+        }
+
+        // Shared dynamic vertex buffer for per-frame geometry. Only use it from within UseImmediateD3DDeviceContext.
+        VertexRingBuffer& GetVertexRingBuffer()
+        {
+            return m_vertexRingBuffer;
+        }
+
+        // Measures the GPU time of frames and sections of them. Only use it from within UseImmediateD3DDeviceContext.
+        GpuTimer& GetGpuTimer()
+        {
+            return m_gpuTimer;
+        }
+
+        // Measures the GPU time of the commands func submits as a section of the current frame. The immediate context is not
+        // locked while func runs.
+        template <typename F>
+        void TimeGpuSection(size_t section, const F& func)
+        {
+            UseImmediateD3DDeviceContext([&](ID3D11DeviceContext3* context) { m_gpuTimer.BeginSection(context, section); });
+            func();
+            UseImmediateD3DDeviceContext([&](ID3D11DeviceContext3* context) { m_gpuTimer.EndSection(context, section); });
+        }
+
+        // Shared cache of shader bytecode and shader objects, may be used from any thread.
+        ShaderCache& GetShaderCache()
+        {
+            return m_shaderCache;
+        }
+
+        // Depth targets released by the cameras, shared by all of them. May be used from any thread.
+        DepthTargetPool& GetDepthTargetPool()
+        {
+            return m_depthTargetPool;
+        }
+
+        // Hi-Z occlusion culling against the depth of the previous frame. Only use it from the render thread.
+        HiZOcclusionCuller& GetOcclusionCuller()
+        {
+            return m_occlusionCuller;
+        }
+
+        // Video memory usage against the budget of the process. Updated on the render thread, may be read from any thread.
+        VideoMemoryBudget& GetVideoMemoryBudget()
+        {
+            return m_videoMemoryBudget;
+        }
+
+        // Array of view-projection constant buffers, one element per camera. Each element is ViewProjectionArrayElementConstants
+        // shader constants large, as required for binding with VSSetConstantBuffers1.
+        ID3D11Buffer* GetViewProjectionArrayBuffer() const
+        {
+            return m_viewProjectionArrayBuffer.get();
+        }
+        static constexpr UINT ViewProjectionArrayElementConstants = 16;
+
         // DXGI acessors.
         IDXGIAdapter3* GetDXGIAdapter() const
         {
@@ -108,13 +291,49 @@ namespace DXHelper
         void CreateDeviceIndependentResources();
         void InitializeUsingHolographicSpace();
 
+        // Returns whether the current device can be used with m_holographicSpace.
+        bool CanReuseDevice() const;
+
+        // Removes the cameras of a previous holographic space. Their resources are deallocated like those of a removed camera.
+        void RemoveAllHolographicCameras();
+
+        // Publishes a copy of the current camera resource set, modified by func. Must be called with m_cameraResourcesLock held.
+        template <typename F>
+        void PublishHolographicCameraResources(F func);
+
+        // Releases the back buffer resources of removed cameras once no camera resource set refers to them anymore.
+        void ReleaseRemovedHolographicCameras();
+        // Same as ReleaseRemovedHolographicCameras, must be called with m_cameraResourcesLock held.
+        void ReleaseRemovedHolographicCamerasLocked();
+
     protected:
         // Direct3D objects.
         winrt::com_ptr<ID3D11Device4> m_d3dDevice;
         mutable std::recursive_mutex m_d3dContextMutex;
         winrt::com_ptr<ID3D11DeviceContext3> m_d3dContext;
+
+        // Deferred context the calling thread is currently recording into, if any.
+        static inline thread_local ID3D11DeviceContext3* s_recordingContext = nullptr;
         winrt::com_ptr<IDXGIAdapter3> m_dxgiAdapter;
 
+        // Shared dynamic vertex buffer which transient geometry is sub-allocated from.
+        VertexRingBuffer m_vertexRingBuffer;
+
+        // Shader bytecode is kept across device loss, the shader objects are recreated for the new device.
+        ShaderCache m_shaderCache;
+
+        GpuTimer m_gpuTimer;
+
+        DepthTargetPool m_depthTargetPool;
+
+        HiZOcclusionCuller m_occlusionCuller;
+
+        VideoMemoryBudget m_videoMemoryBudget;
+
+        // Dynamic constant buffer holding the view-projection matrices of all cameras.
+        winrt::com_ptr<ID3D11Buffer> m_viewProjectionArrayBuffer;
+        UINT m_viewProjectionArrayCapacity = 0;
+
         // Direct3D interop objects.
         winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DDevice m_d3dInteropDevice;
 
@@ -130,28 +349,45 @@ namespace DXHelper
         // for setting the render target array index from the vertex shader stage.
         bool m_supportsVprt = false;
 
+        // Whether or not the current Direct3D device supports binding a range of a constant buffer.
+        bool m_supportsConstantBufferOffsetting = false;
+
     private:
         // The holographic space provides a preferred DXGI adapter ID.
         winrt::Windows::Graphics::Holographic::HolographicSpace m_holographicSpace = nullptr;
 
+        // Adapter the device is pinned to if the holographic space has no preference, negative to select it automatically.
+        int32_t m_adapterIndex = -1;
+
         // Properties of the Direct3D device currently in use.
         D3D_FEATURE_LEVEL m_d3dFeatureLevel = D3D_FEATURE_LEVEL_10_0;
 
-        // Back buffer resources, etc. for attached holographic cameras.
-        std::map<UINT32, std::unique_ptr<CameraResources>> m_cameraResources;
+        // Back buffer resources, etc. for attached holographic cameras. Only accessed with std::atomic_load and std::atomic_store.
+        std::shared_ptr<const CameraResourceSet> m_cameraResources = std::make_shared<CameraResourceSet>();
+
+        // The resources of removed cameras, which might still be in use by a frame.
+        std::vector<std::shared_ptr<CameraResources>> m_removedCameraResources;
+
+        // Serializes the camera events, which modify the camera resource set and m_removedCameraResources. Frames do not take it.
         std::mutex m_cameraResourcesLock;
     };
 } // namespace DXHelper
 
-// Device-based resources for holographic cameras are stored in a std::map. Access this list by providing a
-// callback to this function, and the std::map will be guarded from add and remove
-// events until the callback returns. The callback is processed immediately and must
-// not contain any nested calls to UseHolographicCameraResources.
-// The callback takes a parameter of type std::map<UINT32, std::unique_ptr<DXHelper::CameraResources>>&
-// through which the list of cameras will be accessed.
+// Device-based resources for holographic cameras are stored in an immutable CameraResourceSet. The callback is processed
+// immediately with the current set, which stays valid until the callback returns. Camera events are not blocked meanwhile,
+// cameras added or removed during the callback show up in the set of the next call.
+// The callback takes a parameter of type const DXHelper::CameraResourceSet& through which the cameras will be accessed.
 template <typename LCallback>
 void DXHelper::DeviceResources::UseHolographicCameraResources(LCallback const& callback)
 {
-    std::lock_guard<std::mutex> guard(m_cameraResourcesLock);
-    callback(m_cameraResources);
+    const std::shared_ptr<const CameraResourceSet> cameraResources = GetHolographicCameraResources();
+    callback(*cameraResources);
+}
+
+template <typename F>
+void DXHelper::DeviceResources::PublishHolographicCameraResources(F func)
+{
+    auto cameraResources = std::make_shared<CameraResourceSet>(*std::atomic_load(&m_cameraResources));
+    func(cameraResources->m_entries);
+    std::atomic_store(&m_cameraResources, std::shared_ptr<const CameraResourceSet>(std::move(cameraResources)));
 }
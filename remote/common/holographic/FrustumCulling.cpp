@@ -11,6 +11,9 @@
 
 #include <holographic/FrustumCulling.h>
 
+#include <algorithm>
+#include <cmath>
+
 using namespace FrustumCulling;
 
 bool FrustumCulling::PointInFrustum(
@@ -85,3 +88,183 @@ bool FrustumCulling::SphereInFrustum(
     }
     return true;
 }
+
+namespace
+{
+    static_assert(sizeof(CullingSphere) == 4 * sizeof(float), "CullingSphere is loaded as a single vector.");
+
+    // Converts the per lane culled results of four bounding volumes to a bitmask.
+    uint32_t XM_CALLCONV CulledLanesToMask(DirectX::FXMVECTOR culled)
+    {
+        uint32_t lanes[4];
+        DirectX::XMStoreInt4(lanes, culled);
+        return (lanes[0] & 1) | ((lanes[1] & 1) << 1) | ((lanes[2] & 1) << 2) | ((lanes[3] & 1) << 3);
+    }
+
+    // Calls cullGroup for groups of four consecutive bounding volumes and stores the visibility of each volume.
+    // The last group is padded by repeating its last volume, the bits of the padding are dropped.
+    template <typename Volume, typename CullGroup>
+    void CullGroupsOfFour(const Volume* volumes, size_t count, VisibilityMask& visibility, CullGroup&& cullGroup)
+    {
+        visibility.assign((count + 31) / 32, 0);
+
+        for (size_t first = 0; first < count; first += 4)
+        {
+            const size_t groupSize = std::min<size_t>(4, count - first);
+
+            Volume group[4];
+            for (size_t i = 0; i < 4; ++i)
+            {
+                group[i] = volumes[first + std::min(i, groupSize - 1)];
+            }
+
+            const uint32_t visibleLanes = ~cullGroup(group) & ((1u << groupSize) - 1);
+
+            // Groups start at multiples of four, so a group never straddles two mask elements.
+            visibility[first / 32] |= visibleLanes << (first % 32);
+        }
+    }
+} // namespace
+
+FrustumCulling::FrustumPlanes::FrustumPlanes(const winrt::Windows::Foundation::IReference<SpatialBoundingFrustum>& cullingFrustum)
+{
+    if (cullingFrustum)
+    {
+        *this = FrustumPlanes(cullingFrustum.Value());
+    }
+}
+
+FrustumCulling::FrustumPlanes::FrustumPlanes(const SpatialBoundingFrustum& frustum)
+{
+    const winrt::Windows::Foundation::Numerics::plane planes[PlaneCount] = {
+        frustum.Near, frustum.Far, frustum.Left, frustum.Right, frustum.Top, frustum.Bottom};
+
+    for (size_t i = 0; i < PlaneCount; ++i)
+    {
+        m_planes[i].normalX = DirectX::XMVectorReplicate(planes[i].normal.x);
+        m_planes[i].normalY = DirectX::XMVectorReplicate(planes[i].normal.y);
+        m_planes[i].normalZ = DirectX::XMVectorReplicate(planes[i].normal.z);
+        m_planes[i].distance = DirectX::XMVectorReplicate(planes[i].d);
+    }
+
+    m_hasFrustum = true;
+}
+
+void FrustumCulling::FrustumPlanes::CullSpheres(const CullingSphere* spheres, size_t count, VisibilityMask& visibility) const
+{
+    if (!m_hasFrustum)
+    {
+        visibility.assign((count + 31) / 32, ~0u);
+        return;
+    }
+
+    CullGroupsOfFour(spheres, count, visibility, [this](const CullingSphere* group) {
+        // Transpose the four (x, y, z, radius) spheres into one vector per component.
+        const DirectX::XMMATRIX components = DirectX::XMMatrixTranspose(DirectX::XMMATRIX(
+            DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&group[0])),
+            DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&group[1])),
+            DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&group[2])),
+            DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&group[3]))));
+
+        return CullSpheres4(components.r[0], components.r[1], components.r[2], components.r[3]);
+    });
+}
+
+void FrustumCulling::FrustumPlanes::CullBoxes(const CullingBox* boxes, size_t count, VisibilityMask& visibility) const
+{
+    if (!m_hasFrustum)
+    {
+        visibility.assign((count + 31) / 32, ~0u);
+        return;
+    }
+
+    CullGroupsOfFour(boxes, count, visibility, [this](const CullingBox* group) {
+        DirectX::XMMATRIX centers;
+        DirectX::XMMATRIX extents;
+        for (size_t i = 0; i < 4; ++i)
+        {
+            centers.r[i] = DirectX::XMLoadFloat3(reinterpret_cast<const DirectX::XMFLOAT3*>(&group[i].center));
+            extents.r[i] = DirectX::XMLoadFloat3(reinterpret_cast<const DirectX::XMFLOAT3*>(&group[i].extents));
+        }
+        centers = DirectX::XMMatrixTranspose(centers);
+        extents = DirectX::XMMatrixTranspose(extents);
+
+        return CullBoxes4(centers.r[0], centers.r[1], centers.r[2], extents.r[0], extents.r[1], extents.r[2]);
+    });
+}
+
+FrustumCulling::Containment FrustumCulling::FrustumPlanes::ClassifyBox(const CullingBox& box) const
+{
+    if (!m_hasFrustum)
+    {
+        return Containment::Inside;
+    }
+
+    Containment containment = Containment::Inside;
+    for (const Plane& plane : m_planes)
+    {
+        // The plane components are replicated, so the first lane holds the plane.
+        const float normalX = DirectX::XMVectorGetX(plane.normalX);
+        const float normalY = DirectX::XMVectorGetX(plane.normalY);
+        const float normalZ = DirectX::XMVectorGetX(plane.normalZ);
+
+        const float distance =
+            normalX * box.center.x + normalY * box.center.y + normalZ * box.center.z + DirectX::XMVectorGetX(plane.distance);
+        const float projectedExtent =
+            std::abs(normalX) * box.extents.x + std::abs(normalY) * box.extents.y + std::abs(normalZ) * box.extents.z;
+
+        if (distance > projectedExtent)
+        {
+            return Containment::Outside;
+        }
+        if (distance > -projectedExtent)
+        {
+            containment = Containment::Intersecting;
+        }
+    }
+    return containment;
+}
+
+uint32_t XM_CALLCONV FrustumCulling::FrustumPlanes::CullSpheres4(
+    DirectX::FXMVECTOR x, DirectX::FXMVECTOR y, DirectX::FXMVECTOR z, DirectX::GXMVECTOR radius) const
+{
+    using namespace DirectX;
+
+    XMVECTOR culled = XMVectorFalseInt();
+    for (const Plane& plane : m_planes)
+    {
+        // A sphere is culled if its center is further than its radius in front of any plane.
+        XMVECTOR distance = XMVectorMultiplyAdd(plane.normalX, x, plane.distance);
+        distance = XMVectorMultiplyAdd(plane.normalY, y, distance);
+        distance = XMVectorMultiplyAdd(plane.normalZ, z, distance);
+        culled = XMVectorOrInt(culled, XMVectorGreater(XMVectorSubtract(distance, radius), XMVectorZero()));
+    }
+    return CulledLanesToMask(culled);
+}
+
+uint32_t XM_CALLCONV FrustumCulling::FrustumPlanes::CullBoxes4(
+    DirectX::FXMVECTOR x,
+    DirectX::FXMVECTOR y,
+    DirectX::FXMVECTOR z,
+    DirectX::GXMVECTOR extentX,
+    DirectX::HXMVECTOR extentY,
+    DirectX::HXMVECTOR extentZ) const
+{
+    using namespace DirectX;
+
+    XMVECTOR culled = XMVectorFalseInt();
+    for (const Plane& plane : m_planes)
+    {
+        // A box is culled if its center is further in front of any plane than the box extends along the plane normal.
+        XMVECTOR distance = XMVectorMultiplyAdd(plane.normalX, x, plane.distance);
+        distance = XMVectorMultiplyAdd(plane.normalY, y, distance);
+        distance = XMVectorMultiplyAdd(plane.normalZ, z, distance);
+
+        XMVECTOR projectedExtent = XMVectorMultiply(XMVectorAbs(plane.normalX), extentX);
+        projectedExtent = XMVectorMultiplyAdd(XMVectorAbs(plane.normalY), extentY, projectedExtent);
+        projectedExtent = XMVectorMultiplyAdd(XMVectorAbs(plane.normalZ), extentZ, projectedExtent);
+
+        culled = XMVectorOrInt(culled, XMVectorGreater(XMVectorSubtract(distance, projectedExtent), XMVectorZero()));
+    }
+    return CulledLanesToMask(culled);
+}
@@ -11,6 +11,11 @@
 
 #pragma once
 
+#include <DirectXMath.h>
+
+#include <cstdint>
+#include <vector>
+
 #include <winrt/Windows.Foundation.Metadata.h>
 #include <winrt/Windows.Perception.Spatial.h>
 
@@ -23,8 +28,89 @@ namespace FrustumCulling
         const winrt::Windows::Foundation::IReference<SpatialBoundingFrustum>& cullingFrustum);
 
     // Returns true if the sphere(given by its center and radius) is inside the frustum, or if no cullingFrustum is available.
+    // Use FrustumPlanes below to test many spheres against the same frustum.
     bool SphereInFrustum(
         const winrt::Windows::Foundation::Numerics::float3& sphereCenter,
         float sphereRadius,
         const winrt::Windows::Foundation::IReference<SpatialBoundingFrustum>& cullingFrustum);
+
+    struct CullingSphere
+    {
+        winrt::Windows::Foundation::Numerics::float3 center;
+        float radius;
+    };
+
+    struct CullingBox
+    {
+        winrt::Windows::Foundation::Numerics::float3 center;
+        winrt::Windows::Foundation::Numerics::float3 extents;
+    };
+
+    enum class Containment
+    {
+        Outside,
+        Intersecting,
+        Inside,
+    };
+
+    // One bit per bounding volume, bit (i % 32) of element (i / 32) is set if volume i is visible.
+    using VisibilityMask = std::vector<uint32_t>;
+
+    inline bool IsVisible(const VisibilityMask& visibility, size_t index)
+    {
+        return (visibility[index / 32] >> (index % 32)) & 1;
+    }
+
+    // The planes of a culling frustum, extracted once per camera so that arrays of bounding volumes can be
+    // tested against it four at a time. Without a culling frustum every bounding volume is visible.
+    class FrustumPlanes
+    {
+    public:
+        explicit FrustumPlanes(const winrt::Windows::Foundation::IReference<SpatialBoundingFrustum>& cullingFrustum);
+
+        // For frustums which are not provided by a camera, like the views of an OpenXR frame. The plane normals point outwards.
+        explicit FrustumPlanes(const SpatialBoundingFrustum& frustum);
+
+        void CullSpheres(const CullingSphere* spheres, size_t count, VisibilityMask& visibility) const;
+        void CullSpheres(const std::vector<CullingSphere>& spheres, VisibilityMask& visibility) const
+        {
+            CullSpheres(spheres.data(), spheres.size(), visibility);
+        }
+
+        void CullBoxes(const CullingBox* boxes, size_t count, VisibilityMask& visibility) const;
+        void CullBoxes(const std::vector<CullingBox>& boxes, VisibilityMask& visibility) const
+        {
+            CullBoxes(boxes.data(), boxes.size(), visibility);
+        }
+
+        // Tells whether the box is completely outside of the frustum, completely inside of it or intersects its boundary, so that
+        // hierarchies of bounding volumes can skip or accept whole subtrees. Without a culling frustum every box is inside.
+        Containment ClassifyBox(const CullingBox& box) const;
+
+    private:
+        static constexpr size_t PlaneCount = 6;
+
+        // Returns a bit per lane, set if the lane is outside of any plane.
+        uint32_t XM_CALLCONV
+            CullSpheres4(DirectX::FXMVECTOR x, DirectX::FXMVECTOR y, DirectX::FXMVECTOR z, DirectX::GXMVECTOR radius) const;
+        uint32_t XM_CALLCONV CullBoxes4(
+            DirectX::FXMVECTOR x,
+            DirectX::FXMVECTOR y,
+            DirectX::FXMVECTOR z,
+            DirectX::GXMVECTOR extentX,
+            DirectX::HXMVECTOR extentY,
+            DirectX::HXMVECTOR extentZ) const;
+
+        bool m_hasFrustum = false;
+
+        // Each plane component is replicated into all four lanes.
+        struct Plane
+        {
+            DirectX::XMVECTOR normalX;
+            DirectX::XMVECTOR normalY;
+            DirectX::XMVECTOR normalZ;
+            DirectX::XMVECTOR distance;
+        };
+        Plane m_planes[PlaneCount];
+    };
 }; // namespace FrustumCulling
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <chrono>
 #include <memory>
 #include <string>
 
@@ -21,6 +22,13 @@ public:
     // Ticks the application while the window is visible.
     virtual void Tick() = 0;
 
+    // Returns how long the window may wait for window messages before the next Tick. Zero while frames are rendered, which are
+    // paced by waiting for the next frame within Tick.
+    virtual std::chrono::milliseconds GetIdleTimeout() = 0;
+
+    // Returns an event the application signals to end the wait for the idle timeout early, e.g. when a connection is established.
+    virtual HANDLE GetWakeEvent() = 0;
+
     // Notifies the application about key presses.
     virtual void OnKeyPress(char key) = 0;
 
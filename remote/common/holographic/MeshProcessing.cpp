@@ -0,0 +1,520 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#include <pch.h>
+
+#include <holographic/MeshProcessing.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <iterator>
+#include <queue>
+#include <unordered_map>
+
+using namespace winrt::Windows::Foundation::Numerics;
+using namespace MeshProcessing;
+
+namespace
+{
+    constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+    // Collapses which tilt a remaining triangle such that the cosine between its old and new normal falls below this are rejected.
+    constexpr float MinNormalCosine = 0.2f;
+
+    // Size of the modeled vertex cache and the constants of the vertex scores of Forsyth's algorithm.
+    constexpr uint32_t VertexCacheSize = 32;
+    constexpr float CacheDecayPower = 1.5f;
+    constexpr float LastTriangleScore = 0.75f;
+    constexpr float ValenceBoostScale = 2.0f;
+    constexpr float ValenceBoostPower = 0.5f;
+
+    // Symmetric 4x4 matrix of the quadric error metric, stored as its upper triangle row by row.
+    struct Quadric
+    {
+        double m[10] = {};
+
+        void AddPlane(const float3& normal, float distance, double weight)
+        {
+            const double a = normal.x;
+            const double b = normal.y;
+            const double c = normal.z;
+            const double d = distance;
+            m[0] += weight * a * a;
+            m[1] += weight * a * b;
+            m[2] += weight * a * c;
+            m[3] += weight * a * d;
+            m[4] += weight * b * b;
+            m[5] += weight * b * c;
+            m[6] += weight * b * d;
+            m[7] += weight * c * c;
+            m[8] += weight * c * d;
+            m[9] += weight * d * d;
+        }
+
+        void Add(const Quadric& other)
+        {
+            for (int i = 0; i < 10; ++i)
+            {
+                m[i] += other.m[i];
+            }
+        }
+
+        // Weighted sum of the squared distances of the point to the planes of the quadric.
+        double Evaluate(const float3& point) const
+        {
+            const double x = point.x;
+            const double y = point.y;
+            const double z = point.z;
+            return m[0] * x * x + 2.0 * m[1] * x * y + 2.0 * m[2] * x * z + 2.0 * m[3] * x + m[4] * y * y + 2.0 * m[5] * y * z +
+                   2.0 * m[6] * y + m[7] * z * z + 2.0 * m[8] * z + m[9];
+        }
+    };
+
+    // Moves the vertex of one end of an edge onto the other one.
+    struct Collapse
+    {
+        double cost;
+        uint32_t from;
+        uint32_t to;
+        uint32_t fromVersion;
+        uint32_t toVersion;
+
+        bool operator>(const Collapse& other) const
+        {
+            return cost > other.cost;
+        }
+    };
+
+    // Orders the vertices by their first use in the index buffer and drops the unused ones.
+    void ReorderVerticesByFirstUse(std::vector<PackedVertex>& vertices, std::vector<uint16_t>& indices)
+    {
+        std::vector<uint32_t> remap(vertices.size(), InvalidIndex);
+        std::vector<PackedVertex> reordered;
+        reordered.reserve(vertices.size());
+        for (uint16_t& index : indices)
+        {
+            if (remap[index] == InvalidIndex)
+            {
+                remap[index] = static_cast<uint32_t>(reordered.size());
+                reordered.push_back(vertices[index]);
+            }
+            index = static_cast<uint16_t>(remap[index]);
+        }
+        vertices = std::move(reordered);
+    }
+
+    float GetVertexScore(int32_t cachePosition, uint32_t remainingTriangles)
+    {
+        if (remainingTriangles == 0)
+        {
+            return -1.0f;
+        }
+
+        float score = 0.0f;
+        if (cachePosition >= 0)
+        {
+            // The vertices of the last triangle get a fixed score, to not favor any of them over the others.
+            score = cachePosition < 3 ? LastTriangleScore
+                                      : std::pow(1.0f - (cachePosition - 3) / static_cast<float>(VertexCacheSize - 3), CacheDecayPower);
+        }
+
+        // Vertices with few remaining triangles are preferred, so they do not end up as the only remaining user of a vertex.
+        return score + ValenceBoostScale * std::pow(static_cast<float>(remainingTriangles), -ValenceBoostPower);
+    }
+} // namespace
+
+void MeshProcessing::WeldVertices(std::vector<PackedVertex>& vertices, std::vector<uint16_t>& indices)
+{
+    std::unordered_map<uint64_t, uint16_t> firstVertices;
+    firstVertices.reserve(vertices.size());
+
+    std::vector<uint16_t> remap(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i)
+    {
+        const int16_t* pos = vertices[i].pos;
+        const uint64_t key = (uint64_t{static_cast<uint16_t>(pos[0])} << 32) | (uint64_t{static_cast<uint16_t>(pos[1])} << 16) |
+                             uint64_t{static_cast<uint16_t>(pos[2])};
+        remap[i] = firstVertices.try_emplace(key, static_cast<uint16_t>(i)).first->second;
+    }
+
+    size_t indexCount = 0;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        const uint16_t a = remap[indices[i]];
+        const uint16_t b = remap[indices[i + 1]];
+        const uint16_t c = remap[indices[i + 2]];
+        if (a != b && b != c && c != a)
+        {
+            indices[indexCount++] = a;
+            indices[indexCount++] = b;
+            indices[indexCount++] = c;
+        }
+    }
+    indices.resize(indexCount);
+
+    ReorderVerticesByFirstUse(vertices, indices);
+}
+
+void MeshProcessing::Decimate(
+    std::vector<PackedVertex>& vertices, std::vector<uint16_t>& indices, uint32_t maxTriangleCount, const float3& positionScale)
+{
+    const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+    const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+    if (triangleCount <= maxTriangleCount)
+    {
+        return;
+    }
+
+    std::vector<float3> positions(vertexCount);
+    for (uint32_t i = 0; i < vertexCount; ++i)
+    {
+        const int16_t* pos = vertices[i].pos;
+        positions[i] = float3(pos[0], pos[1], pos[2]) * positionScale / static_cast<float>(INT16_MAX);
+    }
+
+    // The triangles around each vertex. A vertex takes over the triangles of the vertices collapsed onto it.
+    std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+    std::vector<Quadric> quadrics(vertexCount);
+    std::unordered_map<uint32_t, uint32_t> edgeTriangleCounts;
+    edgeTriangleCounts.reserve(indices.size());
+    for (uint32_t t = 0; t < triangleCount; ++t)
+    {
+        const uint16_t* corners = &indices[t * 3];
+        const float3 normal = cross(positions[corners[1]] - positions[corners[0]], positions[corners[2]] - positions[corners[0]]);
+        const float doubleArea = length(normal);
+        for (int k = 0; k < 3; ++k)
+        {
+            vertexTriangles[corners[k]].push_back(t);
+            if (doubleArea > 0.0f)
+            {
+                // Area weighted, so large flat triangles keep their shape over small ones.
+                const float3 unitNormal = normal / doubleArea;
+                quadrics[corners[k]].AddPlane(unitNormal, -dot(unitNormal, positions[corners[0]]), doubleArea * 0.5);
+            }
+
+            const uint32_t a = std::min<uint32_t>(corners[k], corners[(k + 1) % 3]);
+            const uint32_t b = std::max<uint32_t>(corners[k], corners[(k + 1) % 3]);
+            edgeTriangleCounts[(a << 16) | b]++;
+        }
+    }
+
+    // Vertices of border and non-manifold edges do not move.
+    std::vector<bool> locked(vertexCount, false);
+    for (const auto& [edge, count] : edgeTriangleCounts)
+    {
+        if (count != 2)
+        {
+            locked[edge >> 16] = true;
+            locked[edge & 0xFFFF] = true;
+        }
+    }
+
+    std::vector<bool> triangleRemoved(triangleCount, false);
+    std::vector<bool> vertexRemoved(vertexCount, false);
+    // Incremented whenever the quadric of a vertex changes. Queued collapses of older versions are outdated.
+    std::vector<uint32_t> versions(vertexCount, 0);
+
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<>> queue;
+    auto pushCollapse = [&](uint32_t from, uint32_t to) {
+        if (!locked[from])
+        {
+            Quadric quadric = quadrics[from];
+            quadric.Add(quadrics[to]);
+            queue.push({quadric.Evaluate(positions[to]), from, to, versions[from], versions[to]});
+        }
+    };
+    auto pushCollapsesOf = [&](uint32_t vertex) {
+        for (uint32_t t : vertexTriangles[vertex])
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                const uint32_t other = indices[t * 3 + k];
+                if (other != vertex)
+                {
+                    pushCollapse(vertex, other);
+                    pushCollapse(other, vertex);
+                }
+            }
+        }
+    };
+
+    for (uint32_t t = 0; t < triangleCount; ++t)
+    {
+        for (int k = 0; k < 3; ++k)
+        {
+            const uint32_t a = indices[t * 3 + k];
+            const uint32_t b = indices[t * 3 + (k + 1) % 3];
+            pushCollapse(a, b);
+            pushCollapse(b, a);
+        }
+    }
+
+    std::vector<uint32_t> fromNeighbors;
+    std::vector<uint32_t> toNeighbors;
+    auto collectNeighbors = [&](uint32_t vertex, std::vector<uint32_t>& neighbors) {
+        neighbors.clear();
+        for (uint32_t t : vertexTriangles[vertex])
+        {
+            for (int k = 0; k < 3; ++k)
+            {
+                if (indices[t * 3 + k] != vertex)
+                {
+                    neighbors.push_back(indices[t * 3 + k]);
+                }
+            }
+        }
+        std::sort(neighbors.begin(), neighbors.end());
+        neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+    };
+
+    auto canCollapse = [&](uint32_t from, uint32_t to) {
+        // The vertices adjacent to both ends have to be the ones opposite the edge, otherwise the surface would be pinched.
+        uint32_t sharedTriangleCount = 0;
+        for (uint32_t t : vertexTriangles[from])
+        {
+            const uint16_t* corners = &indices[t * 3];
+            sharedTriangleCount += (corners[0] == to || corners[1] == to || corners[2] == to) ? 1 : 0;
+        }
+
+        collectNeighbors(from, fromNeighbors);
+        collectNeighbors(to, toNeighbors);
+        std::vector<uint32_t> commonNeighbors;
+        std::set_intersection(
+            fromNeighbors.begin(), fromNeighbors.end(), toNeighbors.begin(), toNeighbors.end(), std::back_inserter(commonNeighbors));
+        if (sharedTriangleCount == 0 || commonNeighbors.size() != sharedTriangleCount)
+        {
+            return false;
+        }
+
+        // The triangles which remain must neither flip nor degenerate.
+        for (uint32_t t : vertexTriangles[from])
+        {
+            const uint16_t* corners = &indices[t * 3];
+            if (corners[0] == to || corners[1] == to || corners[2] == to)
+            {
+                continue;
+            }
+
+            const float3 oldNormal = cross(positions[corners[1]] - positions[corners[0]], positions[corners[2]] - positions[corners[0]]);
+            float3 newCorners[3];
+            for (int k = 0; k < 3; ++k)
+            {
+                newCorners[k] = positions[corners[k] == from ? to : corners[k]];
+            }
+            const float3 newNormal = cross(newCorners[1] - newCorners[0], newCorners[2] - newCorners[0]);
+
+            const float newLength = length(newNormal);
+            if (newLength == 0.0f || dot(oldNormal, newNormal) < MinNormalCosine * length(oldNormal) * newLength)
+            {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    uint32_t remainingTriangleCount = triangleCount;
+    while (remainingTriangleCount > maxTriangleCount && !queue.empty())
+    {
+        const Collapse collapse = queue.top();
+        queue.pop();
+
+        if (vertexRemoved[collapse.from] || vertexRemoved[collapse.to] || versions[collapse.from] != collapse.fromVersion ||
+            versions[collapse.to] != collapse.toVersion || !canCollapse(collapse.from, collapse.to))
+        {
+            continue;
+        }
+
+        for (uint32_t t : vertexTriangles[collapse.from])
+        {
+            uint16_t* corners = &indices[t * 3];
+            if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to)
+            {
+                triangleRemoved[t] = true;
+                remainingTriangleCount--;
+            }
+            else
+            {
+                std::replace(corners, corners + 3, static_cast<uint16_t>(collapse.from), static_cast<uint16_t>(collapse.to));
+                vertexTriangles[collapse.to].push_back(t);
+            }
+        }
+
+        // The removed triangles are dropped from the lists of their remaining corners.
+        std::vector<uint32_t> collapsedTriangles = std::move(vertexTriangles[collapse.from]);
+        vertexTriangles[collapse.from].clear();
+        for (uint32_t t : collapsedTriangles)
+        {
+            if (triangleRemoved[t])
+            {
+                for (int k = 0; k < 3; ++k)
+                {
+                    std::vector<uint32_t>& triangles = vertexTriangles[indices[t * 3 + k]];
+                    triangles.erase(std::remove(triangles.begin(), triangles.end(), t), triangles.end());
+                }
+            }
+        }
+
+        vertexRemoved[collapse.from] = true;
+        quadrics[collapse.to].Add(quadrics[collapse.from]);
+        versions[collapse.to]++;
+        pushCollapsesOf(collapse.to);
+    }
+
+    size_t indexCount = 0;
+    for (uint32_t t = 0; t < triangleCount; ++t)
+    {
+        if (!triangleRemoved[t])
+        {
+            std::copy_n(&indices[t * 3], 3, &indices[indexCount]);
+            indexCount += 3;
+        }
+    }
+    indices.resize(indexCount);
+
+    ReorderVerticesByFirstUse(vertices, indices);
+}
+
+void MeshProcessing::OptimizeVertexCache(std::vector<PackedVertex>& vertices, std::vector<uint16_t>& indices)
+{
+    const uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+    const uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+    // The triangles of vertex v are vertexTriangles[triangleOffsets[v]...], the first remainingTriangles[v] of them not emitted yet.
+    std::vector<uint32_t> remainingTriangles(vertexCount, 0);
+    for (uint16_t index : indices)
+    {
+        remainingTriangles[index]++;
+    }
+
+    std::vector<uint32_t> triangleOffsets(vertexCount + 1, 0);
+    for (uint32_t v = 0; v < vertexCount; ++v)
+    {
+        triangleOffsets[v + 1] = triangleOffsets[v] + remainingTriangles[v];
+    }
+
+    std::vector<uint32_t> vertexTriangles(indices.size());
+    {
+        std::vector<uint32_t> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+        for (uint32_t i = 0; i < indices.size(); ++i)
+        {
+            vertexTriangles[fill[indices[i]]++] = i / 3;
+        }
+    }
+
+    std::vector<int32_t> cachePositions(vertexCount, -1);
+    std::vector<float> vertexScores(vertexCount);
+    for (uint32_t v = 0; v < vertexCount; ++v)
+    {
+        vertexScores[v] = GetVertexScore(-1, remainingTriangles[v]);
+    }
+
+    uint32_t bestTriangle = InvalidIndex;
+    float bestScore = -1.0f;
+    for (uint32_t t = 0; t < triangleCount; ++t)
+    {
+        const float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestTriangle = t;
+        }
+    }
+
+    std::vector<bool> triangleEmitted(triangleCount, false);
+    std::vector<uint16_t> optimizedIndices;
+    optimizedIndices.reserve(indices.size());
+
+    // The cache holds up to VertexCacheSize entries, the three entries beyond are the ones pushed out by the last triangle.
+    std::array<uint32_t, VertexCacheSize + 3> cache;
+    uint32_t cacheCount = 0;
+    uint32_t nextUnemittedTriangle = 0;
+    for (uint32_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+    {
+        // If no triangle of the cached vertices is left, continue with the first one which was not emitted yet.
+        if (bestTriangle == InvalidIndex)
+        {
+            while (triangleEmitted[nextUnemittedTriangle])
+            {
+                nextUnemittedTriangle++;
+            }
+            bestTriangle = nextUnemittedTriangle;
+        }
+
+        const uint16_t* corners = &indices[bestTriangle * 3];
+        triangleEmitted[bestTriangle] = true;
+        optimizedIndices.insert(optimizedIndices.end(), corners, corners + 3);
+
+        for (int k = 0; k < 3; ++k)
+        {
+            const uint16_t v = corners[k];
+            uint32_t* triangles = &vertexTriangles[triangleOffsets[v]];
+            std::swap(*std::find(triangles, triangles + remainingTriangles[v], bestTriangle), triangles[remainingTriangles[v] - 1]);
+            remainingTriangles[v]--;
+        }
+
+        std::array<uint32_t, VertexCacheSize + 3> newCache;
+        uint32_t newCacheCount = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            newCache[newCacheCount++] = corners[k];
+        }
+        for (uint32_t i = 0; i < cacheCount; ++i)
+        {
+            if (cache[i] != corners[0] && cache[i] != corners[1] && cache[i] != corners[2])
+            {
+                newCache[newCacheCount++] = cache[i];
+            }
+        }
+
+        for (uint32_t i = 0; i < newCacheCount; ++i)
+        {
+            const uint32_t v = newCache[i];
+            cachePositions[v] = i < VertexCacheSize ? static_cast<int32_t>(i) : -1;
+            vertexScores[v] = GetVertexScore(cachePositions[v], remainingTriangles[v]);
+        }
+
+        // Only the scores of the triangles of cached vertices changed, the best of them is emitted next.
+        bestTriangle = InvalidIndex;
+        bestScore = -1.0f;
+        for (uint32_t i = 0; i < newCacheCount; ++i)
+        {
+            const uint32_t v = newCache[i];
+            const uint32_t* triangles = &vertexTriangles[triangleOffsets[v]];
+            for (uint32_t j = 0; j < remainingTriangles[v]; ++j)
+            {
+                const uint32_t t = triangles[j];
+                const float score = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        cacheCount = std::min(newCacheCount, VertexCacheSize);
+        cache = newCache;
+    }
+
+    indices = std::move(optimizedIndices);
+    ReorderVerticesByFirstUse(vertices, indices);
+}
+
+void MeshProcessing::Process(
+    std::vector<PackedVertex>& vertices, std::vector<uint16_t>& indices, uint32_t maxTriangleCount, const float3& positionScale)
+{
+    WeldVertices(vertices, indices);
+    Decimate(vertices, indices, maxTriangleCount, positionScale);
+    OptimizeVertexCache(vertices, indices);
+}
@@ -0,0 +1,50 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#pragma once
+
+#include <winrt/Windows.Foundation.Numerics.h>
+
+#include <cstdint>
+#include <vector>
+
+// Processing of spatial surface meshes on the thread which ingests them, before they are uploaded. The vertices keep the
+// R16G16B16A16 SNORM layout of SpatialSurfaceMesh and the indices stay 16 bit, so the result is uploaded like the original mesh.
+namespace MeshProcessing
+{
+    struct PackedVertex
+    {
+        int16_t pos[4];
+    };
+
+    // Merges vertices with the same position and drops the triangles which degenerate by that.
+    void WeldVertices(std::vector<PackedVertex>& vertices, std::vector<uint16_t>& indices);
+
+    // Collapses the edges with the smallest quadric error until at most maxTriangleCount triangles are left, or no edge can be
+    // collapsed without folding the surface. Vertices on the border of the mesh are kept in place, so the seams between
+    // neighboring surfaces stay closed. The positions are scaled by positionScale to measure the error in meters.
+    void Decimate(
+        std::vector<PackedVertex>& vertices,
+        std::vector<uint16_t>& indices,
+        uint32_t maxTriangleCount,
+        const winrt::Windows::Foundation::Numerics::float3& positionScale);
+
+    // Orders the triangles for the post-transform vertex cache (Forsyth) and the vertices by their first use.
+    void OptimizeVertexCache(std::vector<PackedVertex>& vertices, std::vector<uint16_t>& indices);
+
+    // Welds, decimates to the triangle budget and optimizes the mesh for the vertex cache.
+    void Process(
+        std::vector<PackedVertex>& vertices,
+        std::vector<uint16_t>& indices,
+        uint32_t maxTriangleCount,
+        const winrt::Windows::Foundation::Numerics::float3& positionScale);
+} // namespace MeshProcessing
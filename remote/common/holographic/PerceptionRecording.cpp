@@ -0,0 +1,493 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#include <pch.h>
+
+#include <DbgLog.h>
+#include <ThreadConfiguration.h>
+#include <holographic/PerceptionRecording.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace PerceptionRecording
+{
+    namespace
+    {
+        template <typename T>
+        winrt::array_view<const uint8_t> AsBytes(const T& value)
+        {
+            return {reinterpret_cast<const uint8_t*>(&value), static_cast<uint32_t>(sizeof(T))};
+        }
+
+        template <typename T>
+        winrt::array_view<const uint8_t> AsBytes(winrt::array_view<const T> values)
+        {
+            return {reinterpret_cast<const uint8_t*>(values.data()), static_cast<uint32_t>(values.size() * sizeof(T))};
+        }
+
+        // Reads the parts of a payload in order. A read past the end of the payload fails, as do all reads after it.
+        class PayloadReader
+        {
+        public:
+            PayloadReader(const std::vector<uint8_t>& payload)
+                : m_payload(payload)
+            {
+            }
+
+            template <typename T>
+            bool Read(T& value)
+            {
+                return Read(&value, sizeof(T));
+            }
+
+            template <typename T>
+            bool Read(std::vector<T>& values, size_t count)
+            {
+                // The count is checked against the payload before anything is allocated for it.
+                if (count > Remaining() / sizeof(T))
+                {
+                    m_failed = true;
+                    return false;
+                }
+
+                values.resize(count);
+                return Read(values.data(), count * sizeof(T));
+            }
+
+            // Reads the rest of the payload as an array.
+            template <typename T>
+            bool ReadAll(std::vector<T>& values)
+            {
+                return Remaining() % sizeof(T) == 0 && Read(values, Remaining() / sizeof(T));
+            }
+
+            bool Failed() const
+            {
+                return m_failed;
+            }
+
+        private:
+            size_t Remaining() const
+            {
+                return m_payload.size() - m_offset;
+            }
+
+            bool Read(void* data, size_t size)
+            {
+                if (m_failed || size > Remaining())
+                {
+                    m_failed = true;
+                    return false;
+                }
+
+                if (size != 0)
+                {
+                    memcpy(data, m_payload.data() + m_offset, size);
+                    m_offset += size;
+                }
+                return true;
+            }
+
+            const std::vector<uint8_t>& m_payload;
+            size_t m_offset = 0;
+            bool m_failed = false;
+        };
+    } // namespace
+
+    Recorder::Recorder(const std::filesystem::path& path)
+        : m_file(path, std::ios::binary | std::ios::trunc)
+    {
+        if (!m_file)
+        {
+            DebugLog(L"Failed to create the perception recording %s.\n", path.c_str());
+            m_file.close();
+            return;
+        }
+
+        const FileHeader header;
+        m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        m_writer = std::thread([this]() { WriteRecords(); });
+    }
+
+    Recorder::~Recorder()
+    {
+        {
+            std::lock_guard lock(m_mutex);
+            m_stopping = true;
+        }
+        m_recordsAdded.notify_one();
+
+        if (m_writer.joinable())
+        {
+            m_writer.join();
+        }
+    }
+
+    void Recorder::WriteFrame(std::chrono::microseconds time)
+    {
+        const uint64_t microseconds = static_cast<uint64_t>(time.count());
+        Write(RecordType::Frame, {AsBytes(microseconds)});
+    }
+
+    void Recorder::WriteCameras(const std::vector<Camera>& cameras)
+    {
+        Write(RecordType::Cameras, {AsBytes(winrt::array_view<const Camera>(cameras))});
+    }
+
+    void Recorder::WriteSpatialInput(const SpatialInput& spatialInput)
+    {
+        SpatialInputHeader header;
+        header.modelTransform = spatialInput.modelTransform;
+        header.transformCount = static_cast<uint32_t>(spatialInput.transforms.size());
+        header.jointCount = static_cast<uint32_t>(spatialInput.joints.size());
+
+        Write(
+            RecordType::SpatialInput,
+            {AsBytes(header),
+             AsBytes(winrt::array_view<const Pose>(spatialInput.transforms)),
+             AsBytes(winrt::array_view<const Joint>(spatialInput.joints))});
+    }
+
+    void Recorder::WriteQRCodes(const std::vector<QRCode>& qrCodes)
+    {
+        Write(RecordType::QRCodes, {AsBytes(winrt::array_view<const QRCode>(qrCodes))});
+    }
+
+    void Recorder::WriteSurfaceMesh(
+        const winrt::guid& surfaceId,
+        const winrt::Windows::Foundation::Numerics::float3& vertexScale,
+        winrt::array_view<const SurfaceMeshVertex> vertices,
+        winrt::array_view<const uint16_t> indices)
+    {
+        SurfaceMeshHeader header;
+        header.surfaceId = surfaceId;
+        header.vertexScale = vertexScale;
+        header.vertexCount = vertices.size();
+        header.indexCount = indices.size();
+
+        Write(RecordType::SurfaceMesh, {AsBytes(header), AsBytes(vertices), AsBytes(indices)});
+    }
+
+    void Recorder::WriteSurfaceMeshTransforms(const std::vector<SurfaceMeshTransform>& transforms)
+    {
+        Write(RecordType::SurfaceMeshTransforms, {AsBytes(winrt::array_view<const SurfaceMeshTransform>(transforms))});
+    }
+
+    void Recorder::Write(RecordType type, std::initializer_list<winrt::array_view<const uint8_t>> parts)
+    {
+        if (!IsOpen())
+        {
+            return;
+        }
+
+        RecordHeader header;
+        header.type = type;
+        for (const winrt::array_view<const uint8_t>& part : parts)
+        {
+            header.size += part.size();
+        }
+
+        {
+            std::lock_guard lock(m_mutex);
+            const auto headerBytes = AsBytes(header);
+            m_records.insert(m_records.end(), headerBytes.begin(), headerBytes.end());
+            for (const winrt::array_view<const uint8_t>& part : parts)
+            {
+                m_records.insert(m_records.end(), part.begin(), part.end());
+            }
+        }
+        m_recordsAdded.notify_one();
+    }
+
+    void Recorder::WriteRecords()
+    {
+        // The writes must not compete with the frames for the disk or the processor.
+        ThreadConfiguration::BackgroundPriorityScope backgroundPriority;
+
+        // The records are swapped with this buffer, so neither side allocates once both have grown to the size of a frame.
+        std::vector<uint8_t> records;
+        bool failed = false;
+
+        while (true)
+        {
+            bool stopping = false;
+            {
+                std::unique_lock lock(m_mutex);
+                m_recordsAdded.wait(lock, [this]() { return m_stopping || !m_records.empty(); });
+                records.swap(m_records);
+                stopping = m_stopping;
+            }
+
+            if (!records.empty() && !failed)
+            {
+                m_file.write(reinterpret_cast<const char*>(records.data()), static_cast<std::streamsize>(records.size()));
+                if (!m_file)
+                {
+                    DebugLog(L"Failed to write the perception recording, the rest of the input is not recorded.\n");
+                    failed = true;
+                }
+            }
+            records.clear();
+
+            if (stopping)
+            {
+                std::lock_guard lock(m_mutex);
+                if (m_records.empty())
+                {
+                    break;
+                }
+            }
+        }
+
+        m_file.close();
+    }
+
+    Reader::Reader(const std::filesystem::path& path)
+        : m_file(path, std::ios::binary)
+    {
+        FileHeader header;
+        if (!m_file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != FileHeader::Magic ||
+            header.version != FileHeader::Version)
+        {
+            DebugLog(L"Failed to open the perception recording %s.\n", path.c_str());
+            m_file.close();
+            return;
+        }
+
+        std::error_code error;
+        m_fileSize = std::filesystem::file_size(path, error);
+        if (error)
+        {
+            DebugLog(L"Failed to open the perception recording %s.\n", path.c_str());
+            m_file.close();
+        }
+    }
+
+    bool Reader::ReadFrame(Frame& frame)
+    {
+        // The containers are cleared instead of replaced, so their memory is reused from frame to frame.
+        frame.time = std::chrono::microseconds(0);
+        frame.cameras.clear();
+        frame.spatialInput.modelTransform = winrt::Windows::Foundation::Numerics::float4x4::identity();
+        frame.spatialInput.transforms.clear();
+        frame.spatialInput.joints.clear();
+        frame.qrCodes.clear();
+        frame.surfaceMeshes.clear();
+        frame.surfaceMeshTransforms.clear();
+
+        if (!IsOpen())
+        {
+            return false;
+        }
+
+        // Records before the first Frame record belong to the first frame.
+        bool frameStarted = false;
+        while (true)
+        {
+            RecordHeader header;
+            if (m_nextFrameHeader)
+            {
+                header = *m_nextFrameHeader;
+                m_nextFrameHeader.reset();
+            }
+            else if (!ReadRecordHeader(header))
+            {
+                // The end of the file ends the last frame.
+                return frameStarted;
+            }
+
+            if (header.type == RecordType::Frame && frameStarted)
+            {
+                m_nextFrameHeader = header;
+                return true;
+            }
+
+            // The size is checked before anything is allocated for it, the replay stops at a record which cannot fit.
+            const uint64_t position = static_cast<uint64_t>(static_cast<std::streamoff>(m_file.tellg()));
+            if (header.size > MaxRecordSize || header.size > m_fileSize - std::min(position, m_fileSize))
+            {
+                DebugLog(
+                    L"The perception recording has a record of type %u with an invalid size of %u bytes, replaying stops.\n",
+                    static_cast<uint32_t>(header.type),
+                    header.size);
+                m_file.close();
+                return false;
+            }
+
+            m_payload.resize(header.size);
+            if (!m_file.read(reinterpret_cast<char*>(m_payload.data()), static_cast<std::streamsize>(m_payload.size())))
+            {
+                // The recording was cut off in the middle of a record, e.g. because the app was terminated.
+                return frameStarted;
+            }
+
+            PayloadReader payload(m_payload);
+            switch (header.type)
+            {
+                case RecordType::Frame:
+                {
+                    uint64_t microseconds = 0;
+                    payload.Read(microseconds);
+                    frame.time = std::chrono::microseconds(microseconds);
+                    frameStarted = true;
+                    break;
+                }
+
+                case RecordType::Cameras:
+                    payload.ReadAll(frame.cameras);
+                    break;
+
+                case RecordType::SpatialInput:
+                {
+                    SpatialInputHeader spatialInputHeader;
+                    SpatialInput& spatialInput = frame.spatialInput;
+                    if (payload.Read(spatialInputHeader))
+                    {
+                        spatialInput.modelTransform = spatialInputHeader.modelTransform;
+                        payload.Read(spatialInput.transforms, spatialInputHeader.transformCount);
+                        payload.Read(spatialInput.joints, spatialInputHeader.jointCount);
+                    }
+                    break;
+                }
+
+                case RecordType::QRCodes:
+                    payload.ReadAll(frame.qrCodes);
+                    break;
+
+                case RecordType::SurfaceMesh:
+                {
+                    SurfaceMeshHeader surfaceMeshHeader;
+                    if (payload.Read(surfaceMeshHeader))
+                    {
+                        SurfaceMesh& surfaceMesh = frame.surfaceMeshes.emplace_back();
+                        surfaceMesh.surfaceId = surfaceMeshHeader.surfaceId;
+                        surfaceMesh.vertexScale = surfaceMeshHeader.vertexScale;
+                        payload.Read(surfaceMesh.vertices, surfaceMeshHeader.vertexCount);
+                        payload.Read(surfaceMesh.indices, surfaceMeshHeader.indexCount);
+                    }
+                    break;
+                }
+
+                case RecordType::SurfaceMeshTransforms:
+                    payload.ReadAll(frame.surfaceMeshTransforms);
+                    break;
+
+                default:
+                    break;
+            }
+
+            if (payload.Failed())
+            {
+                DebugLog(
+                    L"The perception recording has a damaged record of type %u, replaying stops there.\n",
+                    static_cast<uint32_t>(header.type));
+                return false;
+            }
+        }
+    }
+
+    void Reader::Rewind()
+    {
+        if (!IsOpen())
+        {
+            return;
+        }
+
+        m_file.clear();
+        m_file.seekg(sizeof(FileHeader));
+        m_nextFrameHeader.reset();
+    }
+
+    bool Reader::ReadRecordHeader(RecordHeader& header)
+    {
+        return static_cast<bool>(m_file.read(reinterpret_cast<char*>(&header), sizeof(header)));
+    }
+
+    Replay::Replay(const std::filesystem::path& path, bool asFastAsPossible)
+        : m_reader(path)
+        , m_asFastAsPossible(asFastAsPossible)
+    {
+        m_hasNextFrame = m_reader.ReadFrame(m_nextFrame);
+    }
+
+    const Frame& Replay::Advance(std::chrono::steady_clock::time_point now, const std::function<void(const SurfaceMesh&)>& onSurfaceMesh)
+    {
+        if (!m_passStarted)
+        {
+            m_passStarted = true;
+            m_passStartTime = now;
+            m_passFirstFrameTime = m_nextFrame.time;
+        }
+
+        bool advanced = false;
+        do
+        {
+            if (!m_hasNextFrame)
+            {
+                // The last frame of a pass is shown before the next pass starts.
+                if (advanced)
+                {
+                    break;
+                }
+
+                EndPass(now);
+                if (!m_hasNextFrame)
+                {
+                    break;
+                }
+            }
+
+            // At the recorded timing, a frame is due once as much time passed since the start of the pass as was recorded between
+            // the first frame and it.
+            if (!m_asFastAsPossible && m_nextFrame.time - m_passFirstFrameTime > now - m_passStartTime)
+            {
+                break;
+            }
+
+            std::swap(m_frame, m_nextFrame);
+            for (const SurfaceMesh& surfaceMesh : m_frame.surfaceMeshes)
+            {
+                onSurfaceMesh(surfaceMesh);
+            }
+            m_hasNextFrame = m_reader.ReadFrame(m_nextFrame);
+            advanced = true;
+        } while (!m_asFastAsPossible);
+
+        m_passFrameCount++;
+        return m_frame;
+    }
+
+    void Replay::EndPass(std::chrono::steady_clock::time_point now)
+    {
+        m_passCount++;
+        if (m_passFrameCount > 0)
+        {
+            const std::chrono::duration<double> replayDuration = now - m_passStartTime;
+            const std::chrono::duration<double> recordedDuration = m_frame.time - m_passFirstFrameTime;
+            DebugLog(
+                L"Perception replay pass %u: %u frames in %.2f s (recorded over %.2f s), %.2f ms per frame.\n",
+                m_passCount,
+                m_passFrameCount,
+                replayDuration.count(),
+                recordedDuration.count(),
+                1000.0 * replayDuration.count() / m_passFrameCount);
+        }
+
+        m_reader.Rewind();
+        m_hasNextFrame = m_reader.ReadFrame(m_nextFrame);
+        m_passStartTime = now;
+        m_passFirstFrameTime = m_nextFrame.time;
+        m_passFrameCount = 0;
+    }
+} // namespace PerceptionRecording
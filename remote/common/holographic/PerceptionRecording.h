@@ -0,0 +1,263 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#pragma once
+
+#include <winrt/Windows.Foundation.Numerics.h>
+#include <winrt/Windows.Perception.Spatial.h>
+
+#include <DirectXMath.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Recording of the perception input of the sample: the camera poses, the poses of the spatial input sources, the QR codes and the
+// spatial surface meshes. A recording replaces the live input when it is replayed, so frame-time issues seen with the head motion,
+// hands and environment of a device can be reproduced with exactly the same input, see SampleRemoteApp.
+//
+// The input is recorded where the renderers have turned it into content, e.g. the joints of the hands in rendering space, so it
+// is replayed without any perception API. A file starts with a FileHeader, followed by records of a RecordHeader and its payload.
+// A Frame record starts a frame, the records up to the next Frame record belong to it. Records of unknown types are skipped.
+namespace PerceptionRecording
+{
+    struct FileHeader
+    {
+        static constexpr uint32_t Magic = 0x43525050; // "PPRC"
+        static constexpr uint32_t Version = 1;
+
+        uint32_t magic = Magic;
+        uint32_t version = Version;
+    };
+
+    enum class RecordType : uint8_t
+    {
+        // A uint64_t with the time since the start of the app in microseconds.
+        Frame = 1,
+        // A Camera per camera pose of the frame.
+        Cameras = 2,
+        // A SpatialInputHeader, followed by the transforms and the joints.
+        SpatialInput = 3,
+        // The QRCode of every located code.
+        QRCodes = 4,
+        // A SurfaceMeshHeader, followed by the vertices and the indices. Written whenever the mesh of a surface is ingested.
+        SurfaceMesh = 5,
+        // The SurfaceMeshTransform of every located surface which has a mesh.
+        SurfaceMeshTransforms = 6,
+    };
+
+    struct RecordHeader
+    {
+        RecordType type = RecordType::Frame;
+        uint8_t reserved[3] = {};
+        uint32_t size = 0;
+    };
+
+    struct Camera
+    {
+        // Transposed for the shaders, like DXHelper::ViewProjectionConstantBuffer. Only valid if the camera was located.
+        DirectX::XMFLOAT4X4 viewProjection[2] = {};
+        winrt::Windows::Perception::Spatial::SpatialBoundingFrustum cullingFrustum = {};
+        uint32_t located = 0;
+        uint32_t hasCullingFrustum = 0;
+    };
+
+    struct Pose
+    {
+        winrt::Windows::Foundation::Numerics::float3 position;
+        winrt::Windows::Foundation::Numerics::quaternion orientation;
+    };
+
+    struct Joint
+    {
+        Pose pose;
+        float length;
+        float radius;
+    };
+
+    struct SpatialInputHeader
+    {
+        winrt::Windows::Foundation::Numerics::float4x4 modelTransform;
+        uint32_t transformCount = 0;
+        uint32_t jointCount = 0;
+    };
+
+    // The poses of the eye gaze and the spatial input sources, as sampled by SpatialInputRenderer::Update.
+    struct SpatialInput
+    {
+        winrt::Windows::Foundation::Numerics::float4x4 modelTransform = winrt::Windows::Foundation::Numerics::float4x4::identity();
+        std::vector<Pose> transforms;
+        std::vector<Joint> joints;
+    };
+
+    struct QRCode
+    {
+        winrt::Windows::Foundation::Numerics::float4x4 codeToRendering;
+        float size;
+    };
+
+    // A vertex in the R16G16B16A16IntNormalized format of the spatial surface meshes.
+    struct SurfaceMeshVertex
+    {
+        int16_t position[4];
+    };
+
+    struct SurfaceMeshHeader
+    {
+        winrt::guid surfaceId;
+        winrt::Windows::Foundation::Numerics::float3 vertexScale;
+        uint32_t vertexCount = 0;
+        uint32_t indexCount = 0;
+    };
+
+    struct SurfaceMesh
+    {
+        winrt::guid surfaceId;
+        winrt::Windows::Foundation::Numerics::float3 vertexScale;
+        std::vector<SurfaceMeshVertex> vertices;
+        std::vector<uint16_t> indices;
+    };
+
+    struct SurfaceMeshTransform
+    {
+        winrt::guid surfaceId;
+        winrt::Windows::Foundation::Numerics::float4x4 meshToRendering;
+    };
+
+    // The input of a frame read from a recording. Input which was not recorded in the frame is left empty. Surface meshes are
+    // only recorded when they are ingested, so a frame only holds the meshes ingested since the previous frame.
+    struct Frame
+    {
+        std::chrono::microseconds time{0};
+        std::vector<Camera> cameras;
+        SpatialInput spatialInput;
+        std::vector<QRCode> qrCodes;
+        std::vector<SurfaceMesh> surfaceMeshes;
+        std::vector<SurfaceMeshTransform> surfaceMeshTransforms;
+    };
+
+    // Writes a recording. Records may be added from any thread and are written in the order they were added, by a thread of the
+    // recorder, so the file IO does not add to the frame time.
+    class Recorder
+    {
+    public:
+        // Replaces the file with a new recording. Check IsOpen for whether the file could be created.
+        explicit Recorder(const std::filesystem::path& path);
+
+        // Writes the records added so far and closes the file.
+        ~Recorder();
+
+        bool IsOpen() const
+        {
+            return m_file.is_open();
+        }
+
+        void WriteFrame(std::chrono::microseconds time);
+        void WriteCameras(const std::vector<Camera>& cameras);
+        void WriteSpatialInput(const SpatialInput& spatialInput);
+        void WriteQRCodes(const std::vector<QRCode>& qrCodes);
+        void WriteSurfaceMesh(
+            const winrt::guid& surfaceId,
+            const winrt::Windows::Foundation::Numerics::float3& vertexScale,
+            winrt::array_view<const SurfaceMeshVertex> vertices,
+            winrt::array_view<const uint16_t> indices);
+        void WriteSurfaceMeshTransforms(const std::vector<SurfaceMeshTransform>& transforms);
+
+    private:
+        // The payload of a record is the concatenation of the parts.
+        void Write(RecordType type, std::initializer_list<winrt::array_view<const uint8_t>> parts);
+        void WriteRecords();
+
+        std::ofstream m_file;
+
+        // Records added since the writer thread last took them over.
+        std::mutex m_mutex;
+        std::condition_variable m_recordsAdded;
+        std::vector<uint8_t> m_records;
+        bool m_stopping = false;
+
+        std::thread m_writer;
+    };
+
+    // Reads a recording frame by frame, so a recording of any length is replayed with the memory of a few frames.
+    class Reader
+    {
+    public:
+        // Check IsOpen for whether the file is a recording.
+        explicit Reader(const std::filesystem::path& path);
+
+        bool IsOpen() const
+        {
+            return m_file.is_open();
+        }
+
+        // Reads the next frame. Returns false at the end of the recording and at a damaged record. A record larger than the rest of
+        // the file or MaxRecordSize also closes the reader, so the replay ends.
+        bool ReadFrame(Frame& frame);
+
+        // Starts over at the first frame.
+        void Rewind();
+
+    private:
+        // No record comes close to this, a larger size is a damaged record header.
+        static constexpr uint32_t MaxRecordSize = 64 * 1024 * 1024;
+
+        bool ReadRecordHeader(RecordHeader& header);
+
+        std::ifstream m_file;
+        uint64_t m_fileSize = 0;
+        // The Frame record which ended the previous frame, and starts the next one.
+        std::optional<RecordHeader> m_nextFrameHeader;
+        std::vector<uint8_t> m_payload;
+    };
+
+    // Replays a recording in a loop, either at the timing it was recorded with or with one recorded frame per app frame. Each pass
+    // over the recording logs the frame time it was replayed with.
+    class Replay
+    {
+    public:
+        Replay(const std::filesystem::path& path, bool asFastAsPossible);
+
+        bool IsOpen() const
+        {
+            return m_hasNextFrame;
+        }
+
+        // Returns the frame to show now. At the recorded timing, frames are skipped when the app renders slower than the recording
+        // and shown again when it renders faster. The meshes of skipped frames are passed to onSurfaceMesh nevertheless, since a mesh
+        // is only recorded once. Must not be called if the replay is not open.
+        const Frame& Advance(std::chrono::steady_clock::time_point now, const std::function<void(const SurfaceMesh&)>& onSurfaceMesh);
+
+    private:
+        void EndPass(std::chrono::steady_clock::time_point now);
+
+        Reader m_reader;
+        const bool m_asFastAsPossible;
+
+        Frame m_frame;
+        Frame m_nextFrame;
+        bool m_hasNextFrame = false;
+
+        bool m_passStarted = false;
+        std::chrono::steady_clock::time_point m_passStartTime;
+        std::chrono::microseconds m_passFirstFrameTime{0};
+        uint32_t m_passFrameCount = 0;
+        uint32_t m_passCount = 0;
+    };
+} // namespace PerceptionRecording
@@ -0,0 +1,162 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <pch.h>
+
+#include <holographic/PreviewRenderer.h>
+
+#include <algorithm>
+
+#include <DirectXColors.h>
+
+PreviewRenderer::PreviewRenderer(const std::shared_ptr<DXHelper::DeviceResources>& deviceResources)
+    : m_deviceResources(deviceResources)
+{
+    CreateDeviceDependentResources();
+}
+
+std::future<void> PreviewRenderer::CreateDeviceDependentResources()
+{
+    DXHelper::ShaderCache& shaderCache = m_deviceResources->GetShaderCache();
+    auto vertexShader = shaderCache.GetVertexShaderAsync(L"Preview_VertexShader.cso");
+    auto pixelShader = shaderCache.GetPixelShaderAsync(L"Preview_PixelShader.cso");
+
+    // Trilinear filtering with clamped texture coordinates.
+    CD3D11_SAMPLER_DESC samplerDesc(D3D11_DEFAULT);
+    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateSamplerState(&samplerDesc, m_sampler.put()));
+
+    m_vertexShader = co_await vertexShader;
+    m_pixelShader = co_await pixelShader;
+
+    m_loadingComplete = true;
+}
+
+void PreviewRenderer::ReleaseDeviceDependentResources()
+{
+    m_loadingComplete = false;
+    m_vertexShader = nullptr;
+    m_pixelShader = nullptr;
+    m_sampler = nullptr;
+    m_deferredContext = nullptr;
+    m_sourceViews.clear();
+    m_copyTexture = nullptr;
+    m_copyTextureView = nullptr;
+}
+
+bool PreviewRenderer::Render(ID3D11Texture2D* source, ID3D11RenderTargetView* target, UINT targetWidth, UINT targetHeight)
+{
+    if (!m_loadingComplete)
+    {
+        return false;
+    }
+
+    D3D11_TEXTURE2D_DESC sourceDesc;
+    source->GetDesc(&sourceDesc);
+
+    // Fit the source into the center of the target.
+    const float scale = std::min(
+        static_cast<float>(targetWidth) / static_cast<float>(sourceDesc.Width),
+        static_cast<float>(targetHeight) / static_cast<float>(sourceDesc.Height));
+
+    D3D11_VIEWPORT viewport = {};
+    viewport.Width = static_cast<float>(sourceDesc.Width) * scale;
+    viewport.Height = static_cast<float>(sourceDesc.Height) * scale;
+    viewport.TopLeftX = (static_cast<float>(targetWidth) - viewport.Width) / 2;
+    viewport.TopLeftY = (static_cast<float>(targetHeight) - viewport.Height) / 2;
+    viewport.MaxDepth = 1.0f;
+
+    if (!m_deferredContext)
+    {
+        winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateDeferredContext3(0, m_deferredContext.put()));
+    }
+
+    ID3D11DeviceContext3* context = m_deferredContext.get();
+    ID3D11ShaderResourceView* sourceView = GetSourceView(context, source);
+
+    context->ClearRenderTargetView(target, DirectX::Colors::Black);
+    context->OMSetRenderTargets(1, &target, nullptr);
+    context->RSSetViewports(1, &viewport);
+    context->RSSetState(nullptr);
+
+    context->IASetInputLayout(nullptr);
+    context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    context->VSSetShader(m_vertexShader.get(), nullptr, 0);
+    context->GSSetShader(nullptr, nullptr, 0);
+    context->PSSetShader(m_pixelShader.get(), nullptr, 0);
+    context->PSSetShaderResources(0, 1, &sourceView);
+
+    ID3D11SamplerState* sampler = m_sampler.get();
+    context->PSSetSamplers(0, 1, &sampler);
+
+    context->Draw(3, 0);
+
+    // Finishing the command list resets the state of the deferred context, which also unbinds the source again.
+    winrt::com_ptr<ID3D11CommandList> commandList;
+    winrt::check_hresult(context->FinishCommandList(FALSE, commandList.put()));
+    m_deviceResources->ExecuteCommandList(commandList.get(), true);
+
+    return true;
+}
+
+ID3D11ShaderResourceView* PreviewRenderer::GetSourceView(ID3D11DeviceContext* context, ID3D11Texture2D* source)
+{
+    D3D11_TEXTURE2D_DESC sourceDesc;
+    source->GetDesc(&sourceDesc);
+
+    if ((sourceDesc.BindFlags & D3D11_BIND_SHADER_RESOURCE) == 0)
+    {
+        D3D11_TEXTURE2D_DESC copyDesc = {};
+        if (m_copyTexture)
+        {
+            m_copyTexture->GetDesc(&copyDesc);
+        }
+
+        if (copyDesc.Width != sourceDesc.Width || copyDesc.Height != sourceDesc.Height || copyDesc.Format != sourceDesc.Format)
+        {
+            const CD3D11_TEXTURE2D_DESC textureDesc(sourceDesc.Format, sourceDesc.Width, sourceDesc.Height, 1, 1);
+            winrt::com_ptr<ID3D11Texture2D> texture;
+            winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateTexture2D(&textureDesc, nullptr, texture.put()));
+
+            const CD3D11_SHADER_RESOURCE_VIEW_DESC viewDesc(texture.get(), D3D11_SRV_DIMENSION_TEXTURE2DARRAY);
+            winrt::com_ptr<ID3D11ShaderResourceView> view;
+            winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateShaderResourceView(texture.get(), &viewDesc, view.put()));
+
+            m_copyTexture = std::move(texture);
+            m_copyTextureView = std::move(view);
+        }
+
+        context->CopySubresourceRegion(m_copyTexture.get(), 0, 0, 0, 0, source, 0, nullptr);
+        return m_copyTextureView.get();
+    }
+
+    for (const auto& [texture, view] : m_sourceViews)
+    {
+        if (texture.get() == source)
+        {
+            return view.get();
+        }
+    }
+
+    if (m_sourceViews.size() >= MaxSourceViews)
+    {
+        m_sourceViews.clear();
+    }
+
+    // Always viewed as array, so a single pixel shader handles mono and stereo frames.
+    const CD3D11_SHADER_RESOURCE_VIEW_DESC viewDesc(source, D3D11_SRV_DIMENSION_TEXTURE2DARRAY);
+    winrt::com_ptr<ID3D11ShaderResourceView> view;
+    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateShaderResourceView(source, &viewDesc, view.put()));
+
+    winrt::com_ptr<ID3D11Texture2D> texture;
+    texture.copy_from(source);
+    m_sourceViews.emplace_back(std::move(texture), view);
+    return view.get();
+}
@@ -0,0 +1,57 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <holographic/DeviceResources.h>
+
+#include <atomic>
+#include <future>
+#include <utility>
+#include <vector>
+
+// Draws the first slice, i.e. the left eye, of the frames sent to the player into the preview window. The frame is scaled on the
+// GPU to fit the window while keeping its aspect ratio, so the preview window can be much smaller than the frame.
+class PreviewRenderer
+{
+public:
+    PreviewRenderer(const std::shared_ptr<DXHelper::DeviceResources>& deviceResources);
+
+    std::future<void> CreateDeviceDependentResources();
+    void ReleaseDeviceDependentResources();
+
+    // Returns false if the resources are still loading and nothing was drawn.
+    bool Render(ID3D11Texture2D* source, ID3D11RenderTargetView* target, UINT targetWidth, UINT targetHeight);
+
+private:
+    // Returns a view of the source which the pixel shader can sample. Must be called with exclusive access to the context.
+    ID3D11ShaderResourceView* GetSourceView(ID3D11DeviceContext* context, ID3D11Texture2D* source);
+
+    std::shared_ptr<DXHelper::DeviceResources> m_deviceResources;
+
+    // Render is called on the thread which sends the frames, so the preview is recorded here and executed with the state of the
+    // immediate context restored. The render thread may be between binding its state and drawing.
+    winrt::com_ptr<ID3D11DeviceContext3> m_deferredContext;
+
+    winrt::com_ptr<ID3D11VertexShader> m_vertexShader;
+    winrt::com_ptr<ID3D11PixelShader> m_pixelShader;
+    winrt::com_ptr<ID3D11SamplerState> m_sampler;
+
+    // Views of the recently rendered sources, which the remote context reuses frame after frame.
+    static constexpr size_t MaxSourceViews = 8;
+    std::vector<std::pair<winrt::com_ptr<ID3D11Texture2D>, winrt::com_ptr<ID3D11ShaderResourceView>>> m_sourceViews;
+
+    // Sources which cannot be bound as shader resource are copied to this texture first.
+    winrt::com_ptr<ID3D11Texture2D> m_copyTexture;
+    winrt::com_ptr<ID3D11ShaderResourceView> m_copyTextureView;
+
+    std::atomic<bool> m_loadingComplete = false;
+};
@@ -14,6 +14,9 @@ namespace
     constexpr const LONG windowInitialHeight = 720;
     constexpr const wchar_t* windowInitialTitle = L"Remote";
     constexpr const wchar_t* windowClassName = L"RemoteWindowHolographicWin32Class";
+
+    // Window messages are handled in batches of at most this many between two ticks, so a flood of messages cannot hold up frames.
+    constexpr const UINT maxMessagesPerTick = 32;
 } // namespace
 
 RemoteWindowHolographicWin32::RemoteWindowHolographicWin32(const std::shared_ptr<IRemoteAppHolographic>& app)
@@ -222,7 +225,7 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
     while (!quit)
     {
         MSG msg = {0};
-        if (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE))
+        for (UINT messageCount = 0; messageCount < maxMessagesPerTick && PeekMessage(&msg, NULL, 0, 0, PM_REMOVE); ++messageCount)
         {
             if (msg.message == WM_QUIT)
             {
@@ -232,17 +235,30 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
             TranslateMessage(&msg);
             DispatchMessage(&msg);
         }
-        else
+
+        if (quit)
         {
-            try
-            {
-                app->Tick();
-            }
-            catch (...)
-            {
-                // Unhandeled exception during tick, exit program
-                return 1;
-            }
+            break;
+        }
+
+        // While nothing is rendered, e.g. while waiting for a connection, sleep until a window message arrives, the app signals its
+        // wake event or the idle timeout elapses, instead of spinning a core.
+        const std::chrono::milliseconds idleTimeout = app->GetIdleTimeout();
+        if (idleTimeout.count() > 0)
+        {
+            HANDLE wakeEvent = app->GetWakeEvent();
+            MsgWaitForMultipleObjectsEx(
+                wakeEvent ? 1 : 0, &wakeEvent, static_cast<DWORD>(idleTimeout.count()), QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+        }
+
+        try
+        {
+            app->Tick();
+        }
+        catch (...)
+        {
+            // Unhandeled exception during tick, exit program
+            return 1;
         }
     }
 
@@ -0,0 +1,71 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#pragma once
+
+#include <d3d11.h>
+
+namespace RenderPath
+{
+    // The configuration a camera renders with, fixed at compile time so that the draw loops of a renderer do not branch on
+    // it. Stereo draws every object with one instance per view. With Vprt the vertex shaders set the render target array
+    // index themselves, otherwise a pass-through geometry shader does it.
+    template <bool Stereo, bool Vprt>
+    struct Variant
+    {
+        static constexpr bool IsStereo = Stereo;
+        static constexpr bool UsesVprt = Vprt;
+        static constexpr UINT InstanceCount = Stereo ? 2 : 1;
+
+        // The geometry shader of the variant, nullptr with VPRT. Always bound explicitly, a renderer does not rely on the
+        // state left behind by the previous one.
+        static ID3D11GeometryShader* GeometryShader(ID3D11GeometryShader* passThroughShader)
+        {
+            if constexpr (Vprt)
+            {
+                return nullptr;
+            }
+            else
+            {
+                return passThroughShader;
+            }
+        }
+    };
+
+    // Calls render with the variant of a camera. Renderers call this once per camera and specialize their draws on the variant.
+    template <typename RenderFunc>
+    void Dispatch(bool isStereo, bool usingVprt, RenderFunc&& render)
+    {
+        if (isStereo)
+        {
+            if (usingVprt)
+            {
+                render(Variant<true, true>{});
+            }
+            else
+            {
+                render(Variant<true, false>{});
+            }
+        }
+        else
+        {
+            if (usingVprt)
+            {
+                render(Variant<false, true>{});
+            }
+            else
+            {
+                render(Variant<false, false>{});
+            }
+        }
+    }
+} // namespace RenderPath
@@ -31,7 +31,7 @@ void RenderableObject::UpdateModelConstantBuffer(const winrt::Windows::Foundatio
 
         // Update the model transform buffer for the hologram.
         m_deviceResources->UseD3DDeviceContext(
-            [&](auto context) { context->UpdateSubresource(m_modelConstantBuffer.get(), 0, nullptr, &m_modelConstantBufferData, 0, 0); });
+            [&](auto context) { DXHelper::UpdateDynamicBuffer(context, m_modelConstantBuffer.get(), m_modelConstantBufferData); });
     }
 }
 
@@ -44,35 +44,32 @@ void RenderableObject::Render(bool isStereo, winrt::Windows::Foundation::IRefere
 
     // Use the D3D device context to update Direct3D device-based resources.
     m_deviceResources->UseD3DDeviceContext([&](auto context) {
-        context->IASetInputLayout(m_inputLayout.get());
+        DXHelper::UpdateDynamicBuffer(context, m_filterColorBuffer.get(), m_filterColorData);
 
-        // Attach the vertex shader.
-        context->VSSetShader(m_vertexShader.get(), nullptr, 0);
-
-        // Apply the model constant buffer to the vertex shader.
-        ID3D11Buffer* pBuffer = m_modelConstantBuffer.get();
-        context->VSSetConstantBuffers(0, 1, &pBuffer);
-
-        if (!m_usingVprtShaders)
-        {
-            // On devices that do not support the D3D11_FEATURE_D3D11_OPTIONS3::
-            // VPAndRTArrayIndexFromAnyShaderFeedingRasterizer optional feature,
-            // a pass-through geometry shader is used to set the render target
-            // array index.
-            context->GSSetShader(m_geometryShader.get(), nullptr, 0);
-        }
-
-        context->UpdateSubresource(m_filterColorBuffer.get(), 0, nullptr, &m_filterColorData, 0, 0);
-        ID3D11Buffer* pBufferToSet = m_filterColorBuffer.get();
-        context->PSSetConstantBuffers(0, 1, &pBufferToSet);
-
-        context->PSSetShader(m_pixelShader.get(), nullptr, 0);
-        context->RSSetState(m_rasterizerState.get());
-
-        Draw(isStereo ? 2 : 1, cullingFrustum);
+        Draw(m_renderQueue, isStereo ? 2 : 1, cullingFrustum);
+        m_renderQueue.Execute(context);
     });
 }
 
+DXHelper::DrawPacket RenderableObject::CreateDrawPacket() const
+{
+    DXHelper::DrawPacket packet;
+    packet.pipeline.inputLayout = m_inputLayout;
+    packet.pipeline.vertexShader = m_vertexShader;
+
+    // On devices that do not support the D3D11_FEATURE_D3D11_OPTIONS3::
+    // VPAndRTArrayIndexFromAnyShaderFeedingRasterizer optional feature,
+    // a pass-through geometry shader is used to set the render target
+    // array index. It is null otherwise.
+    packet.pipeline.geometryShader = m_geometryShader;
+    packet.pipeline.pixelShader = m_pixelShader;
+    packet.pipeline.rasterizerState = m_rasterizerState;
+
+    packet.vertexShaderConstantBuffers[0] = m_modelConstantBuffer;
+    packet.pixelShaderConstantBuffer = m_filterColorBuffer;
+    return packet;
+}
+
 std::future<void> RenderableObject::CreateDeviceDependentResources()
 {
     return CreateDeviceDependentResourcesInternal();
@@ -80,12 +77,6 @@ std::future<void> RenderableObject::CreateDeviceDependentResources()
 
 std::future<void> RenderableObject::CreateDeviceDependentResourcesInternal()
 {
-#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
-    std::wstring fileNamePrefix = L"";
-#else
-    std::wstring fileNamePrefix = L"ms-appx:///";
-#endif
-
     m_usingVprtShaders = m_deviceResources->GetDeviceSupportsVprt();
 
     // On devices that do support the D3D11_FEATURE_D3D11_OPTIONS3::
@@ -93,48 +84,53 @@ std::future<void> RenderableObject::CreateDeviceDependentResourcesInternal()
     // we can avoid using a pass-through geometry shader to set the render
     // target array index, thus avoiding any overhead that would be
     // incurred by setting the geometry shader stage.
-    std::wstring vertexShaderFileName = m_usingVprtShaders ? L"SimpleColor_VertexShaderVprt.cso" : L"SimpleColor_VertexShader.cso";
+    std::wstring vertexShaderFileName = m_deviceResources->GetVertexShaderFileName(L"SimpleColor_VertexShader");
 
-    // Load shaders asynchronously.
-    std::vector<byte> vertexShaderFileData = co_await DXHelper::ReadDataAsync(fileNamePrefix + vertexShaderFileName);
-    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateVertexShader(
-        vertexShaderFileData.data(), vertexShaderFileData.size(), nullptr, m_vertexShader.put()));
+    // Load shaders asynchronously. All shaders are requested before awaiting any of them, so their files are read in parallel.
+    DXHelper::ShaderCache& shaderCache = m_deviceResources->GetShaderCache();
+    auto vertexShader = shaderCache.GetVertexShaderAsync(vertexShaderFileName);
+    auto pixelShader = shaderCache.GetPixelShaderAsync(L"SimpleColor_PixelShader.cso");
+    std::future<winrt::com_ptr<ID3D11GeometryShader>> geometryShader;
+    if (!m_usingVprtShaders)
+    {
+        // Load the pass-through geometry shader.
+        geometryShader = shaderCache.GetGeometryShaderAsync(L"SimpleColor_GeometryShader.cso");
+    }
 
-    constexpr std::array<D3D11_INPUT_ELEMENT_DESC, 3> vertexDesc = {{
+    m_vertexShader = co_await vertexShader;
+    const DXHelper::ShaderCache::Bytecode vertexShaderBytecode = co_await shaderCache.GetBytecodeAsync(vertexShaderFileName);
+
+    constexpr std::array<D3D11_INPUT_ELEMENT_DESC, 2> vertexDesc = {{
         {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
-        {"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
-        {"COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
     }};
 
     winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateInputLayout(
         vertexDesc.data(),
         static_cast<UINT>(vertexDesc.size()),
-        vertexShaderFileData.data(),
-        static_cast<UINT>(vertexShaderFileData.size()),
+        vertexShaderBytecode.data(),
+        static_cast<UINT>(vertexShaderBytecode.size()),
         m_inputLayout.put()));
 
-    std::vector<byte> pixelShaderFileData = co_await DXHelper::ReadDataAsync(fileNamePrefix + L"SimpleColor_PixelShader.cso");
-    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreatePixelShader(
-        pixelShaderFileData.data(), pixelShaderFileData.size(), nullptr, m_pixelShader.put()));
+    m_pixelShader = co_await pixelShader;
 
     const ModelConstantBuffer constantBuffer{
         reinterpret_cast<DirectX::XMFLOAT4X4&>(winrt::Windows::Foundation::Numerics::float4x4::identity()),
     };
 
-    const CD3D11_BUFFER_DESC constantBufferDesc(sizeof(ModelConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
-    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(&constantBufferDesc, nullptr, m_modelConstantBuffer.put()));
+    const CD3D11_BUFFER_DESC constantBufferDesc(
+        sizeof(ModelConstantBuffer), D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+    const D3D11_SUBRESOURCE_DATA constantBufferData = {&constantBuffer};
+    winrt::check_hresult(
+        m_deviceResources->GetD3DDevice()->CreateBuffer(&constantBufferDesc, &constantBufferData, m_modelConstantBuffer.put()));
 
-    const CD3D11_BUFFER_DESC filterColorBufferDesc(sizeof(DirectX::XMFLOAT4), D3D11_BIND_CONSTANT_BUFFER);
+    const CD3D11_BUFFER_DESC filterColorBufferDesc(
+        sizeof(DirectX::XMFLOAT4), D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
     winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(&filterColorBufferDesc, nullptr, m_filterColorBuffer.put()));
 
-    if (!m_usingVprtShaders)
+    if (geometryShader.valid())
     {
-        // Load the pass-through geometry shader.
-        std::vector<byte> geometryShaderFileData = co_await DXHelper::ReadDataAsync(fileNamePrefix + L"SimpleColor_GeometryShader.cso");
-
-        // After the pass-through geometry shader file is loaded, create the shader.
-        winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateGeometryShader(
-            geometryShaderFileData.data(), geometryShaderFileData.size(), nullptr, m_geometryShader.put()));
+        m_geometryShader = co_await geometryShader;
     }
 
     {
@@ -162,11 +158,10 @@ void RenderableObject::AppendColoredTriangle(
     DirectX::XMFLOAT3 p1,
     DirectX::XMFLOAT3 p2,
     DirectX::XMFLOAT3 color,
-    std::vector<VertexPositionNormalColor>& vertices)
+    std::vector<VertexPositionColor>& vertices)
 {
-    VertexPositionNormalColor vertex;
-    vertex.color = color;
-    vertex.normal = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f);
+    VertexPositionColor vertex;
+    vertex.color = DirectX::PackedVector::XMUBYTEN4(color.x, color.y, color.z, 1.0f);
 
     vertex.pos = p0;
     vertices.push_back(vertex);
@@ -181,7 +176,7 @@ void RenderableObject::AppendColoredTriangle(
     winrt::Windows::Foundation::Numerics::float3 p1,
     winrt::Windows::Foundation::Numerics::float3 p2,
     winrt::Windows::Foundation::Numerics::float3 color,
-    std::vector<VertexPositionNormalColor>& vertices)
+    std::vector<VertexPositionColor>& vertices)
 {
 
     AppendColoredTriangle(
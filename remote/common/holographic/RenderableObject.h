@@ -11,6 +11,7 @@
 
 #pragma once
 
+#include <d3d11/RenderQueue.h>
 #include <d3d11/SimpleColor_ShaderStructures.h>
 #include <holographic/DeviceResources.h>
 
@@ -25,12 +26,21 @@ public:
     virtual std::future<void> CreateDeviceDependentResources();
     virtual void ReleaseDeviceDependentResources();
 
+    // Submits the draws of the object to a render queue and executes it, which sorts them by pipeline state.
     void Render(bool isStereo, winrt::Windows::Foundation::IReference<SpatialBoundingFrustum> cullingFrustum);
 
 protected:
     void UpdateModelConstantBuffer(const winrt::Windows::Foundation::Numerics::float4x4& modelTransform);
 
-    virtual void Draw(unsigned int numInstances, winrt::Windows::Foundation::IReference<SpatialBoundingFrustum> cullingFrustum) = 0;
+    // Submits the draws for the given camera to the queue. Called from within DeviceResources::UseD3DDeviceContext.
+    virtual void Draw(
+        DXHelper::RenderQueue& renderQueue,
+        unsigned int numInstances,
+        winrt::Windows::Foundation::IReference<SpatialBoundingFrustum> cullingFrustum) = 0;
+
+    // Returns a draw with the SimpleColor pipeline, the model constant buffer and the filter color buffer. Subclasses with their
+    // own vertex shader replace the input layout and the vertex shader of its pipeline.
+    DXHelper::DrawPacket CreateDrawPacket() const;
 
     std::future<void> CreateDeviceDependentResourcesInternal();
 
@@ -39,14 +49,14 @@ protected:
         DirectX::XMFLOAT3 p1,
         DirectX::XMFLOAT3 p2,
         DirectX::XMFLOAT3 color,
-        std::vector<VertexPositionNormalColor>& vertices);
+        std::vector<VertexPositionColor>& vertices);
 
     static void AppendColoredTriangle(
         winrt::Windows::Foundation::Numerics::float3 p0,
         winrt::Windows::Foundation::Numerics::float3 p1,
         winrt::Windows::Foundation::Numerics::float3 p2,
         winrt::Windows::Foundation::Numerics::float3 color,
-        std::vector<VertexPositionNormalColor>& vertices);
+        std::vector<VertexPositionColor>& vertices);
 
     // Cached pointer to device resources.
     std::shared_ptr<DXHelper::DeviceResources> m_deviceResources;
@@ -64,6 +74,9 @@ private:
     winrt::com_ptr<ID3D11RasterizerState> m_rasterizerState;
     DirectX::XMFLOAT4 m_filterColorData = {1, 1, 1, 1};
 
+    // Kept to reuse the memory of the draws from frame to frame.
+    DXHelper::RenderQueue m_renderQueue;
+
     // System resources for geometry.
     ModelConstantBuffer m_modelConstantBufferData;
     uint32_t m_indexCount = 0;
@@ -0,0 +1,327 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#include <pch.h>
+
+#include <holographic/SpatialIndex.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace winrt::Windows::Foundation::Numerics;
+
+SpatialIndex::SpatialIndex(float minCellSize)
+    : m_minCellSize(minCellSize)
+{
+}
+
+void SpatialIndex::Update(ObjectId id, const FrustumCulling::CullingSphere& bounds)
+{
+    if (id < m_locations.size() && m_locations[id].node != InvalidIndex)
+    {
+        const ObjectLocation& location = m_locations[id];
+        const Node& node = m_nodes[location.node];
+        if (Fits(node, bounds) && !FitsChild(node, bounds))
+        {
+            m_nodes[location.node].bounds[location.slot] = bounds;
+            return;
+        }
+
+        Remove(id);
+    }
+
+    Insert(id, bounds);
+}
+
+void SpatialIndex::Remove(ObjectId id)
+{
+    if (id >= m_locations.size() || m_locations[id].node == InvalidIndex)
+    {
+        return;
+    }
+
+    const ObjectLocation location = m_locations[id];
+    m_locations[id].node = InvalidIndex;
+
+    // The last object of the node takes the slot of the removed one.
+    Node& node = m_nodes[location.node];
+    const ObjectId lastObject = node.objects.back();
+    node.objects[location.slot] = lastObject;
+    node.bounds[location.slot] = node.bounds.back();
+    node.objects.pop_back();
+    node.bounds.pop_back();
+    if (lastObject != id)
+    {
+        m_locations[lastObject].slot = location.slot;
+    }
+
+    // Release the largest subtree which became empty, so moving objects do not leave a trail of empty nodes behind.
+    uint32_t emptySubtree = InvalidIndex;
+    for (uint32_t nodeIndex = location.node; nodeIndex != InvalidIndex; nodeIndex = m_nodes[nodeIndex].parent)
+    {
+        if (--m_nodes[nodeIndex].subtreeObjectCount == 0)
+        {
+            emptySubtree = nodeIndex;
+        }
+    }
+
+    if (emptySubtree != InvalidIndex)
+    {
+        const uint32_t parent = m_nodes[emptySubtree].parent;
+        if (parent != InvalidIndex)
+        {
+            std::replace(std::begin(m_nodes[parent].children), std::end(m_nodes[parent].children), emptySubtree, InvalidIndex);
+        }
+        else
+        {
+            m_root = InvalidIndex;
+        }
+        ReleaseSubtree(emptySubtree);
+    }
+}
+
+void SpatialIndex::Clear()
+{
+    m_nodes.clear();
+    m_freeNodes.clear();
+    m_root = InvalidIndex;
+    m_locations.clear();
+}
+
+void SpatialIndex::QueryFrustum(const FrustumCulling::FrustumPlanes& frustum, std::vector<ObjectId>& result) const
+{
+    if (m_root != InvalidIndex)
+    {
+        QueryFrustum(m_root, frustum, false, result);
+    }
+}
+
+void SpatialIndex::QueryDistance(const float3& point, float distance, std::vector<ObjectId>& result) const
+{
+    if (m_root != InvalidIndex)
+    {
+        QueryDistance(m_root, point, distance, result);
+    }
+}
+
+bool SpatialIndex::Fits(const Node& node, const FrustumCulling::CullingSphere& bounds)
+{
+    // An object whose center is in the cell and which is not larger than half the cell is inside the loose bounds.
+    const float3 offset = bounds.center - node.center;
+    return bounds.radius <= node.halfSize && std::abs(offset.x) <= node.halfSize && std::abs(offset.y) <= node.halfSize &&
+           std::abs(offset.z) <= node.halfSize;
+}
+
+bool SpatialIndex::FitsChild(const Node& node, const FrustumCulling::CullingSphere& bounds) const
+{
+    return node.halfSize >= m_minCellSize && bounds.radius <= 0.5f * node.halfSize;
+}
+
+uint32_t SpatialIndex::GetOctant(const float3& center, const float3& point)
+{
+    return (point.x >= center.x ? 1u : 0u) | (point.y >= center.y ? 2u : 0u) | (point.z >= center.z ? 4u : 0u);
+}
+
+void SpatialIndex::Insert(ObjectId id, const FrustumCulling::CullingSphere& bounds)
+{
+    if (m_root == InvalidIndex)
+    {
+        // The first object gets the smallest cell which holds it, the root grows with the scene.
+        float halfSize = 0.5f * m_minCellSize;
+        while (halfSize < bounds.radius)
+        {
+            halfSize *= 2.0f;
+        }
+        m_root = AllocateNode(bounds.center, halfSize, InvalidIndex);
+    }
+
+    while (!Fits(m_nodes[m_root], bounds))
+    {
+        GrowRoot(bounds.center);
+    }
+
+    uint32_t nodeIndex = m_root;
+    while (FitsChild(m_nodes[nodeIndex], bounds))
+    {
+        const uint32_t octant = GetOctant(m_nodes[nodeIndex].center, bounds.center);
+        uint32_t child = m_nodes[nodeIndex].children[octant];
+        if (child == InvalidIndex)
+        {
+            const float childHalfSize = 0.5f * m_nodes[nodeIndex].halfSize;
+            const float3 childOffset(
+                (octant & 1) ? childHalfSize : -childHalfSize,
+                (octant & 2) ? childHalfSize : -childHalfSize,
+                (octant & 4) ? childHalfSize : -childHalfSize);
+
+            // Allocating may move the nodes, so the parent is looked up again afterwards.
+            child = AllocateNode(m_nodes[nodeIndex].center + childOffset, childHalfSize, nodeIndex);
+            m_nodes[nodeIndex].children[octant] = child;
+        }
+        nodeIndex = child;
+    }
+
+    Node& node = m_nodes[nodeIndex];
+    if (id >= m_locations.size())
+    {
+        m_locations.resize(id + 1);
+    }
+    m_locations[id] = {nodeIndex, static_cast<uint32_t>(node.objects.size())};
+    node.objects.push_back(id);
+    node.bounds.push_back(bounds);
+
+    for (; nodeIndex != InvalidIndex; nodeIndex = m_nodes[nodeIndex].parent)
+    {
+        m_nodes[nodeIndex].subtreeObjectCount++;
+    }
+}
+
+void SpatialIndex::GrowRoot(const float3& point)
+{
+    const float3 oldCenter = m_nodes[m_root].center;
+    const float oldHalfSize = m_nodes[m_root].halfSize;
+
+    // The old root becomes the child of the new root on the side away from the point.
+    const float3 offset(
+        point.x >= oldCenter.x ? oldHalfSize : -oldHalfSize,
+        point.y >= oldCenter.y ? oldHalfSize : -oldHalfSize,
+        point.z >= oldCenter.z ? oldHalfSize : -oldHalfSize);
+    const float3 center = oldCenter + offset;
+
+    const uint32_t oldRoot = m_root;
+    m_root = AllocateNode(center, 2.0f * oldHalfSize, InvalidIndex);
+    m_nodes[m_root].children[GetOctant(center, oldCenter)] = oldRoot;
+    m_nodes[m_root].subtreeObjectCount = m_nodes[oldRoot].subtreeObjectCount;
+    m_nodes[oldRoot].parent = m_root;
+}
+
+uint32_t SpatialIndex::AllocateNode(const float3& center, float halfSize, uint32_t parent)
+{
+    uint32_t nodeIndex;
+    if (!m_freeNodes.empty())
+    {
+        nodeIndex = m_freeNodes.back();
+        m_freeNodes.pop_back();
+    }
+    else
+    {
+        nodeIndex = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.emplace_back();
+    }
+
+    // Released nodes keep the capacity of their arrays.
+    Node& node = m_nodes[nodeIndex];
+    node.center = center;
+    node.halfSize = halfSize;
+    node.parent = parent;
+    std::fill(std::begin(node.children), std::end(node.children), InvalidIndex);
+    node.subtreeObjectCount = 0;
+    return nodeIndex;
+}
+
+void SpatialIndex::ReleaseSubtree(uint32_t nodeIndex)
+{
+    for (uint32_t child : m_nodes[nodeIndex].children)
+    {
+        if (child != InvalidIndex)
+        {
+            ReleaseSubtree(child);
+        }
+    }
+
+    Node& node = m_nodes[nodeIndex];
+    node.bounds.clear();
+    node.objects.clear();
+    m_freeNodes.push_back(nodeIndex);
+}
+
+void SpatialIndex::QueryFrustum(
+    uint32_t nodeIndex, const FrustumCulling::FrustumPlanes& frustum, bool inside, std::vector<ObjectId>& result) const
+{
+    const Node& node = m_nodes[nodeIndex];
+    if (node.subtreeObjectCount == 0)
+    {
+        return;
+    }
+
+    // Once a node is inside of the frustum, so are all objects below it.
+    if (!inside)
+    {
+        const float looseExtent = 2.0f * node.halfSize;
+        const FrustumCulling::Containment containment =
+            frustum.ClassifyBox({node.center, float3(looseExtent, looseExtent, looseExtent)});
+        if (containment == FrustumCulling::Containment::Outside)
+        {
+            return;
+        }
+        inside = containment == FrustumCulling::Containment::Inside;
+    }
+
+    if (inside)
+    {
+        result.insert(result.end(), node.objects.begin(), node.objects.end());
+    }
+    else if (!node.objects.empty())
+    {
+        frustum.CullSpheres(node.bounds, m_visibility);
+        for (size_t i = 0; i < node.objects.size(); ++i)
+        {
+            if (FrustumCulling::IsVisible(m_visibility, i))
+            {
+                result.push_back(node.objects[i]);
+            }
+        }
+    }
+
+    for (uint32_t child : node.children)
+    {
+        if (child != InvalidIndex)
+        {
+            QueryFrustum(child, frustum, inside, result);
+        }
+    }
+}
+
+void SpatialIndex::QueryDistance(uint32_t nodeIndex, const float3& point, float distance, std::vector<ObjectId>& result) const
+{
+    const Node& node = m_nodes[nodeIndex];
+    if (node.subtreeObjectCount == 0)
+    {
+        return;
+    }
+
+    // Distance of the point to the loose bounds of the node, zero inside of them.
+    const float looseExtent = 2.0f * node.halfSize;
+    const float offsetX = std::max(std::abs(point.x - node.center.x) - looseExtent, 0.0f);
+    const float offsetY = std::max(std::abs(point.y - node.center.y) - looseExtent, 0.0f);
+    const float offsetZ = std::max(std::abs(point.z - node.center.z) - looseExtent, 0.0f);
+    if (offsetX * offsetX + offsetY * offsetY + offsetZ * offsetZ > distance * distance)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < node.objects.size(); ++i)
+    {
+        const FrustumCulling::CullingSphere& bounds = node.bounds[i];
+        if (length(bounds.center - point) <= distance + bounds.radius)
+        {
+            result.push_back(node.objects[i]);
+        }
+    }
+
+    for (uint32_t child : node.children)
+    {
+        if (child != InvalidIndex)
+        {
+            QueryDistance(child, point, distance, result);
+        }
+    }
+}
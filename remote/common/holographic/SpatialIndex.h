@@ -0,0 +1,102 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#pragma once
+
+#include <holographic/FrustumCulling.h>
+
+#include <cstdint>
+#include <vector>
+
+// A loose octree of bounding spheres, so that frustum and distance queries only visit the part of a large scene near the query
+// instead of every object. The cells of the nodes are loose, their bounds extend twice as far as the cell, so an object is stored
+// by its center in the smallest node at least as large as the object and never straddles nodes. An object which moves within its
+// cell only has its bounds replaced, so objects can be moved every frame. The root grows towards objects outside of it, the scene
+// needs no extent up front.
+// Objects are identified by dense ids chosen by the caller, like their index in the arrays of the caller. Not thread safe.
+class SpatialIndex
+{
+public:
+    using ObjectId = uint32_t;
+
+    // The cells are never smaller than minCellSize, which bounds the depth of the tree for small objects.
+    explicit SpatialIndex(float minCellSize = 0.25f);
+
+    // Adds the object, or moves it if it is part of the index already.
+    void Update(ObjectId id, const FrustumCulling::CullingSphere& bounds);
+    void Remove(ObjectId id);
+    void Clear();
+
+    // Appends the objects whose bounds intersect the frustum. Without a culling frustum all objects are appended.
+    void QueryFrustum(const FrustumCulling::FrustumPlanes& frustum, std::vector<ObjectId>& result) const;
+
+    // Appends the objects whose bounds are within the distance of the point.
+    void QueryDistance(const winrt::Windows::Foundation::Numerics::float3& point, float distance, std::vector<ObjectId>& result) const;
+
+private:
+    static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+    struct Node
+    {
+        winrt::Windows::Foundation::Numerics::float3 center = {};
+        // Half the edge length of the cell.
+        float halfSize = 0.0f;
+        uint32_t parent = InvalidIndex;
+        // Indexed by octant, bit 0 is set for the positive x half of the cell, bit 1 for y and bit 2 for z.
+        uint32_t children[8] = {
+            InvalidIndex, InvalidIndex, InvalidIndex, InvalidIndex, InvalidIndex, InvalidIndex, InvalidIndex, InvalidIndex};
+        // Objects of the node and all its descendants, empty subtrees are released.
+        uint32_t subtreeObjectCount = 0;
+
+        // The objects of the node, their bounds are kept apart so they can be culled four at a time.
+        std::vector<FrustumCulling::CullingSphere> bounds;
+        std::vector<ObjectId> objects;
+    };
+
+    struct ObjectLocation
+    {
+        uint32_t node = InvalidIndex;
+        uint32_t slot = 0;
+    };
+
+    // True if the object belongs to the cell of the node or one of its descendants.
+    static bool Fits(const Node& node, const FrustumCulling::CullingSphere& bounds);
+    // True if the object belongs to a child of the node instead of the node itself.
+    bool FitsChild(const Node& node, const FrustumCulling::CullingSphere& bounds) const;
+    static uint32_t GetOctant(
+        const winrt::Windows::Foundation::Numerics::float3& center, const winrt::Windows::Foundation::Numerics::float3& point);
+
+    void Insert(ObjectId id, const FrustumCulling::CullingSphere& bounds);
+
+    // Replaces the root by one twice as large which extends towards the point.
+    void GrowRoot(const winrt::Windows::Foundation::Numerics::float3& point);
+
+    uint32_t AllocateNode(const winrt::Windows::Foundation::Numerics::float3& center, float halfSize, uint32_t parent);
+    void ReleaseSubtree(uint32_t nodeIndex);
+
+    void QueryFrustum(
+        uint32_t nodeIndex, const FrustumCulling::FrustumPlanes& frustum, bool inside, std::vector<ObjectId>& result) const;
+    void QueryDistance(
+        uint32_t nodeIndex, const winrt::Windows::Foundation::Numerics::float3& point, float distance, std::vector<ObjectId>& result) const;
+
+    const float m_minCellSize;
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_freeNodes;
+    uint32_t m_root = InvalidIndex;
+
+    // Indexed by object id.
+    std::vector<ObjectLocation> m_locations;
+
+    // Reused by the frustum queries.
+    mutable FrustumCulling::VisibilityMask m_visibility;
+};
@@ -39,8 +39,7 @@ SpatialInputHandler::SpatialInputHandler(winrt::Windows::UI::Input::Spatial::Spa
                                                     winrt::Windows::UI::Input::Spatial::SpatialTappedEventArgs>(
         [this](
             winrt::Windows::UI::Input::Spatial::SpatialGestureRecognizer, winrt::Windows::UI::Input::Spatial::SpatialTappedEventArgs args) {
-            std::lock_guard _lg(m_manipulationStateLock);
-            m_tapped = args;
+            m_events.Push({InputEventType::Tapped, args});
         }));
 
     m_manipulationStartedEventToken =
@@ -50,8 +49,7 @@ SpatialInputHandler::SpatialInputHandler(winrt::Windows::UI::Input::Spatial::Spa
             [this](
                 winrt::Windows::UI::Input::Spatial::SpatialGestureRecognizer,
                 winrt::Windows::UI::Input::Spatial::SpatialManipulationStartedEventArgs args) {
-                std::lock_guard _lg(m_manipulationStateLock);
-                m_manipulationStarted = args;
+                m_events.Push({InputEventType::ManipulationStarted, nullptr, args});
             }));
 
     m_manipulationUpdatedEventToken =
@@ -61,8 +59,7 @@ SpatialInputHandler::SpatialInputHandler(winrt::Windows::UI::Input::Spatial::Spa
             [this](
                 winrt::Windows::UI::Input::Spatial::SpatialGestureRecognizer,
                 winrt::Windows::UI::Input::Spatial::SpatialManipulationUpdatedEventArgs args) {
-                std::lock_guard _lg(m_manipulationStateLock);
-                m_manipulationUpdated = args;
+                m_events.Push({InputEventType::ManipulationUpdated, nullptr, nullptr, args});
             }));
 
     m_manipulationCompletedEventToken =
@@ -72,8 +69,7 @@ SpatialInputHandler::SpatialInputHandler(winrt::Windows::UI::Input::Spatial::Spa
             [this](
                 winrt::Windows::UI::Input::Spatial::SpatialGestureRecognizer,
                 winrt::Windows::UI::Input::Spatial::SpatialManipulationCompletedEventArgs) {
-                std::lock_guard _lg(m_manipulationStateLock);
-                m_manipulationResult = ManipulationResult::Completed;
+                m_events.Push({InputEventType::ManipulationCompleted});
             }));
 
     m_manipulationCanceledEventToken =
@@ -83,8 +79,7 @@ SpatialInputHandler::SpatialInputHandler(winrt::Windows::UI::Input::Spatial::Spa
             [this](
                 winrt::Windows::UI::Input::Spatial::SpatialGestureRecognizer,
                 winrt::Windows::UI::Input::Spatial::SpatialManipulationCanceledEventArgs) {
-                std::lock_guard _lg(m_manipulationStateLock);
-                m_manipulationResult = ManipulationResult::Canceled;
+                m_events.Push({InputEventType::ManipulationCanceled});
             }));
 
     m_navigationStartedEventToken =
@@ -153,38 +148,3 @@ SpatialInputHandler::~SpatialInputHandler()
     m_gestureRecognizer.ManipulationCompleted(m_manipulationCompletedEventToken);
     m_gestureRecognizer.ManipulationCanceled(m_manipulationCanceledEventToken);
 }
-
-// Checks if the user performed an input gesture since the last call to this method.
-// Allows the main update loop to check for asynchronous changes to the user
-// input state.
-winrt::Windows::UI::Input::Spatial::SpatialTappedEventArgs SpatialInputHandler::CheckForTapped()
-{
-    std::lock_guard _lg(m_manipulationStateLock);
-    auto tapped = m_tapped;
-    m_tapped = nullptr;
-    return tapped;
-}
-
-winrt::Windows::UI::Input::Spatial::SpatialManipulationStartedEventArgs SpatialInputHandler::CheckForManipulationStarted()
-{
-    std::lock_guard _lg(m_manipulationStateLock);
-    auto manipulationStarted = m_manipulationStarted;
-    m_manipulationStarted = nullptr;
-    return manipulationStarted;
-}
-
-winrt::Windows::UI::Input::Spatial::SpatialManipulationUpdatedEventArgs SpatialInputHandler::CheckForManipulationUpdated()
-{
-    std::lock_guard _lg(m_manipulationStateLock);
-    auto manipulationUpdated = m_manipulationUpdated;
-    m_manipulationUpdated = nullptr;
-    return manipulationUpdated;
-}
-
-SpatialInputHandler::ManipulationResult SpatialInputHandler::CheckForManipulationResult()
-{
-    std::lock_guard _lg(m_manipulationStateLock);
-    auto manipulationResult = m_manipulationResult;
-    m_manipulationResult = ManipulationResult::Unknown;
-    return manipulationResult;
-}
@@ -10,29 +10,46 @@
 //*********************************************************
 
 #pragma once
-#include <mutex>
-#include <vector>
+
+#include <Utils.h>
+
 #include <winrt/Windows.UI.Input.Spatial.h>
 
+#include <utility>
+
 // Sample gesture handler.
-// Hooks up events to recognize a tap gesture, and keeps track of input using a boolean value.
+// Hooks up events to recognize tap and manipulation gestures, and queues them for the update loop.
 class SpatialInputHandler
 {
 public:
     SpatialInputHandler(winrt::Windows::UI::Input::Spatial::SpatialInteractionManager interactionManager);
     ~SpatialInputHandler();
 
-    enum class ManipulationResult
+    enum class InputEventType
+    {
+        Tapped,
+        ManipulationStarted,
+        ManipulationUpdated,
+        ManipulationCompleted,
+        ManipulationCanceled,
+    };
+
+    // A recognized gesture. Only the event args matching the type are set.
+    struct InputEvent
     {
-        Unknown = 0,
-        Completed,
-        Canceled,
+        InputEventType type;
+        winrt::Windows::UI::Input::Spatial::SpatialTappedEventArgs tapped = nullptr;
+        winrt::Windows::UI::Input::Spatial::SpatialManipulationStartedEventArgs manipulationStarted = nullptr;
+        winrt::Windows::UI::Input::Spatial::SpatialManipulationUpdatedEventArgs manipulationUpdated = nullptr;
     };
 
-    winrt::Windows::UI::Input::Spatial::SpatialTappedEventArgs CheckForTapped();
-    winrt::Windows::UI::Input::Spatial::SpatialManipulationStartedEventArgs CheckForManipulationStarted();
-    winrt::Windows::UI::Input::Spatial::SpatialManipulationUpdatedEventArgs CheckForManipulationUpdated();
-    ManipulationResult CheckForManipulationResult();
+    // Invokes callback with each gesture recognized since the last call, in the order in which they were recognized.
+    // Must only be called from the update loop.
+    template <typename Callback>
+    void DrainEvents(Callback&& callback)
+    {
+        m_events.Drain(std::forward<Callback>(callback));
+    }
 
 private:
     // API objects used to process gesture input, and generate gesture events.
@@ -52,11 +69,7 @@ private:
     winrt::event_token m_navigationCompletedEventToken;
     winrt::event_token m_navigationCanceledEventToken;
 
-    // Used to indicate that a Pressed input event was received this frame.
-    std::recursive_mutex m_manipulationStateLock;
-
-    winrt::Windows::UI::Input::Spatial::SpatialTappedEventArgs m_tapped = nullptr;
-    winrt::Windows::UI::Input::Spatial::SpatialManipulationStartedEventArgs m_manipulationStarted = nullptr;
-    winrt::Windows::UI::Input::Spatial::SpatialManipulationUpdatedEventArgs m_manipulationUpdated = nullptr;
-    ManipulationResult m_manipulationResult = ManipulationResult::Unknown;
+    // Pushed by the gesture event handlers without taking a lock, drained once per frame. Every event is kept, so a burst of
+    // gestures between two frames is not collapsed into the last one.
+    Utils::MpscQueue<InputEvent> m_events;
 };
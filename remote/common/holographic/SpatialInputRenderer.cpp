@@ -32,35 +32,172 @@ SpatialInputRenderer::SpatialInputRenderer(
     , m_interactionManager(interactionManager)
 {
     m_referenceFrame = winrt::Windows::Perception::Spatial::SpatialLocator::GetDefault().CreateAttachedFrameOfReferenceAtCurrentHeading();
+    m_jointResourcesCreated = CreateJointDeviceDependentResources();
+}
+
+std::future<void> SpatialInputRenderer::CreateDeviceDependentResources()
+{
+    co_await RenderableObject::CreateDeviceDependentResources();
+    co_await CreateJointDeviceDependentResources();
+}
+
+void SpatialInputRenderer::ReleaseDeviceDependentResources()
+{
+    RenderableObject::ReleaseDeviceDependentResources();
+
+    m_jointResourcesLoaded = false;
+    m_jointVertexShader = nullptr;
+    m_jointInputLayouts[0] = nullptr;
+    m_jointInputLayouts[1] = nullptr;
+    m_jointVertexBuffer = nullptr;
+    m_jointConstantBuffer = nullptr;
+    m_jointConstantBufferViewCount = 0;
+    m_vertexAllocation = {};
+    m_jointAllocation = {};
+}
+
+std::future<void> SpatialInputRenderer::CreateJointDeviceDependentResources()
+{
+    // The joint vertex shader outputs the same data as the SimpleColor vertex shaders, so the pass-through
+    // geometry shader and pixel shader set up by RenderableObject are reused.
+    std::wstring vertexShaderFileName = m_deviceResources->GetVertexShaderFileName(L"SimpleColor_JointVertexShader");
+
+    DXHelper::ShaderCache& shaderCache = m_deviceResources->GetShaderCache();
+    m_jointVertexShader = co_await shaderCache.GetVertexShaderAsync(vertexShaderFileName);
+    const DXHelper::ShaderCache::Bytecode vertexShaderBytecode = co_await shaderCache.GetBytecodeAsync(vertexShaderFileName);
+
+    // Each joint instance is drawn once per view, so the instance data step rate equals the view count.
+    for (UINT viewCount = 1; viewCount <= 2; ++viewCount)
+    {
+        const std::array<D3D11_INPUT_ELEMENT_DESC, 5> vertexDesc = {{
+            {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+            {"COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
+            {"JOINTPOSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, viewCount},
+            {"JOINTORIENTATION", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 12, D3D11_INPUT_PER_INSTANCE_DATA, viewCount},
+            {"JOINTSIZE", 0, DXGI_FORMAT_R32G32_FLOAT, 1, 28, D3D11_INPUT_PER_INSTANCE_DATA, viewCount},
+        }};
+
+        winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateInputLayout(
+            vertexDesc.data(),
+            static_cast<UINT>(vertexDesc.size()),
+            vertexShaderBytecode.data(),
+            static_cast<UINT>(vertexShaderBytecode.size()),
+            m_jointInputLayouts[viewCount - 1].put()));
+    }
+
+    // The unit joint mesh. The vertex shader scales x and y by the joint radius and maps z to the
+    // base (0), the center ring (1) or the tip (2) of the joint.
+    {
+        using namespace DirectX;
+
+        const XMFLOAT3 baseVertexPosition(0.0f, 0.0f, 0.0f);
+        const XMFLOAT3 centerVertexPositions[4] = {
+            XMFLOAT3(-1.0f, -1.0f, 1.0f),
+            XMFLOAT3(-1.0f, +1.0f, 1.0f),
+            XMFLOAT3(+1.0f, +1.0f, 1.0f),
+            XMFLOAT3(+1.0f, -1.0f, 1.0f),
+        };
+        const XMFLOAT3 topVertexPosition(0.0f, 0.0f, 2.0f);
+
+        std::vector<VertexPositionColor> vertices;
+        AppendColoredTriangle(baseVertexPosition, centerVertexPositions[0], centerVertexPositions[1], XMFLOAT3(0.0f, 0.0f, 0.4f), vertices);
+        AppendColoredTriangle(baseVertexPosition, centerVertexPositions[1], centerVertexPositions[2], XMFLOAT3(0.0f, 0.4f, 0.0f), vertices);
+        AppendColoredTriangle(baseVertexPosition, centerVertexPositions[2], centerVertexPositions[3], XMFLOAT3(0.4f, 0.0f, 0.0f), vertices);
+        AppendColoredTriangle(baseVertexPosition, centerVertexPositions[3], centerVertexPositions[0], XMFLOAT3(0.4f, 0.4f, 0.0f), vertices);
+        AppendColoredTriangle(topVertexPosition, centerVertexPositions[1], centerVertexPositions[0], XMFLOAT3(0.0f, 0.0f, 0.6f), vertices);
+        AppendColoredTriangle(topVertexPosition, centerVertexPositions[2], centerVertexPositions[1], XMFLOAT3(0.0f, 0.6f, 0.0f), vertices);
+        AppendColoredTriangle(topVertexPosition, centerVertexPositions[3], centerVertexPositions[2], XMFLOAT3(0.6f, 0.0f, 0.0f), vertices);
+        AppendColoredTriangle(topVertexPosition, centerVertexPositions[0], centerVertexPositions[3], XMFLOAT3(0.6f, 0.6f, 0.0f), vertices);
+
+        m_jointVertexCount = static_cast<UINT>(vertices.size());
+
+        D3D11_SUBRESOURCE_DATA vertexBufferData = {0};
+        vertexBufferData.pSysMem = vertices.data();
+        const CD3D11_BUFFER_DESC vertexBufferDesc(
+            static_cast<UINT>(vertices.size() * sizeof(VertexPositionColor)), D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_IMMUTABLE);
+        winrt::check_hresult(
+            m_deviceResources->GetD3DDevice()->CreateBuffer(&vertexBufferDesc, &vertexBufferData, m_jointVertexBuffer.put()));
+    }
+
+    // Constant buffers must be a multiple of 16 bytes.
+    const CD3D11_BUFFER_DESC jointConstantBufferDesc(4 * sizeof(UINT), D3D11_BIND_CONSTANT_BUFFER);
+    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(&jointConstantBufferDesc, nullptr, m_jointConstantBuffer.put()));
+    m_jointConstantBufferViewCount = 0;
+
+    m_jointResourcesLoaded = true;
 }
 
 void SpatialInputRenderer::Update(
     winrt::Windows::Perception::PerceptionTimestamp timestamp,
     winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem)
 {
-    m_transforms.clear();
+    SamplePoses(timestamp, renderingCoordinateSystem, true);
+    BuildVertices();
+    UploadVertices();
+}
+
+void SpatialInputRenderer::UpdatePoses(
+    winrt::Windows::Perception::PerceptionTimestamp timestamp,
+    winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem)
+{
+    const size_t transformCount = m_transforms.size();
+    const size_t jointCount = m_joints.size();
+
+    SamplePoses(timestamp, renderingCoordinateSystem, false);
+    BuildVertices();
+
+    // A source which appeared or was lost since Update changes the sizes, which then need new allocations.
+    bool overwritten = false;
+    if (m_transforms.size() == transformCount && m_joints.size() == jointCount)
+    {
+        m_deviceResources->UseImmediateD3DDeviceContext([&](auto context) {
+            DXHelper::VertexRingBuffer& ringBuffer = m_deviceResources->GetVertexRingBuffer();
+            overwritten = (m_vertices.empty() || ringBuffer.Overwrite(context, m_vertexAllocation, m_vertices)) &&
+                          (m_joints.empty() || ringBuffer.Overwrite(context, m_jointAllocation, m_joints));
+        });
+    }
+
+    if (!overwritten)
+    {
+        UploadVertices();
+    }
+}
+
+void SpatialInputRenderer::SamplePoses(
+    winrt::Windows::Perception::PerceptionTimestamp timestamp,
+    winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem,
+    bool sampleGaze)
+{
+    // The gaze transform comes first, it is kept if the gaze is not sampled again.
+    m_transforms.resize(sampleGaze ? 0 : m_gazeTransformCount);
     m_joints.clear();
 
     auto coordinateSystem = m_referenceFrame.GetStationaryCoordinateSystemAtTimestamp(timestamp);
 
-    auto spatialPointerPose = winrt::Windows::UI::Input::Spatial::SpatialPointerPose::TryGetAtTimestamp(coordinateSystem, timestamp);
-    if (spatialPointerPose)
+    if (sampleGaze)
     {
-        if (auto eyesPose = spatialPointerPose.Eyes())
+        m_gazeTransformCount = 0;
+
+        auto spatialPointerPose = winrt::Windows::UI::Input::Spatial::SpatialPointerPose::TryGetAtTimestamp(coordinateSystem, timestamp);
+        if (spatialPointerPose)
         {
-            if (auto gaze = eyesPose.Gaze())
+            if (auto eyesPose = spatialPointerPose.Eyes())
             {
-                float3 position = gaze.Value().Origin + gaze.Value().Direction;
-                float4x4 transform =
-                    make_float4x4_billboard(position, gaze.Value().Origin, float3(0.0f, 1.0f, 0.0f), gaze.Value().Direction);
-                m_transforms.emplace_back(QTransform(transform));
+                if (auto gaze = eyesPose.Gaze())
+                {
+                    float3 position = gaze.Value().Origin + gaze.Value().Direction;
+                    float4x4 transform =
+                        make_float4x4_billboard(position, gaze.Value().Origin, float3(0.0f, 1.0f, 0.0f), gaze.Value().Direction);
+                    m_transforms.emplace_back(QTransform(transform));
+                    m_gazeTransformCount = 1;
+                }
             }
         }
     }
 
     auto states = m_interactionManager.GetDetectedSourcesAtTimestamp(timestamp);
 
-    m_transforms.reserve(states.Size());
+    m_transforms.reserve(m_transforms.size() + states.Size());
 
     for (const auto& state : states)
     {
@@ -147,9 +284,54 @@ void SpatialInputRenderer::Update(
     }
 }
 
-void SpatialInputRenderer::Draw(unsigned int numInstances, winrt::Windows::Foundation::IReference<SpatialBoundingFrustum> cullingFrustum)
+PerceptionRecording::SpatialInput SpatialInputRenderer::GetSpatialInput() const
+{
+    PerceptionRecording::SpatialInput spatialInput;
+    spatialInput.modelTransform = m_modelTransform;
+
+    spatialInput.transforms.reserve(m_transforms.size());
+    for (const QTransform& transform : m_transforms)
+    {
+        PerceptionRecording::Pose& pose = spatialInput.transforms.emplace_back();
+        DirectX::XMStoreFloat3(reinterpret_cast<DirectX::XMFLOAT3*>(&pose.position), transform.m_position);
+        DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*>(&pose.orientation), transform.m_orientation);
+    }
+
+    spatialInput.joints.reserve(m_joints.size());
+    for (const Joint& joint : m_joints)
+    {
+        spatialInput.joints.push_back({{joint.position, joint.orientation}, joint.length, joint.radius});
+    }
+
+    return spatialInput;
+}
+
+void SpatialInputRenderer::ReplaySpatialInput(const PerceptionRecording::SpatialInput& spatialInput)
+{
+    m_transforms.clear();
+    m_gazeTransformCount = 0;
+    for (const PerceptionRecording::Pose& pose : spatialInput.transforms)
+    {
+        m_transforms.emplace_back(pose.position, pose.orientation);
+    }
+
+    m_joints.clear();
+    for (const PerceptionRecording::Joint& joint : spatialInput.joints)
+    {
+        m_joints.push_back({joint.pose.position, joint.pose.orientation, joint.length, joint.radius});
+    }
+
+    m_modelTransform = spatialInput.modelTransform;
+    UpdateModelConstantBuffer(m_modelTransform);
+
+    BuildVertices();
+    UploadVertices();
+}
+
+void SpatialInputRenderer::BuildVertices()
 {
-    std::vector<VertexPositionNormalColor> vertices;
+    m_vertices.clear();
+    m_jointBounds.clear();
 
     for (const auto& transform : m_transforms)
     {
@@ -161,20 +343,7 @@ void SpatialInputRenderer::Draw(unsigned int numInstances, winrt::Windows::Found
             transform.TransformPosition(trianglePositions[1]),
             transform.TransformPosition(trianglePositions[2]),
             DirectX::XMFLOAT3{0, 0, 1},
-            vertices);
-    }
-
-    for (const auto& joint : m_joints)
-    {
-        // Frustum culling
-        QTransform jointTransform = QTransform(joint.position, joint.orientation);
-        float3 jointCenter = joint.position + (0.5f * jointTransform.TransformPosition(float3(0.0f, 0.0f, -joint.length)));
-        float jointCullingRadius = std::max<float>(joint.radius, joint.length / 2.0f);
-        if (FrustumCulling::SphereInFrustum(transform(jointCenter, m_modelTransform), jointCullingRadius, cullingFrustum))
-        {
-            auto jointVertices = CalculateJointVisualizationVertices(joint.position, joint.orientation, joint.length, joint.radius);
-            vertices.insert(vertices.end(), jointVertices.begin(), jointVertices.end());
-        }
+            m_vertices);
     }
 
     for (const auto& coloredTransform : m_coloredTransforms)
@@ -192,62 +361,96 @@ void SpatialInputRenderer::Draw(unsigned int numInstances, winrt::Windows::Found
         }
 
         AppendColoredTriangle(
-            transformedPositions[0], transformedPositions[1], transformedPositions[2], coloredTransform.m_color, vertices);
+            transformedPositions[0], transformedPositions[1], transformedPositions[2], coloredTransform.m_color, m_vertices);
         AppendColoredTriangle(
-            transformedPositions[2], transformedPositions[3], transformedPositions[0], coloredTransform.m_color, vertices);
+            transformedPositions[2], transformedPositions[3], transformedPositions[0], coloredTransform.m_color, m_vertices);
     }
 
-    if (!vertices.empty())
+    for (const auto& joint : m_joints)
     {
-        const UINT stride = sizeof(vertices[0]);
-        const UINT offset = 0;
-        D3D11_SUBRESOURCE_DATA vertexBufferData = {0};
-        vertexBufferData.pSysMem = vertices.data();
-        const CD3D11_BUFFER_DESC vertexBufferDesc(static_cast<UINT>(vertices.size() * stride), D3D11_BIND_VERTEX_BUFFER);
-        winrt::com_ptr<ID3D11Buffer> vertexBuffer;
-        winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(&vertexBufferDesc, &vertexBufferData, vertexBuffer.put()));
-
-        m_deviceResources->UseD3DDeviceContext([&](auto context) {
-            context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-            ID3D11Buffer* pBuffer = vertexBuffer.get();
-            context->IASetVertexBuffers(0, 1, &pBuffer, &stride, &offset);
-            context->DrawInstanced(static_cast<UINT>(vertices.size()), numInstances, offset, 0);
-        });
+        // Bounding sphere used for frustum culling in Draw.
+        QTransform jointTransform = QTransform(joint.position, joint.orientation);
+        float3 jointCenter = joint.position + (0.5f * jointTransform.TransformPosition(float3(0.0f, 0.0f, -joint.length)));
+        float jointCullingRadius = std::max<float>(joint.radius, joint.length / 2.0f);
+        m_jointBounds.push_back({transform(jointCenter, m_modelTransform), jointCullingRadius});
     }
 }
 
-std::vector<VertexPositionNormalColor> SpatialInputRenderer::CalculateJointVisualizationVertices(
-    float3 jointPosition, quaternion jointOrientation, float jointLength, float jointRadius)
+void SpatialInputRenderer::UploadVertices()
 {
-    using namespace DirectX;
-
-    constexpr const size_t verticesCount = 2 * 4 * 3;
-    std::vector<VertexPositionNormalColor> vertices;
-    vertices.reserve(verticesCount);
-
-    float centerHeight = std::min<float>(jointRadius, 0.5f * jointLength);
-    float centerXandY = jointRadius / sqrtf(2.0f);
-
-    QTransform jointTransform = QTransform(jointPosition, jointOrientation);
-
-    XMFLOAT3 baseVertexPosition = jointTransform.TransformPosition(XMFLOAT3(0.0f, 0.0f, 0.0f));
-    XMFLOAT3 centerVertexPositions[4] = {
-        jointTransform.TransformPosition(XMFLOAT3(-centerXandY, -centerXandY, -centerHeight)),
-        jointTransform.TransformPosition(XMFLOAT3(-centerXandY, +centerXandY, -centerHeight)),
-        jointTransform.TransformPosition(XMFLOAT3(+centerXandY, +centerXandY, -centerHeight)),
-        jointTransform.TransformPosition(XMFLOAT3(+centerXandY, -centerXandY, -centerHeight)),
-    };
-    XMFLOAT3 topVertexPosition = jointTransform.TransformPosition(XMFLOAT3(0.0f, 0.0f, -jointLength));
-
-    AppendColoredTriangle(baseVertexPosition, centerVertexPositions[0], centerVertexPositions[1], XMFLOAT3(0.0f, 0.0f, 0.4f), vertices);
-    AppendColoredTriangle(baseVertexPosition, centerVertexPositions[1], centerVertexPositions[2], XMFLOAT3(0.0f, 0.4f, 0.0f), vertices);
-    AppendColoredTriangle(baseVertexPosition, centerVertexPositions[2], centerVertexPositions[3], XMFLOAT3(0.4f, 0.0f, 0.0f), vertices);
-    AppendColoredTriangle(baseVertexPosition, centerVertexPositions[3], centerVertexPositions[0], XMFLOAT3(0.4f, 0.4f, 0.0f), vertices);
-    AppendColoredTriangle(topVertexPosition, centerVertexPositions[1], centerVertexPositions[0], XMFLOAT3(0.0f, 0.0f, 0.6f), vertices);
-    AppendColoredTriangle(topVertexPosition, centerVertexPositions[2], centerVertexPositions[1], XMFLOAT3(0.0f, 0.6f, 0.0f), vertices);
-    AppendColoredTriangle(topVertexPosition, centerVertexPositions[3], centerVertexPositions[2], XMFLOAT3(0.6f, 0.0f, 0.0f), vertices);
-    AppendColoredTriangle(topVertexPosition, centerVertexPositions[0], centerVertexPositions[3], XMFLOAT3(0.6f, 0.6f, 0.0f), vertices);
-
-    return vertices;
+    m_deviceResources->UseImmediateD3DDeviceContext([&](auto context) {
+        m_vertexAllocation = m_deviceResources->GetVertexRingBuffer().Allocate(context, m_vertices);
+        m_jointAllocation = m_deviceResources->GetVertexRingBuffer().Allocate(context, m_joints);
+    });
+}
+
+void SpatialInputRenderer::Draw(
+    DXHelper::RenderQueue& renderQueue,
+    unsigned int numInstances,
+    winrt::Windows::Foundation::IReference<SpatialBoundingFrustum> cullingFrustum)
+{
+    m_deviceResources->UseD3DDeviceContext([&](auto context) {
+        if (m_vertexAllocation)
+        {
+            DXHelper::DrawPacket packet = CreateDrawPacket();
+            packet.vertexBuffers[0] = m_vertexAllocation.buffer;
+            packet.strides[0] = sizeof(VertexPositionColor);
+            packet.offsets[0] = m_vertexAllocation.offset;
+            packet.elementCount = static_cast<UINT>(m_vertices.size());
+            packet.instanceCount = numInstances;
+            renderQueue.Submit(std::move(packet));
+        }
+
+        if (!m_jointResourcesLoaded || !m_jointAllocation)
+        {
+            return;
+        }
+
+        // Frustum culling
+        FrustumCulling::FrustumPlanes(cullingFrustum).CullSpheres(m_jointBounds, m_jointVisibility);
+
+        const UINT viewCount = std::clamp<UINT>(numInstances, 1, 2);
+        if (m_jointConstantBufferViewCount != viewCount)
+        {
+            const UINT jointConstantBufferData[4] = {viewCount, 0, 0, 0};
+            context->UpdateSubresource(m_jointConstantBuffer.get(), 0, nullptr, jointConstantBufferData, 0, 0);
+            m_jointConstantBufferViewCount = viewCount;
+        }
+
+        // The joints of a hand are consecutive and mostly visible or culled together, so there are only a few runs. Each run is
+        // drawn from its offset into the shared instance data.
+        for (size_t runStart = 0; runStart < m_joints.size();)
+        {
+            if (!FrustumCulling::IsVisible(m_jointVisibility, runStart))
+            {
+                ++runStart;
+                continue;
+            }
+
+            size_t runEnd = runStart + 1;
+            while (runEnd < m_joints.size() && FrustumCulling::IsVisible(m_jointVisibility, runEnd))
+            {
+                ++runEnd;
+            }
+
+            // Only the input layout and the vertex shader differ from the SimpleColor pipeline. The geometry shader,
+            // pixel shader and the remaining constant buffers stay the same.
+            DXHelper::DrawPacket packet = CreateDrawPacket();
+            packet.pipeline.inputLayout = m_jointInputLayouts[viewCount - 1];
+            packet.pipeline.vertexShader = m_jointVertexShader;
+            packet.vertexShaderConstantBuffers[2] = m_jointConstantBuffer;
+
+            packet.vertexBuffers[0] = m_jointVertexBuffer;
+            packet.strides[0] = sizeof(VertexPositionColor);
+            packet.vertexBuffers[1] = m_jointAllocation.buffer;
+            packet.strides[1] = sizeof(Joint);
+            packet.offsets[1] = m_jointAllocation.offset + static_cast<UINT>(runStart * sizeof(Joint));
+
+            packet.elementCount = m_jointVertexCount;
+            packet.instanceCount = static_cast<UINT>(runEnd - runStart) * viewCount;
+            renderQueue.Submit(std::move(packet));
+
+            runStart = runEnd;
+        }
+    });
 }
@@ -11,6 +11,9 @@
 
 #pragma once
 
+#include <holographic/ContentDepthRange.h>
+#include <holographic/FrustumCulling.h>
+#include <holographic/PerceptionRecording.h>
 #include <holographic/RenderableObject.h>
 
 #include <vector>
@@ -75,11 +78,36 @@ public:
         const std::shared_ptr<DXHelper::DeviceResources>& deviceResources,
         winrt::Windows::UI::Input::Spatial::SpatialInteractionManager interactionManager);
 
+    std::future<void> CreateDeviceDependentResources() override;
+    void ReleaseDeviceDependentResources() override;
+
+    // Samples the eye gaze and the poses of all detected sources at the timestamp.
     void Update(
         winrt::Windows::Perception::PerceptionTimestamp timestamp,
         winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem);
 
+    // Locates the sources and their joints again at the timestamp of an updated prediction, right before rendering, and writes
+    // them over the instance data Update uploaded for the frame. The eye gaze is kept from Update. Must be called after Update and
+    // before the frame is rendered.
+    void UpdatePoses(
+        winrt::Windows::Perception::PerceptionTimestamp timestamp,
+        winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem);
+
+    // Returns the poses sampled by the last Update or UpdatePoses, for a perception recording.
+    PerceptionRecording::SpatialInput GetSpatialInput() const;
+
+    // Takes over recorded poses in place of Update, so the sources are drawn as they were recorded.
+    void ReplaySpatialInput(const PerceptionRecording::SpatialInput& spatialInput);
+
+    // Adds the bounds of the joints found by the last Update.
+    void AddBounds(ContentDepthRange& depthRange) const
+    {
+        depthRange.Add(m_jointBounds);
+    }
+
 private:
+    // Joints are drawn as instances of a unit joint mesh. The layout of this struct is used
+    // as per-instance vertex data by SimpleColor_JointVertexShader.
     struct Joint
     {
         float3 position;
@@ -87,6 +115,7 @@ private:
         float length;
         float radius;
     };
+    static_assert(sizeof(Joint) == 9 * sizeof(float), "Joint must be tightly packed to be used as per-instance vertex data.");
 
     struct ColoredTransform
     {
@@ -105,16 +134,54 @@ private:
     };
 
 private:
-    static std::vector<VertexPositionNormalColor>
-        CalculateJointVisualizationVertices(float3 jointPosition, quaternion jointOrientation, float jointLength, float jointRadius);
+    std::future<void> CreateJointDeviceDependentResources();
+
+    // Fills m_transforms and m_joints with the poses at the timestamp. Without sampleGaze, the gaze transform is kept.
+    void SamplePoses(
+        winrt::Windows::Perception::PerceptionTimestamp timestamp,
+        winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem,
+        bool sampleGaze);
 
-    void Draw(unsigned int numInstances, winrt::Windows::Foundation::IReference<SpatialBoundingFrustum> cullingFrustum) override;
+    // Builds the vertices for all transforms and the culling bounds of all joints.
+    void BuildVertices();
+
+    // Uploads the vertices and the joint instances to the vertex ring buffer.
+    void UploadVertices();
+
+    void Draw(
+        DXHelper::RenderQueue& renderQueue,
+        unsigned int numInstances,
+        winrt::Windows::Foundation::IReference<SpatialBoundingFrustum> cullingFrustum) override;
 
     winrt::Windows::UI::Input::Spatial::SpatialInteractionManager m_interactionManager{nullptr};
     winrt::Windows::Perception::Spatial::SpatialLocatorAttachedFrameOfReference m_referenceFrame{nullptr};
     std::vector<QTransform> m_transforms;
+    // 1 if m_transforms starts with the eye gaze transform.
+    size_t m_gazeTransformCount = 0;
     std::vector<Joint> m_joints;
     std::vector<ColoredTransform> m_coloredTransforms;
 
     winrt::Windows::Foundation::Numerics::float4x4 m_modelTransform;
+
+    // Vertices are built once per frame in Update and shared by all cameras.
+    std::vector<VertexPositionColor> m_vertices;
+    DXHelper::VertexRingBuffer::Allocation m_vertexAllocation;
+
+    // The instances of all joints, uploaded once per frame in Update and shared by all cameras. Each camera draws the runs of
+    // consecutive joints which passed its culling from it.
+    DXHelper::VertexRingBuffer::Allocation m_jointAllocation;
+
+    // Culling bounds for each entry in m_joints, and the joints which passed culling for the current camera.
+    std::vector<FrustumCulling::CullingSphere> m_jointBounds;
+    FrustumCulling::VisibilityMask m_jointVisibility;
+
+    // Direct3D resources for instanced joint rendering.
+    std::future<void> m_jointResourcesCreated;
+    std::atomic<bool> m_jointResourcesLoaded = false;
+    winrt::com_ptr<ID3D11VertexShader> m_jointVertexShader;
+    winrt::com_ptr<ID3D11InputLayout> m_jointInputLayouts[2]; // One per view count, the instance data step rate differs.
+    winrt::com_ptr<ID3D11Buffer> m_jointVertexBuffer;
+    winrt::com_ptr<ID3D11Buffer> m_jointConstantBuffer;
+    UINT m_jointVertexCount = 0;
+    UINT m_jointConstantBufferViewCount = 0;
 };
@@ -0,0 +1,69 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <pch.h>
+
+#include <holographic/SpatialTransformCache.h>
+
+using namespace winrt::Windows::Foundation::Numerics;
+using namespace winrt::Windows::Perception::Spatial;
+
+SpatialTransformCache::SpatialTransformCache()
+{
+    if (SpatialLocator locator = SpatialLocator::GetDefault())
+    {
+        m_locatabilityChangedRevoker = locator.LocatabilityChanged(
+            winrt::auto_revoke, [this](const SpatialLocator&, const winrt::Windows::Foundation::IInspectable&) { Invalidate(); });
+    }
+}
+
+void SpatialTransformCache::BeginFrame(const SpatialCoordinateSystem& renderingCoordinateSystem)
+{
+    m_frameIndex++;
+
+    if (m_invalidated.exchange(false) || renderingCoordinateSystem != m_renderingCoordinateSystem)
+    {
+        m_entries.clear();
+        m_renderingCoordinateSystem = renderingCoordinateSystem;
+        return;
+    }
+
+    // Drop the entries which were not used in the previous frame, which also releases coordinate systems that are no longer used.
+    for (auto it = m_entries.begin(); it != m_entries.end();)
+    {
+        it = it->second.frameIndex + 1 < m_frameIndex ? m_entries.erase(it) : std::next(it);
+    }
+}
+
+void SpatialTransformCache::Invalidate()
+{
+    m_invalidated = true;
+}
+
+winrt::Windows::Foundation::IReference<float4x4> SpatialTransformCache::TryGetTransform(const SpatialCoordinateSystem& coordinateSystem)
+{
+    if (!coordinateSystem || !m_renderingCoordinateSystem)
+    {
+        return nullptr;
+    }
+
+    Entry& entry = m_entries[winrt::get_abi(coordinateSystem)];
+
+    // Each coordinate system is located once per frame, also if it could not be located.
+    if (entry.frameIndex != m_frameIndex)
+    {
+        entry.coordinateSystem = coordinateSystem;
+        entry.transform = coordinateSystem.TryGetTransformTo(m_renderingCoordinateSystem);
+        entry.frameIndex = m_frameIndex;
+    }
+
+    return entry.transform;
+}
@@ -0,0 +1,59 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <winrt/Windows.Foundation.Numerics.h>
+#include <winrt/Windows.Perception.Spatial.h>
+
+#include <atomic>
+#include <unordered_map>
+
+// Caches the transforms from coordinate systems to the rendering coordinate system within a frame.
+// A coordinate system which is used by several objects is only located once per frame. Every frame locates the coordinate systems
+// anew, so anchors, QR codes and mesh parts which move are never drawn with the transform of an earlier frame. Entries of
+// coordinate systems which were not used in the previous frame are dropped, which releases the coordinate systems.
+// All cached transforms are dropped when the rendering coordinate system changes or when the locatability of the default
+// spatial locator changes. Apart from Invalidate, the cache must only be used from a single thread.
+class SpatialTransformCache
+{
+public:
+    SpatialTransformCache();
+
+    // Starts a new frame. Must be called before any transform is requested for the frame.
+    void BeginFrame(const winrt::Windows::Perception::Spatial::SpatialCoordinateSystem& renderingCoordinateSystem);
+
+    // Drops all cached transforms. May be called from any thread; takes effect with the next BeginFrame.
+    void Invalidate();
+
+    // Returns the transform from coordinateSystem to the rendering coordinate system, or null if it cannot be located.
+    winrt::Windows::Foundation::IReference<winrt::Windows::Foundation::Numerics::float4x4>
+        TryGetTransform(const winrt::Windows::Perception::Spatial::SpatialCoordinateSystem& coordinateSystem);
+
+private:
+    struct Entry
+    {
+        // Keeps the coordinate system alive, so that its address is not reused as a key by another coordinate system.
+        winrt::Windows::Perception::Spatial::SpatialCoordinateSystem coordinateSystem = nullptr;
+        winrt::Windows::Foundation::IReference<winrt::Windows::Foundation::Numerics::float4x4> transform = nullptr;
+        // The frame the transform was located in, 0 if it was never located.
+        uint64_t frameIndex = 0;
+    };
+
+    winrt::Windows::Perception::Spatial::SpatialCoordinateSystem m_renderingCoordinateSystem = nullptr;
+    uint64_t m_frameIndex = 0;
+
+    // Keyed by the ABI pointer of the coordinate system.
+    std::unordered_map<void*, Entry> m_entries;
+
+    std::atomic<bool> m_invalidated = false;
+    winrt::Windows::Perception::Spatial::SpatialLocator::LocatabilityChanged_revoker m_locatabilityChangedRevoker;
+};
@@ -18,6 +18,7 @@
 #include <winrt/Windows.Storage.h>
 
 #include <filesystem>
+#include <mutex>
 
 namespace
 {
@@ -41,8 +42,41 @@ namespace
         return rootFolder.GetFileAsync(speechGrammarFile);
 #endif
     }
+
+    std::mutex g_grammarFileMutex;
+    winrt::Windows::Storage::StorageFile g_grammarFile = nullptr;
+
+    // Looks up the grammar file once per process, the sessions of later connections reuse it.
+    winrt::Windows::Foundation::IAsyncOperation<winrt::Windows::Storage::StorageFile> GetGrammarFileAsync()
+    {
+        {
+            std::lock_guard lock(g_grammarFileMutex);
+            if (g_grammarFile)
+            {
+                co_return g_grammarFile;
+            }
+        }
+
+        auto grammarFile = co_await LoadGrammarFileAsync();
+
+        std::lock_guard lock(g_grammarFileMutex);
+        g_grammarFile = grammarFile;
+        co_return grammarFile;
+    }
 } // namespace
 
+winrt::fire_and_forget Speech::PreloadGrammarFileAsync()
+{
+    try
+    {
+        co_await GetGrammarFileAsync();
+    }
+    catch (const winrt::hresult_error&)
+    {
+        // Retried by InitializeSpeechAsync.
+    }
+}
+
 winrt::fire_and_forget Speech::InitializeSpeechAsync(
     winrt::Microsoft::Holographic::AppRemoting::IRemoteSpeech remoteSpeech,
     winrt::Microsoft::Holographic::AppRemoting::IRemoteSpeech::OnRecognizedSpeech_revoker& onRecognizedSpeechRevoker,
@@ -56,14 +90,9 @@ winrt::fire_and_forget Speech::InitializeSpeechAsync(
             }
         });
 
-    auto grammarFile = co_await LoadGrammarFileAsync();
+    auto grammarFile = co_await GetGrammarFileAsync();
 
-    std::vector<winrt::hstring> dictionary;
-    dictionary.push_back(L"Red");
-    dictionary.push_back(L"Blue");
-    dictionary.push_back(L"Green");
-    dictionary.push_back(L"Default");
-    dictionary.push_back(L"Aquamarine");
+    static const std::vector<winrt::hstring> dictionary = {L"Red", L"Blue", L"Green", L"Default", L"Aquamarine"};
 
     remoteSpeech.ApplyParameters(L"en-US", grammarFile, dictionary);
 }
@@ -23,6 +23,9 @@ namespace Speech
         virtual void OnRecognizedSpeech(const winrt::hstring& recognizedText) = 0;
     };
 
+    // Looks up the grammar file ahead of the first connection, so InitializeSpeechAsync can apply it right away.
+    winrt::fire_and_forget PreloadGrammarFileAsync();
+
     winrt::fire_and_forget InitializeSpeechAsync(
         winrt::Microsoft::Holographic::AppRemoting::IRemoteSpeech remoteSpeech,
         winrt::Microsoft::Holographic::AppRemoting::IRemoteSpeech::OnRecognizedSpeech_revoker& onRecognizedSpeechRevoker,
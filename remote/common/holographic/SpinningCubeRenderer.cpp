@@ -15,11 +15,13 @@
 
 #include <d3d11/DirectXHelper.h>
 #include <holographic/FrustumCulling.h>
+#include <holographic/RenderPath.h>
 
 #include <winrt/Windows.Perception.People.h>
 #include <winrt/Windows.Storage.Streams.h>
 
 using namespace DirectX;
+using namespace DirectX::PackedVector;
 
 // Loads vertex and pixel shaders from files and instantiates the cube geometry.
 SpinningCubeRenderer::SpinningCubeRenderer(const std::shared_ptr<DXHelper::DeviceResources>& deviceResources)
@@ -132,7 +134,7 @@ void SpinningCubeRenderer::Update(
     // Use the D3D device context to update Direct3D device-based resources.
     m_deviceResources->UseD3DDeviceContext([&](auto context) {
         // Update the model transform buffer for the hologram.
-        context->UpdateSubresource(m_modelConstantBuffer.get(), 0, nullptr, &(m_modelConstantBufferData), 0, 0);
+        DXHelper::UpdateDynamicBuffer(context, m_modelConstantBuffer.get(), m_modelConstantBufferData);
     });
 }
 
@@ -155,11 +157,29 @@ void SpinningCubeRenderer::Render(bool isStereo, winrt::Windows::Foundation::IRe
         return;
     }
 
+    RenderPath::Dispatch(isStereo, m_usingVprtShaders, [this](auto variant) { RenderVariant(variant); });
+}
+
+template <typename Variant>
+void SpinningCubeRenderer::RenderVariant(Variant)
+{
     m_deviceResources->UseD3DDeviceContext([&](auto context) {
+        // Cull against the depth of the previous frame, a hidden cube is drawn with an instance count of 0.
+        DXHelper::HiZOcclusionCuller& occlusionCuller = m_deviceResources->GetOcclusionCuller();
+        const bool occlusionCulling = occlusionCuller.IsActive();
+        if (occlusionCulling)
+        {
+            const winrt::Windows::Foundation::Numerics::float3& position = GetPosition();
+            m_occlusionCulledDraws.Clear();
+            m_occlusionCulledDraws.Add(
+                {position.x, position.y, position.z, m_boundingSphereRadius}, {m_indexCount, Variant::InstanceCount, 0, 0, 0});
+            m_occlusionCulledDraws.Cull(context, occlusionCuller);
+        }
+
         ID3D11Buffer* pBufferToSet = nullptr;
 
         // Each vertex is one instance of the VertexPositionColor struct.
-        const UINT stride = sizeof(VertexPositionNormalColor);
+        const UINT stride = sizeof(VertexPositionColor);
         const UINT offset = 0;
 
         pBufferToSet = m_vertexBuffer.get();
@@ -177,16 +197,13 @@ void SpinningCubeRenderer::Render(bool isStereo, winrt::Windows::Foundation::IRe
         pBufferToSet = m_modelConstantBuffer.get();
         context->VSSetConstantBuffers(0, 1, &pBufferToSet);
 
-        if (!m_usingVprtShaders)
-        {
-            // On devices that do not support the D3D11_FEATURE_D3D11_OPTIONS3::
-            // VPAndRTArrayIndexFromAnyShaderFeedingRasterizer optional feature,
-            // a pass-through geometry shader is used to set the render target
-            // array index.
-            context->GSSetShader(m_geometryShader.get(), nullptr, 0);
-        }
+        // On devices that do not support the D3D11_FEATURE_D3D11_OPTIONS3::
+        // VPAndRTArrayIndexFromAnyShaderFeedingRasterizer optional feature,
+        // a pass-through geometry shader is used to set the render target
+        // array index.
+        context->GSSetShader(Variant::GeometryShader(m_geometryShader.get()), nullptr, 0);
 
-        context->UpdateSubresource(m_filterColorBuffer.get(), 0, nullptr, &m_filterColorData, 0, 0);
+        DXHelper::UpdateDynamicBuffer(context, m_filterColorBuffer.get(), m_filterColorData);
 
         pBufferToSet = m_filterColorBuffer.get();
         context->PSSetConstantBuffers(0, 1, &pBufferToSet);
@@ -195,24 +212,24 @@ void SpinningCubeRenderer::Render(bool isStereo, winrt::Windows::Foundation::IRe
         context->PSSetShader(m_pixelShader.get(), nullptr, 0);
 
         // Draw the objects.
+        if (occlusionCulling)
+        {
+            m_occlusionCulledDraws.Draw(context, 0);
+            return;
+        }
+
         context->DrawIndexedInstanced(
-            m_indexCount,     // Index count per instance.
-            isStereo ? 2 : 1, // Instance count.
-            0,                // Start index location.
-            0,                // Base vertex location.
-            0                 // Start instance location.
+            m_indexCount,           // Index count per instance.
+            Variant::InstanceCount, // Instance count.
+            0,                      // Start index location.
+            0,                      // Base vertex location.
+            0                       // Start instance location.
         );
     });
 }
 
 std::future<void> SpinningCubeRenderer::CreateDeviceDependentResources()
 {
-#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
-    std::wstring fileNamePrefix = L"";
-#else
-    std::wstring fileNamePrefix = L"ms-appx:///";
-#endif
-
     m_usingVprtShaders = m_deviceResources->GetDeviceSupportsVprt();
 
     // On devices that do support the D3D11_FEATURE_D3D11_OPTIONS3::
@@ -221,62 +238,68 @@ std::future<void> SpinningCubeRenderer::CreateDeviceDependentResources()
     // target array index, thus avoiding any overhead that would be
     // incurred by setting the geometry shader stage.
 
-    std::wstring vertexShaderFileName = m_usingVprtShaders ? L"SimpleColor_VertexShaderVprt.cso" : L"SimpleColor_VertexShader.cso";
+    std::wstring vertexShaderFileName = m_deviceResources->GetVertexShaderFileName(L"SimpleColor_VertexShader");
+
+    // All shaders are requested before awaiting any of them, so their files are read in parallel.
+    DXHelper::ShaderCache& shaderCache = m_deviceResources->GetShaderCache();
+    auto vertexShader = shaderCache.GetVertexShaderAsync(vertexShaderFileName);
+    auto pixelShader = shaderCache.GetPixelShaderAsync(L"SimpleColor_PixelShader.cso");
+    std::future<winrt::com_ptr<ID3D11GeometryShader>> geometryShader;
+    if (!m_usingVprtShaders)
+    {
+        // Load the pass-through geometry shader.
+        geometryShader = shaderCache.GetGeometryShaderAsync(L"SimpleColor_GeometryShader.cso");
+    }
 
-    std::vector<byte> vertexShaderFileData = co_await DXHelper::ReadDataAsync(fileNamePrefix + vertexShaderFileName);
-    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateVertexShader(
-        vertexShaderFileData.data(), vertexShaderFileData.size(), nullptr, m_vertexShader.put()));
+    m_vertexShader = co_await vertexShader;
+    const DXHelper::ShaderCache::Bytecode vertexShaderBytecode = co_await shaderCache.GetBytecodeAsync(vertexShaderFileName);
 
-    std::array<D3D11_INPUT_ELEMENT_DESC, 3> vertexDesc = {{
+    std::array<D3D11_INPUT_ELEMENT_DESC, 2> vertexDesc = {{
         {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
-        {"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
-        {"COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
     }};
 
     winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateInputLayout(
         vertexDesc.data(),
         static_cast<UINT>(vertexDesc.size()),
-        vertexShaderFileData.data(),
-        static_cast<UINT>(vertexShaderFileData.size()),
+        vertexShaderBytecode.data(),
+        static_cast<UINT>(vertexShaderBytecode.size()),
         m_inputLayout.put()));
 
-    std::vector<byte> pixelShaderFileData = co_await DXHelper::ReadDataAsync(fileNamePrefix + L"SimpleColor_PixelShader.cso");
-    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreatePixelShader(
-        pixelShaderFileData.data(), pixelShaderFileData.size(), nullptr, m_pixelShader.put()));
+    m_pixelShader = co_await pixelShader;
 
     const ModelConstantBuffer constantBuffer{
         reinterpret_cast<DirectX::XMFLOAT4X4&>(winrt::Windows::Foundation::Numerics::float4x4::identity()),
     };
 
-    const CD3D11_BUFFER_DESC constantBufferDesc(sizeof(ModelConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
-    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(&constantBufferDesc, nullptr, m_modelConstantBuffer.put()));
+    const CD3D11_BUFFER_DESC constantBufferDesc(
+        sizeof(ModelConstantBuffer), D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+    const D3D11_SUBRESOURCE_DATA constantBufferData = {&constantBuffer};
+    winrt::check_hresult(
+        m_deviceResources->GetD3DDevice()->CreateBuffer(&constantBufferDesc, &constantBufferData, m_modelConstantBuffer.put()));
 
-    const CD3D11_BUFFER_DESC filterColorBufferDesc(sizeof(XMFLOAT4), D3D11_BIND_CONSTANT_BUFFER);
+    const CD3D11_BUFFER_DESC filterColorBufferDesc(
+        sizeof(XMFLOAT4), D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
     winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(&filterColorBufferDesc, nullptr, m_filterColorBuffer.put()));
 
-    if (!m_usingVprtShaders)
+    if (geometryShader.valid())
     {
-        // Load the pass-through geometry shader.
-        std::vector<byte> geometryShaderFileData = co_await DXHelper::ReadDataAsync(fileNamePrefix + L"SimpleColor_GeometryShader.cso");
-
-        // After the pass-through geometry shader file is loaded, create the shader.
-        winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateGeometryShader(
-            geometryShaderFileData.data(), geometryShaderFileData.size(), nullptr, m_geometryShader.put()));
+        m_geometryShader = co_await geometryShader;
     }
 
     // Load mesh vertices. Each vertex has a position and a color.
     // Note that the cube size has changed from the default DirectX app
     // template. Windows Holographic is scaled in meters, so to draw the
     // cube at a comfortable size we made the cube width 0.2 m (20 cm).
-    static const VertexPositionNormalColor cubeVertices[] = {
-        {XMFLOAT3(-m_cubeExtent, -m_cubeExtent, -m_cubeExtent), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f)},
-        {XMFLOAT3(-m_cubeExtent, -m_cubeExtent, m_cubeExtent), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f)},
-        {XMFLOAT3(-m_cubeExtent, m_cubeExtent, -m_cubeExtent), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f)},
-        {XMFLOAT3(-m_cubeExtent, m_cubeExtent, m_cubeExtent), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 1.0f)},
-        {XMFLOAT3(m_cubeExtent, -m_cubeExtent, -m_cubeExtent), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 0.0f, 0.0f)},
-        {XMFLOAT3(m_cubeExtent, -m_cubeExtent, m_cubeExtent), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 0.0f, 1.0f)},
-        {XMFLOAT3(m_cubeExtent, m_cubeExtent, -m_cubeExtent), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 0.0f)},
-        {XMFLOAT3(m_cubeExtent, m_cubeExtent, m_cubeExtent), XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)},
+    static const VertexPositionColor cubeVertices[] = {
+        {XMFLOAT3(-m_cubeExtent, -m_cubeExtent, -m_cubeExtent), XMUBYTEN4(0.0f, 0.0f, 0.0f, 1.0f)},
+        {XMFLOAT3(-m_cubeExtent, -m_cubeExtent, m_cubeExtent), XMUBYTEN4(0.0f, 0.0f, 1.0f, 1.0f)},
+        {XMFLOAT3(-m_cubeExtent, m_cubeExtent, -m_cubeExtent), XMUBYTEN4(0.0f, 1.0f, 0.0f, 1.0f)},
+        {XMFLOAT3(-m_cubeExtent, m_cubeExtent, m_cubeExtent), XMUBYTEN4(0.0f, 1.0f, 1.0f, 1.0f)},
+        {XMFLOAT3(m_cubeExtent, -m_cubeExtent, -m_cubeExtent), XMUBYTEN4(1.0f, 0.0f, 0.0f, 1.0f)},
+        {XMFLOAT3(m_cubeExtent, -m_cubeExtent, m_cubeExtent), XMUBYTEN4(1.0f, 0.0f, 1.0f, 1.0f)},
+        {XMFLOAT3(m_cubeExtent, m_cubeExtent, -m_cubeExtent), XMUBYTEN4(1.0f, 1.0f, 0.0f, 1.0f)},
+        {XMFLOAT3(m_cubeExtent, m_cubeExtent, m_cubeExtent), XMUBYTEN4(1.0f, 1.0f, 1.0f, 1.0f)},
     };
 
     D3D11_SUBRESOURCE_DATA vertexBufferData = {0};
@@ -337,6 +360,7 @@ void SpinningCubeRenderer::ReleaseDeviceDependentResources()
     m_vertexBuffer = nullptr;
     m_indexBuffer = nullptr;
     m_filterColorBuffer = nullptr;
+    m_occlusionCulledDraws.ReleaseDeviceDependentResources();
 }
 
 void SpinningCubeRenderer::CreateWindowSizeDependentResources()
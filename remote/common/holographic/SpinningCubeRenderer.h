@@ -12,6 +12,7 @@
 #pragma once
 
 #include <d3d11/SimpleColor_ShaderStructures.h>
+#include <holographic/ContentDepthRange.h>
 #include <holographic/DeviceResources.h>
 
 #include <winrt/Windows.UI.Input.Spatial.h>
@@ -34,6 +35,12 @@ public:
     void SetColorFilter(DirectX::XMFLOAT4 color);
     void Render(bool isStereo, winrt::Windows::Foundation::IReference<SpatialBoundingFrustum> cullingFrustum);
 
+    // Returns whether the device dependent resources are created. Nothing is rendered before.
+    bool IsLoadingComplete() const
+    {
+        return m_loadingComplete;
+    }
+
     // Repositions the sample hologram.
     void PositionHologram(const winrt::Windows::UI::Input::Spatial::SpatialPointerPose& pointerPose);
 
@@ -60,6 +67,11 @@ public:
     }
     void TogglePauseState();
 
+    void AddBounds(ContentDepthRange& depthRange) const
+    {
+        depthRange.Add({m_position, m_boundingSphereRadius});
+    }
+
 private:
     enum class PauseState
     {
@@ -69,6 +81,10 @@ private:
         Unpausing,
     };
 
+    // Draws the cube, specialized on the render path variant of the camera.
+    template <typename Variant>
+    void RenderVariant(Variant variant);
+
     // Cached pointer to device resources.
     std::shared_ptr<DXHelper::DeviceResources> m_deviceResources;
 
@@ -81,6 +97,7 @@ private:
     winrt::com_ptr<ID3D11PixelShader> m_pixelShader;
     winrt::com_ptr<ID3D11Buffer> m_modelConstantBuffer;
     winrt::com_ptr<ID3D11Buffer> m_filterColorBuffer;
+    DXHelper::OcclusionCulledDraws m_occlusionCulledDraws;
 
     // System resources for cube geometry.
     ModelConstantBuffer m_modelConstantBufferData;
@@ -0,0 +1,286 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#include <pch.h>
+
+#include <holographic/StressTestRenderer.h>
+
+#include <d3d11/DirectXHelper.h>
+#include <holographic/RenderPath.h>
+
+#include <algorithm>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+using namespace winrt::Windows::Foundation::Numerics;
+
+StressTestRenderer::StressTestRenderer(const std::shared_ptr<DXHelper::DeviceResources>& deviceResources, const Options& options)
+    : m_deviceResources(deviceResources)
+    , m_options(options)
+    , m_spatialIndex(SpatialIndexCellSize)
+{
+    const uint32_t hologramCount = std::clamp(m_options.hologramCount, MinHologramCount, MaxHologramCount);
+    m_holograms.resize(hologramCount);
+    m_modelConstantBufferData.resize(hologramCount);
+    m_spheres.resize(hologramCount);
+    for (uint32_t i = 0; i < hologramCount; ++i)
+    {
+        Spawn(i);
+    }
+    SetActiveCount(hologramCount);
+
+    CreateDeviceDependentResources();
+}
+
+void StressTestRenderer::SetActiveCount(uint32_t count)
+{
+    // Only the active cubes are part of the spatial index.
+    const uint32_t activeCount = std::min(count, GetHologramCount());
+    for (uint32_t i = activeCount; i < m_activeCount; ++i)
+    {
+        m_spatialIndex.Remove(i);
+    }
+    for (uint32_t i = m_activeCount; i < activeCount; ++i)
+    {
+        m_spatialIndex.Update(i, m_spheres[i]);
+    }
+
+    m_activeCount = activeCount;
+    m_nextRespawn = 0;
+    m_churnDebt = 0.0f;
+}
+
+void StressTestRenderer::Spawn(uint32_t index)
+{
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    Hologram& hologram = m_holograms[index];
+
+    switch (m_options.distribution)
+    {
+        case Distribution::Grid:
+        {
+            // The grid fills up layer by layer from the front, starting two meters in front of the user. A respawned cube keeps its
+            // slot and only changes how it spins.
+            const uint32_t side = static_cast<uint32_t>(std::ceil(std::cbrt(static_cast<float>(GetHologramCount()))));
+            const float offset = 0.5f * (side - 1) * GridSpacing;
+            const uint32_t x = index % side;
+            const uint32_t y = (index / side) % side;
+            const uint32_t z = index / (side * side);
+            hologram.position = {x * GridSpacing - offset, y * GridSpacing - offset, -2.0f - z * GridSpacing};
+            break;
+        }
+
+        case Distribution::Sphere:
+        {
+            // Uniformly distributed directions, three meters around the user.
+            const float z = 2.0f * unit(m_random) - 1.0f;
+            const float angle = XM_2PI * unit(m_random);
+            const float r = std::sqrt(1.0f - z * z);
+            hologram.position = 3.0f * float3(r * std::cos(angle), r * std::sin(angle), z);
+            break;
+        }
+
+        case Distribution::Random:
+            hologram.position = {4.0f * unit(m_random) - 2.0f, 2.0f * unit(m_random) - 1.0f, -1.0f - 4.0f * unit(m_random)};
+            break;
+    }
+
+    const float3 axis = normalize(float3(unit(m_random) - 0.5f, unit(m_random) - 0.5f, unit(m_random) - 0.5f) + float3(0.0f, 0.01f, 0.0f));
+    hologram.rotationAxis = DXHelper::Float3ToXMFloat3(axis);
+    hologram.radiansPerSecond = XM_PI * (0.25f + 1.75f * unit(m_random));
+    hologram.phase = XM_2PI * unit(m_random);
+
+    m_spheres[index] = {hologram.position, std::sqrt(3.0f) * CubeExtent};
+    if (index < m_activeCount)
+    {
+        m_spatialIndex.Update(index, m_spheres[index]);
+    }
+}
+
+void StressTestRenderer::Update(float totalSeconds, float elapsedSeconds)
+{
+    if (m_activeCount == 0)
+    {
+        return;
+    }
+
+    // Cubes are respawned round robin, so every cube moves once before any cube moves twice.
+    m_churnDebt = std::min(m_churnDebt + m_options.churnPerSecond * m_activeCount * elapsedSeconds, static_cast<float>(m_activeCount));
+    while (m_churnDebt >= 1.0f)
+    {
+        Spawn(m_nextRespawn);
+        m_nextRespawn = (m_nextRespawn + 1) % m_activeCount;
+        m_churnDebt -= 1.0f;
+    }
+
+    XMVECTOR boundsMin = g_XMFltMax;
+    XMVECTOR boundsMax = XMVectorNegate(g_XMFltMax);
+    for (uint32_t i = 0; i < m_activeCount; ++i)
+    {
+        const Hologram& hologram = m_holograms[i];
+        const float radians = std::fmod(hologram.phase + totalSeconds * hologram.radiansPerSecond, XM_2PI);
+        const XMVECTOR position = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(&hologram.position));
+        const XMMATRIX modelTransform =
+            XMMatrixMultiply(XMMatrixRotationAxis(XMLoadFloat3(&hologram.rotationAxis), radians), XMMatrixTranslationFromVector(position));
+
+        // Transposed for the shader.
+        XMStoreFloat4x4(&m_modelConstantBufferData[i].model, XMMatrixTranspose(modelTransform));
+
+        boundsMin = XMVectorMin(boundsMin, position);
+        boundsMax = XMVectorMax(boundsMax, position);
+    }
+
+    XMFLOAT3 center;
+    XMStoreFloat3(&center, 0.5f * (boundsMin + boundsMax));
+    m_bounds = {float3(center.x, center.y, center.z), XMVectorGetX(XMVector3Length(0.5f * (boundsMax - boundsMin))) + m_spheres[0].radius};
+}
+
+void StressTestRenderer::Render(bool isStereo, winrt::Windows::Foundation::IReference<SpatialBoundingFrustum> cullingFrustum)
+{
+    if (!m_loadingComplete || m_activeCount == 0)
+    {
+        return;
+    }
+
+    m_visibleHolograms.clear();
+    m_spatialIndex.QueryFrustum(FrustumCulling::FrustumPlanes(cullingFrustum), m_visibleHolograms);
+
+    RenderPath::Dispatch(isStereo, m_usingVprtShaders, [this](auto variant) { RenderVisible(variant); });
+}
+
+template <typename Variant>
+void StressTestRenderer::RenderVisible(Variant)
+{
+    m_deviceResources->UseD3DDeviceContext([&](auto context) {
+        const UINT stride = sizeof(VertexPositionColor);
+        const UINT offset = 0;
+        ID3D11Buffer* vertexBuffer = m_vertexBuffer.get();
+        context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+        context->IASetIndexBuffer(m_indexBuffer.get(), DXGI_FORMAT_R16_UINT, 0);
+        context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        context->IASetInputLayout(m_inputLayout.get());
+
+        context->VSSetShader(m_vertexShader.get(), nullptr, 0);
+        ID3D11Buffer* modelConstantBuffer = m_modelConstantBuffer.get();
+        context->VSSetConstantBuffers(0, 1, &modelConstantBuffer);
+
+        // Without VPRT support a pass-through geometry shader sets the render target array index.
+        context->GSSetShader(Variant::GeometryShader(m_geometryShader.get()), nullptr, 0);
+
+        ID3D11Buffer* filterColorBuffer = m_filterColorBuffer.get();
+        context->PSSetConstantBuffers(0, 1, &filterColorBuffer);
+        context->PSSetShader(m_pixelShader.get(), nullptr, 0);
+
+        // One constant buffer update and one draw per cube, like independent holograms.
+        for (SpatialIndex::ObjectId i : m_visibleHolograms)
+        {
+            DXHelper::UpdateDynamicBuffer(context, m_modelConstantBuffer.get(), m_modelConstantBufferData[i]);
+            context->DrawIndexedInstanced(m_indexCount, Variant::InstanceCount, 0, 0, 0);
+        }
+        m_drawCallCount += static_cast<uint32_t>(m_visibleHolograms.size());
+    });
+}
+
+std::future<void> StressTestRenderer::CreateDeviceDependentResources()
+{
+    m_usingVprtShaders = m_deviceResources->GetDeviceSupportsVprt();
+
+    std::wstring vertexShaderFileName = m_deviceResources->GetVertexShaderFileName(L"SimpleColor_VertexShader");
+
+    // All shaders are requested before awaiting any of them, so their files are read in parallel.
+    DXHelper::ShaderCache& shaderCache = m_deviceResources->GetShaderCache();
+    auto vertexShader = shaderCache.GetVertexShaderAsync(vertexShaderFileName);
+    auto pixelShader = shaderCache.GetPixelShaderAsync(L"SimpleColor_PixelShader.cso");
+    std::future<winrt::com_ptr<ID3D11GeometryShader>> geometryShader;
+    if (!m_usingVprtShaders)
+    {
+        geometryShader = shaderCache.GetGeometryShaderAsync(L"SimpleColor_GeometryShader.cso");
+    }
+
+    m_vertexShader = co_await vertexShader;
+    const DXHelper::ShaderCache::Bytecode vertexShaderBytecode = co_await shaderCache.GetBytecodeAsync(vertexShaderFileName);
+
+    constexpr std::array<D3D11_INPUT_ELEMENT_DESC, 2> vertexDesc = {{
+        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
+    }};
+
+    ID3D11Device* device = m_deviceResources->GetD3DDevice();
+    winrt::check_hresult(device->CreateInputLayout(
+        vertexDesc.data(),
+        static_cast<UINT>(vertexDesc.size()),
+        vertexShaderBytecode.data(),
+        static_cast<UINT>(vertexShaderBytecode.size()),
+        m_inputLayout.put()));
+
+    m_pixelShader = co_await pixelShader;
+
+    const CD3D11_BUFFER_DESC constantBufferDesc(
+        sizeof(ModelConstantBuffer), D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+    winrt::check_hresult(device->CreateBuffer(&constantBufferDesc, nullptr, m_modelConstantBuffer.put()));
+
+    const XMFLOAT4 filterColor = {1, 1, 1, 1};
+    const CD3D11_BUFFER_DESC filterColorBufferDesc(sizeof(XMFLOAT4), D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_IMMUTABLE);
+    const D3D11_SUBRESOURCE_DATA filterColorBufferData = {&filterColor};
+    winrt::check_hresult(device->CreateBuffer(&filterColorBufferDesc, &filterColorBufferData, m_filterColorBuffer.put()));
+
+    if (geometryShader.valid())
+    {
+        m_geometryShader = co_await geometryShader;
+    }
+
+    static const VertexPositionColor cubeVertices[] = {
+        {XMFLOAT3(-CubeExtent, -CubeExtent, -CubeExtent), XMUBYTEN4(0.0f, 0.0f, 0.0f, 1.0f)},
+        {XMFLOAT3(-CubeExtent, -CubeExtent, CubeExtent), XMUBYTEN4(0.0f, 0.0f, 1.0f, 1.0f)},
+        {XMFLOAT3(-CubeExtent, CubeExtent, -CubeExtent), XMUBYTEN4(0.0f, 1.0f, 0.0f, 1.0f)},
+        {XMFLOAT3(-CubeExtent, CubeExtent, CubeExtent), XMUBYTEN4(0.0f, 1.0f, 1.0f, 1.0f)},
+        {XMFLOAT3(CubeExtent, -CubeExtent, -CubeExtent), XMUBYTEN4(1.0f, 0.0f, 0.0f, 1.0f)},
+        {XMFLOAT3(CubeExtent, -CubeExtent, CubeExtent), XMUBYTEN4(1.0f, 0.0f, 1.0f, 1.0f)},
+        {XMFLOAT3(CubeExtent, CubeExtent, -CubeExtent), XMUBYTEN4(1.0f, 1.0f, 0.0f, 1.0f)},
+        {XMFLOAT3(CubeExtent, CubeExtent, CubeExtent), XMUBYTEN4(1.0f, 1.0f, 1.0f, 1.0f)},
+    };
+
+    const D3D11_SUBRESOURCE_DATA vertexBufferData = {cubeVertices};
+    const CD3D11_BUFFER_DESC vertexBufferDesc(sizeof(cubeVertices), D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_IMMUTABLE);
+    winrt::check_hresult(device->CreateBuffer(&vertexBufferDesc, &vertexBufferData, m_vertexBuffer.put()));
+
+    // Clockwise winding, like the spinning cube.
+    static const unsigned short cubeIndices[] = {
+        2, 1, 0, 2, 3, 1, // -x
+        6, 4, 5, 6, 5, 7, // +x
+        0, 1, 5, 0, 5, 4, // -y
+        2, 6, 7, 2, 7, 3, // +y
+        0, 4, 6, 0, 6, 2, // -z
+        1, 3, 7, 1, 7, 5, // +z
+    };
+    m_indexCount = ARRAYSIZE(cubeIndices);
+
+    const D3D11_SUBRESOURCE_DATA indexBufferData = {cubeIndices};
+    const CD3D11_BUFFER_DESC indexBufferDesc(sizeof(cubeIndices), D3D11_BIND_INDEX_BUFFER, D3D11_USAGE_IMMUTABLE);
+    winrt::check_hresult(device->CreateBuffer(&indexBufferDesc, &indexBufferData, m_indexBuffer.put()));
+
+    m_loadingComplete = true;
+}
+
+void StressTestRenderer::ReleaseDeviceDependentResources()
+{
+    m_loadingComplete = false;
+    m_usingVprtShaders = false;
+    m_inputLayout = nullptr;
+    m_vertexBuffer = nullptr;
+    m_indexBuffer = nullptr;
+    m_vertexShader = nullptr;
+    m_geometryShader = nullptr;
+    m_pixelShader = nullptr;
+    m_modelConstantBuffer = nullptr;
+    m_filterColorBuffer = nullptr;
+}
@@ -0,0 +1,145 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+
+#pragma once
+
+#include <d3d11/SimpleColor_ShaderStructures.h>
+#include <holographic/ContentDepthRange.h>
+#include <holographic/DeviceResources.h>
+#include <holographic/FrustumCulling.h>
+#include <holographic/SpatialIndex.h>
+
+#include <atomic>
+#include <future>
+#include <random>
+#include <vector>
+
+// Renders a configurable number of small animated cubes, to find out where rendering and streaming stop scaling with the
+// amount of content. Every visible cube is a draw call of its own with a model transform of its own, like the independent
+// holograms of an application, so the cost grows with the number of cubes instead of being hidden by instancing. Churn
+// respawns a share of the cubes every second, which gives the encoder newly exposed content to stream.
+class StressTestRenderer
+{
+public:
+    enum class Distribution
+    {
+        // A cube shaped grid in front of the user, the front layers hide most cubes behind them.
+        Grid,
+        // A shell around the user, most cubes are behind or beside the user and get culled.
+        Sphere,
+        // Uniformly distributed in a box in front of the user.
+        Random,
+    };
+
+    static constexpr uint32_t MinHologramCount = 100;
+    static constexpr uint32_t MaxHologramCount = 100000;
+
+    struct Options
+    {
+        // Number of cubes, clamped to [MinHologramCount, MaxHologramCount].
+        uint32_t hologramCount = MinHologramCount;
+        Distribution distribution = Distribution::Random;
+        // Share of the active cubes respawned per second, 0 keeps every cube where it is.
+        float churnPerSecond = 0.0f;
+    };
+
+    StressTestRenderer(const std::shared_ptr<DXHelper::DeviceResources>& deviceResources, const Options& options);
+
+    std::future<void> CreateDeviceDependentResources();
+    void ReleaseDeviceDependentResources();
+
+    // Sets the number of cubes which are animated and rendered, clamped to the configured count. Cubes keep their place when
+    // the count changes, so growing it adds cubes to the ones already there.
+    void SetActiveCount(uint32_t count);
+    uint32_t GetActiveCount() const
+    {
+        return m_activeCount;
+    }
+    uint32_t GetHologramCount() const
+    {
+        return static_cast<uint32_t>(m_holograms.size());
+    }
+
+    // Animates the active cubes and respawns the share of them the churn asks for. Called once per frame.
+    void Update(float totalSeconds, float elapsedSeconds);
+    void Render(bool isStereo, winrt::Windows::Foundation::IReference<SpatialBoundingFrustum> cullingFrustum);
+
+    void AddBounds(ContentDepthRange& depthRange) const
+    {
+        if (m_activeCount > 0)
+        {
+            depthRange.Add(m_bounds);
+        }
+    }
+
+    // Returns the number of draw calls issued since the last call, by all cameras.
+    uint32_t TakeDrawCallCount()
+    {
+        return m_drawCallCount.exchange(0);
+    }
+
+private:
+    struct Hologram
+    {
+        winrt::Windows::Foundation::Numerics::float3 position;
+        DirectX::XMFLOAT3 rotationAxis;
+        float radiansPerSecond;
+        float phase;
+    };
+
+    void Spawn(uint32_t index);
+
+    // Draws the visible cubes, specialized on the render path variant of the camera.
+    template <typename Variant>
+    void RenderVisible(Variant variant);
+
+    std::shared_ptr<DXHelper::DeviceResources> m_deviceResources;
+    const Options m_options;
+
+    // Direct3D resources shared by all cubes.
+    winrt::com_ptr<ID3D11InputLayout> m_inputLayout;
+    winrt::com_ptr<ID3D11Buffer> m_vertexBuffer;
+    winrt::com_ptr<ID3D11Buffer> m_indexBuffer;
+    winrt::com_ptr<ID3D11VertexShader> m_vertexShader;
+    winrt::com_ptr<ID3D11GeometryShader> m_geometryShader;
+    winrt::com_ptr<ID3D11PixelShader> m_pixelShader;
+    winrt::com_ptr<ID3D11Buffer> m_modelConstantBuffer;
+    winrt::com_ptr<ID3D11Buffer> m_filterColorBuffer;
+    uint32_t m_indexCount = 0;
+
+    // Per cube state, of all cubes. Only the first m_activeCount cubes are animated and rendered.
+    std::vector<Hologram> m_holograms;
+    std::vector<ModelConstantBuffer> m_modelConstantBufferData;
+    std::vector<FrustumCulling::CullingSphere> m_spheres;
+    uint32_t m_activeCount = 0;
+
+    // A sphere enclosing all active cubes, for the depth range.
+    FrustumCulling::CullingSphere m_bounds = {};
+
+    // The active cubes by their index, moved when a cube respawns, so the cubes far outside of the view are not visited at all.
+    SpatialIndex m_spatialIndex;
+
+    // Reused across frames and cameras.
+    std::vector<SpatialIndex::ObjectId> m_visibleHolograms;
+
+    std::mt19937 m_random;
+    float m_churnDebt = 0.0f;
+    uint32_t m_nextRespawn = 0;
+
+    std::atomic<uint32_t> m_drawCallCount = 0;
+    std::atomic<bool> m_loadingComplete = false;
+    bool m_usingVprtShaders = false;
+
+    static constexpr float CubeExtent = 0.02f;
+    static constexpr float GridSpacing = 0.1f;
+    static constexpr float SpatialIndexCellSize = 0.5f;
+};
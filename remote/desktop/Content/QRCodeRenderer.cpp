@@ -11,10 +11,14 @@
 
 #include <pch.h>
 
+#include <algorithm>
+#include <array>
 #include <chrono>
 
 #include <content/QRCodeRenderer.h>
 
+#include <ThreadConfiguration.h>
+
 #include <d3d11/DirectXHelper.h>
 #include <holographic/FrustumCulling.h>
 
@@ -27,122 +31,330 @@ using namespace winrt::Windows::Foundation::Numerics;
 QRCodeRenderer::QRCodeRenderer(const std::shared_ptr<DXHelper::DeviceResources>& deviceResources)
     : RenderableObject(deviceResources)
 {
+    m_qrCodeResourcesCreated = CreateQRCodeDeviceDependentResources();
 }
 
-void QRCodeRenderer::OnAddedQRCode(const winrt::Microsoft::MixedReality::QR::QRCode& code)
+std::future<void> QRCodeRenderer::CreateDeviceDependentResources()
+{
+    co_await RenderableObject::CreateDeviceDependentResources();
+    co_await CreateQRCodeDeviceDependentResources();
+}
+
+void QRCodeRenderer::ReleaseDeviceDependentResources()
 {
+    RenderableObject::ReleaseDeviceDependentResources();
+
     std::scoped_lock lock(m_mutex);
-    m_qrCodes.insert({code, nullptr});
+    m_qrCodeResourcesLoaded = false;
+    m_qrCodeVertexShader = nullptr;
+    m_qrCodeInputLayouts[0] = nullptr;
+    m_qrCodeInputLayouts[1] = nullptr;
+    m_quadVertexBuffer = nullptr;
+    m_instanceBuffer = nullptr;
+    m_qrCodeConstantBuffer = nullptr;
+    m_instanceBufferCapacity = 0;
+    m_instanceCount = 0;
+    m_qrCodeConstantBufferViewCount = 0;
 }
 
-void QRCodeRenderer::OnUpdatedQRCode(const winrt::Microsoft::MixedReality::QR::QRCode& code)
+std::future<void> QRCodeRenderer::CreateQRCodeDeviceDependentResources()
 {
+    // The QR code vertex shader outputs the same data as the SimpleColor vertex shaders, so the pass-through
+    // geometry shader and pixel shader set up by RenderableObject are reused.
+    std::wstring vertexShaderFileName = m_deviceResources->GetVertexShaderFileName(L"QR_VertexShader");
+
+    DXHelper::ShaderCache& shaderCache = m_deviceResources->GetShaderCache();
+    winrt::com_ptr<ID3D11VertexShader> vertexShader = co_await shaderCache.GetVertexShaderAsync(vertexShaderFileName);
+    const DXHelper::ShaderCache::Bytecode vertexShaderBytecode = co_await shaderCache.GetBytecodeAsync(vertexShaderFileName);
+
     std::scoped_lock lock(m_mutex);
 
-    if (m_qrCodes.find(code) != m_qrCodes.end())
+    m_qrCodeVertexShader = vertexShader;
+
+    // Each QR code instance is drawn once per view, so the instance data step rate equals the view count.
+    for (UINT viewCount = 1; viewCount <= 2; ++viewCount)
     {
-        // Remove the old entry;
-        m_qrCodes.erase(code);
+        const std::array<D3D11_INPUT_ELEMENT_DESC, 7> vertexDesc = {{
+            {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+            {"COLOR", 0, DXGI_FORMAT_R8G8B8A8_UNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
+            {"CODETRANSFORM", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, viewCount},
+            {"CODETRANSFORM", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, viewCount},
+            {"CODETRANSFORM", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, viewCount},
+            {"CODETRANSFORM", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, viewCount},
+            {"CODESIZE", 0, DXGI_FORMAT_R32_FLOAT, 1, 64, D3D11_INPUT_PER_INSTANCE_DATA, viewCount},
+        }};
+
+        winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateInputLayout(
+            vertexDesc.data(),
+            static_cast<UINT>(vertexDesc.size()),
+            vertexShaderBytecode.data(),
+            static_cast<UINT>(vertexShaderBytecode.size()),
+            m_qrCodeInputLayouts[viewCount - 1].put()));
     }
 
-    m_qrCodes.insert({code, nullptr});
+    // The unit quad, which the vertex shader scales by the physical side length of each code.
+    {
+        const float3 positions[4] = {{0.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {1.0f, 1.0f, 0.0f}, {1.0f, 0.0f, 0.0f}};
+        const float3 color{1.0f, 0.76f, 0.0f};
+
+        std::vector<VertexPositionColor> vertices;
+        AppendColoredTriangle(positions[0], positions[2], positions[1], color, vertices);
+        AppendColoredTriangle(positions[0], positions[3], positions[2], color, vertices);
+
+        m_quadVertexCount = static_cast<UINT>(vertices.size());
+
+        D3D11_SUBRESOURCE_DATA vertexBufferData = {0};
+        vertexBufferData.pSysMem = vertices.data();
+        const CD3D11_BUFFER_DESC vertexBufferDesc(
+            static_cast<UINT>(vertices.size() * sizeof(VertexPositionColor)), D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_IMMUTABLE);
+        m_deviceResources->CreateBuffer(MemoryAccounting::Tag::QRCodes, vertexBufferDesc, &vertexBufferData, m_quadVertexBuffer.put());
+    }
+
+    // Constant buffers must be a multiple of 16 bytes.
+    const CD3D11_BUFFER_DESC qrCodeConstantBufferDesc(4 * sizeof(UINT), D3D11_BIND_CONSTANT_BUFFER);
+    m_deviceResources->CreateBuffer(MemoryAccounting::Tag::QRCodes, qrCodeConstantBufferDesc, nullptr, m_qrCodeConstantBuffer.put());
+    m_qrCodeConstantBufferViewCount = 0;
+
+    m_qrCodeResourcesLoaded = true;
 }
 
-void QRCodeRenderer::Update(winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem)
+void QRCodeRenderer::OnAddedQRCode(const winrt::Microsoft::MixedReality::QR::QRCode& code)
 {
-    std::scoped_lock lock(m_mutex);
-    m_renderableQrCodes.clear();
+    m_qrCodeEvents.Push({code, code.SpatialGraphNodeId(), m_generation.load()});
+}
 
-    for (auto& [code, coordinateSystem] : m_qrCodes)
+void QRCodeRenderer::OnUpdatedQRCode(const winrt::Microsoft::MixedReality::QR::QRCode& code)
+{
+    m_qrCodeEvents.Push({code, code.SpatialGraphNodeId(), m_generation.load()});
+}
+
+void QRCodeRenderer::ProcessQRCodeEvents()
+{
+    const uint32_t generation = m_generation.load();
+    if (m_qrCodesGeneration != generation)
     {
-        winrt::Windows::Foundation::IReference<float4x4> qrToRenderingRef = nullptr;
-        if (coordinateSystem == nullptr)
+        m_qrCodes.clear();
+        m_qrCodesGeneration = generation;
+    }
+
+    m_qrCodeEvents.Drain([&](QRCodeEvent&& event) {
+        if (event.generation != generation)
         {
-            try
-            {
-                coordinateSystem = Preview::SpatialGraphInteropPreview::CreateCoordinateSystemForNode(code.SpatialGraphNodeId());
-            }
-            catch (winrt::hresult_error const&)
-            {
-                coordinateSystem = nullptr;
-                continue;
-            }
+            return;
         }
 
-        if (coordinateSystem)
+        // The coordinate system is only recreated if the code moved to a different spatial graph node.
+        TrackedQRCode& trackedCode = m_qrCodes[event.code];
+        if (trackedCode.spatialGraphNodeId != event.spatialGraphNodeId)
         {
-            qrToRenderingRef = coordinateSystem.TryGetTransformTo(renderingCoordinateSystem);
+            trackedCode.spatialGraphNodeId = event.spatialGraphNodeId;
+            trackedCode.coordinateSystem = nullptr;
+        }
+    });
 
-            if (qrToRenderingRef)
-            {
-                m_renderableQrCodes.push_back({code.PhysicalSideLength(), qrToRenderingRef.Value()});
-            }
+    m_coordinateSystemResults->Drain([&](CoordinateSystemResult&& result) {
+        if (result.generation != generation)
+        {
+            return;
+        }
+
+        auto it = m_qrCodes.find(result.code);
+        if (it != m_qrCodes.end() && it->second.spatialGraphNodeId == result.spatialGraphNodeId)
+        {
+            // Failed creations leave the coordinate system empty, which retries them.
+            it->second.coordinateSystem = result.coordinateSystem;
+            it->second.creationPending = false;
+        }
+    });
+
+    for (auto& [code, trackedCode] : m_qrCodes)
+    {
+        if (!trackedCode.coordinateSystem && !trackedCode.creationPending)
+        {
+            trackedCode.creationPending = true;
+            CreateCoordinateSystemAsync(m_coordinateSystemResults, code, trackedCode.spatialGraphNodeId, generation);
         }
     }
+}
 
-    // The vertices are already in rendering space.
-    auto modelTransform = winrt::Windows::Foundation::Numerics::float4x4::identity();
-    UpdateModelConstantBuffer(modelTransform);
+winrt::fire_and_forget QRCodeRenderer::CreateCoordinateSystemAsync(
+    std::shared_ptr<CoordinateSystemResultQueue> results, QRCode code, winrt::guid spatialGraphNodeId, uint32_t generation)
+{
+    // The watcher events only enqueue the codes, the spatial graph lookups run on the workers like the other content processing.
+    co_await ThreadConfiguration::ResumeOnWorker{};
+
+    winrt::Windows::Perception::Spatial::SpatialCoordinateSystem coordinateSystem = nullptr;
+    try
+    {
+        coordinateSystem = Preview::SpatialGraphInteropPreview::CreateCoordinateSystemForNode(spatialGraphNodeId);
+    }
+    catch (winrt::hresult_error const&)
+    {
+        coordinateSystem = nullptr;
+    }
+
+    results->Push({code, spatialGraphNodeId, coordinateSystem, generation});
 }
 
-void QRCodeRenderer::Draw(unsigned int numInstances, winrt::Windows::Foundation::IReference<SpatialBoundingFrustum> cullingFrustum)
+void QRCodeRenderer::AddBounds(ContentDepthRange& depthRange)
 {
     std::scoped_lock lock(m_mutex);
+    depthRange.Add(m_codeBounds);
+}
 
-    // Clear the vertices.
-    m_vertices.clear();
+void QRCodeRenderer::Update(winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem)
+{
+    // Watcher events and created coordinate systems are picked up without blocking the watcher or the render thread.
+    ProcessQRCodeEvents();
 
-    for (auto renderableCode : m_renderableQrCodes)
-    {
-        // Apply frustum culling.
-        const float size = renderableCode.size;
-        winrt::Windows::Foundation::Numerics::float3 center =
-            winrt::Windows::Foundation::Numerics::transform({0, 0, 0}, renderableCode.codeToRendering);
-        float radius = sqrtf(2 * size * size);
+    m_instances.clear();
+    m_transformCache.BeginFrame(renderingCoordinateSystem);
 
-        if (FrustumCulling::SphereInFrustum(center, radius, cullingFrustum))
+    for (auto& [code, trackedCode] : m_qrCodes)
+    {
+        if (trackedCode.coordinateSystem)
         {
-            float3 positions[4] = {{0.0f, 0.0f, 0.0f}, {0.0f, size, 0.0f}, {size, size, 0.0f}, {size, 0.0f, 0.0f}};
-            for (int i = 0; i < 4; ++i)
+            winrt::Windows::Foundation::IReference<float4x4> qrToRenderingRef =
+                m_transformCache.TryGetTransform(trackedCode.coordinateSystem);
+
+            if (qrToRenderingRef)
             {
-                // Transform from entity to rendering space.
-                positions[i] = transform(positions[i], renderableCode.codeToRendering);
+                m_instances.push_back({qrToRenderingRef.Value(), code.PhysicalSideLength()});
             }
-
-            float3 col{1.0f, 0.76f, 0.0f};
-            AppendColoredTriangle(positions[0], positions[2], positions[1], col, m_vertices);
-            AppendColoredTriangle(positions[0], positions[3], positions[2], col, m_vertices);
         }
     }
 
-    // Only render if vertices are available.
-    if (m_vertices.empty())
+    PublishInstances();
+}
+
+std::vector<PerceptionRecording::QRCode> QRCodeRenderer::GetQRCodes() const
+{
+    std::vector<PerceptionRecording::QRCode> qrCodes;
+    qrCodes.reserve(m_instances.size());
+    for (const QRCodeInstance& instance : m_instances)
+    {
+        qrCodes.push_back({instance.codeToRendering, instance.size});
+    }
+    return qrCodes;
+}
+
+void QRCodeRenderer::ReplayQRCodes(const std::vector<PerceptionRecording::QRCode>& qrCodes)
+{
+    m_instances.clear();
+    for (const PerceptionRecording::QRCode& qrCode : qrCodes)
+    {
+        m_instances.push_back({qrCode.codeToRendering, qrCode.size});
+    }
+
+    PublishInstances();
+}
+
+void QRCodeRenderer::PublishInstances()
+{
+    m_nextCodeBounds.clear();
+    for (const QRCodeInstance& instance : m_instances)
+    {
+        const float3 center = transform({0.5f * instance.size, 0.5f * instance.size, 0.0f}, instance.codeToRendering);
+        m_nextCodeBounds.push_back({center, 0.70710678f * instance.size});
+    }
+
+    std::scoped_lock lock(m_mutex);
+    m_codeBounds.swap(m_nextCodeBounds);
+
+    // The instance data already transforms the codes into rendering space.
+    auto modelTransform = winrt::Windows::Foundation::Numerics::float4x4::identity();
+    UpdateModelConstantBuffer(modelTransform);
+
+    UpdateInstanceBuffer();
+}
+
+void QRCodeRenderer::UpdateInstanceBuffer()
+{
+    m_instanceCount = 0;
+    if (!m_qrCodeResourcesLoaded || m_instances.empty())
     {
         return;
     }
 
-    const UINT stride = sizeof(m_vertices[0]);
-    const UINT offset = 0;
-    D3D11_SUBRESOURCE_DATA vertexBufferData = {0};
-    vertexBufferData.pSysMem = m_vertices.data();
-    const CD3D11_BUFFER_DESC vertexBufferDesc(static_cast<UINT>(m_vertices.size() * stride), D3D11_BIND_VERTEX_BUFFER);
-    winrt::com_ptr<ID3D11Buffer> vertexBuffer;
-    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(&vertexBufferDesc, &vertexBufferData, vertexBuffer.put()));
+    const UINT instanceCount = static_cast<UINT>(m_instances.size());
+    if (instanceCount > m_instanceBufferCapacity)
+    {
+        // Grow geometrically, so tracking more and more codes only reallocates the buffer a few times.
+        m_instanceBufferCapacity = std::max(2 * m_instanceBufferCapacity, std::max(instanceCount, 16u));
+        m_instanceBuffer = nullptr;
 
-    m_deviceResources->UseD3DDeviceContext([&](auto context) {
-        context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        const CD3D11_BUFFER_DESC instanceBufferDesc(
+            m_instanceBufferCapacity * sizeof(QRCodeInstance), D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+        m_deviceResources->CreateBuffer(MemoryAccounting::Tag::QRCodes, instanceBufferDesc, nullptr, m_instanceBuffer.put());
+    }
 
-        ID3D11Buffer* pBuffer = vertexBuffer.get();
-        context->IASetVertexBuffers(0, 1, &pBuffer, &stride, &offset);
-        context->DrawInstanced(static_cast<UINT>(m_vertices.size()), numInstances, offset, 0);
+    m_deviceResources->UseD3DDeviceContext([&](auto context) {
+        D3D11_MAPPED_SUBRESOURCE mappedResource = {};
+        winrt::check_hresult(context->Map(m_instanceBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
+        memcpy(mappedResource.pData, m_instances.data(), instanceCount * sizeof(QRCodeInstance));
+        context->Unmap(m_instanceBuffer.get(), 0);
     });
+
+    m_instanceCount = instanceCount;
 }
 
-void QRCodeRenderer::Reset()
+void QRCodeRenderer::Draw(
+    DXHelper::RenderQueue& renderQueue,
+    unsigned int numInstances,
+    winrt::Windows::Foundation::IReference<SpatialBoundingFrustum> cullingFrustum)
 {
     std::scoped_lock lock(m_mutex);
 
-    m_qrCodes.clear();
-    m_renderableQrCodes.clear();
-    m_vertices.clear();
+    if (!m_qrCodeResourcesLoaded || m_instanceCount == 0)
+    {
+        return;
+    }
+
+    // The instance buffer is shared by all cameras of the frame, so culling only skips the draw call
+    // when none of the codes is visible.
+    FrustumCulling::FrustumPlanes(cullingFrustum).CullSpheres(m_codeBounds, m_codeVisibility);
+    const bool anyVisible =
+        std::any_of(m_codeVisibility.begin(), m_codeVisibility.end(), [](uint32_t visibleCodes) { return visibleCodes != 0; });
+    if (!anyVisible)
+    {
+        return;
+    }
+
+    const UINT viewCount = std::clamp<UINT>(numInstances, 1, 2);
+    if (m_qrCodeConstantBufferViewCount != viewCount)
+    {
+        m_deviceResources->UseD3DDeviceContext([&](auto context) {
+            const UINT qrCodeConstantBufferData[4] = {viewCount, 0, 0, 0};
+            context->UpdateSubresource(m_qrCodeConstantBuffer.get(), 0, nullptr, qrCodeConstantBufferData, 0, 0);
+        });
+        m_qrCodeConstantBufferViewCount = viewCount;
+    }
+
+    // Only the input layout and the vertex shader differ from the SimpleColor pipeline. The geometry shader,
+    // pixel shader and the remaining constant buffers stay the same.
+    DXHelper::DrawPacket packet = CreateDrawPacket();
+    packet.pipeline.inputLayout = m_qrCodeInputLayouts[viewCount - 1];
+    packet.pipeline.vertexShader = m_qrCodeVertexShader;
+    packet.vertexShaderConstantBuffers[2] = m_qrCodeConstantBuffer;
+
+    packet.vertexBuffers[0] = m_quadVertexBuffer;
+    packet.strides[0] = sizeof(VertexPositionColor);
+    packet.vertexBuffers[1] = m_instanceBuffer;
+    packet.strides[1] = sizeof(QRCodeInstance);
+
+    // All codes are drawn to both views with a single draw call.
+    packet.elementCount = m_quadVertexCount;
+    packet.instanceCount = m_instanceCount * viewCount;
+    renderQueue.Submit(std::move(packet));
+}
+
+void QRCodeRenderer::Reset()
+{
+    // The QR codes themselves are owned by Update, which drops them once it sees the new generation.
+    m_generation++;
+
+    std::scoped_lock lock(m_mutex);
+    m_codeBounds.clear();
+    m_instanceCount = 0;
+    m_transformCache.Invalidate();
 }
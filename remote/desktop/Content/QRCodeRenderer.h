@@ -11,27 +11,51 @@
 
 #pragma once
 
+#include <atomic>
 #include <vector>
 
+#include <MemoryAccounting.h>
+#include <Utils.h>
+
+#include <holographic/ContentDepthRange.h>
+#include <holographic/FrustumCulling.h>
+#include <holographic/PerceptionRecording.h>
 #include <holographic/RenderableObject.h>
+#include <holographic/SpatialTransformCache.h>
 
 #include <winrt/Microsoft.MixedReality.QR.h>
 #include <winrt/Windows.Perception.Spatial.h>
 #include <winrt/Windows.UI.Input.Spatial.h>
 
-struct RenderableQRCode
+// Per-instance data of a QR code, which scales and places the unit quad in rendering space.
+struct QRCodeInstance
 {
-    float size;
     winrt::Windows::Foundation::Numerics::float4x4 codeToRendering;
+    float size;
 };
 
+static_assert(
+    sizeof(QRCodeInstance) == 17 * sizeof(float), "QRCodeInstance must be tightly packed to be used as per-instance vertex data.");
+
 class QRCodeRenderer : public RenderableObject
 {
 public:
     QRCodeRenderer(const std::shared_ptr<DXHelper::DeviceResources>& deviceResources);
 
+    std::future<void> CreateDeviceDependentResources() override;
+    void ReleaseDeviceDependentResources() override;
+
     void Update(winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem);
 
+    // Returns the codes located by the last Update, for a perception recording.
+    std::vector<PerceptionRecording::QRCode> GetQRCodes() const;
+
+    // Takes over recorded codes in place of Update, so they are drawn as they were recorded.
+    void ReplayQRCodes(const std::vector<PerceptionRecording::QRCode>& qrCodes);
+
+    // Adds the bounds of the codes located by the last Update.
+    void AddBounds(ContentDepthRange& depthRange);
+
     void OnAddedQRCode(const winrt::Microsoft::MixedReality::QR::QRCode& code);
 
     void OnUpdatedQRCode(const winrt::Microsoft::MixedReality::QR::QRCode& code);
@@ -39,13 +63,91 @@ public:
     void Reset();
 
 private:
-    void Draw(unsigned int numInstances, winrt::Windows::Foundation::IReference<SpatialBoundingFrustum> cullingFrustum) override;
+    void Draw(
+        DXHelper::RenderQueue& renderQueue,
+        unsigned int numInstances,
+        winrt::Windows::Foundation::IReference<SpatialBoundingFrustum> cullingFrustum) override;
+
+    // A QR code reported by the watcher, tagged with the reset generation it was reported in.
+    struct QRCodeEvent
+    {
+        winrt::Microsoft::MixedReality::QR::QRCode code;
+        winrt::guid spatialGraphNodeId;
+        uint32_t generation;
+    };
+
+    // The outcome of creating the coordinate system of a QR code on a background thread.
+    struct CoordinateSystemResult
+    {
+        winrt::Microsoft::MixedReality::QR::QRCode code;
+        winrt::guid spatialGraphNodeId;
+        winrt::Windows::Perception::Spatial::SpatialCoordinateSystem coordinateSystem;
+        uint32_t generation;
+    };
+
+    struct TrackedQRCode
+    {
+        winrt::guid spatialGraphNodeId{};
+        winrt::Windows::Perception::Spatial::SpatialCoordinateSystem coordinateSystem = nullptr;
+        bool creationPending = false;
+    };
+
+    using CoordinateSystemResultQueue = Utils::MpscQueue<CoordinateSystemResult>;
+
+    std::future<void> CreateQRCodeDeviceDependentResources();
+    void ProcessQRCodeEvents();
+
+    // Hands the instances over to Draw, together with their bounds.
+    void PublishInstances();
+    void UpdateInstanceBuffer();
+
+    // Only touches the result queue, which it keeps alive, so it may outlive the renderer.
+    static winrt::fire_and_forget CreateCoordinateSystemAsync(
+        std::shared_ptr<CoordinateSystemResultQueue> results,
+        winrt::Microsoft::MixedReality::QR::QRCode code,
+        winrt::guid spatialGraphNodeId,
+        uint32_t generation);
 
 private:
-    std::vector<VertexPositionNormalColor> m_vertices;
+    // Events of the QR code watcher and coordinate systems created in the background, both drained by Update.
+    Utils::MpscQueue<QRCodeEvent> m_qrCodeEvents;
+    std::shared_ptr<CoordinateSystemResultQueue> m_coordinateSystemResults = std::make_shared<CoordinateSystemResultQueue>();
+
+    // Incremented by Reset, events and results of earlier generations are dropped.
+    std::atomic<uint32_t> m_generation = 0;
 
-    std::map<winrt::Microsoft::MixedReality::QR::QRCode, winrt::Windows::Perception::Spatial::SpatialCoordinateSystem> m_qrCodes{};
-    std::vector<RenderableQRCode> m_renderableQrCodes{};
+    // Only accessed by Update.
+    // The per code state is counted under MemoryAccounting::Tag::QRCodes.
+    std::map<
+        winrt::Microsoft::MixedReality::QR::QRCode,
+        TrackedQRCode,
+        std::less<winrt::Microsoft::MixedReality::QR::QRCode>,
+        MemoryAccounting::TrackingAllocator<
+            std::pair<const winrt::Microsoft::MixedReality::QR::QRCode, TrackedQRCode>,
+            MemoryAccounting::Tag::QRCodes>>
+        m_qrCodes{};
+    uint32_t m_qrCodesGeneration = 0;
+    std::vector<FrustumCulling::CullingSphere> m_nextCodeBounds{};
+    MemoryAccounting::Vector<QRCodeInstance, MemoryAccounting::Tag::QRCodes> m_instances{};
 
+    // Transforms of the QR code coordinate systems to the rendering coordinate system.
+    SpatialTransformCache m_transformCache;
+
+    // Guards the state shared between Update, Draw and Reset below.
     std::mutex m_mutex;
+    std::vector<FrustumCulling::CullingSphere> m_codeBounds{};
+    FrustumCulling::VisibilityMask m_codeVisibility;
+
+    // Direct3D resources for instanced QR code rendering.
+    std::future<void> m_qrCodeResourcesCreated;
+    std::atomic<bool> m_qrCodeResourcesLoaded = false;
+    winrt::com_ptr<ID3D11VertexShader> m_qrCodeVertexShader;
+    winrt::com_ptr<ID3D11InputLayout> m_qrCodeInputLayouts[2]; // One per view count, the instance data step rate differs.
+    winrt::com_ptr<ID3D11Buffer> m_quadVertexBuffer;
+    winrt::com_ptr<ID3D11Buffer> m_instanceBuffer;
+    winrt::com_ptr<ID3D11Buffer> m_qrCodeConstantBuffer;
+    UINT m_quadVertexCount = 0;
+    UINT m_instanceBufferCapacity = 0;
+    UINT m_instanceCount = 0;
+    UINT m_qrCodeConstantBufferViewCount = 0;
 };
@@ -11,9 +11,19 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <filesystem>
 #include <future>
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
+#include <MemoryAccounting.h>
+#include <Utils.h>
+#include <d3d11/DirectXHelper.h>
+#include <holographic/ContentDepthRange.h>
 #include <holographic/DeviceResources.h>
 
 #include <winrt/Microsoft.MixedReality.SceneUnderstanding.h>
@@ -34,18 +44,212 @@ public:
 
     void Update(winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem);
 
+    // Adds the bounds of the rendered scene, as of the last Update.
+    void AddBounds(ContentDepthRange& depthRange) const;
+
     void Render(bool isStereo);
 
     void ToggleRenderingType();
 
+    // Returns false if the rendering type is None, in which case the scene does not need to be updated.
+    bool IsRenderingEnabled() const;
+
+    // Time it took to generate the geometry and create the buffers of the last scene, on a background thread.
+    float GetLastVertexBuildMilliseconds() const;
+
     void Reset();
 
+    // Writes the buffers of every scene to a cache file and, if the file exists, shows the scene stored in it until the first
+    // scene is computed, so fixed installations have their scene on the first frame of a session. Enables rendering if it is off.
+    // Relative paths are resolved against the directory of the executable on desktop and the local app data folder otherwise.
+    void EnableSceneCache(const std::wstring& filename);
+
 private:
-    struct VertexPositionUVColor
+    // The containers of the scene geometry are counted under MemoryAccounting::Tag::SceneUnderstanding.
+    template <typename T>
+    using SceneAllocator = MemoryAccounting::TrackingAllocator<T, MemoryAccounting::Tag::SceneUnderstanding>;
+    template <typename T>
+    using SceneVector = std::vector<T, SceneAllocator<T>>;
+
+    // A scene quad in the layout of the quad buffer. The vertex shader expands it to the two triangles of the quad or of its label.
+    struct QuadInstance
+    {
+        // The first three rows of the transposed object to scene transform.
+        DirectX::XMFLOAT4 objectToScene[3];
+        DirectX::XMFLOAT2 extents;
+        // The color as R8G8B8, red in the lowest byte.
+        uint32_t color;
+        // The cell of the label of the quad in the label atlas.
+        uint32_t labelCell;
+    };
+
+    // Selects whether the quads or their labels are expanded from the quad buffer.
+    struct QuadPassConstantBuffer
+    {
+        // The size of an expanded quad in object space is extents * extentsScale + size.
+        DirectX::XMFLOAT2 extentsScale;
+        DirectX::XMFLOAT2 size;
+        // Offset of the expanded quad along the normal of the scene quad.
+        float normalOffset;
+        // Non-zero if the uv coordinates address the label atlas, otherwise they are the extents of the quad.
+        uint32_t labels;
+        // Height of a cell of the label atlas and the inset of the uv coordinates of a cell, in uv units.
+        float labelCellHeight;
+        float labelCellInset;
+    };
+
+    // Vertex of the scene meshes with a position quantized to the bounds of its mesh batch.
+    struct MeshVertex
     {
-        DirectX::XMFLOAT3 pos;
-        DirectX::XMFLOAT2 uv;
-        DirectX::XMFLOAT3 color;
+        int16_t pos[4];
+    };
+
+    struct MeshBatchConstantBuffer
+    {
+        // Scene space position = positionOffset + quantized position * positionScale.
+        DirectX::XMFLOAT4 positionOffset;
+        DirectX::XMFLOAT4 positionScale;
+        DirectX::XMFLOAT4 color;
+    };
+
+    // The meshes of all scene objects of the same SceneObjectKind, in scene space and with their native indices.
+    struct SceneMeshBatch
+    {
+        SceneVector<winrt::Windows::Foundation::Numerics::float3> positions;
+        SceneVector<uint32_t> indices;
+        winrt::Windows::Foundation::Numerics::float3 color;
+    };
+
+    // The vertices of a scene, built on a background thread.
+    struct SceneVertices
+    {
+        // All scene quads. The quads and their labels are both drawn from them.
+        SceneVector<QuadInstance> quads;
+
+        // The scene meshes, one batch per SceneObjectKind.
+        std::map<winrt::Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind, SceneMeshBatch> meshBatches;
+    };
+
+    struct QuadBuffer
+    {
+        winrt::com_ptr<ID3D11Buffer> buffer;
+        winrt::com_ptr<ID3D11ShaderResourceView> view;
+        UINT quadCount = 0;
+    };
+
+    // Describes the geometry of a scene object, used to detect whether it changed between two scenes. The quads and the mesh data
+    // are hashed, so a mesh which changed in place is detected as well.
+    struct SceneObjectSignature
+    {
+        struct MeshSignature
+        {
+            winrt::guid id;
+            uint32_t vertexCount = 0;
+            uint32_t triangleIndexCount = 0;
+            // Hash of the vertex positions and the triangle indices.
+            uint64_t dataHash = 0;
+
+            bool operator==(const MeshSignature& other) const
+            {
+                return id == other.id && vertexCount == other.vertexCount && triangleIndexCount == other.triangleIndexCount &&
+                       dataHash == other.dataHash;
+            }
+        };
+
+        winrt::Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind kind;
+        winrt::Windows::Foundation::Numerics::float4x4 location;
+        uint32_t quadCount = 0;
+        // Hash of the extents and the alignment of the quads.
+        uint64_t quadHash = 0;
+        std::vector<MeshSignature> meshes;
+
+        bool operator==(const SceneObjectSignature& other) const
+        {
+            return kind == other.kind && location == other.location && quadCount == other.quadCount && quadHash == other.quadHash &&
+                   meshes == other.meshes;
+        }
+    };
+
+    // The geometry generated for a scene object, in scene space. It is reused for as long as the object does not change.
+    struct CachedSceneObject
+    {
+        SceneObjectSignature signature;
+        SceneVector<QuadInstance> quads;
+        SceneMeshBatch mesh;
+
+        // The scene update the object was last seen in.
+        uint64_t generation = 0;
+    };
+
+    // An object of the scene which is being built.
+    struct RenderedSceneObject
+    {
+        winrt::Microsoft::MixedReality::SceneUnderstanding::SceneObject object = nullptr;
+
+        // The index of the entry of the object in m_objectCache, which is stable until the cache entries of removed objects
+        // are erased.
+        size_t cacheIndex = 0;
+
+        // Whether the object is new or changed, and its geometry must be generated.
+        bool generate = false;
+    };
+
+    // The data of a mesh batch in the layout of its GPU buffers.
+    struct QuantizedMeshBatch
+    {
+        MeshBatchConstantBuffer constants;
+        SceneVector<MeshVertex> vertices;
+        SceneVector<uint32_t> indices;
+    };
+
+    // Header of a scene cache file. It is followed by the quads and the mesh batches, each
+    // stored as SceneCacheMeshBatch followed by its vertices and indices. The file is only valid for the scene origin node it
+    // was written for; the resolved coordinate system of that node places the scene in the world.
+    struct SceneCacheHeader
+    {
+        static constexpr uint32_t Magic = 0x43535553; // "SUSC"
+        static constexpr uint32_t Version = 2;
+
+        uint32_t magic = Magic;
+        uint32_t version = Version;
+        winrt::guid originSpatialGraphNodeId;
+        FrustumCulling::CullingSphere bounds;
+        uint32_t quadCount = 0;
+        uint32_t meshBatchCount = 0;
+        uint32_t reserved[2] = {};
+    };
+
+    struct SceneCacheMeshBatch
+    {
+        MeshBatchConstantBuffer constants;
+        uint32_t vertexCount = 0;
+        uint32_t indexCount = 0;
+    };
+
+    struct MeshBatchBuffers
+    {
+        winrt::com_ptr<ID3D11Buffer> vertexBuffer;
+        winrt::com_ptr<ID3D11Buffer> indexBuffer;
+        winrt::com_ptr<ID3D11Buffer> constantBuffer;
+        UINT vertexCount = 0;
+        UINT indexCount = 0;
+    };
+
+    // The GPU resources of a scene. A set is created and filled on a background thread and is immutable once it was published,
+    // so the render thread can use it without synchronization while the next set is built.
+    struct SceneBuffers
+    {
+        QuadBuffer quads;
+        std::vector<MeshBatchBuffers> meshBatches;
+
+        // The spatial graph node the vertices are relative to.
+        winrt::guid originSpatialGraphNodeId;
+
+        // Bounding sphere of all vertices in scene space, the radius is zero if there are none.
+        FrustumCulling::CullingSphere bounds = {};
+
+        // Returns the size of all buffers of the set.
+        uint64_t GetSizeInBytes() const;
     };
 
     enum RenderingType
@@ -61,60 +265,102 @@ private:
         winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem,
         winrt::Windows::Perception::Spatial::SpatialStationaryFrameOfReference lastUpdateLocation);
 
-    void AddSceneQuadsVertices(
-        const winrt::Microsoft::MixedReality::SceneUnderstanding::SceneObject& object,
-        const winrt::Windows::Foundation::Numerics::float3& color);
+    static SceneObjectSignature GetSignature(const winrt::Microsoft::MixedReality::SceneUnderstanding::SceneObject& object);
 
-    void AddSceneQuadLabelVertices(
-        const winrt::Microsoft::MixedReality::SceneUnderstanding::SceneObject& object,
-        const winrt::Windows::Foundation::Numerics::float3& color);
+    // Marks the cached geometry of the object as part of the current scene and adds the object to the rendered objects, unless
+    // its kind is not rendered. Cache entries of new objects are added here.
+    void AddSceneObject(
+        const winrt::Microsoft::MixedReality::SceneUnderstanding::SceneObject& object, std::vector<RenderedSceneObject>& objects);
 
-    void AddSceneMeshVertices(
-        const winrt::Microsoft::MixedReality::SceneUnderstanding::SceneObject& object,
-        const winrt::Windows::Foundation::Numerics::float3& color);
+    // Generates the geometry of an object which is new or changed since the previous scene. Only reads the label dictionaries, so
+    // the geometry of several objects can be generated in parallel.
+    void GenerateSceneObjectGeometry(
+        const winrt::Microsoft::MixedReality::SceneUnderstanding::SceneObject& object, CachedSceneObject& cached) const;
+
+    // Appends the cached geometry of the rendered objects to the vertices of the scene.
+    void AppendSceneObjects(const std::vector<RenderedSceneObject>& objects, SceneVertices& vertices) const;
 
-    void RenderSceneMesh(bool isStereo);
-    void RenderSceneQuads(bool isStereo);
-    void RenderSceneQuadsLabel(bool isStereo);
+    // Adds one instance per quad of the object, the color is packed like QuadInstance::color.
+    static void AddSceneQuads(
+        const winrt::Microsoft::MixedReality::SceneUnderstanding::SceneObject& object, uint32_t color, SceneVector<QuadInstance>& quads);
 
-    static void AppendQuad(
-        const winrt::Windows::Foundation::Numerics::float3 positions[4],
-        const winrt::Windows::Foundation::Numerics::float2 uvs[4],
-        const float height,
-        const float width,
+    static void AddSceneMeshVertices(
+        const winrt::Microsoft::MixedReality::SceneUnderstanding::SceneObject& object,
         const winrt::Windows::Foundation::Numerics::float3& color,
-        std::vector<VertexPositionUVColor>& vertices);
+        SceneMeshBatch& batch);
+
+    static FrustumCulling::CullingSphere ComputeBounds(const SceneVertices& vertices);
+
+    static QuantizedMeshBatch QuantizeMeshBatch(SceneMeshBatch&& batch);
+
+    QuadBuffer CreateQuadBuffer(winrt::array_view<const QuadInstance> quads);
+    MeshBatchBuffers CreateMeshBatchBuffers(
+        winrt::array_view<const MeshVertex> vertices, winrt::array_view<const uint32_t> indices, const MeshBatchConstantBuffer& constants);
 
-    // The current renderingType.
-    RenderingType m_renderingType = RenderingType::None;
+    // Replaces the cache file with the given scene. Called on the background thread which built the scene.
+    void WriteSceneCache(
+        const SceneVertices& vertices,
+        const std::vector<QuantizedMeshBatch>& meshBatches,
+        const winrt::guid& originId,
+        const FrustumCulling::CullingSphere& bounds) const;
 
-    // The vertices for all scene quads.
-    std::vector<VertexPositionUVColor> m_quadVertices;
+    // Maps the cache file and publishes its scene, unless a computed scene was published meanwhile.
+    winrt::fire_and_forget LoadSceneCacheAsync();
 
-    // The vertices for the same SceneObjectKind are stored in the same collection.
-    std::map<winrt::Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind, std::vector<VertexPositionUVColor>> m_quadLabelsVertices;
+    // Creates the buffers of the scene stored in a cache file. Returns nullptr if the file is invalid or of another version.
+    std::shared_ptr<SceneBuffers> CreateSceneBuffersFromCache(const DXHelper::FileView& file);
 
-    // The vertices for the scene mesh.
-    std::vector<VertexPositionUVColor> m_meshVertices;
+    // Releases the published scene buffers, which are rebuilt from the scene by the next Update with rendering enabled.
+    void ReleaseSceneBuffers();
+
+    // The passes, specialized on the render path variant of the camera. Each pass binds all the shader stages it uses.
+    template <typename Variant>
+    void RenderSceneMesh(const SceneBuffers& buffers, Variant variant);
+    template <typename Variant>
+    void RenderSceneQuads(const SceneBuffers& buffers, Variant variant);
+    template <typename Variant>
+    void RenderSceneQuadsLabel(const SceneBuffers& buffers, Variant variant);
+
+    // Binds the vertex shader which expands the quads of the quad buffer, with the constant buffer of the pass.
+    void SetQuadVertexShader(ID3D11DeviceContext* context, const SceneBuffers& buffers, ID3D11Buffer* passConstantBuffer);
+
+    // The current renderingType. Toggled from the key handler while the pose independent update reads it on a worker thread.
+    std::atomic<RenderingType> m_renderingType = RenderingType::None;
 
     // Cached pointer to device resources.
     std::shared_ptr<DXHelper::DeviceResources> m_deviceResources;
 
+    // The geometry of the scene objects of the previous scene by object ID. Only accessed by CreateVerticesAsync, of which at most
+    // one runs at a time.
+    Utils::GUIDFlatMap<CachedSceneObject, SceneAllocator<std::pair<GUID, CachedSceneObject>>> m_objectCache;
+    winrt::guid m_objectCacheOriginId;
+    uint64_t m_objectCacheGeneration = 0;
+
+    // The most recently published scene buffers. Only accessed with std::atomic_load and std::atomic_store.
+    std::shared_ptr<const SceneBuffers> m_sceneBuffers;
+    // The scene buffers picked up by Update, which are used by Render until the next Update.
+    std::shared_ptr<const SceneBuffers> m_renderBuffers;
+
     // Direct3D resources.
-    winrt::com_ptr<ID3D11Buffer> m_quadVerticesBuffer;
-    std::map<winrt::Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind, winrt::com_ptr<ID3D11Buffer>> m_quadLabelsVerticesBuffer;
-    winrt::com_ptr<ID3D11Buffer> m_meshVerticesBuffer;
-    winrt::com_ptr<ID3D11InputLayout> m_inputLayout = nullptr;
     winrt::com_ptr<ID3D11VertexShader> m_vertexShader = nullptr;
     winrt::com_ptr<ID3D11GeometryShader> m_geometryShader = nullptr;
     winrt::com_ptr<ID3D11PixelShader> m_quadsPixelShader = nullptr;
     winrt::com_ptr<ID3D11PixelShader> m_meshPixelShader = nullptr;
+    winrt::com_ptr<ID3D11InputLayout> m_meshInputLayout = nullptr;
+    winrt::com_ptr<ID3D11VertexShader> m_meshVertexShader = nullptr;
     winrt::com_ptr<ID3D11RasterizerState> m_rasterizerState = nullptr;
+    // Set if m_vertexShader sets the render target array index, in which case the quads and labels are drawn without geometry shader.
+    bool m_usingVprtShaders = false;
     winrt::com_ptr<ID3D11Buffer> m_modelConstantBuffer = nullptr;
+    winrt::com_ptr<ID3D11Buffer> m_quadPassConstantBuffer = nullptr;
+    winrt::com_ptr<ID3D11Buffer> m_labelPassConstantBuffer = nullptr;
 
     // True if the model constant buffer up to date.
     bool m_validSceneToRenderingTransform = false;
 
+    // The bounds of the render buffers in rendering space, valid along with the scene to rendering transform.
+    FrustumCulling::CullingSphere m_renderingBounds = {};
+
     // Variables used with the rendering loop.
     std::atomic<bool> m_loadingComplete = false;
 
@@ -125,24 +371,25 @@ private:
     bool m_verticesOutdated = false;
     // True if the scene was updated and the vertices are currently asynchronously updated.
     bool m_verticesUpdating = false;
-    // Mutex to prevent the scene from updating while the vertices are still updating.
+    // True if the geometry cache must not be used for the next scene, e.g. after a reset.
+    bool m_objectCacheOutdated = false;
+    // Mutex protecting the scene and the flags above. It is only held briefly and never while vertices are built.
     std::mutex m_mutex;
 
-    // DirectX resources for text rendering.
-    std::map<winrt::Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind, winrt::com_ptr<ID3D11Texture2D>> m_textTextures;
-    std::map<winrt::Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind, winrt::com_ptr<ID3D11ShaderResourceView>>
-        m_textShaderResourceViews;
-    std::map<winrt::Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind, winrt::com_ptr<ID3D11RenderTargetView>>
-        m_textRenderTargets;
-    std::map<winrt::Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind, winrt::com_ptr<ID2D1RenderTarget>> m_d2dTextRenderTargets;
-    std::map<winrt::Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind, winrt::com_ptr<ID2D1SolidColorBrush>> m_brushes;
-    std::map<winrt::Microsoft::MixedReality::SceneUnderstanding::SceneObjectKind, winrt::com_ptr<IDWriteTextLayout>> m_layouts;
+    std::atomic<float> m_lastVertexBuildMilliseconds = 0.0f;
+
+    // Empty if the scene cache is disabled.
+    std::filesystem::path m_sceneCachePath;
+
+    // DirectX resources for text rendering. All label names are drawn once into a single atlas texture.
+    winrt::com_ptr<ID3D11ShaderResourceView> m_textShaderResourceView;
 
     winrt::com_ptr<IDWriteTextFormat> m_textFormat = nullptr;
     winrt::com_ptr<ID3D11SamplerState> m_textSamplerState = nullptr;
     winrt::com_ptr<ID3D11PixelShader> m_labelPixelShader = nullptr;
     winrt::com_ptr<ID3D11BlendState> m_blendState = nullptr;
 
-    // The spatial coordinate system.
+    // The spatial coordinate system of the spatial graph node the render buffers are relative to.
     winrt::Windows::Perception::Spatial::SpatialCoordinateSystem m_coordinateSystem = nullptr;
+    winrt::guid m_coordinateSystemNodeId;
 };
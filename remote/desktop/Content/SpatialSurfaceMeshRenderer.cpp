@@ -13,7 +13,20 @@
 
 #include <content/SpatialSurfaceMeshRenderer.h>
 
+#include <DbgLog.h>
+#include <ThreadConfiguration.h>
 #include <d3d11/DirectXHelper.h>
+#include <holographic/FrustumCulling.h>
+#include <holographic/MeshProcessing.h>
+#include <holographic/RenderPath.h>
+
+#include <winrt/Windows.Perception.Spatial.Preview.h>
+#include <winrt/Windows.Storage.h>
+#include <winrt/Windows.UI.Input.Spatial.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
 
 using namespace winrt::Windows;
 using namespace winrt::Windows::Perception::Spatial;
@@ -25,6 +38,69 @@ using namespace Concurrency;
 bool g_freeze = false;
 bool g_freezeOnFrame = false;
 
+namespace
+{
+    // Parts closer than these distances in meters get fine and medium detail, parts further away coarse detail.
+    constexpr float FineDistance = 2.0f;
+    constexpr float MediumDistance = 5.0f;
+
+    // A part has to move this far in meters past a band boundary before its level of detail changes, so that parts near a
+    // boundary do not request new meshes over and over again.
+    constexpr float LevelOfDetailHysteresis = 0.25f;
+
+    // Parts outside of this cone around the head direction are deferred. It is wider than the field of view, so that meshes are
+    // ready by the time a part becomes visible.
+    constexpr float ViewConeHalfAngleRadians = 60.0f * 3.14159265f / 180.0f;
+
+    // Maximum number of meshes computed at the same time. Further parts wait until a computation completes, so that a burst of
+    // surface changes does not occupy all worker threads.
+    constexpr uint32_t MaxMeshRequestsInFlight = 4;
+
+    // Triangles per cubic meter the mesh is computed with.
+    double GetTriangleDensity(MeshLevelOfDetail levelOfDetail)
+    {
+        switch (levelOfDetail)
+        {
+            case MeshLevelOfDetail::Fine:
+                return 1200.0;
+            case MeshLevelOfDetail::Medium:
+                return 750.0; // from Hydrogen
+            default:
+                return 250.0;
+        }
+    }
+
+    MeshLevelOfDetail SelectLevelOfDetail(
+        const SpatialBoundingOrientedBox& bounds, const float3& headPosition, const float3& headDirection, MeshLevelOfDetail current)
+    {
+        const float3 toCenter = bounds.Center - headPosition;
+        const float centerDistance = length(toCenter);
+        const float radius = length(bounds.Extents);
+
+        // Surfaces the user is inside of are always in view.
+        if (centerDistance > radius)
+        {
+            const float angularRadius = std::asin(radius / centerDistance);
+            const float angle = std::acos(std::clamp(dot(toCenter / centerDistance, headDirection), -1.0f, 1.0f));
+            if (angle - angularRadius > ViewConeHalfAngleRadians)
+            {
+                return MeshLevelOfDetail::Deferred;
+            }
+        }
+
+        const float distance = std::max<>(centerDistance - radius, 0.0f);
+        const float fineLimit = FineDistance + (current == MeshLevelOfDetail::Fine ? LevelOfDetailHysteresis : -LevelOfDetailHysteresis);
+        const float mediumLimit =
+            MediumDistance + (current >= MeshLevelOfDetail::Medium ? LevelOfDetailHysteresis : -LevelOfDetailHysteresis);
+
+        if (distance < fineLimit)
+        {
+            return MeshLevelOfDetail::Fine;
+        }
+        return distance < mediumLimit ? MeshLevelOfDetail::Medium : MeshLevelOfDetail::Coarse;
+    }
+} // namespace
+
 // Initializes D2D resources used for text rendering.
 SpatialSurfaceMeshRenderer::SpatialSurfaceMeshRenderer(const std::shared_ptr<DXHelper::DeviceResources>& deviceResources)
     : m_deviceResources(deviceResources)
@@ -47,66 +123,345 @@ SpatialSurfaceMeshRenderer::~SpatialSurfaceMeshRenderer()
 
 std::future<void> SpatialSurfaceMeshRenderer::CreateDeviceDependentResources()
 {
-#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
-    std::wstring fileNamePrefix = L"";
-#else
-    std::wstring fileNamePrefix = L"ms-appx:///";
-#endif
+    CreateSurfaceObserver();
 
-    auto asyncAccess = Surfaces::SpatialSurfaceObserver::RequestAccessAsync();
-    asyncAccess.Completed([this](auto handler, auto asyncStatus) {
-        m_surfaceObserver = Surfaces::SpatialSurfaceObserver();
+    // After a device loss the cached meshes are the quickest way to show the mesh parts again, before their meshes are computed.
+    if (!m_meshCachePath.empty())
+    {
+        LoadMeshCache();
+    }
 
-        m_observedSurfaceChangedToken = m_surfaceObserver.ObservedSurfacesChanged(
-            [this](Surfaces::SpatialSurfaceObserver, winrt::Windows::Foundation::IInspectable const& handler) {
-                OnObservedSurfaceChanged();
-            });
-    });
+    // All shaders are requested before awaiting any of them, so their files are read in parallel.
+    DXHelper::ShaderCache& shaderCache = m_deviceResources->GetShaderCache();
+    auto vertexShader = shaderCache.GetVertexShaderAsync(L"SRMesh_VertexShader.cso");
+    auto geometryShader = shaderCache.GetGeometryShaderAsync(L"SRMesh_GeometryShader.cso");
+    auto pixelShader = shaderCache.GetPixelShaderAsync(L"SRMesh_PixelShader.cso");
+
+    // The wireframe shading needs the barycentric coordinates computed by the geometry shader, but the depth-only pass does not.
+    // On devices that can set the render target array index from the vertex shader it is drawn without geometry shader.
+    std::future<winrt::com_ptr<ID3D11VertexShader>> vprtVertexShader;
+    if (m_deviceResources->GetDeviceSupportsVprt())
+    {
+        vprtVertexShader = shaderCache.GetVertexShaderAsync(m_deviceResources->GetVertexShaderFileName(L"SRMesh_VertexShader"));
+    }
 
-    std::vector<byte> vertexShaderFileData = co_await DXHelper::ReadDataAsync(fileNamePrefix + L"SRMesh_VertexShader.cso");
-    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateVertexShader(
-        vertexShaderFileData.data(), vertexShaderFileData.size(), nullptr, m_vertexShader.put()));
+    m_vertexShader = co_await vertexShader;
+    const DXHelper::ShaderCache::Bytecode vertexShaderBytecode = co_await shaderCache.GetBytecodeAsync(L"SRMesh_VertexShader.cso");
 
-    constexpr std::array<D3D11_INPUT_ELEMENT_DESC, 1> vertexDesc = {{
+    constexpr std::array<D3D11_INPUT_ELEMENT_DESC, 2> vertexDesc = {{
         {"POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"PARTINDEX", 0, DXGI_FORMAT_R32_UINT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 2},
     }};
 
     winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateInputLayout(
         vertexDesc.data(),
         static_cast<UINT>(vertexDesc.size()),
-        vertexShaderFileData.data(),
-        static_cast<UINT>(vertexShaderFileData.size()),
+        vertexShaderBytecode.data(),
+        static_cast<UINT>(vertexShaderBytecode.size()),
         m_inputLayout.put()));
 
-    std::vector<byte> geometryShaderFileData = co_await DXHelper::ReadDataAsync(fileNamePrefix + L"SRMesh_GeometryShader.cso");
-
-    // After the pass-through geometry shader file is loaded, create the shader.
-    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateGeometryShader(
-        geometryShaderFileData.data(), geometryShaderFileData.size(), nullptr, m_geometryShader.put()));
+    constexpr std::array<D3D11_INPUT_ELEMENT_DESC, 2> monoVertexDesc = {{
+        {"POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        {"PARTINDEX", 0, DXGI_FORMAT_R32_UINT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1},
+    }};
 
-    std::vector<byte> pixelShaderFileData = co_await DXHelper::ReadDataAsync(fileNamePrefix + L"SRMesh_PixelShader.cso");
-    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreatePixelShader(
-        pixelShaderFileData.data(), pixelShaderFileData.size(), nullptr, m_pixelShader.put()));
+    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateInputLayout(
+        monoVertexDesc.data(),
+        static_cast<UINT>(monoVertexDesc.size()),
+        vertexShaderBytecode.data(),
+        static_cast<UINT>(vertexShaderBytecode.size()),
+        m_monoInputLayout.put()));
+
+    m_geometryShader = co_await geometryShader;
+    m_pixelShader = co_await pixelShader;
+    if (vprtVertexShader.valid())
+    {
+        m_vprtVertexShader = co_await vprtVertexShader;
+    }
 
-    const CD3D11_BUFFER_DESC constantBufferDesc(sizeof(SRMeshConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
-    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(&constantBufferDesc, nullptr, m_modelConstantBuffer.put()));
+    EnsurePartBufferCapacity(64);
 
     m_loadingComplete = true;
 }
 
 void SpatialSurfaceMeshRenderer::ReleaseDeviceDependentResources()
 {
-    if (m_surfaceObserver)
-    {
-        m_surfaceObserver.ObservedSurfacesChanged(m_observedSurfaceChangedToken);
-        m_surfaceObserver = nullptr;
-    }
+    ReleaseSurfaceObserver();
     m_loadingComplete = false;
     m_inputLayout = nullptr;
+    m_monoInputLayout = nullptr;
     m_vertexShader = nullptr;
+    m_vprtVertexShader = nullptr;
     m_geometryShader = nullptr;
     m_pixelShader = nullptr;
-    m_modelConstantBuffer = nullptr;
+    m_partDataBuffer = nullptr;
+    m_partDataView = nullptr;
+    m_partIndexBuffer = nullptr;
+    m_partBufferCapacity = 0;
+    m_occlusionCulledDraws.ReleaseDeviceDependentResources();
+
+    // The parts keep their surfaces, so only the meshes in view are requested again once the device is restored, a few at a time
+    // like any other mesh request. Parts out of view follow when they come into view.
+    DXHelper::VideoMemoryBudget& videoMemoryBudget = m_deviceResources->GetVideoMemoryBudget();
+    for (auto& pair : m_meshParts)
+    {
+        videoMemoryBudget.NotifyReleased(pair.second->ReleaseDeviceDependentResources());
+    }
+}
+
+void SpatialSurfaceMeshRenderer::RecreateSurfaceObserver()
+{
+    ReleaseSurfaceObserver();
+    m_meshPartsOutdated = true;
+    CreateSurfaceObserver();
+}
+
+void SpatialSurfaceMeshRenderer::CreateSurfaceObserver()
+{
+    auto asyncAccess = Surfaces::SpatialSurfaceObserver::RequestAccessAsync();
+    asyncAccess.Completed([this](auto handler, auto asyncStatus) {
+        m_surfaceObserver = Surfaces::SpatialSurfaceObserver();
+
+        m_observedSurfaceChangedToken = m_surfaceObserver.ObservedSurfacesChanged(
+            [this](Surfaces::SpatialSurfaceObserver, winrt::Windows::Foundation::IInspectable const& handler) {
+                OnObservedSurfaceChanged();
+            });
+    });
+}
+
+void SpatialSurfaceMeshRenderer::ReleaseSurfaceObserver()
+{
+    if (m_surfaceObserver)
+    {
+        m_surfaceObserver.ObservedSurfacesChanged(m_observedSurfaceChangedToken);
+        m_surfaceObserver = nullptr;
+    }
+}
+
+void SpatialSurfaceMeshRenderer::EnsurePartBufferCapacity(uint32_t partCount)
+{
+    if (partCount <= m_partBufferCapacity)
+        return;
+
+    uint32_t capacity = std::max<uint32_t>(m_partBufferCapacity, 64);
+    while (capacity < partCount)
+    {
+        capacity *= 2;
+    }
+
+    ID3D11Device* device = m_deviceResources->GetD3DDevice();
+
+    const CD3D11_BUFFER_DESC partDataBufferDesc(
+        capacity * sizeof(SRMeshConstantBuffer),
+        D3D11_BIND_SHADER_RESOURCE,
+        D3D11_USAGE_DYNAMIC,
+        D3D11_CPU_ACCESS_WRITE,
+        D3D11_RESOURCE_MISC_BUFFER_STRUCTURED,
+        sizeof(SRMeshConstantBuffer));
+    winrt::com_ptr<ID3D11Buffer> partDataBuffer;
+    winrt::check_hresult(device->CreateBuffer(&partDataBufferDesc, nullptr, partDataBuffer.put()));
+    MemoryAccounting::TrackGpuResource(MemoryAccounting::Tag::SurfaceMesh, partDataBuffer.get());
+
+    const CD3D11_SHADER_RESOURCE_VIEW_DESC partDataViewDesc(partDataBuffer.get(), DXGI_FORMAT_UNKNOWN, 0, capacity);
+    winrt::com_ptr<ID3D11ShaderResourceView> partDataView;
+    winrt::check_hresult(device->CreateShaderResourceView(partDataBuffer.get(), &partDataViewDesc, partDataView.put()));
+
+    std::vector<uint32_t> partIndices(capacity);
+    for (uint32_t i = 0; i < capacity; ++i)
+    {
+        partIndices[i] = i;
+    }
+
+    const CD3D11_BUFFER_DESC partIndexBufferDesc(capacity * sizeof(uint32_t), D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_IMMUTABLE);
+    const D3D11_SUBRESOURCE_DATA partIndexBufferData = {partIndices.data(), 0, 0};
+    winrt::com_ptr<ID3D11Buffer> partIndexBuffer;
+    winrt::check_hresult(device->CreateBuffer(&partIndexBufferDesc, &partIndexBufferData, partIndexBuffer.put()));
+    MemoryAccounting::TrackGpuResource(MemoryAccounting::Tag::SurfaceMesh, partIndexBuffer.get());
+
+    m_partDataBuffer = std::move(partDataBuffer);
+    m_partDataView = std::move(partDataView);
+    m_partIndexBuffer = std::move(partIndexBuffer);
+    m_partBufferCapacity = capacity;
+}
+
+void SpatialSurfaceMeshRenderer::EnableMeshCache(const std::wstring& directory)
+{
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+    m_meshCachePath = DXHelper::GetExecutableRelativePath(directory);
+#else
+    m_meshCachePath =
+        std::filesystem::path(winrt::Windows::Storage::ApplicationData::Current().LocalFolder().Path().c_str()) / directory;
+#endif
+
+    std::error_code error;
+    std::filesystem::create_directories(m_meshCachePath, error);
+
+    LoadMeshCache();
+}
+
+void SpatialSurfaceMeshRenderer::LoadMeshCache()
+{
+    auto loadedMeshes = std::make_shared<LoadedMeshes>();
+    std::atomic_store(&m_loadedMeshes, loadedMeshes);
+
+    winrt::com_ptr<ID3D11Device> device;
+    device.copy_from(m_deviceResources->GetD3DDevice());
+    LoadMeshCacheAsync(m_meshCachePath, std::move(device), std::move(loadedMeshes));
+}
+
+void SpatialSurfaceMeshRenderer::WriteMeshCache(
+    const winrt::guid& surfaceId,
+    winrt::Windows::Foundation::DateTime updateTime,
+    MeshLevelOfDetail levelOfDetail,
+    const SpatialCoordinateSystem& coordinateSystem,
+    const float3& vertexScale,
+    winrt::array_view<const SpatialSurfaceMeshPart::Vertex_t> vertices,
+    winrt::array_view<const uint16_t> indices) const
+{
+    // The coordinate system of the mesh is only found again in a later session through its spatial graph node.
+    Preview::SpatialGraphInteropFrameOfReferencePreview frameOfReference = nullptr;
+    try
+    {
+        frameOfReference = Preview::SpatialGraphInteropPreview::TryCreateFrameOfReference(coordinateSystem);
+    }
+    catch (const winrt::hresult_error&)
+    {
+    }
+
+    if (!frameOfReference)
+    {
+        return;
+    }
+
+    MeshCacheHeader header;
+    header.surfaceId = surfaceId;
+    header.updateTime = updateTime.time_since_epoch().count();
+    header.spatialGraphNodeId = frameOfReference.NodeId();
+    header.meshToNode = frameOfReference.CoordinateSystemToNodeTransform();
+    header.vertexScale = vertexScale;
+    header.levelOfDetail = static_cast<uint32_t>(levelOfDetail);
+    header.vertexCount = vertices.size();
+    header.indexCount = indices.size();
+
+    std::filesystem::path path = m_meshCachePath / (std::wstring(winrt::to_hstring(surfaceId)) + L".mesh");
+
+    // The previous file is only replaced once the new one was written completely.
+    std::filesystem::path temporaryPath = path;
+    temporaryPath += L".tmp";
+
+    ThreadConfiguration::BackgroundPriorityScope backgroundPriority;
+    std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+    auto write = [&file](const void* data, size_t size) {
+        file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    };
+
+    write(&header, sizeof(header));
+    write(vertices.data(), vertices.size() * sizeof(SpatialSurfaceMeshPart::Vertex_t));
+    write(indices.data(), indices.size() * sizeof(uint16_t));
+
+    file.close();
+    if (!file)
+    {
+        DebugLog(L"Failed to write the mesh cache %s.\n", temporaryPath.c_str());
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error)
+    {
+        DebugLog(L"Failed to replace the mesh cache %s.\n", path.c_str());
+    }
+}
+
+winrt::fire_and_forget SpatialSurfaceMeshRenderer::LoadMeshCacheAsync(
+    std::filesystem::path directory, winrt::com_ptr<ID3D11Device> device, std::shared_ptr<LoadedMeshes> loadedMeshes)
+{
+    co_await ThreadConfiguration::ResumeOnWorker{};
+
+    std::vector<std::filesystem::path> paths;
+    std::error_code error;
+    for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(directory, error))
+    {
+        if (entry.path().extension() == L".mesh")
+        {
+            paths.push_back(entry.path());
+        }
+    }
+
+    for (const std::filesystem::path& path : paths)
+    {
+        DXHelper::FileView file;
+        try
+        {
+            file = co_await DXHelper::MapDataAsync(path.wstring());
+        }
+        catch (...)
+        {
+            continue;
+        }
+
+        // Every section is a multiple of 4 bytes, so the vertices and the indices stay aligned.
+        const MeshCacheHeader* header = reinterpret_cast<const MeshCacheHeader*>(file.data());
+        if (file.size() < sizeof(MeshCacheHeader) || header->magic != MeshCacheHeader::Magic ||
+            header->version != MeshCacheHeader::Version || header->levelOfDetail > static_cast<uint32_t>(MeshLevelOfDetail::Fine) ||
+            header->vertexCount == 0 || header->indexCount == 0 ||
+            file.size() != sizeof(MeshCacheHeader) + uint64_t{header->vertexCount} * sizeof(SpatialSurfaceMeshPart::Vertex_t) +
+                               uint64_t{header->indexCount} * sizeof(uint16_t))
+        {
+            DebugLog(L"Ignoring the invalid or outdated mesh cache %s.\n", path.c_str());
+            continue;
+        }
+
+        LoadedMesh loadedMesh;
+        try
+        {
+            const auto* vertices = reinterpret_cast<const SpatialSurfaceMeshPart::Vertex_t*>(header + 1);
+            const auto* indices = reinterpret_cast<const uint16_t*>(vertices + header->vertexCount);
+            loadedMesh.buffers = SpatialSurfaceMeshPart::CreateMeshBuffers(
+                device.get(), vertices, header->vertexCount, indices, header->indexCount, header->vertexScale);
+            loadedMesh.buffers.coordinateSystem =
+                Preview::SpatialGraphInteropPreview::CreateCoordinateSystemForNode(header->spatialGraphNodeId);
+        }
+        catch (const winrt::hresult_error&)
+        {
+            continue;
+        }
+
+        loadedMesh.buffers.meshToCoordinateSystem = header->meshToNode;
+        loadedMesh.surfaceId = header->surfaceId;
+        loadedMesh.updateTime = winrt::Windows::Foundation::DateTime(winrt::Windows::Foundation::TimeSpan(header->updateTime));
+        loadedMesh.levelOfDetail = static_cast<MeshLevelOfDetail>(header->levelOfDetail);
+
+        // Handed over one by one, so the meshes show up while the remaining files are read.
+        std::scoped_lock lock(loadedMeshes->mutex);
+        loadedMeshes->meshes.push_back(std::move(loadedMesh));
+    }
+}
+
+void SpatialSurfaceMeshRenderer::ApplyLoadedMeshes()
+{
+    const std::shared_ptr<LoadedMeshes> loadedMeshes = std::atomic_load(&m_loadedMeshes);
+    if (!loadedMeshes)
+        return;
+
+    std::vector<LoadedMesh> meshes;
+    {
+        std::scoped_lock lock(loadedMeshes->mutex);
+        meshes.swap(loadedMeshes->meshes);
+    }
+
+    for (LoadedMesh& loadedMesh : meshes)
+    {
+        // A part the observer already provided the surface of gets a mesh computed in this session, unless it lost its mesh with
+        // the device and the cached mesh is of the same surface update.
+        SpatialSurfaceMeshPart* meshPart = GetOrCreateMeshPart(loadedMesh.surfaceId);
+        const bool surfaceCurrent = !meshPart->m_surfaceInfo || meshPart->m_surfaceUpdateTime == loadedMesh.updateTime;
+        if (surfaceCurrent && !meshPart->m_updateInProgress && !meshPart->m_vertexBuffer)
+        {
+            meshPart->ApplyCachedMesh(std::move(loadedMesh.buffers), loadedMesh.updateTime, loadedMesh.levelOfDetail);
+        }
+    }
 }
 
 void SpatialSurfaceMeshRenderer::OnObservedSurfaceChanged()
@@ -114,28 +469,74 @@ void SpatialSurfaceMeshRenderer::OnObservedSurfaceChanged()
     if (g_freeze)
         return;
 
-    m_surfaceChangedCounter++; // just for debugging purposes
-    m_sufaceChanged = true;
+    m_surfaceChangedCounter++;
+}
+
+void SpatialSurfaceMeshRenderer::ProcessSurfaceChanges()
+{
+    // first mark all as not used
+    for (auto& pair : m_meshParts)
+    {
+        pair.second->m_inUse = false;
+    }
+
+    // Parts of surfaces which were not updated only take note that they are still observed.
+    auto mapContainingSurfaceCollection = m_surfaceObserver.GetObservedSurfaces();
+    for (auto pair : mapContainingSurfaceCollection)
+    {
+        if (SpatialSurfaceMeshPart* meshPart = GetOrCreateMeshPart(pair.Key()))
+        {
+            if (meshPart->Update(pair.Value()))
+            {
+                g_freeze = g_freezeOnFrame;
+            }
+        }
+    }
+
+    // purge the ones not used
+    for (MeshPartMap::const_iterator itr = m_meshParts.cbegin(); itr != m_meshParts.cend();)
+    {
+        itr = itr->second->IsInUse() ? std::next(itr) : m_meshParts.erase(itr);
+    }
+}
+
+bool SpatialSurfaceMeshRenderer::TryBeginMeshRequest()
+{
+    uint32_t inFlight = m_meshRequestsInFlight;
+    do
+    {
+        if (inFlight >= MaxMeshRequestsInFlight)
+        {
+            return false;
+        }
+    } while (!m_meshRequestsInFlight.compare_exchange_weak(inFlight, inFlight + 1));
+
+    return true;
+}
+
+void SpatialSurfaceMeshRenderer::EndMeshRequest()
+{
+    m_meshRequestsInFlight--;
 }
 
 void SpatialSurfaceMeshRenderer::OnLocatibilityChanged(
     const SpatialLocator& spatialLocator, const winrt::Windows::Foundation::IInspectable&)
 {
+    // The parts are refreshed by the next surface change instead of being dropped right away, which also happens on every disconnect.
+    // Parts of surfaces which are no longer observed are purged then.
     SpatialLocatability locatibility = spatialLocator.Locatability();
     if (locatibility != SpatialLocatability::PositionalTrackingActive)
     {
-        m_meshParts.clear();
+        m_meshPartsOutdated = true;
     }
 }
 
 SpatialSurfaceMeshPart* SpatialSurfaceMeshRenderer::GetOrCreateMeshPart(winrt::guid id)
 {
-    GUID key = id;
-    auto found = m_meshParts.find(key);
-    if (found == m_meshParts.cend())
+    auto [found, inserted] = m_meshParts.try_emplace(id);
+    if (inserted)
     {
-        m_meshParts[id] = std::make_unique<SpatialSurfaceMeshPart>(this);
-        return m_meshParts[id].get();
+        found->second = std::make_unique<SpatialSurfaceMeshPart>(this);
     }
 
     return found->second.get();
@@ -148,6 +549,16 @@ void SpatialSurfaceMeshRenderer::Update(
     if (m_surfaceObserver == nullptr)
         return;
 
+    ApplyLoadedMeshes();
+
+    if (m_meshPartsOutdated.exchange(false))
+    {
+        for (auto& pair : m_meshParts)
+        {
+            pair.second->MarkSurfaceOutdated();
+        }
+    }
+
     // update bounding volume (every frame)
     {
         SpatialBoundingBox axisAlignedBoundingBox = {
@@ -170,94 +581,278 @@ void SpatialSurfaceMeshRenderer::Update(
         }
     }
 
-    if (m_sufaceChanged)
+    const uint32_t surfaceChangedCounter = m_surfaceChangedCounter;
+    const bool surfacesChanged = surfaceChangedCounter != m_processedSurfaceChangedCounter;
+    if (surfacesChanged)
     {
-        // first mark all as not used
-        for (auto& pair : m_meshParts)
+        m_processedSurfaceChangedCounter = surfaceChangedCounter;
+        ProcessSurfaceChanges();
+    }
+
+    // re-evaluate the level of detail of all parts periodically and whenever surfaces changed
+    {
+        using namespace std::chrono_literals;
+        auto now = std::chrono::steady_clock::now();
+
+        if (surfacesChanged || m_meshRequestsThrottled || now - m_levelOfDetailUpdateTime > 250ms)
         {
-            pair.second->m_inUse = false;
+            UpdateLevelOfDetail(timestamp, renderingCoordinateSystem);
+            m_levelOfDetailUpdateTime = now;
         }
+    }
 
-        auto mapContainingSurfaceCollection = m_surfaceObserver.GetObservedSurfaces();
+    // every frame, pick up newly ingested meshes and bring the model matrix to rendering space
+    m_frameIndex++;
+    m_transformCache.BeginFrame(renderingCoordinateSystem);
+    for (auto& pair : m_meshParts)
+    {
+        pair.second->ApplyPendingMesh();
+        pair.second->UpdateModelMatrix(m_transformCache);
+    }
+
+    EvictMeshParts();
+}
 
-        for (auto pair : mapContainingSurfaceCollection)
+std::vector<PerceptionRecording::SurfaceMeshTransform> SpatialSurfaceMeshRenderer::GetSurfaceMeshTransforms() const
+{
+    std::vector<PerceptionRecording::SurfaceMeshTransform> transforms;
+    for (const auto& pair : m_meshParts)
+    {
+        const SpatialSurfaceMeshPart* part = pair.second.get();
+        if (part->m_indexCount != 0 && part->m_boundsLocated)
         {
-            if (SpatialSurfaceMeshPart* meshPart = GetOrCreateMeshPart(pair.Key()))
-            {
-                meshPart->Update(pair.Value());
-                g_freeze = g_freezeOnFrame;
-            }
+            transforms.push_back({winrt::guid(pair.first), part->m_meshToRendering});
+        }
+    }
+    return transforms;
+}
+
+void SpatialSurfaceMeshRenderer::ReplaySurfaceMesh(const PerceptionRecording::SurfaceMesh& surfaceMesh)
+{
+    SpatialSurfaceMeshPart::MeshBuffers meshBuffers;
+    if (!surfaceMesh.vertices.empty() && !surfaceMesh.indices.empty())
+    {
+        meshBuffers = SpatialSurfaceMeshPart::CreateMeshBuffers(
+            m_deviceResources->GetD3DDevice(),
+            reinterpret_cast<const SpatialSurfaceMeshPart::Vertex_t*>(surfaceMesh.vertices.data()),
+            static_cast<uint32_t>(surfaceMesh.vertices.size()),
+            surfaceMesh.indices.data(),
+            static_cast<uint32_t>(surfaceMesh.indices.size()),
+            surfaceMesh.vertexScale);
+    }
+
+    SpatialSurfaceMeshPart* part = GetOrCreateMeshPart(surfaceMesh.surfaceId);
+    std::scoped_lock lock(part->m_pendingMeshMutex);
+    part->m_pendingMesh = std::move(meshBuffers);
+}
+
+void SpatialSurfaceMeshRenderer::ReplayUpdate(const std::vector<PerceptionRecording::SurfaceMeshTransform>& transforms)
+{
+    m_frameIndex++;
+    for (auto& pair : m_meshParts)
+    {
+        pair.second->ApplyPendingMesh();
+        pair.second->m_boundsLocated = false;
+    }
+
+    for (const PerceptionRecording::SurfaceMeshTransform& meshTransform : transforms)
+    {
+        auto found = m_meshParts.find(meshTransform.surfaceId);
+        if (found != m_meshParts.end())
+        {
+            found->second->m_boundsLocated = true;
+            found->second->SetMeshToRendering(meshTransform.meshToRendering);
         }
+    }
+}
 
-        // purge the ones not used
-        for (MeshPartMap::const_iterator itr = m_meshParts.cbegin(); itr != m_meshParts.cend();)
+void SpatialSurfaceMeshRenderer::EvictMeshParts()
+{
+    DXHelper::VideoMemoryBudget& videoMemoryBudget = m_deviceResources->GetVideoMemoryBudget();
+    if (!videoMemoryBudget.IsOverTarget())
+        return;
+
+    // Only deferred parts are evicted, so their meshes are not requested again right away.
+    m_evictableParts.clear();
+    for (auto& pair : m_meshParts)
+    {
+        SpatialSurfaceMeshPart* part = pair.second.get();
+        if (part->m_sizeInBytes != 0 && part->m_levelOfDetail == MeshLevelOfDetail::Deferred && !part->m_updateInProgress)
+            m_evictableParts.push_back(part);
+    }
+
+    std::sort(m_evictableParts.begin(), m_evictableParts.end(), [](const SpatialSurfaceMeshPart* a, const SpatialSurfaceMeshPart* b) {
+        return a->m_lastVisibleFrame < b->m_lastVisibleFrame;
+    });
+
+    for (SpatialSurfaceMeshPart* part : m_evictableParts)
+    {
+        if (!videoMemoryBudget.IsOverTarget())
+            break;
+
+        videoMemoryBudget.NotifyReleased(part->ReleaseMesh());
+    }
+}
+
+void SpatialSurfaceMeshRenderer::UpdateLevelOfDetail(
+    winrt::Windows::Perception::PerceptionTimestamp timestamp,
+    winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem)
+{
+    winrt::Windows::UI::Input::Spatial::SpatialPointerPose pose =
+        winrt::Windows::UI::Input::Spatial::SpatialPointerPose::TryGetAtTimestamp(renderingCoordinateSystem, timestamp);
+    if (!pose)
+        return;
+
+    const float3 headPosition = pose.Head().Position();
+    const float3 headDirection = pose.Head().ForwardDirection();
+
+    m_meshRequestsThrottled = false;
+    for (auto& pair : m_meshParts)
+    {
+        SpatialSurfaceMeshPart* part = pair.second.get();
+        if (!part->m_surfaceInfo)
+            continue;
+
+        MeshLevelOfDetail levelOfDetail = MeshLevelOfDetail::Deferred;
+        if (auto bounds = part->m_surfaceInfo.TryGetBounds(renderingCoordinateSystem))
         {
-            itr = itr->second->IsInUse() ? std::next(itr) : m_meshParts.erase(itr);
+            levelOfDetail = SelectLevelOfDetail(bounds.Value(), headPosition, headDirection, part->m_levelOfDetail);
         }
 
-        m_sufaceChanged = false;
+        if (!part->UpdateLevelOfDetail(levelOfDetail))
+        {
+            m_meshRequestsThrottled = true;
+        }
     }
+}
+
+void SpatialSurfaceMeshRenderer::AddBounds(ContentDepthRange& depthRange) const
+{
+    if (!m_loadingComplete)
+        return;
 
-    // every frame, bring the model matrix to rendering space
     for (auto& pair : m_meshParts)
     {
-        pair.second->UpdateModelMatrix(renderingCoordinateSystem);
+        const SpatialSurfaceMeshPart* part = pair.second.get();
+        if (part->m_indexCount != 0 && part->m_boundsLocated)
+            depthRange.Add({part->m_renderingBoundsCenter, part->m_boundsRadius});
     }
 }
 
-void SpatialSurfaceMeshRenderer::Render(bool isStereo)
+void SpatialSurfaceMeshRenderer::Render(
+    bool isStereo, winrt::Windows::Foundation::IReference<winrt::Windows::Perception::Spatial::SpatialBoundingFrustum> cullingFrustum)
 {
     if (!m_loadingComplete || m_meshParts.empty())
         return;
 
-    m_deviceResources->UseD3DDeviceContext([&](auto context) {
-        // Each vertex is one instance of the VertexPositionColorTexture struct.
-        const uint32_t stride = sizeof(SpatialSurfaceMeshPart::Vertex_t);
-        const uint32_t offset = 0;
-        ID3D11Buffer* pBufferToSet;
-        context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        context->IASetInputLayout(m_inputLayout.get());
+    // collect the renderable parts and cull all of them at once
+    m_renderableParts.clear();
+    m_renderablePartBounds.clear();
+    for (auto& pair : m_meshParts)
+    {
+        SpatialSurfaceMeshPart* part = pair.second.get();
+        if (part->m_indexCount == 0 || !part->m_boundsLocated)
+            continue;
+
+        m_renderableParts.push_back(part);
+        m_renderablePartBounds.push_back({part->m_renderingBoundsCenter, part->m_boundsRadius});
+    }
 
-        // Attach the vertex shader.
-        context->VSSetShader(m_vertexShader.get(), nullptr, 0);
-        // Apply the model constant buffer to the vertex shader.
-        pBufferToSet = m_modelConstantBuffer.get();
-        context->VSSetConstantBuffers(0, 1, &pBufferToSet);
+    FrustumCulling::FrustumPlanes(cullingFrustum).CullSpheres(m_renderablePartBounds, m_partVisibility);
 
-        // geometry shader
-        context->GSSetShader(m_geometryShader.get(), nullptr, 0);
+    m_visibleParts.clear();
+    for (size_t i = 0; i < m_renderableParts.size(); ++i)
+    {
+        if (FrustumCulling::IsVisible(m_partVisibility, i))
+        {
+            m_visibleParts.push_back(m_renderableParts[i]);
+            m_renderableParts[i]->m_lastVisibleFrame = m_frameIndex;
+        }
+    }
 
-        // pixel shader
-        context->PSSetShader(m_zfillOnly ? nullptr : m_pixelShader.get(), nullptr, 0);
+    if (m_visibleParts.empty())
+        return;
 
-        // Apply the model constant buffer to the pixel shader.
-        pBufferToSet = m_modelConstantBuffer.get();
-        context->PSSetConstantBuffers(0, 1, &pBufferToSet);
+    EnsurePartBufferCapacity(static_cast<uint32_t>(m_visibleParts.size()));
 
-        // render each mesh part
-        for (auto& pair : m_meshParts)
+    RenderPath::Dispatch(isStereo, m_zfillOnly && m_vprtVertexShader, [this](auto variant) { RenderVisibleParts(variant); });
+}
+
+template <typename Variant>
+void SpatialSurfaceMeshRenderer::RenderVisibleParts(Variant)
+{
+    m_deviceResources->UseD3DDeviceContext([&](auto context) {
+        // upload the model matrices of all visible parts at once
+        D3D11_MAPPED_SUBRESOURCE mappedPartData = {};
+        winrt::check_hresult(context->Map(m_partDataBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedPartData));
+        SRMeshConstantBuffer* partData = static_cast<SRMeshConstantBuffer*>(mappedPartData.pData);
+        for (size_t i = 0; i < m_visibleParts.size(); ++i)
         {
-            SpatialSurfaceMeshPart* part = pair.second.get();
-            if (part->m_indexCount == 0)
-                continue;
+            partData[i] = m_visibleParts[i]->m_constantBufferData;
+        }
+        context->Unmap(m_partDataBuffer.get(), 0);
 
-            if (part->m_needsUpload)
+        // cull the visible parts against the depth of the previous frame, hidden parts are drawn with an instance count of 0
+        const uint32_t instanceCount = Variant::InstanceCount;
+        DXHelper::HiZOcclusionCuller& occlusionCuller = m_deviceResources->GetOcclusionCuller();
+        const bool occlusionCulling = occlusionCuller.IsActive();
+        if (occlusionCulling)
+        {
+            m_occlusionCulledDraws.Clear();
+            for (size_t i = 0; i < m_visibleParts.size(); ++i)
             {
-                part->UploadData();
+                const SpatialSurfaceMeshPart* part = m_visibleParts[i];
+                const auto& center = part->m_renderingBoundsCenter;
+                m_occlusionCulledDraws.Add(
+                    {center.x, center.y, center.z, part->m_boundsRadius}, {part->m_indexCount, instanceCount, 0, 0, static_cast<UINT>(i)});
             }
+            m_occlusionCulledDraws.Cull(context, occlusionCuller);
+        }
 
-            // update part specific model matrix
-            context->UpdateSubresource(m_modelConstantBuffer.get(), 0, nullptr, &part->m_constantBufferData, 0, 0);
+        const UINT strides[2] = {sizeof(SpatialSurfaceMeshPart::Vertex_t), sizeof(uint32_t)};
+        const UINT offsets[2] = {0, 0};
+        context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        context->IASetInputLayout(Variant::IsStereo ? m_inputLayout.get() : m_monoInputLayout.get());
+
+        // Attach the vertex shader. Both vertex shaders have the same input signature, so the input layouts apply to both.
+        context->VSSetShader(Variant::UsesVprt ? m_vprtVertexShader.get() : m_vertexShader.get(), nullptr, 0);
+        // Apply the part data to the vertex shader.
+        ID3D11ShaderResourceView* partDataView = m_partDataView.get();
+        context->VSSetShaderResources(0, 1, &partDataView);
+
+        // geometry shader
+        context->GSSetShader(Variant::GeometryShader(m_geometryShader.get()), nullptr, 0);
 
-            ID3D11Buffer* pBufferToSet2 = part->m_vertexBuffer.get();
-            context->IASetVertexBuffers(0, 1, &pBufferToSet2, &stride, &offset);
+        // pixel shader
+        context->PSSetShader(m_zfillOnly ? nullptr : m_pixelShader.get(), nullptr, 0);
+
+        // render each visible mesh part, the n-th part reads the n-th model matrix
+        for (size_t i = 0; i < m_visibleParts.size(); ++i)
+        {
+            SpatialSurfaceMeshPart* part = m_visibleParts[i];
+
+            ID3D11Buffer* buffers[2] = {part->m_vertexBuffer.get(), m_partIndexBuffer.get()};
+            context->IASetVertexBuffers(0, 2, buffers, strides, offsets);
             context->IASetIndexBuffer(part->m_indexBuffer.get(), DXGI_FORMAT_R16_UINT, 0);
             // draw the mesh
-            context->DrawIndexedInstanced(part->m_indexCount, isStereo ? 2 : 1, 0, 0, 0);
+            if (occlusionCulling)
+            {
+                m_occlusionCulledDraws.Draw(context, i);
+            }
+            else
+            {
+                context->DrawIndexedInstanced(part->m_indexCount, instanceCount, 0, 0, static_cast<UINT>(i));
+            }
         }
 
-        // set geometry shader back
-        context->GSSetShader(nullptr, nullptr, 0);
+        // set the part data back, the geometry shader is bound by every renderer anyway
+        ID3D11ShaderResourceView* nullView = nullptr;
+        context->VSSetShaderResources(0, 1, &nullView);
+
+        // unbind the part index stream, so that other renderers do not inherit it
+        ID3D11Buffer* nullBuffer = nullptr;
+        const UINT zero = 0;
+        context->IASetVertexBuffers(1, 1, &nullBuffer, &zero, &zero);
     });
 }
 
@@ -273,39 +868,111 @@ SpatialSurfaceMeshPart::SpatialSurfaceMeshPart(SpatialSurfaceMeshRenderer* owner
     m_vertexScale.x = m_vertexScale.y = m_vertexScale.z = 1.0f;
 }
 
-void SpatialSurfaceMeshPart::Update(Surfaces::SpatialSurfaceInfo surfaceInfo)
+bool SpatialSurfaceMeshPart::Update(Surfaces::SpatialSurfaceInfo surfaceInfo)
 {
     m_inUse = true;
+
+    const winrt::Windows::Foundation::DateTime updateTime = surfaceInfo.UpdateTime();
+    if (m_surfaceInfo && updateTime == m_surfaceUpdateTime)
+    {
+        return false;
+    }
+
+    // A cached mesh of the same surface update is still current.
+    m_meshOutdated = !(m_cachedMeshUpdateTime && *m_cachedMeshUpdateTime == updateTime);
+    m_cachedMeshUpdateTime.reset();
+    m_surfaceInfo = surfaceInfo;
+    m_surfaceUpdateTime = updateTime;
+    return true;
+}
+
+void SpatialSurfaceMeshPart::MarkSurfaceOutdated()
+{
+    m_surfaceUpdateTime = {};
+}
+
+bool SpatialSurfaceMeshPart::UpdateLevelOfDetail(MeshLevelOfDetail levelOfDetail)
+{
+    m_levelOfDetail = levelOfDetail;
+
+    // Parts which are out of view keep their current mesh until they come into view again.
+    if (levelOfDetail == MeshLevelOfDetail::Deferred || m_updateInProgress)
+        return true;
+
+    if (m_meshOutdated || levelOfDetail != m_requestedLevelOfDetail)
+    {
+        if (!m_owner->TryBeginMeshRequest())
+            return false;
+
+        RequestMesh(levelOfDetail);
+    }
+    return true;
+}
+
+void SpatialSurfaceMeshPart::RequestMesh(MeshLevelOfDetail levelOfDetail)
+{
+    m_meshOutdated = false;
+    m_requestedLevelOfDetail = levelOfDetail;
+
     m_updateInProgress = true;
-    double TriangleDensity = 750.0; // from Hydrogen
-    auto asyncOpertation = surfaceInfo.TryComputeLatestMeshAsync(TriangleDensity);
-    asyncOpertation.Completed([this](winrt::Windows::Foundation::IAsyncOperation<Surfaces::SpatialSurfaceMesh> result, auto asyncStatus) {
-        Surfaces::SpatialSurfaceMesh mesh = result.GetResults();
-        UpdateMesh(mesh);
-        m_updateInProgress = false;
+    auto asyncOpertation = m_surfaceInfo.TryComputeLatestMeshAsync(GetTriangleDensity(levelOfDetail));
+    // The mesh is ingested into GPU buffers on a content worker thread, not on the system thread which completed the request.
+    asyncOpertation.Completed([this, surfaceId = m_surfaceInfo.Id(), updateTime = m_surfaceUpdateTime, levelOfDetail](
+                                  winrt::Windows::Foundation::IAsyncOperation<Surfaces::SpatialSurfaceMesh> result, auto asyncStatus) {
+        ThreadConfiguration::PostToWorker([this, result, asyncStatus, surfaceId, updateTime, levelOfDetail]() {
+            if (asyncStatus == winrt::Windows::Foundation::AsyncStatus::Completed)
+            {
+                // The mesh is null if the surface is no longer observed.
+                if (Surfaces::SpatialSurfaceMesh mesh = result.GetResults())
+                {
+                    UpdateMesh(mesh, surfaceId, updateTime, levelOfDetail);
+                }
+            }
+
+            // The request slot has to be released before the part may be purged by the render thread.
+            m_owner->EndMeshRequest();
+            m_updateInProgress = false;
+        });
     });
 }
 
-void SpatialSurfaceMeshPart::UpdateModelMatrix(winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem)
+void SpatialSurfaceMeshPart::UpdateModelMatrix(SpatialTransformCache& transformCache)
 {
     if (m_coordinateSystem == nullptr)
         return;
 
-    auto modelTransform = m_coordinateSystem.TryGetTransformTo(renderingCoordinateSystem);
+    auto modelTransform = transformCache.TryGetTransform(m_coordinateSystem);
+    m_boundsLocated = modelTransform != nullptr;
     if (modelTransform)
     {
-        float4x4 matrixWinRt = transpose(modelTransform.Value());
-        DirectX::XMMATRIX transformMatrix = DirectX::XMLoadFloat4x4(&matrixWinRt);
-        DirectX::XMMATRIX scaleMatrix = DirectX::XMMatrixScaling(m_vertexScale.x, m_vertexScale.y, m_vertexScale.z);
-        DirectX::XMMATRIX result = DirectX::XMMatrixMultiply(transformMatrix, scaleMatrix);
-        DirectX::XMStoreFloat4x4(&m_constantBufferData.modelMatrix, result);
+        SetMeshToRendering(m_meshToCoordinateSystem * modelTransform.Value());
     }
 }
 
-void SpatialSurfaceMeshPart::UpdateMesh(Surfaces::SpatialSurfaceMesh mesh)
+void SpatialSurfaceMeshPart::SetMeshToRendering(const float4x4& meshToRendering)
 {
-    m_coordinateSystem = mesh.CoordinateSystem();
+    m_meshToRendering = meshToRendering;
+    m_renderingBoundsCenter = transform(m_boundsCenter, meshToRendering);
+
+    float4x4 matrixWinRt = transpose(meshToRendering);
+    DirectX::XMMATRIX transformMatrix = DirectX::XMLoadFloat4x4(&matrixWinRt);
+    DirectX::XMMATRIX scaleMatrix = DirectX::XMMatrixScaling(m_vertexScale.x, m_vertexScale.y, m_vertexScale.z);
+    DirectX::XMMATRIX result = DirectX::XMMatrixMultiply(transformMatrix, scaleMatrix);
+    DirectX::XMStoreFloat4x4(&m_constantBufferData.modelMatrix, result);
+}
 
+static_assert(
+    sizeof(SpatialSurfaceMeshPart::Vertex_t) == sizeof(MeshProcessing::PackedVertex), "Mesh processing must keep the vertex layout.");
+static_assert(
+    sizeof(SpatialSurfaceMeshPart::Vertex_t) == sizeof(PerceptionRecording::SurfaceMeshVertex),
+    "Perception recordings must keep the vertex layout.");
+
+void SpatialSurfaceMeshPart::UpdateMesh(
+    Surfaces::SpatialSurfaceMesh mesh,
+    const winrt::guid& surfaceId,
+    winrt::Windows::Foundation::DateTime updateTime,
+    MeshLevelOfDetail levelOfDetail)
+{
     Surfaces::SpatialSurfaceMeshBuffer vertexBuffer = mesh.VertexPositions();
     Surfaces::SpatialSurfaceMeshBuffer indexBuffer = mesh.TriangleIndices();
 
@@ -319,105 +986,185 @@ void SpatialSurfaceMeshPart::UpdateMesh(Surfaces::SpatialSurfaceMesh mesh)
     uint32_t indexCount = indexBuffer.ElementCount();
     assert((indexCount % 3) == 0);
 
-    if (vertexCount == 0 || indexCount == 0)
-    {
-        m_indexCount = 0;
-        return;
-    }
-
-    // convert vertices:
+    MeshBuffers meshBuffers;
+    if (vertexCount != 0 && indexCount != 0)
     {
-        Vertex_t* dest = MapVertices(vertexCount);
+        // The mesh data already has the layout used for rendering, so the GPU buffers are initialized straight from the memory of the
+        // mesh buffers. The device is free threaded, so neither a CPU copy nor an upload is left to the render thread.
         winrt::Windows::Storage::Streams::IBuffer vertexData = vertexBuffer.Data();
-        uint8_t* vertexRaw = vertexData.data();
-        int vertexStride = vertexData.Length() / vertexCount;
-        assert(vertexStride == 8); // DirectXPixelFormat::R16G16B16A16IntNormalized
-        winrt::Windows::Foundation::Numerics::float3 positionScale = mesh.VertexPositionScale();
-        m_vertexScale.x = positionScale.x;
-        m_vertexScale.y = positionScale.y;
-        m_vertexScale.z = positionScale.z;
-        memcpy(dest, vertexRaw, vertexCount * sizeof(Vertex_t));
-        UnmapVertices();
-    }
+        assert(vertexData.Length() / vertexCount == sizeof(Vertex_t)); // DirectXPixelFormat::R16G16B16A16IntNormalized
 
-    // convert indices
-    {
-        uint16_t* dest = MapIndices(indexCount);
         winrt::Windows::Storage::Streams::IBuffer indexData = indexBuffer.Data();
-        uint16_t* source = (uint16_t*)indexData.data();
-        for (uint32_t i = 0; i < indexCount; i++)
+        assert(indexData.Length() / indexCount == sizeof(uint16_t)); // DirectXPixelFormat::R16UInt
+
+        const Vertex_t* vertices = reinterpret_cast<const Vertex_t*>(vertexData.data());
+        const uint16_t* indices = reinterpret_cast<const uint16_t*>(indexData.data());
+        const float3 positionScale = mesh.VertexPositionScale();
+
+        // With a triangle budget the mesh is processed on this thread, so the render cost depends on the budget rather than on
+        // the quality of the scan. Only then a copy of the mesh data is made.
+        std::vector<MeshProcessing::PackedVertex> processedVertices;
+        std::vector<uint16_t> processedIndices;
+        if (const uint32_t triangleBudget = m_owner->m_meshTriangleBudget; triangleBudget != 0)
         {
-            assert(source[i] < vertexCount);
-            dest[i] = source[i];
+            const auto* packedVertices = reinterpret_cast<const MeshProcessing::PackedVertex*>(vertices);
+            processedVertices.assign(packedVertices, packedVertices + vertexCount);
+            processedIndices.assign(indices, indices + indexCount);
+            MeshProcessing::Process(processedVertices, processedIndices, triangleBudget, positionScale);
+
+            vertices = reinterpret_cast<const Vertex_t*>(processedVertices.data());
+            vertexCount = static_cast<uint32_t>(processedVertices.size());
+            indices = processedIndices.data();
+            indexCount = static_cast<uint32_t>(processedIndices.size());
+        }
+
+        if (indexCount != 0)
+        {
+            meshBuffers = CreateMeshBuffers(
+                m_owner->m_deviceResources->GetD3DDevice(), vertices, vertexCount, indices, indexCount, positionScale);
+
+            if (!m_owner->m_meshCachePath.empty())
+            {
+                m_owner->WriteMeshCache(
+                    surfaceId,
+                    updateTime,
+                    levelOfDetail,
+                    mesh.CoordinateSystem(),
+                    positionScale,
+                    {vertices, vertices + vertexCount},
+                    {indices, indices + indexCount});
+            }
+
+            if (m_owner->m_recorder)
+            {
+                const auto* recordedVertices = reinterpret_cast<const PerceptionRecording::SurfaceMeshVertex*>(vertices);
+                m_owner->m_recorder->WriteSurfaceMesh(
+                    surfaceId, positionScale, {recordedVertices, recordedVertices + vertexCount}, {indices, indices + indexCount});
+            }
         }
-        UnmapIndices();
     }
-    m_needsUpload = true;
-}
+    meshBuffers.coordinateSystem = mesh.CoordinateSystem();
 
-SpatialSurfaceMeshPart::Vertex_t* SpatialSurfaceMeshPart::MapVertices(uint32_t vertexCount)
-{
-    m_vertexCount = vertexCount;
-    if (vertexCount > m_vertexData.size())
-        m_vertexData.resize(vertexCount);
-    return &m_vertexData[0];
+    // Creating a buffer with initial data completes the copy before CreateBuffer returns, so publishing the buffers under the lock
+    // is all the synchronization the render thread needs. A mesh which was not picked up yet is simply replaced.
+    std::scoped_lock lock(m_pendingMeshMutex);
+    m_pendingMesh = std::move(meshBuffers);
 }
 
-void SpatialSurfaceMeshPart::UnmapVertices()
+SpatialSurfaceMeshPart::MeshBuffers SpatialSurfaceMeshPart::CreateMeshBuffers(
+    ID3D11Device* device,
+    const Vertex_t* vertices,
+    uint32_t vertexCount,
+    const uint16_t* indices,
+    uint32_t indexCount,
+    const float3& positionScale)
 {
-}
+    MeshBuffers meshBuffers;
+
+    const CD3D11_BUFFER_DESC vertexBufferDesc(vertexCount * sizeof(Vertex_t), D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_IMMUTABLE);
+    const D3D11_SUBRESOURCE_DATA vertexBufferData = {vertices, 0, 0};
+    winrt::check_hresult(device->CreateBuffer(&vertexBufferDesc, &vertexBufferData, meshBuffers.vertexBuffer.put()));
+    MemoryAccounting::TrackGpuResource(MemoryAccounting::Tag::SurfaceMesh, meshBuffers.vertexBuffer.get());
+
+    const CD3D11_BUFFER_DESC indexBufferDesc(indexCount * sizeof(uint16_t), D3D11_BIND_INDEX_BUFFER, D3D11_USAGE_IMMUTABLE);
+    const D3D11_SUBRESOURCE_DATA indexBufferData = {indices, 0, 0};
+    winrt::check_hresult(device->CreateBuffer(&indexBufferDesc, &indexBufferData, meshBuffers.indexBuffer.put()));
+    MemoryAccounting::TrackGpuResource(MemoryAccounting::Tag::SurfaceMesh, meshBuffers.indexBuffer.get());
+
+    // Bounding box of the normalized positions, which is turned into a bounding sphere for culling once the scale is known.
+    int16_t minPosition[3] = {INT16_MAX, INT16_MAX, INT16_MAX};
+    int16_t maxPosition[3] = {INT16_MIN, INT16_MIN, INT16_MIN};
+    for (uint32_t i = 0; i < vertexCount; ++i)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            minPosition[axis] = std::min<>(minPosition[axis], vertices[i].pos[axis]);
+            maxPosition[axis] = std::max<>(maxPosition[axis], vertices[i].pos[axis]);
+        }
+    }
 
-uint16_t* SpatialSurfaceMeshPart::MapIndices(uint32_t indexCount)
-{
-    m_indexCount = indexCount;
-    if (indexCount > m_indexData.size())
-        m_indexData.resize(indexCount);
-    return &m_indexData[0];
-}
+    meshBuffers.vertexScale = {positionScale.x, positionScale.y, positionScale.z};
+    meshBuffers.indexCount = indexCount;
+    meshBuffers.sizeInBytes = uint64_t{vertexCount} * sizeof(Vertex_t) + uint64_t{indexCount} * sizeof(uint16_t);
 
-void SpatialSurfaceMeshPart::UnmapIndices()
-{
+    // Positions are SNORM, so the vertex shader maps them to [-1, 1] before the scale is applied.
+    const float3 minBounds = float3(minPosition[0], minPosition[1], minPosition[2]) * positionScale / static_cast<float>(INT16_MAX);
+    const float3 maxBounds = float3(maxPosition[0], maxPosition[1], maxPosition[2]) * positionScale / static_cast<float>(INT16_MAX);
+    meshBuffers.boundsCenter = (minBounds + maxBounds) * 0.5f;
+    meshBuffers.boundsRadius = length(maxBounds - minBounds) * 0.5f;
+    return meshBuffers;
 }
 
-void SpatialSurfaceMeshPart::UploadData()
+void SpatialSurfaceMeshPart::ApplyCachedMesh(
+    MeshBuffers&& meshBuffers, winrt::Windows::Foundation::DateTime updateTime, MeshLevelOfDetail levelOfDetail)
 {
-    if (m_vertexCount > m_allocatedVertexCount)
+    // Taken over by the next ApplyPendingMesh like an ingested mesh.
     {
-        m_vertexBuffer = nullptr;
-
-        const int alignment = 1024;
-        m_allocatedVertexCount = ((m_vertexCount + alignment - 1) / alignment) * alignment; // align to reasonable size
+        std::scoped_lock lock(m_pendingMeshMutex);
+        m_pendingMesh = std::move(meshBuffers);
+    }
 
-        const int elementSize = sizeof(Vertex_t);
-        const CD3D11_BUFFER_DESC vertexBufferDesc(
-            m_allocatedVertexCount * elementSize, D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+    m_cachedMeshUpdateTime = updateTime;
+    m_requestedLevelOfDetail = levelOfDetail;
 
-        winrt::check_hresult(m_owner->m_deviceResources->GetD3DDevice()->CreateBuffer(&vertexBufferDesc, nullptr, m_vertexBuffer.put()));
+    // A part which already has its surface is not updated again, so its mesh is current right away.
+    if (m_surfaceInfo)
+    {
+        m_meshOutdated = false;
     }
+}
 
-    if (m_indexCount > m_allocatedIndexCount)
+void SpatialSurfaceMeshPart::ApplyPendingMesh()
+{
+    std::scoped_lock lock(m_pendingMeshMutex);
+    if (!m_pendingMesh)
     {
-        m_indexBuffer = nullptr;
-        const int alignment = 3 * 1024;
-        m_allocatedIndexCount = ((m_indexCount + alignment - 1) / alignment) * alignment; // align to reasonable size
-
-        const int elementSize = sizeof(uint16_t);
-        const CD3D11_BUFFER_DESC indexBufferDesc(
-            m_allocatedIndexCount * elementSize, D3D11_BIND_INDEX_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+        return;
+    }
 
-        winrt::check_hresult(m_owner->m_deviceResources->GetD3DDevice()->CreateBuffer(&indexBufferDesc, nullptr, m_indexBuffer.put()));
+    if (m_pendingMesh->vertexBuffer)
+    {
+        winrt::com_ptr<ID3D11Device> device;
+        m_pendingMesh->vertexBuffer->GetDevice(device.put());
+        if (device.get() != m_owner->m_deviceResources->GetD3DDevice())
+        {
+            m_pendingMesh.reset();
+            m_meshOutdated = true;
+            return;
+        }
     }
 
-    // upload data
-    D3D11_MAPPED_SUBRESOURCE resource;
+    m_vertexBuffer = std::move(m_pendingMesh->vertexBuffer);
+    m_indexBuffer = std::move(m_pendingMesh->indexBuffer);
+    m_indexCount = m_pendingMesh->indexCount;
+    m_sizeInBytes = m_pendingMesh->sizeInBytes;
+    m_vertexScale = m_pendingMesh->vertexScale;
+    m_coordinateSystem = m_pendingMesh->coordinateSystem;
+    m_meshToCoordinateSystem = m_pendingMesh->meshToCoordinateSystem;
+    m_boundsCenter = m_pendingMesh->boundsCenter;
+    m_boundsRadius = m_pendingMesh->boundsRadius;
+    m_pendingMesh.reset();
+}
 
-    m_owner->m_deviceResources->UseD3DDeviceContext([&](auto context) {
-        context->Map(m_vertexBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &resource);
-        memcpy(resource.pData, &m_vertexData[0], sizeof(Vertex_t) * m_vertexCount);
-        context->Unmap(m_vertexBuffer.get(), 0);
+uint64_t SpatialSurfaceMeshPart::ReleaseMesh()
+{
+    const uint64_t sizeInBytes = m_sizeInBytes;
+    m_vertexBuffer = nullptr;
+    m_indexBuffer = nullptr;
+    m_indexCount = 0;
+    m_sizeInBytes = 0;
+
+    // UpdateLevelOfDetail requests the mesh once the part is no longer deferred.
+    m_meshOutdated = true;
+    return sizeInBytes;
+}
 
-        context->Map(m_indexBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &resource);
-        memcpy(resource.pData, &m_indexData[0], sizeof(uint16_t) * m_indexCount);
-        context->Unmap(m_indexBuffer.get(), 0);
-    });
+uint64_t SpatialSurfaceMeshPart::ReleaseDeviceDependentResources()
+{
+    {
+        std::scoped_lock lock(m_pendingMeshMutex);
+        m_pendingMesh.reset();
+    }
+
+    return ReleaseMesh();
 }
@@ -11,27 +11,49 @@
 
 #pragma once
 
+#include <MemoryAccounting.h>
 #include <Utils.h>
+#include <holographic/ContentDepthRange.h>
 #include <holographic/DeviceResources.h>
+#include <holographic/FrustumCulling.h>
+#include <holographic/PerceptionRecording.h>
+#include <holographic/SpatialTransformCache.h>
 
 #include <winrt/windows.perception.spatial.surfaces.h>
 
+#include <atomic>
+#include <filesystem>
 #include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <vector>
 
 // forward
 class SpatialSurfaceMeshRenderer;
 
+// Per-part data, stored as one element of the structured buffer which holds the data of all parts drawn in a pass.
 struct SRMeshConstantBuffer
 {
     DirectX::XMFLOAT4X4 modelMatrix;
 };
 
-// Assert that the constant buffer remains 16-byte aligned (best practice).
+// Assert that the structured buffer elements remain 16-byte aligned (best practice).
 static_assert(
     (sizeof(SRMeshConstantBuffer) % (sizeof(float) * 4)) == 0,
     "SR mesh constant buffer size must be 16-byte aligned (16 bytes is the length of four floats).");
 
+// Detail a mesh part is requested with, based on its distance to the user and whether it is in view.
+enum class MeshLevelOfDetail
+{
+    // Outside of the view. Requests are deferred until the part comes into view.
+    Deferred,
+    Coarse,
+    Medium,
+    Fine,
+};
+
 // represents a single piece of mesh (SpatialSurfaceMesh)
 class SpatialSurfaceMeshPart
 {
@@ -42,9 +64,25 @@ public:
         int16_t pos[4];
     };
     SpatialSurfaceMeshPart(SpatialSurfaceMeshRenderer* owner);
-    void Update(winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceInfo surfaceInfo);
 
-    void UpdateMesh(winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceMesh mesh);
+    // Records the latest state of the surface. The mesh is requested by UpdateLevelOfDetail.
+    // Returns true if the surface is new or was updated since the last call.
+    bool Update(winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceInfo surfaceInfo);
+
+    // Requests a new mesh if the surface has changed or the part crossed into another level of detail.
+    // Returns false if a new mesh is needed but could not be requested because too many requests are in flight.
+    bool UpdateLevelOfDetail(MeshLevelOfDetail levelOfDetail);
+
+    // Ingests a computed mesh into GPU buffers and writes it to the mesh cache, if enabled. Called on the worker thread which
+    // computed the mesh, with the surface update and the level of detail the mesh was requested for.
+    void UpdateMesh(
+        winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceMesh mesh,
+        const winrt::guid& surfaceId,
+        winrt::Windows::Foundation::DateTime updateTime,
+        MeshLevelOfDetail levelOfDetail);
+
+    // Makes the next Update take over the surface info, even if the surface has not changed. The current mesh is kept until then.
+    void MarkSurfaceOutdated();
 
     bool IsInUse() const
     {
@@ -52,34 +90,90 @@ public:
     }
 
 private:
-    Vertex_t* MapVertices(uint32_t vertexCount);
-    void UnmapVertices();
-    uint16_t* MapIndices(uint32_t indexCount);
-    void UnmapIndices();
-    void UploadData();
-    void UpdateModelMatrix(winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem);
+    // GPU buffers of a mesh, created on the thread that computed the mesh.
+    struct MeshBuffers
+    {
+        winrt::com_ptr<ID3D11Buffer> vertexBuffer;
+        winrt::com_ptr<ID3D11Buffer> indexBuffer;
+        uint32_t indexCount = 0;
+        uint64_t sizeInBytes = 0;
+        DirectX::XMFLOAT3 vertexScale = {1.0f, 1.0f, 1.0f};
+        winrt::Windows::Perception::Spatial::SpatialCoordinateSystem coordinateSystem = nullptr;
+        // Places the mesh in the coordinate system, identity unless the mesh was loaded from the mesh cache.
+        winrt::Windows::Foundation::Numerics::float4x4 meshToCoordinateSystem = winrt::Windows::Foundation::Numerics::float4x4::identity();
+
+        // Bounding sphere of the vertices in the coordinate system of the mesh.
+        winrt::Windows::Foundation::Numerics::float3 boundsCenter = {0.0f, 0.0f, 0.0f};
+        float boundsRadius = 0.0f;
+    };
+
+    // Creates the GPU buffers of a mesh and its bounds. Safe to call from any thread.
+    static MeshBuffers CreateMeshBuffers(
+        ID3D11Device* device,
+        const Vertex_t* vertices,
+        uint32_t vertexCount,
+        const uint16_t* indices,
+        uint32_t indexCount,
+        const winrt::Windows::Foundation::Numerics::float3& positionScale);
+
+    void RequestMesh(MeshLevelOfDetail levelOfDetail);
+
+    // Shows a mesh read from the mesh cache until the observer provides the surface, or in place of a mesh released with the
+    // device if the part is of the same surface update. If the surface was not updated since the mesh was cached, no new mesh
+    // is requested for it.
+    void ApplyCachedMesh(MeshBuffers&& meshBuffers, winrt::Windows::Foundation::DateTime updateTime, MeshLevelOfDetail levelOfDetail);
+
+    // Takes over the buffers of the most recently ingested mesh. Called on the render thread. A mesh ingested on a device which
+    // was lost meanwhile is dropped and requested again.
+    void ApplyPendingMesh();
+
+    // Releases the buffers of the mesh, which is requested again once the part comes into view. Returns the size of the buffers.
+    uint64_t ReleaseMesh();
+
+    // Releases the buffers of the current and of the pending mesh when the device is lost. Returns the size of the buffers.
+    uint64_t ReleaseDeviceDependentResources();
+    void UpdateModelMatrix(SpatialTransformCache& transformCache);
+    void SetMeshToRendering(const winrt::Windows::Foundation::Numerics::float4x4& meshToRendering);
 
     friend class SpatialSurfaceMeshRenderer;
     SpatialSurfaceMeshRenderer* m_owner;
     bool m_inUse = true;
-    bool m_needsUpload = false;
-    bool m_updateInProgress = false;
+    std::atomic<bool> m_updateInProgress = false;
 
     GUID m_ID;
-    uint32_t m_allocatedVertexCount = 0;
-    uint32_t m_allocatedIndexCount = 0;
-    uint32_t m_vertexCount = 0;
+    winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceInfo m_surfaceInfo = nullptr;
+    winrt::Windows::Foundation::DateTime m_surfaceUpdateTime = {};
+    bool m_meshOutdated = true;
+    // Update time of the surface the cached mesh was computed for, until the observer provides the surface.
+    std::optional<winrt::Windows::Foundation::DateTime> m_cachedMeshUpdateTime;
+    MeshLevelOfDetail m_levelOfDetail = MeshLevelOfDetail::Deferred;
+    MeshLevelOfDetail m_requestedLevelOfDetail = MeshLevelOfDetail::Deferred;
+
     uint32_t m_indexCount = 0;
+    uint64_t m_sizeInBytes = 0;
     winrt::com_ptr<ID3D11Buffer> m_vertexBuffer;
     winrt::com_ptr<ID3D11Buffer> m_indexBuffer;
 
+    // The frame the part was last drawn in, which orders the parts for eviction.
+    uint64_t m_lastVisibleFrame = 0;
+
     winrt::Windows::Perception::Spatial::SpatialCoordinateSystem m_coordinateSystem = nullptr;
+    winrt::Windows::Foundation::Numerics::float4x4 m_meshToCoordinateSystem = winrt::Windows::Foundation::Numerics::float4x4::identity();
+
+    // Handoff from the mesh ingestion on the worker thread to the render thread.
+    std::mutex m_pendingMeshMutex;
+    std::optional<MeshBuffers> m_pendingMesh;
 
-    // double buffered data:
-    std::vector<Vertex_t> m_vertexData;
-    std::vector<uint16_t> m_indexData;
     SRMeshConstantBuffer m_constantBufferData;
     DirectX::XMFLOAT3 m_vertexScale;
+    winrt::Windows::Foundation::Numerics::float4x4 m_meshToRendering = winrt::Windows::Foundation::Numerics::float4x4::identity();
+
+    // Bounding sphere of the mesh in its own coordinate system and its center in the rendering coordinate system. The transform
+    // between the two is rigid, so the radius applies to both.
+    winrt::Windows::Foundation::Numerics::float3 m_boundsCenter = {0.0f, 0.0f, 0.0f};
+    winrt::Windows::Foundation::Numerics::float3 m_renderingBoundsCenter = {0.0f, 0.0f, 0.0f};
+    float m_boundsRadius = 0.0f;
+    bool m_boundsLocated = false;
 };
 
 // Renders the SR mesh
@@ -93,16 +187,136 @@ public:
         winrt::Windows::Perception::PerceptionTimestamp timestamp,
         winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem);
 
-    void Render(bool isStereo);
+    // Adds the bounds of all mesh parts which are located and have a mesh.
+    void AddBounds(ContentDepthRange& depthRange) const;
+
+    // Renders all mesh parts whose bounding sphere intersects the culling frustum. Nothing is culled if no frustum is given.
+    void Render(
+        bool isStereo, winrt::Windows::Foundation::IReference<winrt::Windows::Perception::Spatial::SpatialBoundingFrustum> cullingFrustum);
 
     std::future<void> CreateDeviceDependentResources();
     void ReleaseDeviceDependentResources();
 
+    // Renders the mesh into the depth buffer only. Rendered before the other content, it occludes the holograms behind real
+    // surfaces, whose pixels are then rejected by the early depth test and stay cleared.
+    void SetDepthOnly(bool depthOnly)
+    {
+        m_zfillOnly = depthOnly;
+    }
+
+    // Replaces the surface observer, which stops working on disconnect. The mesh parts and their GPU buffers are kept and rendered
+    // until the new observer provides their surfaces again, so the mesh shows up right after reconnecting.
+    void RecreateSurfaceObserver();
+
+    // Writes every ingested mesh to a file per surface in the directory and uploads the meshes found there, so the mesh of a known
+    // environment shows up right at the start of a session. Only surfaces which were updated since are requested again.
+    // Relative paths are resolved against the directory of the executable on desktop and the local app data folder otherwise.
+    void EnableMeshCache(const std::wstring& directory);
+
+    // Welds the vertices of every mesh, decimates it to at most triangleBudget triangles and orders it for the vertex cache before
+    // it is uploaded, see MeshProcessing. 0 uploads the meshes as computed. Applies to meshes requested after the call.
+    void SetMeshTriangleBudget(uint32_t triangleBudget)
+    {
+        m_meshTriangleBudget = triangleBudget;
+    }
+
+    // Writes every ingested mesh to the perception recording. Must be called before the first Update.
+    void SetRecorder(std::shared_ptr<PerceptionRecording::Recorder> recorder)
+    {
+        m_recorder = std::move(recorder);
+    }
+
+    // Returns where the parts with a mesh were located by the last Update, for a perception recording.
+    std::vector<PerceptionRecording::SurfaceMeshTransform> GetSurfaceMeshTransforms() const;
+
+    // Shows a recorded mesh from the next ReplayUpdate on, in place of the mesh of the surface.
+    void ReplaySurfaceMesh(const PerceptionRecording::SurfaceMesh& surfaceMesh);
+
+    // Takes the place of Update while a perception recording is replayed. Places the parts at the recorded transforms, parts
+    // without a transform in the frame are not drawn. Neither the observer nor the level of detail or the eviction are involved.
+    void ReplayUpdate(const std::vector<PerceptionRecording::SurfaceMeshTransform>& transforms);
+
 private:
+    // Header of a mesh cache file, followed by the vertices and the indices of the mesh. The mesh is placed relative to the
+    // spatial graph node of the surface it was computed for, so it is found again in later sessions.
+    struct MeshCacheHeader
+    {
+        static constexpr uint32_t Magic = 0x48534D53; // "SMSH"
+        static constexpr uint32_t Version = 1;
+
+        uint32_t magic = Magic;
+        uint32_t version = Version;
+        winrt::guid surfaceId;
+        // Update time of the surface in ticks of winrt::clock.
+        int64_t updateTime = 0;
+        winrt::guid spatialGraphNodeId;
+        winrt::Windows::Foundation::Numerics::float4x4 meshToNode;
+        winrt::Windows::Foundation::Numerics::float3 vertexScale;
+        uint32_t levelOfDetail = 0;
+        uint32_t vertexCount = 0;
+        uint32_t indexCount = 0;
+    };
+
+    struct LoadedMesh
+    {
+        winrt::guid surfaceId;
+        winrt::Windows::Foundation::DateTime updateTime;
+        MeshLevelOfDetail levelOfDetail = MeshLevelOfDetail::Deferred;
+        SpatialSurfaceMeshPart::MeshBuffers buffers;
+    };
+
+    // Meshes read by LoadMeshCacheAsync, taken over by the next Update. Shared with the loading thread, which may outlive the renderer.
+    struct LoadedMeshes
+    {
+        std::mutex mutex;
+        std::vector<LoadedMesh> meshes;
+    };
+
+    // Replaces the cache file of the surface with the mesh. Called on the worker thread which ingested the mesh.
+    void WriteMeshCache(
+        const winrt::guid& surfaceId,
+        winrt::Windows::Foundation::DateTime updateTime,
+        MeshLevelOfDetail levelOfDetail,
+        const winrt::Windows::Perception::Spatial::SpatialCoordinateSystem& coordinateSystem,
+        const winrt::Windows::Foundation::Numerics::float3& vertexScale,
+        winrt::array_view<const SpatialSurfaceMeshPart::Vertex_t> vertices,
+        winrt::array_view<const uint16_t> indices) const;
+
+    // Starts loading the mesh cache on the current device. Meshes still loading on a previous device are discarded.
+    void LoadMeshCache();
+
+    // Maps the cache files of the directory and creates the buffers of their meshes.
+    static winrt::fire_and_forget LoadMeshCacheAsync(
+        std::filesystem::path directory, winrt::com_ptr<ID3D11Device> device, std::shared_ptr<LoadedMeshes> loadedMeshes);
+
+    // Shows the loaded meshes of surfaces the observer did not provide yet, or which lost their mesh with the device.
+    void ApplyLoadedMeshes();
+
+    void CreateSurfaceObserver();
+    void ReleaseSurfaceObserver();
     void OnObservedSurfaceChanged();
+    // Synchronizes the mesh parts with the observed surfaces. Only new and updated surfaces are marked for a new mesh.
+    void ProcessSurfaceChanges();
     void OnLocatibilityChanged(
         const winrt::Windows::Perception::Spatial::SpatialLocator& spatialLocator, const winrt::Windows::Foundation::IInspectable&);
     SpatialSurfaceMeshPart* GetOrCreateMeshPart(winrt::guid id);
+    void UpdateLevelOfDetail(
+        winrt::Windows::Perception::PerceptionTimestamp timestamp,
+        winrt::Windows::Perception::Spatial::SpatialCoordinateSystem renderingCoordinateSystem);
+
+    // Releases the meshes of parts out of view while the video memory usage is over the target, the longest unseen parts first.
+    void EvictMeshParts();
+
+    // Makes sure the per-part buffers can hold the data of at least partCount parts.
+    void EnsurePartBufferCapacity(uint32_t partCount);
+
+    // Draws the visible parts, specialized on the render path variant of the pass. Only the depth-only pass uses VPRT.
+    template <typename Variant>
+    void RenderVisibleParts(Variant variant);
+
+    // Reserves one of the mesh computations which may be in flight at the same time. Returns false if all are in use.
+    bool TryBeginMeshRequest();
+    void EndMeshRequest();
 
 private:
     friend class SpatialSurfaceMeshPart;
@@ -111,25 +325,71 @@ private:
     std::shared_ptr<DXHelper::DeviceResources> m_deviceResources;
 
     // observer:
-    int m_surfaceChangedCounter = 0;
-    bool m_sufaceChanged = false;
+    // Incremented on the thread raising ObservedSurfacesChanged. Changes are processed on the render thread once the counter
+    // differs from the last processed value.
+    std::atomic<uint32_t> m_surfaceChangedCounter = 0;
+    uint32_t m_processedSurfaceChangedCounter = 0;
     winrt::Windows::Perception::Spatial::Surfaces::SpatialSurfaceObserver m_surfaceObserver = nullptr;
     winrt::event_token m_observedSurfaceChangedToken;
+    // Set when the surfaces of the mesh parts have to be taken over from the observer again. Handled on the render thread.
+    std::atomic<bool> m_meshPartsOutdated = false;
+
+    // Read by the worker threads ingesting meshes.
+    std::atomic<uint32_t> m_meshTriangleBudget = 0;
+    std::shared_ptr<PerceptionRecording::Recorder> m_recorder;
+
+    // Directory of the mesh cache, empty if it is disabled.
+    std::filesystem::path m_meshCachePath;
+    // Replaced on device restore, which may run on another thread than the render thread. Accessed with std::atomic_load/store.
+    std::shared_ptr<LoadedMeshes> m_loadedMeshes;
+
+    // Transforms of the mesh coordinate systems to the rendering coordinate system.
+    SpatialTransformCache m_transformCache;
 
     // mesh parts
-    using MeshPartMap = std::map<GUID, std::unique_ptr<SpatialSurfaceMeshPart>, Utils::GUIDComparer>;
+    template <typename T>
+    using MeshAllocator = MemoryAccounting::TrackingAllocator<T, MemoryAccounting::Tag::SurfaceMesh>;
+    using MeshPartMap = Utils::GUIDFlatMap<
+        std::unique_ptr<SpatialSurfaceMeshPart>,
+        MeshAllocator<std::pair<GUID, std::unique_ptr<SpatialSurfaceMeshPart>>>>;
     MeshPartMap m_meshParts;
 
+    // Number of TryComputeLatestMeshAsync operations which did not complete yet.
+    std::atomic<uint32_t> m_meshRequestsInFlight = 0;
+    // Set if parts are waiting for a mesh request, so that the level of detail is re-evaluated until they got one.
+    bool m_meshRequestsThrottled = false;
+
     // rendering
     bool m_zfillOnly = false;
     std::atomic<bool> m_loadingComplete = false;
+    // The part index is per-instance data. Stereo draws two instances per part, so the stereo layout advances it every second instance.
     winrt::com_ptr<ID3D11InputLayout> m_inputLayout;
+    winrt::com_ptr<ID3D11InputLayout> m_monoInputLayout;
 
     winrt::com_ptr<ID3D11VertexShader> m_vertexShader;
+    // Sets the render target array index itself, used for the depth-only pass if the device supports it.
+    winrt::com_ptr<ID3D11VertexShader> m_vprtVertexShader;
     winrt::com_ptr<ID3D11GeometryShader> m_geometryShader;
     winrt::com_ptr<ID3D11PixelShader> m_pixelShader;
 
-    winrt::com_ptr<ID3D11Buffer> m_modelConstantBuffer;
+    // Model matrices of the parts drawn in a pass, filled with a single map per pass and read by the vertex shader.
+    winrt::com_ptr<ID3D11Buffer> m_partDataBuffer;
+    winrt::com_ptr<ID3D11ShaderResourceView> m_partDataView;
+    // Holds the indices 0..capacity-1. The draw of the n-th part starts at instance n, which makes the vertex shader read element n.
+    winrt::com_ptr<ID3D11Buffer> m_partIndexBuffer;
+    // Indirect draws of the visible parts, used while occlusion culling is active.
+    DXHelper::OcclusionCulledDraws m_occlusionCulledDraws;
+    uint32_t m_partBufferCapacity = 0;
+
+    // Parts (and their bounds) which are candidates for and passed culling in the current pass. Kept as members to reuse their memory.
+    std::vector<SpatialSurfaceMeshPart*, MeshAllocator<SpatialSurfaceMeshPart*>> m_renderableParts;
+    std::vector<FrustumCulling::CullingSphere> m_renderablePartBounds;
+    FrustumCulling::VisibilityMask m_partVisibility;
+    std::vector<SpatialSurfaceMeshPart*, MeshAllocator<SpatialSurfaceMeshPart*>> m_visibleParts;
+    std::vector<SpatialSurfaceMeshPart*, MeshAllocator<SpatialSurfaceMeshPart*>> m_evictableParts;
+
+    // Incremented by every Update.
+    uint64_t m_frameIndex = 0;
 
     winrt::Windows::Perception::Spatial::SpatialLocator m_spatialLocator = nullptr;
     winrt::Windows::Perception::Spatial::SpatialLocator::LocatabilityChanged_revoker m_spatialLocatorLocabilityChangedEventRevoker;
@@ -138,4 +398,5 @@ private:
     winrt::Windows::Perception::Spatial::SpatialLocatorAttachedFrameOfReference m_attachedFrameOfReference = nullptr;
 
     std::chrono::time_point<std::chrono::steady_clock> m_boundingVolumeUpdateTime;
+    std::chrono::time_point<std::chrono::steady_clock> m_levelOfDetailUpdateTime;
 };
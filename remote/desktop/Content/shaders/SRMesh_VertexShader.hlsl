@@ -9,11 +9,8 @@
 //
 //*********************************************************
 
-// A constant buffer that stores the model transform.
-cbuffer SRMeshConstantBuffer : register(b0)
-{
-    float4x4 model;
-};
+// The model transforms of all mesh parts drawn in this pass, indexed by partIndex.
+StructuredBuffer<float4x4> models : register(t0);
 
 // A constant buffer that stores each set of view and projection matrices in column-major format.
 cbuffer ViewProjectionConstantBuffer : register(b1)
@@ -24,8 +21,9 @@ cbuffer ViewProjectionConstantBuffer : register(b1)
 // Per-vertex data used as input to the vertex shader.
 struct VertexShaderInput
 {
-    float4  pos      : POSITION;
-    uint    instId   : SV_InstanceID;
+    float4  pos       : POSITION;
+    uint    partIndex : PARTINDEX; // per-instance data, advanced once per mesh part
+    uint    instId    : SV_InstanceID;
 };
 
 // Per-vertex data passed to the geometry shader.
@@ -50,7 +48,7 @@ VertexShaderOutput main(VertexShaderInput input)
     int idx = input.instId % 2;
 
     // Transform the vertex position into world space.
-    pos = mul(pos, model);
+    pos = mul(pos, models[input.partIndex]);
 
     // Correct for perspective and project the vertex position onto the screen.
     pos = mul(pos, viewProjection[idx]);
@@ -0,0 +1,60 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// The model transforms of all mesh parts drawn in this pass, indexed by partIndex.
+StructuredBuffer<float4x4> models : register(t0);
+
+// A constant buffer that stores each set of view and projection matrices in column-major format.
+cbuffer ViewProjectionConstantBuffer : register(b1)
+{
+    float4x4 viewProjection[2];
+};
+
+// Per-vertex data used as input to the vertex shader.
+struct VertexShaderInput
+{
+    float4  pos       : POSITION;
+    uint    partIndex : PARTINDEX; // per-instance data, advanced once per mesh part
+    uint    instId    : SV_InstanceID;
+};
+
+// Per-vertex data passed to the rasterizer. Only used for the depth-only pass, which has no pixel shader.
+// Note that the render target array index is set here in the vertex shader.
+struct VertexShaderOutput
+{
+    float4  pos      : SV_POSITION;
+    uint    rtvId    : SV_RenderTargetArrayIndex; // SV_InstanceID % 2
+};
+
+// Simple shader to do vertex processing on the GPU.
+VertexShaderOutput main(VertexShaderInput input)
+{
+    VertexShaderOutput output;
+    float4 pos = float4(input.pos.xyz, 1.0f);
+
+    // Note which view this vertex has been sent to. Used for matrix lookup.
+    // Taking the modulo of the instance ID allows geometry instancing to be used
+    // along with stereo instanced drawing; in that case, two copies of each
+    // instance would be drawn, one for left and one for right.
+    int idx = input.instId % 2;
+
+    // Transform the vertex position into world space.
+    pos = mul(pos, models[input.partIndex]);
+
+    // Correct for perspective and project the vertex position onto the screen.
+    pos = mul(pos, viewProjection[idx]);
+    output.pos = pos;
+
+    // Set the render target array index.
+    output.rtvId = idx;
+
+    return output;
+}
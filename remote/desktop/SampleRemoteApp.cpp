@@ -14,6 +14,8 @@
 #include <SampleRemoteApp.h>
 
 #include <DbgLog.h>
+#include <FrameProfiler.h>
+#include <MemoryAccounting.h>
 #include <Utils.h>
 #include <d3d11/DirectXHelper.h>
 #include <holographic/RemoteWindowHolographic.h>
@@ -21,8 +23,11 @@
 
 #include <HolographicAppRemoting/Streamer.h>
 
+#include <algorithm>
 #include <iterator>
+#include <numeric>
 #include <sstream>
+#include <unordered_map>
 
 #include <DirectXColors.h>
 #include <shellapi.h>
@@ -30,6 +35,7 @@
 #include <winrt/Windows.Foundation.Metadata.h>
 #include <winrt/Windows.Perception.People.h>
 #include <winrt/Windows.Security.Authorization.AppCapabilityAccess.h>
+#include <winrt/Windows.Storage.h>
 
 using namespace concurrency;
 
@@ -64,18 +70,132 @@ namespace
 
         return L"Unknown";
     }
+
+    // Presets for the stream settings, trading quality for latency on slower networks.
+    // Returns false for unknown profile names.
+    bool ApplyStreamProfile(std::wstring_view profile, SampleRemoteApp::Options& options)
+    {
+        if (profile == L"lan")
+        {
+            options.maxBitrateKbps = 20000;
+            options.videoCodec = PreferredVideoCodec::H265;
+            options.depthDownscale = 1;
+            return true;
+        }
+
+        if (profile == L"wifi")
+        {
+            options.maxBitrateKbps = 12000;
+            options.videoCodec = PreferredVideoCodec::H265;
+            options.depthDownscale = 2;
+            return true;
+        }
+
+        if (profile == L"cellular")
+        {
+            options.maxBitrateKbps = 4000;
+            options.videoCodec = PreferredVideoCodec::H265;
+            options.depthDownscale = 4;
+            options.enableAudio = false;
+            return true;
+        }
+
+        return false;
+    }
+
+    DepthBufferStreamResolution GetDepthBufferStreamResolution(uint32_t depthDownscale)
+    {
+        switch (depthDownscale)
+        {
+            case 1:
+                return DepthBufferStreamResolution::Full_Resolution;
+            case 4:
+                return DepthBufferStreamResolution::Quarter_Resolution;
+            default:
+                return DepthBufferStreamResolution::Half_Resolution;
+        }
+    }
+
+    // Names of the content renderers, in the order of SampleRemoteApp::ContentRenderer.
+    constexpr const wchar_t* ContentRendererNames[] = {
+        L"SpinningCube", L"SceneUnderstanding", L"QRCode", L"SpatialSurfaceMesh", L"SpatialInput", L"StressTest"};
+
+    // Names of the profiler zones of the content renderers, in the order of SampleRemoteApp::ContentRenderer.
+    constexpr const char* ContentRendererZoneNames[] = {
+        "SpinningCube::Render",
+        "SceneUnderstanding::Render",
+        "QRCode::Render",
+        "SpatialSurfaceMesh::Render",
+        "SpatialInput::Render",
+        "StressTest::Render"};
+
+    // Creates the device dependent resources of a renderer on a worker thread, so after a device loss the renderers create their
+    // shaders and buffers at the same time instead of one after the other on the render thread.
+    template <typename Renderer>
+    std::future<void> CreateDeviceDependentResourcesAsync(Renderer& renderer)
+    {
+        co_await winrt::resume_background();
+        co_await renderer.CreateDeviceDependentResources();
+    }
 } // namespace
 
 SampleRemoteApp::SampleRemoteApp()
 {
+    FrameProfiler::Initialize();
+    Speech::PreloadGrammarFileAsync();
+
+#ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
+    m_customDataChannelDispatcher.Register(PlayerFrameStatisticsMessage::Type, [this](winrt::array_view<const uint8_t> message) {
+        if (message.size() == sizeof(PlayerFrameStatisticsMessage))
+        {
+            // Copied to get a properly aligned structure; the received data itself stays where the channel put it.
+            PlayerFrameStatisticsMessage statistics;
+            memcpy(&statistics, message.data(), sizeof(statistics));
+            m_bitrateController.OnPlayerFrameStatistics(statistics);
+        }
+    });
+
+    m_customDataChannelDispatcher.Register(LatencyProbeMessage::Type, [this](winrt::array_view<const uint8_t> message) {
+        // Taken first, the time handling the message takes is not part of the network latency.
+        const auto receiveTime = LatencyProbe::Clock::now();
+        if (message.size() == sizeof(LatencyProbeMessage))
+        {
+            LatencyProbeMessage probe;
+            memcpy(&probe, message.data(), sizeof(probe));
+            m_latencyProbe.OnProbeEchoed(probe, receiveTime);
+        }
+    });
+
+    m_customDataChannelDispatcher.SetDefaultHandler([](winrt::array_view<const uint8_t>) {
+        // TODO: React on data received via the custom data channel here.
+        OutputDebugString(TEXT("Response Received.\n"));
+    });
+#endif
 }
 
 SampleRemoteApp::~SampleRemoteApp()
 {
+    WaitForPoseIndependentUpdate();
+
+    {
+        std::lock_guard lock(m_poseIndependentMutex);
+        m_poseIndependentWorkerStopping = true;
+    }
+    m_poseIndependentChanged.notify_all();
+    if (m_poseIndependentWorker.joinable())
+    {
+        m_poseIndependentWorker.join();
+    }
+
     ShutdownRemoteContext();
 
     m_deviceResources->RegisterDeviceNotify(nullptr);
     UnregisterHolographicEventHandlers();
+
+    FrameProfiler::Shutdown();
+
+    // The work the content renderers posted finishes while they still exist.
+    ThreadConfiguration::Shutdown();
 }
 
 void SampleRemoteApp::SetWindow(RemoteWindowHolographic* window)
@@ -91,12 +211,64 @@ void SampleRemoteApp::SetWindow(RemoteWindowHolographic* window)
 
 void SampleRemoteApp::Tick()
 {
+    ThreadConfiguration::RegisterFrameThread();
+
+    FRAME_PROFILER_ZONE("Tick");
+
+    if (m_recreateRemoteContextPending.exchange(false))
+    {
+        // Reconnect with the stream settings chosen by the bitrate controller.
+        ShutdownRemoteContext();
+        InitializeRemoteContextAndConnectOrListen();
+    }
+
+    // Once the connection goes idle, the driver may reclaim the memory of temporary resources until the next connection.
+    {
+        std::lock_guard remoteContextLock(m_remoteContextAccess);
+        const bool streaming = m_remoteContext && m_remoteContext.ConnectionState() == ConnectionState::Connected;
+        if (m_wasStreaming && !streaming)
+        {
+            m_deviceResources->Trim();
+        }
+        m_wasStreaming = streaming;
+    }
+
+    // Requested updates wait until the access to the scene observer was granted. No scenes are computed while none is rendered.
+    if (m_sceneUpdateScheduler && m_hasSceneObserverAccess)
+    {
+        m_sceneUpdateScheduler->Tick(!m_sceneUnderstandingRenderer->IsRenderingEnabled());
+    }
+
     if (const HolographicFrame& holographicFrame = Update())
     {
         Render(holographicFrame);
     }
 }
 
+std::chrono::milliseconds SampleRemoteApp::GetIdleTimeout()
+{
+    if (m_isStandalone || m_recreateRemoteContextPending)
+    {
+        return 0ms;
+    }
+
+    {
+        std::lock_guard remoteContextLock(m_remoteContextAccess);
+        if (m_holographicSpace && m_remoteContext && m_remoteContext.ConnectionState() == ConnectionState::Connected)
+        {
+            return 0ms;
+        }
+    }
+
+    // Nothing is streamed, ticking ten times per second keeps the window title and the preview up to date.
+    return 100ms;
+}
+
+HANDLE SampleRemoteApp::GetWakeEvent()
+{
+    return m_wakeEvent.get();
+}
+
 void SampleRemoteApp::OnKeyPress(char key)
 {
     switch (key)
@@ -143,6 +315,23 @@ void SampleRemoteApp::OnKeyPress(char key)
         case 'u':
             ToggleSceneUnderstanding();
             break;
+
+        case 'r':
+            // Toggle recording all content renderers on deferred contexts.
+            m_recordOnDeferredContext.fill(!m_recordOnDeferredContext[0]);
+            break;
+
+        case 'g':
+            LogGpuTimes();
+            break;
+
+        case 'f':
+            LogCpuZones();
+            break;
+
+        case 'i':
+            LogSceneUpdateTimes();
+            break;
     }
 
     WindowUpdateTitle();
@@ -159,6 +348,8 @@ void SampleRemoteApp::OnResize(int width, int height)
 
         if (m_swapChain)
         {
+            // Resizing requires all references to the buffers to be released.
+            WindowReleaseBackBuffer();
             winrt::check_hresult(m_swapChain->ResizeBuffers(2, m_width, m_height, DXGI_FORMAT_B8G8R8A8_UNORM, 0));
         }
     }
@@ -191,6 +382,23 @@ void SampleRemoteApp::ParseLaunchArguments(std::wstring_view arguments)
 
     size_t argCount = args.size();
 #endif
+
+    // Apply the profile first, so that it can be refined with the individual stream arguments independent of their order.
+    for (int argIndex = 0; argIndex + 1 < argCount; ++argIndex)
+    {
+        std::wstring arg = args[argIndex];
+        std::transform(arg.begin(), arg.end(), arg.begin(), ::tolower);
+        if (arg == L"-profile")
+        {
+            std::wstring profile = args[argIndex + 1];
+            std::transform(profile.begin(), profile.end(), profile.begin(), ::tolower);
+            if (!ApplyStreamProfile(profile, options))
+            {
+                DebugLog(L"Unknown stream profile %s.", profile.c_str());
+            }
+        }
+    }
+
     for (int argIndex = 0; argIndex < argCount; ++argIndex)
     {
         std::wstring arg = args[argIndex];
@@ -235,317 +443,857 @@ void SampleRemoteApp::ParseLaunchArguments(std::wstring_view arguments)
                 continue;
             }
 
-            if (param == L"ephemeralport")
+            if (param == L"coldreconnect")
             {
-                options.ephemeralPort = true;
+                options.warmReconnect = false;
                 continue;
             }
 
-            if (param == L"transportport")
+            if (param == L"deferredcontexts")
+            {
+                m_recordOnDeferredContext.fill(true);
+                continue;
+            }
+
+            if (param == L"pipelineframes")
+            {
+                m_pipelineFrames = true;
+                continue;
+            }
+
+            if (param == L"fulldepthrange")
+            {
+                options.tightDepthRange = false;
+                continue;
+            }
+
+            if (param == L"meshoccluder")
+            {
+                options.meshOccluder = true;
+                continue;
+            }
+
+            if (param == L"occlusionculling")
+            {
+                options.occlusionCulling = true;
+                continue;
+            }
+
+            if (param == L"previewrate")
             {
                 if (argIndex + 1 < argCount)
                 {
-                    std::wstring transportPortStr = args[argIndex + 1];
+                    std::wstring previewRateStr = args[argIndex + 1];
                     try
                     {
-                        options.transportPort = std::stoi(transportPortStr);
+                        options.previewFrameRate = std::stoi(previewRateStr);
                     }
                     catch (const std::invalid_argument&)
                     {
-                        // Ignore invalid transport port strings.
+                        // Ignore invalid preview rate strings.
                     }
                     argIndex++;
                 }
                 continue;
             }
-        }
-
-        options.hostname = Utils::SplitHostnameAndPortString(arg, options.port);
-    }
-
-    if (!isStandalone)
-    {
-        ConfigureRemoting(options);
-        if (noUserWait)
-        {
-            InitializeRemoteContextAndConnectOrListen();
-        }
-    }
-    else
-    {
-        InitializeStandalone();
-    }
-}
-
-void SampleRemoteApp::OnRecognizedSpeech(const winrt::hstring& recognizedText)
-{
-    bool changedColor = false;
-    DirectX::XMFLOAT4 color = {1, 1, 1, 1};
-
-    if (recognizedText == L"Red")
-    {
-        color = {1, 0, 0, 1};
-        changedColor = true;
-    }
-    else if (recognizedText == L"Blue")
-    {
-        color = {0, 0, 1, 1};
-        changedColor = true;
-    }
-    else if (recognizedText == L"Green")
-    {
-        color = {0, 1, 0, 1};
-        changedColor = true;
-    }
-    else if (recognizedText == L"Default")
-    {
-        color = {1, 1, 1, 1};
-        changedColor = true;
-    }
-    else if (recognizedText == L"Aquamarine")
-    {
-        color = {0, 1, 1, 1};
-        changedColor = true;
-    }
-    else if (recognizedText == L"Load position")
-    {
-        LoadPosition();
-    }
-    else if (recognizedText == L"Save position")
-    {
-        SavePosition();
-    }
-
-    if (changedColor && m_spinningCubeRenderer)
-    {
-        m_spinningCubeRenderer->SetColorFilter(color);
-    }
-}
-
-HolographicFrame SampleRemoteApp::Update()
-{
-    auto timeDelta = std::chrono::high_resolution_clock::now() - m_windowTitleUpdateTime;
-    if (timeDelta >= 1s)
-    {
-        WindowUpdateTitle();
-
-        m_windowTitleUpdateTime = std::chrono::high_resolution_clock::now();
-        m_framesPerSecond = 0;
-    }
-
-    if (!m_holographicSpace)
-    {
-        return nullptr;
-    }
-
-    try
-    {
-        // Create the next holographic frame early.
-        HolographicFrame holographicFrame = m_holographicSpace.CreateNextFrame();
-
-        // NOTE: DXHelper::DeviceResources::Present does not wait for the frame to finish.
-        //       Instead we wait here before we do the call to CreateNextFrame on the HolographicSpace.
-        //       We do this to avoid that PeekMessage causes frame delta time spikes, say if we wait
-        //       after PeekMessage WaitForNextFrameReady will compensate any time spend in PeekMessage.
-        m_holographicSpace.WaitForNextFrameReady();
-
-        // Update to latest prediction immediately after waiting.
-        holographicFrame.UpdateCurrentPrediction();
-
-        HolographicFramePrediction prediction = holographicFrame.CurrentPrediction();
-
-        // Back buffers can change from frame to frame. Validate each buffer, and recreate resource views and depth buffers as needed.
-        m_deviceResources->EnsureCameraResources(holographicFrame, prediction);
-
-        SpatialCoordinateSystem coordinateSystem = nullptr;
-        coordinateSystem = m_referenceFrame.CoordinateSystem();
-
-        // Check for new input state since the last frame.
-        Spatial::SpatialTappedEventArgs tapped = m_spatialInputHandler->CheckForTapped();
-        if (tapped)
-        {
-            Spatial::SpatialPointerPose pointerPose = tapped.TryGetPointerPose(coordinateSystem);
-
-            // When the Tapped spatial input event is received, the sample hologram will be repositioned two meters in front of the user.
-            m_spinningCubeRenderer->PositionHologram(pointerPose);
-        }
-        else
-        {
-            static float3 initialCubePosition = float3::zero();
 
-            auto manipulationStarted = m_spatialInputHandler->CheckForManipulationStarted();
-            if (manipulationStarted)
+            if (param == L"sceneinterval")
             {
-                initialCubePosition = m_spinningCubeRenderer->GetPosition();
-                m_spinningCubeRenderer->Pause();
-            }
-            else
-            {
-                auto manipulationUpdated = m_spatialInputHandler->CheckForManipulationUpdated();
-                if (manipulationUpdated)
+                if (argIndex + 1 < argCount)
                 {
-                    auto delta = manipulationUpdated.TryGetCumulativeDelta(coordinateSystem);
-                    if (delta)
+                    std::wstring sceneIntervalStr = args[argIndex + 1];
+                    try
                     {
-                        m_spinningCubeRenderer->SetPosition(initialCubePosition + delta.Translation());
+                        options.sceneUpdateIntervalMs = std::stoi(sceneIntervalStr);
                     }
-                }
-                else
-                {
-                    switch (m_spatialInputHandler->CheckForManipulationResult())
+                    catch (const std::invalid_argument&)
                     {
-                        case SpatialInputHandler::ManipulationResult::Canceled:
-                            m_spinningCubeRenderer->SetPosition(initialCubePosition);
-                        case SpatialInputHandler::ManipulationResult::Completed:
-                            m_spinningCubeRenderer->Unpause();
-                            break;
+                        // Ignore invalid scene update interval strings.
                     }
+                    argIndex++;
                 }
+                continue;
             }
-        }
 
-        std::chrono::duration<float> timeSinceStart = std::chrono::high_resolution_clock::now() - m_startTime;
-        m_spinningCubeRenderer->Update(timeSinceStart.count(), prediction.Timestamp(), coordinateSystem);
-
-        m_sceneUnderstandingRenderer->Update(coordinateSystem);
-        m_qrCodeRenderer->Update(coordinateSystem);
-
-        if (m_spatialSurfaceMeshRenderer)
-        {
-            m_spatialSurfaceMeshRenderer->Update(prediction.Timestamp(), coordinateSystem);
-        }
-        m_spatialInputRenderer->Update(prediction.Timestamp(), coordinateSystem);
-
-        // We complete the frame update by using information about our content positioning to set the focus point.
-        if (!m_canCommitDirect3D11DepthBuffer || !m_commitDirect3D11DepthBuffer)
-        {
-            for (auto cameraPose : prediction.CameraPoses())
+            if (param == L"scenecache")
             {
-                try
+                if (argIndex + 1 < argCount)
                 {
-                    HolographicCameraRenderingParameters renderingParameters = holographicFrame.GetRenderingParameters(cameraPose);
-
-                    // Set the focus point for image stabilization to the center of the sample hologram.
-                    // NOTE: A focus point can be set for every HolographicFrame. If a focus point is set on a HolographicFrame,
-                    //       it will get transmitted to the player and will get set during the PlayerContext::BlitRemoteFrame() call.
-                    renderingParameters.SetFocusPoint(coordinateSystem, m_spinningCubeRenderer->GetPosition());
+                    options.sceneCacheFile = args[argIndex + 1];
+                    argIndex++;
                 }
-                catch (winrt::hresult_error&)
+                continue;
+            }
+
+            if (param == L"meshcache")
+            {
+                if (argIndex + 1 < argCount)
                 {
+                    options.meshCacheDirectory = args[argIndex + 1];
+                    argIndex++;
                 }
+                continue;
             }
-        }
-
-#ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
-        timeDelta = std::chrono::high_resolution_clock::now() - m_customDataChannelSendTime;
-        if (timeDelta > 5s)
-        {
-            m_customDataChannelSendTime = std::chrono::high_resolution_clock::now();
 
-            // Send ping every couple of frames if we have a custom data channel.
-            std::lock_guard lock(m_customDataChannelLock);
-            if (m_customDataChannel)
+            if (param == L"meshbudget")
             {
-                // Try to get send queue size. The send queue size returns the size of data, that has not been send yet, in bytes.
-                // A big number might indicate that more data is queued to send than the amount of data, that is actually sent.
-                // If possible skip sending data in this case, to help the queue getting smaller again.
-                uint32_t sendQueueSize = m_customDataChannel.SendQueueSize();
-
-                // Only send the packet if the send queue is smaller than 1MiB
-                if (sendQueueSize < 1 * 1024 * 1024)
+                if (argIndex + 1 < argCount)
                 {
-                    uint8_t data = 1;
-
+                    std::wstring meshBudgetStr = args[argIndex + 1];
                     try
                     {
-                        m_customDataChannel.SendData(
-                            winrt::array_view<const uint8_t>(
-                                reinterpret_cast<const uint8_t*>(&data), reinterpret_cast<const uint8_t*>(&data + 1)),
-                            true);
-                        OutputDebugString(TEXT("Request Sent.\n"));
+                        options.meshTriangleBudget = std::stoi(meshBudgetStr);
                     }
-                    catch (...)
+                    catch (const std::invalid_argument&)
                     {
-                        // SendData might throw if channel is closed, but we did not get or process the async closed event yet.
+                        // Ignore invalid triangle budget strings.
                     }
+                    argIndex++;
                 }
+                continue;
             }
-        }
-#endif
 
-        return holographicFrame;
-    }
-    catch (const winrt::hresult_error&)
-    {
+            if (param == L"adapter")
+            {
+                if (argIndex + 1 < argCount)
+                {
+                    std::wstring adapterStr = args[argIndex + 1];
+                    try
+                    {
+                        options.adapterIndex = std::stoi(adapterStr);
+                    }
+                    catch (const std::invalid_argument&)
+                    {
+                        // Ignore invalid adapter strings.
+                    }
+                    argIndex++;
+                }
+                continue;
+            }
+
+            if (param == L"latencyprobe")
+            {
+                if (argIndex + 1 < argCount)
+                {
+                    std::wstring intervalStr = args[argIndex + 1];
+                    try
+                    {
+                        options.latencyProbeIntervalMs = std::stoi(intervalStr);
+                    }
+                    catch (const std::invalid_argument&)
+                    {
+                        // Ignore invalid interval strings.
+                    }
+                    argIndex++;
+                }
+                continue;
+            }
+
+            if (param == L"stress")
+            {
+                if (argIndex + 1 < argCount)
+                {
+                    std::wstring countStr = args[argIndex + 1];
+                    try
+                    {
+                        options.stressHologramCount = std::stoi(countStr);
+                    }
+                    catch (const std::invalid_argument&)
+                    {
+                        // Ignore invalid hologram count strings.
+                    }
+                    argIndex++;
+                }
+                continue;
+            }
+
+            if (param == L"stressdistribution")
+            {
+                if (argIndex + 1 < argCount)
+                {
+                    std::wstring distribution = args[argIndex + 1];
+                    std::transform(distribution.begin(), distribution.end(), distribution.begin(), ::tolower);
+                    if (distribution == L"grid")
+                    {
+                        options.stressDistribution = StressTestRenderer::Distribution::Grid;
+                    }
+                    else if (distribution == L"sphere")
+                    {
+                        options.stressDistribution = StressTestRenderer::Distribution::Sphere;
+                    }
+                    else if (distribution == L"random")
+                    {
+                        options.stressDistribution = StressTestRenderer::Distribution::Random;
+                    }
+                    argIndex++;
+                }
+                continue;
+            }
+
+            if (param == L"stresschurn")
+            {
+                if (argIndex + 1 < argCount)
+                {
+                    std::wstring churnStr = args[argIndex + 1];
+                    try
+                    {
+                        options.stressChurnPerSecond = std::max(std::stof(churnStr), 0.0f);
+                    }
+                    catch (const std::invalid_argument&)
+                    {
+                        // Ignore invalid churn strings.
+                    }
+                    argIndex++;
+                }
+                continue;
+            }
+
+            if (param == L"stressstep")
+            {
+                if (argIndex + 1 < argCount)
+                {
+                    std::wstring stepStr = args[argIndex + 1];
+                    try
+                    {
+                        options.stressStepSeconds = std::max(std::stoi(stepStr), 1);
+                    }
+                    catch (const std::invalid_argument&)
+                    {
+                        // Ignore invalid step strings.
+                    }
+                    argIndex++;
+                }
+                continue;
+            }
+
+            if (param == L"record")
+            {
+                if (argIndex + 1 < argCount)
+                {
+                    options.perceptionRecordFile = args[argIndex + 1];
+                    argIndex++;
+                }
+                continue;
+            }
+
+            if (param == L"replay")
+            {
+                if (argIndex + 1 < argCount)
+                {
+                    options.perceptionReplayFile = args[argIndex + 1];
+                    argIndex++;
+                }
+                continue;
+            }
+
+            if (param == L"replayfast")
+            {
+                options.perceptionReplayFast = true;
+                continue;
+            }
+
+            if (param == L"secondaryscale")
+            {
+                if (argIndex + 1 < argCount)
+                {
+                    std::wstring scaleStr = args[argIndex + 1];
+                    try
+                    {
+                        options.secondaryCameraScale = std::clamp(std::stof(scaleStr), 0.1f, 1.0f);
+                    }
+                    catch (const std::invalid_argument&)
+                    {
+                        // Ignore invalid scale strings.
+                    }
+                    argIndex++;
+                }
+                continue;
+            }
+
+            if (param == L"secondaryinterval")
+            {
+                if (argIndex + 1 < argCount)
+                {
+                    std::wstring intervalStr = args[argIndex + 1];
+                    try
+                    {
+                        options.secondaryCameraFrameInterval = std::max(std::stoi(intervalStr), 1);
+                    }
+                    catch (const std::invalid_argument&)
+                    {
+                        // Ignore invalid interval strings.
+                    }
+                    argIndex++;
+                }
+                continue;
+            }
+
+            if (param == L"secondarynomesh")
+            {
+                options.secondaryCameraSurfaceMesh = false;
+                continue;
+            }
+
+            if (param == L"nommcss")
+            {
+                options.threading.mmcssFrameThread = false;
+                continue;
+            }
+
+            if (param == L"workers")
+            {
+                if (argIndex + 1 < argCount)
+                {
+                    std::wstring workersStr = args[argIndex + 1];
+                    try
+                    {
+                        options.threading.workerCount = std::max(std::stoi(workersStr), 0);
+                    }
+                    catch (const std::invalid_argument&)
+                    {
+                        // Ignore invalid worker count strings.
+                    }
+                    argIndex++;
+                }
+                continue;
+            }
+
+            if (param == L"workeraffinity")
+            {
+                if (argIndex + 1 < argCount)
+                {
+                    std::wstring affinityStr = args[argIndex + 1];
+                    try
+                    {
+                        options.threading.workerAffinityMask = std::stoull(affinityStr, nullptr, 16);
+                    }
+                    catch (const std::invalid_argument&)
+                    {
+                        // Ignore invalid affinity mask strings.
+                    }
+                    argIndex++;
+                }
+                continue;
+            }
+
+            if (param == L"bitrate")
+            {
+                if (argIndex + 1 < argCount)
+                {
+                    std::wstring bitrateStr = args[argIndex + 1];
+                    try
+                    {
+                        options.maxBitrateKbps = std::stoi(bitrateStr);
+                    }
+                    catch (const std::invalid_argument&)
+                    {
+                        // Ignore invalid bitrate strings.
+                    }
+                    argIndex++;
+                }
+                continue;
+            }
+
+            if (param == L"profile")
+            {
+                // Already applied above.
+                argIndex++;
+                continue;
+            }
+
+            if (param == L"codec")
+            {
+                if (argIndex + 1 < argCount)
+                {
+                    std::wstring codec = args[argIndex + 1];
+                    std::transform(codec.begin(), codec.end(), codec.begin(), ::tolower);
+                    if (codec == L"h264")
+                    {
+                        options.videoCodec = PreferredVideoCodec::H264;
+                    }
+                    else if (codec == L"h265")
+                    {
+                        options.videoCodec = PreferredVideoCodec::H265;
+                    }
+                    else if (codec == L"any")
+                    {
+                        options.videoCodec = PreferredVideoCodec::Any;
+                    }
+                    argIndex++;
+                }
+                continue;
+            }
+
+            if (param == L"depthresolution")
+            {
+                if (argIndex + 1 < argCount)
+                {
+                    std::wstring resolution = args[argIndex + 1];
+                    std::transform(resolution.begin(), resolution.end(), resolution.begin(), ::tolower);
+                    if (resolution == L"full")
+                    {
+                        options.depthDownscale = 1;
+                    }
+                    else if (resolution == L"half")
+                    {
+                        options.depthDownscale = 2;
+                    }
+                    else if (resolution == L"quarter")
+                    {
+                        options.depthDownscale = 4;
+                    }
+                    argIndex++;
+                }
+                continue;
+            }
+
+            if (param == L"audio")
+            {
+                options.enableAudio = true;
+                continue;
+            }
+
+            if (param == L"noaudio")
+            {
+                options.enableAudio = false;
+                continue;
+            }
+
+            if (param == L"nopreview")
+            {
+                options.showPreview = false;
+                continue;
+            }
+
+            if (param == L"ephemeralport")
+            {
+                options.ephemeralPort = true;
+                continue;
+            }
+
+            if (param == L"transportport")
+            {
+                if (argIndex + 1 < argCount)
+                {
+                    std::wstring transportPortStr = args[argIndex + 1];
+                    try
+                    {
+                        options.transportPort = std::stoi(transportPortStr);
+                    }
+                    catch (const std::invalid_argument&)
+                    {
+                        // Ignore invalid transport port strings.
+                    }
+                    argIndex++;
+                }
+                continue;
+            }
+        }
+
+        options.hostname = Utils::SplitHostnameAndPortString(arg, options.port);
+    }
+
+    ThreadConfiguration::Configure(options.threading);
+    OpenPerceptionRecording(options);
+
+    if (!isStandalone)
+    {
+        ConfigureRemoting(options);
+        if (noUserWait)
+        {
+            InitializeRemoteContextAndConnectOrListen();
+        }
+    }
+    else
+    {
+        InitializeStandalone();
+    }
+}
+
+void SampleRemoteApp::OnRecognizedSpeech(const winrt::hstring& recognizedText)
+{
+    using SpeechCommand = void (*)(SampleRemoteApp& app);
+    static const std::unordered_map<std::wstring_view, SpeechCommand> speechCommands = {
+        {L"Red", [](SampleRemoteApp& app) { app.SetCubeColorFilter({1, 0, 0, 1}); }},
+        {L"Blue", [](SampleRemoteApp& app) { app.SetCubeColorFilter({0, 0, 1, 1}); }},
+        {L"Green", [](SampleRemoteApp& app) { app.SetCubeColorFilter({0, 1, 0, 1}); }},
+        {L"Default", [](SampleRemoteApp& app) { app.SetCubeColorFilter({1, 1, 1, 1}); }},
+        {L"Aquamarine", [](SampleRemoteApp& app) { app.SetCubeColorFilter({0, 1, 1, 1}); }},
+        {L"Load position", [](SampleRemoteApp& app) { app.LoadPosition(); }},
+        {L"Save position", [](SampleRemoteApp& app) { app.SavePosition(); }},
+    };
+
+    const auto command = speechCommands.find(recognizedText);
+    if (command != speechCommands.end())
+    {
+        command->second(*this);
+    }
+}
+
+void SampleRemoteApp::SetCubeColorFilter(const DirectX::XMFLOAT4& color)
+{
+    if (m_spinningCubeRenderer)
+    {
+        m_spinningCubeRenderer->SetColorFilter(color);
+    }
+}
+
+HolographicFrame SampleRemoteApp::Update()
+{
+    FRAME_PROFILER_ZONE("Update");
+
+    auto timeDelta = std::chrono::high_resolution_clock::now() - m_windowTitleUpdateTime;
+    if (timeDelta >= 1s)
+    {
+        WindowUpdateTitle();
+
+        m_windowTitleUpdateTime = std::chrono::high_resolution_clock::now();
+        m_framesPerSecond = 0;
+
+        // Growing memory shows up in the debug output, broken down by subsystem.
+        const MemoryAccounting::Usage memoryUsage = MemoryAccounting::GetTotalUsage();
+        const uint64_t memoryBytes = memoryUsage.cpuBytes + memoryUsage.gpuBytes;
+        if (memoryBytes > m_loggedMemoryBytes + MemoryLogThresholdBytes)
+        {
+            DebugLog(L"Memory usage: %s\n", MemoryAccounting::FormatUsage().c_str());
+            m_loggedMemoryBytes = memoryBytes;
+        }
+    }
+
+    if (!m_holographicSpace)
+    {
+        return nullptr;
+    }
+
+    try
+    {
+        // Create the next holographic frame early.
+        HolographicFrame holographicFrame = nullptr;
+        {
+            FRAME_PROFILER_ZONE("CreateNextFrame");
+            holographicFrame = m_holographicSpace.CreateNextFrame();
+        }
+
+        // NOTE: DXHelper::DeviceResources::Present does not wait for the frame to finish.
+        //       Instead we wait here before we do the call to CreateNextFrame on the HolographicSpace.
+        //       We do this to avoid that PeekMessage causes frame delta time spikes, say if we wait
+        //       after PeekMessage WaitForNextFrameReady will compensate any time spend in PeekMessage.
+        {
+            FRAME_PROFILER_ZONE("WaitForNextFrameReady");
+            m_holographicSpace.WaitForNextFrameReady();
+        }
+
+        // Update to latest prediction immediately after waiting.
+        holographicFrame.UpdateCurrentPrediction();
+
+        HolographicFramePrediction prediction = holographicFrame.CurrentPrediction();
+
+        // Back buffers can change from frame to frame. Validate each buffer, and recreate resource views and depth buffers as needed.
+        {
+            FRAME_PROFILER_ZONE("EnsureCameraResources");
+            m_deviceResources->EnsureCameraResources(holographicFrame, prediction);
+        }
+
+        SpatialCoordinateSystem coordinateSystem = nullptr;
+        coordinateSystem = m_referenceFrame.CoordinateSystem();
+
+        // The animations follow the recorded time while the perception input is replayed.
+        std::chrono::duration<float> timeSinceStart = std::chrono::high_resolution_clock::now() - m_startTime;
+        if (m_perceptionReplay)
+        {
+            FRAME_PROFILER_ZONE("PerceptionReplay");
+            m_replayedFrame = &m_perceptionReplay->Advance(std::chrono::steady_clock::now(), [this](const auto& surfaceMesh) {
+                if (m_spatialSurfaceMeshRenderer)
+                {
+                    m_spatialSurfaceMeshRenderer->ReplaySurfaceMesh(surfaceMesh);
+                }
+            });
+            timeSinceStart = m_replayedFrame->time;
+        }
+        else if (m_perceptionRecorder)
+        {
+            m_perceptionRecorder->WriteFrame(std::chrono::duration_cast<std::chrono::microseconds>(timeSinceStart));
+        }
+
+        {
+            FRAME_PROFILER_ZONE("Input");
+
+            // Handle all input events received since the last frame, in the order in which they arrived.
+            static float3 initialCubePosition = float3::zero();
+            m_spatialInputHandler->DrainEvents([&](SpatialInputHandler::InputEvent&& event) {
+                switch (event.type)
+                {
+                    case SpatialInputHandler::InputEventType::Tapped:
+                        // When the Tapped spatial input event is received, the sample hologram will be repositioned two meters in
+                        // front of the user.
+                        m_spinningCubeRenderer->PositionHologram(event.tapped.TryGetPointerPose(coordinateSystem));
+                        break;
+
+                    case SpatialInputHandler::InputEventType::ManipulationStarted:
+                        initialCubePosition = m_spinningCubeRenderer->GetPosition();
+                        m_spinningCubeRenderer->Pause();
+                        break;
+
+                    case SpatialInputHandler::InputEventType::ManipulationUpdated:
+                        if (auto delta = event.manipulationUpdated.TryGetCumulativeDelta(coordinateSystem))
+                        {
+                            m_spinningCubeRenderer->SetPosition(initialCubePosition + delta.Translation());
+                        }
+                        break;
+
+                    case SpatialInputHandler::InputEventType::ManipulationCanceled:
+                        m_spinningCubeRenderer->SetPosition(initialCubePosition);
+                        [[fallthrough]];
+                    case SpatialInputHandler::InputEventType::ManipulationCompleted:
+                        m_spinningCubeRenderer->Unpause();
+                        break;
+                }
+            });
+        }
+
+        {
+            FRAME_PROFILER_ZONE("AnchorStore::Update");
+            m_anchorStore->Update(coordinateSystem);
+        }
+
+        {
+            FRAME_PROFILER_ZONE("SpinningCube::Update");
+            m_spinningCubeRenderer->Update(timeSinceStart.count(), prediction.Timestamp(), coordinateSystem);
+        }
+        if (m_stressTestRenderer)
+        {
+            FRAME_PROFILER_ZONE("StressTest::Update");
+            UpdateStressTest(timeSinceStart.count());
+        }
+
+        // With frame pipelining the pose independent update already ran during the previous frame.
+        if (m_poseIndependentUpdateStarted)
+        {
+            FRAME_PROFILER_ZONE("WaitForPoseIndependentUpdate");
+            WaitForPoseIndependentUpdate();
+        }
+        else
+        {
+            UpdatePoseIndependentContent(coordinateSystem);
+        }
+
+        if (m_perceptionReplay)
+        {
+            m_qrCodeRenderer->ReplayQRCodes(m_replayedFrame->qrCodes);
+        }
+        else if (m_perceptionRecorder)
+        {
+            m_perceptionRecorder->WriteQRCodes(m_qrCodeRenderer->GetQRCodes());
+        }
+
+        if (m_spatialSurfaceMeshRenderer)
+        {
+            FRAME_PROFILER_ZONE("SpatialSurfaceMesh::Update");
+            if (m_perceptionReplay)
+            {
+                m_spatialSurfaceMeshRenderer->ReplayUpdate(m_replayedFrame->surfaceMeshTransforms);
+            }
+            else
+            {
+                m_spatialSurfaceMeshRenderer->Update(prediction.Timestamp(), coordinateSystem);
+                if (m_perceptionRecorder)
+                {
+                    m_perceptionRecorder->WriteSurfaceMeshTransforms(m_spatialSurfaceMeshRenderer->GetSurfaceMeshTransforms());
+                }
+            }
+        }
+        {
+            FRAME_PROFILER_ZONE("SpatialInput::Update");
+            if (m_perceptionReplay)
+            {
+                m_spatialInputRenderer->ReplaySpatialInput(m_replayedFrame->spatialInput);
+            }
+            else
+            {
+                m_spatialInputRenderer->Update(prediction.Timestamp(), coordinateSystem);
+            }
+        }
+
+        if (m_options.tightDepthRange)
+        {
+            UpdateDepthRange(prediction, coordinateSystem);
+        }
+
+        // We complete the frame update by using information about our content positioning to set the focus point.
+        if (!m_canCommitDirect3D11DepthBuffer || !m_commitDirect3D11DepthBuffer)
+        {
+            for (auto cameraPose : prediction.CameraPoses())
+            {
+                try
+                {
+                    HolographicCameraRenderingParameters renderingParameters = holographicFrame.GetRenderingParameters(cameraPose);
+
+                    // Set the focus point for image stabilization to the center of the sample hologram.
+                    // NOTE: A focus point can be set for every HolographicFrame. If a focus point is set on a HolographicFrame,
+                    //       it will get transmitted to the player and will get set during the PlayerContext::BlitRemoteFrame() call.
+                    renderingParameters.SetFocusPoint(coordinateSystem, m_spinningCubeRenderer->GetPosition());
+                }
+                catch (winrt::hresult_error&)
+                {
+                }
+            }
+        }
+
+#ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
+        // The probe is flushed right below, so the send time it carries is off by the time it waits in the send queue of the
+        // channel at most, which is part of the latency anyway.
+        if (const std::optional<LatencyProbeMessage> probe = m_latencyProbe.TakeProbeToSend(LatencyProbe::Clock::now()))
+        {
+            SendCustomDataChannelMessage(
+                DataChannelSender::Lane::Unreliable,
+                winrt::array_view<const uint8_t>(reinterpret_cast<const uint8_t*>(&*probe), reinterpret_cast<const uint8_t*>(&*probe + 1)));
+        }
+
+        {
+            std::lock_guard lock(m_customDataChannelLock);
+            if (m_customDataChannel)
+            {
+                try
+                {
+                    // The send queue size is the amount of data, in bytes, which has not been sent yet. The sender only adds
+                    // to it while it is below its limit, which keeps the queue from growing when more data is produced than
+                    // the connection can carry.
+                    m_customDataChannelSender.Flush(
+                        m_customDataChannel.SendQueueSize(), [this](winrt::array_view<const uint8_t> batch, bool guaranteedDelivery) {
+                            m_customDataChannel.SendData(batch, guaranteedDelivery);
+                        });
+                }
+                catch (...)
+                {
+                    // SendData might throw if channel is closed, but we did not get or process the async closed event yet.
+                }
+            }
+            else
+            {
+                m_customDataChannelSender.Clear();
+            }
+        }
+#endif
+
+        return holographicFrame;
+    }
+    catch (const winrt::hresult_error&)
+    {
         return nullptr;
     }
 }
 
 void SampleRemoteApp::Render(HolographicFrame holographicFrame)
 {
+    FRAME_PROFILER_ZONE("Render");
+
     bool atLeastOneCameraRendered = false;
 
+    m_deviceResources->UseImmediateD3DDeviceContext(
+        [this](ID3D11DeviceContext3* context) { m_deviceResources->GetGpuTimer().BeginFrame(context); });
+
+    // Camera events are not blocked while the frame renders, cameras added or removed meanwhile are picked up next frame.
     m_deviceResources->UseHolographicCameraResources([this, holographicFrame, &atLeastOneCameraRendered](
-                                                         std::map<UINT32, std::unique_ptr<DXHelper::CameraResources>>& cameraResourceMap) {
+                                                         const DXHelper::CameraResourceSet& cameraResources) {
         holographicFrame.UpdateCurrentPrediction();
         HolographicFramePrediction prediction = holographicFrame.CurrentPrediction();
 
         SpatialCoordinateSystem coordinateSystem = nullptr;
         coordinateSystem = m_referenceFrame.CoordinateSystem();
 
+        // A replayed frame takes the place of the poses of the cameras, in the order of the camera poses.
+        const std::vector<PerceptionRecording::Camera>* replayedCameras = m_replayedFrame ? &m_replayedFrame->cameras : nullptr;
+        std::vector<std::optional<DXHelper::ViewProjectionConstantBuffer>> replayedViewProjections;
+        if (replayedCameras)
+        {
+            for (const PerceptionRecording::Camera& camera : *replayedCameras)
+            {
+                std::optional<DXHelper::ViewProjectionConstantBuffer>& viewProjection = replayedViewProjections.emplace_back();
+                if (camera.located)
+                {
+                    viewProjection.emplace();
+                    std::copy(std::begin(camera.viewProjection), std::end(camera.viewProjection), viewProjection->viewProjection);
+                }
+            }
+        }
+
+        // The view and projection matrices for each holographic camera will change
+        // every frame. Refresh the data of all cameras at once, so that only a single
+        // constant buffer update is needed per frame.
+        m_deviceResources->UpdateViewProjectionBuffers(cameraResources, prediction, coordinateSystem, replayedViewProjections);
+
+        std::vector<CameraView> cameraViews;
+
+        std::vector<PerceptionRecording::Camera> recordedCameras;
+        if (m_perceptionRecorder)
+        {
+            recordedCameras.resize(prediction.CameraPoses().Size());
+        }
+
+        // Secondary cameras which skip this frame repeat the last frame they rendered.
+        const uint32_t secondaryCameraFrameInterval = m_options.secondaryCameraFrameInterval;
+        const bool secondaryCameraFrame = secondaryCameraFrameInterval <= 1 || m_frameCount % secondaryCameraFrameInterval == 0;
+
+        size_t cameraIndex = 0;
         for (auto cameraPose : prediction.CameraPoses())
         {
+            const size_t poseIndex = cameraIndex++;
             try
             {
-                DXHelper::CameraResources* pCameraResources = cameraResourceMap[cameraPose.HolographicCamera().Id()].get();
+                DXHelper::CameraResources* pCameraResources = cameraResources.Find(cameraPose.HolographicCamera().Id());
 
                 if (pCameraResources == nullptr || pCameraResources->GetBackBufferRenderTargetView() == nullptr)
                 {
                     continue;
                 }
 
+                const bool isSecondary = pCameraResources->IsSecondary();
+                const bool repeatFrame = isSecondary && !secondaryCameraFrame && pCameraResources->HasHeldFrame();
+
                 winrt::Windows::Foundation::IReference<SpatialBoundingFrustum> cullingFrustum =
                     cameraPose.TryGetCullingFrustum(coordinateSystem);
+                if (replayedCameras && poseIndex < replayedCameras->size())
+                {
+                    const PerceptionRecording::Camera& camera = (*replayedCameras)[poseIndex];
+                    cullingFrustum = camera.hasCullingFrustum
+                                         ? winrt::Windows::Foundation::IReference<SpatialBoundingFrustum>(camera.cullingFrustum)
+                                         : nullptr;
+                }
 
                 m_deviceResources->UseD3DDeviceContext([&](ID3D11DeviceContext3* context) {
-                    // Clear the back buffer view.
-                    context->ClearRenderTargetView(pCameraResources->GetBackBufferRenderTargetView(), DirectX::Colors::Transparent);
-                    context->ClearDepthStencilView(
-                        pCameraResources->GetDepthStencilView(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
-
-                    // The view and projection matrices for each holographic camera will change
-                    // every frame. This function refreshes the data in the constant buffer for
-                    // the holographic camera indicated by cameraPose.
-                    pCameraResources->UpdateViewProjectionBuffer(m_deviceResources, cameraPose, coordinateSystem);
+                    if (repeatFrame)
+                    {
+                        pCameraResources->RestoreHeldFrame(context);
+                    }
+                    else
+                    {
+                        // Clear the back buffer view.
+                        context->ClearRenderTargetView(pCameraResources->GetBackBufferRenderTargetView(), DirectX::Colors::Transparent);
+                        context->ClearDepthStencilView(
+                            pCameraResources->GetDepthStencilView(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+                    }
 
                     // Set up the camera buffer.
                     bool cameraActive = pCameraResources->AttachViewProjectionBuffer(m_deviceResources);
 
                     // Only render world-locked content when positional tracking is active.
-                    if (cameraActive)
+                    if (cameraActive && !repeatFrame)
                     {
-                        // Set the render target, and set the depth target drawing buffer.
-                        ID3D11RenderTargetView* const targets[1] = {pCameraResources->GetBackBufferRenderTargetView()};
-                        context->OMSetRenderTargets(1, targets, pCameraResources->GetDepthStencilView());
-
-                        // Render the scene objects.
-                        m_spinningCubeRenderer->Render(pCameraResources->IsRenderingStereoscopic(), cullingFrustum);
-
-                        m_sceneUnderstandingRenderer->Render(pCameraResources->IsRenderingStereoscopic());
-                        m_qrCodeRenderer->Render(pCameraResources->IsRenderingStereoscopic(), cullingFrustum);
-
-                        if (m_spatialSurfaceMeshRenderer)
-                        {
-                            m_spatialSurfaceMeshRenderer->Render(pCameraResources->IsRenderingStereoscopic());
-                        }
-                        m_spatialInputRenderer->Render(pCameraResources->IsRenderingStereoscopic(), cullingFrustum);
+                        cameraViews.push_back({cameraPose, pCameraResources, cullingFrustum, isSecondary});
+                    }
 
-                        // Commit depth buffer if available and enabled.
-                        if (m_canCommitDirect3D11DepthBuffer && m_commitDirect3D11DepthBuffer)
+                    if (m_perceptionRecorder)
+                    {
+                        PerceptionRecording::Camera& camera = recordedCameras[poseIndex];
+                        const DXHelper::ViewProjectionConstantBuffer& viewProjection =
+                            pCameraResources->GetViewProjectionConstantBufferData();
+                        std::copy(
+                            std::begin(viewProjection.viewProjection), std::end(viewProjection.viewProjection), camera.viewProjection);
+                        camera.located = cameraActive;
+                        camera.hasCullingFrustum = cullingFrustum != nullptr;
+                        if (cullingFrustum)
                         {
-                            auto interopSurface = pCameraResources->GetDepthStencilTextureInteropObject();
-                            HolographicCameraRenderingParameters renderingParameters = holographicFrame.GetRenderingParameters(cameraPose);
-                            renderingParameters.CommitDirect3D11DepthBuffer(interopSurface);
+                            camera.cullingFrustum = cullingFrustum.Value();
                         }
                     }
                 });
@@ -556,10 +1304,90 @@ void SampleRemoteApp::Render(HolographicFrame holographicFrame)
             {
             }
         }
+
+        // Locate the hands again with the updated prediction, right before they are rendered. The poses sampled in Update are
+        // almost a frame older, by the time they are drawn. The depth range and focus point of this frame keep using the poses of
+        // Update, the difference is small enough. A replayed frame keeps its recorded poses.
+        if (!m_replayedFrame)
+        {
+            FRAME_PROFILER_ZONE("SpatialInput::LateUpdate");
+            m_spatialInputRenderer->UpdatePoses(prediction.Timestamp(), coordinateSystem);
+        }
+
+        // The cameras and the poses of the spatial input sources are recorded as they are rendered.
+        if (m_perceptionRecorder)
+        {
+            m_perceptionRecorder->WriteCameras(recordedCameras);
+            m_perceptionRecorder->WriteSpatialInput(m_spatialInputRenderer->GetSpatialInput());
+        }
+
+        // The pyramid of the previous frame only matches while a single camera renders.
+        m_deviceResources->GetOcclusionCuller().BeginFrame(m_options.occlusionCulling && cameraViews.size() == 1);
+
+        // Render the scene objects.
+        RenderContent(cameraViews);
+
+        // Keep the frames of secondary cameras which render at a reduced frame rate, the following frames repeat them.
+        if (secondaryCameraFrameInterval > 1)
+        {
+            m_deviceResources->UseD3DDeviceContext([&](ID3D11DeviceContext3* context) {
+                for (const CameraView& cameraView : cameraViews)
+                {
+                    if (cameraView.isSecondary)
+                    {
+                        cameraView.pCameraResources->HoldFrame(context);
+                    }
+                }
+            });
+        }
+
+        // Commit depth buffer if available and enabled.
+        if (m_canCommitDirect3D11DepthBuffer && m_commitDirect3D11DepthBuffer)
+        {
+            for (const CameraView& cameraView : cameraViews)
+            {
+                try
+                {
+                    auto interopSurface = cameraView.pCameraResources->GetDepthStencilTextureInteropObject();
+                    HolographicCameraRenderingParameters renderingParameters =
+                        holographicFrame.GetRenderingParameters(cameraView.cameraPose);
+                    renderingParameters.CommitDirect3D11DepthBuffer(interopSurface);
+                }
+                catch (const winrt::hresult_error&)
+                {
+                }
+            }
+        }
+
+        // Build the Hi-Z pyramid the content of the next frame is culled against.
+        if (m_options.occlusionCulling && cameraViews.size() == 1)
+        {
+            const DXHelper::CameraResources* pCameraResources = cameraViews.front().pCameraResources;
+            m_deviceResources->UseD3DDeviceContext([&](ID3D11DeviceContext3* context) {
+                // The depth buffer is read by the downsample shader, so it must not be bound as depth target.
+                context->OMSetRenderTargets(0, nullptr, nullptr);
+                m_deviceResources->GetOcclusionCuller().UpdatePyramid(
+                    context,
+                    pCameraResources->GetDepthStencilTexture2D(),
+                    pCameraResources->GetViewProjectionConstantBufferData().viewProjection,
+                    pCameraResources->IsRenderingStereoscopic());
+            });
+        }
     });
 
+    m_deviceResources->UseImmediateD3DDeviceContext(
+        [this](ID3D11DeviceContext3* context) { m_deviceResources->GetGpuTimer().EndFrame(context); });
+
+    // All commands of this frame were submitted. Start the pose independent update of the next frame, so it overlaps
+    // with presenting this frame and sending it to the player.
+    if (m_pipelineFrames && m_isInitialized)
+    {
+        StartPoseIndependentUpdate(m_referenceFrame.CoordinateSystem());
+    }
+
     if (atLeastOneCameraRendered)
     {
+        FRAME_PROFILER_ZONE("Present");
         m_deviceResources->Present(holographicFrame);
     }
 
@@ -586,26 +1414,260 @@ void SampleRemoteApp::Render(HolographicFrame holographicFrame)
         }
         if (copyPreview && m_isInitialized)
         {
-            winrt::com_ptr<ID3D11Device1> spDevice;
-            spDevice.copy_from(GetDeviceResources()->GetD3DDevice());
+            std::lock_guard _lg(m_deviceLock);
+
+            if (WindowAcquireBackBuffer())
+            {
+                GetDeviceResources()->UseD3DDeviceContext([&](auto context) {
+                    context->ClearRenderTargetView(m_swapChainRenderTargetView.get(), DirectX::Colors::CornflowerBlue);
+                });
+
+                WindowPresentSwapChain();
+            }
+        }
+    }
+
+    m_framesPerSecond++;
+    m_frameCount++;
+}
+
+void SampleRemoteApp::UpdateDepthRange(const HolographicFramePrediction& prediction, const SpatialCoordinateSystem& coordinateSystem)
+{
+    m_contentDepthRange.Clear();
+    m_spinningCubeRenderer->AddBounds(m_contentDepthRange);
+    if (m_spatialSurfaceMeshRenderer)
+    {
+        m_spatialSurfaceMeshRenderer->AddBounds(m_contentDepthRange);
+    }
+    m_sceneUnderstandingRenderer->AddBounds(m_contentDepthRange);
+    m_qrCodeRenderer->AddBounds(m_contentDepthRange);
+    m_spatialInputRenderer->AddBounds(m_contentDepthRange);
+    if (m_stressTestRenderer)
+    {
+        m_stressTestRenderer->AddBounds(m_contentDepthRange);
+    }
+
+    for (const HolographicCameraPose& cameraPose : prediction.CameraPoses())
+    {
+        try
+        {
+            const auto viewTransform = cameraPose.TryGetViewTransform(coordinateSystem);
+            float nearPlane = ContentDepthRange::DefaultNearPlane;
+            float farPlane = ContentDepthRange::DefaultFarPlane;
+            if (viewTransform)
+            {
+                m_contentDepthRange.ComputePlanes(viewTransform.Value(), nearPlane, farPlane);
+            }
+
+            // The planes take effect with the next frame. The committed depth buffer is always interpreted with the
+            // projection it was rendered with, so changing the planes every frame is safe.
+            HolographicCamera camera = cameraPose.HolographicCamera();
+            camera.SetNearPlaneDistance(nearPlane);
+            camera.SetFarPlaneDistance(farPlane);
+        }
+        catch (const winrt::hresult_error&)
+        {
+        }
+    }
+}
+
+void SampleRemoteApp::UpdatePoseIndependentContent(SpatialCoordinateSystem coordinateSystem)
+{
+    FRAME_PROFILER_ZONE("UpdatePoseIndependentContent");
+
+    {
+        FRAME_PROFILER_ZONE("SceneUnderstanding::Update");
+        m_sceneUnderstandingRenderer->Update(coordinateSystem);
+    }
+    // The QR codes of a replayed frame are taken over by Update.
+    if (!m_perceptionReplay)
+    {
+        FRAME_PROFILER_ZONE("QRCode::Update");
+        m_qrCodeRenderer->Update(coordinateSystem);
+    }
+}
+
+void SampleRemoteApp::StartPoseIndependentUpdate(SpatialCoordinateSystem coordinateSystem)
+{
+    if (!m_poseIndependentWorker.joinable())
+    {
+        m_poseIndependentWorker = std::thread([this]() { RunPoseIndependentWorker(); });
+    }
+
+    {
+        std::lock_guard lock(m_poseIndependentMutex);
+        m_poseIndependentCoordinateSystem = std::move(coordinateSystem);
+        m_poseIndependentUpdatePending = true;
+    }
+    m_poseIndependentChanged.notify_all();
+
+    m_poseIndependentUpdateStarted = true;
+}
+
+void SampleRemoteApp::WaitForPoseIndependentUpdate()
+{
+    if (!m_poseIndependentUpdateStarted)
+    {
+        return;
+    }
+    m_poseIndependentUpdateStarted = false;
+
+    std::exception_ptr exception;
+    {
+        std::unique_lock lock(m_poseIndependentMutex);
+        m_poseIndependentChanged.wait(lock, [this]() { return !m_poseIndependentUpdatePending; });
+        exception = std::exchange(m_poseIndependentException, nullptr);
+    }
+
+    try
+    {
+        if (exception)
+        {
+            std::rethrow_exception(exception);
+        }
+    }
+    catch (const winrt::hresult_error&)
+    {
+        // The content is updated again next frame.
+    }
+}
+
+void SampleRemoteApp::RunPoseIndependentWorker()
+{
+    SetThreadDescription(GetCurrentThread(), L"Pose independent update");
+
+    std::unique_lock lock(m_poseIndependentMutex);
+    while (true)
+    {
+        m_poseIndependentChanged.wait(lock, [this]() { return m_poseIndependentUpdatePending || m_poseIndependentWorkerStopping; });
+        if (!m_poseIndependentUpdatePending)
+        {
+            return;
+        }
+
+        SpatialCoordinateSystem coordinateSystem = std::exchange(m_poseIndependentCoordinateSystem, nullptr);
+        lock.unlock();
+
+        std::exception_ptr exception;
+        try
+        {
+            UpdatePoseIndependentContent(coordinateSystem);
+        }
+        catch (...)
+        {
+            exception = std::current_exception();
+        }
+
+        lock.lock();
+        m_poseIndependentException = exception;
+        m_poseIndependentUpdatePending = false;
+        m_poseIndependentChanged.notify_all();
+    }
+}
+
+void SampleRemoteApp::RenderContent(const std::vector<CameraView>& cameraViews)
+{
+    if (cameraViews.empty())
+    {
+        return;
+    }
+
+    const std::array<bool, ContentRendererCount> recordOnDeferredContext = m_recordOnDeferredContext;
+
+    // Start all deferred recordings first, so they run in parallel to each other and to the renderers which use the
+    // immediate context.
+    for (size_t rendererIndex = 0; rendererIndex < ContentRendererCount; ++rendererIndex)
+    {
+        if (recordOnDeferredContext[rendererIndex])
+        {
+            const ContentRenderer renderer = static_cast<ContentRenderer>(rendererIndex);
+            m_deferredContextRecorders[rendererIndex]->BeginRecording(
+                [this, renderer, &cameraViews]() { RenderContent(renderer, cameraViews); });
+        }
+    }
+
+    // Submit the renderers in a fixed order, independent of which recording finishes first. The GPU timer sections are the
+    // renderer indices. An occluding mesh goes first, so the pixels of the content behind it fail the early depth test.
+    std::array<size_t, ContentRendererCount> submitOrder;
+    std::iota(submitOrder.begin(), submitOrder.end(), size_t(0));
+    if (m_options.meshOccluder)
+    {
+        const auto mesh = submitOrder.begin() + static_cast<size_t>(ContentRenderer::SpatialSurfaceMesh);
+        std::rotate(submitOrder.begin(), mesh, mesh + 1);
+    }
+
+    for (size_t rendererIndex : submitOrder)
+    {
+        try
+        {
+            m_deviceResources->TimeGpuSection(rendererIndex, [&]() {
+                if (recordOnDeferredContext[rendererIndex])
+                {
+                    m_deferredContextRecorders[rendererIndex]->ExecuteRecording();
+                }
+                else
+                {
+                    RenderContent(static_cast<ContentRenderer>(rendererIndex), cameraViews);
+                }
+            });
+        }
+        catch (const winrt::hresult_error&)
+        {
+        }
+    }
+}
+
+void SampleRemoteApp::RenderContent(ContentRenderer renderer, const std::vector<CameraView>& cameraViews)
+{
+    FRAME_PROFILER_ZONE(ContentRendererZoneNames[static_cast<size_t>(renderer)]);
+
+    for (const CameraView& cameraView : cameraViews)
+    {
+        // Set the viewport, the camera buffer, the render target and the depth target drawing buffer.
+        m_deviceResources->UseD3DDeviceContext(
+            [&](ID3D11DeviceContext3* context) { cameraView.pCameraResources->BindRenderState(m_deviceResources.get(), context); });
+
+        // Secondary cameras may leave out the spatial surface mesh, to save GPU time for the display.
+        if (renderer == ContentRenderer::SpatialSurfaceMesh && cameraView.isSecondary && !m_options.secondaryCameraSurfaceMesh)
+        {
+            continue;
+        }
+
+        const bool isStereo = cameraView.pCameraResources->IsRenderingStereoscopic();
+
+        switch (renderer)
+        {
+            case ContentRenderer::SpinningCube:
+                m_spinningCubeRenderer->Render(isStereo, cameraView.cullingFrustum);
+                break;
+
+            case ContentRenderer::SceneUnderstanding:
+                m_sceneUnderstandingRenderer->Render(isStereo);
+                break;
 
-            winrt::com_ptr<ID3D11Texture2D> spBackBuffer;
-            winrt::check_hresult(m_swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), spBackBuffer.put_void()));
+            case ContentRenderer::QRCode:
+                m_qrCodeRenderer->Render(isStereo, cameraView.cullingFrustum);
+                break;
 
-            // Create a render target view of the back buffer.
-            // Creating this resource is inexpensive, and is better than keeping track of
-            // the back buffers in order to pre-allocate render target views for each one.
-            winrt::com_ptr<ID3D11RenderTargetView> spRenderTargetView;
-            winrt::check_hresult(spDevice->CreateRenderTargetView(spBackBuffer.get(), nullptr, spRenderTargetView.put()));
+            case ContentRenderer::SpatialSurfaceMesh:
+                if (m_spatialSurfaceMeshRenderer)
+                {
+                    m_spatialSurfaceMeshRenderer->Render(isStereo, cameraView.cullingFrustum);
+                }
+                break;
 
-            GetDeviceResources()->UseD3DDeviceContext(
-                [&](auto context) { context->ClearRenderTargetView(spRenderTargetView.get(), DirectX::Colors::CornflowerBlue); });
+            case ContentRenderer::SpatialInput:
+                m_spatialInputRenderer->Render(isStereo, cameraView.cullingFrustum);
+                break;
 
-            WindowPresentSwapChain();
+            case ContentRenderer::StressTest:
+                if (m_stressTestRenderer)
+                {
+                    m_stressTestRenderer->Render(isStereo, cameraView.cullingFrustum);
+                }
+                break;
         }
     }
-
-    m_framesPerSecond++;
 }
 
 void SampleRemoteApp::ConfigureRemoting(const Options& options)
@@ -613,6 +1675,13 @@ void SampleRemoteApp::ConfigureRemoting(const Options& options)
     if (!m_isInitialized)
     {
         m_options = options;
+        m_bitrateController.Configure(m_options.maxBitrateKbps, m_options.depthDownscale);
+        m_latencyProbe.Configure(std::chrono::milliseconds(m_options.latencyProbeIntervalMs));
+
+        if (m_deviceResources)
+        {
+            m_deviceResources->SetAdapterIndex(m_options.adapterIndex);
+        }
     }
 }
 
@@ -636,7 +1705,8 @@ void SampleRemoteApp::InitializeRemoteContextAndConnectOrListen()
 
         // Create the RemoteContext
         // IMPORTANT: This must be done before creating the HolographicSpace (or any other call to the Holographic API).
-        HRESULT hr = CreateRemoteContext(m_remoteContext, 20000, true, PreferredVideoCodec::Any);
+        HRESULT hr = CreateRemoteContext(
+            m_remoteContext, m_bitrateController.GetBitrateKbps(), m_options.enableAudio, m_options.videoCodec);
 
         if (hr != S_OK)
         {
@@ -652,17 +1722,9 @@ void SampleRemoteApp::InitializeRemoteContextAndConnectOrListen()
             return;
         }
 
-        // Configure for half-resolution depth.
-        auto depthResolution = DepthBufferStreamResolution::Half_Resolution;
-        if (m_depthDownscale == 1)
-        {
-            depthResolution = DepthBufferStreamResolution::Full_Resolution;
-        }
-        else if (m_depthDownscale == 4)
-        {
-            depthResolution = DepthBufferStreamResolution::Quarter_Resolution;
-        }
-        m_remoteContext.ConfigureDepthVideoStream(depthResolution);
+        // Configure the depth resolution chosen by the bitrate controller, starting with the configured one.
+        m_remoteContext.ConfigureDepthVideoStream(GetDepthBufferStreamResolution(m_bitrateController.GetDepthDownscale()));
+        m_bitrateController.MarkApplied();
 
         // Create the HolographicSpace
         CreateHolographicSpaceAndDeviceResources();
@@ -714,6 +1776,7 @@ void SampleRemoteApp::InitializeRemoteContextAndConnectOrListen()
             m_remoteContext.OnDataChannelCreated(winrt::auto_revoke, [this](const IDataChannel& dataChannel, uint8_t channelId) {
                 std::lock_guard lock(m_customDataChannelLock);
                 m_customDataChannel = dataChannel.as<IDataChannel2>();
+                m_latencyProbe.Reset();
 
                 m_customChannelDataReceivedEventRevoker = m_customDataChannel.OnDataReceived(
                     winrt::auto_revoke, [this](winrt::array_view<const uint8_t> dataView) { OnCustomDataChannelDataReceived(dataView); });
@@ -729,6 +1792,9 @@ void SampleRemoteApp::InitializeRemoteContextAndConnectOrListen()
 
 void SampleRemoteApp::CreateHolographicSpaceAndDeviceResources()
 {
+    // The pose independent update uses the renderers which are recreated below.
+    WaitForPoseIndependentUpdate();
+
     UnregisterHolographicEventHandlers();
 
     if (m_window)
@@ -737,15 +1803,50 @@ void SampleRemoteApp::CreateHolographicSpaceAndDeviceResources()
         m_interactionManager = m_window->CreateInteractionManager();
     }
 
-    m_deviceResources->SetHolographicSpace(m_holographicSpace);
+    const bool deviceCreated = m_deviceResources->SetHolographicSpace(m_holographicSpace);
 
+    // The input renderer and handler are bound to the interaction manager of the space.
     m_spatialInputRenderer = std::make_shared<SpatialInputRenderer>(m_deviceResources, m_interactionManager);
     m_spatialInputHandler = std::make_shared<SpatialInputHandler>(m_interactionManager);
 
-    m_spinningCubeRenderer = std::make_unique<SpinningCubeRenderer>(m_deviceResources);
+    // The other renderers only depend on the device. If the device was kept for the new space, e.g. when reconnecting with a new
+    // remote context, they are kept as well, with their shaders, buffers and cached content, so the first frame is ready right away.
+    const bool keepRenderers = m_options.warmReconnect && !deviceCreated && m_spinningCubeRenderer;
+    if (!keepRenderers)
+    {
+        m_spinningCubeRenderer = std::make_unique<SpinningCubeRenderer>(m_deviceResources);
+
+        if (m_options.stressHologramCount > 0)
+        {
+            StressTestRenderer::Options stressTestOptions;
+            stressTestOptions.hologramCount = m_options.stressHologramCount;
+            stressTestOptions.distribution = m_options.stressDistribution;
+            stressTestOptions.churnPerSecond = m_options.stressChurnPerSecond;
+            m_stressTestRenderer = std::make_unique<StressTestRenderer>(m_deviceResources, stressTestOptions);
+            m_stressTestRenderer->SetActiveCount(StressTestRenderer::MinHologramCount);
+            m_stressTestStep = {std::chrono::steady_clock::now()};
+        }
+
+        {
+            std::lock_guard _lg(m_deviceLock);
+            m_previewRenderer = std::make_unique<PreviewRenderer>(m_deviceResources);
+        }
+
+        m_sceneUnderstandingRenderer = std::make_unique<SceneUnderstandingRenderer>(m_deviceResources);
+        if (!m_options.sceneCacheFile.empty())
+        {
+            m_sceneUnderstandingRenderer->EnableSceneCache(m_options.sceneCacheFile);
+        }
+        m_qrCodeRenderer = std::make_unique<QRCodeRenderer>(m_deviceResources);
 
-    m_sceneUnderstandingRenderer = std::make_unique<SceneUnderstandingRenderer>(m_deviceResources);
-    m_qrCodeRenderer = std::make_unique<QRCodeRenderer>(m_deviceResources);
+        for (auto& deferredContextRecorder : m_deferredContextRecorders)
+        {
+            deferredContextRecorder = std::make_unique<DXHelper::DeferredContextRecorder>(m_deviceResources);
+        }
+
+        // The mesh parts of a kept renderer hold buffers of the previous device.
+        m_spatialSurfaceMeshRenderer = nullptr;
+    }
 
     m_locator = SpatialLocator::GetDefault();
 
@@ -830,28 +1931,12 @@ void SampleRemoteApp::LoadPosition()
         return;
     }
 
-    auto storeRequest = SpatialAnchorManager::RequestStoreAsync();
-    storeRequest.Completed([this](winrt::Windows::Foundation::IAsyncOperation<SpatialAnchorStore> result, auto asyncStatus) {
-        if (result.Status() != winrt::Windows::Foundation::AsyncStatus::Completed)
-        {
-            return;
-        }
-
-        const SpatialAnchorStore& store = result.GetResults();
-        if (store)
+    // The handler is called from Update once the anchor can be located.
+    m_anchorStore->LoadRegion(L"", [this](const winrt::hstring& name, const float4x4& positionToOrigin) {
+        if (name == L"position")
         {
-            auto anchors = store.GetAllSavedAnchors();
-            if (anchors.HasKey(L"position"))
-            {
-                auto position = anchors.Lookup(L"position");
-                auto positionToOrigin = position.CoordinateSystem().TryGetTransformTo(m_referenceFrame.CoordinateSystem());
-                if (positionToOrigin)
-                {
-                    const float3 res = transform(float3::zero(), positionToOrigin.Value());
-                    m_spinningCubeRenderer->SetPosition(res);
-                    OutputDebugStringW(L"Loaded cube position from SpatialAnchorStore.\n");
-                }
-            }
+            m_spinningCubeRenderer->SetPosition(transform(float3::zero(), positionToOrigin));
+            OutputDebugStringW(L"Loaded cube position from SpatialAnchorStore.\n");
         }
     });
 }
@@ -865,24 +1950,12 @@ void SampleRemoteApp::SavePosition()
     }
 
     auto position = SpatialAnchor::TryCreateRelativeTo(m_referenceFrame.CoordinateSystem(), m_spinningCubeRenderer->GetPosition());
-
-    auto storeRequest = SpatialAnchorManager::RequestStoreAsync();
-    storeRequest.Completed([position](winrt::Windows::Foundation::IAsyncOperation<SpatialAnchorStore> result, auto asyncStatus) {
-        if (result.Status() != winrt::Windows::Foundation::AsyncStatus::Completed)
-        {
-            return;
-        }
-
-        const SpatialAnchorStore& store = result.GetResults();
-        if (store)
-        {
-            store.Clear();
-            if (store.TrySave(L"position", position))
-            {
-                OutputDebugStringW(L"Saved cube position to SpatialAnchorStore.\n");
-            }
-        }
-    });
+    if (position)
+    {
+        // Written by the anchor store on a worker thread, together with other saves queued meanwhile.
+        m_anchorStore->Save(L"position", position);
+        OutputDebugStringW(L"Saving cube position to SpatialAnchorStore.\n");
+    }
 }
 
 winrt::fire_and_forget SampleRemoteApp::ExportPosition()
@@ -962,13 +2035,62 @@ void SampleRemoteApp::InitializeAccessToFeatures()
     // Request access to scene observer.
     RequestSceneObserverAccess();
 
+    if (!m_sceneUpdateScheduler)
+    {
+        m_sceneUpdateScheduler = std::make_shared<SceneUpdateScheduler>([weakThis = weak_from_this()](const Scene& scene) {
+            if (auto strongThis = weakThis.lock())
+            {
+                strongThis->OnSceneComputed(scene);
+            }
+        });
+
+        // Create Query settings for the scene update
+        SceneQuerySettings querySettings{};
+        querySettings.EnableSceneObjectQuads = true;                             // Requests that the scene updates quads.
+        querySettings.EnableSceneObjectMeshes = true;                            // Requests that the scene updates watertight mesh data.
+        querySettings.EnableOnlyObservedSceneObjects = false;                    // Do not explicitly turn off quad inference.
+        querySettings.EnableWorldMesh = true;                                    // Requests a static version of the spatial mapping mesh.
+        querySettings.RequestedMeshLevelOfDetail = SceneMeshLevelOfDetail::Fine; // Requests the finest LOD of the spatial mapping mesh.
+
+        m_sceneUpdateScheduler->Configure(querySettings, 10.0f, std::chrono::milliseconds(m_options.sceneUpdateIntervalMs));
+
+        // The cached scene is shown right away and refreshed by a new computation.
+        if (!m_options.sceneCacheFile.empty())
+        {
+            m_sceneUpdateScheduler->RequestUpdate();
+        }
+    }
+
     // Request updates from qr code watcher.
     RequestQRCodeWatcherUpdates();
 
-    // If not in standalone mode the spatial surface renderer needs to get recreated on every connect, because its SpatialSurfaceObserver
-    // stops working on disconnect. Uncomment the line below to render spatial surfaces. This creates the SpatialSurfaceMeshRenderer and
-    // requests access from the SpatialSurfaceObserver.
-    // m_spatialSurfaceMeshRenderer = std::make_unique<SpatialSurfaceMeshRenderer>(m_deviceResources);
+    // If not in standalone mode the SpatialSurfaceObserver of the spatial surface renderer needs to get recreated on every connect,
+    // because it stops working on disconnect. A renderer kept from the previous connection keeps its mesh parts meanwhile.
+    if (m_spatialSurfaceMeshRenderer)
+    {
+        m_spatialSurfaceMeshRenderer->RecreateSurfaceObserver();
+    }
+    else if (m_options.meshOccluder)
+    {
+        m_spatialSurfaceMeshRenderer = std::make_unique<SpatialSurfaceMeshRenderer>(m_deviceResources);
+        m_spatialSurfaceMeshRenderer->SetMeshTriangleBudget(m_options.meshTriangleBudget);
+        m_spatialSurfaceMeshRenderer->SetRecorder(m_perceptionRecorder);
+        if (!m_options.meshCacheDirectory.empty())
+        {
+            m_spatialSurfaceMeshRenderer->EnableMeshCache(m_options.meshCacheDirectory);
+        }
+    }
+    else
+    {
+        // Uncomment the line below to render spatial surfaces. This creates the SpatialSurfaceMeshRenderer and requests access from
+        // the SpatialSurfaceObserver.
+        // m_spatialSurfaceMeshRenderer = std::make_unique<SpatialSurfaceMeshRenderer>(m_deviceResources);
+    }
+
+    if (m_spatialSurfaceMeshRenderer)
+    {
+        m_spatialSurfaceMeshRenderer->SetDepthOnly(m_options.meshOccluder);
+    }
 }
 
 void SampleRemoteApp::RequestEyesPoseAccess()
@@ -1037,35 +2159,24 @@ winrt::fire_and_forget SampleRemoteApp::RequestSceneObserverAccess()
 
 void SampleRemoteApp::ToggleSceneUnderstanding()
 {
-    if (!m_hasSceneObserverAccess)
+    if (!m_hasSceneObserverAccess || !m_sceneUpdateScheduler)
     {
         return;
     }
 
-    // Create Query settings for the scene update
-    SceneQuerySettings querySettings{};
-    querySettings.EnableSceneObjectQuads = true;                             // Requests that the scene updates quads.
-    querySettings.EnableSceneObjectMeshes = true;                            // Requests that the scene updates watertight mesh data.
-    querySettings.EnableOnlyObservedSceneObjects = false;                    // Do not explicitly turn off quad inference.
-    querySettings.EnableWorldMesh = true;                                    // Requests a static version of the spatial mapping mesh.
-    querySettings.RequestedMeshLevelOfDetail = SceneMeshLevelOfDetail::Fine; // Requests the finest LOD of the static spatial mapping mesh.
-
-    SceneObserver::ComputeAsync(querySettings, 10.0f)
-        .Completed([&, weakThis = weak_from_this()](winrt::Windows::Foundation::IAsyncOperation<Scene> result, auto asyncStatus) {
-            if (result.Status() != winrt::Windows::Foundation::AsyncStatus::Completed)
-            {
-                return;
-            }
-
-            if (auto strongThis = weakThis.lock())
-            {
-                SpatialStationaryFrameOfReference updateLocation = m_locator.CreateStationaryFrameOfReferenceAtCurrentLocation();
-                Scene scene = result.GetResults();
+    // The scheduler coalesces repeated toggles into a single computation, which starts once the one in flight completed. Toggling
+    // to None pauses the scheduler instead, see Tick.
+    m_sceneUnderstandingRenderer->ToggleRenderingType();
+    if (m_sceneUnderstandingRenderer->IsRenderingEnabled())
+    {
+        m_sceneUpdateScheduler->RequestUpdate();
+    }
+}
 
-                m_sceneUnderstandingRenderer->SetScene(scene, updateLocation);
-                m_sceneUnderstandingRenderer->ToggleRenderingType();
-            }
-        });
+void SampleRemoteApp::OnSceneComputed(const Scene& scene)
+{
+    SpatialStationaryFrameOfReference updateLocation = m_locator.CreateStationaryFrameOfReferenceAtCurrentLocation();
+    m_sceneUnderstandingRenderer->SetScene(scene, updateLocation);
 }
 
 winrt::fire_and_forget SampleRemoteApp::RequestQRCodeWatcherUpdates()
@@ -1158,13 +2269,37 @@ void SampleRemoteApp::ShutdownRemoteContext()
         m_remoteContext.Close();
         m_remoteContext = nullptr;
     }
+
+    std::lock_guard _lg(m_deviceLock);
+    m_sentFrameTextures.clear();
 }
 
 void SampleRemoteApp::OnDeviceLost()
 {
+    WaitForPoseIndependentUpdate();
+
+    // The device may be lost again before the resources of the previous device were restored.
+    if (m_deviceRestore.valid())
+    {
+        m_deviceRestore.wait();
+    }
+
+    for (auto& deferredContextRecorder : m_deferredContextRecorders)
+    {
+        if (deferredContextRecorder)
+        {
+            deferredContextRecorder->ReleaseDeviceDependentResources();
+        }
+    }
+
     m_spinningCubeRenderer->ReleaseDeviceDependentResources();
     m_spatialInputRenderer->ReleaseDeviceDependentResources();
 
+    if (m_stressTestRenderer)
+    {
+        m_stressTestRenderer->ReleaseDeviceDependentResources();
+    }
+
     m_qrCodeRenderer->ReleaseDeviceDependentResources();
     m_sceneUnderstandingRenderer->ReleaseDeviceDependentResources();
 
@@ -1172,20 +2307,56 @@ void SampleRemoteApp::OnDeviceLost()
     {
         m_spatialSurfaceMeshRenderer->ReleaseDeviceDependentResources();
     }
+
+    {
+        std::lock_guard _lg(m_deviceLock);
+        m_previewRenderer->ReleaseDeviceDependentResources();
+    }
 }
 
 void SampleRemoteApp::OnDeviceRestored()
 {
-    m_spinningCubeRenderer->CreateDeviceDependentResources();
-    m_spatialInputRenderer->CreateDeviceDependentResources();
+    const auto restoreStart = std::chrono::steady_clock::now();
+
+    // The scene understanding renderer draws its labels with Direct2D, which has to happen on this thread. It switches threads
+    // on its own once the labels are drawn.
+    std::vector<std::future<void>> restores;
+    restores.push_back(m_sceneUnderstandingRenderer->CreateDeviceDependentResources());
 
-    m_qrCodeRenderer->CreateDeviceDependentResources();
-    m_sceneUnderstandingRenderer->CreateDeviceDependentResources();
+    restores.push_back(CreateDeviceDependentResourcesAsync(*m_spinningCubeRenderer));
+    restores.push_back(CreateDeviceDependentResourcesAsync(*m_spatialInputRenderer));
+    restores.push_back(CreateDeviceDependentResourcesAsync(*m_qrCodeRenderer));
+
+    if (m_stressTestRenderer)
+    {
+        restores.push_back(CreateDeviceDependentResourcesAsync(*m_stressTestRenderer));
+    }
 
     if (m_spatialSurfaceMeshRenderer)
     {
-        m_spatialSurfaceMeshRenderer->CreateDeviceDependentResources();
+        restores.push_back(CreateDeviceDependentResourcesAsync(*m_spatialSurfaceMeshRenderer));
     }
+
+    restores.push_back(CreateDeviceDependentResourcesAsync(*m_previewRenderer));
+
+    // Every renderer draws again as soon as its own resources are created. The surface meshes and the scene buffers are rebuilt
+    // from the data the renderers kept, by their next updates.
+    m_deviceRestore = std::async(std::launch::async, [restores = std::move(restores), restoreStart]() mutable {
+        for (std::future<void>& restore : restores)
+        {
+            try
+            {
+                restore.get();
+            }
+            catch (const winrt::hresult_error& e)
+            {
+                DebugLog(L"Failed to restore device resources with hr = 0x%08X\n", e.code());
+            }
+        }
+
+        const auto restoreTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - restoreStart);
+        DebugLog(L"Restored the device dependent resources in %lld ms.\n", static_cast<long long>(restoreTime.count()));
+    });
 }
 
 void SampleRemoteApp::OnCameraAdded(const HolographicSpace& sender, const HolographicSpaceCameraAddedEventArgs& args)
@@ -1196,6 +2367,12 @@ void SampleRemoteApp::OnCameraAdded(const HolographicSpace& sender, const Hologr
     create_task([this, deferral, holographicCamera]() {
         m_deviceResources->AddHolographicCamera(holographicCamera);
 
+        // Secondary cameras render a scaled down part of their back buffer, which the system scales up again.
+        if (m_options.secondaryCameraScale < 1.0f && DXHelper::CameraResources::IsSecondaryCamera(holographicCamera))
+        {
+            holographicCamera.ViewportScaleFactor(m_options.secondaryCameraScale);
+        }
+
         deferral.Complete();
     });
 }
@@ -1238,6 +2415,7 @@ void SampleRemoteApp::OnLocatabilityChanged(const SpatialLocator& sender, const
 void SampleRemoteApp::OnConnected()
 {
     WindowUpdateTitle();
+    SetEvent(m_wakeEvent.get());
 
     InitializeAccessToFeatures();
 
@@ -1258,6 +2436,8 @@ void SampleRemoteApp::OnDisconnected(winrt::Microsoft::Holographic::AppRemoting:
         m_disconnectPending = false;
     }
 
+    bool reconnecting = false;
+
     // Reconnect if this is a transient failure.
     if (failureReason == ConnectionFailureReason::DisconnectRequest || failureReason == ConnectionFailureReason::PeerDisconnectRequest)
     {
@@ -1270,7 +2450,18 @@ void SampleRemoteApp::OnDisconnected(winrt::Microsoft::Holographic::AppRemoting:
         if (m_options.autoReconnect)
         {
             DebugLog(L"Reconnecting...");
-            ConnectOrListen();
+            reconnecting = true;
+            if (m_bitrateController.HasPendingChange())
+            {
+                // The stream settings can only be changed by creating a new RemoteContext, which must not be
+                // done from within its own event handler.
+                DebugLog(L"Reconnecting with %u kbps.", m_bitrateController.GetBitrateKbps());
+                m_recreateRemoteContextPending = true;
+            }
+            else
+            {
+                ConnectOrListen();
+            }
         }
         else
         {
@@ -1285,82 +2476,119 @@ void SampleRemoteApp::OnDisconnected(winrt::Microsoft::Holographic::AppRemoting:
     }
 
     WindowUpdateTitle();
-
-    m_spatialSurfaceMeshRenderer = nullptr;
+    SetEvent(m_wakeEvent.get());
 
     m_hasSceneObserverAccess = false;
 
-    m_sceneUnderstandingRenderer->Reset();
-    m_qrCodeRenderer->Reset();
+    // The anchor store belongs to the player of the connection.
+    m_anchorStore->Reset();
+
+    // After a transient failure the player most likely reconnects from the same place, so the spatial mesh, the scene and the QR
+    // codes of the previous connection are kept and shown until they are updated. Otherwise they are dropped.
+    if (!reconnecting || !m_options.warmReconnect)
+    {
+        m_spatialSurfaceMeshRenderer = nullptr;
+
+        m_sceneUnderstandingRenderer->Reset();
+        m_qrCodeRenderer->Reset();
+    }
 }
 
 void SampleRemoteApp::OnSendFrame(const winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface& texture)
 {
-    if (m_options.showPreview)
+    if (!m_options.showPreview)
     {
-        winrt::com_ptr<ID3D11Device1> spDevice;
-        spDevice.copy_from(GetDeviceResources()->GetD3DDevice());
-
-        winrt::com_ptr<ID3D11Texture2D> spBackBuffer;
-        winrt::check_hresult(m_swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), spBackBuffer.put_void()));
+        return;
+    }
 
-        winrt::com_ptr<ID3D11Texture2D> texturePtr;
+    // Skip frames to stay at the preview frame rate, the cost of the preview is independent of the stream frame rate then.
+    const auto now = std::chrono::steady_clock::now();
+    if (m_options.previewFrameRate > 0)
+    {
+        const auto previewFrameInterval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<float>(1.0f / static_cast<float>(m_options.previewFrameRate)));
+        if (now - m_lastPreviewTime < previewFrameInterval)
         {
-            winrt::com_ptr<ID3D11Resource> resource;
-            winrt::com_ptr<::IInspectable> inspectable = texture.as<::IInspectable>();
-            winrt::com_ptr<Windows::Graphics::DirectX::Direct3D11::IDirect3DDxgiInterfaceAccess> dxgiInterfaceAccess;
-            winrt::check_hresult(inspectable->QueryInterface(__uuidof(dxgiInterfaceAccess), dxgiInterfaceAccess.put_void()));
-            winrt::check_hresult(dxgiInterfaceAccess->GetInterface(__uuidof(resource), resource.put_void()));
-            resource.as(texturePtr);
+            return;
         }
+    }
 
-        // Get source/dest dimensions and adjust copy rect and destination position to avoid D3D errors
-        D3D11_TEXTURE2D_DESC backBufferDesc, textureDesc;
-        spBackBuffer->GetDesc(&backBufferDesc);
-        texturePtr->GetDesc(&textureDesc);
+    std::lock_guard _lg(m_deviceLock);
 
-        UINT destX = 0, destY = 0;
-        D3D11_BOX srcBox{0, 0, 0, textureDesc.Width, textureDesc.Height, 1};
+    if (!m_previewRenderer || !WindowAcquireBackBuffer())
+    {
+        return;
+    }
 
-        if (backBufferDesc.Width < textureDesc.Width)
-        {
-            // Target (BackBuffer) narrower than source (Texture)
-            srcBox.left = (textureDesc.Width - backBufferDesc.Width) / 2;
-            srcBox.right = srcBox.left + backBufferDesc.Width;
-        }
-        else if (backBufferDesc.Width > textureDesc.Width)
-        {
-            // Target (BackBuffer) wider than source (Texture)
-            destX = (backBufferDesc.Width - textureDesc.Width) / 2;
-        }
+    D3D11_TEXTURE2D_DESC backBufferDesc;
+    m_swapChainBackBuffer->GetDesc(&backBufferDesc);
 
-        if (backBufferDesc.Height < textureDesc.Height)
-        {
-            // Target (BackBuffer) shorter than source (Texture)
-            srcBox.top = (textureDesc.Height - backBufferDesc.Height) / 2;
-            srcBox.bottom = srcBox.top + backBufferDesc.Height;
-        }
-        else if (backBufferDesc.Height > textureDesc.Height)
+    if (m_previewRenderer->Render(
+            GetSentFrameTexture(texture), m_swapChainRenderTargetView.get(), backBufferDesc.Width, backBufferDesc.Height))
+    {
+        // Never wait for the window, frames are sent to the player from this thread.
+        WindowPresentSwapChain(DXGI_PRESENT_DO_NOT_WAIT);
+        m_lastPreviewTime = now;
+    }
+}
+
+ID3D11Texture2D* SampleRemoteApp::GetSentFrameTexture(const winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface& surface)
+{
+    // The cache holds a reference to every surface, so a cached pointer cannot be reused by another surface.
+    for (const auto& [cachedSurface, texture] : m_sentFrameTextures)
+    {
+        if (winrt::get_abi(cachedSurface) == winrt::get_abi(surface))
         {
-            // Target (BackBuffer) taller than source (Texture)
-            destY = (backBufferDesc.Height - textureDesc.Height) / 2;
+            return texture.get();
         }
+    }
 
-        // Copy texture to back buffer
-        GetDeviceResources()->UseD3DDeviceContext([&](auto context) {
-            context->CopySubresourceRegion(
-                spBackBuffer.get(), // dest
-                0,                  // dest subresource
-                destX,
-                destY,
-                0,                // dest x, y, z
-                texturePtr.get(), // source
-                0,                // source subresource
-                &srcBox);         // source box, null means the entire resource
-        });
+    if (m_sentFrameTextures.size() >= MaxSentFrameTextures)
+    {
+        m_sentFrameTextures.clear();
+    }
+
+    winrt::com_ptr<ID3D11Texture2D> texture;
+    {
+        winrt::com_ptr<ID3D11Resource> resource;
+        winrt::com_ptr<::IInspectable> inspectable = surface.as<::IInspectable>();
+        winrt::com_ptr<Windows::Graphics::DirectX::Direct3D11::IDirect3DDxgiInterfaceAccess> dxgiInterfaceAccess;
+        winrt::check_hresult(inspectable->QueryInterface(__uuidof(dxgiInterfaceAccess), dxgiInterfaceAccess.put_void()));
+        winrt::check_hresult(dxgiInterfaceAccess->GetInterface(__uuidof(resource), resource.put_void()));
+        resource.as(texture);
+    }
+
+    m_sentFrameTextures.emplace_back(surface, texture);
+    return texture.get();
+}
+
+bool SampleRemoteApp::WindowAcquireBackBuffer()
+{
+    if (!m_swapChain)
+    {
+        return false;
+    }
+
+    if (!m_swapChainBackBuffer)
+    {
+        winrt::com_ptr<ID3D11Texture2D> backBuffer;
+        winrt::check_hresult(m_swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), backBuffer.put_void()));
+
+        winrt::com_ptr<ID3D11RenderTargetView> renderTargetView;
+        winrt::check_hresult(
+            GetDeviceResources()->GetD3DDevice()->CreateRenderTargetView(backBuffer.get(), nullptr, renderTargetView.put()));
 
-        WindowPresentSwapChain();
+        m_swapChainBackBuffer = std::move(backBuffer);
+        m_swapChainRenderTargetView = std::move(renderTargetView);
     }
+
+    return true;
+}
+
+void SampleRemoteApp::WindowReleaseBackBuffer()
+{
+    m_swapChainBackBuffer = nullptr;
+    m_swapChainRenderTargetView = nullptr;
 }
 
 void SampleRemoteApp::WindowCreateSwapChain(const winrt::com_ptr<ID3D11Device1>& device)
@@ -1381,6 +2609,8 @@ void SampleRemoteApp::WindowCreateSwapChain(const winrt::com_ptr<ID3D11Device1>&
     desc.AlphaMode = DXGI_ALPHA_MODE_IGNORE;
     desc.Scaling = DXGI_SCALING_STRETCH;
 
+    WindowReleaseBackBuffer();
+    m_sentFrameTextures.clear();
     m_swapChain = nullptr;
 
     if (m_window)
@@ -1389,14 +2619,21 @@ void SampleRemoteApp::WindowCreateSwapChain(const winrt::com_ptr<ID3D11Device1>&
     }
 }
 
-void SampleRemoteApp::WindowPresentSwapChain()
+void SampleRemoteApp::WindowPresentSwapChain(UINT flags)
 {
-    HRESULT hr = m_swapChain->Present(0, 0);
+    HRESULT hr = m_swapChain->Present(0, flags);
+
+    if (hr == DXGI_ERROR_WAS_STILL_DRAWING)
+    {
+        // Only returned with DXGI_PRESENT_DO_NOT_WAIT, the frame is dropped.
+        return;
+    }
 
     if (hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET)
     {
         // The D3D device is lost.
         // This should be handled after the frame is complete.
+        WindowReleaseBackBuffer();
         m_swapChain = nullptr;
     }
     else
@@ -1405,6 +2642,154 @@ void SampleRemoteApp::WindowPresentSwapChain()
     }
 }
 
+void SampleRemoteApp::LogGpuTimes()
+{
+    static_assert(std::size(ContentRendererNames) == ContentRendererCount);
+    static_assert(ContentRendererCount <= DXHelper::GpuTimer::MaxSectionCount);
+
+    if (!m_deviceResources)
+    {
+        return;
+    }
+
+    m_deviceResources->UseImmediateD3DDeviceContext([this](ID3D11DeviceContext3*) {
+        const DXHelper::GpuTimer& gpuTimer = m_deviceResources->GetGpuTimer();
+        DebugLog(L"GPU frame time: %.2f ms\n", gpuTimer.GetFrameTime());
+        for (size_t rendererIndex = 0; rendererIndex < ContentRendererCount; ++rendererIndex)
+        {
+            DebugLog(L"  %s: %.2f ms\n", ContentRendererNames[rendererIndex], gpuTimer.GetSectionTime(rendererIndex));
+        }
+    });
+}
+
+void SampleRemoteApp::LogCpuZones()
+{
+    static_assert(std::size(ContentRendererZoneNames) == ContentRendererCount);
+
+    // Zones are recorded when they end, so the zones of the last frame directly precede its Tick zone, which is the most recent
+    // zone without an enclosing zone.
+    std::array<FrameProfiler::Zone, FrameProfiler::ZonesPerThread> zones;
+    const size_t count = FrameProfiler::CopyRecentZones(zones.data(), zones.size());
+    if (count == 0 || zones[count - 1].depth != 0)
+    {
+        return;
+    }
+
+    size_t first = count - 1;
+    while (first > 0 && zones[first - 1].depth > 0)
+    {
+        --first;
+    }
+
+    std::sort(zones.begin() + first, zones.begin() + count, [](const FrameProfiler::Zone& a, const FrameProfiler::Zone& b) {
+        return a.begin < b.begin;
+    });
+
+    DebugLog(L"CPU zones of the last frame:\n");
+    for (size_t i = first; i < count; ++i)
+    {
+        const FrameProfiler::Zone& zone = zones[i];
+        DebugLog(L"%*s%S: %.3f ms\n", 2 * (zone.depth + 1), L"", zone.name, FrameProfiler::TicksToMilliseconds(zone.end - zone.begin));
+    }
+}
+
+void SampleRemoteApp::LogSceneUpdateTimes()
+{
+    if (!m_sceneUpdateScheduler)
+    {
+        return;
+    }
+
+    const SceneUpdateScheduler::Metrics metrics = m_sceneUpdateScheduler->GetMetrics();
+    DebugLog(
+        L"Scene updates: %u completed, %u failed, %u requests coalesced\n",
+        metrics.completedUpdates,
+        metrics.failedUpdates,
+        metrics.coalescedRequests);
+    DebugLog(
+        L"Last scene update (%u bytes): compute %.1f ms, deserialize %.1f ms, hand over %.1f ms, vertices %.1f ms\n",
+        metrics.sceneSizeBytes,
+        metrics.computeMilliseconds,
+        metrics.deserializeMilliseconds,
+        metrics.handlerMilliseconds,
+        m_sceneUnderstandingRenderer->GetLastVertexBuildMilliseconds());
+}
+
+void SampleRemoteApp::UpdateStressTest(float totalSeconds)
+{
+    const float elapsedSeconds = m_stressTestUpdateSeconds > 0.0f ? totalSeconds - m_stressTestUpdateSeconds : 0.0f;
+    m_stressTestUpdateSeconds = totalSeconds;
+    m_stressTestRenderer->Update(totalSeconds, elapsedSeconds);
+
+    // The draw calls of the previous frame, which was rendered with the count of this step as well.
+    m_stressTestStep.frameCount++;
+    m_stressTestStep.drawCallCount += m_stressTestRenderer->TakeDrawCallCount();
+    m_stressTestStep.gpuFrameTimeSum += m_deviceResources->UseImmediateD3DDeviceContext(
+        [this](ID3D11DeviceContext3*) { return m_deviceResources->GetGpuTimer().GetFrameTime(); });
+
+    const auto now = std::chrono::steady_clock::now();
+    const std::chrono::duration<float, std::milli> stepDuration = now - m_stressTestStep.start;
+    if (stepDuration < std::chrono::seconds(m_options.stressStepSeconds))
+    {
+        return;
+    }
+
+    // The remoting runtime does not report the size of the encoded frames, the bitrate is the one the stream is configured with,
+    // which the bitrate controller lowers once the player reports frames which arrive late or not at all.
+    const float frameCount = static_cast<float>(m_stressTestStep.frameCount);
+    DebugLog(
+        L"Stress test: %u holograms, %.2f ms per frame, GPU %.2f ms, %.0f draw calls per frame, %u kbps\n",
+        m_stressTestRenderer->GetActiveCount(),
+        stepDuration.count() / frameCount,
+        m_stressTestStep.gpuFrameTimeSum / frameCount,
+        m_stressTestStep.drawCallCount / frameCount,
+        m_bitrateController.GetBitrateKbps());
+
+    // The last step repeats with all cubes.
+    const uint32_t activeCount = m_stressTestRenderer->GetActiveCount();
+    if (activeCount < m_stressTestRenderer->GetHologramCount())
+    {
+        m_stressTestRenderer->SetActiveCount(activeCount * 2);
+        m_stressTestRenderer->TakeDrawCallCount();
+    }
+    m_stressTestStep = {now};
+}
+
+void SampleRemoteApp::OpenPerceptionRecording(const Options& options)
+{
+    // The arguments are parsed again on every activation, a recording or replay keeps going across them.
+    if (m_perceptionRecorder || m_perceptionReplay)
+    {
+        return;
+    }
+
+    auto resolvePath = [](const std::wstring& filename) {
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+        return DXHelper::GetExecutableRelativePath(filename);
+#else
+        return std::filesystem::path(winrt::Windows::Storage::ApplicationData::Current().LocalFolder().Path().c_str()) / filename;
+#endif
+    };
+
+    if (!options.perceptionReplayFile.empty())
+    {
+        auto replay =
+            std::make_unique<PerceptionRecording::Replay>(resolvePath(options.perceptionReplayFile), options.perceptionReplayFast);
+        if (replay->IsOpen())
+        {
+            m_perceptionReplay = std::move(replay);
+        }
+    }
+    else if (!options.perceptionRecordFile.empty())
+    {
+        auto recorder = std::make_shared<PerceptionRecording::Recorder>(resolvePath(options.perceptionRecordFile));
+        if (recorder->IsOpen())
+        {
+            m_perceptionRecorder = std::move(recorder);
+        }
+    }
+}
+
 void SampleRemoteApp::WindowUpdateTitle()
 {
     std::wstring title = TITLE_TEXT;
@@ -1413,6 +2798,38 @@ void SampleRemoteApp::WindowUpdateTitle()
     uint32_t fps = std::min<uint32_t>(120, m_framesPerSecond);
     title += separator + std::to_wstring(fps) + L" fps";
 
+    if (m_deviceResources)
+    {
+        const float gpuFrameTime = m_deviceResources->UseImmediateD3DDeviceContext(
+            [this](ID3D11DeviceContext3*) { return m_deviceResources->GetGpuTimer().GetFrameTime(); });
+        wchar_t gpuText[32];
+        swprintf_s(gpuText, L"GPU %.1f ms", gpuFrameTime);
+        title += separator + gpuText;
+    }
+
+    if (m_stressTestRenderer)
+    {
+        title += separator + std::to_wstring(m_stressTestRenderer->GetActiveCount()) + L" holograms";
+    }
+
+    {
+        const MemoryAccounting::Usage memoryUsage = MemoryAccounting::GetTotalUsage();
+        wchar_t memoryText[64];
+        swprintf_s(
+            memoryText, L"CPU %.1f MB, GPU %.1f MB", memoryUsage.cpuBytes / (1024.0 * 1024.0), memoryUsage.gpuBytes / (1024.0 * 1024.0));
+        title += separator + memoryText;
+    }
+
+#ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
+    if (const LatencyProbe::Estimate latency = m_latencyProbe.GetEstimate(); latency.valid)
+    {
+        wchar_t latencyText[64];
+        swprintf_s(
+            latencyText, L"RTT %.1f ms, %.1f ms to player, %.1f ms back", latency.roundTripMs, latency.toPlayerMs, latency.toRemoteMs);
+        title += separator + latencyText;
+    }
+#endif
+
     // Title | {ip} | {State} [| Press Space to Connect] [| Preview Disabled (p toggles)]
     title += separator + m_options.hostname;
     {
@@ -1444,8 +2861,13 @@ void SampleRemoteApp::WindowUpdateTitle()
 #ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
 void SampleRemoteApp::OnCustomDataChannelDataReceived(winrt::array_view<const uint8_t> dataView)
 {
-    // TODO: React on data received via the custom data channel here.
-    OutputDebugString(TEXT("Response Received.\n"));
+    // The player sends every message in a packet of its own.
+    m_customDataChannelDispatcher.Dispatch(dataView);
+}
+
+bool SampleRemoteApp::SendCustomDataChannelMessage(DataChannelSender::Lane lane, winrt::array_view<const uint8_t> message)
+{
+    return m_customDataChannelSender.Enqueue(lane, message);
 }
 
 void SampleRemoteApp::OnCustomDataChannelClosed()
@@ -0,0 +1,361 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// Renders the content of the remote sample for a fixed number of frames, without a holographic space or a connected device,
+// and reports the CPU and GPU time of each renderer. The stereo camera follows a synthetic head motion, so two runs on the
+// same machine render exactly the same frames.
+
+#include <pch.h>
+
+#include <d3d11/DirectXHelper.h>
+#include <holographic/DeviceResources.h>
+#include <holographic/SpinningCubeRenderer.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <numeric>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <DirectXColors.h>
+
+using namespace DirectX;
+
+namespace
+{
+    // Creates the Direct3D device on the default adapter. There is no holographic space which could ask for another one.
+    class HeadlessDeviceResources : public DXHelper::DeviceResources
+    {
+    public:
+        HeadlessDeviceResources()
+        {
+            CreateDeviceResources();
+        }
+    };
+
+    struct Options
+    {
+        uint32_t frameCount = 1000;
+        uint32_t warmupFrameCount = 100;
+        uint32_t cubeCount = 64;
+        bool occlusionCulling = false;
+    };
+
+    // A renderer measured by the benchmark. Its CPU time covers update and render, its GPU time the commands render submits.
+    struct BenchmarkRenderer
+    {
+        const char* name;
+        std::function<void(uint32_t frame)> update;
+        std::function<void()> render;
+        std::vector<float> cpuTimes;
+        std::vector<float> gpuTimes;
+    };
+
+    // The render targets of a stereo camera at the resolution of HoloLens 2, both views in one texture array.
+    class SyntheticStereoCamera
+    {
+    public:
+        static constexpr UINT Width = 1440;
+        static constexpr UINT Height = 936;
+
+        explicit SyntheticStereoCamera(DXHelper::DeviceResources& deviceResources)
+        {
+            ID3D11Device4* device = deviceResources.GetD3DDevice();
+
+            const CD3D11_TEXTURE2D_DESC colorDesc(DXGI_FORMAT_B8G8R8A8_UNORM, Width, Height, 2, 1, D3D11_BIND_RENDER_TARGET);
+            winrt::check_hresult(device->CreateTexture2D(&colorDesc, nullptr, m_colorTexture.put()));
+            winrt::check_hresult(device->CreateRenderTargetView(m_colorTexture.get(), nullptr, m_renderTargetView.put()));
+
+            // Same format as the depth buffers of the cameras, so the Hi-Z pyramid is built like in the sample.
+            const CD3D11_TEXTURE2D_DESC depthDesc(
+                DXGI_FORMAT_R16_TYPELESS, Width, Height, 2, 1, D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE);
+            m_depthTarget = deviceResources.GetDepthTargetPool().Acquire(device, depthDesc, DXGI_FORMAT_D16_UNORM);
+
+            const CD3D11_BUFFER_DESC constantBufferDesc(
+                sizeof(DXHelper::ViewProjectionConstantBuffer),
+                D3D11_BIND_CONSTANT_BUFFER,
+                D3D11_USAGE_DYNAMIC,
+                D3D11_CPU_ACCESS_WRITE);
+            winrt::check_hresult(device->CreateBuffer(&constantBufferDesc, nullptr, m_viewProjectionConstantBuffer.put()));
+        }
+
+        // Moves the head along a fixed path, one revolution every 240 frames, and clears the render targets.
+        void BeginFrame(ID3D11DeviceContext* context, uint32_t frame)
+        {
+            const float phase = XM_2PI * static_cast<float>(frame % 240) / 240.0f;
+            const XMMATRIX head = XMMatrixRotationRollPitchYaw(0.05f * sinf(2.0f * phase), 0.3f * sinf(phase), 0.0f) *
+                                  XMMatrixTranslation(0.05f * sinf(phase), 0.02f * sinf(2.0f * phase), 0.0f);
+            const XMMATRIX projection =
+                XMMatrixPerspectiveFovRH(XMConvertToRadians(29.0f), static_cast<float>(Width) / Height, 0.1f, 20.0f);
+
+            constexpr float halfInterpupillaryDistance = 0.032f;
+            for (int view = 0; view < 2; ++view)
+            {
+                const XMMATRIX eye = XMMatrixTranslation(view == 0 ? -halfInterpupillaryDistance : halfInterpupillaryDistance, 0, 0);
+                const XMMATRIX viewTransform = XMMatrixInverse(nullptr, eye * head);
+                XMStoreFloat4x4(&m_viewProjectionConstantBufferData.viewProjection[view], XMMatrixTranspose(viewTransform * projection));
+            }
+
+            DXHelper::UpdateDynamicBuffer(context, m_viewProjectionConstantBuffer.get(), m_viewProjectionConstantBufferData);
+            context->ClearRenderTargetView(m_renderTargetView.get(), Colors::Transparent);
+            context->ClearDepthStencilView(m_depthTarget->view.get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+        }
+
+        // Sets up the state the renderers expect, like CameraResources::BindRenderState.
+        void BindRenderState(ID3D11DeviceContext* context) const
+        {
+            const CD3D11_VIEWPORT viewport(0.0f, 0.0f, static_cast<float>(Width), static_cast<float>(Height));
+            context->RSSetViewports(1, &viewport);
+
+            ID3D11Buffer* pBuffer = m_viewProjectionConstantBuffer.get();
+            context->VSSetConstantBuffers(1, 1, &pBuffer);
+
+            ID3D11RenderTargetView* const targets[1] = {m_renderTargetView.get()};
+            context->OMSetRenderTargets(1, targets, m_depthTarget->view.get());
+        }
+
+        ID3D11Texture2D* GetDepthTexture() const
+        {
+            return m_depthTarget->texture.get();
+        }
+
+        const DirectX::XMFLOAT4X4 (&GetViewProjection() const)[2]
+        {
+            return m_viewProjectionConstantBufferData.viewProjection;
+        }
+
+    private:
+        winrt::com_ptr<ID3D11Texture2D> m_colorTexture;
+        winrt::com_ptr<ID3D11RenderTargetView> m_renderTargetView;
+        std::shared_ptr<DXHelper::DepthTarget> m_depthTarget;
+        winrt::com_ptr<ID3D11Buffer> m_viewProjectionConstantBuffer;
+        DXHelper::ViewProjectionConstantBuffer m_viewProjectionConstantBufferData = {};
+    };
+
+    bool ParseArguments(int argc, wchar_t* argv[], Options& options)
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            const std::wstring_view arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+
+            if (arg == L"-frames" && hasValue)
+            {
+                options.frameCount = std::max(1ul, wcstoul(argv[++i], nullptr, 10));
+            }
+            else if (arg == L"-warmup" && hasValue)
+            {
+                options.warmupFrameCount = wcstoul(argv[++i], nullptr, 10);
+            }
+            else if (arg == L"-cubes" && hasValue)
+            {
+                options.cubeCount = wcstoul(argv[++i], nullptr, 10);
+            }
+            else if (arg == L"-occlusionculling")
+            {
+                options.occlusionCulling = true;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    float MillisecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Prints the mean and the 99th percentile of the samples, in milliseconds.
+    void PrintStatistics(const char* name, std::vector<float> samples)
+    {
+        if (samples.empty())
+        {
+            printf("  %-24s %8s %8s\n", name, "-", "-");
+            return;
+        }
+
+        const float mean = std::accumulate(samples.begin(), samples.end(), 0.0f) / samples.size();
+        const size_t p99Index = std::min(samples.size() - 1, samples.size() * 99 / 100);
+        std::nth_element(samples.begin(), samples.begin() + p99Index, samples.end());
+        printf("  %-24s %8.3f %8.3f\n", name, mean, samples[p99Index]);
+    }
+} // namespace
+
+int wmain(int argc, wchar_t* argv[])
+{
+    Options options;
+    if (!ParseArguments(argc, argv, options))
+    {
+        printf("Usage: SampleRemoteBenchmark [-frames <count>] [-warmup <count>] [-cubes <count>] [-occlusionculling]\n");
+        return 1;
+    }
+
+    winrt::init_apartment();
+
+    auto deviceResources = std::make_shared<HeadlessDeviceResources>();
+    SyntheticStereoCamera camera(*deviceResources);
+
+    // A grid of cubes in front of the head. Rows farther back are partially hidden by the rows in front of them.
+    std::vector<std::unique_ptr<SpinningCubeRenderer>> cubes;
+    for (uint32_t i = 0; i < options.cubeCount; ++i)
+    {
+        auto cube = std::make_unique<SpinningCubeRenderer>(deviceResources);
+        const float x = (static_cast<float>(i % 8) - 3.5f) * 0.3f;
+        const float y = (static_cast<float>(i / 8 % 4) - 1.5f) * 0.3f;
+        cube->SetPosition({x, y, -2.0f - (i / 32) * 0.5f});
+        cubes.push_back(std::move(cube));
+    }
+
+    // The renderers load their shaders asynchronously, the first measured frame must not depend on how long that takes.
+    while (!std::all_of(cubes.begin(), cubes.end(), [](const auto& cube) { return cube->IsLoadingComplete(); }))
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::vector<BenchmarkRenderer> renderers;
+    renderers.push_back(
+        {"SpinningCube",
+         [&](uint32_t frame) {
+             for (auto& cube : cubes)
+             {
+                 cube->Update(static_cast<float>(frame) / 60.0f, nullptr, nullptr);
+             }
+         },
+         [&]() {
+             for (auto& cube : cubes)
+             {
+                 cube->Render(true, nullptr);
+             }
+         }});
+
+    // The pyramid is built after all renderers, so its GPU time is reported as a section of its own.
+    const size_t pyramidSection = renderers.size();
+    std::vector<float> pyramidGpuTimes;
+    std::vector<float> frameCpuTimes;
+    std::vector<float> frameGpuTimes;
+
+    winrt::com_ptr<ID3D11Query> frameDone;
+    const CD3D11_QUERY_DESC frameDoneDesc(D3D11_QUERY_EVENT);
+    winrt::check_hresult(deviceResources->GetD3DDevice()->CreateQuery(&frameDoneDesc, frameDone.put()));
+
+    DXHelper::GpuTimer& gpuTimer = deviceResources->GetGpuTimer();
+    const uint32_t endFrame = options.warmupFrameCount + options.frameCount;
+    for (uint32_t frame = 0; frame <= endFrame; ++frame)
+    {
+        // Each frame waits for the GPU below, so BeginFrame reads back the times of the previous frame.
+        deviceResources->UseImmediateD3DDeviceContext([&](ID3D11DeviceContext3* context) { gpuTimer.BeginFrame(context); });
+        if (frame > options.warmupFrameCount)
+        {
+            for (size_t section = 0; section < renderers.size(); ++section)
+            {
+                renderers[section].gpuTimes.push_back(gpuTimer.GetSectionTime(section));
+            }
+            if (options.occlusionCulling)
+            {
+                pyramidGpuTimes.push_back(gpuTimer.GetSectionTime(pyramidSection));
+            }
+            frameGpuTimes.push_back(gpuTimer.GetFrameTime());
+        }
+
+        if (frame == endFrame)
+        {
+            break;
+        }
+
+        const bool measured = frame >= options.warmupFrameCount;
+        const auto frameStart = std::chrono::steady_clock::now();
+
+        deviceResources->UseImmediateD3DDeviceContext([&](ID3D11DeviceContext3* context) { camera.BeginFrame(context, frame); });
+        deviceResources->GetOcclusionCuller().BeginFrame(options.occlusionCulling);
+
+        for (size_t section = 0; section < renderers.size(); ++section)
+        {
+            BenchmarkRenderer& renderer = renderers[section];
+            const auto start = std::chrono::steady_clock::now();
+            renderer.update(frame);
+            deviceResources->TimeGpuSection(section, [&]() {
+                deviceResources->UseImmediateD3DDeviceContext([&](ID3D11DeviceContext3* context) { camera.BindRenderState(context); });
+                renderer.render();
+            });
+            if (measured)
+            {
+                renderer.cpuTimes.push_back(MillisecondsSince(start));
+            }
+        }
+
+        if (options.occlusionCulling)
+        {
+            deviceResources->TimeGpuSection(pyramidSection, [&]() {
+                deviceResources->UseImmediateD3DDeviceContext([&](ID3D11DeviceContext3* context) {
+                    context->OMSetRenderTargets(0, nullptr, nullptr);
+                    deviceResources->GetOcclusionCuller().UpdatePyramid(
+                        context, camera.GetDepthTexture(), camera.GetViewProjection(), true);
+                });
+            });
+        }
+
+        if (measured)
+        {
+            frameCpuTimes.push_back(MillisecondsSince(frameStart));
+        }
+
+        // Wait for the GPU, like a swap chain with a single frame of latency would. This keeps frames from piling up in the
+        // queue and makes the GPU times of every frame available to the next one.
+        deviceResources->UseImmediateD3DDeviceContext([&](ID3D11DeviceContext3* context) {
+            gpuTimer.EndFrame(context);
+            context->End(frameDone.get());
+            context->Flush();
+        });
+
+        BOOL done = FALSE;
+        while (deviceResources->UseImmediateD3DDeviceContext([&](ID3D11DeviceContext3* context) {
+            return context->GetData(frameDone.get(), &done, sizeof(done), 0);
+        }) != S_OK)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    DXGI_ADAPTER_DESC2 adapterDesc = {};
+    deviceResources->GetDXGIAdapter()->GetDesc2(&adapterDesc);
+    printf("Adapter: %ls\n", adapterDesc.Description);
+    printf("Frames: %u (after %u warmup frames), cubes: %u, occlusion culling: %s\n\n",
+           options.frameCount,
+           options.warmupFrameCount,
+           options.cubeCount,
+           options.occlusionCulling ? "on" : "off");
+
+    printf("%-26s %8s %8s\n", "CPU time (ms)", "mean", "p99");
+    for (BenchmarkRenderer& renderer : renderers)
+    {
+        PrintStatistics(renderer.name, renderer.cpuTimes);
+    }
+    PrintStatistics("Frame", frameCpuTimes);
+
+    printf("\n%-26s %8s %8s\n", "GPU time (ms)", "mean", "p99");
+    for (BenchmarkRenderer& renderer : renderers)
+    {
+        PrintStatistics(renderer.name, renderer.gpuTimes);
+    }
+    if (options.occlusionCulling)
+    {
+        PrintStatistics("HiZPyramid", pyramidGpuTimes);
+    }
+    PrintStatistics("Frame", frameGpuTimes);
+
+    return 0;
+}
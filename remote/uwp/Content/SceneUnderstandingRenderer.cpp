@@ -14,11 +14,20 @@
 #include <content/SceneUnderstandingRenderer.h>
 
 #include <DbgLog.h>
+#include <ThreadConfiguration.h>
 #include <DirectXColors.h>
 #include <d3d11/DirectXHelper.h>
+#include <holographic/RenderPath.h>
 
 #include <winrt/Windows.Perception.Spatial.Preview.h>
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <execution>
+#include <fstream>
+#include <iterator>
+
 using namespace DirectX;
 
 using namespace winrt::Windows::Foundation;
@@ -33,7 +42,7 @@ namespace
     constexpr float LabelQuadWidth = 0.6f;
     constexpr float LabelQuadHeight = 0.3f;
 
-    // The texture size in pixels.
+    // The size of a label in the label atlas in pixels. The labels are stacked vertically in the atlas.
     constexpr int TextTextureWidth = 256;
     constexpr int TextTextureHeight = 128;
 
@@ -60,6 +69,42 @@ namespace
         {SceneObjectKind::World, SceneObjectLabel{L"World", {100, 255, 255}}} // Cyan'ish
     };
 
+    // The label atlas has one cell per entry of m_sceneQuadsLabels, in the order of the dictionary.
+    const int TextAtlasHeight = static_cast<int>(m_sceneQuadsLabels.size()) * TextTextureHeight;
+
+    int GetLabelAtlasCell(SceneObjectKind kind)
+    {
+        return static_cast<int>(std::distance(m_sceneQuadsLabels.begin(), m_sceneQuadsLabels.find(kind)));
+    }
+
+    // Returns the next count elements of type T of the data, or nullptr if there are less. Advances the data past them.
+    template <typename T>
+    const T* TakeSection(const byte*& data, size_t& remaining, size_t count)
+    {
+        if (count > remaining / sizeof(T))
+        {
+            return nullptr;
+        }
+
+        const T* section = reinterpret_cast<const T*>(data);
+        data += count * sizeof(T);
+        remaining -= count * sizeof(T);
+        return section;
+    }
+
+    // FNV-1a, continued from the hash of the previous data.
+    uint64_t HashBytes(uint64_t hash, const void* data, size_t size)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+        }
+        return hash;
+    }
+
+    constexpr uint64_t HashSeed = 0xCBF29CE484222325ull;
+
 } // namespace
 
 SceneUnderstandingRenderer::SceneUnderstandingRenderer(const std::shared_ptr<DXHelper::DeviceResources>& deviceResources)
@@ -75,17 +120,11 @@ SceneUnderstandingRenderer::~SceneUnderstandingRenderer()
 
 std::future<void> SceneUnderstandingRenderer::CreateDeviceDependentResources()
 {
-#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
-    std::wstring fileNamePrefix = L"";
-#else
-    std::wstring fileNamePrefix = L"ms-appx:///";
-#endif
-
     // Create the resources for label texture rendering before any thread switch occurs.
     {
         // Create texture description.
         CD3D11_TEXTURE2D_DESC textureDesc(
-            DXGI_FORMAT_B8G8R8A8_UNORM, TextTextureWidth, TextTextureHeight, 1, 1, D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET);
+            DXGI_FORMAT_B8G8R8A8_UNORM, TextTextureWidth, TextAtlasHeight, 1, 1, D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET);
 
         // Create font.
         winrt::check_hresult(m_deviceResources->GetDWriteFactory()->CreateTextFormat(
@@ -104,110 +143,124 @@ std::future<void> SceneUnderstandingRenderer::CreateDeviceDependentResources()
         CD3D11_SAMPLER_DESC samplerDesc(D3D11_DEFAULT);
         winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateSamplerState(&samplerDesc, m_textSamplerState.put()));
 
-        // Create a single texture for every label.
-        for (auto const& [kind, label] : m_sceneQuadsLabels)
-        {
-            // Create the texture.
-            winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateTexture2D(&textureDesc, nullptr, m_textTextures[kind].put()));
-
-            // Create the shader resource view.
-            winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateShaderResourceView(
-                m_textTextures[kind].get(), nullptr, m_textShaderResourceViews[kind].put()));
-
-            // Create the render target view.
-            winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateRenderTargetView(
-                m_textTextures[kind].get(), nullptr, m_textRenderTargets[kind].put()));
-
-            // Create the DXGI render targets.
-            D2D1_RENDER_TARGET_PROPERTIES props = D2D1::RenderTargetProperties(
-                D2D1_RENDER_TARGET_TYPE_DEFAULT, D2D1::PixelFormat(DXGI_FORMAT_UNKNOWN, D2D1_ALPHA_MODE_PREMULTIPLIED), 96, 96);
-            winrt::com_ptr<IDXGISurface> dxgiSurface;
-            m_textTextures[kind].as(dxgiSurface);
-            winrt::check_hresult(m_deviceResources->GetD2DFactory()->CreateDxgiSurfaceRenderTarget(
-                dxgiSurface.get(), &props, m_d2dTextRenderTargets[kind].put()));
-
-            // Create the brush.
-            winrt::check_hresult(
-                m_d2dTextRenderTargets[kind]->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::White), m_brushes[kind].put()));
-
-            // Create the layout.
-            winrt::check_hresult(m_deviceResources->GetDWriteFactory()->CreateTextLayout(
-                label.name.c_str(),
-                static_cast<UINT32>(label.name.size()),
-                m_textFormat.get(),
-                static_cast<float>(TextTextureWidth),  // Max width of the input text.
-                static_cast<float>(TextTextureHeight), // Max height of the input text.
-                m_layouts[kind].put()));
-
-            m_deviceResources->UseD3DDeviceContext([&](auto context) {
-                context->ClearRenderTargetView(m_textRenderTargets[kind].get(), DirectX::Colors::Transparent);
-
-                // Draw the label name to the texture.
-                m_d2dTextRenderTargets[kind]->BeginDraw();
-                m_d2dTextRenderTargets[kind]->DrawTextLayout(
-                    D2D1::Point2F(0, (m_layouts[kind]->GetMaxHeight() / 2.0f) - LabelFontSize),
-                    m_layouts[kind].get(),
-                    m_brushes[kind].get());
-                m_d2dTextRenderTargets[kind]->EndDraw();
-            });
-        }
+        // Create a single atlas texture for all labels.
+        winrt::com_ptr<ID3D11Texture2D> atlasTexture;
+        m_deviceResources->CreateTexture2D(MemoryAccounting::Tag::SceneUnderstanding, textureDesc, nullptr, atlasTexture.put());
+
+        // Create the shader resource view.
+        winrt::check_hresult(
+            m_deviceResources->GetD3DDevice()->CreateShaderResourceView(atlasTexture.get(), nullptr, m_textShaderResourceView.put()));
+
+        // The render target, the DXGI render target and the brush are only needed to draw the atlas once.
+        winrt::com_ptr<ID3D11RenderTargetView> textRenderTarget;
+        winrt::check_hresult(
+            m_deviceResources->GetD3DDevice()->CreateRenderTargetView(atlasTexture.get(), nullptr, textRenderTarget.put()));
+
+        D2D1_RENDER_TARGET_PROPERTIES props = D2D1::RenderTargetProperties(
+            D2D1_RENDER_TARGET_TYPE_DEFAULT, D2D1::PixelFormat(DXGI_FORMAT_UNKNOWN, D2D1_ALPHA_MODE_PREMULTIPLIED), 96, 96);
+        winrt::com_ptr<IDXGISurface> dxgiSurface;
+        atlasTexture.as(dxgiSurface);
+        winrt::com_ptr<ID2D1RenderTarget> d2dTextRenderTarget;
+        winrt::check_hresult(
+            m_deviceResources->GetD2DFactory()->CreateDxgiSurfaceRenderTarget(dxgiSurface.get(), &props, d2dTextRenderTarget.put()));
+
+        winrt::com_ptr<ID2D1SolidColorBrush> brush;
+        winrt::check_hresult(d2dTextRenderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::White), brush.put()));
+
+        m_deviceResources->UseD3DDeviceContext([&](auto context) {
+            context->ClearRenderTargetView(textRenderTarget.get(), DirectX::Colors::Transparent);
+
+            // Draw the label names to their cells of the atlas.
+            d2dTextRenderTarget->BeginDraw();
+            for (auto const& [kind, label] : m_sceneQuadsLabels)
+            {
+                winrt::com_ptr<IDWriteTextLayout> layout;
+                winrt::check_hresult(m_deviceResources->GetDWriteFactory()->CreateTextLayout(
+                    label.name.c_str(),
+                    static_cast<UINT32>(label.name.size()),
+                    m_textFormat.get(),
+                    static_cast<float>(TextTextureWidth),  // Max width of the input text.
+                    static_cast<float>(TextTextureHeight), // Max height of the input text.
+                    layout.put()));
+
+                const float cellTop = static_cast<float>(GetLabelAtlasCell(kind) * TextTextureHeight);
+                d2dTextRenderTarget->DrawTextLayout(
+                    D2D1::Point2F(0, cellTop + (layout->GetMaxHeight() / 2.0f) - LabelFontSize), layout.get(), brush.get());
+            }
+            d2dTextRenderTarget->EndDraw();
+        });
     }
 
-    // Vertex shader.
+    // The quads and labels are drawn without the geometry shader on devices that can set the render target array index from the
+    // vertex shader. The wireframe shading of the meshes needs the barycentric coordinates computed by the geometry shader.
+    m_usingVprtShaders = m_deviceResources->GetDeviceSupportsVprt();
+    const std::wstring vertexShaderFileName = m_deviceResources->GetVertexShaderFileName(L"SU_VertexShader");
+
+    // All shaders are requested before awaiting any of them, so their files are read in parallel.
+    DXHelper::ShaderCache& shaderCache = m_deviceResources->GetShaderCache();
+    auto vertexShader = shaderCache.GetVertexShaderAsync(vertexShaderFileName);
+    auto meshVertexShader = shaderCache.GetVertexShaderAsync(L"SUMesh_VertexShader.cso");
+    auto quadsPixelShader = shaderCache.GetPixelShaderAsync(L"SUQuads_PixelShader.cso");
+    auto labelPixelShader = shaderCache.GetPixelShaderAsync(L"SULabel_PixelShader.cso");
+    auto meshPixelShader = shaderCache.GetPixelShaderAsync(L"SUMesh_PixelShader.cso");
+    auto geometryShader = shaderCache.GetGeometryShaderAsync(L"SU_GeometryShader.cso");
+
+    // Vertex shader for the scene quads and their labels. It has no input layout, the quads are read from the quad buffer.
+    m_vertexShader = co_await vertexShader;
+
+    // Vertex shader for the scene meshes.
     {
-        std::vector<byte> vertexShaderFileData = co_await DXHelper::ReadDataAsync(fileNamePrefix + L"SU_VertexShader.cso");
-        winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateVertexShader(
-            vertexShaderFileData.data(), vertexShaderFileData.size(), nullptr, m_vertexShader.put()));
+        m_meshVertexShader = co_await meshVertexShader;
+        const DXHelper::ShaderCache::Bytecode vertexShaderBytecode = co_await shaderCache.GetBytecodeAsync(L"SUMesh_VertexShader.cso");
 
-        constexpr std::array<D3D11_INPUT_ELEMENT_DESC, 3> vertexDesc = {{
-            {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
-            {"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0},
-            {"COLOR", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 20, D3D11_INPUT_PER_VERTEX_DATA, 0},
+        constexpr std::array<D3D11_INPUT_ELEMENT_DESC, 1> vertexDesc = {{
+            {"POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0},
         }};
 
         winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateInputLayout(
             vertexDesc.data(),
             static_cast<UINT>(vertexDesc.size()),
-            vertexShaderFileData.data(),
-            static_cast<UINT>(vertexShaderFileData.size()),
-            m_inputLayout.put()));
-    }
-
-    // Pixel shader for scene quads.
-    {
-        std::vector<byte> pixelShaderFileData = co_await DXHelper::ReadDataAsync(fileNamePrefix + L"SUQuads_PixelShader.cso");
-        winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreatePixelShader(
-            pixelShaderFileData.data(), pixelShaderFileData.size(), nullptr, m_quadsPixelShader.put()));
+            vertexShaderBytecode.data(),
+            static_cast<UINT>(vertexShaderBytecode.size()),
+            m_meshInputLayout.put()));
     }
 
-    // Pixel shader for scene quad labels.
-    {
-        std::vector<byte> pixelShaderFileData = co_await DXHelper::ReadDataAsync(fileNamePrefix + L"SULabel_PixelShader.cso");
-        winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreatePixelShader(
-            pixelShaderFileData.data(), pixelShaderFileData.size(), nullptr, m_labelPixelShader.put()));
-    }
-
-    // Pixel shader for scene mesh.
-    {
-        std::vector<byte> pixelShaderFileData = co_await DXHelper::ReadDataAsync(fileNamePrefix + L"SUMesh_PixelShader.cso");
-        winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreatePixelShader(
-            pixelShaderFileData.data(), pixelShaderFileData.size(), nullptr, m_meshPixelShader.put()));
-    }
+    // Pixel shaders for scene quads, scene quad labels and the scene mesh.
+    m_quadsPixelShader = co_await quadsPixelShader;
+    m_labelPixelShader = co_await labelPixelShader;
+    m_meshPixelShader = co_await meshPixelShader;
 
     // Geometry shader.
-    {
-        std::vector<byte> geometryShaderFileData = co_await DXHelper::ReadDataAsync(fileNamePrefix + L"SU_GeometryShader.cso");
-
-        winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateGeometryShader(
-            geometryShaderFileData.data(), geometryShaderFileData.size(), nullptr, m_geometryShader.put()));
-    }
+    m_geometryShader = co_await geometryShader;
 
     // Rasterizer description.
     D3D11_RASTERIZER_DESC rasterizerDesc = {D3D11_FILL_SOLID, D3D11_CULL_BACK};
     winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateRasterizerState(&rasterizerDesc, m_rasterizerState.put()));
 
-    const CD3D11_BUFFER_DESC constantBufferDesc(sizeof(DirectX::XMFLOAT4X4), D3D11_BIND_CONSTANT_BUFFER);
-    winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(&constantBufferDesc, nullptr, m_modelConstantBuffer.put()));
+    const CD3D11_BUFFER_DESC constantBufferDesc(
+        sizeof(DirectX::XMFLOAT4X4), D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_DYNAMIC, D3D11_CPU_ACCESS_WRITE);
+    m_deviceResources->CreateBuffer(MemoryAccounting::Tag::SceneUnderstanding, constantBufferDesc, nullptr, m_modelConstantBuffer.put());
+
+    // The quads have the size of the scene quads, the labels have a fixed size and a slight offset in the z-direction.
+    {
+        const QuadPassConstantBuffer quadPass = {{1.0f, 1.0f}, {0.0f, 0.0f}, 0.0f, 0, 0.0f, 0.0f};
+        const QuadPassConstantBuffer labelPass = {
+            {0.0f, 0.0f},
+            {LabelQuadWidth, LabelQuadHeight},
+            0.01f,
+            1,
+            static_cast<float>(TextTextureHeight) / TextAtlasHeight,
+            0.5f / TextAtlasHeight};
+
+        const CD3D11_BUFFER_DESC passBufferDesc(sizeof(QuadPassConstantBuffer), D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_IMMUTABLE);
+        D3D11_SUBRESOURCE_DATA passBufferData = {0};
+        passBufferData.pSysMem = &quadPass;
+        m_deviceResources->CreateBuffer(
+            MemoryAccounting::Tag::SceneUnderstanding, passBufferDesc, &passBufferData, m_quadPassConstantBuffer.put());
+        passBufferData.pSysMem = &labelPass;
+        m_deviceResources->CreateBuffer(
+            MemoryAccounting::Tag::SceneUnderstanding, passBufferDesc, &passBufferData, m_labelPassConstantBuffer.put());
+    }
 
     // Create the blend state.
     {
@@ -235,47 +288,55 @@ std::future<void> SceneUnderstandingRenderer::CreateDeviceDependentResources()
     }
 
     m_loadingComplete = true;
+
+    bool reloadSceneCache = false;
+    if (!m_sceneCachePath.empty())
+    {
+        std::lock_guard lock(m_mutex);
+        reloadSceneCache = m_scene == nullptr;
+    }
+
+    if (reloadSceneCache)
+    {
+        LoadSceneCacheAsync();
+    }
 }
 
 void SceneUnderstandingRenderer::ReleaseDeviceDependentResources()
 {
     m_loadingComplete = false;
+    m_usingVprtShaders = false;
 
-    m_inputLayout = nullptr;
     m_vertexShader = nullptr;
     m_geometryShader = nullptr;
     m_quadsPixelShader = nullptr;
     m_meshPixelShader = nullptr;
+    m_meshInputLayout = nullptr;
+    m_meshVertexShader = nullptr;
     m_rasterizerState = nullptr;
     m_modelConstantBuffer = nullptr;
+    m_quadPassConstantBuffer = nullptr;
+    m_labelPassConstantBuffer = nullptr;
 
-    for (auto const& [kind, label] : m_sceneQuadsLabels)
-    {
-        m_textTextures[kind] = nullptr;
-        m_textShaderResourceViews[kind] = nullptr;
-        m_textRenderTargets[kind] = nullptr;
-        m_d2dTextRenderTargets[kind] = nullptr;
-        m_brushes[kind] = nullptr;
-        m_layouts[kind] = nullptr;
-    }
-
+    m_textShaderResourceView = nullptr;
     m_textFormat = nullptr;
     m_textSamplerState = nullptr;
     m_labelPixelShader = nullptr;
     m_blendState = nullptr;
+
+    // The buffers are rebuilt from the scene by the next update, or loaded from the scene cache again if there is no scene yet.
+    ReleaseSceneBuffers();
 }
 
 void SceneUnderstandingRenderer::SetScene(Scene scene, SpatialStationaryFrameOfReference lastUpdateLocation)
 {
-    // While the vertices are updated asynchronously the scene cannot be set.
+    // The vertices of the previous scene stay in use until the vertices of this scene are published.
     std::lock_guard lock(m_mutex);
 
     m_scene = scene;
     m_sceneLastUpdateLocation = lastUpdateLocation;
 
     m_verticesOutdated = true;
-
-    m_coordinateSystem = nullptr;
 }
 
 void SceneUnderstandingRenderer::Update(SpatialCoordinateSystem renderingCoordinateSystem)
@@ -286,23 +347,40 @@ void SceneUnderstandingRenderer::Update(SpatialCoordinateSystem renderingCoordin
         return;
     }
 
-    // Only create the vertices once if the scene was updated.
-    std::lock_guard lock(m_mutex);
-    if (m_verticesOutdated && !m_verticesUpdating)
+    // The rendering type may be toggled while the update runs, the whole update uses the same one.
+    const RenderingType renderingType = m_renderingType;
+
+    // Without rendering the buffers are only kept so the scene shows up right away once rendering is enabled again. While the
+    // video memory usage is over the target they are released, and rebuilt from the scene once rendering is enabled.
+    if (renderingType == RenderingType::None && m_deviceResources->GetVideoMemoryBudget().IsOverTarget())
+    {
+        ReleaseSceneBuffers();
+    }
+
+    // Only create the vertices once if the scene was updated and is rendered.
     {
-        m_verticesUpdating = true;
-        CreateVerticesAsync(renderingCoordinateSystem, m_sceneLastUpdateLocation);
+        std::lock_guard lock(m_mutex);
+        if (m_verticesOutdated && !m_verticesUpdating && renderingType != RenderingType::None)
+        {
+            m_verticesUpdating = true;
+            CreateVerticesAsync(renderingCoordinateSystem, m_sceneLastUpdateLocation);
+        }
     }
 
+    // Pick up the most recently published buffers. Until the next update, rendering uses exactly this set.
+    m_renderBuffers = std::atomic_load(&m_sceneBuffers);
+
     m_validSceneToRenderingTransform = false;
 
-    if (m_scene)
+    if (m_renderBuffers)
     {
-        if (m_coordinateSystem == nullptr)
+        if (m_coordinateSystem == nullptr || m_coordinateSystemNodeId != m_renderBuffers->originSpatialGraphNodeId)
         {
             try
             {
-                m_coordinateSystem = Preview::SpatialGraphInteropPreview::CreateCoordinateSystemForNode(m_scene.OriginSpatialGraphNodeId());
+                m_coordinateSystem =
+                    Preview::SpatialGraphInteropPreview::CreateCoordinateSystemForNode(m_renderBuffers->originSpatialGraphNodeId);
+                m_coordinateSystemNodeId = m_renderBuffers->originSpatialGraphNodeId;
             }
             catch (winrt::hresult_error const&)
             {
@@ -326,193 +404,654 @@ void SceneUnderstandingRenderer::Update(SpatialCoordinateSystem renderingCoordin
 
                 m_deviceResources->UseD3DDeviceContext([&](auto context) {
                     // Update the model transform buffer for the holograms.
-                    context->UpdateSubresource(m_modelConstantBuffer.get(), 0, nullptr, &model, 0, 0);
+                    DXHelper::UpdateDynamicBuffer(context, m_modelConstantBuffer.get(), model);
                 });
 
                 m_validSceneToRenderingTransform = true;
+                m_renderingBounds = {transform(m_renderBuffers->bounds.center, sceneToRenderingTransform), m_renderBuffers->bounds.radius};
             }
         }
     }
 }
 
+void SceneUnderstandingRenderer::AddBounds(ContentDepthRange& depthRange) const
+{
+    if (m_renderingType != RenderingType::None && m_validSceneToRenderingTransform && m_renderingBounds.radius > 0.0f)
+    {
+        depthRange.Add(m_renderingBounds);
+    }
+}
+
 winrt::fire_and_forget SceneUnderstandingRenderer::CreateVerticesAsync(
     SpatialCoordinateSystem renderingCoordinateSystem, SpatialStationaryFrameOfReference lastUpdateLocation)
 {
     auto weakThis = weak_from_this();
-    co_await winrt::resume_background();
+    co_await ThreadConfiguration::ResumeOnWorker{};
 
     if (auto strongThis = weakThis.lock())
     {
-        std::lock_guard lock(m_mutex);
-
-        // Clear the vertices.
-        m_quadVertices.clear();
-        m_quadLabelsVertices.clear();
-        m_meshVertices.clear();
+        // Take the scene to build the vertices for. Scenes set from now on mark the vertices as outdated again and are
+        // picked up by the next update.
+        Scene scene = nullptr;
+        bool objectCacheOutdated = false;
+        {
+            std::lock_guard lock(m_mutex);
+            scene = m_scene;
+            m_verticesOutdated = false;
+            objectCacheOutdated = std::exchange(m_objectCacheOutdated, false);
+        }
 
-        // Collect all scene objects, then iterate to find quad entities
-        for (const SceneObject& object : m_scene.SceneObjects())
+        if (scene)
         {
-            // Check if the object is in the quads labels.
-            auto quadLabelPos = m_sceneQuadsLabels.find(object.Kind());
-            if (quadLabelPos != m_sceneQuadsLabels.end())
+            const auto buildStart = std::chrono::steady_clock::now();
+
+            // The cached geometry is in scene space, so it can only be reused if the scene origin stays the same.
+            const winrt::guid originId = scene.OriginSpatialGraphNodeId();
+            if (objectCacheOutdated || originId != m_objectCacheOriginId)
             {
-                const SceneObjectLabel& label = quadLabelPos->second;
-                auto [r, g, b] = label.color;
-                float3 color = {r / 255.0f, g / 255.0f, b / 255.0f};
+                m_objectCache.clear();
+                m_objectCacheOriginId = originId;
+            }
+            m_objectCacheGeneration++;
 
-                // Adds the quads to the vertex buffer for rendering, using the color indicated by the label dictionary for the quad's owner
-                // entity's type.
-                AddSceneQuadsVertices(object, color);
+            // Collect all rendered scene objects, only objects which are new or changed generate geometry.
+            std::vector<RenderedSceneObject> objects;
+            for (const SceneObject& object : scene.SceneObjects())
+            {
+                AddSceneObject(object, objects);
+            }
+
+            // No cache entries are added or erased meanwhile, so the objects can write their entries from several threads.
+            std::for_each(std::execution::par, objects.begin(), objects.end(), [this](const RenderedSceneObject& rendered) {
+                if (rendered.generate)
+                {
+                    GenerateSceneObjectGeometry(rendered.object, (m_objectCache.begin() + rendered.cacheIndex)->second);
+                }
+            });
+
+            SceneVertices vertices;
+            AppendSceneObjects(objects, vertices);
 
-                // Adds the label quads to the vertex buffer for rendering.
-                AddSceneQuadLabelVertices(object, color);
+            // Drop the geometry of objects which are no longer part of the scene.
+            for (auto it = m_objectCache.cbegin(); it != m_objectCache.cend();)
+            {
+                it = it->second.generation == m_objectCacheGeneration ? std::next(it) : m_objectCache.erase(it);
             }
 
-            // Check if the object is in the mesh labels.
-            auto meshLabelPos = m_sceneMeshLabels.find(object.Kind());
-            if (meshLabelPos != m_sceneMeshLabels.end())
+            const FrustumCulling::CullingSphere bounds = ComputeBounds(vertices);
+
+            std::vector<QuantizedMeshBatch> meshBatches;
+            for (auto& [kind, batch] : vertices.meshBatches)
             {
-                const SceneObjectLabel& label = meshLabelPos->second;
-                auto [r, g, b] = label.color;
-                float3 color = {r / 255.0f, g / 255.0f, b / 255.0f};
+                if (!batch.indices.empty())
+                {
+                    meshBatches.push_back(QuantizeMeshBatch(std::move(batch)));
+                }
+            }
 
-                // Adds the sceneMeshes to the vertex buffer for rendering, using the color indicated by the label dictionary for the quad's
-                // owner entity's type.
-                AddSceneMeshVertices(object, color);
+            // Create the d3d11 vertex buffers of the new set. The set which is currently published stays untouched.
+            auto buffers = std::make_shared<SceneBuffers>();
+            buffers->quads = CreateQuadBuffer({vertices.quads.data(), vertices.quads.data() + vertices.quads.size()});
+            for (const QuantizedMeshBatch& batch : meshBatches)
+            {
+                buffers->meshBatches.push_back(CreateMeshBatchBuffers(
+                    {batch.vertices.data(), batch.vertices.data() + batch.vertices.size()},
+                    {batch.indices.data(), batch.indices.data() + batch.indices.size()},
+                    batch.constants));
             }
-        }
+            buffers->originSpatialGraphNodeId = originId;
+            buffers->bounds = bounds;
 
-        // Create the d3d11 vertex buffers.
-        const UINT stride = sizeof(VertexPositionUVColor);
-        const UINT offset = 0;
+            m_lastVertexBuildMilliseconds =
+                std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
 
-        // Quads.
-        if (!m_quadVertices.empty())
-        {
-            m_quadVerticesBuffer = nullptr;
-            D3D11_SUBRESOURCE_DATA vertexBufferData = {0};
-            vertexBufferData.pSysMem = m_quadVertices.data();
-            const CD3D11_BUFFER_DESC vertexBufferDesc(static_cast<UINT>(m_quadVertices.size() * stride), D3D11_BIND_VERTEX_BUFFER);
-            winrt::check_hresult(
-                m_deviceResources->GetD3DDevice()->CreateBuffer(&vertexBufferDesc, &vertexBufferData, m_quadVerticesBuffer.put()));
-        }
-        // Labels.
-        for (auto const& [kind, vertices] : m_quadLabelsVertices)
-        {
-            if (!vertices.empty())
+            if (!m_sceneCachePath.empty())
             {
-                m_quadLabelsVerticesBuffer[kind] = nullptr;
-                D3D11_SUBRESOURCE_DATA vertexBufferData = {0};
-                vertexBufferData.pSysMem = vertices.data();
-                const CD3D11_BUFFER_DESC vertexBufferDesc(static_cast<UINT>(vertices.size() * stride), D3D11_BIND_VERTEX_BUFFER);
-                winrt::check_hresult(m_deviceResources->GetD3DDevice()->CreateBuffer(
-                    &vertexBufferDesc, &vertexBufferData, m_quadLabelsVerticesBuffer[kind].put()));
+                WriteSceneCache(vertices, meshBatches, originId, bounds);
+            }
+
+            std::lock_guard lock(m_mutex);
+
+            // A reset while the vertices were built discards them.
+            if (m_scene)
+            {
+                // The buffers were created with their initial data, so they are complete once published.
+                std::atomic_store(&m_sceneBuffers, std::shared_ptr<const SceneBuffers>(std::move(buffers)));
             }
-        }
-        // Mesh.
-        if (!m_meshVertices.empty())
-        {
-            m_meshVerticesBuffer = nullptr;
-            D3D11_SUBRESOURCE_DATA vertexBufferData = {0};
-            vertexBufferData.pSysMem = m_meshVertices.data();
-            const CD3D11_BUFFER_DESC vertexBufferDesc(static_cast<UINT>(m_meshVertices.size() * stride), D3D11_BIND_VERTEX_BUFFER);
-            winrt::check_hresult(
-                m_deviceResources->GetD3DDevice()->CreateBuffer(&vertexBufferDesc, &vertexBufferData, m_meshVerticesBuffer.put()));
         }
 
         // Done with updating.
+        std::lock_guard lock(m_mutex);
         m_verticesUpdating = false;
-        // All the vertices are now up to date and can be used for rendering.
-        m_verticesOutdated = false;
     }
 }
 
-void SceneUnderstandingRenderer::AddSceneQuadsVertices(const SceneObject& object, const float3& color)
+FrustumCulling::CullingSphere SceneUnderstandingRenderer::ComputeBounds(const SceneVertices& vertices)
 {
-    float4x4 objectToSceneTransform = object.GetLocationAsMatrix();
-    for (const SceneQuad& quad : object.Quads())
+    // The sphere around the axis aligned bounding box is a good enough fit for a room sized scene.
+    float3 minPosition = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float3 maxPosition = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    auto addPosition = [&](const float3& position) {
+        minPosition = min(minPosition, position);
+        maxPosition = max(maxPosition, position);
+    };
+
+    for (const QuadInstance& quad : vertices.quads)
+    {
+        // The columns of the transform are the axes and the origin of the quad in scene space.
+        const XMFLOAT4* rows = quad.objectToScene;
+        const float3 origin = {rows[0].w, rows[1].w, rows[2].w};
+        const float3 halfWidth = float3(rows[0].x, rows[1].x, rows[2].x) * (quad.extents.x / 2);
+        const float3 halfHeight = float3(rows[0].y, rows[1].y, rows[2].y) * (quad.extents.y / 2);
+        addPosition(origin - halfWidth - halfHeight);
+        addPosition(origin + halfWidth - halfHeight);
+        addPosition(origin - halfWidth + halfHeight);
+        addPosition(origin + halfWidth + halfHeight);
+    }
+    for (const auto& [kind, batch] : vertices.meshBatches)
     {
-        // Create the quad's corner points in object space.
-        const float width = quad.Extents().x;
-        const float height = quad.Extents().y;
-        float3 positions[4] = {
-            {-width / 2, -height / 2, 0.0f}, {width / 2, -height / 2, 0.0f}, {-width / 2, height / 2, 0.0f}, {width / 2, height / 2, 0.0f}};
+        for (const float3& position : batch.positions)
+        {
+            addPosition(position);
+        }
+    }
 
-        // Transform the vertices to scene space.
-        for (int i = 0; i < 4; ++i)
+    if (minPosition.x > maxPosition.x)
+    {
+        return {};
+    }
+    return {0.5f * (minPosition + maxPosition), 0.5f * length(maxPosition - minPosition)};
+}
+
+SceneUnderstandingRenderer::QuadBuffer SceneUnderstandingRenderer::CreateQuadBuffer(winrt::array_view<const QuadInstance> quads)
+{
+    QuadBuffer quadBuffer;
+    if (!quads.empty())
+    {
+        ID3D11Device* device = m_deviceResources->GetD3DDevice();
+
+        D3D11_SUBRESOURCE_DATA quadBufferData = {0};
+        quadBufferData.pSysMem = quads.data();
+        const CD3D11_BUFFER_DESC quadBufferDesc(
+            static_cast<UINT>(quads.size() * sizeof(QuadInstance)),
+            D3D11_BIND_SHADER_RESOURCE,
+            D3D11_USAGE_IMMUTABLE,
+            0,
+            D3D11_RESOURCE_MISC_BUFFER_STRUCTURED,
+            sizeof(QuadInstance));
+        m_deviceResources->CreateBuffer(
+            MemoryAccounting::Tag::SceneUnderstanding, quadBufferDesc, &quadBufferData, quadBuffer.buffer.put());
+
+        const CD3D11_SHADER_RESOURCE_VIEW_DESC quadViewDesc(
+            quadBuffer.buffer.get(), DXGI_FORMAT_UNKNOWN, 0, static_cast<UINT>(quads.size()));
+        winrt::check_hresult(device->CreateShaderResourceView(quadBuffer.buffer.get(), &quadViewDesc, quadBuffer.view.put()));
+        quadBuffer.quadCount = static_cast<UINT>(quads.size());
+    }
+    return quadBuffer;
+}
+
+SceneUnderstandingRenderer::QuantizedMeshBatch SceneUnderstandingRenderer::QuantizeMeshBatch(SceneMeshBatch&& batch)
+{
+    // Quantize the positions to the bounds of the batch.
+    float3 minPosition = batch.positions.front();
+    float3 maxPosition = batch.positions.front();
+    for (const float3& position : batch.positions)
+    {
+        minPosition = min(minPosition, position);
+        maxPosition = max(maxPosition, position);
+    }
+
+    const float3 offset = (minPosition + maxPosition) * 0.5f;
+    const float3 scale = max((maxPosition - minPosition) * 0.5f, float3(1e-4f));
+
+    QuantizedMeshBatch quantized;
+    quantized.vertices.resize(batch.positions.size());
+    for (size_t i = 0; i < batch.positions.size(); ++i)
+    {
+        const float3 normalized = clamp((batch.positions[i] - offset) / scale, float3(-1.0f), float3(1.0f));
+        quantized.vertices[i].pos[0] = static_cast<int16_t>(std::lround(normalized.x * INT16_MAX));
+        quantized.vertices[i].pos[1] = static_cast<int16_t>(std::lround(normalized.y * INT16_MAX));
+        quantized.vertices[i].pos[2] = static_cast<int16_t>(std::lround(normalized.z * INT16_MAX));
+        quantized.vertices[i].pos[3] = INT16_MAX;
+    }
+    quantized.indices = std::move(batch.indices);
+
+    quantized.constants.positionOffset = {offset.x, offset.y, offset.z, 0.0f};
+    quantized.constants.positionScale = {scale.x, scale.y, scale.z, 0.0f};
+    quantized.constants.color = {batch.color.x, batch.color.y, batch.color.z, 1.0f};
+    return quantized;
+}
+
+SceneUnderstandingRenderer::MeshBatchBuffers SceneUnderstandingRenderer::CreateMeshBatchBuffers(
+    winrt::array_view<const MeshVertex> vertices, winrt::array_view<const uint32_t> indices, const MeshBatchConstantBuffer& constants)
+{
+    MeshBatchBuffers buffers;
+
+    {
+        D3D11_SUBRESOURCE_DATA vertexBufferData = {0};
+        vertexBufferData.pSysMem = vertices.data();
+        const CD3D11_BUFFER_DESC vertexBufferDesc(
+            static_cast<UINT>(vertices.size() * sizeof(MeshVertex)), D3D11_BIND_VERTEX_BUFFER, D3D11_USAGE_IMMUTABLE);
+        m_deviceResources->CreateBuffer(
+            MemoryAccounting::Tag::SceneUnderstanding, vertexBufferDesc, &vertexBufferData, buffers.vertexBuffer.put());
+        buffers.vertexCount = static_cast<UINT>(vertices.size());
+    }
+
+    {
+        D3D11_SUBRESOURCE_DATA indexBufferData = {0};
+        indexBufferData.pSysMem = indices.data();
+        const CD3D11_BUFFER_DESC indexBufferDesc(
+            static_cast<UINT>(indices.size() * sizeof(uint32_t)), D3D11_BIND_INDEX_BUFFER, D3D11_USAGE_IMMUTABLE);
+        m_deviceResources->CreateBuffer(
+            MemoryAccounting::Tag::SceneUnderstanding, indexBufferDesc, &indexBufferData, buffers.indexBuffer.put());
+        buffers.indexCount = static_cast<UINT>(indices.size());
+    }
+
+    {
+        D3D11_SUBRESOURCE_DATA constantBufferData = {0};
+        constantBufferData.pSysMem = &constants;
+        const CD3D11_BUFFER_DESC constantBufferDesc(sizeof(MeshBatchConstantBuffer), D3D11_BIND_CONSTANT_BUFFER, D3D11_USAGE_IMMUTABLE);
+        m_deviceResources->CreateBuffer(
+            MemoryAccounting::Tag::SceneUnderstanding, constantBufferDesc, &constantBufferData, buffers.constantBuffer.put());
+    }
+
+    return buffers;
+}
+
+uint64_t SceneUnderstandingRenderer::SceneBuffers::GetSizeInBytes() const
+{
+    uint64_t sizeInBytes = uint64_t{quads.quadCount} * sizeof(QuadInstance);
+    for (const MeshBatchBuffers& batch : meshBatches)
+    {
+        sizeInBytes += uint64_t{batch.vertexCount} * sizeof(MeshVertex) + uint64_t{batch.indexCount} * sizeof(uint32_t) +
+                       sizeof(MeshBatchConstantBuffer);
+    }
+    return sizeInBytes;
+}
+
+void SceneUnderstandingRenderer::EnableSceneCache(const std::wstring& filename)
+{
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+    m_sceneCachePath = DXHelper::GetExecutableRelativePath(filename);
+#else
+    m_sceneCachePath =
+        std::filesystem::path(winrt::Windows::Storage::ApplicationData::Current().LocalFolder().Path().c_str()) / filename;
+#endif
+
+    // The cached scene is meant to be seen on the first frame.
+    RenderingType expected = RenderingType::None;
+    m_renderingType.compare_exchange_strong(expected, RenderingType::All);
+
+    LoadSceneCacheAsync();
+}
+
+void SceneUnderstandingRenderer::WriteSceneCache(
+    const SceneVertices& vertices,
+    const std::vector<QuantizedMeshBatch>& meshBatches,
+    const winrt::guid& originId,
+    const FrustumCulling::CullingSphere& bounds) const
+{
+    SceneCacheHeader header;
+    header.originSpatialGraphNodeId = originId;
+    header.bounds = bounds;
+    header.quadCount = static_cast<uint32_t>(vertices.quads.size());
+    header.meshBatchCount = static_cast<uint32_t>(meshBatches.size());
+
+    // The previous file is only replaced once the new one was written completely.
+    std::filesystem::path temporaryPath = m_sceneCachePath;
+    temporaryPath += L".tmp";
+
+    ThreadConfiguration::BackgroundPriorityScope backgroundPriority;
+    std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+    auto write = [&file](const void* data, size_t size) {
+        file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+    };
+
+    write(&header, sizeof(header));
+    write(vertices.quads.data(), vertices.quads.size() * sizeof(QuadInstance));
+    for (const QuantizedMeshBatch& batch : meshBatches)
+    {
+        const SceneCacheMeshBatch batchHeader = {
+            batch.constants, static_cast<uint32_t>(batch.vertices.size()), static_cast<uint32_t>(batch.indices.size())};
+        write(&batchHeader, sizeof(batchHeader));
+        write(batch.vertices.data(), batch.vertices.size() * sizeof(MeshVertex));
+        write(batch.indices.data(), batch.indices.size() * sizeof(uint32_t));
+    }
+
+    file.close();
+    if (!file)
+    {
+        DebugLog(L"Failed to write the scene cache %s.\n", temporaryPath.c_str());
+        return;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, m_sceneCachePath, error);
+    if (error)
+    {
+        DebugLog(L"Failed to replace the scene cache %s.\n", m_sceneCachePath.c_str());
+    }
+}
+
+winrt::fire_and_forget SceneUnderstandingRenderer::LoadSceneCacheAsync()
+{
+    auto weakThis = weak_from_this();
+    const std::wstring path = m_sceneCachePath.wstring();
+
+    DXHelper::FileView file;
+    try
+    {
+        file = co_await DXHelper::MapDataAsync(path);
+    }
+    catch (...)
+    {
+        // There is no cache yet, it is written once the first scene was computed.
+        co_return;
+    }
+
+    // Creating the buffers reads the whole file, which does not need to happen on the thread the file was read on.
+    co_await ThreadConfiguration::ResumeOnWorker{};
+
+    if (auto strongThis = weakThis.lock())
+    {
+        std::shared_ptr<SceneBuffers> buffers;
+        try
+        {
+            buffers = CreateSceneBuffersFromCache(file);
+        }
+        catch (const winrt::hresult_error&)
         {
-            positions[i] = transform(positions[i], objectToSceneTransform);
         }
 
-        // Create uv coordinates so that the checkerboard pattern becomes uniformly.
-        float2 uvs[4] = {{0, 0}, {0, width}, {height, 0}, {height, width}};
+        if (!buffers)
+        {
+            DebugLog(L"Ignoring the invalid or outdated scene cache %s.\n", path.c_str());
+            co_return;
+        }
+
+        std::lock_guard lock(m_mutex);
 
-        // Create the vertices with uv coordinates for the quad.
-        AppendQuad(positions, uvs, height, width, color, m_quadVertices);
+        // A computed scene is more recent than the cached one.
+        if (!std::atomic_load(&m_sceneBuffers))
+        {
+            std::atomic_store(&m_sceneBuffers, std::shared_ptr<const SceneBuffers>(std::move(buffers)));
+        }
     }
 }
 
-void SceneUnderstandingRenderer::AddSceneQuadLabelVertices(const SceneObject& object, const float3& color)
+std::shared_ptr<SceneUnderstandingRenderer::SceneBuffers> SceneUnderstandingRenderer::CreateSceneBuffersFromCache(
+    const DXHelper::FileView& file)
 {
-    float4x4 objectToSceneTransform = object.GetLocationAsMatrix();
-    for (const SceneQuad& quad : object.Quads())
+    // The buffers are created right from the file contents. Every section is a multiple of 4 bytes, so all of them stay aligned.
+    const byte* data = file.data();
+    size_t remaining = file.size();
+
+    const SceneCacheHeader* header = TakeSection<SceneCacheHeader>(data, remaining, 1);
+    if (!header || header->magic != SceneCacheHeader::Magic || header->version != SceneCacheHeader::Version)
+    {
+        return nullptr;
+    }
+
+    const QuadInstance* quads = TakeSection<QuadInstance>(data, remaining, header->quadCount);
+    if (!quads)
     {
-        // Create the quad's corner points in object space with a slight offset in the z-direction.
-        float3 positions[4] = {
-            {-LabelQuadWidth / 2, -LabelQuadHeight / 2, 0.01f},
-            {LabelQuadWidth / 2, -LabelQuadHeight / 2, 0.01f},
-            {-LabelQuadWidth / 2, LabelQuadHeight / 2, 0.01f},
-            {LabelQuadWidth / 2, LabelQuadHeight / 2, 0.01f}};
+        return nullptr;
+    }
 
-        // Transform the vertices to scene space.
-        for (int i = 0; i < 4; ++i)
+    auto buffers = std::make_shared<SceneBuffers>();
+    buffers->quads = CreateQuadBuffer({quads, quads + header->quadCount});
+
+    for (uint32_t i = 0; i < header->meshBatchCount; ++i)
+    {
+        const SceneCacheMeshBatch* batch = TakeSection<SceneCacheMeshBatch>(data, remaining, 1);
+        if (!batch)
         {
-            positions[i] = transform(positions[i], objectToSceneTransform);
+            return nullptr;
         }
-        // Create uv coordinates.
-        float2 uvs[4] = {{0, 1}, {1, 1}, {0, 0}, {1, 0}};
 
-        // Create the vertices with uv coordinates for the quad labels.
-        AppendQuad(positions, uvs, LabelQuadHeight, LabelQuadWidth, color, m_quadLabelsVertices[object.Kind()]);
+        const MeshVertex* vertices = TakeSection<MeshVertex>(data, remaining, batch->vertexCount);
+        const uint32_t* indices = TakeSection<uint32_t>(data, remaining, batch->indexCount);
+        if (!vertices || !indices || batch->vertexCount == 0 || batch->indexCount == 0)
+        {
+            return nullptr;
+        }
+
+        buffers->meshBatches.push_back(CreateMeshBatchBuffers(
+            {vertices, vertices + batch->vertexCount}, {indices, indices + batch->indexCount}, batch->constants));
     }
+
+    buffers->originSpatialGraphNodeId = header->originSpatialGraphNodeId;
+    buffers->bounds = header->bounds;
+    return buffers;
 }
 
-void SceneUnderstandingRenderer::AddSceneMeshVertices(const SceneObject& object, const float3& color)
+SceneUnderstandingRenderer::SceneObjectSignature SceneUnderstandingRenderer::GetSignature(const SceneObject& object)
 {
-    float4x4 objectToSceneTransform = object.GetLocationAsMatrix();
+    SceneObjectSignature signature;
+    signature.kind = object.Kind();
+    signature.location = object.GetLocationAsMatrix();
+
+    signature.quadHash = HashSeed;
+    for (const SceneQuad& quad : object.Quads())
+    {
+        const float2 extents = quad.Extents();
+        const SceneQuadAlignment alignment = quad.Alignment();
+        signature.quadHash = HashBytes(signature.quadHash, &extents, sizeof(extents));
+        signature.quadHash = HashBytes(signature.quadHash, &alignment, sizeof(alignment));
+        signature.quadCount++;
+    }
+
+    // The scratch buffers are kept per thread, like the one of AddSceneMeshVertices.
+    thread_local std::vector<float3> positions;
+    thread_local std::vector<uint32_t> indices;
     for (const SceneMesh& mesh : object.Meshes())
     {
-        auto indicesCount = mesh.TriangleIndexCount();
-        std::vector<uint32_t> indices(indicesCount);
+        SceneObjectSignature::MeshSignature& meshSignature =
+            signature.meshes.emplace_back(SceneObjectSignature::MeshSignature{mesh.Id(), mesh.VertexCount(), mesh.TriangleIndexCount()});
+
+        positions.resize(meshSignature.vertexCount);
+        indices.resize(meshSignature.triangleIndexCount);
+        mesh.GetVertexPositions(positions);
         mesh.GetTriangleIndices(indices);
+        meshSignature.dataHash = HashBytes(HashSeed, positions.data(), positions.size() * sizeof(float3));
+        meshSignature.dataHash = HashBytes(meshSignature.dataHash, indices.data(), indices.size() * sizeof(uint32_t));
+    }
+    return signature;
+}
+
+void SceneUnderstandingRenderer::AddSceneObject(const SceneObject& object, std::vector<RenderedSceneObject>& objects)
+{
+    const SceneObjectKind kind = object.Kind();
+    if (m_sceneQuadsLabels.find(kind) == m_sceneQuadsLabels.end() && m_sceneMeshLabels.find(kind) == m_sceneMeshLabels.end())
+    {
+        return;
+    }
+
+    auto [entry, inserted] = m_objectCache.try_emplace(object.Id());
+    CachedSceneObject& cached = entry->second;
+    cached.generation = m_objectCacheGeneration;
+
+    SceneObjectSignature signature = GetSignature(object);
+    const bool generate = inserted || !(signature == cached.signature);
+    if (generate)
+    {
+        cached.signature = std::move(signature);
+    }
+
+    objects.push_back({object, static_cast<size_t>(entry - m_objectCache.begin()), generate});
+}
+
+void SceneUnderstandingRenderer::GenerateSceneObjectGeometry(const SceneObject& object, CachedSceneObject& cached) const
+{
+    cached.quads.clear();
+    cached.mesh = {};
+
+    // Check if the object is in the quads labels.
+    auto quadLabelPos = m_sceneQuadsLabels.find(cached.signature.kind);
+    if (quadLabelPos != m_sceneQuadsLabels.end())
+    {
+        const SceneObjectLabel& label = quadLabelPos->second;
+        auto [r, g, b] = label.color;
+        const uint32_t color = static_cast<uint32_t>(r | (g << 8) | (b << 16));
+
+        // Adds the quads to the quad buffer for rendering, using the color indicated by the label dictionary for the quad's owner
+        // entity's type. The labels are drawn from the same quads.
+        AddSceneQuads(object, color, cached.quads);
+    }
+
+    // Check if the object is in the mesh labels.
+    auto meshLabelPos = m_sceneMeshLabels.find(cached.signature.kind);
+    if (meshLabelPos != m_sceneMeshLabels.end())
+    {
+        const SceneObjectLabel& label = meshLabelPos->second;
+        auto [r, g, b] = label.color;
+        float3 color = {r / 255.0f, g / 255.0f, b / 255.0f};
+
+        // Adds the sceneMeshes to the vertex buffer for rendering, using the color indicated by the label dictionary for the quad's
+        // owner entity's type.
+        AddSceneMeshVertices(object, color, cached.mesh);
+    }
+}
 
-        // Get the mesh's vertices in object space.
-        std::vector<float3> vertices(mesh.VertexCount());
-        mesh.GetVertexPositions(vertices);
+void SceneUnderstandingRenderer::AppendSceneObjects(const std::vector<RenderedSceneObject>& objects, SceneVertices& vertices) const
+{
+    // Size the geometry of the scene up front, so appending the objects does not reallocate.
+    size_t quadCount = 0;
+    std::map<SceneObjectKind, std::pair<size_t, size_t>> meshBatchSizes;
+    for (const RenderedSceneObject& rendered : objects)
+    {
+        const CachedSceneObject& cached = (m_objectCache.begin() + rendered.cacheIndex)->second;
+        quadCount += cached.quads.size();
+        if (!cached.mesh.indices.empty())
+        {
+            auto& [positionCount, indexCount] = meshBatchSizes[cached.signature.kind];
+            positionCount += cached.mesh.positions.size();
+            indexCount += cached.mesh.indices.size();
+        }
+    }
 
-        // Transform the vertices to scene space and create the triangles.
-        for (uint32_t i = 0; i < indices.size(); i += 3)
+    vertices.quads.reserve(quadCount);
+    for (const auto& [kind, sizes] : meshBatchSizes)
+    {
+        SceneMeshBatch& batch = vertices.meshBatches[kind];
+        batch.positions.reserve(sizes.first);
+        batch.indices.reserve(sizes.second);
+    }
+
+    // Append the geometry of the objects in the order of the scene.
+    for (const RenderedSceneObject& rendered : objects)
+    {
+        const CachedSceneObject& cached = (m_objectCache.begin() + rendered.cacheIndex)->second;
+        vertices.quads.insert(vertices.quads.end(), cached.quads.begin(), cached.quads.end());
+        if (!cached.mesh.indices.empty())
         {
-            VertexPositionUVColor vertex;
-            vertex.color = DXHelper::Float3ToXMFloat3(color);
-            vertex.uv = {0, 0};
+            SceneMeshBatch& batch = vertices.meshBatches[cached.signature.kind];
+            batch.color = cached.mesh.color;
+
+            const uint32_t firstVertex = static_cast<uint32_t>(batch.positions.size());
+            batch.positions.insert(batch.positions.end(), cached.mesh.positions.begin(), cached.mesh.positions.end());
+            std::transform(
+                cached.mesh.indices.begin(), cached.mesh.indices.end(), std::back_inserter(batch.indices), [firstVertex](uint32_t index) {
+                    return firstVertex + index;
+                });
+        }
+    }
+}
+
+void SceneUnderstandingRenderer::AddSceneQuads(const SceneObject& object, uint32_t color, SceneVector<QuadInstance>& quads)
+{
+    // The quads of an object share its transform and only differ in their extents. The vertex shader creates the corner points
+    // of a quad from the extents and transforms them to scene space.
+    const float4x4 objectToScene = transpose(object.GetLocationAsMatrix());
+
+    QuadInstance instance;
+    instance.objectToScene[0] = {objectToScene.m11, objectToScene.m12, objectToScene.m13, objectToScene.m14};
+    instance.objectToScene[1] = {objectToScene.m21, objectToScene.m22, objectToScene.m23, objectToScene.m24};
+    instance.objectToScene[2] = {objectToScene.m31, objectToScene.m32, objectToScene.m33, objectToScene.m34};
+    instance.color = color;
+    instance.labelCell = static_cast<uint32_t>(GetLabelAtlasCell(object.Kind()));
+
+    for (const SceneQuad& quad : object.Quads())
+    {
+        instance.extents = DXHelper::Float2ToXMFloat2(quad.Extents());
+        quads.push_back(instance);
+    }
+}
+
+void SceneUnderstandingRenderer::AddSceneMeshVertices(const SceneObject& object, const float3& color, SceneMeshBatch& batch)
+{
+    batch.color = color;
+
+    struct MeshSize
+    {
+        SceneMesh mesh;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+    };
+
+    // Size the batch for all meshes of the object at once.
+    std::vector<MeshSize> meshes;
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    for (const SceneMesh& mesh : object.Meshes())
+    {
+        meshes.push_back({mesh, mesh.VertexCount(), mesh.TriangleIndexCount()});
+        vertexCount += meshes.back().vertexCount;
+        indexCount += meshes.back().indexCount;
+    }
+    batch.positions.resize(vertexCount);
+    batch.indices.resize(indexCount);
 
-            vertex.pos = DXHelper::Float3ToXMFloat3(transform(vertices[indices[i]], objectToSceneTransform));
-            m_meshVertices.push_back(vertex);
+    // The positions are read into a scratch buffer and transformed from there into the batch. The buffer is kept per thread,
+    // so it is reused by all meshes generated on the thread.
+    thread_local std::vector<float3> objectPositions;
 
-            vertex.pos = DXHelper::Float3ToXMFloat3(transform(vertices[indices[i + 1]], objectToSceneTransform));
-            m_meshVertices.push_back(vertex);
+    const float4x4 objectToSceneTransform = object.GetLocationAsMatrix();
+    const XMMATRIX objectToScene = XMLoadFloat4x4(reinterpret_cast<const XMFLOAT4X4*>(&objectToSceneTransform));
 
-            vertex.pos = DXHelper::Float3ToXMFloat3(transform(vertices[indices[i + 2]], objectToSceneTransform));
-            m_meshVertices.push_back(vertex);
+    size_t firstVertex = 0;
+    size_t firstIndex = 0;
+    for (const MeshSize& mesh : meshes)
+    {
+        // Read the mesh's indices straight into the batch.
+        uint32_t* indices = batch.indices.data() + firstIndex;
+        mesh.mesh.GetTriangleIndices({indices, indices + mesh.indexCount});
+
+        // Transform the vertices to scene space.
+        objectPositions.resize(mesh.vertexCount);
+        mesh.mesh.GetVertexPositions(objectPositions);
+        XMVector3TransformCoordStream(
+            reinterpret_cast<XMFLOAT3*>(batch.positions.data() + firstVertex),
+            sizeof(float3),
+            reinterpret_cast<const XMFLOAT3*>(objectPositions.data()),
+            sizeof(float3),
+            mesh.vertexCount,
+            objectToScene);
+
+        // The indices are relative to the mesh, make them relative to the batch.
+        for (uint32_t i = 0; i < mesh.indexCount; ++i)
+        {
+            indices[i] += static_cast<uint32_t>(firstVertex);
         }
+
+        firstVertex += mesh.vertexCount;
+        firstIndex += mesh.indexCount;
     }
 }
 
 void SceneUnderstandingRenderer::ToggleRenderingType()
 {
-    m_renderingType = static_cast<RenderingType>((m_renderingType + 1) % RenderingType::Max);
+    m_renderingType = static_cast<RenderingType>((m_renderingType.load() + 1) % RenderingType::Max);
+}
+
+bool SceneUnderstandingRenderer::IsRenderingEnabled() const
+{
+    return m_renderingType != RenderingType::None;
+}
+
+float SceneUnderstandingRenderer::GetLastVertexBuildMilliseconds() const
+{
+    return m_lastVertexBuildMilliseconds;
 }
 
 void SceneUnderstandingRenderer::Render(bool isStereo)
@@ -523,74 +1062,68 @@ void SceneUnderstandingRenderer::Render(bool isStereo)
         return;
     }
 
-    // Only render if the scene is not being updated and there is a valid scene to rendering transformation.
-    if (!m_verticesUpdating && m_validSceneToRenderingTransform)
+    // Only render if there are buffers with a valid scene to rendering transformation. A scene update which is still in progress
+    // does not affect the buffers used here.
+    if (m_renderBuffers && m_validSceneToRenderingTransform)
     {
-        // For RenderingType::Mesh only render the scene mesh. In case of RenderingType::Quads only render the scene quads with labels. For
-        // RenderingType::All render the scene mesh and the scene quads with labels.
-        if (m_renderingType == RenderingType::Quads || m_renderingType == RenderingType::All)
-        {
-            RenderSceneQuads(isStereo);
-            RenderSceneQuadsLabel(isStereo);
-        }
-        if (m_renderingType == RenderingType::Mesh || m_renderingType == RenderingType::All)
-        {
-            RenderSceneMesh(isStereo);
-        }
-
-        // Disable the geometry shader.
-        m_deviceResources->UseD3DDeviceContext([&](auto context) { context->GSSetShader(nullptr, nullptr, 0); });
+        const RenderingType renderingType = m_renderingType;
+        RenderPath::Dispatch(isStereo, m_usingVprtShaders, [this, renderingType](auto variant) {
+            // For RenderingType::Mesh only render the scene mesh. In case of RenderingType::Quads only render the scene quads with
+            // labels. For RenderingType::All render the scene mesh and the scene quads with labels.
+            if (renderingType == RenderingType::Quads || renderingType == RenderingType::All)
+            {
+                RenderSceneQuads(*m_renderBuffers, variant);
+                RenderSceneQuadsLabel(*m_renderBuffers, variant);
+            }
+            if (renderingType == RenderingType::Mesh || renderingType == RenderingType::All)
+            {
+                RenderSceneMesh(*m_renderBuffers, variant);
+            }
+        });
     }
 }
 
-void SceneUnderstandingRenderer::RenderSceneQuads(bool isStereo)
+template <typename Variant>
+void SceneUnderstandingRenderer::RenderSceneQuads(const SceneBuffers& buffers, Variant)
 {
-    // Only render if vertices are available.
-    if (m_quadVertices.empty())
+    // Only render if quads are available.
+    if (buffers.quads.quadCount == 0)
     {
         return;
     }
 
     // Use the D3D device context to update Direct3D device-based resources.
     m_deviceResources->UseD3DDeviceContext([&](auto context) {
-        context->IASetInputLayout(m_inputLayout.get());
+        SetQuadVertexShader(context, buffers, m_quadPassConstantBuffer.get());
 
-        // Attach the vertex shader.
-        context->VSSetShader(m_vertexShader.get(), nullptr, 0);
-        // Apply the model constant buffer to the vertex shader.
-        ID3D11Buffer* modelBuffer = m_modelConstantBuffer.get();
-        context->VSSetConstantBuffers(0, 1, &modelBuffer);
-
-        context->GSSetShader(m_geometryShader.get(), nullptr, 0);
+        context->GSSetShader(Variant::GeometryShader(m_geometryShader.get()), nullptr, 0);
 
         context->PSSetShader(m_quadsPixelShader.get(), nullptr, 0);
 
         context->RSSetState(m_rasterizerState.get());
 
+        // Each quad is expanded to two triangles.
         context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-
-        const UINT stride = sizeof(VertexPositionUVColor);
-        const UINT offset = 0;
-        ID3D11Buffer* pBuffer = m_quadVerticesBuffer.get();
-        context->IASetVertexBuffers(0, 1, &pBuffer, &stride, &offset);
-
-        context->DrawInstanced(static_cast<UINT>(m_quadVertices.size()), isStereo ? 2 : 1, offset, 0);
+        context->DrawInstanced(buffers.quads.quadCount * 6, Variant::InstanceCount, 0, 0);
     });
 }
 
-void SceneUnderstandingRenderer::RenderSceneQuadsLabel(bool isStereo)
+template <typename Variant>
+void SceneUnderstandingRenderer::RenderSceneQuadsLabel(const SceneBuffers& buffers, Variant)
 {
+    // Only render if quads are available.
+    if (buffers.quads.quadCount == 0)
+    {
+        return;
+    }
+
     // Use the D3D device context to update Direct3D device-based resources.
     m_deviceResources->UseD3DDeviceContext([&](auto context) {
         context->OMSetBlendState(m_blendState.get(), nullptr, 0xffffffff);
-        context->IASetInputLayout(m_inputLayout.get());
 
-        // Attach the vertex shader.
-        context->VSSetShader(m_vertexShader.get(), nullptr, 0);
-        ID3D11Buffer* modelBuffer = m_modelConstantBuffer.get();
-        context->VSSetConstantBuffers(0, 1, &modelBuffer);
+        SetQuadVertexShader(context, buffers, m_labelPassConstantBuffer.get());
 
-        context->GSSetShader(m_geometryShader.get(), nullptr, 0);
+        context->GSSetShader(Variant::GeometryShader(m_geometryShader.get()), nullptr, 0);
 
         context->PSSetShader(m_labelPixelShader.get(), nullptr, 0);
 
@@ -599,37 +1132,39 @@ void SceneUnderstandingRenderer::RenderSceneQuadsLabel(bool isStereo)
 
         context->RSSetState(m_rasterizerState.get());
 
-        // Render all quad labels with the same SceneObjectKind with a single draw call.
-        for (auto const& [kind, vertices] : m_quadLabelsVertices)
-        {
-            // Only render if vertices are available.
-            if (vertices.empty())
-            {
-                continue;
-            }
+        // Render all quad labels with a single draw call. The label atlas contains the names of all labels.
+        ID3D11ShaderResourceView* pShaderViewToSet = m_textShaderResourceView.get();
+        context->PSSetShaderResources(0, 1, &pShaderViewToSet);
 
-            context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        context->DrawInstanced(buffers.quads.quadCount * 6, Variant::InstanceCount, 0, 0);
 
-            const UINT stride = sizeof(VertexPositionUVColor);
-            const UINT offset = 0;
-            ID3D11Buffer* pBuffer = m_quadLabelsVerticesBuffer[kind].get();
-            context->IASetVertexBuffers(0, 1, &pBuffer, &stride, &offset);
+        context->OMSetBlendState(nullptr, nullptr, 0xffffffff);
+    });
+}
 
-            // Set the text label texture which contains the label name.
-            ID3D11ShaderResourceView* pShaderViewToSet = m_textShaderResourceViews[kind].get();
-            context->PSSetShaderResources(0, 1, &pShaderViewToSet);
+void SceneUnderstandingRenderer::SetQuadVertexShader(
+    ID3D11DeviceContext* context, const SceneBuffers& buffers, ID3D11Buffer* passConstantBuffer)
+{
+    // The vertex shader reads the quads from the quad buffer, there are no vertex buffers.
+    context->IASetInputLayout(nullptr);
 
-            context->DrawInstanced(static_cast<UINT>(vertices.size()), isStereo ? 2 : 1, offset, 0);
-        }
+    context->VSSetShader(m_vertexShader.get(), nullptr, 0);
 
-        context->OMSetBlendState(nullptr, nullptr, 0xffffffff);
-    });
+    // Apply the model constant buffer and the constant buffer of the pass to the vertex shader.
+    ID3D11Buffer* modelBuffer = m_modelConstantBuffer.get();
+    context->VSSetConstantBuffers(0, 1, &modelBuffer);
+    context->VSSetConstantBuffers(2, 1, &passConstantBuffer);
+
+    ID3D11ShaderResourceView* quadView = buffers.quads.view.get();
+    context->VSSetShaderResources(0, 1, &quadView);
 }
 
-void SceneUnderstandingRenderer::RenderSceneMesh(bool isStereo)
+template <typename Variant>
+void SceneUnderstandingRenderer::RenderSceneMesh(const SceneBuffers& buffers, Variant)
 {
-    // Only render if vertices are available.
-    if (m_meshVertices.empty())
+    // Only render if meshes are available.
+    if (buffers.meshBatches.empty())
     {
         return;
     }
@@ -638,12 +1173,13 @@ void SceneUnderstandingRenderer::RenderSceneMesh(bool isStereo)
     m_deviceResources->UseD3DDeviceContext([&](auto context) {
         context->OMSetBlendState(m_blendState.get(), nullptr, 0xffffffff);
 
-        context->IASetInputLayout(m_inputLayout.get());
+        context->IASetInputLayout(m_meshInputLayout.get());
 
-        context->VSSetShader(m_vertexShader.get(), nullptr, 0);
+        context->VSSetShader(m_meshVertexShader.get(), nullptr, 0);
         ID3D11Buffer* modelBuffer = m_modelConstantBuffer.get();
         context->VSSetConstantBuffers(0, 1, &modelBuffer);
 
+        // The mesh vertex shader has no VPRT version, the geometry shader sets the render target array index with every variant.
         context->GSSetShader(m_geometryShader.get(), nullptr, 0);
 
         context->PSSetShader(m_meshPixelShader.get(), nullptr, 0);
@@ -652,52 +1188,38 @@ void SceneUnderstandingRenderer::RenderSceneMesh(bool isStereo)
 
         context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-        const UINT stride = sizeof(VertexPositionUVColor);
-        const UINT offset = 0;
-        ID3D11Buffer* pBuffer = m_meshVerticesBuffer.get();
-        context->IASetVertexBuffers(0, 1, &pBuffer, &stride, &offset);
+        // Render all meshes with the same SceneObjectKind with a single draw call.
+        for (const MeshBatchBuffers& batch : buffers.meshBatches)
+        {
+            const UINT stride = sizeof(MeshVertex);
+            const UINT offset = 0;
+            ID3D11Buffer* pBuffer = batch.vertexBuffer.get();
+            context->IASetVertexBuffers(0, 1, &pBuffer, &stride, &offset);
+            context->IASetIndexBuffer(batch.indexBuffer.get(), DXGI_FORMAT_R32_UINT, 0);
+
+            // The batch color and the position dequantization.
+            ID3D11Buffer* batchBuffer = batch.constantBuffer.get();
+            context->VSSetConstantBuffers(2, 1, &batchBuffer);
 
-        context->DrawInstanced(static_cast<UINT>(m_meshVertices.size()), isStereo ? 2 : 1, offset, 0);
+            context->DrawIndexedInstanced(batch.indexCount, Variant::InstanceCount, 0, 0, 0);
+        }
 
         context->OMSetBlendState(nullptr, nullptr, 0xffffffff);
     });
 }
 
-// Appends a quad to the given collection.
-void SceneUnderstandingRenderer::AppendQuad(
-    const float3 positions[4],
-    const float2 uvs[4],
-    const float height,
-    const float width,
-    const float3& color,
-    std::vector<VertexPositionUVColor>& vertices)
+void SceneUnderstandingRenderer::ReleaseSceneBuffers()
 {
-    VertexPositionUVColor vertex;
-    vertex.color = DXHelper::Float3ToXMFloat3(color);
-
-    vertex.pos = DXHelper::Float3ToXMFloat3(positions[0]);
-    vertex.uv = DXHelper::Float2ToXMFloat2(uvs[0]);
-    vertices.push_back(vertex);
-
-    vertex.pos = DXHelper::Float3ToXMFloat3(positions[2]);
-    vertex.uv = DXHelper::Float2ToXMFloat2(uvs[2]);
-    vertices.push_back(vertex);
-
-    vertex.pos = DXHelper::Float3ToXMFloat3(positions[3]);
-    vertex.uv = DXHelper::Float2ToXMFloat2(uvs[3]);
-    vertices.push_back(vertex);
+    m_renderBuffers = nullptr;
 
-    vertex.pos = DXHelper::Float3ToXMFloat3(positions[3]);
-    vertex.uv = DXHelper::Float2ToXMFloat2(uvs[3]);
-    vertices.push_back(vertex);
-
-    vertex.pos = DXHelper::Float3ToXMFloat3(positions[1]);
-    vertex.uv = DXHelper::Float2ToXMFloat2(uvs[1]);
-    vertices.push_back(vertex);
+    std::lock_guard lock(m_mutex);
+    if (auto buffers = std::atomic_exchange(&m_sceneBuffers, std::shared_ptr<const SceneBuffers>()))
+    {
+        m_deviceResources->GetVideoMemoryBudget().NotifyReleased(buffers->GetSizeInBytes());
 
-    vertex.pos = DXHelper::Float3ToXMFloat3(positions[0]);
-    vertex.uv = DXHelper::Float2ToXMFloat2(uvs[0]);
-    vertices.push_back(vertex);
+        // The geometry of the objects is still cached, so rebuilding the buffers from the scene is cheap.
+        m_verticesOutdated = m_scene != nullptr;
+    }
 }
 
 void SceneUnderstandingRenderer::Reset()
@@ -707,5 +1229,7 @@ void SceneUnderstandingRenderer::Reset()
     m_scene = nullptr;
     m_sceneLastUpdateLocation = nullptr;
     m_verticesOutdated = false;
-    m_verticesUpdating = false;
+    m_objectCacheOutdated = true;
+
+    std::atomic_store(&m_sceneBuffers, std::shared_ptr<const SceneBuffers>());
 }
@@ -0,0 +1,116 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <pch.h>
+
+#include <content/SceneUpdateScheduler.h>
+
+#include <ThreadConfiguration.h>
+
+#include <vector>
+
+using namespace winrt::Microsoft::MixedReality::SceneUnderstanding;
+
+namespace
+{
+    float MillisecondsBetween(std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end)
+    {
+        return std::chrono::duration<float, std::milli>(end - begin).count();
+    }
+} // namespace
+
+SceneUpdateScheduler::SceneUpdateScheduler(SceneHandler handler)
+    : m_handler(std::move(handler))
+{
+}
+
+void SceneUpdateScheduler::Configure(const SceneQuerySettings& querySettings, float queryRadius, std::chrono::milliseconds interval)
+{
+    m_querySettings = querySettings;
+    m_queryRadius = queryRadius;
+    m_interval = interval;
+}
+
+void SceneUpdateScheduler::RequestUpdate()
+{
+    if (m_updateRequested.exchange(true))
+    {
+        std::lock_guard lock(m_metricsMutex);
+        m_metrics.coalescedRequests++;
+    }
+}
+
+void SceneUpdateScheduler::Tick(bool paused)
+{
+    // Requests made meanwhile stay pending until the computation in flight completed, or until the scheduler is resumed.
+    if (m_computationInFlight || paused)
+    {
+        return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    const bool periodicUpdateDue = m_interval.count() > 0 && now - m_lastStartTime >= m_interval;
+    if (!m_updateRequested.exchange(false) && !periodicUpdateDue)
+    {
+        return;
+    }
+
+    m_computationInFlight = true;
+    m_lastStartTime = now;
+    ComputeAsync();
+}
+
+SceneUpdateScheduler::Metrics SceneUpdateScheduler::GetMetrics() const
+{
+    std::lock_guard lock(m_metricsMutex);
+    return m_metrics;
+}
+
+winrt::fire_and_forget SceneUpdateScheduler::ComputeAsync()
+{
+    auto keepAlive = shared_from_this();
+
+    // The settings are only changed on the thread calling Tick, which does not start another computation until this one is done.
+    const SceneQuerySettings querySettings = m_querySettings;
+    const float queryRadius = m_queryRadius;
+
+    try
+    {
+        const auto computeStart = std::chrono::steady_clock::now();
+        SceneBuffer serializedScene = co_await SceneObserver::ComputeSerializedAsync(querySettings, queryRadius);
+
+        // Deserializing a large scene takes a while, so it does not run on the thread the computation completed on.
+        co_await ThreadConfiguration::ResumeOnWorker{};
+        const auto deserializeStart = std::chrono::steady_clock::now();
+
+        std::vector<uint8_t> sceneData(serializedScene.Size());
+        serializedScene.GetData(sceneData);
+        Scene scene = Scene::Deserialize(sceneData);
+
+        const auto handlerStart = std::chrono::steady_clock::now();
+        m_handler(scene);
+        const auto handlerEnd = std::chrono::steady_clock::now();
+
+        std::lock_guard lock(m_metricsMutex);
+        m_metrics.computeMilliseconds = MillisecondsBetween(computeStart, deserializeStart);
+        m_metrics.deserializeMilliseconds = MillisecondsBetween(deserializeStart, handlerStart);
+        m_metrics.handlerMilliseconds = MillisecondsBetween(handlerStart, handlerEnd);
+        m_metrics.sceneSizeBytes = static_cast<uint32_t>(sceneData.size());
+        m_metrics.completedUpdates++;
+    }
+    catch (...)
+    {
+        std::lock_guard lock(m_metricsMutex);
+        m_metrics.failedUpdates++;
+    }
+
+    m_computationInFlight = false;
+}
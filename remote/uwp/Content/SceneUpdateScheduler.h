@@ -0,0 +1,78 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+#include <winrt/Microsoft.MixedReality.SceneUnderstanding.h>
+
+// Schedules the scene understanding computations. Runs at most one computation at a time: requests made while one is in flight
+// are coalesced into a single follow-up computation, and periodic updates start no earlier than the configured interval after
+// the previous one started. The scene is computed in serialized form, then deserialized and handed to the scene handler on a
+// thread pool worker, so neither stage blocks the render thread.
+class SceneUpdateScheduler : public std::enable_shared_from_this<SceneUpdateScheduler>
+{
+public:
+    // Called on a thread pool worker with each computed scene. Calls do not overlap.
+    using SceneHandler = std::function<void(const winrt::Microsoft::MixedReality::SceneUnderstanding::Scene& scene)>;
+
+    // Durations of the stages of the last completed update, in milliseconds, and counters since the scheduler was created.
+    struct Metrics
+    {
+        float computeMilliseconds = 0.0f;
+        float deserializeMilliseconds = 0.0f;
+        float handlerMilliseconds = 0.0f;
+        uint32_t sceneSizeBytes = 0;
+
+        uint32_t completedUpdates = 0;
+        uint32_t failedUpdates = 0;
+        // Requests which were merged into a request that was still pending.
+        uint32_t coalescedRequests = 0;
+    };
+
+    SceneUpdateScheduler(SceneHandler handler);
+
+    // Sets the query of the computations and the interval of the periodic updates. An interval of zero disables periodic updates.
+    void Configure(
+        const winrt::Microsoft::MixedReality::SceneUnderstanding::SceneQuerySettings& querySettings,
+        float queryRadius,
+        std::chrono::milliseconds interval);
+
+    // Requests a computation as soon as possible. Thread-safe.
+    void RequestUpdate();
+
+    // Starts a computation if one was requested, or if periodic updates are due. Called once per frame. While paused, e.g. while
+    // no scene is rendered, requests stay pending and no computation starts.
+    void Tick(bool paused);
+
+    Metrics GetMetrics() const;
+
+private:
+    winrt::fire_and_forget ComputeAsync();
+
+    const SceneHandler m_handler;
+
+    winrt::Microsoft::MixedReality::SceneUnderstanding::SceneQuerySettings m_querySettings{};
+    float m_queryRadius = 10.0f;
+    std::chrono::milliseconds m_interval{0};
+
+    std::atomic<bool> m_updateRequested = false;
+    std::atomic<bool> m_computationInFlight = false;
+    std::chrono::steady_clock::time_point m_lastStartTime;
+
+    mutable std::mutex m_metricsMutex;
+    Metrics m_metrics;
+};
@@ -0,0 +1,81 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// A constant buffer that stores the model transform.
+cbuffer ModelConstantBuffer : register(b0)
+{
+    float4x4 model;
+};
+
+// A constant buffer that stores each set of view and projection matrices in column-major format.
+cbuffer ViewProjectionConstantBuffer : register(b1)
+{
+    float4x4 viewProjection[2];
+};
+
+// A constant buffer that stores the number of views each QR code instance is drawn to.
+cbuffer QRCodeConstantBuffer : register(b2)
+{
+    uint viewCount;
+};
+
+// Per-vertex data of the unit quad and per-instance data of the QR code.
+// The unit quad spans [0, 1] in x and y and is scaled by the physical side length of the code.
+struct VertexShaderInput
+{
+    float3      pos         : POSITION;
+    min16float3 color       : COLOR0;
+    float4      codeRow0    : CODETRANSFORM0;
+    float4      codeRow1    : CODETRANSFORM1;
+    float4      codeRow2    : CODETRANSFORM2;
+    float4      codeRow3    : CODETRANSFORM3;
+    float       codeSize    : CODESIZE;
+    uint        instId      : SV_InstanceID;
+};
+
+// Per-vertex data passed to the geometry shader.
+// Note that the render target array index is set here in the vertex shader.
+struct VertexShaderOutput
+{
+    float4      pos     : SV_POSITION;
+    min16float3 color   : COLOR0;
+    uint        idx     : TEXCOORD0;
+    uint        rtvId   : SV_RenderTargetArrayIndex; // SV_InstanceID % 2
+};
+
+// Expands the unit quad to the size of the QR code instance and transforms it into clip space.
+VertexShaderOutput main(VertexShaderInput input)
+{
+    VertexShaderOutput output;
+
+    float4x4 codeToRendering = float4x4(input.codeRow0, input.codeRow1, input.codeRow2, input.codeRow3);
+    float4 pos = mul(float4(input.pos * input.codeSize, 1.0f), codeToRendering);
+
+    // Each QR code instance is drawn once per view, see QRCodeRenderer::Draw.
+    int idx = input.instId % viewCount;
+
+    // Transform the vertex position into world space.
+    pos = mul(pos, model);
+
+    // Correct for perspective and project the vertex position onto the screen.
+    pos = mul(pos, viewProjection[idx]);
+
+    output.pos = pos;
+
+    // Pass the color through without modification.
+    output.color = input.color;
+
+    // Set the render target array index.
+    output.rtvId = idx;
+    output.idx   = idx;
+
+    return output;
+}
@@ -0,0 +1,80 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// A constant buffer that stores the model transform.
+cbuffer SUMeshConstantBuffer : register(b0)
+{
+    float4x4 model;
+};
+
+// A constant buffer that stores each set of view and projection matrices in column-major format.
+cbuffer ViewProjectionConstantBuffer : register(b1)
+{
+    float4x4 viewProjection[2];
+};
+
+// A constant buffer that stores the data shared by all vertices of a mesh batch.
+cbuffer SUMeshBatchConstantBuffer : register(b2)
+{
+    // Scene space position = positionOffset + quantized position * positionScale.
+    float4 positionOffset;
+    float4 positionScale;
+    float4 color;
+};
+
+// Per-vertex data used as input to the vertex shader.
+struct VertexShaderInput
+{
+    float4      pos     : POSITION; // quantized to [-1, 1]
+    uint        instId  : SV_InstanceID;
+};
+
+// Per-vertex data passed to the geometry shader.
+// Note that the render target array index will be set by the geometry shader
+// using the value of viewId.
+struct VertexShaderOutput
+{
+    float4      pos     : SV_POSITION;
+    min16float3 color   : COLOR0;
+    float2      uv      : TEXCOORD0;
+    uint        viewId  : TEXCOORD1; // SV_InstanceID % 2
+};
+
+// Vertex shader for the indexed scene meshes.
+VertexShaderOutput main(VertexShaderInput input)
+{
+    VertexShaderOutput output;
+    float4 pos = float4(positionOffset.xyz + input.pos.xyz * positionScale.xyz, 1.0f);
+
+    // Note which view this vertex has been sent to. Used for matrix lookup.
+    // Taking the modulo of the instance ID allows geometry instancing to be used
+    // along with stereo instanced drawing; in that case, two copies of each
+    // instance would be drawn, one for left and one for right.
+    int idx = input.instId % 2;
+
+    // Transform the vertex position into world space.
+    pos = mul(pos, model);
+
+    // Correct for perspective and project the vertex position onto the screen.
+    output.pos = mul(pos, viewProjection[idx]);
+
+    // The color is the same for the whole batch.
+    output.color = (min16float3)color.rgb;
+
+    // The meshes are not textured.
+    output.uv = float2(0.0f, 0.0f);
+
+    // Set the instance ID. The pass-through geometry shader will set the
+    // render target array index to whatever value is set here.
+    output.viewId = idx;
+
+    return output;
+}
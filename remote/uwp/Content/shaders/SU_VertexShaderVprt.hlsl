@@ -0,0 +1,119 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+// A constant buffer that stores the model transform.
+cbuffer SUMeshConstantBuffer : register(b0)
+{
+    float4x4 model;
+};
+
+// A constant buffer that stores each set of view and projection matrices in column-major format.
+cbuffer ViewProjectionConstantBuffer : register(b1)
+{
+    float4x4 viewProjection[2];
+};
+
+// A constant buffer that selects whether the quads or their labels are drawn.
+cbuffer SUQuadPassConstantBuffer : register(b2)
+{
+    // The size of a quad in object space is extents * extentsScale + size.
+    float2  extentsScale;
+    float2  size;
+    // Offset of the quad along the normal of the scene quad.
+    float   normalOffset;
+    // Non-zero if the uv coordinates address the label atlas.
+    uint    labels;
+    float   labelCellHeight;
+    float   labelCellInset;
+};
+
+// A scene quad, which is expanded to two triangles.
+struct SceneQuad
+{
+    float4  objectToScene[3]; // the first three rows of the transposed object to scene transform
+    float2  extents;
+    uint    color;            // R8G8B8, red in the lowest byte
+    uint    labelCell;
+};
+
+StructuredBuffer<SceneQuad> quads : register(t0);
+
+// The corners of the two triangles of a quad. Bit 0 is the x and bit 1 the y coordinate of a corner.
+static const uint QuadCorners[6] = {0, 2, 3, 3, 1, 0};
+
+// Per-vertex data used as input to the vertex shader. There is no vertex buffer, every six vertices form a quad.
+struct VertexShaderInput
+{
+    uint    vertexId    : SV_VertexID;
+    uint    instId      : SV_InstanceID;
+};
+
+// Per-vertex data passed to the pixel shader, laid out like the output of the geometry shader.
+// Note that the render target array index is set here in the vertex shader. The quad and label
+// pixel shaders do not use the barycentric coordinates, which are only computed by the geometry shader.
+struct VertexShaderOutput
+{
+    float4      pos                 : SV_POSITION;
+    min16float3 color               : COLOR0;
+    float2      uv                  : TEXCOORD0;
+    uint        idx                 : TEXCOORD1;
+    float2      barycentricCoords   : TEXCOORD2;
+    uint        rtvId               : SV_RenderTargetArrayIndex; // SV_InstanceID % 2
+};
+
+// Expands the quads on the GPU.
+VertexShaderOutput main(VertexShaderInput input)
+{
+    VertexShaderOutput output;
+    SceneQuad quad = quads[input.vertexId / 6];
+    uint cornerIndex = QuadCorners[input.vertexId % 6];
+    float2 corner = float2(cornerIndex & 1, cornerIndex >> 1);
+
+    // Create the corner point in object space and transform it to scene space.
+    float4 pos = float4((corner - 0.5f) * (quad.extents * extentsScale + size), normalOffset, 1.0f);
+    pos = float4(dot(pos, quad.objectToScene[0]), dot(pos, quad.objectToScene[1]), dot(pos, quad.objectToScene[2]), 1.0f);
+
+    // Note which view this vertex has been sent to. Used for matrix lookup.
+    // Taking the modulo of the instance ID allows geometry instancing to be used
+    // along with stereo instanced drawing; in that case, two copies of each
+    // instance would be drawn, one for left and one for right.
+    int idx = input.instId % 2;
+
+    // Transform the vertex position into world space.
+    pos = mul(pos, model);
+
+    // Correct for perspective and project the vertex position onto the screen.
+    output.pos = mul(pos, viewProjection[idx]);
+
+    // Unpack the color.
+    output.color = min16float3(float3(uint3(quad.color, quad.color >> 8, quad.color >> 16) & 0xff) / 255.0f);
+
+    if (labels)
+    {
+        // The cell of the label in the atlas, inset by half a texel so that filtering does not pick up the neighboring labels.
+        float top = quad.labelCell * labelCellHeight + labelCellInset;
+        float bottom = (quad.labelCell + 1) * labelCellHeight - labelCellInset;
+        output.uv = float2(corner.x, lerp(bottom, top, corner.y));
+    }
+    else
+    {
+        // The uv coordinates are the extents of the quad, so that the checkerboard pattern becomes uniform.
+        output.uv = corner.yx * quad.extents.yx;
+    }
+
+    output.barycentricCoords = float2(0.0f, 0.0f);
+
+    // Set the render target array index.
+    output.rtvId = idx;
+    output.idx   = idx;
+
+    return output;
+}
@@ -13,17 +13,38 @@
 
 #include <holographic/IRemoteAppHolographic.h>
 
+#include <BitrateController.h>
+#include <DataChannelDispatcher.h>
+#include <DataChannelSender.h>
+#include <LatencyProbe.h>
+#include <ThreadConfiguration.h>
+
+#include <holographic/AnchorStore.h>
+#include <holographic/ContentDepthRange.h>
+#include <holographic/DeferredContextRecorder.h>
 #include <holographic/DeviceResources.h>
+#include <holographic/PerceptionRecording.h>
 #include <holographic/SpatialInputHandler.h>
 #include <holographic/SpatialInputRenderer.h>
 #include <holographic/Speech.h>
+#include <holographic/PreviewRenderer.h>
 #include <holographic/SpinningCubeRenderer.h>
+#include <holographic/StressTestRenderer.h>
 
 #include <content/QRCodeRenderer.h>
 #include <content/SceneUnderstandingRenderer.h>
+#include <content/SceneUpdateScheduler.h>
 #include <content/SpatialSurfaceMeshRenderer.h>
 
+#include <array>
+#include <condition_variable>
+#include <exception>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include <winrt/Microsoft.Holographic.AppRemoting.h>
 
@@ -52,8 +73,73 @@ public:
         uint16_t transportPort = 0;
         bool ephemeralPort = false;
         bool showPreview = true;
+        // Maximum number of frames per second shown in the preview window, 0 shows every frame sent to the player.
+        uint32_t previewFrameRate = 0;
         bool listen = false;
         bool autoReconnect = true;
+        // Keeps the renderers and the scene caches of the previous connection when reconnecting after a transient failure.
+        bool warmReconnect = true;
+        uint32_t maxBitrateKbps = 20000;
+
+        // Remote context settings, which can be preset for a network type with -profile lan|wifi|cellular.
+        bool enableAudio = true;
+        winrt::Microsoft::Holographic::AppRemoting::PreferredVideoCodec videoCodec =
+            winrt::Microsoft::Holographic::AppRemoting::PreferredVideoCodec::Any;
+
+        // Depth buffer downscale factor used while the connection is good: 1 = full, 2 = half, 4 = quarter resolution.
+        uint32_t depthDownscale = 2;
+
+        // Fits the near and far planes of the cameras tightly around the content, see ContentDepthRange.
+        bool tightDepthRange = true;
+
+        // Renders the spatial surface mesh depth-only before all other content, so real surfaces occlude the holograms behind them.
+        bool meshOccluder = false;
+
+        // Culls the spinning cube and the spatial surface mesh parts against the depth of the previous frame, see HiZOcclusionCuller.
+        bool occlusionCulling = false;
+
+        // Interval of the periodic scene understanding updates while the scene is rendered, 0 only updates it on request.
+        uint32_t sceneUpdateIntervalMs = 0;
+
+        // File the scene understanding buffers are cached in across sessions, empty disables the cache.
+        std::wstring sceneCacheFile;
+
+        // Directory the spatial surface meshes are cached in across sessions, empty disables the cache.
+        std::wstring meshCacheDirectory;
+
+        // Maximum number of triangles of a spatial surface mesh part, 0 renders the meshes as computed.
+        uint32_t meshTriangleBudget = 0;
+
+        // DXGI enumeration index of the adapter to render and encode on, -1 prefers one with a hardware H.265 encoder.
+        int32_t adapterIndex = -1;
+
+        // Interval of the latency probes sent over the custom data channel, 0 disables them. See LatencyProbe.
+        uint32_t latencyProbeIntervalMs = 1000;
+
+        // Renders this many small animated cubes in addition to the sample content, 0 disables the stress test. The count ramps
+        // up from StressTestRenderer::MinHologramCount, doubling every stressStepSeconds, and every step is logged.
+        uint32_t stressHologramCount = 0;
+        StressTestRenderer::Distribution stressDistribution = StressTestRenderer::Distribution::Random;
+        float stressChurnPerSecond = 0.0f;
+        uint32_t stressStepSeconds = 10;
+
+        // File the perception input is recorded to, empty disables recording. See PerceptionRecording.
+        std::wstring perceptionRecordFile;
+
+        // Recording which replaces the perception input, in a loop. Takes precedence over perceptionRecordFile. The recording is
+        // replayed at the timing it was recorded with, or with one recorded frame per rendered frame if perceptionReplayFast is set.
+        std::wstring perceptionReplayFile;
+        bool perceptionReplayFast = false;
+
+        // Secondary cameras, like the photo video camera of mixed reality capture, render their viewport scaled by
+        // secondaryCameraScale and only every secondaryCameraFrameInterval-th frame, the frames in between repeat the last
+        // rendered one. The spatial surface mesh is left out of them unless secondaryCameraSurfaceMesh is set.
+        float secondaryCameraScale = 1.0f;
+        uint32_t secondaryCameraFrameInterval = 1;
+        bool secondaryCameraSurfaceMesh = true;
+
+        // Priority of the frame thread and the worker threads which process the spatial surface meshes and scenes.
+        ThreadConfiguration::Settings threading;
     };
 
 public:
@@ -66,6 +152,10 @@ public:
 
     virtual void Tick() override;
 
+    virtual std::chrono::milliseconds GetIdleTimeout() override;
+
+    virtual HANDLE GetWakeEvent() override;
+
     virtual void OnKeyPress(char key) override;
 
     virtual void OnResize(int width, int height) override;
@@ -103,6 +193,11 @@ public:
     // Initializes the RemoteContext and starts connecting or listening to the currently set network address
     void InitializeRemoteContextAndConnectOrListen();
 
+#ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
+    // Queues a message for the custom data channel. Thread-safe, queued messages are sent in batches once per frame.
+    bool SendCustomDataChannelMessage(DataChannelSender::Lane lane, winrt::array_view<const uint8_t> message);
+#endif
+
 private:
     // Initializes the HolographicSpace and creates graphics device dependent resources
     void CreateHolographicSpaceAndDeviceResources();
@@ -116,6 +211,9 @@ private:
     // Saves the position of the spinning cube.
     void SavePosition();
 
+    // Tints the spinning cube, used by the color speech commands.
+    void SetCubeColorFilter(const DirectX::XMFLOAT4& color);
+
     // Exports a test anchor via SpatialAnchorExporter.
     winrt::fire_and_forget ExportPosition();
 
@@ -131,9 +229,12 @@ private:
     // Request updates for qr code watcher data.
     winrt::fire_and_forget RequestQRCodeWatcherUpdates();
 
-    // Compute scene update and toggle rendering mode.
+    // Request a scene update and toggle rendering mode.
     void ToggleSceneUnderstanding();
 
+    // Hands a scene computed by the scene update scheduler to the renderer. Called on a worker thread.
+    void OnSceneComputed(const winrt::Microsoft::MixedReality::SceneUnderstanding::Scene& scene);
+
     // Clears event registration state. Used when changing to a new HolographicSpace
     // and when tearing down SampleRemoteApp.
     void UnregisterHolographicEventHandlers();
@@ -145,11 +246,33 @@ private:
     void WindowCreateSwapChain(const winrt::com_ptr<ID3D11Device1>& device);
 
     // Presents the SwapChain of the host window
-    void WindowPresentSwapChain();
+    void WindowPresentSwapChain(UINT flags = 0);
+
+    // Creates the cached back buffer and render target view of the SwapChain if needed. Returns false if there is no SwapChain.
+    // Must be called with m_deviceLock held.
+    bool WindowAcquireBackBuffer();
+
+    // Releases the cached back buffer, which has to happen before the SwapChain buffers are resized or the SwapChain is released.
+    void WindowReleaseBackBuffer();
 
     // Updates the title of the host window
     void WindowUpdateTitle();
 
+    // Logs the GPU time of the last measured frame and of each content renderer.
+    void LogGpuTimes();
+
+    // Logs the CPU profiler zones of the last frame recorded on the calling thread.
+    void LogCpuZones();
+
+    // Logs the stage durations of the last scene understanding update.
+    void LogSceneUpdateTimes();
+
+    // Animates the stress test cubes, ramps up their count and logs the frame time, draw calls and bitrate of each step.
+    void UpdateStressTest(float totalSeconds);
+
+    // Starts recording or replaying the perception input, as configured by the options.
+    void OpenPerceptionRecording(const Options& options);
+
     // Asynchronously creates resources for new holographic cameras.
     void OnCameraAdded(
         const winrt::Windows::Graphics::Holographic::HolographicSpace& sender,
@@ -174,6 +297,9 @@ private:
     // Used to notify the app when a frame is about to be sent to the Player
     void OnSendFrame(const winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface& texture);
 
+    // Returns the texture of a surface passed to OnSendFrame. Must be called with m_deviceLock held.
+    ID3D11Texture2D* GetSentFrameTexture(const winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface& surface);
+
 #ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
     // Used to notify the app when the custom data channel received a data packet
     void OnCustomDataChannelDataReceived(winrt::array_view<const uint8_t> dataView);
@@ -183,6 +309,52 @@ private:
 #endif
 
 private:
+    // Content renderers, in the order their commands are executed.
+    enum class ContentRenderer
+    {
+        SpinningCube = 0,
+        SceneUnderstanding,
+        QRCode,
+        SpatialSurfaceMesh,
+        SpatialInput,
+        StressTest,
+        Count,
+    };
+    static constexpr size_t ContentRendererCount = static_cast<size_t>(ContentRenderer::Count);
+
+    // A holographic camera which content gets rendered to in the current frame.
+    struct CameraView
+    {
+        winrt::Windows::Graphics::Holographic::HolographicCameraPose cameraPose;
+        DXHelper::CameraResources* pCameraResources;
+        winrt::Windows::Foundation::IReference<winrt::Windows::Perception::Spatial::SpatialBoundingFrustum> cullingFrustum;
+        bool isSecondary;
+    };
+
+    // Sets the near and far planes of the cameras to enclose the content of the frame.
+    void UpdateDepthRange(
+        const winrt::Windows::Graphics::Holographic::HolographicFramePrediction& prediction,
+        const winrt::Windows::Perception::Spatial::SpatialCoordinateSystem& coordinateSystem);
+
+    // Updates the content which does not depend on the predicted head pose of a frame.
+    void UpdatePoseIndependentContent(winrt::Windows::Perception::Spatial::SpatialCoordinateSystem coordinateSystem);
+
+    // Hands the pose independent update of the next frame to the pose independent worker, which is started on first use.
+    void StartPoseIndependentUpdate(winrt::Windows::Perception::Spatial::SpatialCoordinateSystem coordinateSystem);
+
+    // Waits for the pose independent update started at the end of the previous frame, if frame pipelining is enabled.
+    void WaitForPoseIndependentUpdate();
+
+    // Runs the pose independent updates on the pose independent worker until it is stopped.
+    void RunPoseIndependentWorker();
+
+    // Renders all content renderers to the given cameras. Renderers which record on a deferred context are recorded in
+    // parallel on worker threads, the resulting command lists are executed in ContentRenderer order.
+    void RenderContent(const std::vector<CameraView>& cameraViews);
+
+    // Renders a single content renderer to the given cameras, using the context returned by UseD3DDeviceContext.
+    void RenderContent(ContentRenderer renderer, const std::vector<CameraView>& cameraViews);
+
     bool m_isInitialized = false;
 
     std::chrono::high_resolution_clock::time_point m_startTime = std::chrono::high_resolution_clock::now();
@@ -196,6 +368,9 @@ private:
     // Whether a disconnect is currently pending.
     bool m_disconnectPending{false};
 
+    // Whether the remote context was connected during the previous tick.
+    bool m_wasStreaming = false;
+
     // Represents the holographic space around the user.
     winrt::Windows::Graphics::Holographic::HolographicSpace m_holographicSpace = nullptr;
 
@@ -215,6 +390,26 @@ private:
     // is used to demonstrate world-locked rendering.
     std::unique_ptr<SpinningCubeRenderer> m_spinningCubeRenderer;
 
+    // Only created with stressHologramCount set.
+    std::unique_ptr<StressTestRenderer> m_stressTestRenderer;
+
+    // The measurements of the current stress test step.
+    struct StressTestStep
+    {
+        std::chrono::steady_clock::time_point start;
+        uint32_t frameCount = 0;
+        uint64_t drawCallCount = 0;
+        float gpuFrameTimeSum = 0.0f;
+    } m_stressTestStep;
+    float m_stressTestUpdateSeconds = 0.0f;
+
+    // Persists the position of the cube in the spatial anchor store of the player.
+    std::shared_ptr<AnchorStore> m_anchorStore = std::make_shared<AnchorStore>();
+
+    // Draws the frames sent to the player into the preview window. Guarded by m_deviceLock, as frames are sent from another thread.
+    std::unique_ptr<PreviewRenderer> m_previewRenderer;
+    std::chrono::steady_clock::time_point m_lastPreviewTime;
+
     // Renders the surface observed in the user's surroundings.
     std::unique_ptr<SpatialSurfaceMeshRenderer> m_spatialSurfaceMeshRenderer;
 
@@ -225,10 +420,44 @@ private:
     // Renders scene objects.
     std::atomic<bool> m_hasSceneObserverAccess = false;
     std::shared_ptr<SceneUnderstandingRenderer> m_sceneUnderstandingRenderer;
+    std::shared_ptr<SceneUpdateScheduler> m_sceneUpdateScheduler;
 
     // Renders qr codes.
     std::unique_ptr<QRCodeRenderer> m_qrCodeRenderer;
 
+    // At most one of the two is set, for the whole run of the app. The replayed frame is the one of the current frame, it is
+    // advanced by Update.
+    std::shared_ptr<PerceptionRecording::Recorder> m_perceptionRecorder;
+    std::unique_ptr<PerceptionRecording::Replay> m_perceptionReplay;
+    const PerceptionRecording::Frame* m_replayedFrame = nullptr;
+
+    // Whether a content renderer records its commands on its own deferred context on a worker thread, instead of
+    // on the immediate context.
+    std::array<bool, ContentRendererCount> m_recordOnDeferredContext = {};
+    std::array<std::unique_ptr<DXHelper::DeferredContextRecorder>, ContentRendererCount> m_deferredContextRecorders;
+
+    // If enabled, the pose independent update of the next frame runs on a worker thread while the current frame is
+    // presented and handed to the encoder. Poses are still acquired after WaitForNextFrameReady and latched again
+    // right before rendering, so this does not add latency.
+    bool m_pipelineFrames = false;
+
+    // The pose independent worker is kept for the lifetime of the app instead of starting a thread every frame. Its state is
+    // handed over between the render thread and the worker under m_poseIndependentMutex.
+    std::mutex m_poseIndependentMutex;
+    std::condition_variable m_poseIndependentChanged;
+    winrt::Windows::Perception::Spatial::SpatialCoordinateSystem m_poseIndependentCoordinateSystem = nullptr;
+    bool m_poseIndependentUpdatePending = false;
+    bool m_poseIndependentWorkerStopping = false;
+    std::exception_ptr m_poseIndependentException;
+    std::thread m_poseIndependentWorker;
+
+    // Set from StartPoseIndependentUpdate until WaitForPoseIndependentUpdate, only used on the render thread.
+    bool m_poseIndependentUpdateStarted = false;
+
+    // Completes once all renderers created their resources on the device restored last. Declared after the renderers, so it is
+    // waited for before they are destroyed.
+    std::future<void> m_deviceRestore;
+
     // Event registration tokens.
     winrt::event_token m_cameraAddedToken;
     winrt::event_token m_cameraRemovedToken;
@@ -250,25 +479,59 @@ private:
     int m_height = INITIAL_WINDOW_HEIGHT;
 
     std::chrono::high_resolution_clock::time_point m_windowTitleUpdateTime;
+
+    // The memory usage is logged again once it grew by the threshold since it was last logged.
+    static constexpr uint64_t MemoryLogThresholdBytes = 16 * 1024 * 1024;
+    uint64_t m_loggedMemoryBytes = 0;
     uint32_t m_framesPerSecond = 0;
 
+    // Counts the rendered frames, secondary cameras render the ones which are a multiple of secondaryCameraFrameInterval.
+    uint64_t m_frameCount = 0;
+
     std::recursive_mutex m_deviceLock;
     winrt::com_ptr<IDXGISwapChain1> m_swapChain;
+
+    // D3D11 always exposes the current back buffer of a flip model SwapChain as buffer 0, so a single view stays valid until the
+    // buffers are resized or the SwapChain is recreated.
+    winrt::com_ptr<ID3D11Texture2D> m_swapChainBackBuffer;
+    winrt::com_ptr<ID3D11RenderTargetView> m_swapChainRenderTargetView;
+
+    // Textures of the surfaces passed to OnSendFrame. The remote context sends frames from a small set of surfaces, which
+    // therefore only have to be unwrapped once.
+    static constexpr size_t MaxSentFrameTextures = 8;
+    std::vector<std::pair<winrt::Windows::Graphics::DirectX::Direct3D11::IDirect3DSurface, winrt::com_ptr<ID3D11Texture2D>>>
+        m_sentFrameTextures;
     winrt::com_ptr<ID3D11Texture2D> m_spTexture;
 
     bool m_canCommitDirect3D11DepthBuffer = false;
     bool m_commitDirect3D11DepthBuffer = true;
 
+    ContentDepthRange m_contentDepthRange;
+
     bool m_isStandalone = false;
 
-    uint32_t m_depthDownscale = 2;
+    // Chooses bitrate and depth buffer resolution of the stream from the statistics the player sends over the custom data
+    // channel, which requires ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE. Starts out with 20 Mbps and half resolution depth.
+    BitrateController m_bitrateController;
+
+    // Set when the bitrate controller chose new settings while the connection was lost. The new settings require a new
+    // RemoteContext, which is created on the next Tick.
+    std::atomic<bool> m_recreateRemoteContextPending = false;
+
+    // Measures round trip and one-way network latency with probes the player echoes over the custom data channel, which
+    // requires ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE. Shown in the window title.
+    LatencyProbe m_latencyProbe;
+
+    // Signaled when the connection state changes, so an idle window ticks right away.
+    winrt::handle m_wakeEvent{CreateEventW(nullptr, FALSE, FALSE, nullptr)};
 
 #ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
     std::recursive_mutex m_customDataChannelLock;
     winrt::Microsoft::Holographic::AppRemoting::IDataChannel2 m_customDataChannel = nullptr;
     winrt::Microsoft::Holographic::AppRemoting::IDataChannel2::OnDataReceived_revoker m_customChannelDataReceivedEventRevoker;
     winrt::Microsoft::Holographic::AppRemoting::IDataChannel2::OnClosed_revoker m_customChannelClosedEventRevoker;
-    std::chrono::high_resolution_clock::time_point m_customDataChannelSendTime = std::chrono::high_resolution_clock::now();
+    DataChannelSender m_customDataChannelSender;
+    DataChannelDispatcher m_customDataChannelDispatcher;
 #endif
 
     winrt::Microsoft::MixedReality::QR::QRCodeWatcher m_qrWatcher{nullptr};
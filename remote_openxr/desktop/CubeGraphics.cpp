@@ -77,20 +77,23 @@ namespace {
             1, 7, 5,
         };
 
-        struct ModelConstantBuffer {
+        // Per cube data, all cubes of a view are drawn with one instanced draw call reading this from a structured buffer.
+        struct CubeInstance {
             DirectX::XMFLOAT4X4 Model;
+            DirectX::XMFLOAT4 ColorFilter;
         };
 
         struct ViewProjectionConstantBuffer {
             DirectX::XMFLOAT4X4 ViewProjection[2];
-        };
-
-        struct ColorFilterConstantBuffer {
-            DirectX::XMFLOAT4 colorFilter;
+            uint32_t ViewCount;
+            uint32_t Padding[3];
         };
 
         constexpr uint32_t MaxViewInstance = 2;
 
+        // Smallest number of cubes the instance buffer is created for, it grows geometrically beyond that.
+        constexpr uint32_t MinCubeInstanceCapacity = 64;
+
         // Separate entrypoints for the vertex and pixel shader functions.
         constexpr char ShaderHlsl[] = R"_(
             struct VSOutput {
@@ -103,26 +106,30 @@ namespace {
                 float3 Color : COLOR0;
                 uint instId : SV_InstanceID;
             };
-            cbuffer ModelConstantBuffer : register(b0) {
+            struct CubeInstance {
                 float4x4 Model;
+                float4 ColorFilter;
             };
+            StructuredBuffer<CubeInstance> Cubes : register(t0);
             cbuffer ViewProjectionConstantBuffer : register(b1) {
                 float4x4 ViewProjection[2];
-            };
-            cbuffer ColorFilterConstantBuffer: register(b0) {
-                float4 colorFilter;
+                uint ViewCount;
             };
 
+            // Each cube is drawn as ViewCount consecutive instances, one for each view of the texture array.
             VSOutput MainVS(VSInput input) {
+                const uint viewIndex = input.instId % ViewCount;
+                const CubeInstance cube = Cubes[input.instId / ViewCount];
+
                 VSOutput output;
-                output.Pos = mul(mul(float4(input.Pos, 1), Model), ViewProjection[input.instId]);
-                output.Color = input.Color;
-                output.viewId = input.instId;
+                output.Pos = mul(mul(float4(input.Pos, 1), cube.Model), ViewProjection[viewIndex]);
+                output.Color = input.Color * cube.ColorFilter.rgb;
+                output.viewId = viewIndex;
                 return output;
             }
 
             float4 MainPS(VSOutput input) : SV_TARGET {
-                return float4(input.Color, 1) * colorFilter;
+                return float4(input.Color, 1);
             }
             )_";
 
@@ -159,17 +166,10 @@ namespace {
                                                     vertexShaderBytes->GetBufferSize(),
                                                     m_inputLayout.put()));
 
-            const CD3D11_BUFFER_DESC modelConstantBufferDesc(sizeof(CubeShader::ModelConstantBuffer), D3D11_BIND_CONSTANT_BUFFER);
-            CHECK_HRCMD(m_device->CreateBuffer(&modelConstantBufferDesc, nullptr, m_modelCBuffer.put()));
-
             const CD3D11_BUFFER_DESC viewProjectionConstantBufferDesc(sizeof(CubeShader::ViewProjectionConstantBuffer),
                                                                       D3D11_BIND_CONSTANT_BUFFER);
             CHECK_HRCMD(m_device->CreateBuffer(&viewProjectionConstantBufferDesc, nullptr, m_viewProjectionCBuffer.put()));
 
-            const CD3D11_BUFFER_DESC colorFilterConstantBufferDesc(sizeof(CubeShader::ColorFilterConstantBuffer),
-                                                                   D3D11_BIND_CONSTANT_BUFFER);
-            CHECK_HRCMD(m_device->CreateBuffer(&colorFilterConstantBufferDesc, nullptr, m_colorFilterCBuffer.put()));
-
             const D3D11_SUBRESOURCE_DATA vertexBufferData{CubeShader::c_cubeVertices};
             const CD3D11_BUFFER_DESC vertexBufferDesc(sizeof(CubeShader::c_cubeVertices), D3D11_BIND_VERTEX_BUFFER);
             CHECK_HRCMD(m_device->CreateBuffer(&vertexBufferDesc, &vertexBufferData, m_cubeVertexBuffer.put()));
@@ -188,6 +188,14 @@ namespace {
             depthStencilDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
             depthStencilDesc.DepthFunc = D3D11_COMPARISON_GREATER;
             CHECK_HRCMD(m_device->CreateDepthStencilState(&depthStencilDesc, m_reversedZDepthNoStencilTest.put()));
+
+            const CD3D11_QUERY_DESC disjointQueryDesc(D3D11_QUERY_TIMESTAMP_DISJOINT);
+            const CD3D11_QUERY_DESC timestampQueryDesc(D3D11_QUERY_TIMESTAMP);
+            for (GpuTimerQueries& queries : m_gpuTimerQueries) {
+                CHECK_HRCMD(m_device->CreateQuery(&disjointQueryDesc, queries.Disjoint.put()));
+                CHECK_HRCMD(m_device->CreateQuery(&timestampQueryDesc, queries.Begin.put()));
+                CHECK_HRCMD(m_device->CreateQuery(&timestampQueryDesc, queries.End.put()));
+            }
         }
 
         const std::vector<DXGI_FORMAT>& SupportedColorFormats() const override {
@@ -212,50 +220,55 @@ namespace {
 
         void RenderView(const XrRect2Di& imageRect,
                         const float renderTargetClearColor[4],
-                        const std::vector<xr::math::ViewProjection>& viewProjections,
+                        winrt::array_view<const xr::math::ViewProjection> viewProjections,
                         DXGI_FORMAT colorSwapchainFormat,
                         ID3D11Texture2D* colorTexture,
                         DXGI_FORMAT depthSwapchainFormat,
                         ID3D11Texture2D* depthTexture,
-                        const std::vector<const sample::Cube*>& cubes) override {
+                        const sample::CubeBatch& cubes) override {
             const uint32_t viewInstanceCount = (uint32_t)viewProjections.size();
             CHECK_MSG(viewInstanceCount <= CubeShader::MaxViewInstance,
                       "Sample shader supports 2 or fewer view instances. Adjust shader to accommodate more.")
 
+            BeginGpuTimer();
+
             CD3D11_VIEWPORT viewport(
                 (float)imageRect.offset.x, (float)imageRect.offset.y, (float)imageRect.extent.width, (float)imageRect.extent.height);
             m_deviceContext->RSSetViewports(1, &viewport);
 
-            // Create RenderTargetView with the original swapchain format (swapchain image is typeless).
-            winrt::com_ptr<ID3D11RenderTargetView> renderTargetView;
-            const CD3D11_RENDER_TARGET_VIEW_DESC renderTargetViewDesc(D3D11_RTV_DIMENSION_TEXTURE2DARRAY, colorSwapchainFormat);
-            CHECK_HRCMD(m_device->CreateRenderTargetView(colorTexture, &renderTargetViewDesc, renderTargetView.put()));
-
-            // Create a DepthStencilView with the original swapchain format (swapchain image is typeless)
-            winrt::com_ptr<ID3D11DepthStencilView> depthStencilView;
-            CD3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc(D3D11_DSV_DIMENSION_TEXTURE2DARRAY, depthSwapchainFormat);
-            CHECK_HRCMD(m_device->CreateDepthStencilView(depthTexture, &depthStencilViewDesc, depthStencilView.put()));
+            // Views are normally created by CreateRenderTargetViews and CreateDepthStencilViews, this only creates views for
+            // textures which were not announced up front.
+            ID3D11RenderTargetView* const renderTargetView = GetOrCreateRenderTargetView(colorSwapchainFormat, colorTexture);
+            ID3D11DepthStencilView* const depthStencilView = GetOrCreateDepthStencilView(depthSwapchainFormat, depthTexture);
 
             const bool reversedZ = viewProjections[0].NearFar.Near > viewProjections[0].NearFar.Far;
             const float depthClearValue = reversedZ ? 0.f : 1.f;
 
             // Clear swapchain and depth buffer. NOTE: This will clear the entire render target view, not just the specified view.
-            m_deviceContext->ClearRenderTargetView(renderTargetView.get(), renderTargetClearColor);
-            m_deviceContext->ClearDepthStencilView(depthStencilView.get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, depthClearValue, 0);
+            m_deviceContext->ClearRenderTargetView(renderTargetView, renderTargetClearColor);
+            m_deviceContext->ClearDepthStencilView(depthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, depthClearValue, 0);
             m_deviceContext->OMSetDepthStencilState(reversedZ ? m_reversedZDepthNoStencilTest.get() : nullptr, 0);
 
-            ID3D11RenderTargetView* renderTargets[] = {renderTargetView.get()};
-            m_deviceContext->OMSetRenderTargets((UINT)std::size(renderTargets), renderTargets, depthStencilView.get());
+            ID3D11RenderTargetView* renderTargets[] = {renderTargetView};
+            m_deviceContext->OMSetRenderTargets((UINT)std::size(renderTargets), renderTargets, depthStencilView);
+
+            if (cubes.Size() == 0) {
+                EndGpuTimer();
+                return;
+            }
 
-            ID3D11Buffer* const vsConstantBuffers[] = {m_modelCBuffer.get(), m_viewProjectionCBuffer.get()};
-            m_deviceContext->VSSetConstantBuffers(0, (UINT)std::size(vsConstantBuffers), vsConstantBuffers);
+            UpdateCubeInstanceBuffer(cubes);
+
+            ID3D11Buffer* const vsConstantBuffers[] = {m_viewProjectionCBuffer.get()};
+            m_deviceContext->VSSetConstantBuffers(1, (UINT)std::size(vsConstantBuffers), vsConstantBuffers);
+            ID3D11ShaderResourceView* const vsShaderResources[] = {m_cubeInstanceBufferView.get()};
+            m_deviceContext->VSSetShaderResources(0, (UINT)std::size(vsShaderResources), vsShaderResources);
             m_deviceContext->VSSetShader(m_vertexShader.get(), nullptr, 0);
 
-            ID3D11Buffer* const psConstantBuffers[] = {m_colorFilterCBuffer.get()};
-            m_deviceContext->PSSetConstantBuffers(0, (UINT)std::size(psConstantBuffers), psConstantBuffers);
             m_deviceContext->PSSetShader(m_pixelShader.get(), nullptr, 0);
 
             CubeShader::ViewProjectionConstantBuffer viewProjectionCBufferData{};
+            viewProjectionCBufferData.ViewCount = viewInstanceCount;
 
             for (uint32_t k = 0; k < viewInstanceCount; k++) {
                 const DirectX::XMMATRIX spaceToView = xr::math::LoadInvertedXrPose(viewProjections[k].Pose);
@@ -276,42 +289,186 @@ namespace {
             m_deviceContext->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
             m_deviceContext->IASetInputLayout(m_inputLayout.get());
 
-            // Render each cube
-            for (const sample::Cube* cube : cubes) {
-                // Compute and update the model transform for each cube, transpose for shader usage.
-                CubeShader::ModelConstantBuffer model;
-                const DirectX::XMMATRIX scaleMatrix = DirectX::XMMatrixScaling(cube->Scale.x, cube->Scale.y, cube->Scale.z);
-                DirectX::XMStoreFloat4x4(&model.Model,
-                                         DirectX::XMMatrixTranspose(scaleMatrix * xr::math::LoadXrPose(cube->PoseInAppSpace)));
-                m_deviceContext->UpdateSubresource(m_modelCBuffer.get(), 0, nullptr, &model, 0, 0);
-
-                CubeShader::ColorFilterConstantBuffer color;
-                color.colorFilter = DirectX::XMFLOAT4(cube->colorFilter.x, cube->colorFilter.y, cube->colorFilter.z, 1.0f);
-                m_deviceContext->UpdateSubresource(m_colorFilterCBuffer.get(), 0, nullptr, &color, 0, 0);
-
-                // Draw the cube.
-                m_deviceContext->DrawIndexedInstanced((UINT)std::size(CubeShader::c_cubeIndices), viewInstanceCount, 0, 0, 0);
-            }
+            // Draw all cubes in all views at once.
+            m_deviceContext->DrawIndexedInstanced(
+                (UINT)std::size(CubeShader::c_cubeIndices), (UINT)cubes.Size() * viewInstanceCount, 0, 0, 0);
+
+            EndGpuTimer();
         }
 
         void ClearView(ID3D11Texture2D* colorTexture, const float renderTargetClearColor[4]) override {
-            winrt::com_ptr<ID3D11RenderTargetView> renderTargetView;
-            CHECK_HRCMD(m_device->CreateRenderTargetView(colorTexture, nullptr, renderTargetView.put()));
+            // The window swapchain always returns the same texture for its current back buffer, so its view is cached as well.
+            winrt::com_ptr<ID3D11RenderTargetView>& renderTargetView = m_renderTargetViews[colorTexture];
+            if (!renderTargetView) {
+                CHECK_HRCMD(m_device->CreateRenderTargetView(colorTexture, nullptr, renderTargetView.put()));
+            }
             m_deviceContext->ClearRenderTargetView(renderTargetView.get(), renderTargetClearColor);
         }
 
+        void CreateRenderTargetViews(DXGI_FORMAT colorSwapchainFormat, const std::vector<XrSwapchainImageD3D11KHR>& images) override {
+            for (const XrSwapchainImageD3D11KHR& image : images) {
+                GetOrCreateRenderTargetView(colorSwapchainFormat, image.texture);
+            }
+        }
+
+        void CreateDepthStencilViews(DXGI_FORMAT depthSwapchainFormat, const std::vector<XrSwapchainImageD3D11KHR>& images) override {
+            for (const XrSwapchainImageD3D11KHR& image : images) {
+                GetOrCreateDepthStencilView(depthSwapchainFormat, image.texture);
+            }
+        }
+
+        void ReleaseSwapchainImageViews() override {
+            m_renderTargetViews.clear();
+            m_depthStencilViews.clear();
+        }
+
+        std::optional<float> TryGetGpuFrameTime() override {
+            while (m_gpuTimerReadIndex != m_gpuTimerWriteIndex) {
+                const GpuTimerQueries& queries = m_gpuTimerQueries[m_gpuTimerReadIndex % GpuTimerQueryCount];
+
+                D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint;
+                UINT64 begin;
+                UINT64 end;
+                constexpr UINT getDataFlags = D3D11_ASYNC_GETDATA_DONOTFLUSH;
+                if (m_deviceContext->GetData(queries.Disjoint.get(), &disjoint, sizeof(disjoint), getDataFlags) != S_OK ||
+                    m_deviceContext->GetData(queries.Begin.get(), &begin, sizeof(begin), getDataFlags) != S_OK ||
+                    m_deviceContext->GetData(queries.End.get(), &end, sizeof(end), getDataFlags) != S_OK) {
+                    return std::nullopt;
+                }
+
+                m_gpuTimerReadIndex++;
+
+                // Timestamps are unreliable if the GPU clock changed while measuring, skip such measurements.
+                if (!disjoint.Disjoint && end >= begin) {
+                    return (float)((double)(end - begin) / (double)disjoint.Frequency);
+                }
+            }
+            return std::nullopt;
+        }
+
     private:
+        void BeginGpuTimer() {
+            // Skip measuring this frame if the results of all queries are still pending.
+            m_gpuTimerActive = m_gpuTimerWriteIndex - m_gpuTimerReadIndex < GpuTimerQueryCount;
+            if (m_gpuTimerActive) {
+                const GpuTimerQueries& queries = m_gpuTimerQueries[m_gpuTimerWriteIndex % GpuTimerQueryCount];
+                m_deviceContext->Begin(queries.Disjoint.get());
+                m_deviceContext->End(queries.Begin.get());
+            }
+        }
+
+        void EndGpuTimer() {
+            if (m_gpuTimerActive) {
+                const GpuTimerQueries& queries = m_gpuTimerQueries[m_gpuTimerWriteIndex % GpuTimerQueryCount];
+                m_deviceContext->End(queries.End.get());
+                m_deviceContext->End(queries.Disjoint.get());
+                m_gpuTimerWriteIndex++;
+                m_gpuTimerActive = false;
+            }
+        }
+
+        // Writes the model transforms and color filters of all cubes to the instance buffer, growing it if needed.
+        void UpdateCubeInstanceBuffer(const sample::CubeBatch& cubes) {
+            const uint32_t cubeCount = (uint32_t)cubes.Size();
+            if (cubeCount > m_cubeInstanceCapacity) {
+                m_cubeInstanceCapacity = std::max({cubeCount, 2 * m_cubeInstanceCapacity, CubeShader::MinCubeInstanceCapacity});
+
+                m_cubeInstanceBufferView = nullptr;
+                m_cubeInstanceBuffer = nullptr;
+
+                const CD3D11_BUFFER_DESC instanceBufferDesc(m_cubeInstanceCapacity * sizeof(CubeShader::CubeInstance),
+                                                            D3D11_BIND_SHADER_RESOURCE,
+                                                            D3D11_USAGE_DYNAMIC,
+                                                            D3D11_CPU_ACCESS_WRITE,
+                                                            D3D11_RESOURCE_MISC_BUFFER_STRUCTURED,
+                                                            sizeof(CubeShader::CubeInstance));
+                CHECK_HRCMD(m_device->CreateBuffer(&instanceBufferDesc, nullptr, m_cubeInstanceBuffer.put()));
+
+                const CD3D11_SHADER_RESOURCE_VIEW_DESC instanceBufferViewDesc(
+                    m_cubeInstanceBuffer.get(), DXGI_FORMAT_UNKNOWN, 0, m_cubeInstanceCapacity);
+                CHECK_HRCMD(m_device->CreateShaderResourceView(
+                    m_cubeInstanceBuffer.get(), &instanceBufferViewDesc, m_cubeInstanceBufferView.put()));
+            }
+
+            D3D11_MAPPED_SUBRESOURCE mappedResource{};
+            CHECK_HRCMD(m_deviceContext->Map(m_cubeInstanceBuffer.get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedResource));
+
+            CubeShader::CubeInstance* const instances = static_cast<CubeShader::CubeInstance*>(mappedResource.pData);
+
+            // Compute the model transforms of all cubes in one batch, transposed for shader usage.
+            xr::math::StoreTransposedXrPoseMatrices(
+                cubes.PosesInAppSpace.data(), cubes.Scales.data(), cubeCount, &instances[0].Model, sizeof(CubeShader::CubeInstance));
+
+            for (uint32_t i = 0; i < cubeCount; i++) {
+                const XrVector3f& colorFilter = cubes.ColorFilters[i];
+                instances[i].ColorFilter = DirectX::XMFLOAT4(colorFilter.x, colorFilter.y, colorFilter.z, 1.0f);
+            }
+
+            m_deviceContext->Unmap(m_cubeInstanceBuffer.get(), 0);
+        }
+
+        // Swapchains are multisampled if a sample count above one was requested on the command line.
+        static bool IsMultisampled(ID3D11Texture2D* texture) {
+            D3D11_TEXTURE2D_DESC desc;
+            texture->GetDesc(&desc);
+            return desc.SampleDesc.Count > 1;
+        }
+
+        ID3D11RenderTargetView* GetOrCreateRenderTargetView(DXGI_FORMAT colorSwapchainFormat, ID3D11Texture2D* colorTexture) {
+            winrt::com_ptr<ID3D11RenderTargetView>& renderTargetView = m_renderTargetViews[colorTexture];
+            if (!renderTargetView) {
+                // Create RenderTargetView with the original swapchain format (swapchain image is typeless).
+                const D3D11_RTV_DIMENSION dimension =
+                    IsMultisampled(colorTexture) ? D3D11_RTV_DIMENSION_TEXTURE2DMSARRAY : D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
+                const CD3D11_RENDER_TARGET_VIEW_DESC renderTargetViewDesc(colorTexture, dimension, colorSwapchainFormat);
+                CHECK_HRCMD(m_device->CreateRenderTargetView(colorTexture, &renderTargetViewDesc, renderTargetView.put()));
+            }
+            return renderTargetView.get();
+        }
+
+        ID3D11DepthStencilView* GetOrCreateDepthStencilView(DXGI_FORMAT depthSwapchainFormat, ID3D11Texture2D* depthTexture) {
+            winrt::com_ptr<ID3D11DepthStencilView>& depthStencilView = m_depthStencilViews[depthTexture];
+            if (!depthStencilView) {
+                // Create a DepthStencilView with the original swapchain format (swapchain image is typeless)
+                const D3D11_DSV_DIMENSION dimension =
+                    IsMultisampled(depthTexture) ? D3D11_DSV_DIMENSION_TEXTURE2DMSARRAY : D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+                const CD3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc(depthTexture, dimension, depthSwapchainFormat);
+                CHECK_HRCMD(m_device->CreateDepthStencilView(depthTexture, &depthStencilViewDesc, depthStencilView.put()));
+            }
+            return depthStencilView.get();
+        }
+
         winrt::com_ptr<ID3D11Device> m_device;
         winrt::com_ptr<ID3D11DeviceContext> m_deviceContext;
         winrt::com_ptr<ID3D11VertexShader> m_vertexShader;
         winrt::com_ptr<ID3D11PixelShader> m_pixelShader;
         winrt::com_ptr<ID3D11InputLayout> m_inputLayout;
-        winrt::com_ptr<ID3D11Buffer> m_modelCBuffer;
         winrt::com_ptr<ID3D11Buffer> m_viewProjectionCBuffer;
-        winrt::com_ptr<ID3D11Buffer> m_colorFilterCBuffer;
+        winrt::com_ptr<ID3D11Buffer> m_cubeInstanceBuffer;
+        winrt::com_ptr<ID3D11ShaderResourceView> m_cubeInstanceBufferView;
+        uint32_t m_cubeInstanceCapacity = 0;
         winrt::com_ptr<ID3D11Buffer> m_cubeVertexBuffer;
         winrt::com_ptr<ID3D11Buffer> m_cubeIndexBuffer;
         winrt::com_ptr<ID3D11DepthStencilState> m_reversedZDepthNoStencilTest;
+
+        // Views of swapchain images, keyed by the texture they were created for. Each view holds a reference to its texture,
+        // so a texture address cannot be reused by a different texture while it is in the map.
+        std::unordered_map<ID3D11Texture2D*, winrt::com_ptr<ID3D11RenderTargetView>> m_renderTargetViews;
+        std::unordered_map<ID3D11Texture2D*, winrt::com_ptr<ID3D11DepthStencilView>> m_depthStencilViews;
+
+        // Timestamp queries measuring the GPU time of RenderView. Several frames are measured at once, so that results can be
+        // read back once the GPU is done with a frame instead of waiting for it. The indices count up, modulo the query
+        // count they select the queries of the next frame to measure and of the oldest frame not read back yet.
+        struct GpuTimerQueries {
+            winrt::com_ptr<ID3D11Query> Disjoint;
+            winrt::com_ptr<ID3D11Query> Begin;
+            winrt::com_ptr<ID3D11Query> End;
+        };
+        static constexpr uint32_t GpuTimerQueryCount = 4;
+        std::array<GpuTimerQueries, GpuTimerQueryCount> m_gpuTimerQueries;
+        uint32_t m_gpuTimerWriteIndex = 0;
+        uint32_t m_gpuTimerReadIndex = 0;
+        bool m_gpuTimerActive = false;
     };
 } // namespace
 
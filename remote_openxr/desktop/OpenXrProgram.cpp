@@ -18,14 +18,25 @@
 #include "OpenXrProgram.h"
 #include "DxUtility.h"
 
+#include <condition_variable>
+#include <execution>
 #include <filesystem>
 #include <fstream>
+#include <limits>
 #include <queue>
+#include <random>
+#include <string_view>
 
 #if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
 #include <SampleShared/SampleWindowWin32.h>
 #endif
 
+#include <SampleShared/DataChannelDispatcher.h>
+#include <SampleShared/DataChannelSender.h>
+
+#include <BitrateController.h>
+#include <holographic/SpatialIndex.h>
+
 // #define ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
 
 namespace {
@@ -38,6 +49,20 @@ namespace {
             : m_applicationName(std::move(applicationName))
             , m_graphicsPlugin(std::move(graphicsPlugin))
             , m_options(options) {
+#ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
+            m_userDataDispatcher.Register(PlayerFrameStatisticsMessage::Type, [this](winrt::array_view<const uint8_t> message) {
+                if (message.size() == sizeof(PlayerFrameStatisticsMessage)) {
+                    // Copied to get a properly aligned structure; the received data itself stays in the receive buffer.
+                    PlayerFrameStatisticsMessage statistics;
+                    memcpy(&statistics, message.data(), sizeof(statistics));
+                    AdaptStreamSettings(statistics);
+                }
+            });
+
+            m_userDataDispatcher.SetDefaultHandler([](winrt::array_view<const uint8_t> message) {
+                DEBUG_PRINT("Holographic Remoting: Custom data channel data received: %d", static_cast<uint32_t>(message[0]));
+            });
+#endif
         }
 
         void Run() override {
@@ -75,9 +100,14 @@ namespace {
                         if (timeDelta > std::chrono::seconds(5)) {
                             m_customDataChannelSendTime = std::chrono::high_resolution_clock::now();
 
-                            if (!m_userDataChannelDestroyed && m_usingRemotingRuntime) {
-                                SendDataViaUserDataChannel(m_userDataChannel);
-                            }
+                            const uint8_t data[] = {17};
+                            SendUserData(sample::DataChannelSender::Lane::Reliable, data, sizeof(data));
+                        }
+
+                        if (!m_userDataChannelDestroyed && m_usingRemotingRuntime) {
+                            FlushUserDataChannel(m_userDataChannel);
+                        } else {
+                            m_userDataSender.Clear();
                         }
 #endif
 
@@ -98,6 +128,8 @@ namespace {
                     PrepareSessionRestart();
                 }
             } while (requestRestart);
+
+            StopFramePacing();
         }
 
     private:
@@ -116,28 +148,84 @@ namespace {
             CHECK_XRCMD(m_extensions.xrDestroyRemotingDataChannelMSFT(channelHandle));
         }
 
-        void SendDataViaUserDataChannel(XrRemotingDataChannelMSFT channelHandle) {
+        // The bitrate and the depth resolution are chosen by the BitrateController shared with the holographic remote and are
+        // applied on the next ConnectOrListen. The render scale follows its decisions, which takes effect immediately.
+        void AdaptStreamSettings(const PlayerFrameStatisticsMessage& statistics) {
+            switch (m_bitrateController.OnPlayerFrameStatistics(statistics)) {
+            case BitrateController::Adjustment::Lowered:
+                // Fewer rendered pixels are cheaper to encode, see UpdateRenderScale.
+                m_maxRenderScale = std::max(m_maxRenderScale - 0.1f, MinRenderScale);
+                break;
+            case BitrateController::Adjustment::Raised:
+                m_maxRenderScale = std::min(m_maxRenderScale + 0.1f, 1.0f);
+                break;
+            default:
+                break;
+            }
+        }
+
+        // Queues a message for the user data channel. Thread-safe, queued messages are sent in batches once per frame.
+        bool SendUserData(sample::DataChannelSender::Lane lane, const uint8_t* data, size_t size) {
+            return m_userDataSender.Enqueue(lane, data, size);
+        }
+
+        void FlushUserDataChannel(XrRemotingDataChannelMSFT channelHandle) {
             XrRemotingDataChannelStateMSFT channelState{static_cast<XrStructureType>(XR_TYPE_REMOTING_DATA_CHANNEL_STATE_MSFT)};
             CHECK_XRCMD(m_extensions.xrGetRemotingDataChannelStateMSFT(channelHandle, &channelState));
 
-            if (channelState.connectionStatus == XR_REMOTING_DATA_CHANNEL_STATUS_OPENED_MSFT) {
-                // Only send the packet if the send queue is smaller than 1MiB
-                if (channelState.sendQueueSize >= 1 * 1024 * 1024) {
-                    return;
-                }
-
-                DEBUG_PRINT("Holographic Remoting: SendDataViaUserDataChannel.");
-                uint8_t data[] = {17};
+            if (channelState.connectionStatus != XR_REMOTING_DATA_CHANNEL_STATUS_OPENED_MSFT) {
+                return;
+            }
 
+            // The sender only adds to the send queue while it is below its limit, which keeps the queue from growing when
+            // more data is produced than the connection can carry.
+            m_userDataSender.Flush(channelState.sendQueueSize, [&](const uint8_t* batch, uint32_t size, bool guaranteedDelivery) {
                 XrRemotingDataChannelSendDataInfoMSFT sendInfo{
                     static_cast<XrStructureType>(XR_TYPE_REMOTING_DATA_CHANNEL_SEND_DATA_INFO_MSFT)};
-                sendInfo.data = data;
-                sendInfo.size = sizeof(data);
-                sendInfo.guaranteedDelivery = true;
+                sendInfo.data = batch;
+                sendInfo.size = size;
+                sendInfo.guaranteedDelivery = guaranteedDelivery;
                 CHECK_XRCMD(m_extensions.xrSendRemotingDataMSFT(channelHandle, &sendInfo));
-            }
+            });
         }
 #endif
+        static uint32_t GetDepthDownscale(XrRemotingDepthBufferStreamResolutionMSFT resolution) {
+            switch (resolution) {
+            case XR_REMOTING_DEPTH_BUFFER_STREAM_RESOLUTION_FULL_MSFT:
+                return 1;
+            case XR_REMOTING_DEPTH_BUFFER_STREAM_RESOLUTION_QUARTER_MSFT:
+                return 4;
+            default:
+                return 2;
+            }
+        }
+
+        static XrRemotingDepthBufferStreamResolutionMSFT GetDepthBufferStreamResolution(uint32_t depthDownscale) {
+            switch (depthDownscale) {
+            case 1:
+                return XR_REMOTING_DEPTH_BUFFER_STREAM_RESOLUTION_FULL_MSFT;
+            case 4:
+                return XR_REMOTING_DEPTH_BUFFER_STREAM_RESOLUTION_QUARTER_MSFT;
+            default:
+                return XR_REMOTING_DEPTH_BUFFER_STREAM_RESOLUTION_HALF_MSFT;
+            }
+        }
+
+        // Takes effect with the next connection. The adaptation in AdaptStreamSettings restarts from the new settings.
+        void ApplyStreamSettings(sample::StreamProfile profile, const sample::StreamSettings& settings) {
+            m_streamProfile = profile;
+            m_streamSettings = settings;
+            m_bitrateController.Configure(settings.maxBitrateKbps, GetDepthDownscale(settings.depthBufferStreamResolution));
+
+            DEBUG_PRINT("Stream settings: %s, %u kbps, codec %d, depth resolution %d, audio %s.",
+                        sample::GetStreamProfileName(profile),
+                        settings.maxBitrateKbps,
+                        settings.videoCodec,
+                        settings.depthBufferStreamResolution,
+                        settings.enableAudio ? "on" : "off");
+            UpdateWindowTitleWin32();
+        }
+
         bool EnableRemotingXR() {
             wchar_t executablePath[MAX_PATH];
             if (GetModuleFileNameW(NULL, executablePath, ARRAYSIZE(executablePath)) == 0) {
@@ -227,8 +315,14 @@ namespace {
             speechInitInfo.dictionaryEntries = m_dictionaryEntries.data();
             speechInitInfo.dictionaryEntriesCount = static_cast<uint32_t>(m_dictionaryEntries.size());
 
-            // Initialize the grammar file if it exists.
-            if (LoadGrammarFile(m_grammarFileContent)) {
+            // Initialize the grammar file if it exists. It is read once and reused by the sessions of later connections.
+            if (!m_grammarFileLoaded) {
+                m_grammarFileLoaded = true;
+                if (!LoadGrammarFile(m_grammarFileContent)) {
+                    m_grammarFileContent.clear();
+                }
+            }
+            if (!m_grammarFileContent.empty()) {
                 speechInitInfo.grammarFileSize = static_cast<uint32_t>(m_grammarFileContent.size());
                 speechInitInfo.grammarFileContent = m_grammarFileContent.data();
             }
@@ -292,6 +386,9 @@ namespace {
             m_optionalExtensions.DepthExtensionSupported = EnableExtensionIfSupported(XR_KHR_COMPOSITION_LAYER_DEPTH_EXTENSION_NAME);
             m_optionalExtensions.UnboundedRefSpaceSupported = EnableExtensionIfSupported(XR_MSFT_UNBOUNDED_REFERENCE_SPACE_EXTENSION_NAME);
             m_optionalExtensions.SpatialAnchorSupported = EnableExtensionIfSupported(XR_MSFT_SPATIAL_ANCHOR_EXTENSION_NAME);
+#if XR_KHR_locate_spaces
+            m_optionalExtensions.LocateSpacesSupported = EnableExtensionIfSupported(XR_KHR_LOCATE_SPACES_EXTENSION_NAME);
+#endif
 
             return enabledExtensions;
         }
@@ -501,11 +598,12 @@ namespace {
                 XrRemotingRemoteContextPropertiesMSFT contextProperties;
                 contextProperties =
                     XrRemotingRemoteContextPropertiesMSFT{static_cast<XrStructureType>(XR_TYPE_REMOTING_REMOTE_CONTEXT_PROPERTIES_MSFT)};
-                contextProperties.enableAudio = false;
-                contextProperties.maxBitrateKbps = 20000;
-                contextProperties.videoCodec = XR_REMOTING_VIDEO_CODEC_H265_MSFT;
-                contextProperties.depthBufferStreamResolution = XR_REMOTING_DEPTH_BUFFER_STREAM_RESOLUTION_HALF_MSFT;
+                contextProperties.enableAudio = m_streamSettings.enableAudio;
+                contextProperties.maxBitrateKbps = m_bitrateController.GetBitrateKbps();
+                contextProperties.videoCodec = m_streamSettings.videoCodec;
+                contextProperties.depthBufferStreamResolution = GetDepthBufferStreamResolution(m_bitrateController.GetDepthDownscale());
                 CHECK_XRCMD(m_extensions.xrRemotingSetContextPropertiesMSFT(m_instance.Get(), m_systemId, &contextProperties));
+                m_bitrateController.MarkApplied();
             }
 
             if (m_options.listen) {
@@ -694,9 +792,18 @@ namespace {
             CHECK_XRCMD(xrEnumerateSwapchainFormats(
                 m_session.Get(), (uint32_t)swapchainFormats.size(), &swapchainFormatCount, swapchainFormats.data()));
 
-            // Choose the first runtime-preferred format that this app supports.
+            // Choose the first of the preferred formats that the runtime supports. Without a preference, or if none of them is
+            // supported, choose the first runtime-preferred format that this app supports.
             auto SelectPixelFormat = [](const std::vector<int64_t>& runtimePreferredFormats,
-                                        const std::vector<DXGI_FORMAT>& applicationSupportedFormats) {
+                                        const std::vector<DXGI_FORMAT>& applicationSupportedFormats,
+                                        const std::vector<DXGI_FORMAT>& preferredFormats) {
+                for (DXGI_FORMAT preferredFormat : preferredFormats) {
+                    if (std::find(runtimePreferredFormats.begin(), runtimePreferredFormats.end(), preferredFormat) !=
+                        runtimePreferredFormats.end()) {
+                        return preferredFormat;
+                    }
+                }
+
                 auto found = std::find_first_of(std::begin(runtimePreferredFormats),
                                                 std::end(runtimePreferredFormats),
                                                 std::begin(applicationSupportedFormats),
@@ -707,8 +814,31 @@ namespace {
                 return (DXGI_FORMAT)*found;
             };
 
-            DXGI_FORMAT colorSwapchainFormat = SelectPixelFormat(swapchainFormats, m_graphicsPlugin->SupportedColorFormats());
-            DXGI_FORMAT depthSwapchainFormat = SelectPixelFormat(swapchainFormats, m_graphicsPlugin->SupportedDepthFormats());
+            // Linear color formats avoid the sRGB conversion when rendering and when the runtime reads the images.
+            std::vector<DXGI_FORMAT> preferredColorFormats;
+            if (m_options.colorFormat == sample::ColorFormatPreference::Linear) {
+                preferredColorFormats = {DXGI_FORMAT_R8G8B8A8_UNORM, DXGI_FORMAT_B8G8R8A8_UNORM};
+            } else if (m_options.colorFormat == sample::ColorFormatPreference::Srgb) {
+                preferredColorFormats = {DXGI_FORMAT_R8G8B8A8_UNORM_SRGB, DXGI_FORMAT_B8G8R8A8_UNORM_SRGB};
+            }
+
+            // 16 bit depth halves the memory and bandwidth of the depth swapchain and is cheaper to encode for streaming.
+            const bool preferUnorm16Depth =
+                m_options.depthFormat == sample::DepthFormatPreference::Unorm16 ||
+                (m_options.depthFormat == sample::DepthFormatPreference::Auto &&
+                 m_streamSettings.depthBufferStreamResolution != XR_REMOTING_DEPTH_BUFFER_STREAM_RESOLUTION_FULL_MSFT);
+            std::vector<DXGI_FORMAT> preferredDepthFormats;
+            if (preferUnorm16Depth) {
+                preferredDepthFormats = {DXGI_FORMAT_D16_UNORM};
+            } else if (m_options.depthFormat == sample::DepthFormatPreference::Float32) {
+                preferredDepthFormats = {DXGI_FORMAT_D32_FLOAT};
+            }
+
+            DXGI_FORMAT colorSwapchainFormat =
+                SelectPixelFormat(swapchainFormats, m_graphicsPlugin->SupportedColorFormats(), preferredColorFormats);
+            DXGI_FORMAT depthSwapchainFormat =
+                SelectPixelFormat(swapchainFormats, m_graphicsPlugin->SupportedDepthFormats(), preferredDepthFormats);
+            DEBUG_PRINT("Swapchain formats: color %d, depth %d.", colorSwapchainFormat, depthSwapchainFormat);
 
             return {colorSwapchainFormat, depthSwapchainFormat};
         }
@@ -746,10 +876,12 @@ namespace {
                       m_renderResources->ConfigViews[1].recommendedSwapchainSampleCount);
             }
 
-            // Use the system's recommended rendering parameters.
+            // Use the system's recommended rendering parameters, unless a sample count was requested.
             const uint32_t imageRectWidth = view.recommendedImageRectWidth;
             const uint32_t imageRectHeight = view.recommendedImageRectHeight;
-            const uint32_t swapchainSampleCount = view.recommendedSwapchainSampleCount;
+            const uint32_t swapchainSampleCount = m_options.swapchainSampleCount != 0
+                                                      ? std::min(m_options.swapchainSampleCount, view.maxSwapchainSampleCount)
+                                                      : view.recommendedSwapchainSampleCount;
 
             // Create swapchains with texture array for color and depth images.
             // The texture array has the size of viewCount, and they are rendered in a single pass using VPRT.
@@ -774,8 +906,23 @@ namespace {
                                      0 /*createFlags*/,
                                      XR_SWAPCHAIN_USAGE_SAMPLED_BIT | XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
 
-            // Preallocate view buffers for xrLocateViews later inside frame loop.
+            // OpenXR leaves the number of images to the runtime, it can only be observed.
+            DEBUG_PRINT("Swapchain images: %zu color, %zu depth, %u samples.",
+                        m_renderResources->ColorSwapchain.Images.size(),
+                        m_renderResources->DepthSwapchain.Images.size(),
+                        swapchainSampleCount);
+
+            // The swapchain images are fixed from now on, create their views once instead of every frame.
+            m_graphicsPlugin->CreateRenderTargetViews(colorSwapchainFormat, m_renderResources->ColorSwapchain.Images);
+            m_graphicsPlugin->CreateDepthStencilViews(depthSwapchainFormat, m_renderResources->DepthSwapchain.Images);
+
+            // Preallocate view buffers for xrLocateViews and the composition layer later inside frame loop.
             m_renderResources->Views.resize(viewCount, {XR_TYPE_VIEW});
+            m_renderResources->ViewProjections.resize(viewCount);
+            m_renderResources->ProjectionLayerViews.resize(viewCount);
+            if (m_optionalExtensions.DepthExtensionSupported) {
+                m_renderResources->DepthInfoViews.resize(viewCount);
+            }
         }
 
         struct SwapchainD3D11;
@@ -819,22 +966,25 @@ namespace {
         }
 
         void HandleRecognizedSpeechText(const std::string& text) {
-            if (text == "Red") {
-                m_cubeColorFilter = {1.0f, 0.0f, 0.0f};
-            } else if (text == "Green") {
-                m_cubeColorFilter = {0.0f, 1.0f, 0.0f};
-            } else if (text == "Blue") {
-                m_cubeColorFilter = {0.0f, 0.0f, 1.0f};
-            } else if (text == "Aquamarine") {
-                m_cubeColorFilter = {0.0f, 1.0f, 1.0f};
-            } else if (text == "Default") {
-                m_cubeColorFilter = {1.0f, 1.0f, 1.0f};
-            } else if (text == "Exit Program") {
-                CHECK_XRCMD(xrRequestExitSession(m_session.Get()));
-            } else if (text == "Reverse Direction") {
-                // Reverse the rotation direction of the spinning cube
-                // from anticlockwise to clockwise or vice versa.
-                m_rotationDirection *= -1;
+            using SpeechCommand = void (*)(ImplementOpenXrProgram& program);
+            static const std::unordered_map<std::string_view, SpeechCommand> speechCommands = {
+                {"Red", [](ImplementOpenXrProgram& program) { program.m_cubeColorFilter = {1.0f, 0.0f, 0.0f}; }},
+                {"Green", [](ImplementOpenXrProgram& program) { program.m_cubeColorFilter = {0.0f, 1.0f, 0.0f}; }},
+                {"Blue", [](ImplementOpenXrProgram& program) { program.m_cubeColorFilter = {0.0f, 0.0f, 1.0f}; }},
+                {"Aquamarine", [](ImplementOpenXrProgram& program) { program.m_cubeColorFilter = {0.0f, 1.0f, 1.0f}; }},
+                {"Default", [](ImplementOpenXrProgram& program) { program.m_cubeColorFilter = {1.0f, 1.0f, 1.0f}; }},
+                {"Exit Program", [](ImplementOpenXrProgram& program) { CHECK_XRCMD(xrRequestExitSession(program.m_session.Get())); }},
+                {"Reverse Direction",
+                 [](ImplementOpenXrProgram& program) {
+                     // Reverse the rotation direction of the spinning cube
+                     // from anticlockwise to clockwise or vice versa.
+                     program.m_rotationDirection *= -1;
+                 }},
+            };
+
+            const auto command = speechCommands.find(text);
+            if (command != speechCommands.end()) {
+                command->second(*this);
             }
         }
 
@@ -866,11 +1016,13 @@ namespace {
                         sessionBeginInfo.primaryViewConfigurationType = m_primaryViewConfigType;
                         CHECK_XRCMD(xrBeginSession(m_session.Get(), &sessionBeginInfo));
                         m_sessionRunning = true;
+                        StartFramePacing();
                         UpdateWindowTitleWin32();
                         break;
                     }
                     case XR_SESSION_STATE_STOPPING: {
                         m_sessionRunning = false;
+                        StopFramePacing();
                         CHECK_XRCMD(xrEndSession(m_session.Get()));
                         break;
                     }
@@ -926,14 +1078,16 @@ namespace {
                 }
                 case XR_TYPE_EVENT_DATA_REMOTING_DATA_CHANNEL_DATA_RECEIVED_MSFT: {
                     auto dataReceivedEventData = reinterpret_cast<const XrEventDataRemotingDataChannelDataReceivedMSFT*>(&eventData);
-                    std::vector<uint8_t> packet(dataReceivedEventData->size);
+                    const winrt::array_view<uint8_t> packet = m_userDataReceiveBuffer.Acquire(dataReceivedEventData->size);
                     uint32_t dataBytesCount;
                     CHECK_XRCMD(m_extensions.xrRetrieveRemotingDataMSFT(dataReceivedEventData->channel,
                                                                         dataReceivedEventData->packetId,
-                                                                        static_cast<uint32_t>(packet.size()),
+                                                                        packet.size(),
                                                                         &dataBytesCount,
                                                                         packet.data()));
-                    DEBUG_PRINT("Holographic Remoting: Custom data channel data received: %d", static_cast<uint32_t>(packet[0]));
+
+                    // The player sends every message in a packet of its own.
+                    m_userDataDispatcher.Dispatch(winrt::array_view<const uint8_t>(packet.data(), packet.data() + dataBytesCount));
                     break;
                 }
 
@@ -1079,18 +1233,131 @@ namespace {
             }
         }
 
+        // xrWaitFrame and xrBeginFrame are called on a frame pacing thread, which hands each begun frame to the main thread.
+        // The main thread renders and ends the frame, meanwhile the pacing thread already waits for the next frame. This way
+        // the main thread keeps processing events and input instead of being blocked in xrWaitFrame, and the runtime can
+        // start pacing frame N+1 while frame N is still being submitted.
+        void StartFramePacing() {
+            CHECK(!m_framePacingThread.joinable());
+
+            m_stopFramePacing = false;
+            m_frameInProgress = false;
+            m_begunFrameState.reset();
+            m_framePacingException = nullptr;
+            m_framePacingThread = std::thread([this]() { FramePacingThread(); });
+        }
+
+        void StopFramePacing() {
+            if (!m_framePacingThread.joinable()) {
+                return;
+            }
+
+            {
+                std::lock_guard lock(m_framePacingMutex);
+                m_stopFramePacing = true;
+            }
+            m_framePacingCondition.notify_all();
+            m_framePacingThread.join();
+
+            // A frame which was begun but not handed to the main thread yet still has to be ended.
+            if (m_begunFrameState.has_value()) {
+                XrFrameEndInfo frameEndInfo{XR_TYPE_FRAME_END_INFO};
+                frameEndInfo.displayTime = m_begunFrameState->predictedDisplayTime;
+                frameEndInfo.environmentBlendMode = m_environmentBlendMode;
+                CHECK_XRCMD(xrEndFrame(m_session.Get(), &frameEndInfo));
+            }
+
+            m_frameInProgress = false;
+            m_begunFrameState.reset();
+        }
+
+        void FramePacingThread() {
+            try {
+                while (true) {
+                    XrFrameWaitInfo frameWaitInfo{XR_TYPE_FRAME_WAIT_INFO};
+                    XrFrameState frameState{XR_TYPE_FRAME_STATE};
+                    CHECK_XRCMD(xrWaitFrame(m_session.Get(), &frameWaitInfo, &frameState));
+
+                    // The next frame must not be begun before the main thread ended the previous one.
+                    std::unique_lock lock(m_framePacingMutex);
+                    m_framePacingCondition.wait(lock, [this]() { return m_stopFramePacing || !m_frameInProgress; });
+                    if (m_stopFramePacing) {
+                        return;
+                    }
+
+                    XrFrameBeginInfo frameBeginInfo{XR_TYPE_FRAME_BEGIN_INFO};
+                    CHECK_XRCMD(xrBeginFrame(m_session.Get(), &frameBeginInfo));
+
+                    m_frameInProgress = true;
+                    m_begunFrameState = frameState;
+                    lock.unlock();
+                    m_framePacingCondition.notify_all();
+                }
+            } catch (...) {
+                // Reported by the main thread, which would otherwise keep waiting for frames which are never begun.
+                {
+                    std::lock_guard lock(m_framePacingMutex);
+                    m_framePacingException = std::current_exception();
+                }
+                m_framePacingCondition.notify_all();
+            }
+        }
+
         void RenderFrame() {
             CHECK(m_session.Get() != XR_NULL_HANDLE);
 
-            XrFrameWaitInfo frameWaitInfo{XR_TYPE_FRAME_WAIT_INFO};
-            XrFrameState frameState{XR_TYPE_FRAME_STATE};
-            CHECK_XRCMD(xrWaitFrame(m_session.Get(), &frameWaitInfo, &frameState));
+            // A frame pacing thread which stopped on an error is started again, the error was reported by the previous frame.
+            if (!m_framePacingThread.joinable()) {
+                StartFramePacing();
+            }
+
+            XrFrameState frameState;
+            std::exception_ptr framePacingException;
+            {
+                // Do not block the main loop for long, so that events are still processed if the runtime stops pacing frames.
+                using namespace std::chrono_literals;
+                std::unique_lock lock(m_framePacingMutex);
+                if (!m_framePacingCondition.wait_for(
+                        lock, 100ms, [this]() { return m_begunFrameState.has_value() || m_framePacingException != nullptr; })) {
+                    return;
+                }
 
-            XrFrameBeginInfo frameBeginInfo{XR_TYPE_FRAME_BEGIN_INFO};
-            CHECK_XRCMD(xrBeginFrame(m_session.Get(), &frameBeginInfo));
+                if (m_begunFrameState.has_value()) {
+                    frameState = m_begunFrameState.value();
+                    m_begunFrameState.reset();
+                } else {
+                    framePacingException = std::exchange(m_framePacingException, nullptr);
+                }
+            }
 
+            // The frame pacing thread has exited. Any frame it began is ended before the error is thrown on this thread.
+            if (framePacingException) {
+                StopFramePacing();
+                std::rethrow_exception(framePacingException);
+            }
+
+            try {
+                SubmitFrame(frameState);
+            } catch (...) {
+                FinishFrame();
+                throw;
+            }
+            FinishFrame();
+        }
+
+        // Allows the frame pacing thread to begin the next frame.
+        void FinishFrame() {
+            {
+                std::lock_guard lock(m_framePacingMutex);
+                m_frameInProgress = false;
+            }
+            m_framePacingCondition.notify_all();
+        }
+
+        void SubmitFrame(const XrFrameState& frameState) {
             // xrEndFrame can submit multiple layers. This sample submits one.
-            std::vector<XrCompositionLayerBaseHeader*> layers;
+            std::array<XrCompositionLayerBaseHeader*, 1> layers;
+            uint32_t layerCount = 0;
 
             // The projection layer consists of projection layer views.
             XrCompositionLayerProjection layer{XR_TYPE_COMPOSITION_LAYER_PROJECTION};
@@ -1126,9 +1393,11 @@ namespace {
                     CHECK(viewCountOutput == m_renderResources->DepthSwapchain.ArraySize);
                 }
 
+                UpdateRenderScale(frameState.predictedDisplayPeriod);
+
                 // Then, render projection layer into each view.
                 if (RenderLayer(frameState.predictedDisplayTime, layer)) {
-                    layers.push_back(reinterpret_cast<XrCompositionLayerBaseHeader*>(&layer));
+                    layers[layerCount++] = reinterpret_cast<XrCompositionLayerBaseHeader*>(&layer);
                 }
             }
 
@@ -1136,10 +1405,13 @@ namespace {
             XrFrameEndInfo frameEndInfo{XR_TYPE_FRAME_END_INFO};
             frameEndInfo.displayTime = frameState.predictedDisplayTime;
             frameEndInfo.environmentBlendMode = m_environmentBlendMode;
-            frameEndInfo.layerCount = (uint32_t)layers.size();
+            frameEndInfo.layerCount = layerCount;
             frameEndInfo.layers = layers.data();
 
 #if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+            // Frames which are not mirrored skip both the mirror copy and the present of the window.
+            const bool mirrorFrame = ShouldMirrorFrame();
+
             XrRemotingFrameMirrorImageD3D11MSFT mirrorImageD3D11{
                 static_cast<XrStructureType>(XR_TYPE_REMOTING_FRAME_MIRROR_IMAGE_D3D11_MSFT)};
             mirrorImageD3D11.texture = m_window->GetNextSwapchainTexture();
@@ -1148,13 +1420,51 @@ namespace {
                 static_cast<XrStructureType>(XR_TYPE_REMOTING_FRAME_MIRROR_IMAGE_INFO_MSFT)};
             mirrorImageEndInfo.image = reinterpret_cast<const XrRemotingFrameMirrorImageBaseHeaderMSFT*>(&mirrorImageD3D11);
 
-            frameEndInfo.next = &mirrorImageEndInfo;
+            if (mirrorFrame) {
+                frameEndInfo.next = &mirrorImageEndInfo;
+            }
 #endif
 
             CHECK_XRCMD(xrEndFrame(m_session.Get(), &frameEndInfo));
 
 #if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
-            m_window->PresentSwapchain();
+            if (mirrorFrame) {
+                m_window->PresentSwapchain();
+            }
+#endif
+        }
+
+        bool ShouldMirrorFrame() {
+            switch (m_mirrorMode) {
+            case sample::MirrorMode::Off:
+                return false;
+            case sample::MirrorMode::Throttled:
+                return m_mirrorFrameIndex++ % m_options.mirrorInterval == 0;
+            default:
+                return true;
+            }
+        }
+
+        void SetMirrorMode(sample::MirrorMode mode) {
+#if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
+            const bool downscaled = mode == sample::MirrorMode::Downscaled;
+            if (downscaled != (m_mirrorMode == sample::MirrorMode::Downscaled)) {
+                // The cached view of the window texture has to be released before the window swapchain can be resized.
+                // The views of the headset swapchain images are released as well and are recreated on their next use.
+                m_graphicsPlugin->ReleaseSwapchainImageViews();
+                m_window->SetSwapchainScale(downscaled ? 0.5f : 1.0f);
+            }
+
+            m_mirrorMode = mode;
+            m_mirrorFrameIndex = 0;
+
+            if (mode == sample::MirrorMode::Off) {
+                // Don't leave the last mirrored frame frozen in the window.
+                m_graphicsPlugin->ClearView(m_window->GetNextSwapchainTexture(), clearColor);
+                m_window->PresentSwapchain();
+            }
+
+            UpdateWindowTitleWin32();
 #endif
         }
 
@@ -1232,56 +1542,396 @@ namespace {
             }
         }
 
-        bool RenderLayer(XrTime predictedDisplayTime, XrCompositionLayerProjection& layer) {
-            const uint32_t viewCount = (uint32_t)m_renderResources->ConfigViews.size();
+        // Places a cube of the stress test anew, with a new rotation.
+        void SpawnStressCube(uint32_t index) {
+            std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+            StressCube& cube = m_stressCubes[index];
+
+            switch (m_options.stressDistribution) {
+            case sample::StressDistribution::Grid: {
+                // The grid fills up layer by layer from the front, one meter in front of the user. A respawned cube keeps its slot.
+                const uint32_t side = (uint32_t)std::ceil(std::cbrt((float)m_stressCubes.size()));
+                const float offset = 0.5f * (side - 1) * StressGridSpacing;
+                const uint32_t x = index % side;
+                const uint32_t y = (index / side) % side;
+                const uint32_t z = index / (side * side);
+                cube.Position = {x * StressGridSpacing - offset, y * StressGridSpacing - offset, -1.0f - z * StressGridSpacing};
+                break;
+            }
+            case sample::StressDistribution::Sphere: {
+                // Uniformly distributed directions, three meters around the user.
+                const float z = 2.0f * unit(m_stressRandom) - 1.0f;
+                const float angle = DirectX::XM_2PI * unit(m_stressRandom);
+                const float r = std::sqrt(1.0f - z * z);
+                cube.Position = {3.0f * r * std::cos(angle), 3.0f * r * std::sin(angle), 3.0f * z};
+                break;
+            }
+            case sample::StressDistribution::Random:
+                cube.Position = {
+                    4.0f * unit(m_stressRandom) - 2.0f, 2.0f * unit(m_stressRandom) - 1.0f, -1.0f - 4.0f * unit(m_stressRandom)};
+                break;
+            }
 
-            if (!xr::math::Pose::IsPoseValid(m_renderResources->ViewState)) {
-                DEBUG_PRINT("xrLocateViews returned an invalid pose.");
-                return false; // Skip rendering layers if view location is invalid
+            cube.RotationAxis = xr::math::Normalize(
+                XrVector3f{unit(m_stressRandom) - 0.5f, unit(m_stressRandom) - 0.5f + 0.01f, unit(m_stressRandom) - 0.5f});
+            cube.RadiansPerSecond = DirectX::XM_PI * (0.25f + 1.75f * unit(m_stressRandom));
+            cube.Phase = DirectX::XM_2PI * unit(m_stressRandom);
+
+            if (index < m_stressActiveCount) {
+                IndexStressCube(index);
+            }
+        }
+
+        // The cubes only rotate in place, so the index only changes when a cube is respawned or activated.
+        void IndexStressCube(uint32_t index) {
+            const XrVector3f& position = m_stressCubes[index].Position;
+            m_stressCubeIndex.Update(index, {{position.x, position.y, position.z}, 0.5f * xr::math::Length(StressCubeScale)});
+        }
+
+        // Animates the cubes of the stress test and respawns the share of them the churn asks for. The number of cubes starts at
+        // StressMinCubeCount and doubles every stressStepSeconds until it reaches stressCubeCount. The frame time, the GPU time,
+        // the draw calls and the bitrate of every step are logged, to see where rendering stops scaling with the content.
+        void UpdateStressCubes(XrTime predictedDisplayTime) {
+            if (m_options.stressCubeCount == 0) {
+                return;
+            }
+
+            if (m_stressCubeSpace.Get() == XR_NULL_HANDLE) {
+                XrReferenceSpaceCreateInfo createInfo{XR_TYPE_REFERENCE_SPACE_CREATE_INFO};
+                createInfo.referenceSpaceType = XR_REFERENCE_SPACE_TYPE_LOCAL;
+                createInfo.poseInReferenceSpace = xr::math::Pose::Identity();
+                CHECK_XRCMD(xrCreateReferenceSpace(m_session.Get(), &createInfo, m_stressCubeSpace.Put()));
+
+                m_stressCubes.resize(std::clamp(m_options.stressCubeCount, StressMinCubeCount, StressMaxCubeCount));
+                for (uint32_t i = 0; i < (uint32_t)m_stressCubes.size(); i++) {
+                    SpawnStressCube(i);
+                }
+                m_stressActiveCount = std::min(StressMinCubeCount, (uint32_t)m_stressCubes.size());
+                for (uint32_t i = 0; i < m_stressActiveCount; i++) {
+                    IndexStressCube(i);
+                }
+                m_stressStep = {std::chrono::steady_clock::now()};
+                m_stressCubeTime = predictedDisplayTime;
+            }
+
+            const float elapsedSeconds = (predictedDisplayTime - m_stressCubeTime) * 1e-9f;
+            const float totalSeconds = (predictedDisplayTime - m_spinningCubeStartTime) * 1e-9f;
+            m_stressCubeTime = predictedDisplayTime;
+
+            // Cubes are respawned round robin, so every cube moves once before any cube moves twice.
+            const float churn = m_options.stressChurnPerSecond * m_stressActiveCount * elapsedSeconds;
+            m_stressChurnDebt = std::min(m_stressChurnDebt + churn, (float)m_stressActiveCount);
+            while (m_stressChurnDebt >= 1.0f) {
+                SpawnStressCube(m_stressNextRespawn);
+                m_stressNextRespawn = (m_stressNextRespawn + 1) % m_stressActiveCount;
+                m_stressChurnDebt -= 1.0f;
+            }
+
+            for (uint32_t i = 0; i < m_stressActiveCount; i++) {
+                StressCube& cube = m_stressCubes[i];
+                const float angle = std::fmod(cube.Phase + totalSeconds * cube.RadiansPerSecond, DirectX::XM_2PI);
+                cube.PoseInSpace = {xr::math::Quaternion::RotationAxisAngle(cube.RotationAxis, angle), cube.Position};
             }
 
-            std::vector<const sample::Cube*> visibleCubes;
+            m_stressStep.FrameCount++;
+            const auto now = std::chrono::steady_clock::now();
+            const std::chrono::duration<float, std::milli> stepDuration = now - m_stressStep.Start;
+            if (stepDuration < std::chrono::seconds(m_options.stressStepSeconds)) {
+                return;
+            }
 
-            auto UpdateVisibleCube = [&](sample::Cube& cube) {
+            // The cubes are drawn with one instanced draw call per frame, so the draw calls do not grow with the cubes. The remoting
+            // runtime does not report the size of the encoded frames, the bitrate is the one the stream is configured with.
+            const float frameCount = (float)m_stressStep.FrameCount;
+            DEBUG_PRINT("Stress test: %u cubes, %.2f ms per frame, GPU %.2f ms, %.0f cubes drawn per frame in 1 draw call, %u kbps.",
+                        m_stressActiveCount,
+                        stepDuration.count() / frameCount,
+                        m_stressStep.GpuFrameTimeCount > 0 ? 1000.0f * m_stressStep.GpuFrameTimeSum / m_stressStep.GpuFrameTimeCount : 0.0f,
+                        m_stressStep.DrawnCubeCount / frameCount,
+                        m_bitrateController.GetBitrateKbps());
+
+            // The last step repeats with all cubes.
+            if (m_stressActiveCount < (uint32_t)m_stressCubes.size()) {
+                const uint32_t previousActiveCount = m_stressActiveCount;
+                m_stressActiveCount = std::min(2 * m_stressActiveCount, (uint32_t)m_stressCubes.size());
+                for (uint32_t i = previousActiveCount; i < m_stressActiveCount; i++) {
+                    IndexStressCube(i);
+                }
+                m_stressNextRespawn = 0;
+                m_stressChurnDebt = 0.0f;
+            }
+            m_stressStep = {now};
+        }
+
+        // Scales the rendered part of the swapchain images, so that the GPU time stays within the display period. The scale
+        // drops when the average GPU time of a window of frames gets close to the display period and slowly grows back while
+        // there is headroom. It never exceeds m_maxRenderScale, which is lowered when the player reports a congested stream,
+        // as encoding cost and bandwidth grow with the number of pixels.
+        void UpdateRenderScale(XrDuration predictedDisplayPeriod) {
+            constexpr uint32_t framesPerWindow = 8;
+            constexpr uint32_t headroomWindowsBeforeIncrease = 4;
+            constexpr float overBudgetFraction = 0.9f;
+            constexpr float headroomFraction = 0.7f;
+
+            while (const std::optional<float> gpuFrameTime = m_graphicsPlugin->TryGetGpuFrameTime()) {
+                m_gpuFrameTimeSum += gpuFrameTime.value();
+                m_gpuFrameTimeCount++;
+                m_stressStep.GpuFrameTimeSum += gpuFrameTime.value();
+                m_stressStep.GpuFrameTimeCount++;
+            }
+
+            const float displayPeriod = predictedDisplayPeriod * 1e-9f;
+            if (m_gpuFrameTimeCount >= framesPerWindow && displayPeriod > 0.0f) {
+                const float averageGpuFrameTime = m_gpuFrameTimeSum / m_gpuFrameTimeCount;
+                m_gpuFrameTimeSum = 0.0f;
+                m_gpuFrameTimeCount = 0;
+
+                if (averageGpuFrameTime > overBudgetFraction * displayPeriod) {
+                    m_headroomWindowCount = 0;
+                    m_renderScale = std::max(m_renderScale * 0.9f, MinRenderScale);
+                } else if (averageGpuFrameTime < headroomFraction * displayPeriod) {
+                    if (++m_headroomWindowCount >= headroomWindowsBeforeIncrease) {
+                        m_headroomWindowCount = 0;
+                        m_renderScale = std::min(m_renderScale * 1.05f, 1.0f);
+                    }
+                } else {
+                    m_headroomWindowCount = 0;
+                }
+            }
+
+            m_renderScale = std::min(m_renderScale, m_maxRenderScale);
+        }
+
+        // Locates the spaces of all cubes at once and collects the visible ones in m_renderResources->VisibleCubes.
+        // Uses xrLocateSpacesKHR when XR_KHR_locate_spaces is available. Otherwise the spaces are located one by one,
+        // spread over several threads once there are enough of them.
+        void LocateCubes(XrTime predictedDisplayTime) {
+            constexpr size_t parallelLocateThreshold = 64;
+
+            std::vector<sample::Cube*>& cubes = m_renderResources->LocatedCubes;
+            std::vector<XrSpace>& spaces = m_renderResources->CubeSpaces;
+            std::vector<XrSpaceLocation>& locations = m_renderResources->CubeSpaceLocations;
+            sample::CubeBatch& visibleCubes = m_renderResources->VisibleCubes;
+
+            // The storage is reused across frames. It only grows when holograms are added, so the steady state frame loop
+            // does not allocate.
+            const size_t cubeCount = std::size(m_cubesInHand) + m_holograms.size() + m_stressActiveCount;
+            if (cubes.capacity() < cubeCount) {
+                cubes.reserve(cubeCount);
+                spaces.reserve(cubeCount);
+                locations.reserve(cubeCount);
+                visibleCubes.Reserve(cubeCount);
+
+                m_renderResources->FrameStorageAllocationCount++;
+                DEBUG_PRINT("Frame storage allocation %u: room for %zu cubes.", m_renderResources->FrameStorageAllocationCount, cubeCount);
+            }
+
+            cubes.clear();
+            spaces.clear();
+            visibleCubes.Clear();
+
+            auto AddCube = [&](sample::Cube& cube) {
                 if (cube.Space.Get() != XR_NULL_HANDLE) {
-                    XrSpaceLocation cubeSpaceInAppSpace{XR_TYPE_SPACE_LOCATION};
-                    CHECK_XRCMD(xrLocateSpace(cube.Space.Get(), m_appSpace.Get(), predictedDisplayTime, &cubeSpaceInAppSpace));
+                    cubes.push_back(&cube);
+                    spaces.push_back(cube.Space.Get());
+                }
+            };
 
-                    // Update cube's location with latest space location
-                    if (xr::math::Pose::IsPoseValid(cubeSpaceInAppSpace)) {
-                        if (cube.PoseInSpace.has_value()) {
-                            cube.PoseInAppSpace = xr::math::Pose::Multiply(cube.PoseInSpace.value(), cubeSpaceInAppSpace.pose);
-                        } else {
-                            cube.PoseInAppSpace = cubeSpaceInAppSpace.pose;
-                        }
-                        visibleCubes.push_back(&cube);
+            AddCube(m_cubesInHand[LeftSide]);
+            AddCube(m_cubesInHand[RightSide]);
+            for (auto& hologram : m_holograms) {
+                AddCube(hologram.Cube);
+            }
+
+            if (spaces.empty()) {
+                return;
+            }
+
+            locations.resize(spaces.size(), {XR_TYPE_SPACE_LOCATION});
+
+#if XR_KHR_locate_spaces
+            if (m_optionalExtensions.LocateSpacesSupported) {
+                std::vector<XrSpaceLocationDataKHR>& locationData = m_renderResources->CubeSpaceLocationData;
+                locationData.resize(spaces.size());
+
+                XrSpacesLocateInfoKHR locateInfo{XR_TYPE_SPACES_LOCATE_INFO_KHR};
+                locateInfo.baseSpace = m_appSpace.Get();
+                locateInfo.time = predictedDisplayTime;
+                locateInfo.spaceCount = (uint32_t)spaces.size();
+                locateInfo.spaces = spaces.data();
+
+                XrSpaceLocationsKHR spaceLocations{XR_TYPE_SPACE_LOCATIONS_KHR};
+                spaceLocations.locationCount = (uint32_t)locationData.size();
+                spaceLocations.locations = locationData.data();
+                CHECK_XRCMD(m_extensions.xrLocateSpacesKHR(m_session.Get(), &locateInfo, &spaceLocations));
+
+                for (size_t i = 0; i < locationData.size(); i++) {
+                    locations[i].locationFlags = locationData[i].locationFlags;
+                    locations[i].pose = locationData[i].pose;
+                }
+            } else
+#endif
+            {
+                // xrLocateSpace may be called concurrently for different spaces.
+                std::atomic<XrResult> locateResult{XR_SUCCESS};
+                auto Locate = [&](XrSpaceLocation& location) {
+                    const size_t i = static_cast<size_t>(&location - locations.data());
+                    const XrResult result = xrLocateSpace(spaces[i], m_appSpace.Get(), predictedDisplayTime, &location);
+                    if (XR_FAILED(result)) {
+                        locateResult = result;
+                    }
+                };
+
+                if (locations.size() >= parallelLocateThreshold) {
+                    std::for_each(std::execution::par, locations.begin(), locations.end(), Locate);
+                } else {
+                    std::for_each(locations.begin(), locations.end(), Locate);
+                }
+                CHECK_XRCMD(locateResult.load());
+            }
+
+            for (size_t i = 0; i < cubes.size(); i++) {
+                sample::Cube& cube = *cubes[i];
+
+                // Update cube color
+                cube.colorFilter = m_cubeColorFilter;
+
+                // Update cube's location with latest space location
+                if (xr::math::Pose::IsPoseValid(locations[i])) {
+                    if (cube.PoseInSpace.has_value()) {
+                        cube.PoseInAppSpace = xr::math::Pose::Multiply(cube.PoseInSpace.value(), locations[i].pose);
+                    } else {
+                        cube.PoseInAppSpace = locations[i].pose;
                     }
+                    visibleCubes.Add(cube);
+                }
+            }
 
-                    // Update cube color
-                    cube.colorFilter = m_cubeColorFilter;
+            // The stress test cubes share a single space, which is located once for all of them. Only the cubes in front of the
+            // views are drawn.
+            if (m_stressActiveCount > 0) {
+                XrSpaceLocation location{XR_TYPE_SPACE_LOCATION};
+                CHECK_XRCMD(xrLocateSpace(m_stressCubeSpace.Get(), m_appSpace.Get(), predictedDisplayTime, &location));
+                if (xr::math::Pose::IsPoseValid(location)) {
+                    CullStressCubes(location.pose);
+                    for (SpatialIndex::ObjectId i : m_visibleStressCubes) {
+                        visibleCubes.Add(
+                            xr::math::Pose::Multiply(m_stressCubes[i].PoseInSpace, location.pose), StressCubeScale, m_cubeColorFilter);
+                    }
+                    m_stressStep.DrawnCubeCount += m_visibleStressCubes.size();
                 }
+            }
+        }
+
+        // Collects the stress test cubes inside of any view into m_visibleStressCubes. The views are culled in the space of the
+        // cubes, so the index of the cubes does not change with the head pose. The other holograms are not indexed. Each of them
+        // has a space of its own, which has to be located every frame anyway before its pose is known.
+        void CullStressCubes(const XrPosef& stressCubeSpacePose) {
+            m_visibleStressCubes.clear();
+
+            const float nearZ = std::min(m_nearFar.Near, m_nearFar.Far);
+            const float farZ = std::max(m_nearFar.Near, m_nearFar.Far);
+            const DirectX::XMMATRIX cubeToApp = xr::math::LoadXrPose(stressCubeSpacePose);
+            for (const XrView& view : m_renderResources->Views) {
+                const DirectX::XMMATRIX cubeToView = DirectX::XMMatrixMultiply(cubeToApp, xr::math::LoadInvertedXrPose(view.pose));
+                m_stressCubeIndex.QueryFrustum(GetViewFrustum(view.fov, nearZ, farZ, cubeToView), m_visibleStressCubes);
+            }
+
+            // Cubes in front of both views are only drawn once.
+            if (m_renderResources->Views.size() > 1) {
+                std::sort(m_visibleStressCubes.begin(), m_visibleStressCubes.end());
+                m_visibleStressCubes.erase(
+                    std::unique(m_visibleStressCubes.begin(), m_visibleStressCubes.end()), m_visibleStressCubes.end());
+            }
+        }
+
+        // Returns the frustum of a view in the space whose points toView transforms into the view.
+        static FrustumCulling::FrustumPlanes GetViewFrustum(const XrFovf& fov, float nearZ, float farZ, const DirectX::XMMATRIX& toView) {
+            // Views look down the negative z axis, the plane normals point out of the frustum.
+            const DirectX::XMVECTOR viewPlanes[] = {
+                DirectX::XMVectorSet(0.0f, 0.0f, 1.0f, nearZ),
+                DirectX::XMVectorSet(0.0f, 0.0f, -1.0f, -farZ),
+                DirectX::XMPlaneNormalize(DirectX::XMVectorSet(-1.0f, 0.0f, -std::tan(fov.angleLeft), 0.0f)),
+                DirectX::XMPlaneNormalize(DirectX::XMVectorSet(1.0f, 0.0f, std::tan(fov.angleRight), 0.0f)),
+                DirectX::XMPlaneNormalize(DirectX::XMVectorSet(0.0f, 1.0f, std::tan(fov.angleUp), 0.0f)),
+                DirectX::XMPlaneNormalize(DirectX::XMVectorSet(0.0f, -1.0f, -std::tan(fov.angleDown), 0.0f)),
             };
 
-            UpdateSpinningCube(predictedDisplayTime);
+            // Planes are transformed by the inverse transpose of the transform of the points into their space.
+            const DirectX::XMMATRIX planeTransform = DirectX::XMMatrixTranspose(toView);
+            winrt::Windows::Foundation::Numerics::plane planes[std::size(viewPlanes)];
+            for (size_t i = 0; i < std::size(viewPlanes); i++) {
+                DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*>(&planes[i]),
+                                       DirectX::XMPlaneTransform(viewPlanes[i], planeTransform));
+            }
 
-            UpdateVisibleCube(m_cubesInHand[LeftSide]);
-            UpdateVisibleCube(m_cubesInHand[RightSide]);
+            winrt::Windows::Perception::Spatial::SpatialBoundingFrustum frustum;
+            frustum.Near = planes[0];
+            frustum.Far = planes[1];
+            frustum.Left = planes[2];
+            frustum.Right = planes[3];
+            frustum.Top = planes[4];
+            frustum.Bottom = planes[5];
+            return FrustumCulling::FrustumPlanes(frustum);
+        }
 
-            for (auto& hologram : m_holograms) {
-                UpdateVisibleCube(hologram.Cube);
+        // Fits the depth range tightly around the visible cubes, so that the depth buffer precision is spent where the content is.
+        // This improves the depth based reprojection and lets the depth buffer compress better when it is streamed at reduced
+        // resolution. The default range m_nearFar is used if no cube is in front of the views.
+        xr::math::NearFar ComputeContentNearFar() const {
+            // Keeps the content inside the range when the frame is reprojected to a slightly different head pose.
+            constexpr float margin = 0.1f;
+
+            const sample::CubeBatch& cubes = m_renderResources->VisibleCubes;
+            float minDepth = std::numeric_limits<float>::max();
+            float maxDepth = 0.0f;
+            for (const XrView& view : m_renderResources->Views) {
+                const DirectX::XMMATRIX appToView = xr::math::LoadInvertedXrPose(view.pose);
+                for (size_t i = 0; i < cubes.Size(); i++) {
+                    // Views look down the negative z axis. The cube meshes are unit cubes scaled by the cube's scale.
+                    const DirectX::XMVECTOR center =
+                        DirectX::XMVector3Transform(xr::math::LoadXrVector3(cubes.PosesInAppSpace[i].position), appToView);
+                    const float depth = -DirectX::XMVectorGetZ(center);
+                    const float radius = 0.5f * xr::math::Length(cubes.Scales[i]);
+                    if (depth + radius > 0) {
+                        minDepth = std::min(minDepth, depth - radius);
+                        maxDepth = std::max(maxDepth, depth + radius);
+                    }
+                }
             }
 
-            m_renderResources->ProjectionLayerViews.resize(viewCount);
-            if (m_optionalExtensions.DepthExtensionSupported) {
-                m_renderResources->DepthInfoViews.resize(viewCount);
+            if (maxDepth == 0) {
+                return m_nearFar;
             }
 
+            const bool reversedZ = m_nearFar.Near > m_nearFar.Far;
+            const float defaultNear = reversedZ ? m_nearFar.Far : m_nearFar.Near;
+            const float defaultFar = reversedZ ? m_nearFar.Near : m_nearFar.Far;
+            const float nearZ = std::clamp(minDepth - margin, defaultNear, defaultFar - margin);
+            const float farZ = std::clamp(maxDepth + margin, nearZ + margin, defaultFar);
+            return reversedZ ? xr::math::NearFar{farZ, nearZ} : xr::math::NearFar{nearZ, farZ};
+        }
+
+        bool RenderLayer(XrTime predictedDisplayTime, XrCompositionLayerProjection& layer) {
+            const uint32_t viewCount = (uint32_t)m_renderResources->ConfigViews.size();
+
+            if (!xr::math::Pose::IsPoseValid(m_renderResources->ViewState)) {
+                DEBUG_PRINT("xrLocateViews returned an invalid pose.");
+                return false; // Skip rendering layers if view location is invalid
+            }
+
+            UpdateSpinningCube(predictedDisplayTime);
+            UpdateStressCubes(predictedDisplayTime);
+            LocateCubes(predictedDisplayTime);
+
             // Swapchain is acquired, rendered to, and released together for all views as texture array
             const SwapchainD3D11& colorSwapchain = m_renderResources->ColorSwapchain;
             const SwapchainD3D11& depthSwapchain = m_renderResources->DepthSwapchain;
 
-            // Use the full size of the allocated swapchain image (could render smaller some frames to hit framerate)
-            const XrRect2Di imageRect = {{0, 0}, {(int32_t)colorSwapchain.Width, (int32_t)colorSwapchain.Height}};
+            // Render to the part of the swapchain images selected by the dynamic resolution, see UpdateRenderScale.
+            const XrRect2Di imageRect = {{0, 0},
+                                         {std::max(1, (int32_t)(colorSwapchain.Width * m_renderScale + 0.5f)),
+                                          std::max(1, (int32_t)(colorSwapchain.Height * m_renderScale + 0.5f))}};
             CHECK(colorSwapchain.Width == depthSwapchain.Width);
             CHECK(colorSwapchain.Height == depthSwapchain.Height);
 
@@ -1289,9 +1939,10 @@ namespace {
             const uint32_t depthSwapchainImageIndex = AcquireAndWaitForSwapchainImage(depthSwapchain.Handle.Get());
 
             // Prepare rendering parameters of each view for swapchain texture arrays
-            std::vector<xr::math::ViewProjection> viewProjections(viewCount);
+            const xr::math::NearFar nearFar = m_options.tightDepthRange ? ComputeContentNearFar() : m_nearFar;
+            std::vector<xr::math::ViewProjection>& viewProjections = m_renderResources->ViewProjections;
             for (uint32_t i = 0; i < viewCount; i++) {
-                viewProjections[i] = {m_renderResources->Views[i].pose, m_renderResources->Views[i].fov, m_nearFar};
+                viewProjections[i] = {m_renderResources->Views[i].pose, m_renderResources->Views[i].fov, nearFar};
 
                 m_renderResources->ProjectionLayerViews[i] = {XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW};
                 m_renderResources->ProjectionLayerViews[i].pose = m_renderResources->Views[i].pose;
@@ -1304,8 +1955,8 @@ namespace {
                     m_renderResources->DepthInfoViews[i] = {XR_TYPE_COMPOSITION_LAYER_DEPTH_INFO_KHR};
                     m_renderResources->DepthInfoViews[i].minDepth = 0;
                     m_renderResources->DepthInfoViews[i].maxDepth = 1;
-                    m_renderResources->DepthInfoViews[i].nearZ = m_nearFar.Near;
-                    m_renderResources->DepthInfoViews[i].farZ = m_nearFar.Far;
+                    m_renderResources->DepthInfoViews[i].nearZ = nearFar.Near;
+                    m_renderResources->DepthInfoViews[i].farZ = nearFar.Far;
                     m_renderResources->DepthInfoViews[i].subImage.swapchain = depthSwapchain.Handle.Get();
                     m_renderResources->DepthInfoViews[i].subImage.imageRect = imageRect;
                     m_renderResources->DepthInfoViews[i].subImage.imageArrayIndex = i;
@@ -1328,7 +1979,7 @@ namespace {
                                          colorSwapchain.Images[colorSwapchainImageIndex].texture,
                                          depthSwapchain.Format,
                                          depthSwapchain.Images[depthSwapchainImageIndex].texture,
-                                         visibleCubes);
+                                         m_renderResources->VisibleCubes);
 
             XrSwapchainImageReleaseInfo releaseInfo{XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO};
             CHECK_XRCMD(xrReleaseSwapchainImage(colorSwapchain.Handle.Get(), &releaseInfo));
@@ -1341,8 +1992,14 @@ namespace {
         }
 
         void PrepareSessionRestart() {
+            StopFramePacing();
             m_mainCubeIndex = m_spinningCubeIndex = {};
             m_holograms.clear();
+            m_stressCubeSpace.Reset();
+            m_stressCubes.clear();
+            m_stressCubeIndex.Clear();
+            m_stressActiveCount = 0;
+            m_graphicsPlugin->ReleaseSwapchainImageViews();
             m_renderResources.reset();
             m_appSpace.Reset();
             m_cubesInHand[LeftSide].Space.Reset();
@@ -1369,6 +2026,9 @@ namespace {
         void CreateWindowWin32() {
 #if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
             m_window = std::make_unique<sample::SampleWindowWin32>(xr::utf8_to_wide(m_applicationName), m_device, 768, 512);
+            if (m_mirrorMode == sample::MirrorMode::Downscaled) {
+                m_window->SetSwapchainScale(0.5f);
+            }
             m_window->SetKeyPressedHandler([&](wchar_t key) {
                 std::scoped_lock lock{m_keyPressedMutex};
                 m_keyPressedQueue.push(towlower(key));
@@ -1414,6 +2074,48 @@ namespace {
                         break;
                     }
 #endif
+                    case 'p': {
+                        // Cycle through the stream profiles, custom settings continue with the first one.
+                        sample::StreamProfile profile = sample::StreamProfile::Lan;
+                        if (m_streamProfile == sample::StreamProfile::Lan) {
+                            profile = sample::StreamProfile::WiFi;
+                        } else if (m_streamProfile == sample::StreamProfile::WiFi) {
+                            profile = sample::StreamProfile::Cellular;
+                        }
+                        ApplyStreamSettings(profile, sample::GetStreamProfileSettings(profile));
+                        break;
+                    }
+                    case 'c': {
+                        sample::StreamSettings settings = m_streamSettings;
+                        settings.videoCodec = settings.videoCodec == XR_REMOTING_VIDEO_CODEC_H265_MSFT ? XR_REMOTING_VIDEO_CODEC_H264_MSFT
+                                                                                                       : XR_REMOTING_VIDEO_CODEC_H265_MSFT;
+                        ApplyStreamSettings(sample::StreamProfile::Custom, settings);
+                        break;
+                    }
+                    case 'a': {
+                        sample::StreamSettings settings = m_streamSettings;
+                        settings.enableAudio = !settings.enableAudio;
+                        ApplyStreamSettings(sample::StreamProfile::Custom, settings);
+                        break;
+                    }
+                    case 'm': {
+                        // Cycle through the mirror modes.
+                        switch (m_mirrorMode) {
+                        case sample::MirrorMode::Full:
+                            SetMirrorMode(sample::MirrorMode::Throttled);
+                            break;
+                        case sample::MirrorMode::Throttled:
+                            SetMirrorMode(sample::MirrorMode::Downscaled);
+                            break;
+                        case sample::MirrorMode::Downscaled:
+                            SetMirrorMode(sample::MirrorMode::Off);
+                            break;
+                        case sample::MirrorMode::Off:
+                            SetMirrorMode(sample::MirrorMode::Full);
+                            break;
+                        }
+                        break;
+                    }
                     case 'd': {
                         if (m_sessionRunning && m_usingRemotingRuntime) {
 #ifdef ENABLE_CUSTOM_DATA_CHANNEL_SAMPLE
@@ -1442,6 +2144,11 @@ namespace {
 #if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
             std::string title = m_sessionRunning ? m_applicationName + " | Press D to Disconnect"
                                                  : m_applicationName + " | " + m_options.host + " | Press Space To Connect";
+            title += " | Stream: " + std::string(sample::GetStreamProfileName(m_streamProfile)) + ", " +
+                     std::to_string(m_streamSettings.maxBitrateKbps) + " kbps" +
+                     (m_streamSettings.videoCodec == XR_REMOTING_VIDEO_CODEC_H264_MSFT ? ", H264" : ", H265") +
+                     (m_streamSettings.enableAudio ? ", audio" : "") + " (P/C/A to change)";
+            title += " | Mirror: " + std::string(sample::GetMirrorModeName(m_mirrorMode)) + " (M to change)";
 
             m_window->SetWindowTitle(xr::utf8_to_wide(title));
 #endif
@@ -1466,6 +2173,7 @@ namespace {
             bool DepthExtensionSupported{false};
             bool UnboundedRefSpaceSupported{false};
             bool SpatialAnchorSupported{false};
+            bool LocateSpacesSupported{false};
         } m_optionalExtensions;
 
         XrViewConfigurationType m_primaryViewConfigType{XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO};
@@ -1483,6 +2191,37 @@ namespace {
         std::optional<uint32_t> m_spinningCubeIndex;
         XrTime m_spinningCubeStartTime;
 
+        // Stress test, see UpdateStressCubes. Only the first m_stressActiveCount cubes are animated and rendered.
+        static constexpr uint32_t StressMinCubeCount = 100;
+        static constexpr uint32_t StressMaxCubeCount = 100000;
+        static constexpr float StressGridSpacing = 0.1f;
+        static constexpr XrVector3f StressCubeScale{0.04f, 0.04f, 0.04f};
+        struct StressCube {
+            XrVector3f Position;
+            XrVector3f RotationAxis;
+            float RadiansPerSecond;
+            float Phase;
+            XrPosef PoseInSpace;
+        };
+        struct StressStep {
+            std::chrono::steady_clock::time_point Start;
+            uint32_t FrameCount{0};
+            uint64_t DrawnCubeCount{0};
+            float GpuFrameTimeSum{0.0f};
+            uint32_t GpuFrameTimeCount{0};
+        };
+        xr::SpaceHandle m_stressCubeSpace;
+        std::vector<StressCube> m_stressCubes;
+        uint32_t m_stressActiveCount{0};
+        uint32_t m_stressNextRespawn{0};
+        float m_stressChurnDebt{0.0f};
+        XrTime m_stressCubeTime{0};
+        StressStep m_stressStep;
+        std::mt19937 m_stressRandom;
+        // The active cubes by their position in m_stressCubeSpace, see CullStressCubes.
+        SpatialIndex m_stressCubeIndex;
+        std::vector<SpatialIndex::ObjectId> m_visibleStressCubes;
+
         constexpr static uint32_t LeftSide = 0;
         constexpr static uint32_t RightSide = 1;
         std::array<XrPath, 2> m_subactionPaths{};
@@ -1514,6 +2253,20 @@ namespace {
             SwapchainD3D11 DepthSwapchain;
             std::vector<XrCompositionLayerProjectionView> ProjectionLayerViews;
             std::vector<XrCompositionLayerDepthInfoKHR> DepthInfoViews;
+
+            // Storage used while rendering a frame. It is sized once in CreateSwapchains, or grows with the number of
+            // holograms, and is reused by all following frames.
+            std::vector<xr::math::ViewProjection> ViewProjections;
+            std::vector<sample::Cube*> LocatedCubes;
+            std::vector<XrSpace> CubeSpaces;
+            std::vector<XrSpaceLocation> CubeSpaceLocations;
+#if XR_KHR_locate_spaces
+            std::vector<XrSpaceLocationDataKHR> CubeSpaceLocationData;
+#endif
+            sample::CubeBatch VisibleCubes;
+
+            // Counts how often the frame storage had to be reallocated, which only happens while holograms are added.
+            uint32_t FrameStorageAllocationCount{0};
         };
 
         ID3D11Device* m_device = nullptr;
@@ -1522,6 +2275,20 @@ namespace {
         bool m_sessionRunning{false};
         XrSessionState m_sessionState{XR_SESSION_STATE_UNKNOWN};
 
+        // Frame pacing thread state, see StartFramePacing. m_frameInProgress is set between xrBeginFrame and xrEndFrame,
+        // m_begunFrameState holds a begun frame until the main thread picks it up.
+        std::thread m_framePacingThread;
+        std::mutex m_framePacingMutex;
+        std::condition_variable m_framePacingCondition;
+        bool m_stopFramePacing{false};
+        bool m_frameInProgress{false};
+        std::optional<XrFrameState> m_begunFrameState;
+        // Set when the frame pacing thread stopped on an error, rethrown by RenderFrame.
+        std::exception_ptr m_framePacingException;
+
+        sample::MirrorMode m_mirrorMode{m_options.mirrorMode};
+        uint32_t m_mirrorFrameIndex = 0;
+
 #if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
         std::unique_ptr<sample::SampleWindowWin32> m_window;
 
@@ -1532,7 +2299,26 @@ namespace {
         std::chrono::high_resolution_clock::time_point m_customDataChannelSendTime = std::chrono::high_resolution_clock::now();
         XrRemotingDataChannelMSFT m_userDataChannel;
         bool m_userDataChannelDestroyed = false;
+        sample::DataChannelSender m_userDataSender;
+        sample::DataChannelDispatcher m_userDataDispatcher;
+        sample::DataChannelReceiveBuffer m_userDataReceiveBuffer;
 #endif
+        // Dynamic resolution, see UpdateRenderScale.
+        static constexpr float MinRenderScale = 0.5f;
+        float m_renderScale = 1.0f;
+        float m_maxRenderScale = 1.0f;
+        float m_gpuFrameTimeSum = 0.0f;
+        uint32_t m_gpuFrameTimeCount = 0;
+        uint32_t m_headroomWindowCount = 0;
+
+        // Configured stream settings, initialized from the command line and changed with the P, C and A keys.
+        sample::StreamProfile m_streamProfile{m_options.streamProfile};
+        sample::StreamSettings m_streamSettings{m_options.streamSettings};
+
+        // Stream settings used for the next connection, adapted to the frame statistics reported by the player.
+        BitrateController m_bitrateController{m_streamSettings.maxBitrateKbps,
+                                              GetDepthDownscale(m_streamSettings.depthBufferStreamResolution)};
+        bool m_grammarFileLoaded = false;
         std::vector<uint8_t> m_grammarFileContent;
         std::vector<const char*> m_dictionaryEntries;
         XrVector3f m_cubeColorFilter{1, 1, 1};
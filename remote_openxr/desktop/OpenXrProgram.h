@@ -27,6 +27,43 @@ namespace sample {
         XrPosef PoseInAppSpace = xr::math::Pose::Identity(); // Cube pose in app space that gets updated every frame
     };
 
+    // The cubes to render in a frame, stored as one array per attribute.
+    struct CubeBatch {
+        std::vector<XrPosef> PosesInAppSpace;
+        std::vector<XrVector3f> Scales;
+        std::vector<XrVector3f> ColorFilters;
+
+        size_t Size() const {
+            return PosesInAppSpace.size();
+        }
+
+        size_t Capacity() const {
+            return PosesInAppSpace.capacity();
+        }
+
+        void Reserve(size_t count) {
+            PosesInAppSpace.reserve(count);
+            Scales.reserve(count);
+            ColorFilters.reserve(count);
+        }
+
+        void Clear() {
+            PosesInAppSpace.clear();
+            Scales.clear();
+            ColorFilters.clear();
+        }
+
+        void Add(const Cube& cube) {
+            Add(cube.PoseInAppSpace, cube.Scale, cube.colorFilter);
+        }
+
+        void Add(const XrPosef& poseInAppSpace, const XrVector3f& scale, const XrVector3f& colorFilter) {
+            PosesInAppSpace.push_back(poseInAppSpace);
+            Scales.push_back(scale);
+            ColorFilters.push_back(colorFilter);
+        }
+    };
+
     struct IOpenXrProgram {
         virtual ~IOpenXrProgram() = default;
         virtual void Run() = 0;
@@ -45,14 +82,26 @@ namespace sample {
         // Render to swapchain images using stereo image array
         virtual void RenderView(const XrRect2Di& imageRect,
                                 const float renderTargetClearColor[4],
-                                const std::vector<xr::math::ViewProjection>& viewProjections,
+                                winrt::array_view<const xr::math::ViewProjection> viewProjections,
                                 DXGI_FORMAT colorSwapchainFormat,
                                 ID3D11Texture2D* colorTexture,
                                 DXGI_FORMAT depthSwapchainFormat,
                                 ID3D11Texture2D* depthTexture,
-                                const std::vector<const sample::Cube*>& cubes) = 0;
+                                const sample::CubeBatch& cubes) = 0;
 
         virtual void ClearView(ID3D11Texture2D* colorTexture, const float renderTargetClearColor[4]) = 0;
+
+        // Returns the GPU time in seconds RenderView took for one of the previous frames, or std::nullopt if no new measurement
+        // is available. Measurements are read back a few frames later, so that reading them never stalls the CPU.
+        virtual std::optional<float> TryGetGpuFrameTime() = 0;
+
+        // Create the views of the images of a swapchain once after they have been enumerated, so that RenderView can reuse them
+        // every frame. The views are keyed by texture and stay alive until ReleaseSwapchainImageViews is called.
+        virtual void CreateRenderTargetViews(DXGI_FORMAT colorSwapchainFormat, const std::vector<XrSwapchainImageD3D11KHR>& images) = 0;
+        virtual void CreateDepthStencilViews(DXGI_FORMAT depthSwapchainFormat, const std::vector<XrSwapchainImageD3D11KHR>& images) = 0;
+
+        // Release the views of all swapchain images. Must be called before the swapchains are destroyed.
+        virtual void ReleaseSwapchainImageViews() = 0;
     };
 
     std::unique_ptr<IGraphicsPluginD3D11> CreateCubeGraphics();
@@ -31,14 +31,90 @@ namespace {
             return address;
         }
     }
+
+    bool TryParseStreamProfile(std::string name, sample::StreamProfile& profile) {
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+        for (sample::StreamProfile candidate : {sample::StreamProfile::Lan, sample::StreamProfile::WiFi, sample::StreamProfile::Cellular}) {
+            if (name == sample::GetStreamProfileName(candidate)) {
+                profile = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
 } // namespace
 
 namespace sample {
 
+    StreamSettings GetStreamProfileSettings(StreamProfile profile) {
+        StreamSettings settings;
+        switch (profile) {
+        case StreamProfile::Lan:
+            settings.maxBitrateKbps = 20000;
+            settings.depthBufferStreamResolution = XR_REMOTING_DEPTH_BUFFER_STREAM_RESOLUTION_FULL_MSFT;
+            break;
+        case StreamProfile::WiFi:
+            settings.maxBitrateKbps = 12000;
+            settings.depthBufferStreamResolution = XR_REMOTING_DEPTH_BUFFER_STREAM_RESOLUTION_HALF_MSFT;
+            break;
+        case StreamProfile::Cellular:
+            settings.maxBitrateKbps = 4000;
+            settings.depthBufferStreamResolution = XR_REMOTING_DEPTH_BUFFER_STREAM_RESOLUTION_QUARTER_MSFT;
+            break;
+        case StreamProfile::Custom:
+            break;
+        }
+        return settings;
+    }
+
+    const char* GetStreamProfileName(StreamProfile profile) {
+        switch (profile) {
+        case StreamProfile::Lan:
+            return "lan";
+        case StreamProfile::WiFi:
+            return "wifi";
+        case StreamProfile::Cellular:
+            return "cellular";
+        default:
+            return "custom";
+        }
+    }
+
+    const char* GetMirrorModeName(MirrorMode mode) {
+        switch (mode) {
+        case MirrorMode::Full:
+            return "full";
+        case MirrorMode::Throttled:
+            return "throttled";
+        case MirrorMode::Downscaled:
+            return "downscaled";
+        default:
+            return "off";
+        }
+    }
+
+    const char* GetStressDistributionName(StressDistribution distribution) {
+        switch (distribution) {
+        case StressDistribution::Grid:
+            return "grid";
+        case StressDistribution::Sphere:
+            return "sphere";
+        default:
+            return "random";
+        }
+    }
+
     void ParseCommandLine(sample::AppOptions& options) {
         int numArgs = __argc;
         char** argList = __argv;
 
+        // Apply the profile first, so that it can be refined with the individual stream arguments independent of their order.
+        for (int i = 1; i + 1 < numArgs; ++i) {
+            if (_stricmp(argList[i], "-profile") == 0 && TryParseStreamProfile(argList[i + 1], options.streamProfile)) {
+                options.streamSettings = GetStreamProfileSettings(options.streamProfile);
+            }
+        }
+
         for (int i = 1; i < numArgs; ++i) {
             if (strlen(argList[i]) == 0) {
                 continue;
@@ -82,6 +158,203 @@ namespace sample {
                     continue;
                 }
 
+                if (param == "bitrate") {
+                    if (numArgs > i + 1) {
+                        std::string bitrateStr = argList[i + 1];
+                        try {
+                            options.streamSettings.maxBitrateKbps = std::stoi(bitrateStr);
+                            options.streamProfile = StreamProfile::Custom;
+                        } catch (const std::invalid_argument&) {
+                            // Ignore invalid bitrate strings.
+                        }
+                        i++;
+                    }
+                    continue;
+                }
+
+                if (param == "profile") {
+                    // Already applied above.
+                    i++;
+                    continue;
+                }
+
+                if (param == "codec") {
+                    if (numArgs > i + 1) {
+                        std::string codec = argList[i + 1];
+                        std::transform(codec.begin(), codec.end(), codec.begin(), ::tolower);
+                        if (codec == "h264") {
+                            options.streamSettings.videoCodec = XR_REMOTING_VIDEO_CODEC_H264_MSFT;
+                        } else if (codec == "h265") {
+                            options.streamSettings.videoCodec = XR_REMOTING_VIDEO_CODEC_H265_MSFT;
+                        } else if (codec == "any") {
+                            options.streamSettings.videoCodec = XR_REMOTING_VIDEO_CODEC_ANY_MSFT;
+                        }
+                        options.streamProfile = StreamProfile::Custom;
+                        i++;
+                    }
+                    continue;
+                }
+
+                if (param == "depthresolution") {
+                    if (numArgs > i + 1) {
+                        std::string resolution = argList[i + 1];
+                        std::transform(resolution.begin(), resolution.end(), resolution.begin(), ::tolower);
+                        if (resolution == "full") {
+                            options.streamSettings.depthBufferStreamResolution = XR_REMOTING_DEPTH_BUFFER_STREAM_RESOLUTION_FULL_MSFT;
+                        } else if (resolution == "half") {
+                            options.streamSettings.depthBufferStreamResolution = XR_REMOTING_DEPTH_BUFFER_STREAM_RESOLUTION_HALF_MSFT;
+                        } else if (resolution == "quarter") {
+                            options.streamSettings.depthBufferStreamResolution = XR_REMOTING_DEPTH_BUFFER_STREAM_RESOLUTION_QUARTER_MSFT;
+                        }
+                        options.streamProfile = StreamProfile::Custom;
+                        i++;
+                    }
+                    continue;
+                }
+
+                if (param == "audio") {
+                    options.streamSettings.enableAudio = true;
+                    options.streamProfile = StreamProfile::Custom;
+                    continue;
+                }
+
+                if (param == "noaudio") {
+                    options.streamSettings.enableAudio = false;
+                    options.streamProfile = StreamProfile::Custom;
+                    continue;
+                }
+
+                if (param == "mirror") {
+                    if (numArgs > i + 1) {
+                        std::string mode = argList[i + 1];
+                        std::transform(mode.begin(), mode.end(), mode.begin(), ::tolower);
+                        for (MirrorMode candidate : {MirrorMode::Full, MirrorMode::Throttled, MirrorMode::Downscaled, MirrorMode::Off}) {
+                            if (mode == GetMirrorModeName(candidate)) {
+                                options.mirrorMode = candidate;
+                            }
+                        }
+                        i++;
+                    }
+                    continue;
+                }
+
+                if (param == "mirrorinterval") {
+                    if (numArgs > i + 1) {
+                        std::string intervalStr = argList[i + 1];
+                        try {
+                            options.mirrorInterval = std::max(std::stoi(intervalStr), 1);
+                        } catch (const std::invalid_argument&) {
+                            // Ignore invalid interval strings.
+                        }
+                        i++;
+                    }
+                    continue;
+                }
+
+                if (param == "colorformat") {
+                    if (numArgs > i + 1) {
+                        std::string format = argList[i + 1];
+                        std::transform(format.begin(), format.end(), format.begin(), ::tolower);
+                        if (format == "linear") {
+                            options.colorFormat = ColorFormatPreference::Linear;
+                        } else if (format == "srgb") {
+                            options.colorFormat = ColorFormatPreference::Srgb;
+                        } else if (format == "auto") {
+                            options.colorFormat = ColorFormatPreference::Auto;
+                        }
+                        i++;
+                    }
+                    continue;
+                }
+
+                if (param == "depthformat") {
+                    if (numArgs > i + 1) {
+                        std::string format = argList[i + 1];
+                        std::transform(format.begin(), format.end(), format.begin(), ::tolower);
+                        if (format == "d32") {
+                            options.depthFormat = DepthFormatPreference::Float32;
+                        } else if (format == "d16") {
+                            options.depthFormat = DepthFormatPreference::Unorm16;
+                        } else if (format == "auto") {
+                            options.depthFormat = DepthFormatPreference::Auto;
+                        }
+                        i++;
+                    }
+                    continue;
+                }
+
+                if (param == "fulldepthrange") {
+                    options.tightDepthRange = false;
+                    continue;
+                }
+
+                if (param == "samplecount") {
+                    if (numArgs > i + 1) {
+                        std::string sampleCountStr = argList[i + 1];
+                        try {
+                            options.swapchainSampleCount = std::stoi(sampleCountStr);
+                        } catch (const std::invalid_argument&) {
+                            // Ignore invalid sample count strings.
+                        }
+                        i++;
+                    }
+                    continue;
+                }
+
+                if (param == "stress") {
+                    if (numArgs > i + 1) {
+                        std::string countStr = argList[i + 1];
+                        try {
+                            options.stressCubeCount = std::stoi(countStr);
+                        } catch (const std::invalid_argument&) {
+                            // Ignore invalid cube count strings.
+                        }
+                        i++;
+                    }
+                    continue;
+                }
+
+                if (param == "stressdistribution") {
+                    if (numArgs > i + 1) {
+                        std::string distribution = argList[i + 1];
+                        std::transform(distribution.begin(), distribution.end(), distribution.begin(), ::tolower);
+                        for (StressDistribution candidate :
+                             {StressDistribution::Grid, StressDistribution::Sphere, StressDistribution::Random}) {
+                            if (distribution == GetStressDistributionName(candidate)) {
+                                options.stressDistribution = candidate;
+                            }
+                        }
+                        i++;
+                    }
+                    continue;
+                }
+
+                if (param == "stresschurn") {
+                    if (numArgs > i + 1) {
+                        std::string churnStr = argList[i + 1];
+                        try {
+                            options.stressChurnPerSecond = std::max(std::stof(churnStr), 0.0f);
+                        } catch (const std::invalid_argument&) {
+                            // Ignore invalid churn strings.
+                        }
+                        i++;
+                    }
+                    continue;
+                }
+
+                if (param == "stressstep") {
+                    if (numArgs > i + 1) {
+                        std::string stepStr = argList[i + 1];
+                        try {
+                            options.stressStepSeconds = std::max(std::stoi(stepStr), 1);
+                        } catch (const std::invalid_argument&) {
+                            // Ignore invalid step strings.
+                        }
+                        i++;
+                    }
+                    continue;
+                }
+
                 if (param == "secureconnection") {
                     options.secureConnection = true;
                     continue;
@@ -12,11 +12,51 @@
 #pragma once
 
 namespace sample {
+    // Presets for the remote context properties, trading quality for latency on slower networks.
+    enum class StreamProfile { Custom, Lan, WiFi, Cellular };
+
+    struct StreamSettings {
+        uint32_t maxBitrateKbps{20000};
+        XrRemotingVideoCodecMSFT videoCodec{XR_REMOTING_VIDEO_CODEC_H265_MSFT};
+        XrRemotingDepthBufferStreamResolutionMSFT depthBufferStreamResolution{XR_REMOTING_DEPTH_BUFFER_STREAM_RESOLUTION_HALF_MSFT};
+        bool enableAudio{false};
+    };
+
+    // StreamProfile::Custom returns the default settings.
+    StreamSettings GetStreamProfileSettings(StreamProfile profile);
+    const char* GetStreamProfileName(StreamProfile profile);
+
+    // How the frames streamed to the headset are mirrored to the desktop window.
+    enum class MirrorMode { Full, Throttled, Downscaled, Off };
+    const char* GetMirrorModeName(MirrorMode mode);
+
+    // Swapchain format preferences. Auto keeps the order in which the runtime prefers the formats the app supports.
+    enum class ColorFormatPreference { Auto, Linear, Srgb };
+
+    // Auto prefers 16 bit depth while the depth buffer is streamed at reduced resolution, where the extra precision is lost.
+    enum class DepthFormatPreference { Auto, Float32, Unorm16 };
+
+    // Where the cubes of the stress test are placed: a grid in front of the user, a shell around the user or a box in front.
+    enum class StressDistribution { Grid, Sphere, Random };
+    const char* GetStressDistributionName(StressDistribution distribution);
+
     struct AppOptions {
         bool listen{false};
         std::string host;
         uint16_t port{0};
         uint16_t transportPort{0};
+        StreamProfile streamProfile{StreamProfile::Custom};
+        StreamSettings streamSettings;
+        MirrorMode mirrorMode{MirrorMode::Full};
+        uint32_t mirrorInterval{4}; // Every how many frames MirrorMode::Throttled mirrors a frame.
+        ColorFormatPreference colorFormat{ColorFormatPreference::Auto};
+        DepthFormatPreference depthFormat{DepthFormatPreference::Auto};
+        uint32_t swapchainSampleCount{0}; // 0 uses the sample count recommended by the runtime.
+        bool tightDepthRange{true};       // Fit the depth range of every frame around the visible content.
+        uint32_t stressCubeCount{0};      // Number of animated cubes of the stress test, 0 disables it.
+        StressDistribution stressDistribution{StressDistribution::Random};
+        float stressChurnPerSecond{0.0f}; // Share of the stress test cubes respawned per second.
+        uint32_t stressStepSeconds{10};   // The stress test doubles its cube count every that many seconds.
         bool isStandalone = false;
         bool noUserWait = false;
         bool useEphemeralPort = false;
@@ -0,0 +1,63 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+#include <functional>
+
+namespace sample {
+    // Routes messages received over a remoting data channel to the handler registered for their type, the first byte of a
+    // message. Handlers get a view of the received data, which is only valid during the call; nothing is copied or allocated
+    // per message.
+    class DataChannelDispatcher {
+    public:
+        using Handler = std::function<void(winrt::array_view<const uint8_t> message)>;
+
+        // Messages without a handler for their type go to the default handler, if there is one.
+        void Register(uint8_t type, Handler handler) {
+            m_handlers[type] = std::move(handler);
+        }
+
+        void SetDefaultHandler(Handler handler) {
+            m_defaultHandler = std::move(handler);
+        }
+
+        // Dispatches a packet containing a single message.
+        void Dispatch(winrt::array_view<const uint8_t> message) const {
+            if (message.empty()) {
+                return;
+            }
+
+            const Handler& handler = m_handlers[message[0]] ? m_handlers[message[0]] : m_defaultHandler;
+            if (handler) {
+                handler(message);
+            }
+        }
+
+    private:
+        std::array<Handler, 256> m_handlers;
+        Handler m_defaultHandler;
+    };
+
+    // Buffer for retrieving received packets, reused for all packets. It only grows when a packet is larger than all before.
+    class DataChannelReceiveBuffer {
+    public:
+        // Returns storage for a packet of the given size, valid until the next call.
+        winrt::array_view<uint8_t> Acquire(uint32_t size) {
+            if (m_buffer.size() < size) {
+                m_buffer.resize(std::max<size_t>(size, m_buffer.size() * 2));
+            }
+            return winrt::array_view<uint8_t>(m_buffer.data(), m_buffer.data() + size);
+        }
+
+    private:
+        std::vector<uint8_t> m_buffer;
+    };
+} // namespace sample
@@ -0,0 +1,92 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#include <pch.h>
+
+#include <DataChannelSender.h>
+
+namespace sample {
+    DataChannelSender::DataChannelSender(uint64_t sendQueueLimit)
+        : m_sendQueueLimit(sendQueueLimit) {
+        m_batch.reserve(MaxBatchSize);
+    }
+
+    bool DataChannelSender::Enqueue(Lane lane, const uint8_t* data, size_t size) {
+        if (size == 0 || size > MaxMessageSize) {
+            return false;
+        }
+
+        m_pushedMessages.Push({lane, Message(data, data + size)});
+        return true;
+    }
+
+    void DataChannelSender::Flush(uint64_t sendQueueSize, const SendFunction& send) {
+        MovePushedMessages();
+
+        if (sendQueueSize < m_sendQueueLimit) {
+            uint64_t budget = m_sendQueueLimit - sendQueueSize;
+            SendLane(Lane::Reliable, budget, send);
+            SendLane(Lane::Unreliable, budget, send);
+        }
+
+        // Unreliable messages are never delayed to a later flush.
+        m_statistics.messagesDropped += m_unreliableMessages.size();
+        m_unreliableMessages.clear();
+    }
+
+    void DataChannelSender::Clear() {
+        MovePushedMessages();
+
+        m_statistics.messagesDropped += m_reliableMessages.size() + m_unreliableMessages.size();
+        m_reliableMessages.clear();
+        m_unreliableMessages.clear();
+    }
+
+    void DataChannelSender::MovePushedMessages() {
+        m_pushedMessages.Drain([this](std::pair<Lane, Message>&& message) {
+            (message.first == Lane::Reliable ? m_reliableMessages : m_unreliableMessages).push_back(std::move(message.second));
+        });
+    }
+
+    void DataChannelSender::SendLane(Lane lane, uint64_t& budget, const SendFunction& send) {
+        std::deque<Message>& messages = lane == Lane::Reliable ? m_reliableMessages : m_unreliableMessages;
+
+        while (!messages.empty()) {
+            m_batch.clear();
+
+            size_t messageCount = 0;
+            for (const Message& message : messages) {
+                const size_t size = sizeof(uint16_t) + message.size();
+                if ((!m_batch.empty() && m_batch.size() + size > MaxBatchSize) || m_batch.size() + size > budget) {
+                    break;
+                }
+
+                m_batch.push_back(static_cast<uint8_t>(message.size() & 0xFF));
+                m_batch.push_back(static_cast<uint8_t>(message.size() >> 8));
+                m_batch.insert(m_batch.end(), message.begin(), message.end());
+                messageCount++;
+            }
+
+            if (messageCount == 0) {
+                // The budget is used up.
+                return;
+            }
+
+            // The messages are only removed once the batch was handed to the channel, in case sending throws.
+            send(m_batch.data(), static_cast<uint32_t>(m_batch.size()), lane == Lane::Reliable);
+            messages.erase(messages.begin(), messages.begin() + messageCount);
+
+            budget -= m_batch.size();
+            m_statistics.messagesSent += messageCount;
+            m_statistics.batchesSent++;
+        }
+    }
+} // namespace sample
@@ -0,0 +1,84 @@
+//*********************************************************
+//
+// Copyright (c) Microsoft. All rights reserved.
+// This code is licensed under the MIT License (MIT).
+// THIS CODE IS PROVIDED *AS IS* WITHOUT WARRANTY OF
+// ANY KIND, EITHER EXPRESS OR IMPLIED, INCLUDING ANY
+// IMPLIED WARRANTIES OF FITNESS FOR A PARTICULAR
+// PURPOSE, MERCHANTABILITY, OR NON-INFRINGEMENT.
+//
+//*********************************************************
+
+#pragma once
+#include <deque>
+#include <functional>
+
+#include <Utils.h>
+
+namespace sample {
+    // Sends application messages over a remoting data channel.
+    // Messages can be enqueued from any thread. Flush coalesces the queued messages into batches of up to MaxBatchSize bytes
+    // and sends them, reliable messages first. Sending is paced by the send queue size of the channel: a flush only sends
+    // as much as fits below the send queue limit. Reliable messages which did not fit stay queued for the next flush,
+    // unreliable ones are dropped, as newer messages supersede them.
+    //
+    // Each batch is a sequence of messages, every message prefixed with its size as little endian uint16_t.
+    class DataChannelSender {
+    public:
+        enum class Lane { Reliable, Unreliable };
+
+        // Keeps a batch within a single network packet.
+        static constexpr size_t MaxBatchSize = 1200;
+
+        // Messages larger than a batch are sent in a batch of their own.
+        static constexpr size_t MaxMessageSize = UINT16_MAX;
+
+        using SendFunction = std::function<void(const uint8_t* batch, uint32_t size, bool guaranteedDelivery)>;
+
+        struct Statistics {
+            uint64_t messagesSent{0};
+            uint64_t batchesSent{0};
+            uint64_t messagesDropped{0};
+        };
+
+        explicit DataChannelSender(uint64_t sendQueueLimit = 256 * 1024);
+
+        DataChannelSender(const DataChannelSender&) = delete;
+        DataChannelSender& operator=(const DataChannelSender&) = delete;
+
+        // Thread-safe and lock-free. Returns false if the message is empty or larger than MaxMessageSize.
+        bool Enqueue(Lane lane, const uint8_t* data, size_t size);
+
+        // Sends queued messages while the send queue of the channel stays below the limit. Must be called regularly, e.g. once
+        // per frame, always from the same thread.
+        void Flush(uint64_t sendQueueSize, const SendFunction& send);
+
+        // Drops all queued messages, e.g. after the channel was closed. Must be called from the thread calling Flush.
+        void Clear();
+
+        // Must be called from the thread calling Flush.
+        const Statistics& GetStatistics() const {
+            return m_statistics;
+        }
+
+    private:
+        using Message = std::vector<uint8_t>;
+
+        void MovePushedMessages();
+
+        // Appends messages of the lane to batches and sends them until the lane is empty or the budget is used up.
+        void SendLane(Lane lane, uint64_t& budget, const SendFunction& send);
+
+        const uint64_t m_sendQueueLimit;
+
+        // Messages enqueued since the last flush, in the lock-free queue of the classic remote's utilities.
+        Utils::MpscQueue<std::pair<Lane, Message>> m_pushedMessages;
+
+        // Messages waiting to be sent, only accessed by the thread calling Flush.
+        std::deque<Message> m_reliableMessages;
+        std::deque<Message> m_unreliableMessages;
+        std::vector<uint8_t> m_batch;
+
+        Statistics m_statistics;
+    };
+} // namespace sample
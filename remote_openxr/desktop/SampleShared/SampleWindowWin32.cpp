@@ -120,7 +120,9 @@ namespace sample {
         : SampleWindowWin32(title, device, 512, 512) {
     }
 
-    SampleWindowWin32::SampleWindowWin32(std::wstring title, ID3D11Device* device, long width, long height) {
+    SampleWindowWin32::SampleWindowWin32(std::wstring title, ID3D11Device* device, long width, long height)
+        : m_width(width)
+        , m_height(height) {
         std::promise<HWND> hWndPromise;
         std::future<HWND> hWndFuture = hWndPromise.get_future();
 
@@ -143,6 +145,7 @@ namespace sample {
 
         m_hWnd = hWndFuture.get();
         m_swapchain = CreateSwapchain(m_hWnd, device);
+        winrt::check_hresult(m_swapchain->GetBuffer(0, IID_PPV_ARGS(m_swapchainTexture.put())));
 
         ShowWindow(m_hWnd, SW_SHOWNORMAL);
     }
@@ -153,16 +156,23 @@ namespace sample {
     }
 
     ID3D11Texture2D* SampleWindowWin32::GetNextSwapchainTexture() {
-        ID3D11Texture2D* texture;
-        m_swapchain->GetBuffer(0, IID_PPV_ARGS(&texture));
-
-        return texture;
+        // Buffer 0 of a flip model swapchain always refers to the current back buffer.
+        return m_swapchainTexture.get();
     }
 
     void SampleWindowWin32::PresentSwapchain() {
         m_swapchain->Present(0, 0);
     }
 
+    void SampleWindowWin32::SetSwapchainScale(float scale) {
+        const UINT width = std::max(1u, static_cast<UINT>(m_width * scale));
+        const UINT height = std::max(1u, static_cast<UINT>(m_height * scale));
+
+        m_swapchainTexture = nullptr;
+        winrt::check_hresult(m_swapchain->ResizeBuffers(0, width, height, DXGI_FORMAT_UNKNOWN, 0));
+        winrt::check_hresult(m_swapchain->GetBuffer(0, IID_PPV_ARGS(m_swapchainTexture.put())));
+    }
+
     void SampleWindowWin32::OnClosed() {
         std::lock_guard lock(m_windowMutex);
         m_isClosed = true;
@@ -32,6 +32,10 @@ namespace sample {
         ID3D11Texture2D* GetNextSwapchainTexture();
         void PresentSwapchain();
 
+        // Resizes the swapchain buffers relative to the window size; they are stretched to the window when presented.
+        // All views of the swapchain texture must have been released before.
+        void SetSwapchainScale(float scale);
+
         void OnClosed();
         bool IsClosed() const;
 
@@ -41,6 +45,9 @@ namespace sample {
 
         HWND m_hWnd = nullptr;
         winrt::com_ptr<IDXGISwapChain1> m_swapchain;
+        winrt::com_ptr<ID3D11Texture2D> m_swapchainTexture;
+        long m_width = 0;
+        long m_height = 0;
 
         KeyPressHandler m_keyPressedHandler;
         bool m_isClosed;
@@ -30,6 +30,12 @@
 #define FOR_EACH_SPATIAL_ANCHOR_FUNCTION(_)
 #endif
 
+#if XR_KHR_locate_spaces
+#define FOR_EACH_LOCATE_SPACES_FUNCTION(_) _(xrLocateSpacesKHR)
+#else
+#define FOR_EACH_LOCATE_SPACES_FUNCTION(_)
+#endif
+
 #if XR_MSFT_holographic_remoting
 #define FOR_EACH_HAR_EXPERIMENTAL_EXTENSION_FUNCTION(_) \
     _(xrRemotingSetContextPropertiesMSFT)               \
@@ -59,6 +65,7 @@
 #define FOR_EACH_SAMPLE_EXTENSION_FUNCTION(_)       \
     FOR_EACH_D3D11_EXTENSION_FUNCTION(_)            \
     FOR_EACH_SPATIAL_ANCHOR_FUNCTION(_)             \
+    FOR_EACH_LOCATE_SPACES_FUNCTION(_)              \
     FOR_EACH_HAR_EXPERIMENTAL_EXTENSION_FUNCTION(_) \
     FOR_EACH_HAR_EXPERIMENTAL_SPEECH_EXTENSION_FUNCTION(_)
 
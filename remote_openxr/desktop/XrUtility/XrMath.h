@@ -19,6 +19,8 @@
 #include <DirectXMath.h>
 #include <stdexcept>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
 
 namespace xr::math {
     constexpr float QuaternionEpsilon = 0.01f;
@@ -78,6 +80,13 @@ namespace xr::math {
     DirectX::XMMATRIX XM_CALLCONV LoadInvertedXrPose(const XrPosef& rigidTransform);
     DirectX::XMVECTOR XM_CALLCONV LoadXrExtent(const XrExtent2Df& extend);
 
+    // Batch conversion of scaled poses to transposed model matrices for shader usage, i.e.
+    // XMMatrixTranspose(XMMatrixScaling(scales[i]) * LoadXrPose(poses[i])) for i in [0, count).
+    // Matrix i is written to the XMFLOAT4X4 at byte offset i * stride of outMatrices, so that it can be stored straight into
+    // the instance data which holds it.
+    void StoreTransposedXrPoseMatrices(
+        const XrPosef* poses, const XrVector3f* scales, size_t count, DirectX::XMFLOAT4X4* outMatrices, size_t stride);
+
     // Convert DX types to XR
     void XM_CALLCONV StoreXrVector2(XrVector2f* outVec, DirectX::FXMVECTOR inVec);
     void XM_CALLCONV StoreXrVector3(XrVector3f* outVec, DirectX::FXMVECTOR inVec);
@@ -282,6 +291,75 @@ namespace xr::math {
         return LoadXrPose(Pose::Invert(pose));
     }
 
+    inline void StoreTransposedXrPoseMatrices(
+        const XrPosef* poses, const XrVector3f* scales, size_t count, DirectX::XMFLOAT4X4* outMatrices, size_t stride) {
+        using namespace DirectX;
+
+        const auto outMatrix = [&](size_t i) {
+            return reinterpret_cast<XMFLOAT4X4*>(reinterpret_cast<uint8_t*>(outMatrices) + i * stride);
+        };
+
+        // Four poses at a time: the quaternions, positions and scales are transposed into one vector per component, so that
+        // each vector operation computes one matrix element of all four poses. Transposing the element vectors back yields the
+        // rows of the transposed model matrices. The last row is always (0, 0, 0, 1).
+        size_t i = 0;
+        for (; i + 4 <= count; i += 4) {
+            const XrPosef* p = poses + i;
+            const XrVector3f* s = scales + i;
+            const XMMATRIX q = XMMatrixTranspose(XMMATRIX(LoadXrQuaternion(p[0].orientation),
+                                                          LoadXrQuaternion(p[1].orientation),
+                                                          LoadXrQuaternion(p[2].orientation),
+                                                          LoadXrQuaternion(p[3].orientation)));
+            const XMMATRIX t = XMMatrixTranspose(XMMATRIX(
+                LoadXrVector3(p[0].position), LoadXrVector3(p[1].position), LoadXrVector3(p[2].position), LoadXrVector3(p[3].position)));
+            const XMMATRIX scale =
+                XMMatrixTranspose(XMMATRIX(LoadXrVector3(s[0]), LoadXrVector3(s[1]), LoadXrVector3(s[2]), LoadXrVector3(s[3])));
+
+            const XMVECTOR x = q.r[0];
+            const XMVECTOR y = q.r[1];
+            const XMVECTOR z = q.r[2];
+            const XMVECTOR w = q.r[3];
+            const XMVECTOR x2 = XMVectorAdd(x, x);
+            const XMVECTOR y2 = XMVectorAdd(y, y);
+            const XMVECTOR z2 = XMVectorAdd(z, z);
+            const XMVECTOR xx = XMVectorMultiply(x, x2);
+            const XMVECTOR yy = XMVectorMultiply(y, y2);
+            const XMVECTOR zz = XMVectorMultiply(z, z2);
+            const XMVECTOR xy = XMVectorMultiply(x, y2);
+            const XMVECTOR xz = XMVectorMultiply(x, z2);
+            const XMVECTOR yz = XMVectorMultiply(y, z2);
+            const XMVECTOR wx = XMVectorMultiply(w, x2);
+            const XMVECTOR wy = XMVectorMultiply(w, y2);
+            const XMVECTOR wz = XMVectorMultiply(w, z2);
+
+            // Same rotation as XMMatrixRotationQuaternion, with row j of the rotation scaled by component j of the scale.
+            const XMVECTOR sx = scale.r[0];
+            const XMVECTOR sy = scale.r[1];
+            const XMVECTOR sz = scale.r[2];
+            const XMMATRIX row0 = XMMatrixTranspose(XMMATRIX(XMVectorMultiply(sx, XMVectorSubtract(g_XMOne, XMVectorAdd(yy, zz))),
+                                                             XMVectorMultiply(sy, XMVectorSubtract(xy, wz)),
+                                                             XMVectorMultiply(sz, XMVectorAdd(xz, wy)),
+                                                             t.r[0]));
+            const XMMATRIX row1 = XMMatrixTranspose(XMMATRIX(XMVectorMultiply(sx, XMVectorAdd(xy, wz)),
+                                                             XMVectorMultiply(sy, XMVectorSubtract(g_XMOne, XMVectorAdd(xx, zz))),
+                                                             XMVectorMultiply(sz, XMVectorSubtract(yz, wx)),
+                                                             t.r[1]));
+            const XMMATRIX row2 = XMMatrixTranspose(XMMATRIX(XMVectorMultiply(sx, XMVectorSubtract(xz, wy)),
+                                                             XMVectorMultiply(sy, XMVectorAdd(yz, wx)),
+                                                             XMVectorMultiply(sz, XMVectorSubtract(g_XMOne, XMVectorAdd(xx, yy))),
+                                                             t.r[2]));
+
+            for (size_t j = 0; j < 4; j++) {
+                XMStoreFloat4x4(outMatrix(i + j), XMMATRIX(row0.r[j], row1.r[j], row2.r[j], g_XMIdentityR3));
+            }
+        }
+
+        for (; i < count; i++) {
+            const XMMATRIX scaleMatrix = XMMatrixScaling(scales[i].x, scales[i].y, scales[i].z);
+            XMStoreFloat4x4(outMatrix(i), XMMatrixTranspose(scaleMatrix * LoadXrPose(poses[i])));
+        }
+    }
+
     inline void XM_CALLCONV StoreXrVector2(XrVector2f* outVec, DirectX::FXMVECTOR inVec) {
         DirectX::XMStoreFloat2(&detail::implement_math_cast<DirectX::XMFLOAT2>(*outVec), inVec);
     }